@@ -0,0 +1,103 @@
+/*****************************************************************************
+ *
+ * bench.h -- shared definitions for the benchmark harness
+ *
+ * Copyright 2026
+ *   James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#ifndef OA_BENCH_H
+#define OA_BENCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct {
+	const char*		name;
+	unsigned int	x;
+	unsigned int	y;
+} benchFrameSize;
+
+// Results for one kernel/variant/frame size combination.  Times are in
+// nanoseconds.
+
+typedef struct {
+	const char*		kernel;
+	char					variant[ 64 ];
+	const benchFrameSize*	size;
+	unsigned int	iterations;
+	double				totalTime;
+	uint64_t			p50;
+	uint64_t			p99;
+	uint64_t			max;
+	double				fps;
+	double				mpps;
+	long					peakRSS;		// kB
+	uint64_t			droppedFrames;
+} benchResult;
+
+typedef int ( *benchFunc )( void* );
+
+// Fixed frame time (2026-01-01T00:00:00Z, in nanoseconds) so that getting
+// the current time isn't part of the cost of writing a frame
+
+#define	BENCH_FRAME_TIME	(( int64_t ) 1767225600 * 1000000000 )
+
+extern const benchFrameSize	benchFrameSizes[];
+
+// Options
+
+extern double				benchMinTime;
+extern unsigned int	benchMinIterations;
+extern unsigned int	benchMaxIterations;
+extern const char*	benchTmpDir;
+extern int					benchVerbose;
+
+extern int			benchSizeSelected ( const benchFrameSize* );
+extern int			benchKernelSelected ( const char* );
+
+extern uint64_t	benchTime ( void );
+extern void*		benchAlloc ( size_t );
+extern void			benchFill ( void*, size_t, uint32_t );
+extern void			benchResetPeakRSS ( void );
+extern long			benchPeakRSS ( void );
+
+extern int			benchRun ( const char*, const char*, const benchFrameSize*,
+									benchFunc, void* );
+extern void			benchReport ( benchResult* );
+
+extern void			benchConvert ( const benchFrameSize* );
+extern void			benchDemosaic ( const benchFrameSize* );
+extern void			benchStack ( const benchFrameSize* );
+extern void			benchFocus ( const benchFrameSize* );
+extern void			benchFlip ( const benchFrameSize* );
+extern void			benchCrop ( const benchFrameSize* );
+extern void			benchHistogram ( const benchFrameSize* );
+extern void			benchMaster ( const benchFrameSize* );
+extern void			benchRegister ( const benchFrameSize* );
+extern void			benchStars ( const benchFrameSize* );
+extern void			benchWriteSER ( const benchFrameSize* );
+extern void			benchWriteFITS ( const benchFrameSize* );
+extern void			benchWritePNG ( const benchFrameSize* );
+extern void			benchPipeline ( const benchFrameSize* );
+
+#endif	/* OA_BENCH_H */
@@ -0,0 +1,688 @@
+/*****************************************************************************
+ *
+ * benchKernels.c -- benchmarks for the image processing functions
+ *
+ * Copyright 2026
+ *   James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <oa_common.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openastro/errno.h>
+#include <openastro/video.h>
+#include <openastro/video/formats.h>
+#include <openastro/demosaic.h>
+#include <openastro/imgproc.h>
+
+#include "bench.h"
+
+// Big enough for any pixel format we might be asked to convert to or from
+#define	MAX_BYTES_PER_PIXEL		8
+
+#define	PROBE_SIZE						16
+
+#define	NUM_STACK_DEPTHS			2
+
+static const unsigned int	stackDepths[ NUM_STACK_DEPTHS ] = { 4, 16 };
+
+typedef struct {
+	void*					source;
+	void*					target;
+	unsigned int	x;
+	unsigned int	y;
+	int						sourceFormat;
+	int						targetFormat;
+	int						method;
+	int						cfaPattern;
+	int						bitDepth;
+	unsigned int	length;
+	void**				frames;
+	unsigned int	numFrames;
+	int						( *stackFunc )( void**, unsigned int, void*, unsigned int,
+								unsigned int );
+	int						( *stackKSFunc )( void**, unsigned int, void*, unsigned int,
+								double, unsigned int );
+	oaHistogram		histogram;
+	oaFocusContext	focus;
+	oaMasterBuilder	master;
+	oaRegistration	registration;
+	oaStarDetector	stars;
+} kernelArgs;
+
+static int	_convert ( void* );
+static int	_demosaic ( void* );
+static int	_stack ( void* );
+static int	_stackKappaSigma ( void* );
+static int	_focus ( void* );
+static int	_focusContext ( void* );
+static int	_flip ( void* );
+static int	_crop ( void* );
+static int	_histogram ( void* );
+static int	_master ( void* );
+static int	_registerMeasure ( void* );
+static int	_registerShift ( void* );
+static int	_stars ( void* );
+
+
+void
+benchConvert ( const benchFrameSize* size )
+{
+	static int		pairs[ OA_PIX_FMT_LAST_P1 * 4 ][ 2 ];
+	static int		numPairs = -1;
+	kernelArgs		args;
+	size_t				length;
+	char					variant[ 64 ];
+	int						i, j;
+
+	length = ( size_t ) size->x * size->y * MAX_BYTES_PER_PIXEL;
+	if (!( args.source = benchAlloc ( length ))) {
+		return;
+	}
+	if (!( args.target = benchAlloc ( length ))) {
+		free ( args.source );
+		return;
+	}
+
+	// oaconvert() says whether it knows how to do a given conversion, so
+	// rather than keeping a list here that will get out of step, try
+	// every pair on a tiny frame once and benchmark the ones that work
+
+	if ( numPairs < 0 ) {
+		numPairs = 0;
+		benchFill ( args.source, PROBE_SIZE * PROBE_SIZE * MAX_BYTES_PER_PIXEL,
+				1 );
+		for ( i = 1; i < OA_PIX_FMT_LAST_P1; i++ ) {
+			for ( j = 1; j < OA_PIX_FMT_LAST_P1; j++ ) {
+				if ( i != j && numPairs < OA_PIX_FMT_LAST_P1 * 4 &&
+						!oaconvert ( args.source, args.target, PROBE_SIZE, PROBE_SIZE,
+						i, j )) {
+					pairs[ numPairs ][0] = i;
+					pairs[ numPairs ][1] = j;
+					numPairs++;
+				}
+			}
+		}
+	}
+
+	benchFill ( args.source, length, 1 );
+	args.x = size->x;
+	args.y = size->y;
+	for ( i = 0; i < numPairs; i++ ) {
+		args.sourceFormat = pairs[i][0];
+		args.targetFormat = pairs[i][1];
+		( void ) snprintf ( variant, sizeof ( variant ), "%s->%s",
+				oaFrameFormats[ args.sourceFormat ].name,
+				oaFrameFormats[ args.targetFormat ].name );
+		benchRun ( "convert", variant, size, _convert, &args );
+	}
+
+	free ( args.source );
+	free ( args.target );
+}
+
+
+void
+benchDemosaic ( const benchFrameSize* size )
+{
+	kernelArgs		args;
+	size_t				length;
+	char					variant[ 64 ];
+
+	length = ( size_t ) size->x * size->y * 2;
+	if (!( args.source = benchAlloc ( length ))) {
+		return;
+	}
+	if (!( args.target = benchAlloc ( length * 3 ))) {
+		free ( args.source );
+		return;
+	}
+	benchFill ( args.source, length, 2 );
+
+	args.x = size->x;
+	args.y = size->y;
+	args.cfaPattern = OA_DEMOSAIC_RGGB;
+	for ( args.bitDepth = 8; args.bitDepth <= 16; args.bitDepth += 8 ) {
+		for ( args.method = OA_DEMOSAIC_NEAREST_NEIGHBOUR;
+				args.method < OA_DEMOSAIC_LAST_P1; args.method++ ) {
+			( void ) snprintf ( variant, sizeof ( variant ), "%s RGGB%d",
+					oademosaicMethodName ( args.method ), args.bitDepth );
+			benchRun ( "demosaic", variant, size, _demosaic, &args );
+		}
+	}
+
+	free ( args.source );
+	free ( args.target );
+}
+
+
+void
+benchStack ( const benchFrameSize* size )
+{
+	static const struct {
+		const char*	name;
+		int					( *func )( void**, unsigned int, void*, unsigned int,
+								unsigned int );
+		int					( *ksFunc )( void**, unsigned int, void*, unsigned int,
+								double, unsigned int );
+	} modes[] = {
+		{ "sum", oaStackSum, 0 },
+		{ "mean", oaStackMean, 0 },
+		{ "median", oaStackMedian, 0 },
+		{ "maximum", oaStackMaximum, 0 },
+		{ "kappa-sigma", 0, oaStackKappaSigma },
+		{ "median-kappa-sigma", 0, oaStackMedianKappaSigma },
+		{ 0, 0, 0 }
+	};
+	static const int	formats[] = { OA_PIX_FMT_GREY8, OA_PIX_FMT_GREY16LE, 0 };
+	kernelArgs		args;
+	size_t				length;
+	char					variant[ 64 ];
+	unsigned int	d, i, maxDepth;
+	int						f, m;
+
+	maxDepth = stackDepths[ NUM_STACK_DEPTHS - 1 ];
+	length = ( size_t ) size->x * size->y * 2;
+	if (!( args.frames = calloc ( maxDepth, sizeof ( void* )))) {
+		return;
+	}
+	for ( i = 0; i < maxDepth; i++ ) {
+		if (!( args.frames[i] = benchAlloc ( length ))) {
+			while ( i-- ) {
+				free ( args.frames[i] );
+			}
+			free ( args.frames );
+			return;
+		}
+		benchFill ( args.frames[i], length, i + 1 );
+	}
+	if (!( args.target = benchAlloc ( length ))) {
+		for ( i = 0; i < maxDepth; i++ ) {
+			free ( args.frames[i] );
+		}
+		free ( args.frames );
+		return;
+	}
+
+	for ( f = 0; formats[f]; f++ ) {
+		args.targetFormat = formats[f];
+		args.length = size->x * size->y *
+				oaFrameFormats[ formats[f] ].bytesPerPixel;
+		for ( d = 0; d < NUM_STACK_DEPTHS; d++ ) {
+			args.numFrames = stackDepths[d];
+			for ( m = 0; modes[m].name; m++ ) {
+				args.stackFunc = modes[m].func;
+				args.stackKSFunc = modes[m].ksFunc;
+				( void ) snprintf ( variant, sizeof ( variant ), "%s %s x%u",
+						modes[m].name, oaFrameFormats[ formats[f] ].name,
+						args.numFrames );
+				benchRun ( "stack", variant, size, args.stackFunc ? _stack :
+						_stackKappaSigma, &args );
+			}
+		}
+	}
+
+	for ( i = 0; i < maxDepth; i++ ) {
+		free ( args.frames[i] );
+	}
+	free ( args.frames );
+	free ( args.target );
+}
+
+
+void
+benchFocus ( const benchFrameSize* size )
+{
+	static const int	formats[] = { OA_PIX_FMT_GREY8, OA_PIX_FMT_GREY16LE,
+			OA_PIX_FMT_RGGB8, OA_PIX_FMT_RGB24, 0 };
+	kernelArgs		args;
+	size_t				length;
+	char					variant[ 64 ];
+	int						f;
+
+	length = ( size_t ) size->x * size->y * 3;
+	if (!( args.source = benchAlloc ( length ))) {
+		return;
+	}
+	if (!( args.target = benchAlloc ( length ))) {
+		free ( args.source );
+		return;
+	}
+	benchFill ( args.source, length, 3 );
+
+	args.x = size->x;
+	args.y = size->y;
+	for ( f = 0; formats[f]; f++ ) {
+		args.sourceFormat = formats[f];
+		benchRun ( "focus", oaFrameFormats[ formats[f] ].name, size, _focus,
+				&args );
+		// The same again with the workspace allocated once up front
+		if ( oaFocusInit ( &args.focus, size->x, size->y, formats[f] ) ==
+				OA_ERR_NONE ) {
+			( void ) snprintf ( variant, sizeof ( variant ), "%s context",
+					oaFrameFormats[ formats[f] ].name );
+			benchRun ( "focus", variant, size, _focusContext, &args );
+			oaFocusFree ( &args.focus );
+		}
+	}
+
+	free ( args.source );
+	free ( args.target );
+}
+
+
+void
+benchFlip ( const benchFrameSize* size )
+{
+	static const int	formats[] = { OA_PIX_FMT_GREY8, OA_PIX_FMT_GREY16LE,
+			OA_PIX_FMT_RGB24, 0 };
+	static const struct {
+		const char*	name;
+		int					axis;
+	} axes[] = {
+		{ "x", OA_FLIP_X },
+		{ "y", OA_FLIP_Y },
+		{ "xy", OA_FLIP_X | OA_FLIP_Y },
+		{ 0, 0 }
+	};
+	kernelArgs		args;
+	size_t				length;
+	char					variant[ 64 ];
+	int						f, a;
+
+	length = ( size_t ) size->x * size->y * 3;
+	if (!( args.source = benchAlloc ( length ))) {
+		return;
+	}
+	benchFill ( args.source, length, 4 );
+
+	args.x = size->x;
+	args.y = size->y;
+	for ( f = 0; formats[f]; f++ ) {
+		args.sourceFormat = formats[f];
+		for ( a = 0; axes[a].name; a++ ) {
+			args.method = axes[a].axis;
+			( void ) snprintf ( variant, sizeof ( variant ), "%s %s",
+					oaFrameFormats[ formats[f] ].name, axes[a].name );
+			benchRun ( "flip", variant, size, _flip, &args );
+		}
+	}
+
+	free ( args.source );
+}
+
+
+void
+benchCrop ( const benchFrameSize* size )
+{
+	static const int	bpps[] = { 1, 2, 3, 0 };
+	kernelArgs		args;
+	size_t				length;
+	char					variant[ 64 ];
+	int						b;
+
+	length = ( size_t ) size->x * size->y * 3;
+	if (!( args.source = benchAlloc ( length ))) {
+		return;
+	}
+	benchFill ( args.source, length, 5 );
+
+	// Cropping to half the size in each direction.  The crop is done in
+	// place, so after the first pass the data is different, but the
+	// amount of work done is the same each time.
+
+	args.x = size->x;
+	args.y = size->y;
+	for ( b = 0; bpps[b]; b++ ) {
+		args.bitDepth = bpps[b];
+		( void ) snprintf ( variant, sizeof ( variant ), "half %dbpp", bpps[b] );
+		benchRun ( "crop", variant, size, _crop, &args );
+	}
+
+	free ( args.source );
+}
+
+
+/**
+ * Full-frame exact histograms, single threaded and then with the default
+ * number of threads
+ */
+
+void
+benchHistogram ( const benchFrameSize* size )
+{
+	static const int	formats[] = { OA_PIX_FMT_GREY8, OA_PIX_FMT_GREY16LE,
+			OA_PIX_FMT_RGGB16LE, OA_PIX_FMT_RGB24, 0 };
+	kernelArgs		args;
+	size_t				length;
+	char					variant[ 64 ];
+	int						f, t;
+
+	length = ( size_t ) size->x * size->y * 3;
+	if (!( args.source = benchAlloc ( length ))) {
+		return;
+	}
+	benchFill ( args.source, length, 6 );
+
+	for ( f = 0; formats[f]; f++ ) {
+		for ( t = 1; t >= 0; t-- ) {
+			if ( oaHistogramInit ( &args.histogram, size->x, size->y, formats[f],
+					t ) != OA_ERR_NONE ) {
+				continue;
+			}
+			// No point running the same thing twice on a single processor
+			if ( !t && args.histogram.numThreads == 1 ) {
+				oaHistogramFree ( &args.histogram );
+				continue;
+			}
+			( void ) snprintf ( variant, sizeof ( variant ), "%s x%d",
+					oaFrameFormats[ formats[f] ].name, args.histogram.numThreads );
+			benchRun ( "histogram", variant, size, _histogram, &args );
+			oaHistogramFree ( &args.histogram );
+		}
+	}
+
+	free ( args.source );
+}
+
+
+/**
+ * Cost of folding one more frame into a master.  The median also writes
+ * every frame to disk, so it isn't run here.
+ */
+
+void
+benchMaster ( const benchFrameSize* size )
+{
+	static const struct {
+		const char*	name;
+		int					method;
+	} methods[] = {
+		{ "mean", OA_MASTER_MEAN },
+		{ "minmax", OA_MASTER_MINMAX },
+		{ 0, 0 }
+	};
+	static const int	formats[] = { OA_PIX_FMT_GREY8, OA_PIX_FMT_GREY16LE,
+			OA_PIX_FMT_GREY16BE, 0 };
+	kernelArgs		args;
+	size_t				length;
+	char					variant[ 64 ];
+	int						f, m;
+
+	length = ( size_t ) size->x * size->y * 2;
+	if (!( args.source = benchAlloc ( length ))) {
+		return;
+	}
+	benchFill ( args.source, length, 7 );
+
+	for ( f = 0; formats[f]; f++ ) {
+		for ( m = 0; methods[m].name; m++ ) {
+			if ( oaMasterInit ( &args.master, size->x, size->y, formats[f],
+					methods[m].method, benchTmpDir, 0, 0 ) != OA_ERR_NONE ) {
+				continue;
+			}
+			( void ) snprintf ( variant, sizeof ( variant ), "%s %s x%d",
+					methods[m].name, oaFrameFormats[ formats[f] ].name,
+					args.master.numThreads );
+			benchRun ( "master", variant, size, _master, &args );
+			oaMasterFree ( &args.master );
+		}
+	}
+
+	free ( args.source );
+}
+
+
+/**
+ * Cost of measuring a frame's offset from the reference and of moving it
+ * into line, which together are the cost of aligning a frame for live
+ * stacking
+ */
+
+void
+benchRegister ( const benchFrameSize* size )
+{
+	static const int	formats[] = { OA_PIX_FMT_GREY8, OA_PIX_FMT_GREY16LE,
+			OA_PIX_FMT_RGB24, OA_PIX_FMT_RGB48LE, OA_PIX_FMT_RGB48BE, 0 };
+	kernelArgs		args;
+	size_t				length;
+	char					variant[ 64 ];
+	int						f;
+
+	length = ( size_t ) size->x * size->y * 6;
+	if (!( args.source = benchAlloc ( length ))) {
+		return;
+	}
+	if (!( args.target = benchAlloc ( length ))) {
+		free ( args.source );
+		return;
+	}
+	benchFill ( args.source, length, 7 );
+	benchFill ( args.target, length, 11 );
+
+	for ( f = 0; formats[f]; f++ ) {
+		if ( oaRegistrationInit ( &args.registration, size->x, size->y,
+				formats[f], 0, 0 ) != OA_ERR_NONE ) {
+			continue;
+		}
+		( void ) oaRegistrationSetReference ( &args.registration, args.target );
+		( void ) snprintf ( variant, sizeof ( variant ), "measure %s",
+				oaFrameFormats[ formats[f] ].name );
+		benchRun ( "register", variant, size, _registerMeasure, &args );
+		( void ) snprintf ( variant, sizeof ( variant ), "shift %s x%d",
+				oaFrameFormats[ formats[f] ].name, args.registration.numThreads );
+		benchRun ( "register", variant, size, _registerShift, &args );
+		oaRegistrationFree ( &args.registration );
+	}
+
+	free ( args.source );
+	free ( args.target );
+}
+
+
+/**
+ * Cost of finding and measuring the stars in a frame.  The frame is noise
+ * with a scattering of gaussian stars so the labelling and measuring have
+ * something to do.
+ */
+
+void
+benchStars ( const benchFrameSize* size )
+{
+	static const int	formats[] = { OA_PIX_FMT_GREY8, OA_PIX_FMT_GREY16LE,
+			OA_PIX_FMT_GREY16BE, OA_PIX_FMT_RGGB16LE, 0 };
+	kernelArgs		args;
+	size_t				length;
+	char					variant[ 64 ];
+	uint16_t*			p;
+	unsigned int	i, x, y, s;
+	int						f, dx, dy;
+
+	length = ( size_t ) size->x * size->y * 2;
+	if (!( args.source = benchAlloc ( length ))) {
+		return;
+	}
+	benchFill ( args.source, length, 7 );
+	// Keep the noise down to a few percent of full scale and add about one
+	// star per 10000 pixels
+	p = args.source;
+	for ( i = 0; i < ( unsigned int ) size->x * size->y; i++ ) {
+		p[i] = 0x0800 + ( p[i] & 0x00ff );
+	}
+	srand ( 11 );
+	for ( s = 0; s < ( unsigned int ) size->x * size->y / 10000; s++ ) {
+		x = 4 + rand() % ( size->x - 8 );
+		y = 4 + rand() % ( size->y - 8 );
+		for ( dy = -3; dy <= 3; dy++ ) {
+			for ( dx = -3; dx <= 3; dx++ ) {
+				p[ ( y + dy ) * size->x + x + dx ] += 0x6000 >> ( dx * dx + dy * dy );
+			}
+		}
+	}
+
+	for ( f = 0; formats[f]; f++ ) {
+		if ( oaStarsInit ( &args.stars, size->x, size->y, formats[f], 1000,
+				0 ) != OA_ERR_NONE ) {
+			continue;
+		}
+		( void ) snprintf ( variant, sizeof ( variant ), "%s x%d",
+				oaFrameFormats[ formats[f] ].name, args.stars.numThreads );
+		benchRun ( "stars", variant, size, _stars, &args );
+		oaStarsFree ( &args.stars );
+	}
+
+	free ( args.source );
+}
+
+
+static int
+_convert ( void* param )
+{
+	kernelArgs*		args = param;
+
+	return oaconvert ( args->source, args->target, args->x, args->y,
+			args->sourceFormat, args->targetFormat );
+}
+
+
+static int
+_demosaic ( void* param )
+{
+	kernelArgs*		args = param;
+
+	return oademosaic ( args->source, args->target, args->x, args->y,
+			args->bitDepth, args->cfaPattern, args->method );
+}
+
+
+static int
+_stack ( void* param )
+{
+	kernelArgs*		args = param;
+
+	return args->stackFunc ( args->frames, args->numFrames, args->target,
+			args->length, args->targetFormat );
+}
+
+
+static int
+_stackKappaSigma ( void* param )
+{
+	kernelArgs*		args = param;
+
+	return args->stackKSFunc ( args->frames, args->numFrames, args->target,
+			args->length, 2.0, args->targetFormat );
+}
+
+
+static int
+_focus ( void* param )
+{
+	kernelArgs*		args = param;
+
+	// The score is returned, so only negative values are errors
+	return ( oaFocusScore ( args->source, args->target, args->x, args->y,
+			args->sourceFormat ) < 0 ) ? -1 : 0;
+}
+
+
+static int
+_focusContext ( void* param )
+{
+	kernelArgs*		args = param;
+	double				score;
+
+	return oaFocusScoreFrame ( &args->focus, args->source, 0, &score );
+}
+
+
+static int
+_flip ( void* param )
+{
+	kernelArgs*		args = param;
+
+	return oaFlipImage ( args->source, args->x, args->y, args->sourceFormat,
+			args->method );
+}
+
+
+static int
+_crop ( void* param )
+{
+	kernelArgs*		args = param;
+
+	return oaInplaceCrop ( args->source, args->x, args->y, args->x / 2,
+			args->y / 2, args->bitDepth );
+}
+
+
+static int
+_histogram ( void* param )
+{
+	kernelArgs*		args = param;
+
+	return oaHistogramProcess ( &args->histogram, args->source );
+}
+
+
+static int
+_master ( void* param )
+{
+	kernelArgs*		args = param;
+
+	return oaMasterAddFrame ( &args->master, args->source );
+}
+
+
+static int
+_registerMeasure ( void* param )
+{
+	kernelArgs*		args = param;
+	double				dx, dy;
+
+	return oaRegistrationMeasure ( &args->registration, args->source, 0,
+			&dx, &dy );
+}
+
+
+static int
+_registerShift ( void* param )
+{
+	kernelArgs*		args = param;
+
+	return oaRegistrationShift ( &args->registration, args->source,
+			args->target, 3.4, -2.7 );
+}
+
+
+static int
+_stars ( void* param )
+{
+	kernelArgs*		args = param;
+	int						ret;
+
+	ret = oaStarsDetect ( &args->stars, args->source );
+	return ( ret < 0 ) ? ret : 0;
+}
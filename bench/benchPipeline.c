@@ -0,0 +1,234 @@
+/*****************************************************************************
+ *
+ * benchPipeline.c -- benchmark a complete capture pipeline using the
+ *                    synthetic dummy camera
+ *
+ * Copyright 2026
+ *   James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <oa_common.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <openastro/camera.h>
+#include <openastro/video.h>
+#include <openastro/video/formats.h>
+#include <openastro/imgproc.h>
+#include <openastro/SER.h>
+
+#include "bench.h"
+
+// The pipeline always runs for at least this long to get past start-up
+// effects and gather a reasonable number of frames
+
+#define	MIN_PIPELINE_TIME		2.0
+
+typedef struct {
+	unsigned int	x;
+	unsigned int	y;
+	void*					unpacked;
+	oaSERContext	ser;
+	int						serOK;
+	oaHistogram		histogram;
+	uint64_t			frames;
+	uint64_t			errors;
+} pipelineState;
+
+static void*	_handleFrame ( void*, void*, int, void* );
+static void		_runPipeline ( const benchFrameSize*, const char*, int, int );
+
+
+/**
+ * Frames come from the synthetic camera as fast as they can be consumed
+ * and each one is unpacked, histogrammed and written to a SER file, which
+ * is roughly what a capture application does with a 12-bit camera
+ */
+
+void
+benchPipeline ( const benchFrameSize* size )
+{
+	_runPipeline ( size, "GREY12P->SER16", OA_PIX_FMT_GREY12P,
+			OA_DUMMY_MODE_ASAP );
+	_runPipeline ( size, "GREY16LE->SER16", OA_PIX_FMT_GREY16LE,
+			OA_DUMMY_MODE_ASAP );
+}
+
+
+static void
+_runPipeline ( const benchFrameSize* size, const char* variant, int format,
+		int mode )
+{
+	oaDummyConfig		config;
+	oaCameraDevice**	devs;
+	oaCameraDevice*		dev = 0;
+	oaCamera*				camera;
+	oaFrameStats		stats;
+	oaSERHeader			header;
+	pipelineState		state;
+	benchResult			result;
+	char						path[ PATH_MAX ];
+	double					runTime;
+	uint64_t				start;
+	int							numCameras, i;
+
+	if ( benchVerbose ) {
+		fprintf ( stderr, "pipeline %s %s\n", variant, size->name );
+	}
+
+	memset ( &state, 0, sizeof ( state ));
+	state.x = size->x;
+	state.y = size->y;
+	if (!( state.unpacked = benchAlloc (( size_t ) size->x * size->y * 2 ))) {
+		return;
+	}
+	if ( oaHistogramInit ( &state.histogram, size->x, size->y,
+			( OA_PIX_FMT_GREY12P == format ) ? OA_PIX_FMT_GREY12_16LE : format,
+			0 ) != OA_ERR_NONE ) {
+		free ( state.unpacked );
+		return;
+	}
+
+	oaDummyDefaultConfig ( &config );
+	config.scene = OA_DUMMY_SCENE_STARS;
+	config.format = format;
+	config.xSize = size->x;
+	config.ySize = size->y;
+	config.mode = mode;
+	config.frameRate = 0;
+	if ( oaDummySetConfig ( &config ) != OA_ERR_NONE ) {
+		oaHistogramFree ( &state.histogram );
+		free ( state.unpacked );
+		return;
+	}
+
+	if (( numCameras = oaGetCameras ( &devs, OA_CAM_FEATURE_STREAMING )) <= 0 ) {
+		fprintf ( stderr, "no cameras found for the pipeline benchmark\n" );
+		oaHistogramFree ( &state.histogram );
+		free ( state.unpacked );
+		return;
+	}
+	for ( i = 0; i < numCameras && !dev; i++ ) {
+		if ( devs[i]->interface == OA_CAM_IF_DUMMY &&
+				!strcmp ( devs[i]->deviceName, "Synthetic cam" )) {
+			dev = devs[i];
+		}
+	}
+	if ( !dev || !( camera = dev->initCamera ( dev ))) {
+		fprintf ( stderr, "can't start the synthetic camera\n" );
+		oaReleaseCameras ( devs );
+		oaHistogramFree ( &state.histogram );
+		free ( state.unpacked );
+		return;
+	}
+
+	( void ) snprintf ( path, PATH_MAX, "%s/oabench-%d-pipeline.ser",
+			benchTmpDir, ( int ) getpid());
+	if ( !oaSEROpen ( path, &state.ser )) {
+		memset ( &header, 0, sizeof ( header ));
+		header.ColorID = OA_SER_MONO;
+		header.LittleEndian = 1;
+		header.ImageWidth = size->x;
+		header.ImageHeight = size->y;
+		header.PixelDepth = 16;
+		state.serOK = !oaSERWriteHeader ( &state.ser, &header );
+	}
+
+	benchResetPeakRSS();
+	runTime = ( benchMinTime > MIN_PIPELINE_TIME ) ? benchMinTime :
+			MIN_PIPELINE_TIME;
+	start = benchTime();
+	camera->funcs.startStreaming ( camera, _handleFrame, &state );
+	usleep ( runTime * 1000000 );
+	camera->funcs.stopStreaming ( camera );
+	runTime = ( benchTime() - start ) / 1e9;
+	( void ) oaGetFrameStats ( camera, &stats );
+
+	memset ( &result, 0, sizeof ( result ));
+	result.kernel = "pipeline";
+	( void ) snprintf ( result.variant, sizeof ( result.variant ), "%s",
+			variant );
+	result.size = size;
+	result.iterations = state.frames;
+	result.totalTime = runTime;
+	result.fps = state.frames / runTime;
+	result.mpps = result.fps * size->x * size->y / 1e6;
+	result.p50 = stats.p50[ OA_FRAME_INTERVAL_TOTAL ];
+	result.p99 = stats.p99[ OA_FRAME_INTERVAL_TOTAL ];
+	result.max = stats.max[ OA_FRAME_INTERVAL_TOTAL ];
+	result.droppedFrames = stats.droppedFrames;
+	result.peakRSS = benchPeakRSS();
+	benchReport ( &result );
+
+	if ( state.errors ) {
+		fprintf ( stderr, "pipeline: %llu frames failed to process\n",
+				( unsigned long long ) state.errors );
+	}
+
+	camera->funcs.closeCamera ( camera );
+	oaReleaseCameras ( devs );
+	if ( state.serOK ) {
+		oaSERWriteTrailer ( &state.ser );
+	}
+	oaSERClose ( &state.ser );
+	( void ) unlink ( path );
+	oaHistogramFree ( &state.histogram );
+	free ( state.unpacked );
+	( void ) oaDummySetConfig ( 0 );
+}
+
+
+static void*
+_handleFrame ( void* args, void* imageData, int length, void* metadata )
+{
+	pipelineState*	state = args;
+	FRAME_METADATA*	frameMetadata = metadata;
+	void*						frame = imageData;
+	unsigned int		numPixels = state->x * state->y;
+
+	// The 12-bit packed frame is three bytes for every two pixels
+	if (( unsigned int ) length < numPixels * 2 ) {
+		if ( oaconvert ( imageData, state->unpacked, state->x, state->y,
+				OA_PIX_FMT_GREY12P, OA_PIX_FMT_GREY12_16LE )) {
+			state->errors++;
+			return 0;
+		}
+		frame = state->unpacked;
+	}
+
+	if ( oaHistogramProcess ( &state->histogram, frame )) {
+		state->errors++;
+	}
+
+	if ( state->serOK && oaSERWriteFrame ( &state->ser, frame,
+			( frameMetadata && frameMetadata->timestampValid ) ?
+			frameMetadata->timestamp.utc : 0 )) {
+		state->errors++;
+	}
+	state->frames++;
+	return 0;
+}
@@ -0,0 +1,258 @@
+/*****************************************************************************
+ *
+ * benchWriters.c -- benchmarks for the output file formats
+ *
+ * Copyright 2026
+ *   James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <oa_common.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+
+#include <png.h>
+#ifdef HAVE_FITSIO_H
+#include "fitsio.h"
+#else
+#ifdef HAVE_CFITSIO_FITSIO_H
+#include "cfitsio/fitsio.h"
+#endif
+#endif
+
+#include <openastro/SER.h>
+
+#include "bench.h"
+
+typedef struct {
+	void*					frame;
+	unsigned int	x;
+	unsigned int	y;
+	unsigned int	bytesPerPixel;
+	char					path[ PATH_MAX ];
+	oaSERContext	ser;
+	png_bytep*		rows;
+} writerArgs;
+
+static int	_writeSER ( void* );
+static int	_writeFITS ( void* );
+static int	_writePNG ( void* );
+static int	_setup ( writerArgs*, const benchFrameSize*, unsigned int,
+								const char* );
+
+
+/**
+ * SER output goes to a single file that grows with each frame, which is
+ * how it's used for capture.  Frames are written with a fixed timestamp
+ * so that getting the current time isn't part of the cost.
+ */
+
+void
+benchWriteSER ( const benchFrameSize* size )
+{
+	writerArgs		args;
+	oaSERHeader		header;
+	unsigned int	bpp;
+	char					variant[ 16 ];
+
+	for ( bpp = 1; bpp <= 2; bpp++ ) {
+		if ( _setup ( &args, size, bpp, "ser" )) {
+			return;
+		}
+		if ( oaSEROpen ( args.path, &args.ser )) {
+			fprintf ( stderr, "can't create %s\n", args.path );
+			free ( args.frame );
+			return;
+		}
+		memset ( &header, 0, sizeof ( header ));
+		header.ColorID = OA_SER_MONO;
+		header.LittleEndian = 1;
+		header.ImageWidth = size->x;
+		header.ImageHeight = size->y;
+		header.PixelDepth = bpp * 8;
+		if ( !oaSERWriteHeader ( &args.ser, &header )) {
+			( void ) snprintf ( variant, sizeof ( variant ), "GREY%u", bpp * 8 );
+			benchRun ( "ser", variant, size, _writeSER, &args );
+			oaSERWriteTrailer ( &args.ser );
+		}
+		oaSERClose ( &args.ser );
+		( void ) unlink ( args.path );
+		free ( args.frame );
+	}
+}
+
+
+/**
+ * FITS and PNG write a file per frame, so the cost of creating and
+ * closing the file is included
+ */
+
+void
+benchWriteFITS ( const benchFrameSize* size )
+{
+	writerArgs		args;
+	unsigned int	bpp;
+	char					variant[ 16 ];
+
+	for ( bpp = 1; bpp <= 2; bpp++ ) {
+		if ( _setup ( &args, size, bpp, "fits" )) {
+			return;
+		}
+		( void ) snprintf ( variant, sizeof ( variant ), "GREY%u", bpp * 8 );
+		benchRun ( "fits", variant, size, _writeFITS, &args );
+		( void ) unlink ( args.path );
+		free ( args.frame );
+	}
+}
+
+
+void
+benchWritePNG ( const benchFrameSize* size )
+{
+	writerArgs		args;
+	unsigned int	bpp, i;
+	char					variant[ 16 ];
+
+	for ( bpp = 1; bpp <= 2; bpp++ ) {
+		if ( _setup ( &args, size, bpp, "png" )) {
+			return;
+		}
+		if (!( args.rows = calloc ( size->y, sizeof ( png_bytep )))) {
+			free ( args.frame );
+			return;
+		}
+		for ( i = 0; i < size->y; i++ ) {
+			args.rows[i] = ( png_bytep ) args.frame + i * size->x * bpp;
+		}
+		( void ) snprintf ( variant, sizeof ( variant ), "GREY%u", bpp * 8 );
+		benchRun ( "png", variant, size, _writePNG, &args );
+		( void ) unlink ( args.path );
+		free ( args.rows );
+		free ( args.frame );
+	}
+}
+
+
+static int
+_setup ( writerArgs* args, const benchFrameSize* size, unsigned int bpp,
+		const char* ext )
+{
+	size_t		length = ( size_t ) size->x * size->y * bpp;
+
+	memset ( args, 0, sizeof ( writerArgs ));
+	if (!( args->frame = benchAlloc ( length ))) {
+		return -1;
+	}
+	benchFill ( args->frame, length, 7 );
+	args->x = size->x;
+	args->y = size->y;
+	args->bytesPerPixel = bpp;
+	( void ) snprintf ( args->path, PATH_MAX, "%s/oabench-%d.%s", benchTmpDir,
+			( int ) getpid(), ext );
+	return 0;
+}
+
+
+static int
+_writeSER ( void* param )
+{
+	writerArgs*		args = param;
+
+	return oaSERWriteFrame ( &args->ser, args->frame,
+			BENCH_FRAME_TIME );
+}
+
+
+static int
+_writeFITS ( void* param )
+{
+	writerArgs*		args = param;
+	fitsfile*			fptr;
+	char					path[ PATH_MAX + 1 ];
+	long					axes[2];
+	int						status = 0;
+
+	// The leading '!' tells cfitsio to overwrite an existing file
+	( void ) snprintf ( path, sizeof ( path ), "!%s", args->path );
+	axes[0] = args->x;
+	axes[1] = args->y;
+	if ( fits_create_file ( &fptr, path, &status )) {
+		return -1;
+	}
+	if ( fits_create_img ( fptr, args->bytesPerPixel == 2 ? USHORT_IMG :
+			BYTE_IMG, 2, axes, &status )) {
+		fits_close_file ( fptr, &status );
+		return -1;
+	}
+	fits_write_key_str ( fptr, "ROWORDER", "BOTTOM-UP", "", &status );
+	if ( fits_write_img ( fptr, args->bytesPerPixel == 2 ? TUSHORT : TBYTE, 1,
+			( long ) args->x * args->y, args->frame, &status )) {
+		fits_close_file ( fptr, &status );
+		return -1;
+	}
+	return fits_close_file ( fptr, &status ) ? -1 : 0;
+}
+
+
+static int
+_writePNG ( void* param )
+{
+	writerArgs*		args = param;
+	FILE*					handle;
+	png_structp		pngPtr;
+	png_infop			infoPtr;
+
+	if (!( handle = fopen ( args->path, "wb" ))) {
+		return -1;
+	}
+	if (!( pngPtr = png_create_write_struct ( PNG_LIBPNG_VER_STRING, 0, 0,
+			0 ))) {
+		fclose ( handle );
+		return -1;
+	}
+	if (!( infoPtr = png_create_info_struct ( pngPtr ))) {
+		png_destroy_write_struct ( &pngPtr, 0 );
+		fclose ( handle );
+		return -1;
+	}
+	if ( setjmp ( png_jmpbuf ( pngPtr ))) {
+		png_destroy_write_struct ( &pngPtr, &infoPtr );
+		fclose ( handle );
+		return -1;
+	}
+
+	// Same settings as the PNG output handler
+	png_init_io ( pngPtr, handle );
+	png_set_IHDR ( pngPtr, infoPtr, args->x, args->y, args->bytesPerPixel * 8,
+			PNG_COLOR_TYPE_GRAY, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT,
+			PNG_FILTER_TYPE_DEFAULT );
+	png_set_compression_level ( pngPtr, 0 );
+	png_set_rows ( pngPtr, infoPtr, args->rows );
+	png_write_png ( pngPtr, infoPtr, args->bytesPerPixel == 2 ?
+			PNG_TRANSFORM_SWAP_ENDIAN : PNG_TRANSFORM_IDENTITY, 0 );
+	png_destroy_write_struct ( &pngPtr, &infoPtr );
+	fclose ( handle );
+	return 0;
+}
@@ -0,0 +1,462 @@
+/*****************************************************************************
+ *
+ * oabench.c -- benchmark the image pipeline and report the results as JSON
+ *
+ * Copyright 2026
+ *   James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <oa_common.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/utsname.h>
+
+#include <openastro/util.h>
+
+#include "bench.h"
+
+
+const benchFrameSize	benchFrameSizes[] = {
+	{ "720p", 1280, 720 },
+	{ "1080p", 1920, 1080 },
+	{ "4k", 3840, 2160 },
+	{ "20mp", 5472, 3648 },
+	{ 0, 0, 0 }
+};
+
+typedef struct {
+	const char*		name;
+	void					( *func )( const benchFrameSize* );
+} benchKernel;
+
+static const benchKernel	kernels[] = {
+	{ "convert", benchConvert },
+	{ "demosaic", benchDemosaic },
+	{ "stack", benchStack },
+	{ "focus", benchFocus },
+	{ "flip", benchFlip },
+	{ "crop", benchCrop },
+	{ "histogram", benchHistogram },
+	{ "master", benchMaster },
+	{ "register", benchRegister },
+	{ "stars", benchStars },
+	{ "ser", benchWriteSER },
+	{ "fits", benchWriteFITS },
+	{ "png", benchWritePNG },
+	{ "pipeline", benchPipeline },
+	{ 0, 0 }
+};
+
+double				benchMinTime = 0.5;
+unsigned int	benchMinIterations = 3;
+unsigned int	benchMaxIterations = 10000;
+const char*		benchTmpDir = "/tmp";
+int						benchVerbose = 0;
+
+static const char*	sizeList = 0;
+static const char*	kernelList = 0;
+static const char*	label = 0;
+static FILE*				output;
+static int					numResults = 0;
+
+static void		_usage ( const char* );
+static int		_inList ( const char*, const char* );
+static int		_compareTimes ( const void*, const void* );
+static void		_printHeader ( void );
+static void		_printFooter ( void );
+static long		_processPeakRSS ( void );
+
+
+int
+main ( int argc, char* argv[] )
+{
+	const benchKernel*		k;
+	const benchFrameSize*	s;
+	const char*						outputFile = 0;
+	int										c;
+
+	while (( c = getopt ( argc, argv, "d:hk:l:n:o:s:t:v" )) != -1 ) {
+		switch ( c ) {
+			case 'd':
+				benchTmpDir = optarg;
+				break;
+			case 'k':
+				kernelList = optarg;
+				break;
+			case 'l':
+				label = optarg;
+				break;
+			case 'n':
+				benchMinIterations = atoi ( optarg );
+				if ( benchMinIterations < 1 ) {
+					benchMinIterations = 1;
+				}
+				break;
+			case 'o':
+				outputFile = optarg;
+				break;
+			case 's':
+				sizeList = optarg;
+				break;
+			case 't':
+				benchMinTime = atof ( optarg );
+				break;
+			case 'v':
+				benchVerbose = 1;
+				break;
+			case 'h':
+			default:
+				_usage ( argv[0] );
+				return ( c == 'h' ) ? 0 : 1;
+		}
+	}
+
+	if ( outputFile ) {
+		if (!( output = fopen ( outputFile, "w" ))) {
+			perror ( outputFile );
+			return 1;
+		}
+	} else {
+		output = stdout;
+	}
+
+	_printHeader();
+	for ( k = kernels; k->name; k++ ) {
+		if ( !benchKernelSelected ( k->name )) {
+			continue;
+		}
+		for ( s = benchFrameSizes; s->name; s++ ) {
+			if ( benchSizeSelected ( s )) {
+				k->func ( s );
+			}
+		}
+	}
+	_printFooter();
+
+	if ( output != stdout ) {
+		fclose ( output );
+	}
+	return 0;
+}
+
+
+static void
+_usage ( const char* progName )
+{
+	const benchKernel*		k;
+	const benchFrameSize*	s;
+
+	fprintf ( stderr, "usage: %s [-v] [-k kernels] [-s sizes] [-t seconds] "
+			"[-n iterations]\n\t[-d tmpdir] [-l label] [-o file]\n\n", progName );
+	fprintf ( stderr, "  -k  comma-separated list of kernels to run:\n     " );
+	for ( k = kernels; k->name; k++ ) {
+		fprintf ( stderr, " %s", k->name );
+	}
+	fprintf ( stderr, "\n  -s  comma-separated list of frame sizes:\n     " );
+	for ( s = benchFrameSizes; s->name; s++ ) {
+		fprintf ( stderr, " %s (%ux%u)", s->name, s->x, s->y );
+	}
+	fprintf ( stderr, "\n  -t  minimum time to run each benchmark for "
+			"(default %.1fs)\n", benchMinTime );
+	fprintf ( stderr, "  -n  minimum number of iterations (default %u)\n",
+			benchMinIterations );
+	fprintf ( stderr, "  -d  directory for files written by the writer "
+			"benchmarks (default %s)\n", benchTmpDir );
+	fprintf ( stderr, "  -l  label to include in the output, eg. a commit id\n" );
+	fprintf ( stderr, "  -o  write the results to a file rather than stdout\n" );
+	fprintf ( stderr, "  -v  show progress on stderr\n" );
+}
+
+
+static int
+_inList ( const char* list, const char* name )
+{
+	size_t			len = strlen ( name );
+	const char*	p = list;
+
+	while ( p && *p ) {
+		if ( !strncasecmp ( p, name, len ) && ( p[len] == ',' || !p[len] )) {
+			return 1;
+		}
+		if (( p = strchr ( p, ',' ))) {
+			p++;
+		}
+	}
+	return 0;
+}
+
+
+int
+benchSizeSelected ( const benchFrameSize* size )
+{
+	return sizeList ? _inList ( sizeList, size->name ) : 1;
+}
+
+
+int
+benchKernelSelected ( const char* name )
+{
+	return kernelList ? _inList ( kernelList, name ) : 1;
+}
+
+
+uint64_t
+benchTime ( void )
+{
+	struct timespec	ts;
+
+	clock_gettime ( CLOCK_MONOTONIC, &ts );
+	return ( uint64_t ) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+
+void*
+benchAlloc ( size_t length )
+{
+	void*		p;
+
+	if (!( p = malloc ( length ))) {
+		fprintf ( stderr, "malloc of %lu bytes failed\n",
+				( unsigned long ) length );
+	}
+	return p;
+}
+
+
+/**
+ * Fill a buffer with repeatable pseudo-random data.  Random data stops
+ * anything from being unrealistically cheap because it compresses well
+ * or is all one value.
+ */
+
+void
+benchFill ( void* buffer, size_t length, uint32_t seed )
+{
+	uint8_t*	p = buffer;
+	uint32_t	x = seed ? seed : 1;
+	size_t		i;
+
+	for ( i = 0; i < length; i++ ) {
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		*p++ = x >> 24;
+	}
+}
+
+
+/**
+ * Try to reset the high water mark of the resident set size so the value
+ * reported for each benchmark is its own.  This only works on Linux.
+ * Elsewhere the figure is the peak for the whole run so far.
+ */
+
+void
+benchResetPeakRSS ( void )
+{
+	FILE*		fp;
+
+	if (( fp = fopen ( "/proc/self/clear_refs", "w" ))) {
+		fputs ( "5", fp );
+		fclose ( fp );
+	}
+}
+
+
+long
+benchPeakRSS ( void )
+{
+	FILE*						fp;
+	char						line[ 128 ];
+	long						kb = -1;
+
+	if (( fp = fopen ( "/proc/self/status", "r" ))) {
+		while ( fgets ( line, sizeof ( line ), fp )) {
+			if ( !strncmp ( line, "VmHWM:", 6 )) {
+				kb = atol ( line + 6 );
+				break;
+			}
+		}
+		fclose ( fp );
+	}
+	if ( kb < 0 ) {
+		kb = _processPeakRSS();
+	}
+	return kb;
+}
+
+
+static long
+_processPeakRSS ( void )
+{
+	struct rusage		usage;
+
+	if ( getrusage ( RUSAGE_SELF, &usage )) {
+		return -1;
+	}
+#ifdef __APPLE__
+	return usage.ru_maxrss / 1024;
+#else
+	return usage.ru_maxrss;
+#endif
+}
+
+
+/**
+ * Run a function repeatedly, timing each call, until both the minimum
+ * time and minimum number of iterations have been reached.  The first
+ * call is a warm-up and isn't counted.  Returns the function's error
+ * code if the warm-up fails, in which case nothing is reported.
+ */
+
+int
+benchRun ( const char* kernel, const char* variant,
+		const benchFrameSize* size, benchFunc func, void* arg )
+{
+	benchResult		result;
+	uint64_t*			times;
+	uint64_t			start, end, runStart;
+	unsigned int	n;
+	int						ret;
+
+	if ( benchVerbose ) {
+		fprintf ( stderr, "%s %s %s\n", kernel, variant, size->name );
+	}
+
+	if (!( times = malloc ( benchMaxIterations * sizeof ( uint64_t )))) {
+		return -1;
+	}
+
+	benchResetPeakRSS();
+	if (( ret = func ( arg )) != 0 ) {
+		if ( benchVerbose ) {
+			fprintf ( stderr, "  skipped, error %d\n", ret );
+		}
+		free (( void* ) times );
+		return ret;
+	}
+
+	n = 0;
+	runStart = benchTime();
+	do {
+		start = benchTime();
+		( void ) func ( arg );
+		end = benchTime();
+		times[ n++ ] = end - start;
+	} while ( n < benchMaxIterations && ( n < benchMinIterations ||
+			( end - runStart ) / 1e9 < benchMinTime ));
+
+	memset ( &result, 0, sizeof ( result ));
+	result.kernel = kernel;
+	( void ) snprintf ( result.variant, sizeof ( result.variant ), "%s",
+			variant );
+	result.size = size;
+	result.iterations = n;
+	result.totalTime = ( end - runStart ) / 1e9;
+	result.peakRSS = benchPeakRSS();
+
+	// The throughput is based on the time spent in the function rather
+	// than the wall clock so timer overhead doesn't count against it
+
+	start = 0;
+	for ( n = 0; n < result.iterations; n++ ) {
+		start += times[n];
+	}
+	result.fps = result.iterations / ( start / 1e9 );
+	result.mpps = result.fps * size->x * size->y / 1e6;
+	qsort ( times, result.iterations, sizeof ( uint64_t ), _compareTimes );
+	result.p50 = times[ result.iterations / 2 ];
+	result.p99 = times[( result.iterations * 99 ) / 100 ];
+	result.max = times[ result.iterations - 1 ];
+
+	free (( void* ) times );
+	benchReport ( &result );
+	return 0;
+}
+
+
+void
+benchReport ( benchResult* result )
+{
+	fprintf ( output, "%s\n    { \"kernel\": \"%s\", \"variant\": \"%s\", "
+			"\"size\": \"%s\", \"width\": %u, \"height\": %u,\n"
+			"      \"iterations\": %u, \"seconds\": %.3f, \"fps\": %.2f, "
+			"\"mpix_per_sec\": %.2f,\n"
+			"      \"p50_ms\": %.4f, \"p99_ms\": %.4f, \"max_ms\": %.4f, "
+			"\"dropped\": %llu, \"peak_rss_kb\": %ld }",
+			numResults ? "," : "", result->kernel, result->variant,
+			result->size->name, result->size->x, result->size->y,
+			result->iterations, result->totalTime, result->fps, result->mpps,
+			result->p50 / 1e6, result->p99 / 1e6, result->max / 1e6,
+			( unsigned long long ) result->droppedFrames, result->peakRSS );
+	fflush ( output );
+	numResults++;
+}
+
+
+static int
+_compareTimes ( const void* a, const void* b )
+{
+	uint64_t	ta = *( const uint64_t* ) a;
+	uint64_t	tb = *( const uint64_t* ) b;
+
+	return ( ta < tb ) ? -1 : ( ta > tb ) ? 1 : 0;
+}
+
+
+static void
+_printHeader ( void )
+{
+	struct utsname	host;
+	time_t					now;
+	char						date[ 32 ];
+
+	now = time ( 0 );
+	strftime ( date, sizeof ( date ), "%Y-%m-%dT%H:%M:%SZ", gmtime ( &now ));
+	if ( uname ( &host )) {
+		memset ( &host, 0, sizeof ( host ));
+	}
+
+	fprintf ( output, "{\n  \"version\": \"%s\",\n", PACKAGE_VERSION );
+	if ( label ) {
+		fprintf ( output, "  \"label\": \"%s\",\n", label );
+	}
+	fprintf ( output, "  \"date\": \"%s\",\n  \"host\": \"%s\",\n"
+			"  \"system\": \"%s %s %s\",\n  \"cpus\": %ld,\n"
+			"  \"min_seconds\": %.2f,\n  \"min_iterations\": %u,\n"
+			"  \"results\": [", date, host.nodename, host.sysname, host.release,
+			host.machine, sysconf ( _SC_NPROCESSORS_ONLN ), benchMinTime,
+			benchMinIterations );
+}
+
+
+static void
+_printFooter ( void )
+{
+	fprintf ( output, "\n  ],\n  \"peak_rss_kb\": %ld\n}\n", _processPeakRSS());
+}
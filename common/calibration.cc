@@ -0,0 +1,423 @@
+/*****************************************************************************
+ *
+ * calibration.cc -- calibrate frames with master bias, dark and flat frames
+ *
+ * Copyright 2026
+ *   James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <oa_common.h>
+
+#include <cstdlib>
+#include <cstring>
+
+extern "C" {
+#ifdef HAVE_LIBCFITSIO
+#ifdef HAVE_FITSIO_H
+#include "fitsio.h"
+#else
+#ifdef HAVE_CFITSIO_FITSIO_H
+#include "cfitsio/fitsio.h"
+#endif
+#endif
+#endif
+
+#include <openastro/errno.h>
+#include <openastro/imgproc.h>
+#include <openastro/video/formats.h>
+}
+
+#include "calibration.h"
+#include "calibrationSettings.h"
+
+// A hot pixel has to stand this many times the noise above its
+// neighbours
+
+#define	HOT_PIXEL_SIGMAS		8.0
+
+// Without a dark, hot pixels are looked for in this many frames and must
+// show up in this fraction of them
+
+#define	HOT_PIXEL_DETECT_FRAMES		16
+#define	HOT_PIXEL_FRACTION		0.75
+
+
+Calibration::Calibration()
+{
+  current = loaded = retired = 0;
+  requestedGeneration = loadGeneration = 0;
+  requestedX = requestedY = requestedFormat = -1;
+  loadX = loadY = loadFormat = 0;
+  stopLoader = loadRequested = 0;
+  pthread_mutex_init ( &loadMutex, 0 );
+  pthread_cond_init ( &loadWanted, 0 );
+  if ( pthread_create ( &loader, 0, loaderThread, this )) {
+    qWarning() << "Can't start calibration loader thread";
+    loaderRunning = 0;
+  } else {
+    loaderRunning = 1;
+  }
+}
+
+
+Calibration::~Calibration()
+{
+  if ( loaderRunning ) {
+    pthread_mutex_lock ( &loadMutex );
+    stopLoader = 1;
+    pthread_cond_signal ( &loadWanted );
+    pthread_mutex_unlock ( &loadMutex );
+    pthread_join ( loader, 0 );
+  }
+  freeMasters ( current );
+  freeMasters ( loaded );
+  freeMasters ( retired );
+  pthread_mutex_destroy ( &loadMutex );
+  pthread_cond_destroy ( &loadWanted );
+}
+
+
+// Copy a frame to the target buffer and calibrate it there.  Returns 1
+// if the target holds a calibrated frame, or 0 if calibration is off or
+// can't be done for this frame, in which case the source should be used
+// as it is.  Frames go through uncalibrated while the loader thread is
+// still reading the masters they need.
+
+int
+Calibration::apply ( void* source, void* target, unsigned int length,
+    int x, int y, int fmt, int64_t exposure )
+{
+  calibrationMasters*	masters;
+  unsigned int		generation;
+
+  if ( !loaderRunning ) {
+    return 0;
+  }
+
+  pthread_mutex_lock ( &calibrationConfMutex );
+  generation = calibrationConf.generation;
+  pthread_mutex_unlock ( &calibrationConfMutex );
+
+  pthread_mutex_lock ( &loadMutex );
+  if ( generation != requestedGeneration || x != requestedX ||
+      y != requestedY || fmt != requestedFormat ) {
+    requestedGeneration = loadGeneration = generation;
+    requestedX = loadX = x;
+    requestedY = loadY = y;
+    requestedFormat = loadFormat = fmt;
+    loadRequested = 1;
+    pthread_cond_signal ( &loadWanted );
+  }
+  // Swap in a newly loaded set, leaving the old one for the loader to
+  // free.  If it hasn't yet freed the one before that, the swap waits
+  // for a later frame
+  if ( loaded && !retired ) {
+    if ( current ) {
+      retired = current;
+      pthread_cond_signal ( &loadWanted );
+    }
+    current = loaded;
+    loaded = 0;
+  }
+  pthread_mutex_unlock ( &loadMutex );
+
+  // A set that failed to load is kept (with nothing valid) so the same
+  // masters aren't tried again for this frame size and format
+  masters = current;
+  if ( !masters || masters->generation != generation ||
+      masters->xSize != x || masters->ySize != y || masters->format != fmt ||
+      ( !masters->engineValid && !masters->hotPixelsValid )) {
+    return 0;
+  }
+
+  memcpy ( target, source, length );
+  if ( masters->engineValid && oaCalibrationApply ( &masters->engine,
+      target, exposure ) != OA_ERR_NONE ) {
+    return 0;
+  }
+  if ( masters->hotPixelsValid ) {
+    // Without a dark the hot pixels are found from the first few frames,
+    // which get corrected once they have been
+    if ( masters->framesToDetect ) {
+      ( void ) oaHotPixelDetectFrame ( &masters->hotPixels, target,
+          HOT_PIXEL_SIGMAS );
+      if ( !--masters->framesToDetect ) {
+        ( void ) oaHotPixelDetectFinish ( &masters->hotPixels,
+            HOT_PIXEL_FRACTION );
+      }
+    }
+    ( void ) oaHotPixelCorrect ( &masters->hotPixels, target );
+  }
+  return 1;
+}
+
+
+void*
+Calibration::loaderThread ( void* param )
+{
+  Calibration*		self = static_cast<Calibration*>( param );
+  calibrationMasters*	masters;
+  calibrationMasters*	old;
+  calibrationConfig	settings;
+  unsigned int		generation;
+  int			x, y, fmt;
+
+  pthread_mutex_lock ( &self->loadMutex );
+  while ( !self->stopLoader ) {
+    if ( self->retired ) {
+      old = self->retired;
+      self->retired = 0;
+      pthread_mutex_unlock ( &self->loadMutex );
+      freeMasters ( old );
+      pthread_mutex_lock ( &self->loadMutex );
+      continue;
+    }
+    if ( !self->loadRequested ) {
+      pthread_cond_wait ( &self->loadWanted, &self->loadMutex );
+      continue;
+    }
+    self->loadRequested = 0;
+    generation = self->loadGeneration;
+    x = self->loadX;
+    y = self->loadY;
+    fmt = self->loadFormat;
+    pthread_mutex_unlock ( &self->loadMutex );
+
+    pthread_mutex_lock ( &calibrationConfMutex );
+    settings = calibrationConf;
+    pthread_mutex_unlock ( &calibrationConfMutex );
+    masters = load ( settings, x, y, fmt, generation );
+
+    pthread_mutex_lock ( &self->loadMutex );
+    // If another request came in meanwhile this set is already out of
+    // date and the next time round will replace it
+    old = self->loaded;
+    self->loaded = masters;
+    if ( old ) {
+      pthread_mutex_unlock ( &self->loadMutex );
+      freeMasters ( old );
+      pthread_mutex_lock ( &self->loadMutex );
+    }
+  }
+  pthread_mutex_unlock ( &self->loadMutex );
+  return 0;
+}
+
+
+calibrationMasters*
+Calibration::load ( const calibrationConfig& settings, int xSize, int ySize,
+    int format, unsigned int generation )
+{
+  calibrationMasters*	masters;
+  uint16_t*		master;
+  int64_t		exposure;
+  int			ret;
+
+  if (!( masters = static_cast<calibrationMasters*>( calloc ( 1,
+      sizeof ( calibrationMasters ))))) {
+    return 0;
+  }
+  masters->generation = generation;
+  masters->xSize = xSize;
+  masters->ySize = ySize;
+  masters->format = format;
+
+  if ( !settings.enabled && !settings.fixHotPixels ) {
+    return masters;
+  }
+  if ( settings.enabled && oaCalibrationInit ( &masters->engine, xSize,
+      ySize, format, 0 ) != OA_ERR_NONE ) {
+    qWarning() << "Can't calibrate frames of format" <<
+        oaFrameFormats[ format ].name;
+    return masters;
+  }
+  if ( settings.fixHotPixels && oaHotPixelInit ( &masters->hotPixels,
+      xSize, ySize, format ) != OA_ERR_NONE ) {
+    qWarning() << "Can't correct hot pixels in frames of format" <<
+        oaFrameFormats[ format ].name;
+    oaCalibrationFree ( &masters->engine );
+    return masters;
+  }
+
+  if (!( master = static_cast<uint16_t*>( malloc ( xSize * ySize *
+      sizeof ( uint16_t ))))) {
+    oaCalibrationFree ( &masters->engine );
+    oaHotPixelFree ( &masters->hotPixels );
+    return masters;
+  }
+
+  // The bias has to be loaded first so it can be taken off the flat
+  ret = OA_ERR_NONE;
+  if ( settings.enabled && !settings.biasFile.isEmpty()) {
+    if (( ret = readMaster ( settings.biasFile, master, xSize, ySize,
+        &exposure )) == OA_ERR_NONE ) {
+      ret = oaCalibrationSetBias ( &masters->engine, master );
+    }
+  }
+  if ( ret == OA_ERR_NONE && !settings.darkFile.isEmpty()) {
+    if (( ret = readMaster ( settings.darkFile, master, xSize, ySize,
+        &exposure )) == OA_ERR_NONE ) {
+      if ( settings.enabled ) {
+        ret = oaCalibrationSetDark ( &masters->engine, master, exposure,
+            settings.scaleDark );
+      }
+      if ( ret == OA_ERR_NONE && settings.fixHotPixels ) {
+        ret = oaHotPixelFromDark ( &masters->hotPixels, master,
+            HOT_PIXEL_SIGMAS );
+      }
+    }
+  }
+  if ( ret == OA_ERR_NONE && settings.enabled &&
+      !settings.flatFile.isEmpty()) {
+    if (( ret = readMaster ( settings.flatFile, master, xSize, ySize,
+        &exposure )) == OA_ERR_NONE ) {
+      ret = oaCalibrationSetFlat ( &masters->engine, master );
+    }
+  }
+  free ( master );
+
+  if ( ret != OA_ERR_NONE ) {
+    oaCalibrationFree ( &masters->engine );
+    oaHotPixelFree ( &masters->hotPixels );
+    return masters;
+  }
+  masters->engineValid = settings.enabled;
+  if (( masters->hotPixelsValid = settings.fixHotPixels )) {
+    if ( settings.darkFile.isEmpty()) {
+      masters->framesToDetect = HOT_PIXEL_DETECT_FRAMES;
+    }
+  }
+  return masters;
+}
+
+
+void
+Calibration::freeMasters ( calibrationMasters* masters )
+{
+  if ( masters ) {
+    oaCalibrationFree ( &masters->engine );
+    oaHotPixelFree ( &masters->hotPixels );
+    free ( masters );
+  }
+}
+
+
+// Read a single-plane FITS master frame as 16-bit values, along with its
+// exposure time in microseconds if it has one
+
+int
+Calibration::readMaster ( const QString& filename, uint16_t* buffer,
+    int xSize, int ySize, int64_t* exposure )
+{
+#ifdef HAVE_LIBCFITSIO
+  fitsfile*	fptr;
+  long		naxes[3], fpixel[2] = { 1, 1 };
+  double	exptime;
+  int		status = 0, bitpix, naxis;
+
+  *exposure = 0;
+  if ( fits_open_image ( &fptr, filename.toStdString().c_str(), READONLY,
+      &status )) {
+    qWarning() << "Can't open calibration master" << filename;
+    return -OA_ERR_NOT_READABLE;
+  }
+  if ( fits_get_img_param ( fptr, 3, &bitpix, &naxis, naxes, &status ) ||
+      naxis != 2 || naxes[0] != xSize || naxes[1] != ySize ) {
+    qWarning() << "Calibration master" << filename <<
+        "is not the same size as the frames";
+    status = 0;
+    fits_close_file ( fptr, &status );
+    return -OA_ERR_INVALID_SIZE;
+  }
+  if ( fits_read_pix ( fptr, TUSHORT, fpixel, xSize * ySize, 0, buffer, 0,
+      &status )) {
+    qWarning() << "Can't read calibration master" << filename;
+    status = 0;
+    fits_close_file ( fptr, &status );
+    return -OA_ERR_NOT_READABLE;
+  }
+  if ( !fits_read_key ( fptr, TDOUBLE, "EXPTIME", &exptime, 0, &status )) {
+    *exposure = exptime * 1000000;
+  }
+  status = 0;
+  fits_close_file ( fptr, &status );
+  return OA_ERR_NONE;
+#else
+  Q_UNUSED( buffer );
+  Q_UNUSED( xSize );
+  Q_UNUSED( ySize );
+  *exposure = 0;
+  qWarning() << "No FITS support to read calibration master" << filename;
+  return -OA_ERR_UNIMPLEMENTED;
+#endif
+}
+
+
+// Write a master frame as a single-plane 16-bit FITS file that
+// readMaster() can load again, with the exposure time and the number of
+// frames combined in the header
+
+int
+Calibration::writeMaster ( const QString& filename, const uint16_t* master,
+    int xSize, int ySize, int64_t exposure, unsigned int numFrames )
+{
+#ifdef HAVE_LIBCFITSIO
+  fitsfile*	fptr;
+  long		naxes[2] = { xSize, ySize }, fpixel[2] = { 1, 1 };
+  double	exptime;
+  int		status = 0;
+
+  // The leading "!" has cfitsio replace any existing file
+  if ( fits_create_file ( &fptr, ( "!" + filename ).toStdString().c_str(),
+      &status )) {
+    qWarning() << "Can't create calibration master" << filename;
+    return -OA_ERR_NOT_WRITEABLE;
+  }
+  if ( !fits_create_img ( fptr, USHORT_IMG, 2, naxes, &status ) &&
+      !fits_write_pix ( fptr, TUSHORT, fpixel, xSize * ySize,
+      const_cast<uint16_t*>( master ), &status )) {
+    if ( exposure > 0 ) {
+      exptime = exposure / 1000000.0;
+      ( void ) fits_write_key ( fptr, TDOUBLE, "EXPTIME", &exptime,
+          "Exposure time (s)", &status );
+    }
+    ( void ) fits_write_key ( fptr, TUINT, "NCOMBINE", &numFrames,
+        "Number of frames combined", &status );
+  }
+  if ( status ) {
+    qWarning() << "Can't write calibration master" << filename;
+    status = 0;
+    fits_close_file ( fptr, &status );
+    return -OA_ERR_NOT_WRITEABLE;
+  }
+  fits_close_file ( fptr, &status );
+  return status ? -OA_ERR_NOT_WRITEABLE : OA_ERR_NONE;
+#else
+  Q_UNUSED( master );
+  Q_UNUSED( xSize );
+  Q_UNUSED( ySize );
+  Q_UNUSED( exposure );
+  Q_UNUSED( numFrames );
+  qWarning() << "No FITS support to write calibration master" << filename;
+  return -OA_ERR_UNIMPLEMENTED;
+#endif
+}
@@ -0,0 +1,101 @@
+/*****************************************************************************
+ *
+ * calibration.h -- class declaration
+ *
+ * Copyright 2026
+ *   James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#pragma once
+
+#include <oa_common.h>
+
+#include <pthread.h>
+
+#include <QtCore>
+
+extern "C" {
+#include <openastro/imgproc.h>
+}
+
+#include "calibrationSettings.h"
+
+
+// One loaded set of masters, for a given frame size and format and
+// generation of the calibration settings
+
+typedef struct {
+  oaCalibration		engine;
+  int			engineValid;
+  oaHotPixelMap		hotPixels;
+  int			hotPixelsValid;
+  unsigned int		framesToDetect;
+  unsigned int		generation;
+  int			xSize;
+  int			ySize;
+  int			format;
+} calibrationMasters;
+
+// Wraps the liboaimgproc calibration engine and hot pixel map.  The
+// master frames named in the calibration settings are loaded by a thread
+// of its own whenever they or the frame size or format change, so that
+// reading them never holds up the frame callback
+
+class Calibration
+{
+  public:
+    			Calibration();
+    			~Calibration();
+    int			apply ( void*, void*, unsigned int, int, int, int, int64_t );
+
+    static int		writeMaster ( const QString&, const uint16_t*, int, int,
+			    int64_t, unsigned int );
+
+  private:
+    // Only ever touched by the thread calling apply()
+    calibrationMasters*	current;
+    unsigned int	requestedGeneration;
+    int			requestedX;
+    int			requestedY;
+    int			requestedFormat;
+
+    // Shared with the loader thread, protected by loadMutex
+    pthread_t		loader;
+    int			loaderRunning;
+    pthread_mutex_t	loadMutex;
+    pthread_cond_t	loadWanted;
+    int			stopLoader;
+    int			loadRequested;
+    unsigned int	loadGeneration;
+    int			loadX;
+    int			loadY;
+    int			loadFormat;
+    calibrationMasters*	loaded;
+    calibrationMasters*	retired;
+
+    static void*	loaderThread ( void* );
+    static calibrationMasters*	load ( const calibrationConfig&, int, int,
+			    int, unsigned int );
+    static void		freeMasters ( calibrationMasters* );
+    static int		readMaster ( const QString&, uint16_t*, int, int,
+			    int64_t* );
+};
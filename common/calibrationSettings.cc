@@ -0,0 +1,343 @@
+/*****************************************************************************
+ *
+ * calibrationSettings.cc -- class for the calibration settings in the settings UI
+ *
+ * Copyright 2026
+ *   James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+
+#include <oa_common.h>
+
+#include <cstdlib>
+
+extern "C" {
+#include <openastro/SER.h>
+#include <openastro/errno.h>
+#include <openastro/imgproc.h>
+#include <openastro/video/formats.h>
+}
+
+#include "calibration.h"
+#include "calibrationSettings.h"
+
+static int	serFrameFormat ( oaSERHeader* );
+
+// This is global.  All applications using this code share it.
+
+calibrationConfig calibrationConf;
+pthread_mutex_t	calibrationConfMutex = PTHREAD_MUTEX_INITIALIZER;
+
+CalibrationSettings::CalibrationSettings ( QWidget* parent,
+		int captureOpts, trampolineFuncs* redirs ) :
+		QWidget ( parent ), trampolines ( redirs )
+{
+  enableBox = new QCheckBox ( tr ( "Calibrate frames before processing" ),
+      this );
+  enableBox->setChecked ( calibrationConf.enabled );
+  scaleDarkBox = new QCheckBox (
+      tr ( "Scale dark for exposure time (needs a bias frame)" ), this );
+  scaleDarkBox->setChecked ( calibrationConf.scaleDark );
+  hotPixelBox = new QCheckBox ( tr ( "Correct hot pixels (from the dark, "
+      "or found in the first frames)" ), this );
+  hotPixelBox->setChecked ( calibrationConf.fixHotPixels );
+
+  biasLabel = new QLabel ( tr ( "Master bias" ));
+  biasFile = new QLineEdit ( this );
+  biasFile->setText ( calibrationConf.biasFile );
+  biasButton = new QPushButton ( tr ( "Select..." ), this );
+  darkLabel = new QLabel ( tr ( "Master dark" ));
+  darkFile = new QLineEdit ( this );
+  darkFile->setText ( calibrationConf.darkFile );
+  darkButton = new QPushButton ( tr ( "Select..." ), this );
+  flatLabel = new QLabel ( tr ( "Master flat" ));
+  flatFile = new QLineEdit ( this );
+  flatFile->setText ( calibrationConf.flatFile );
+  flatButton = new QPushButton ( tr ( "Select..." ), this );
+
+  grid = new QGridLayout();
+  grid->addWidget ( biasLabel, 0, 0 );
+  grid->addWidget ( biasFile, 0, 1 );
+  grid->addWidget ( biasButton, 0, 2 );
+  grid->addWidget ( darkLabel, 1, 0 );
+  grid->addWidget ( darkFile, 1, 1 );
+  grid->addWidget ( darkButton, 1, 2 );
+  grid->addWidget ( flatLabel, 2, 0 );
+  grid->addWidget ( flatFile, 2, 1 );
+  grid->addWidget ( flatButton, 2, 2 );
+
+  masterBox = new QGroupBox ( tr ( "Building master frames" ), this );
+  methodLabel = new QLabel ( tr ( "Combine frames using" ));
+  methodMenu = new QComboBox ( this );
+  methodMenu->addItem ( tr ( "Mean" ), QVariant ( OA_MASTER_MEAN ));
+  methodMenu->addItem ( tr ( "Mean without min/max" ),
+      QVariant ( OA_MASTER_MINMAX ));
+  methodMenu->addItem ( tr ( "Median (uses disk space)" ),
+      QVariant ( OA_MASTER_MEDIAN ));
+  methodMenu->setCurrentIndex ( methodMenu->findData (
+      calibrationConf.masterMethod ));
+  buildButton = new QPushButton ( tr ( "Build from SER file..." ), this );
+
+  masterGrid = new QGridLayout();
+  masterGrid->addWidget ( methodLabel, 0, 0 );
+  masterGrid->addWidget ( methodMenu, 0, 1 );
+  masterGrid->addWidget ( buildButton, 0, 2 );
+  buildMasterBox = nullptr;
+  if ( captureOpts ) {
+    buildMasterBox = new QCheckBox (
+        tr ( "Also build a master from each capture" ), this );
+    buildMasterBox->setChecked ( calibrationConf.buildMaster );
+    masterGrid->addWidget ( buildMasterBox, 1, 0, 1, 3 );
+  }
+  masterBox->setLayout ( masterGrid );
+
+  box = new QVBoxLayout ( this );
+  box->addWidget ( enableBox );
+  box->addLayout ( grid );
+  box->addWidget ( scaleDarkBox );
+  box->addWidget ( hotPixelBox );
+  box->addWidget ( masterBox );
+  box->addStretch ( 1 );
+  setLayout ( box );
+
+  connect ( enableBox, SIGNAL ( stateChanged ( int )), parent,
+      SLOT ( dataChanged()));
+  connect ( scaleDarkBox, SIGNAL ( stateChanged ( int )), parent,
+      SLOT ( dataChanged()));
+  connect ( hotPixelBox, SIGNAL ( stateChanged ( int )), parent,
+      SLOT ( dataChanged()));
+  connect ( biasFile, SIGNAL ( textEdited ( const QString& )), parent,
+      SLOT ( dataChanged()));
+  connect ( darkFile, SIGNAL ( textEdited ( const QString& )), parent,
+      SLOT ( dataChanged()));
+  connect ( flatFile, SIGNAL ( textEdited ( const QString& )), parent,
+      SLOT ( dataChanged()));
+  connect ( methodMenu, SIGNAL ( currentIndexChanged ( int )), parent,
+      SLOT ( dataChanged()));
+  if ( buildMasterBox ) {
+    connect ( buildMasterBox, SIGNAL ( stateChanged ( int )), parent,
+        SLOT ( dataChanged()));
+  }
+  connect ( buildButton, SIGNAL ( clicked()), this, SLOT ( buildFromSER()));
+  connect ( biasButton, SIGNAL ( clicked()), this, SLOT ( selectBias()));
+  connect ( darkButton, SIGNAL ( clicked()), this, SLOT ( selectDark()));
+  connect ( flatButton, SIGNAL ( clicked()), this, SLOT ( selectFlat()));
+  connect ( biasButton, SIGNAL ( clicked()), parent, SLOT ( dataChanged()));
+  connect ( darkButton, SIGNAL ( clicked()), parent, SLOT ( dataChanged()));
+  connect ( flatButton, SIGNAL ( clicked()), parent, SLOT ( dataChanged()));
+}
+
+
+CalibrationSettings::~CalibrationSettings()
+{
+  trampolines->destroyLayout ( dynamic_cast<QLayout*>( box ));
+}
+
+
+void
+CalibrationSettings::storeSettings ( void )
+{
+  pthread_mutex_lock ( &calibrationConfMutex );
+  calibrationConf.enabled = enableBox->isChecked() ? 1 : 0;
+  calibrationConf.scaleDark = scaleDarkBox->isChecked() ? 1 : 0;
+  calibrationConf.fixHotPixels = hotPixelBox->isChecked() ? 1 : 0;
+  calibrationConf.biasFile = biasFile->text();
+  calibrationConf.darkFile = darkFile->text();
+  calibrationConf.flatFile = flatFile->text();
+  calibrationConf.masterMethod = methodMenu->itemData (
+      methodMenu->currentIndex()).toInt();
+  if ( buildMasterBox ) {
+    calibrationConf.buildMaster = buildMasterBox->isChecked() ? 1 : 0;
+  }
+  calibrationConf.generation++;
+  pthread_mutex_unlock ( &calibrationConfMutex );
+}
+
+
+void
+CalibrationSettings::selectBias ( void )
+{
+  selectFile ( biasFile, tr ( "Select master bias" ));
+}
+
+
+void
+CalibrationSettings::selectDark ( void )
+{
+  selectFile ( darkFile, tr ( "Select master dark" ));
+}
+
+
+void
+CalibrationSettings::selectFlat ( void )
+{
+  selectFile ( flatFile, tr ( "Select master flat" ));
+}
+
+
+void
+CalibrationSettings::selectFile ( QLineEdit* field, const QString& title )
+{
+  QString	filename;
+
+  filename = QFileDialog::getOpenFileName ( this, title, field->text(),
+      tr ( "FITS files (*.fit *.fits *.fts)" ));
+  if ( !filename.isEmpty()) {
+    field->setText ( filename );
+  }
+}
+
+
+// Combine the frames of a SER file into a master frame one frame at a
+// time, so the size of the file doesn't matter
+
+void
+CalibrationSettings::buildFromSER ( void )
+{
+  QString		serName, fitsName;
+  oaSERContext		ser;
+  oaSERHeader		header;
+  oaMasterBuilder	builder;
+  void*			frame;
+  uint16_t*		master;
+  double		seconds;
+  unsigned int		frames = 0;
+  int			format, ret, ok, cancelled = 0;
+  bool			haveExposure;
+
+  serName = QFileDialog::getOpenFileName ( this,
+      tr ( "Select calibration frames" ), "", tr ( "SER files (*.ser)" ));
+  if ( serName.isEmpty()) {
+    return;
+  }
+  if ( oaSEROpenRead ( serName.toStdString().c_str(), &ser, &header )) {
+    QMessageBox::warning ( this, tr ( "Build master" ),
+        tr ( "Can't read SER file %1" ).arg ( serName ));
+    return;
+  }
+  if (( format = serFrameFormat ( &header )) < 0 ) {
+    QMessageBox::warning ( this, tr ( "Build master" ),
+        tr ( "Masters can only be built from mono or raw colour frames" ));
+    oaSERClose ( &ser );
+    return;
+  }
+
+  fitsName = QFileDialog::getSaveFileName ( this, tr ( "Save master as" ),
+      QFileInfo ( serName ).path() + "/" +
+      QFileInfo ( serName ).completeBaseName() + "-master.fits",
+      tr ( "FITS files (*.fit *.fits *.fts)" ));
+  if ( fitsName.isEmpty()) {
+    oaSERClose ( &ser );
+    return;
+  }
+  // SER files don't record the exposure time, but it's needed in the
+  // master if a dark is to be scaled
+  seconds = QInputDialog::getDouble ( this, tr ( "Build master" ),
+      tr ( "Exposure time of the frames in seconds (0 if unknown)" ), 0, 0,
+      3600, 6, &haveExposure );
+  if ( !haveExposure ) {
+    oaSERClose ( &ser );
+    return;
+  }
+
+  if (( ret = oaMasterInit ( &builder, header.ImageWidth,
+      header.ImageHeight, format, methodMenu->itemData (
+      methodMenu->currentIndex()).toInt(), QFileInfo ( fitsName ).
+      absolutePath().toStdString().c_str(), 0, 0 )) != OA_ERR_NONE ) {
+    QMessageBox::warning ( this, tr ( "Build master" ),
+        tr ( "Can't start building the master (error %1)" ).arg ( -ret ));
+    oaSERClose ( &ser );
+    return;
+  }
+  frame = malloc ( ser.frameSize );
+  master = static_cast<uint16_t*>( malloc ( header.ImageWidth *
+      header.ImageHeight * sizeof ( uint16_t )));
+  if ( !frame || !master ) {
+    free ( frame );
+    free ( master );
+    oaMasterFree ( &builder );
+    oaSERClose ( &ser );
+    return;
+  }
+
+  QProgressDialog progress ( tr ( "Building master frame..." ),
+      tr ( "Cancel" ), 0, header.FrameCount, this );
+  progress.setWindowModality ( Qt::WindowModal );
+  while (( ret = oaSERReadFrame ( &ser, frame )) == 0 ) {
+    if ( oaMasterAddFrame ( &builder, frame ) != OA_ERR_NONE ) {
+      ret = -1;
+      break;
+    }
+    progress.setValue ( ++frames );
+    if (( cancelled = progress.wasCanceled())) {
+      break;
+    }
+  }
+  progress.reset();
+
+  ok = 0;
+  if ( ret >= 0 && !cancelled && frames &&
+      oaMasterFinish ( &builder, master, 0 ) == OA_ERR_NONE ) {
+    ok = ( Calibration::writeMaster ( fitsName, master, header.ImageWidth,
+        header.ImageHeight, seconds * 1000000, frames ) == OA_ERR_NONE );
+  }
+  free ( frame );
+  free ( master );
+  oaMasterFree ( &builder );
+  oaSERClose ( &ser );
+
+  if ( ok ) {
+    QMessageBox::information ( this, tr ( "Build master" ),
+        tr ( "Master of %1 frames written to %2" ).arg ( frames ).arg (
+        fitsName ));
+  } else if ( !cancelled ) {
+    QMessageBox::warning ( this, tr ( "Build master" ),
+        tr ( "Building the master frame failed" ));
+  }
+}
+
+
+static int
+serFrameFormat ( oaSERHeader* header )
+{
+  int	wide = header->PixelDepth > 8;
+  int	le = header->LittleEndian;
+
+  switch ( header->ColorID ) {
+    case OA_SER_MONO:
+      return wide ? ( le ? OA_PIX_FMT_GREY16LE : OA_PIX_FMT_GREY16BE ) :
+          OA_PIX_FMT_GREY8;
+    case OA_SER_BAYER_RGGB:
+      return wide ? ( le ? OA_PIX_FMT_RGGB16LE : OA_PIX_FMT_RGGB16BE ) :
+          OA_PIX_FMT_RGGB8;
+    case OA_SER_BAYER_BGGR:
+      return wide ? ( le ? OA_PIX_FMT_BGGR16LE : OA_PIX_FMT_BGGR16BE ) :
+          OA_PIX_FMT_BGGR8;
+    case OA_SER_BAYER_GRBG:
+      return wide ? ( le ? OA_PIX_FMT_GRBG16LE : OA_PIX_FMT_GRBG16BE ) :
+          OA_PIX_FMT_GRBG8;
+    case OA_SER_BAYER_GBRG:
+      return wide ? ( le ? OA_PIX_FMT_GBRG16LE : OA_PIX_FMT_GBRG16BE ) :
+          OA_PIX_FMT_GBRG8;
+  }
+  return -1;
+}
@@ -0,0 +1,103 @@
+/*****************************************************************************
+ *
+ * calibrationSettings.h -- class declaration
+ *
+ * Copyright 2026
+ *   James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+
+#pragma once
+
+#include <oa_common.h>
+
+#include <pthread.h>
+
+#include <QtGlobal>
+#if QT_VERSION >= 0x050000
+#include <QtWidgets>
+#endif
+#include <QtCore>
+#include <QtGui>
+
+#include "trampoline.h"
+
+
+typedef struct {
+	int			enabled;
+	int			scaleDark;
+	int			fixHotPixels;
+	QString			biasFile;
+	QString			darkFile;
+	QString			flatFile;
+	int			masterMethod;
+	int			buildMaster;
+	// Bumped whenever the settings change so the masters get reloaded
+	unsigned int		generation;
+} calibrationConfig;
+
+extern calibrationConfig calibrationConf;
+
+// Held while calibrationConf is changed or copied, as the calibration
+// loader threads read it
+extern pthread_mutex_t	calibrationConfMutex;
+
+class CalibrationSettings : public QWidget
+{
+  Q_OBJECT
+
+  public:
+    			CalibrationSettings ( QWidget*, int, trampolineFuncs* );
+    			~CalibrationSettings();
+    void		storeSettings ( void );
+
+  private:
+    QCheckBox*		enableBox;
+    QCheckBox*		scaleDarkBox;
+    QCheckBox*		hotPixelBox;
+    QGridLayout*	grid;
+    QLabel*		biasLabel;
+    QLineEdit*		biasFile;
+    QPushButton*	biasButton;
+    QLabel*		darkLabel;
+    QLineEdit*		darkFile;
+    QPushButton*	darkButton;
+    QLabel*		flatLabel;
+    QLineEdit*		flatFile;
+    QPushButton*	flatButton;
+    QGroupBox*		masterBox;
+    QGridLayout*	masterGrid;
+    QLabel*		methodLabel;
+    QComboBox*		methodMenu;
+    QCheckBox*		buildMasterBox;
+    QPushButton*	buildButton;
+    QVBoxLayout*	box;
+		trampolineFuncs*	trampolines;
+
+    void		selectFile ( QLineEdit*, const QString& );
+
+  public slots:
+    void		selectBias ( void );
+    void		selectDark ( void );
+    void		selectFlat ( void );
+    void		buildFromSER ( void );
+};
@@ -174,7 +174,8 @@ Camera::hasROI ( void )
     qWarning() << __func__ << " called with camera uninitialised";
     return 0;
   }
-  return cameraFeatures.flags & OA_CAM_FEATURE_ROI;
+  return ( cameraFeatures.flags & OA_CAM_FEATURE_ROI ) ||
+      oaHasSoftwareROI ( cameraContext );
 }
 
 
@@ -486,6 +487,25 @@ Camera::setControl ( int control, int64_t value )
 }
 
 
+// Queue a control change without waiting for the camera to make it.
+// Changes that arrive faster than the camera can take them (from a slider
+// being dragged, say) are merged, so only the latest value is written
+
+int
+Camera::setControlAsync ( int control, int64_t value )
+{
+  oaControlValue v;
+
+  if ( !initialised ) {
+    qWarning() << __func__ << " called with camera uninitialised";
+    return -1;
+  }
+
+  populateControlValue ( &v, control, value );
+  return cameraFuncs.setControlAsync ( cameraContext, control, &v, 0, 0 );
+}
+
+
 int64_t
 Camera::readControl ( int control )
 {
@@ -807,3 +827,36 @@ Camera::hasSingleShot ( void )
   }
   return cameraFeatures.flags & OA_CAM_FEATURE_SINGLE_SHOT;
 }
+
+
+int
+Camera::frameStats ( oaFrameStats* stats )
+{
+  if ( !initialised ) {
+    qWarning() << __func__ << " called with camera uninitialised";
+    return -1;
+  }
+  return oaGetFrameStats ( cameraContext, stats );
+}
+
+
+void
+Camera::resetFrameStats ( void )
+{
+  if ( !initialised ) {
+    qWarning() << __func__ << " called with camera uninitialised";
+    return;
+  }
+  oaResetFrameStats ( cameraContext );
+}
+
+
+int
+Camera::writeFrameStats ( const char* filename )
+{
+  if ( !initialised ) {
+    qWarning() << __func__ << " called with camera uninitialised";
+    return -1;
+  }
+  return oaWriteFrameStatsCSV ( cameraContext, filename );
+}
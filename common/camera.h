@@ -93,6 +93,7 @@ class Camera : public QObject
 				int64_t );
     int64_t		unpackControlValue ( oaControlValue* );
     int			setControl ( int, int64_t );
+    int			setControlAsync ( int, int64_t );
     int64_t		readControl ( int );
     int			getAWBManualSetting ( void );
     int			setResolution ( int, int );
@@ -105,6 +106,10 @@ class Camera : public QObject
 
     const char*		getMenuString ( int, int );
 
+    int			frameStats ( oaFrameStats* );
+    void		resetFrameStats ( void );
+    int			writeFrameStats ( const char* );
+
   private:
 
     oaCamera*		cameraContext;
@@ -27,8 +27,13 @@
 
 #include <oa_common.h>
 
+extern "C" {
+#include <openastro/imgproc.h>
+}
+
 #include "captureSettings.h"
 #include "commonState.h"
+#include "outputGrader.h"
 
 // This is global.  All applications using this code share it.
 
@@ -59,6 +64,72 @@ CaptureSettings::CaptureSettings ( QWidget* parent, int formats,
   indexSizeSpinbox->setMaximum ( 10 );
   indexSizeSpinbox->setValue ( captureConf.indexDigits );
 
+	if ( videoFormats ) {
+		// Lucky imaging frame selection
+		gradeBox = new QGroupBox ( tr ( "Grade frames and only save the best" ),
+				this );
+		gradeBox->setCheckable ( true );
+		gradeBox->setChecked ( captureConf.gradeFrames );
+
+		gradeMetricLabel = new QLabel ( tr ( "Sharpness measure" ));
+		gradeMetricMenu = new QComboBox ( this );
+		gradeMetricMenu->addItem ( tr ( "Sobel gradient energy" ),
+				OA_GRADE_SOBEL );
+		gradeMetricMenu->addItem ( tr ( "Laplacian variance" ),
+				OA_GRADE_LAPLACIAN );
+		gradeMetricMenu->addItem ( tr ( "Planetary disc only" ),
+				OA_GRADE_PLANET );
+		gradeMetricMenu->setCurrentIndex ( gradeMetricMenu->findData (
+				captureConf.gradeMetric ));
+
+		gradeModeLabel = new QLabel ( tr ( "Keep" ));
+		gradeModeMenu = new QComboBox ( this );
+		gradeModeMenu->addItem ( tr ( "Best frames of recent window" ),
+				GRADE_MODE_BEST_PERCENT );
+		gradeModeMenu->addItem ( tr ( "Frames scoring above threshold" ),
+				GRADE_MODE_THRESHOLD );
+		gradeModeMenu->setCurrentIndex ( gradeModeMenu->findData (
+				captureConf.gradeMode ));
+
+		gradeKeepLabel = new QLabel ( tr ( "Percentage to keep" ));
+		gradeKeepSpinbox = new QSpinBox ( this );
+		gradeKeepSpinbox->setRange ( 1, 100 );
+		gradeKeepSpinbox->setSuffix ( "%" );
+		gradeKeepSpinbox->setValue ( captureConf.gradeKeepPercent );
+
+		gradeWindowLabel = new QLabel ( tr ( "Window (frames)" ));
+		gradeWindowSpinbox = new QSpinBox ( this );
+		gradeWindowSpinbox->setRange ( 1, 100000 );
+		gradeWindowSpinbox->setValue ( captureConf.gradeWindow );
+
+		gradeThresholdLabel = new QLabel ( tr ( "Threshold score" ));
+		gradeThresholdSpinbox = new QDoubleSpinBox ( this );
+		gradeThresholdSpinbox->setRange ( 0, 1e9 );
+		gradeThresholdSpinbox->setDecimals ( 1 );
+		gradeThresholdSpinbox->setValue ( captureConf.gradeThreshold );
+
+		gradeThreadsLabel = new QLabel ( tr ( "Grading threads (0 = auto)" ));
+		gradeThreadsSpinbox = new QSpinBox ( this );
+		gradeThreadsSpinbox->setRange ( 0, GRADE_MAX_THREADS );
+		gradeThreadsSpinbox->setValue ( captureConf.gradeThreads );
+
+		gradeGrid = new QGridLayout();
+		gradeGrid->addWidget ( gradeMetricLabel, 0, 0 );
+		gradeGrid->addWidget ( gradeMetricMenu, 0, 1 );
+		gradeGrid->addWidget ( gradeModeLabel, 1, 0 );
+		gradeGrid->addWidget ( gradeModeMenu, 1, 1 );
+		gradeGrid->addWidget ( gradeKeepLabel, 2, 0 );
+		gradeGrid->addWidget ( gradeKeepSpinbox, 2, 1 );
+		gradeGrid->addWidget ( gradeWindowLabel, 3, 0 );
+		gradeGrid->addWidget ( gradeWindowSpinbox, 3, 1 );
+		gradeGrid->addWidget ( gradeThresholdLabel, 4, 0 );
+		gradeGrid->addWidget ( gradeThresholdSpinbox, 4, 1 );
+		gradeGrid->addWidget ( gradeThreadsLabel, 5, 0 );
+		gradeGrid->addWidget ( gradeThreadsSpinbox, 5, 1 );
+		gradeBox->setLayout ( gradeGrid );
+		gradeModeChanged ( gradeModeMenu->currentIndex());
+	}
+
   hLayout = new QHBoxLayout ( this );
   spinboxLayout = new QHBoxLayout();
   vLayout = new QVBoxLayout();
@@ -70,6 +141,9 @@ CaptureSettings::CaptureSettings ( QWidget* parent, int formats,
   spinboxLayout->addWidget ( indexSizeLabel );
   spinboxLayout->addWidget ( indexSizeSpinbox );
   vLayout->addLayout ( spinboxLayout );
+	if ( videoFormats ) {
+		vLayout->addWidget ( gradeBox );
+	}
 
   vLayout->addStretch ( 1 );
   hLayout->addLayout ( vLayout );
@@ -83,6 +157,22 @@ CaptureSettings::CaptureSettings ( QWidget* parent, int formats,
         SLOT ( dataChanged()));
     connect ( utVideoBox, SIGNAL ( stateChanged ( int )), parent,
         SLOT ( dataChanged()));
+    connect ( gradeBox, SIGNAL ( toggled ( bool )), parent,
+        SLOT ( dataChanged()));
+    connect ( gradeMetricMenu, SIGNAL ( currentIndexChanged ( int )), parent,
+        SLOT ( dataChanged()));
+    connect ( gradeModeMenu, SIGNAL ( currentIndexChanged ( int )), parent,
+        SLOT ( dataChanged()));
+    connect ( gradeModeMenu, SIGNAL ( currentIndexChanged ( int )), this,
+        SLOT ( gradeModeChanged ( int )));
+    connect ( gradeKeepSpinbox, SIGNAL ( valueChanged ( int )), parent,
+        SLOT ( dataChanged()));
+    connect ( gradeWindowSpinbox, SIGNAL ( valueChanged ( int )), parent,
+        SLOT ( dataChanged()));
+    connect ( gradeThresholdSpinbox, SIGNAL ( valueChanged ( double )),
+        parent, SLOT ( dataChanged()));
+    connect ( gradeThreadsSpinbox, SIGNAL ( valueChanged ( int )), parent,
+        SLOT ( dataChanged()));
 	}
   connect ( indexSizeSpinbox, SIGNAL ( valueChanged ( int )), parent,
       SLOT ( dataChanged()));
@@ -101,6 +191,15 @@ CaptureSettings::storeSettings ( void )
 	if ( videoFormats ) {
     captureConf.windowsCompatibleAVI = winAVIBox->isChecked() ? 1 : 0;
     captureConf.useUtVideo = utVideoBox->isChecked() ? 1 : 0;
+    captureConf.gradeFrames = gradeBox->isChecked() ? 1 : 0;
+    captureConf.gradeMetric = gradeMetricMenu->itemData (
+        gradeMetricMenu->currentIndex()).toInt();
+    captureConf.gradeMode = gradeModeMenu->itemData (
+        gradeModeMenu->currentIndex()).toInt();
+    captureConf.gradeKeepPercent = gradeKeepSpinbox->value();
+    captureConf.gradeWindow = gradeWindowSpinbox->value();
+    captureConf.gradeThreshold = gradeThresholdSpinbox->value();
+    captureConf.gradeThreads = gradeThreadsSpinbox->value();
 	}
   captureConf.indexDigits = indexSizeSpinbox->value();
 }
@@ -112,3 +211,15 @@ CaptureSettings::resetIndex ( void )
   // FIX ME -- this might not be good in the middle of a capture run
 	commonState.captureIndex = 0;
 }
+
+
+void
+CaptureSettings::gradeModeChanged ( int index )
+{
+	int		threshold = ( gradeModeMenu->itemData ( index ).toInt() ==
+			GRADE_MODE_THRESHOLD );
+
+	gradeKeepSpinbox->setEnabled ( !threshold );
+	gradeWindowSpinbox->setEnabled ( !threshold );
+	gradeThresholdSpinbox->setEnabled ( threshold );
+}
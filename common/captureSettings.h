@@ -42,6 +42,13 @@ typedef struct {
 	int			useUtVideo;
 	int			indexDigits;
 	int			windowsCompatibleAVI;
+	int			gradeFrames;
+	int			gradeMetric;
+	int			gradeMode;
+	int			gradeKeepPercent;
+	int			gradeWindow;
+	double	gradeThreshold;
+	int			gradeThreads;
 } captureConfig;
 
 extern captureConfig captureConf;
@@ -65,9 +72,24 @@ class CaptureSettings : public QWidget
     QHBoxLayout*	spinboxLayout;
     QLabel*		indexSizeLabel;
     QSpinBox*		indexSizeSpinbox;
+    QGroupBox*		gradeBox;
+    QGridLayout*	gradeGrid;
+    QLabel*		gradeMetricLabel;
+    QComboBox*		gradeMetricMenu;
+    QLabel*		gradeModeLabel;
+    QComboBox*		gradeModeMenu;
+    QLabel*		gradeKeepLabel;
+    QSpinBox*		gradeKeepSpinbox;
+    QLabel*		gradeWindowLabel;
+    QSpinBox*		gradeWindowSpinbox;
+    QLabel*		gradeThresholdLabel;
+    QDoubleSpinBox*	gradeThresholdSpinbox;
+    QLabel*		gradeThreadsLabel;
+    QSpinBox*		gradeThreadsSpinbox;
 		int						videoFormats;
 		trampolineFuncs*	trampolines;
 
   public slots:
     void		resetIndex ( void );
+    void		gradeModeChanged ( int );
 };
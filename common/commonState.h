@@ -75,6 +75,7 @@ typedef struct
   int									histogramSettingsIndex;
   int									demosaicSettingsIndex;
   int									fitsSettingsIndex;
+  int									calibrationSettingsIndex;
   int									timerSettingsIndex;
 
 	/*
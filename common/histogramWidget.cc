@@ -31,6 +31,7 @@
 
 extern "C" {
 #include <openastro/camera.h>
+#include <openastro/imgproc.h>
 }
 
 #include "histogramWidget.h"
@@ -55,6 +56,7 @@ int		HistogramWidget::blue[256];
 int*	HistogramWidget::grey;
 int		HistogramWidget::histogramMin;
 int		HistogramWidget::histogramMax;
+oaHistogram	HistogramWidget::engine;
 
 
 HistogramWidget::HistogramWidget ( const char* appName, QWidget* parent ) :
@@ -81,6 +83,7 @@ HistogramWidget::HistogramWidget ( const char* appName, QWidget* parent ) :
 
 HistogramWidget::~HistogramWidget()
 {
+  oaHistogramFree ( &engine );
 }
 
 
@@ -95,17 +98,77 @@ void
 HistogramWidget::process ( void* imageData, unsigned int width,
     unsigned int height, unsigned int length, int format )
 {
-  fullIntensity = 0xff;
-  minIntensity = 0xffff;
+  int		display[ OA_HISTOGRAM_MAX_CHANNELS ][256];
+  int		maxCount = 1;
+  int		c, shift, mosaicAsGrey;
+  unsigned int	i;
+
+  // The engine only needs setting up again if the frame changes
+  if ( engine.xSize != ( int ) width || engine.ySize != ( int ) height ||
+      engine.frameFormat != format ) {
+    oaHistogramFree ( &engine );
+    ( void ) oaHistogramInit ( &engine, width, height, format, 0 );
+  }
   doneProcess = 1;
+  if ( !engine.workspace || oaHistogramProcess ( &engine, imageData ) !=
+      OA_ERR_NONE ) {
+    // The engine doesn't handle packed, planar or YUV formats, so fall
+    // back to sampling those as greyscale
+    _processGreyscaleHistogram ( imageData, width, height, length, format );
+    if ( statsEnabled ) {
+      histogramMin = minIntensity < histogramMin ? minIntensity : histogramMin;
+      histogramMax = maxIntensity > histogramMax ? maxIntensity : histogramMax;
+    }
+    return;
+  }
+
+  fullIntensity = engine.fullScale;
+  mosaicAsGrey = oaFrameFormats[ format ].rawColour &&
+      !histogramConf.rawRGBHistogram;
+  colours = ( engine.numChannels == 1 || mosaicAsGrey ) ? 1 : 3;
+
+  // 16-bit bins are displayed on the high byte
+  shift = ( engine.bytesPerSample == 2 ) ? 8 : 0;
+  bzero ( display, sizeof ( display ));
+  for ( c = 0; c < engine.numChannels; c++ ) {
+    int* t = display[ mosaicAsGrey ? 0 : c ];
+    for ( i = 0; i < ( unsigned int ) engine.numBins; i++ ) {
+      t[ i >> shift ] += engine.bins[c][i];
+    }
+  }
+
+  minIntensity = engine.stats[0].min;
+  maxIntensity = engine.stats[0].max;
+  for ( c = 1; c < engine.numChannels; c++ ) {
+    minIntensity = engine.stats[c].min < ( unsigned int ) minIntensity ?
+        engine.stats[c].min : minIntensity;
+    maxIntensity = engine.stats[c].max > ( unsigned int ) maxIntensity ?
+        engine.stats[c].max : maxIntensity;
+  }
+  if ( engine.numChannels == 3 ) {
+    maxRedIntensity = engine.stats[ OA_HISTOGRAM_RED ].max;
+    maxGreenIntensity = engine.stats[ OA_HISTOGRAM_GREEN ].max;
+    maxBlueIntensity = engine.stats[ OA_HISTOGRAM_BLUE ].max;
+  }
 
-  if ( OA_PIX_FMT_RGB24 == format || OA_PIX_FMT_BGR24 == format ) {
-    _processRGBHistogram ( imageData, width, height, length, format );
+  for ( c = 0; c < colours; c++ ) {
+    for ( i = 0; i < 256; i++ ) {
+      maxCount = ( display[c][i] > maxCount ) ? display[c][i] : maxCount;
+    }
+  }
+  if ( colours == 1 ) {
+    for ( i = 0; i < 256; i++ ) {
+      grey[i] = ( int64_t ) display[0][i] * 100 / maxCount;
+      if ( histogramConf.logHistogram ) {
+        grey[i] = 50 * log10 ( grey[i] + 1 );
+      }
+    }
   } else {
-    if ( oaFrameFormats[ format ].rawColour && histogramConf.rawRGBHistogram ) {
-      _processMosaicHistogram ( imageData, width, height, length, format );
-    } else {
-      _processGreyscaleHistogram ( imageData, width, height, length, format );
+    for ( i = 0; i < 256; i++ ) {
+      red[i] = ( int64_t ) display[ OA_HISTOGRAM_RED ][i] * 100 / maxCount;
+      green[i] = ( int64_t ) display[ OA_HISTOGRAM_GREEN ][i] * 100 /
+          maxCount;
+      blue[i] = ( int64_t ) display[ OA_HISTOGRAM_BLUE ][i] * 100 / maxCount;
     }
   }
 
@@ -268,6 +331,8 @@ HistogramWidget::_processGreyscaleHistogram ( void* imageData,
   unsigned int i;
 
   colours = 1;
+  fullIntensity = 0xff;
+  minIntensity = 0xffff;
   step = length / 10000;
   if ( step < 1 ) {
     step = 1;
@@ -315,201 +380,6 @@ HistogramWidget::_processGreyscaleHistogram ( void* imageData,
     grey[i] = grey[i] * 100 / maxCount;
    if ( histogramConf.logHistogram ) {
       grey[i] = 50 * log10 ( grey[i] + 1 );
-   }  
-  }
-}
-
-
-void
-HistogramWidget::_processRGBHistogram ( void* imageData,
-    unsigned int width __attribute((unused)),
-		unsigned int height __attribute((unused)), unsigned int length,
-		int format )
-{
-  int* swapRed = red;
-  int* swapBlue = blue;
-  int maxCount = 1;
-  int step;
-  unsigned int i;
-
-  colours = 3;
-  step = ( length / colours ) / 10000;
-  step *= colours;
-  if ( step < 1 ) {
-    step = 1;
-  }
-
-  if ( OA_PIX_FMT_BGR24 == format ) {
-    swapRed = blue;
-    swapBlue = red;
-  }
-
-  maxRedIntensity = 0;
-  maxGreenIntensity = 0;
-  maxBlueIntensity = 0;
-  bzero ( red, sizeof( int ) * 256 );
-  bzero ( green, sizeof( int ) * 256 );
-  bzero ( blue, sizeof( int ) * 256 );
-  int intensity;
-  for ( i = 0; i < length; i += step ) {
-    intensity = *( static_cast<uint8_t*>( imageData ) + i );
-    maxRedIntensity = intensity > maxRedIntensity ? intensity :
-        maxRedIntensity;
-    maxIntensity = intensity > maxIntensity ? intensity : maxIntensity;
-    minIntensity = intensity < minIntensity ? intensity : minIntensity;
-    swapRed[ intensity ]++;
-
-    intensity = *( static_cast<uint8_t*>( imageData ) + i + 1 );
-    maxGreenIntensity = intensity > maxGreenIntensity ? intensity :
-        maxGreenIntensity;
-    maxIntensity = intensity > maxIntensity ? intensity : maxIntensity;
-    minIntensity = intensity < minIntensity ? intensity : minIntensity;
-    green[ intensity ]++;
-
-    intensity = *( static_cast<uint8_t*>( imageData ) + i + 2 );
-    maxBlueIntensity = intensity > maxBlueIntensity ? intensity :
-        maxBlueIntensity;
-    maxIntensity = intensity > maxIntensity ? intensity : maxIntensity;
-    minIntensity = intensity < minIntensity ? intensity : minIntensity;
-    swapBlue[ intensity ]++;
-  }
-  for ( i = 0; i < 256; i++ ) {
-    maxCount = ( red[i] > maxCount ) ? red[i] : maxCount;
-    maxCount = ( green[i] > maxCount ) ? green[i] : maxCount;
-    maxCount = ( blue[i] > maxCount ) ? blue[i] : maxCount;
-  }
-  for ( i = 0; i < 256; i++ ) {
-    red[i] = red[i] * 100 / maxCount;
-    green[i] = green[i] * 100 / maxCount;
-    blue[i] = blue[i] * 100 / maxCount;
-  }
-  if ( OA_PIX_FMT_BGR24 == format ) {
-    int s = maxBlueIntensity;
-    maxBlueIntensity = maxRedIntensity;
-    maxRedIntensity = s;
-  }
-}
-
-
-void
-HistogramWidget::_processMosaicHistogram ( void* imageData,
-    unsigned int width, unsigned int height __attribute((unused)),
-		unsigned int length, int format )
-{
-  unsigned int i, x, y, bytesPerLine, bytesPerPixel;
-  int maxCount = 1;
-  int step;
-  char colour;
-  const char* pattern = "    ";
-
-  bytesPerPixel = oaFrameFormats[ format ].bytesPerPixel;
-  bytesPerLine = width * bytesPerPixel;
-  colours = 3;
-  step = length / 10000;
-  if ( step < 1 ) {
-    step = 1;
-  }
-  // make sure step is odd, so we pick up all photosite colours
-  step &= 1;
-  // and step whole photosites
-  step *= bytesPerPixel;
-
-  maxRedIntensity = 0;
-  maxGreenIntensity = 0;
-  maxBlueIntensity = 0;
-  bzero ( red, sizeof( int ) * 256 );
-  bzero ( green, sizeof( int ) * 256 );
-  bzero ( blue, sizeof( int ) * 256 );
-
-  fullIntensity = ( 1 << oaFrameFormats[ format ].bitsPerPixel ) - 1;
-
-  int intensity = 0;
-  for ( i = 0; i < length; i += step ) {
-    x = ( i % bytesPerLine ) / bytesPerPixel;
-    y = i / bytesPerLine;
-    switch ( format ) {
-      case OA_PIX_FMT_BGGR8:
-      case OA_PIX_FMT_BGGR16LE:
-      case OA_PIX_FMT_BGGR16BE:
-        pattern = "BGGR";
-        break;
-
-      case OA_PIX_FMT_RGGB8:
-      case OA_PIX_FMT_RGGB16LE:
-      case OA_PIX_FMT_RGGB16BE:
-        pattern = "RGGB";
-        break;
-
-      case OA_PIX_FMT_GBRG8:
-      case OA_PIX_FMT_GBRG16LE:
-      case OA_PIX_FMT_GBRG16BE:
-        pattern = "GBRG";
-        break;
-
-      case OA_PIX_FMT_GRBG8:
-      case OA_PIX_FMT_GRBG16LE:
-      case OA_PIX_FMT_GRBG16BE:
-        pattern = "GRBG";
-        break;
-    }
-    colour = pattern[ 2 * ( y % 2 ) + ( x % 2 )];
-
-    if ( oaFrameFormats[ format ].bitsPerPixel == 16 ) {
-      if ( oaFrameFormats[ format ].littleEndian ) {
-        int b1, b2;
-        b1 = *( static_cast<uint8_t*>( imageData ) + i );
-        b2 = *( static_cast<uint8_t*>( imageData ) + i + 1 );
-        intensity = b1 + ( b2 << 8 );
-      } else {
-        int b1, b2;
-        b1 = *( static_cast<uint8_t*>( imageData ) + i );
-        b2 = *( static_cast<uint8_t*>( imageData ) + i + 1 );
-        intensity = ( b1 << 8 ) + b2;
-      }
-    } else {
-      if ( oaFrameFormats[ format ].bitsPerPixel == 8 ) {
-        intensity = *( static_cast<uint8_t*>( imageData ) + i );
-      } else {
-        qWarning() << __func__ << "can't handle bit depth" <<
-            oaFrameFormats[ format ].bitsPerPixel;
-      }
-    }
-
-    switch ( colour ) {
-      case 'R':
-        maxRedIntensity = intensity > maxRedIntensity ? intensity :
-            maxRedIntensity;
-        maxIntensity = intensity > maxIntensity ? intensity : maxIntensity;
-        minIntensity = intensity < minIntensity ? intensity : minIntensity;
-        red[ intensity ]++;
-        break;
-
-      case 'G':
-        maxGreenIntensity = intensity > maxGreenIntensity ? intensity :
-            maxGreenIntensity;
-        maxIntensity = intensity > maxIntensity ? intensity : maxIntensity;
-        minIntensity = intensity < minIntensity ? intensity : minIntensity;
-        green[ intensity ]++;
-        break;
-
-      case 'B':
-        maxBlueIntensity = intensity > maxBlueIntensity ? intensity :
-            maxBlueIntensity;
-        maxIntensity = intensity > maxIntensity ? intensity : maxIntensity;
-        minIntensity = intensity < minIntensity ? intensity : minIntensity;
-        blue[ intensity ]++;
-        break;
-    }
-  }
-
-  for ( i = 0; i < 256; i++ ) {
-    maxCount = ( red[i] > maxCount ) ? red[i] : maxCount;
-    maxCount = ( green[i] > maxCount ) ? green[i] : maxCount;
-    maxCount = ( blue[i] > maxCount ) ? blue[i] : maxCount;
-  }
-  for ( i = 0; i < 256; i++ ) {
-    red[i] = red[i] * 100 / maxCount;
-    green[i] = green[i] * 100 / maxCount;
-    blue[i] = blue[i] * 100 / maxCount;
+   }
   }
 }
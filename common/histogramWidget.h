@@ -36,6 +36,10 @@
 #include <QtCore>
 #include <QtGui>
 
+extern "C" {
+#include <openastro/imgproc.h>
+}
+
 
 class HistogramWidget : public QWidget
 {
@@ -74,13 +78,10 @@ class HistogramWidget : public QWidget
     static int			showingThreeGraphs;
     static int			doneProcess;
     static int			statsEnabled;
+    static oaHistogram		engine;
 		int							windowSizeX;
 		int							windowSizeY;
 
-    void		_processRGBHistogram ( void*, unsigned int,
-			    unsigned int, unsigned int, int );
     void		_processGreyscaleHistogram ( void*, unsigned int,
 			    unsigned int, unsigned int, int );
-    void		_processMosaicHistogram ( void*, unsigned int,
-			    unsigned int, unsigned int, int );
 };
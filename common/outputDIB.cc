@@ -102,7 +102,6 @@ OutputDIB::openOutput ( void )
 
 int
 OutputDIB::addFrame ( void* frame,
-		const char* timestampStr __attribute__((unused)),
 		int64_t expTime __attribute__((unused)),
     const char* commentStr __attribute((unused)),
 		FRAME_METADATA* metadata __attribute__((unused)),
@@ -38,8 +38,8 @@ class OutputDIB : public OutputHandler
     			OutputDIB ( int, int, int, int, int, QString, trampolineFuncs* );
     			~OutputDIB();
     int			openOutput ( void );
-    int			addFrame ( void*, const char*, int64_t, const char*,
-								FRAME_METADATA*, TIMER_METADATA* );
+    int			addFrame ( void*, int64_t, const char*, FRAME_METADATA*,
+								TIMER_METADATA* );
     int			outputExists ( void );
     int			outputWritable ( void );
     void		closeOutput();
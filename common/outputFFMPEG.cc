@@ -269,7 +269,7 @@ OutputFFMPEG::openOutput ( void )
 }
 
 
-int OutputFFMPEG::addFrame ( void* frame,const char* timestampStr __attribute__((unused)),
+int OutputFFMPEG::addFrame ( void* frame,
     int64_t expTime __attribute__((unused)),
 		const char* commentStr __attribute__((unused)),
 		FRAME_METADATA* metadata __attribute__((unused)),
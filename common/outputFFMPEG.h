@@ -42,8 +42,8 @@ class OutputFFMPEG : public OutputHandler
     			OutputFFMPEG ( int, int, int, int, int, QString, trampolineFuncs* );
     			~OutputFFMPEG();
     int			openOutput ( void );
-    int			addFrame ( void*, const char*, int64_t, const char*,
-								FRAME_METADATA*, TIMER_METADATA* );
+    int			addFrame ( void*, int64_t, const char*, FRAME_METADATA*,
+								TIMER_METADATA* );
     int			outputExists ( void );
     int			outputWritable ( void );
     void		closeOutput();
@@ -263,9 +263,8 @@ OutputFITS::openOutput ( void )
 
 
 int
-OutputFITS::addFrame ( void* frame, const char* constTimestampStr,
-    int64_t expTime, const char* commentStr, FRAME_METADATA* metadata,
-		TIMER_METADATA* timerData )
+OutputFITS::addFrame ( void* frame, int64_t expTime, const char* commentStr,
+		FRAME_METADATA* metadata, TIMER_METADATA* timerData )
 {
   unsigned char* s;
   unsigned char* t;
@@ -275,22 +274,13 @@ OutputFITS::addFrame ( void* frame, const char* constTimestampStr,
   char stringBuff[FLEN_VALUE+2];
   float pixelSize = 0;
   int xorg, yorg;
+  char timestampStr[ OA_TIMESTAMP_STRLEN ];
   // Hack to get around older versions of library using char* rather
   // than const char*
 #if CFITSIO_MAJOR > 3 || ( CFITSIO_MAJOR == 3 && CFITSIO_MINOR > 30 )
-  const char* timestampStr = constTimestampStr;
   const char* cString = stringBuff;
 #else
-  char stampStr[FLEN_VALUE+1];
-  char *timestampStr;
   char *cString = stringBuff;
-
-  if ( constTimestampStr ) {
-    ( void ) strcpy ( stampStr, constTimestampStr );
-    timestampStr = stampStr;
-  } else {
-    timestampStr = 0;
-  }
 #endif
 
   filenameRoot = getNewFilename();
@@ -401,6 +391,7 @@ OutputFITS::addFrame ( void* frame, const char* constTimestampStr,
    * 'yyyy-mm-dd' or 'yyyy-mm-ddTHH:MM:SS[.sss]'.
    */
 
+  formatTimestamp ( metadata, timestampStr, OA_TIMESTAMP_STRLEN );
   fits_write_key_str ( fptr, "DATE-OBS", timestampStr, "", &status );
   fits_write_date ( fptr, &status );
 
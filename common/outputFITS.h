@@ -34,8 +34,8 @@ class OutputFITS : public OutputHandler
 							QString, trampolineFuncs* );
     			~OutputFITS();
     int			openOutput ( void );
-    int			addFrame ( void*, const char*, int64_t, const char*,
-								FRAME_METADATA*, TIMER_METADATA* );
+    int			addFrame ( void*, int64_t, const char*, FRAME_METADATA*,
+								TIMER_METADATA* );
     void		closeOutput ( void );
     int			outputExists ( void );
     int			outputWritable ( void );
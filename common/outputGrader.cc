@@ -0,0 +1,486 @@
+/*****************************************************************************
+ *
+ * outputGrader.cc -- grade frames and only keep the best ones
+ *
+ * Copyright 2026
+ *   James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <oa_common.h>
+
+#include <cstdlib>
+#include <cstring>
+
+extern "C" {
+#include <openastro/camera.h>
+#include <openastro/imgproc.h>
+#include <openastro/util.h>
+#include <openastro/video/formats.h>
+}
+
+#include "commonState.h"
+#include "captureSettings.h"
+#include "outputHandler.h"
+#include "outputGrader.h"
+#include "trampoline.h"
+
+#define	SLOT_FREE			0
+#define	SLOT_FILLING	1
+#define	SLOT_QUEUED		2
+#define	SLOT_GRADING	3
+#define	SLOT_GRADED		4
+
+
+OutputGrader::OutputGrader ( OutputHandler* out, int x, int y, int fmt,
+		trampolineFuncs* trampolines ) :
+    OutputHandler ( x, y, 0, 0, QString ( "" ), trampolines ),
+		output ( out ), xSize ( x ), ySize ( y ), imageFormat ( fmt )
+{
+  writesDiscreteFiles = output->writesDiscreteFiles;
+  frameCount = 0;
+  frameSize = xSize * ySize * oaFrameFormats[ imageFormat ].bytesPerPixel;
+
+  metric = captureConf.gradeMetric;
+  mode = captureConf.gradeMode;
+  keepPercent = captureConf.gradeKeepPercent;
+  if ( keepPercent < 1 ) {
+    keepPercent = 1;
+  }
+  if ( keepPercent > 100 ) {
+    keepPercent = 100;
+  }
+  window = captureConf.gradeWindow;
+  if ( window < 1 ) {
+    window = 1;
+  }
+  threshold = captureConf.gradeThreshold;
+  numThreads = captureConf.gradeThreads;
+  if ( numThreads < 1 ) {
+    // leave a core for the camera and the preview
+    numThreads = QThread::idealThreadCount() - 1;
+  }
+  if ( numThreads < 1 ) {
+    numThreads = 1;
+  }
+  if ( numThreads > GRADE_MAX_THREADS ) {
+    numThreads = GRADE_MAX_THREADS;
+  }
+
+  // Enough slots for every worker to have one frame in progress and
+  // another waiting, plus a couple for the writer
+  numSlots = numThreads * 2 + 2;
+  slots = nullptr;
+  history = nullptr;
+  historyLength = historyNext = 0;
+  nextSeq = nextToGrade = nextToSelect = 0;
+  keptFrames = 0;
+  writeFailed = gradeFailed = stopThreads = threadsRunning = 0;
+  sidecar = nullptr;
+
+  pthread_mutex_init ( &slotMutex, 0 );
+  pthread_cond_init ( &slotFree, 0 );
+  pthread_cond_init ( &slotQueued, 0 );
+  pthread_cond_init ( &slotGraded, 0 );
+}
+
+
+OutputGrader::~OutputGrader()
+{
+  int		i;
+
+  stopAllThreads();
+  if ( slots ) {
+    for ( i = 0; i < numSlots; i++ ) {
+      free ( slots[i].frame );
+    }
+    free ( slots );
+  }
+  free ( history );
+  if ( sidecar ) {
+    fclose ( sidecar );
+  }
+  pthread_cond_destroy ( &slotGraded );
+  pthread_cond_destroy ( &slotQueued );
+  pthread_cond_destroy ( &slotFree );
+  pthread_mutex_destroy ( &slotMutex );
+  delete output;
+}
+
+
+int
+OutputGrader::outputExists ( void )
+{
+  return output->outputExists();
+}
+
+
+int
+OutputGrader::outputWritable ( void )
+{
+  return output->outputWritable();
+}
+
+
+QString
+OutputGrader::getFilename ( void )
+{
+  return output->getFilename();
+}
+
+
+QString
+OutputGrader::getNewFilename ( void )
+{
+  return output->getNewFilename();
+}
+
+
+QString
+OutputGrader::getRecordingFilename ( void )
+{
+  return output->getRecordingFilename();
+}
+
+
+QString
+OutputGrader::getRecordingBasename ( void )
+{
+  return output->getRecordingBasename();
+}
+
+
+unsigned int
+OutputGrader::getKeptFrameCount ( void )
+{
+  return keptFrames;
+}
+
+
+int
+OutputGrader::openOutput ( void )
+{
+  QString	sidecarName;
+  int		i, j;
+
+  if ( !oaGradeFormatSupported ( imageFormat )) {
+    qWarning() << "Frame grading is not supported for format" <<
+        oaFrameFormats[ imageFormat ].name;
+    return -1;
+  }
+
+  if (!( slots = static_cast<gradeSlot*> ( calloc ( numSlots,
+      sizeof ( gradeSlot ))))) {
+    return -1;
+  }
+  for ( i = 0; i < numSlots; i++ ) {
+    if (!( slots[i].frame = malloc ( frameSize ))) {
+      return -1;
+    }
+  }
+  if (!( history = static_cast<double*> ( calloc ( window,
+      sizeof ( double ))))) {
+    return -1;
+  }
+
+  if ( output->openOutput()) {
+    return -1;
+  }
+
+  sidecarName = output->getFilename() + "-grades.csv";
+  if (!( sidecar = fopen ( sidecarName.toStdString().c_str(), "w" ))) {
+    qWarning() << "can't create" << sidecarName;
+    return -1;
+  }
+  ( void ) fprintf ( sidecar, "# frame,utc,monotonic,score,kept\n" );
+
+  for ( i = 0; i < numThreads; i++ ) {
+    if ( pthread_create ( &workers[i], 0, workerThread, this )) {
+      pthread_mutex_lock ( &slotMutex );
+      stopThreads = 1;
+      pthread_cond_broadcast ( &slotQueued );
+      pthread_mutex_unlock ( &slotMutex );
+      for ( j = 0; j < i; j++ ) {
+        pthread_join ( workers[j], 0 );
+      }
+      return -1;
+    }
+  }
+  if ( pthread_create ( &selector, 0, selectorThread, this )) {
+    pthread_mutex_lock ( &slotMutex );
+    stopThreads = 1;
+    pthread_cond_broadcast ( &slotQueued );
+    pthread_mutex_unlock ( &slotMutex );
+    for ( i = 0; i < numThreads; i++ ) {
+      pthread_join ( workers[i], 0 );
+    }
+    return -1;
+  }
+  threadsRunning = 1;
+  return 0;
+}
+
+
+// Frames are copied because the camera wants its buffer back as soon as
+// the callback returns.  If all the slots are busy then this waits, which
+// pushes back on the camera exactly as a slow writer would have done.
+
+int
+OutputGrader::addFrame ( void* frame, int64_t expTime, const char* commentStr,
+    FRAME_METADATA* metadata, TIMER_METADATA* timerData )
+{
+  gradeSlot*	slot;
+
+  pthread_mutex_lock ( &slotMutex );
+  slot = &slots[ nextSeq % numSlots ];
+  while ( slot->state != SLOT_FREE && !writeFailed ) {
+    pthread_cond_wait ( &slotFree, &slotMutex );
+  }
+  if ( writeFailed ) {
+    pthread_mutex_unlock ( &slotMutex );
+    return -1;
+  }
+  slot->state = SLOT_FILLING;
+  slot->seq = nextSeq++;
+  pthread_mutex_unlock ( &slotMutex );
+
+  ( void ) memcpy ( slot->frame, frame, frameSize );
+  slot->expTime = expTime;
+  if (( slot->haveComment = ( commentStr != nullptr ))) {
+    ( void ) snprintf ( slot->comment, sizeof ( slot->comment ), "%s",
+        commentStr );
+  }
+  if (( slot->haveMetadata = ( metadata != nullptr ))) {
+    slot->metadata = *metadata;
+    // the buffer behind this will be gone by the time it's written
+    slot->metadata.dmabufValid = 0;
+  }
+  if (( slot->haveTimerData = ( timerData != nullptr ))) {
+    slot->timerData = *timerData;
+  }
+
+  pthread_mutex_lock ( &slotMutex );
+  slot->state = SLOT_QUEUED;
+  frameCount++;
+  pthread_mutex_unlock ( &slotMutex );
+  pthread_cond_signal ( &slotQueued );
+  return 0;
+}
+
+
+void
+OutputGrader::closeOutput ( void )
+{
+  stopAllThreads();
+  output->closeOutput();
+  if ( sidecar ) {
+    ( void ) fprintf ( sidecar, "# kept %u of %u frames\n", keptFrames,
+        frameCount );
+    fclose ( sidecar );
+    sidecar = nullptr;
+  }
+}
+
+
+// Let everything already queued be graded and written, then shut down
+// the threads
+
+void
+OutputGrader::stopAllThreads ( void )
+{
+  int		i;
+
+  if ( !threadsRunning ) {
+    return;
+  }
+  pthread_mutex_lock ( &slotMutex );
+  stopThreads = 1;
+  pthread_cond_broadcast ( &slotQueued );
+  pthread_cond_broadcast ( &slotGraded );
+  pthread_mutex_unlock ( &slotMutex );
+  for ( i = 0; i < numThreads; i++ ) {
+    pthread_join ( workers[i], 0 );
+  }
+  pthread_join ( selector, 0 );
+  threadsRunning = 0;
+}
+
+
+void*
+OutputGrader::workerThread ( void* param )
+{
+  OutputGrader*	self = static_cast<OutputGrader*> ( param );
+  gradeSlot*		slot;
+  void*		workspace;
+  double		score;
+  int			ret;
+
+  // big enough for any greyscale conversion of the frame
+  workspace = malloc ( self->xSize * self->ySize );
+
+  pthread_mutex_lock ( &self->slotMutex );
+  do {
+    slot = &self->slots[ self->nextToGrade % self->numSlots ];
+    if ( self->nextToGrade < self->nextSeq && slot->state == SLOT_QUEUED ) {
+      slot->state = SLOT_GRADING;
+      self->nextToGrade++;
+      pthread_mutex_unlock ( &self->slotMutex );
+
+      score = 0;
+      ret = workspace ? oaGradeFrame ( slot->frame, workspace, self->xSize,
+          self->ySize, self->imageFormat, self->metric, &score ) :
+          -OA_ERR_MEM_ALLOC;
+
+      pthread_mutex_lock ( &self->slotMutex );
+      slot->graded = ( ret == OA_ERR_NONE );
+      slot->score = score;
+      slot->state = SLOT_GRADED;
+      pthread_cond_broadcast ( &self->slotGraded );
+      continue;
+    }
+    // Only stop once there's nothing left to grade
+    if ( self->stopThreads && self->nextToGrade >= self->nextSeq ) {
+      break;
+    }
+    pthread_cond_wait ( &self->slotQueued, &self->slotMutex );
+  } while ( 1 );
+  pthread_mutex_unlock ( &self->slotMutex );
+
+  free ( workspace );
+  return 0;
+}
+
+
+// Frames are graded in any order but are written in the order they
+// arrived
+
+void*
+OutputGrader::selectorThread ( void* param )
+{
+  OutputGrader*	self = static_cast<OutputGrader*> ( param );
+  gradeSlot*		slot;
+  char		timeStr[ OA_TIMESTAMP_STRLEN ];
+  oaTimestamp		stamp;
+  unsigned long long	scoreMilli;
+  int			keep, write, ret;
+
+  pthread_mutex_lock ( &self->slotMutex );
+  do {
+    slot = &self->slots[ self->nextToSelect % self->numSlots ];
+    if ( self->nextToSelect < self->nextSeq && slot->state == SLOT_GRADED ) {
+      write = !self->writeFailed;
+      pthread_mutex_unlock ( &self->slotMutex );
+
+      keep = self->keepFrame ( slot );
+      write = write && keep;
+      ret = 0;
+      if ( write ) {
+        ret = self->output->addFrame ( slot->frame, slot->expTime,
+            slot->haveComment ? slot->comment : nullptr,
+            slot->haveMetadata ? &slot->metadata : nullptr,
+            slot->haveTimerData ? &slot->timerData : nullptr );
+      }
+
+      if ( self->sidecar ) {
+        if ( slot->haveMetadata && slot->metadata.timestampValid ) {
+          stamp = slot->metadata.timestamp;
+        } else {
+          oaTimestampNow ( &stamp );
+        }
+        if ( oaTimestampFormat ( &stamp, timeStr, OA_TIMESTAMP_STRLEN,
+            OA_TIMESTAMP_USEC )) {
+          timeStr[0] = '\0';
+        }
+        // The score is split by hand because the application's locale
+        // might have a decimal comma, which would break the CSV
+        scoreMilli = static_cast<unsigned long long>( slot->score * 1000 +
+            0.5 );
+        ( void ) fprintf ( self->sidecar, "%llu,%s,%llu,%llu.%03u,%d\n",
+            ( unsigned long long ) slot->seq, timeStr,
+            ( unsigned long long ) stamp.monotonic, scoreMilli / 1000,
+            static_cast<unsigned int>( scoreMilli % 1000 ), keep );
+      }
+
+      pthread_mutex_lock ( &self->slotMutex );
+      if ( write ) {
+        if ( ret < 0 ) {
+          self->writeFailed = 1;
+        } else {
+          self->keptFrames++;
+        }
+      }
+      slot->state = SLOT_FREE;
+      self->nextToSelect++;
+      pthread_cond_signal ( &self->slotFree );
+      continue;
+    }
+    if ( self->stopThreads && self->nextToSelect >= self->nextSeq ) {
+      break;
+    }
+    pthread_cond_wait ( &self->slotGraded, &self->slotMutex );
+  } while ( 1 );
+  // wake anyone blocked on a write that's failed
+  pthread_cond_broadcast ( &self->slotFree );
+  pthread_mutex_unlock ( &self->slotMutex );
+
+  return 0;
+}
+
+
+// In threshold mode a frame is kept if it scores at least the threshold.
+// Otherwise it's kept if it's in the best keepPercent of the last window
+// frames including itself, which follows changes in seeing and in the
+// target without having to hold frames back waiting for later ones.
+
+int
+OutputGrader::keepFrame ( gradeSlot* slot )
+{
+  unsigned int	i, better, allowed;
+
+  if ( !slot->graded ) {
+    // Better to keep a frame than lose it because it couldn't be scored
+    if ( !gradeFailed ) {
+      qWarning() << "Frame grading failed for format" <<
+          oaFrameFormats[ imageFormat ].name << "-- keeping all frames";
+      gradeFailed = 1;
+    }
+    return 1;
+  }
+
+  if ( mode == GRADE_MODE_THRESHOLD ) {
+    return slot->score >= threshold;
+  }
+
+  history[ historyNext ] = slot->score;
+  historyNext = ( historyNext + 1 ) % window;
+  if ( historyLength < static_cast<unsigned int>( window )) {
+    historyLength++;
+  }
+
+  better = 0;
+  for ( i = 0; i < historyLength; i++ ) {
+    if ( history[i] > slot->score ) {
+      better++;
+    }
+  }
+  allowed = ( historyLength * keepPercent + 99 ) / 100;
+  return better < allowed;
+}
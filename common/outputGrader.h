@@ -0,0 +1,122 @@
+/*****************************************************************************
+ *
+ * outputGrader.h -- class declaration
+ *
+ * Copyright 2026
+ *   James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#pragma once
+
+#include <pthread.h>
+#include <cstdio>
+
+extern "C" {
+#include <openastro/camera.h>
+#include <openastro/timer.h>
+}
+
+#include "outputHandler.h"
+#include "trampoline.h"
+
+#define	GRADE_MODE_BEST_PERCENT		0
+#define	GRADE_MODE_THRESHOLD			1
+
+#define	GRADE_MAX_THREADS					16
+
+// A frame waiting to be graded and then either written or discarded
+
+typedef struct {
+  int			state;
+  uint64_t		seq;
+  void*			frame;
+  int64_t		expTime;
+  int			haveComment;
+  char			comment[64];
+  int			haveMetadata;
+  FRAME_METADATA	metadata;
+  int			haveTimerData;
+  TIMER_METADATA	timerData;
+  int			graded;
+  double		score;
+} gradeSlot;
+
+// Sits in front of another output handler, scores every frame on a pool
+// of worker threads and only passes on the ones that are good enough.
+// The time and score of every frame is recorded in a sidecar file.
+
+class OutputGrader : public OutputHandler
+{
+  public:
+    			OutputGrader ( OutputHandler*, int, int, int,
+					trampolineFuncs* );
+    			~OutputGrader();
+    int			openOutput ( void );
+    int			addFrame ( void*, int64_t, const char*, FRAME_METADATA*,
+								TIMER_METADATA* );
+    void		closeOutput ( void );
+    int			outputExists ( void );
+    int			outputWritable ( void );
+    QString		getFilename ( void );
+    QString		getNewFilename ( void );
+    QString		getRecordingFilename ( void );
+    QString		getRecordingBasename ( void );
+    unsigned int	getKeptFrameCount ( void );
+
+  private:
+    OutputHandler*	output;
+    int			xSize;
+    int			ySize;
+    int			imageFormat;
+    unsigned int	frameSize;
+    int			metric;
+    int			mode;
+    int			keepPercent;
+    int			window;
+    double		threshold;
+    int			numThreads;
+    int			numSlots;
+    gradeSlot*		slots;
+    double*		history;
+    unsigned int	historyLength;
+    unsigned int	historyNext;
+    uint64_t		nextSeq;
+    uint64_t		nextToGrade;
+    uint64_t		nextToSelect;
+    unsigned int	keptFrames;
+    int			writeFailed;
+    int			gradeFailed;
+    int			stopThreads;
+    int			threadsRunning;
+    FILE*		sidecar;
+    pthread_t		workers[ GRADE_MAX_THREADS ];
+    pthread_t		selector;
+    pthread_mutex_t	slotMutex;
+    pthread_cond_t	slotFree;
+    pthread_cond_t	slotQueued;
+    pthread_cond_t	slotGraded;
+
+    static void*	workerThread ( void* );
+    static void*	selectorThread ( void* );
+    int			keepFrame ( gradeSlot* );
+    void		stopAllThreads ( void );
+};
@@ -27,6 +27,7 @@
 
 #include <oa_common.h>
 
+#include <stdio.h>
 #include <time.h>
 
 #include "commonConfig.h"
@@ -207,3 +208,37 @@ OutputHandler::getRecordingBasename ( void )
 {
   return filenameRoot;
 }
+
+
+// Frames carry a binary timestamp from the camera library.  Only the
+// writers that need text turn it into a string, and a timestamp from the
+// timer is used exactly as the timer gave it.
+
+void
+OutputHandler::formatTimestamp ( FRAME_METADATA* metadata, char* buffer,
+    int length )
+{
+  oaTimestamp	now;
+
+  if ( metadata && metadata->gpsTimeValid ) {
+    ( void ) snprintf ( buffer, length, "%s", metadata->gpsTime );
+    return;
+  }
+  if ( metadata && metadata->timestampValid ) {
+    now = metadata->timestamp;
+  } else {
+    oaTimestampNow ( &now );
+  }
+  if ( oaTimestampFormat ( &now, buffer, length, OA_TIMESTAMP_MSEC )) {
+    *buffer = '\0';
+  }
+}
+
+
+int64_t
+OutputHandler::frameTime ( FRAME_METADATA* metadata )
+{
+  // zero means "now" to the writers that take a binary time
+  return ( metadata && metadata->timestampValid ) ?
+      metadata->timestamp.utc : 0;
+}
@@ -52,15 +52,15 @@ class OutputHandler
     unsigned int	getFrameCount ( void );
 
     virtual int		openOutput() = 0;
-    virtual int		addFrame ( void*, const char*, int64_t,
-                            const char*, FRAME_METADATA*, TIMER_METADATA* ) = 0;
+    virtual int		addFrame ( void*, int64_t, const char*,
+                            FRAME_METADATA*, TIMER_METADATA* ) = 0;
     virtual void	closeOutput() = 0;
     virtual int		outputExists ( void ) = 0;
     virtual int		outputWritable ( void ) = 0;
-    QString		getFilename ( void );
-    QString		getNewFilename ( void );
-    QString		getRecordingFilename ( void );
-    QString		getRecordingBasename ( void );
+    virtual QString	getFilename ( void );
+    virtual QString	getNewFilename ( void );
+    virtual QString	getRecordingFilename ( void );
+    virtual QString	getRecordingBasename ( void );
     int			writesDiscreteFiles;
 
   protected:
@@ -68,6 +68,8 @@ class OutputHandler
     QString		fullSaveFilePath;
     QString		filenameRoot;
     void		generateFilename ( void );
+    void		formatTimestamp ( FRAME_METADATA*, char*, int );
+    int64_t		frameTime ( FRAME_METADATA* );
 		trampolineFuncs*	trampolines;
 
   private:
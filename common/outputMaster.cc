@@ -0,0 +1,169 @@
+/*****************************************************************************
+ *
+ * outputMaster.cc -- build master frames from a capture
+ *
+ * Copyright 2026
+ *   James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <oa_common.h>
+
+#include <cstdlib>
+#include <cstring>
+
+extern "C" {
+#include <openastro/camera.h>
+#include <openastro/errno.h>
+#include <openastro/imgproc.h>
+}
+
+#include "calibration.h"
+#include "calibrationSettings.h"
+#include "outputHandler.h"
+#include "outputMaster.h"
+#include "trampoline.h"
+
+
+OutputMaster::OutputMaster ( OutputHandler* out, int x, int y, int fmt,
+		trampolineFuncs* trampolines ) :
+    OutputHandler ( x, y, 0, 0, QString ( "" ), trampolines ),
+		output ( out ), xSize ( x ), ySize ( y ), imageFormat ( fmt )
+{
+  writesDiscreteFiles = output->writesDiscreteFiles;
+  frameCount = 0;
+  memset ( &builder, 0, sizeof ( builder ));
+  builder.tileFd = -1;
+  building = 0;
+  exposure = 0;
+}
+
+
+OutputMaster::~OutputMaster()
+{
+  oaMasterFree ( &builder );
+  delete output;
+}
+
+
+int
+OutputMaster::outputExists ( void )
+{
+  return output->outputExists();
+}
+
+
+int
+OutputMaster::outputWritable ( void )
+{
+  return output->outputWritable();
+}
+
+
+QString
+OutputMaster::getFilename ( void )
+{
+  return output->getFilename();
+}
+
+
+QString
+OutputMaster::getNewFilename ( void )
+{
+  return output->getNewFilename();
+}
+
+
+QString
+OutputMaster::getRecordingFilename ( void )
+{
+  return output->getRecordingFilename();
+}
+
+
+QString
+OutputMaster::getRecordingBasename ( void )
+{
+  return output->getRecordingBasename();
+}
+
+
+// Not being able to build the master isn't a reason to stop the capture,
+// so failures here are only reported
+
+int
+OutputMaster::openOutput ( void )
+{
+  if ( output->openOutput()) {
+    return -1;
+  }
+
+  masterName = output->getFilename() + "-master.fits";
+  // The median needs every frame kept, so put them on the same disk as
+  // the capture, which should have room for them
+  building = ( oaMasterInit ( &builder, xSize, ySize, imageFormat,
+      calibrationConf.masterMethod, QFileInfo ( masterName ).absolutePath().
+      toStdString().c_str(), 0, 0 ) == OA_ERR_NONE );
+  if ( !building ) {
+    qWarning() << "Can't build a master frame for this capture";
+  }
+  return 0;
+}
+
+
+int
+OutputMaster::addFrame ( void* frame, int64_t expTime, const char* commentStr,
+    FRAME_METADATA* metadata, TIMER_METADATA* timerData )
+{
+  if ( building ) {
+    if ( oaMasterAddFrame ( &builder, frame ) != OA_ERR_NONE ) {
+      qWarning() << "Adding frame to master failed";
+      oaMasterFree ( &builder );
+      building = 0;
+    }
+    exposure = expTime;
+  }
+  frameCount++;
+  return output->addFrame ( frame, expTime, commentStr, metadata,
+      timerData );
+}
+
+
+void
+OutputMaster::closeOutput ( void )
+{
+  uint16_t*	master;
+
+  output->closeOutput();
+  if ( !building || !builder.numFrames ) {
+    return;
+  }
+  if (( master = static_cast<uint16_t*>( malloc ( xSize * ySize *
+      sizeof ( uint16_t ))))) {
+    if ( oaMasterFinish ( &builder, master, 0 ) == OA_ERR_NONE ) {
+      ( void ) Calibration::writeMaster ( masterName, master, xSize, ySize,
+          exposure, builder.numFrames );
+    }
+    free ( master );
+  }
+  oaMasterFree ( &builder );
+  building = 0;
+}
@@ -0,0 +1,70 @@
+/*****************************************************************************
+ *
+ * outputMaster.h -- class declaration for building master frames from a capture
+ *
+ * Copyright 2026
+ *   James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#pragma once
+
+extern "C" {
+#include <openastro/camera.h>
+#include <openastro/imgproc.h>
+#include <openastro/timer.h>
+}
+
+#include "outputHandler.h"
+#include "trampoline.h"
+
+// Sits in front of another output handler, passing every frame on while
+// folding it into a master frame that is written as FITS alongside the
+// capture when it is closed.  Only running statistics are kept, so any
+// number of frames can be combined.
+
+class OutputMaster : public OutputHandler
+{
+  public:
+    			OutputMaster ( OutputHandler*, int, int, int,
+					trampolineFuncs* );
+    			~OutputMaster();
+    int			openOutput ( void );
+    int			addFrame ( void*, int64_t, const char*, FRAME_METADATA*,
+								TIMER_METADATA* );
+    void		closeOutput ( void );
+    int			outputExists ( void );
+    int			outputWritable ( void );
+    QString		getFilename ( void );
+    QString		getNewFilename ( void );
+    QString		getRecordingFilename ( void );
+    QString		getRecordingBasename ( void );
+
+  private:
+    OutputHandler*	output;
+    int			xSize;
+    int			ySize;
+    int			imageFormat;
+    oaMasterBuilder	builder;
+    int			building;
+    int64_t		exposure;
+    QString		masterName;
+};
@@ -162,7 +162,6 @@ OutputNamedPipe::openOutput ( void )
 
 int
 OutputNamedPipe::addFrame ( void* frame,
-		const char* timestampStr __attribute__((unused)),
     int64_t expTime __attribute__((unused)),
 		const char* commentStr __attribute__((unused)),
 		FRAME_METADATA* metadata __attribute__((unused)),
@@ -37,8 +37,8 @@ class OutputNamedPipe : public OutputHandler
 							QString, trampolineFuncs* );
     			~OutputNamedPipe();
     int			openOutput ( void );
-    int			addFrame ( void*, const char*, int64_t, const char*,
-								FRAME_METADATA*, TIMER_METADATA* );
+    int			addFrame ( void*, int64_t, const char*, FRAME_METADATA*,
+								TIMER_METADATA* );
     void		closeOutput ( void );
     int			outputExists ( void );
     int			outputWritable ( void );
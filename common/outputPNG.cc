@@ -186,9 +186,8 @@ OutputPNG::openOutput ( void )
 
 
 int
-OutputPNG::addFrame ( void* frame, const char* timestampStr,
-    int64_t expTime, const char* commentStr, FRAME_METADATA* metadata,
-		TIMER_METADATA* timerData )
+OutputPNG::addFrame ( void* frame, int64_t expTime, const char* commentStr,
+		FRAME_METADATA* metadata, TIMER_METADATA* timerData )
 {
   int			i;
   FILE*			handle;
@@ -200,6 +199,7 @@ OutputPNG::addFrame ( void* frame, const char* timestampStr,
   int			numComments = 0;
   char			stringBuffs[30][ PNG_KEYWORD_MAX_LENGTH + 1 ];
   int       xorg, yorg;
+  char			timestampStr[ OA_TIMESTAMP_STRLEN ];
 
   filenameRoot = getNewFilename();
   fullSaveFilePath = filenameRoot + ".png";
@@ -250,8 +250,9 @@ OutputPNG::addFrame ( void* frame, const char* timestampStr,
   // the constructor and just the ones that can change per frame handled
   // here?
 
+  formatTimestamp ( metadata, timestampStr, OA_TIMESTAMP_STRLEN );
   pngComments[ numComments ].key = const_cast<char *>( "DATE-OBS" );
-  pngComments[ numComments ].text = const_cast<char *>( timestampStr );
+  pngComments[ numComments ].text = timestampStr;
   numComments++;
 
   pngComments[ numComments ].key = const_cast<char *>( "OBSERVER" );
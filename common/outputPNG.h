@@ -41,8 +41,8 @@ class OutputPNG : public OutputHandler
 							QString, trampolineFuncs* );
     			~OutputPNG();
     int			openOutput ( void );
-    int			addFrame ( void*, const char*, int64_t, const char*,
-								FRAME_METADATA*, TIMER_METADATA* );
+    int			addFrame ( void*, int64_t, const char*, FRAME_METADATA*,
+								TIMER_METADATA* );
     void		closeOutput ( void );
     int			outputExists ( void );
     int			outputWritable ( void );
@@ -236,15 +236,15 @@ OutputSER::openOutput ( void )
 
 
 int
-OutputSER::addFrame ( void* frame, const char* timestampStr,
+OutputSER::addFrame ( void* frame,
 		int64_t expTime __attribute__((unused)),
     const char* commentStr __attribute__((unused)),
-		FRAME_METADATA* metadata __attribute__((unused)),
+		FRAME_METADATA* metadata,
 		TIMER_METADATA* timerData __attribute__((unused)))
 {
   int ret;
 
-  ret = oaSERWriteFrame ( &SERContext, frame, timestampStr );
+  ret = oaSERWriteFrame ( &SERContext, frame, frameTime ( metadata ));
   if ( ret ) {
     qWarning() << "oaSERWriteFrame failed";
   }
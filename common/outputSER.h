@@ -40,8 +40,8 @@ class OutputSER : public OutputHandler
     			OutputSER ( int, int, int, int, int, QString, trampolineFuncs* );
     			~OutputSER();
     int			openOutput ( void );
-    int			addFrame ( void*, const char*, int64_t, const char*,
-								FRAME_METADATA*, TIMER_METADATA* );
+    int			addFrame ( void*, int64_t, const char*, FRAME_METADATA*,
+								TIMER_METADATA* );
     void		closeOutput ( void );
     int			outputExists ( void );
     int			outputWritable ( void );
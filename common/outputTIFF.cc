@@ -177,9 +177,9 @@ OutputTIFF::openOutput ( void )
 
 
 int
-OutputTIFF::addFrame ( void* frame, const char* timestampStr,
+OutputTIFF::addFrame ( void* frame,
 		int64_t expTime __attribute__((unused)), const char* commentStr,
-		FRAME_METADATA* metadata __attribute__((unused)),
+		FRAME_METADATA* metadata,
 		TIMER_METADATA* timerData __attribute__((unused)))
 {
   int            ret, i;
@@ -188,6 +188,7 @@ OutputTIFF::addFrame ( void* frame, const char* timestampStr,
   unsigned char* s;
   unsigned char* t;
 	char						tiffField[128];
+	char						timestampStr[ OA_TIMESTAMP_STRLEN ];
 
   filenameRoot = getNewFilename();
   fullSaveFilePath = filenameRoot + ".tiff";
@@ -217,6 +218,7 @@ OutputTIFF::addFrame ( void* frame, const char* timestampStr,
 	( void ) snprintf ( tiffField, 128, "%s %s", applicationName,
 			applicationVersion );
   TIFFSetField ( handle, TIFFTAG_SOFTWARE, tiffField );
+  formatTimestamp ( metadata, timestampStr, OA_TIMESTAMP_STRLEN );
   TIFFSetField ( handle, TIFFTAG_DATETIME, timestampStr );
   if ( commentStr && *commentStr ) {
     TIFFSetField ( handle, TIFFTAG_IMAGEDESCRIPTION, commentStr );
@@ -41,6 +41,7 @@
 #include "autorunSettings.h"
 #include "histogramSettings.h"
 #include "demosaicSettings.h"
+#include "calibrationSettings.h"
 
 
 SettingsWidget::SettingsWidget ( QWidget* parent, QString appName,
@@ -107,6 +108,12 @@ SettingsWidget::SettingsWidget ( QWidget* parent, QString appName,
     commonState.fitsSettingsIndex = tabSet->addTab ( fits,
         QIcon ( ":/qt-icons/fits.png" ), tr ( "FITS/SER Metadata" ));
 	}
+	if ( reqdWindows & SETTINGS_CALIBRATION ) {
+    calibration = new CalibrationSettings ( this, videoFormats,
+        trampolines );
+    commonState.calibrationSettingsIndex = tabSet->addTab ( calibration,
+        QIcon ( ":/qt-icons/fits.png" ), tr ( "Calibration" ));
+	}
 	if ( reqdWindows & SETTINGS_TIMER ) {
     timer = new TimerSettings ( this, applicationName, trampolines );
     commonState.timerSettingsIndex = tabSet->addTab ( timer,
@@ -181,6 +188,9 @@ SettingsWidget::storeSettings ( void )
 	}
 	if ( reqdWindows & SETTINGS_FITS ) {
     fits->storeSettings();
+	}
+	if ( reqdWindows & SETTINGS_CALIBRATION ) {
+    calibration->storeSettings();
 	}
 	if ( reqdWindows & SETTINGS_TIMER ) {
     timer->storeSettings();
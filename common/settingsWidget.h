@@ -46,6 +46,7 @@
 #include "timerSettings.h"
 #include "demosaicSettings.h"
 #include "fitsSettings.h"
+#include "calibrationSettings.h"
 
 /*
 #define	SETTINGS_GENERAL		0x0001
@@ -58,6 +59,7 @@
 #define	SETTINGS_TIMER			0x0080
 #define	SETTINGS_DEMOSAIC		0x0100
 #define	SETTINGS_FITS				0x0200
+#define	SETTINGS_CALIBRATION	0x0400
 */
 #define	SETTINGS_GENERAL		0x0001
 #define	SETTINGS_CAPTURE		0x0002
@@ -69,10 +71,11 @@
 #define	SETTINGS_TIMER			0x0080
 #define	SETTINGS_DEMOSAIC		0x0100
 #define	SETTINGS_FITS				0x0200
+#define	SETTINGS_CALIBRATION	0x0400
 
 
-#define OACAPTURE_SETTINGS	0x03ff
-#define	OALIVE_SETTINGS			0x031b
+#define OACAPTURE_SETTINGS	0x07ff
+#define	OALIVE_SETTINGS			0x071b
 
 
 class SettingsWidget : public QWidget
@@ -109,6 +112,7 @@ class SettingsWidget : public QWidget
     FilterSettings*	filters;
     DemosaicSettings*	demosaic;
     FITSSettings*	fits;
+    CalibrationSettings*	calibration;
     QVBoxLayout*	vbox;
     QTabWidget*		tabSet;
     QHBoxLayout*	buttonBox;
@@ -77,8 +77,12 @@ typedef struct {
 
 extern int  oaSEROpen ( const char*, oaSERContext* );
 extern int  oaSERWriteHeader ( oaSERContext*, oaSERHeader* );
-extern int  oaSERWriteFrame ( oaSERContext*, void*, const char* );
+extern int  oaSERWriteFrame ( oaSERContext*, void*, int64_t );
 extern int  oaSERWriteTrailer ( oaSERContext* );
 extern int  oaSERClose ( oaSERContext* );
 
+extern int  oaSEROpenRead ( const char*, oaSERContext*, oaSERHeader* );
+extern int  oaSERReadFrame ( oaSERContext*, void* );
+extern int  oaSERRewind ( oaSERContext* );
+
 #endif	/* OPENASTRO_SER_H */
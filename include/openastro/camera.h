@@ -32,6 +32,10 @@
 #include <openastro/openastro.h>
 #include <openastro/camera/controls.h>
 #include <openastro/camera/features.h>
+#include <openastro/camera/stats.h>
+#include <openastro/camera/session.h>
+#include <openastro/camera/dummy.h>
+#include <openastro/timestamp.h>
 #include <openastro/video/formats.h>
 
 enum oaCameraInterfaceType {
@@ -93,8 +97,14 @@ typedef struct FRAMERATES {
 typedef struct FRAME_METADATA {
 	unsigned int		frameCounterValid : 1;
 	unsigned int		gpsTimeValid : 1;
+	unsigned int		dmabufValid : 1;
+	unsigned int		timestampValid : 1;
 	unsigned int		frameCounter;
 	char						gpsTime[ 64 ];
+	// Time at which the frame data became available from the camera
+	oaTimestamp			timestamp;
+	// DMABUF handle for the frame buffer, valid until the callback returns
+	int							dmabufFd;
 } FRAME_METADATA;
 
 struct oaCamera;
@@ -109,6 +119,10 @@ typedef struct oaCameraFuncs {
   int              ( *readControl )( struct oaCamera*, int, oaControlValue* );
   int              ( *setControl )( struct oaCamera*, int, oaControlValue*,
                        int );
+  int              ( *setControlAsync )( struct oaCamera*, int,
+                       oaControlValue*, void (*)( void*, int ), void* );
+  int              ( *setControls )( struct oaCamera*, int, const int*,
+                       const oaControlValue*, void (*)( void*, int ), void* );
   int              ( *testControl )( struct oaCamera*, int, oaControlValue* );
   int              ( *getControlRange )( struct oaCamera*, int, int64_t*,
                        int64_t*, int64_t*, int64_t* );
@@ -138,6 +152,7 @@ typedef struct oaCameraFuncs {
   int              ( *getAutoWBManualSetting )( struct oaCamera* );
   int              ( *hasAuto )( struct oaCamera*, int );
   int              ( *isAuto )( struct oaCamera*, int );
+  int              ( *setControlMaxAge )( struct oaCamera*, int, uint64_t );
 
 	int								( *startExposure )( struct oaCamera*,
                        void* (*)(void*, void*, int, void* ), void* );
@@ -185,6 +200,21 @@ typedef struct oaCameraDevice {
 extern int		oaGetCameras ( oaCameraDevice***, unsigned long );
 
 extern void		oaReleaseCameras ( oaCameraDevice** );
+
+/**
+ * @brief Force the next oaGetCameras() call to rescan all interfaces
+ *
+ * The camera list is normally cached until a hotplug event suggests it
+ * may have changed.  This discards the cached list regardless.
+ */
+extern void		oaInvalidateCameraList ( void );
+
+/**
+ * @brief Set how long any single interface may take to enumerate cameras
+ *
+ * @param msec [in] timeout in milliseconds, or 0 to restore the default
+ */
+extern void		oaSetCameraEnumerationTimeout ( unsigned int );
 extern unsigned		oaGetCameraAPIVersion ( void );
 extern const char*	oaGetCameraAPIVersionStr ( void );
 extern int		oaGetAutoForControl ( int );
@@ -194,6 +224,62 @@ extern int		oaIsAuto ( int );
 extern int		oaIsOnOff ( int );
 extern void		oaSetRootPath ( const char* );
 
+/**
+ * @brief Fetch latency and throughput statistics for a camera
+ *
+ * Percentiles are calculated over the most recent frames only.  Counters
+ * and histograms cover everything since the camera was initialised or
+ * oaResetFrameStats() was last called.
+ */
+extern int		oaGetFrameStats ( oaCamera*, oaFrameStats* );
+extern int		oaResetFrameStats ( oaCamera* );
+
+/**
+ * @brief Write the per-frame timestamps for the most recent frames to a
+ * CSV file
+ */
+extern int		oaWriteFrameStatsCSV ( oaCamera*, const char* );
+
+// Software binning, for cameras that can't bin (or can't bin enough) in
+// hardware.  Colour filter data binned by an even factor becomes RGB, with
+// one pixel for each block, unless OA_SOFT_BIN_MONO is given.
+
+#define	OA_SOFT_BIN_MAX_FACTOR		4
+
+#define	OA_SOFT_BIN_AVERAGE				0x00
+#define	OA_SOFT_BIN_SUM						0x01
+#define	OA_SOFT_BIN_MONO					0x02
+
+/**
+ * @brief Bin frames in software before they are handed to the frame
+ * callback
+ *
+ * The factor is from 1 (off) to OA_SOFT_BIN_MAX_FACTOR.  Frames in formats
+ * that can't be binned are passed through unchanged.
+ *
+ * This is library API only: none of the applications here turn it on.  An
+ * application that does must size and format its displays and output
+ * files from oaGetSoftwareBinnedFormat() rather than from the camera's
+ * own frame size and format.
+ */
+extern int		oaSetSoftwareBinning ( oaCamera*, int, int );
+
+/**
+ * @brief Get the pixel format and size of the frames the callback will be
+ * given once software binning has been applied
+ */
+extern int		oaGetSoftwareBinnedFormat ( oaCamera*, int*, unsigned int*,
+								unsigned int* );
+
+/**
+ * @brief Check whether setROI() will crop frames in software because the
+ * camera can't do so itself
+ *
+ * A software ROI is set and tested with setROI() and testROISize() in the
+ * same way as a hardware one and is centred in the frame.
+ */
+extern int		oaHasSoftwareROI ( oaCamera* );
+
 // FIX ME -- These may no longer be required
 
 #define OA_FRAMESIZES_DISCRETE		1
@@ -154,8 +154,16 @@
 #define	OA_CAM_CTRL_CONVERSION_GAIN						118
 #define	OA_CAM_CTRL_BULB_MODE									119
 #define	OA_CAM_CTRL_BRIGHTNESS_TARGET					120
+#define	OA_CAM_CTRL_FRAME_BUFFERS							121
+#define	OA_CAM_CTRL_PACKET_SIZE								122
+#define	OA_CAM_CTRL_PACKET_DELAY							123
+#define	OA_CAM_CTRL_SOCKET_BUFFER_SIZE				124
+#define	OA_CAM_CTRL_PACKET_RESEND							125
+#define	OA_CAM_CTRL_FRAMES_COMPLETED					126
+#define	OA_CAM_CTRL_FRAMES_FAILED							127
+#define	OA_CAM_CTRL_PACKETS_RESENT						128
 // Adding more items here may require updating liboacam/control.c
-#define	OA_CAM_CTRL_LAST_P1										OA_CAM_CTRL_BRIGHTNESS_TARGET+1
+#define	OA_CAM_CTRL_LAST_P1										OA_CAM_CTRL_PACKETS_RESENT+1
 
 // Adding more here will need camera.h and oacamprivate.h changing to make
 // the array bigger and require the the OA_CAM_CTRL_MODIFIER define
@@ -0,0 +1,86 @@
+/*****************************************************************************
+ *
+ * dummy.h -- configuration of the dummy camera as a synthetic image source
+ *
+ * Copyright 2026 James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#ifndef OPENASTRO_CAMERA_DUMMY_H
+#define OPENASTRO_CAMERA_DUMMY_H
+
+#define	OA_DUMMY_SCENE_STARS		1
+#define	OA_DUMMY_SCENE_PLANET		2
+#define	OA_DUMMY_SCENE_SER			3
+
+#define	OA_DUMMY_MODE_PACED			0	// deliver frames at frameRate
+#define	OA_DUMMY_MODE_ASAP			1	// deliver frames as fast as possible
+
+// Environment variable holding a configuration string for the dummy
+// camera.  If it is set the dummy cameras are enumerated.
+
+#define	OA_DUMMY_CAMERA_ENV			"OA_DUMMY_CAMERA"
+
+#define	OA_DUMMY_MAX_PATH				4096
+
+typedef struct oaDummyConfig {
+	int						scene;
+	int						format;			// OA_PIX_FMT_*
+	unsigned int	xSize;
+	unsigned int	ySize;
+	double				frameRate;	// fps, 0 to use the exposure time
+	int						mode;
+	unsigned int	seed;
+	unsigned int	numStars;
+	double				seeing;			// star FWHM in pixels
+	double				jitter;			// RMS image motion in pixels
+	unsigned int	noise;			// RMS noise, in 16-bit units
+	char					serFile[ OA_DUMMY_MAX_PATH ];
+} oaDummyConfig;
+
+/**
+ * @brief Fill in the default synthetic source configuration
+ */
+extern void		oaDummyDefaultConfig ( oaDummyConfig* );
+
+/**
+ * @brief Parse a configuration string into a config structure
+ *
+ * The string is a comma-separated list of key=value pairs, for example
+ * "scene=stars,size=1920x1080,format=GREY12P,fps=200,mode=asap".  Keys
+ * are scene (stars, planet or ser), size, format (the OA_PIX_FMT_ suffix
+ * of an 8, 10, 12 or 16-bit mono or Bayer format, eg. GREY12P or RGGB16LE),
+ * fps, mode (paced or asap), seed, stars, seeing, jitter, noise and ser
+ * (path to a file to replay, which implies scene=ser).  Anything not given
+ * keeps its current value.
+ */
+extern int		oaDummyParseConfig ( const char*, oaDummyConfig* );
+
+/**
+ * @brief Set the configuration used by the "Synthetic camera" dummy device
+ *
+ * This also enables enumeration of the dummy cameras.  Cameras already
+ * initialised are not affected.  Passing a null pointer disables them
+ * again unless the environment variable is set.
+ */
+extern int		oaDummySetConfig ( const oaDummyConfig* );
+
+#endif	/* OPENASTRO_CAMERA_DUMMY_H */
@@ -0,0 +1,98 @@
+/*****************************************************************************
+ *
+ * session.h -- running several cameras together
+ *
+ * Copyright 2026 James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#ifndef OPENASTRO_CAMERA_SESSION_H
+#define OPENASTRO_CAMERA_SESSION_H
+
+#include <stdint.h>
+
+struct oaCamera;
+struct FRAME_METADATA;
+
+// A session streams from two or more cameras at once.  Each camera keeps
+// its own buffers, controller thread and callback thread, so a slow
+// consumer on one camera never holds up another.  All frames are stamped
+// against a single monotonic clock that starts when the session does, so
+// frames from different cameras can be matched up afterwards.
+
+#define	OA_SESSION_MAX_CAMERAS			16
+
+typedef struct oaSessionFrame {
+	unsigned int						cameraIndex;	// order in which cameras were added
+	uint64_t								sequence;			// frames from this camera so far
+	uint64_t								sessionTime;	// ns since oaSessionStart()
+	struct FRAME_METADATA*	metadata;			// from the driver, may be NULL
+} oaSessionFrame;
+
+// Called on the camera's own callback thread with the callback argument
+// given to oaSessionAddCamera(), the frame buffer and its length, and the
+// session information for the frame.  The return value is ignored.
+
+typedef void*	( *oaSessionCallback )( void*, void*, int, oaSessionFrame* );
+
+struct oaCameraSession;
+typedef struct oaCameraSession oaCameraSession;
+
+/**
+ * @brief Create an empty session
+ */
+extern oaCameraSession*	oaSessionCreate ( void );
+
+/**
+ * @brief Add an initialised camera to a session that is not running
+ *
+ * @return the index of the camera in the session, or a negative error
+ */
+extern int		oaSessionAddCamera ( oaCameraSession*, struct oaCamera*,
+									oaSessionCallback, void* );
+
+/**
+ * @brief Start the session clock and stream from every camera
+ *
+ * If any camera fails to start, those already started are stopped again.
+ */
+extern int		oaSessionStart ( oaCameraSession* );
+
+/**
+ * @brief Stop streaming from every camera in the session
+ */
+extern int		oaSessionStop ( oaCameraSession* );
+
+/**
+ * @brief Nanoseconds on the session clock, or 0 if it is not running
+ */
+extern uint64_t	oaSessionTime ( oaCameraSession* );
+
+/**
+ * @brief Stop the session if necessary and free it
+ *
+ * The cameras are not closed, but as a driver may still hand over frames
+ * it had already queued when streaming stopped, the session should not be
+ * freed until its cameras have been closed.
+ */
+extern void		oaSessionFree ( oaCameraSession* );
+
+#endif	/* OPENASTRO_CAMERA_SESSION_H */
@@ -0,0 +1,75 @@
+/*****************************************************************************
+ *
+ * stats.h -- per-frame latency and throughput statistics
+ *
+ * Copyright 2026 James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#ifndef OPENASTRO_CAMERA_STATS_H
+#define OPENASTRO_CAMERA_STATS_H
+
+#include <stdint.h>
+
+// Points in the life of a frame at which a timestamp is taken
+
+#define	OA_FRAME_STAGE_READOUT				0	// data available from the camera
+#define	OA_FRAME_STAGE_COPIED					1	// data is in the frame buffer
+#define	OA_FRAME_STAGE_QUEUED					2	// frame is on the callback queue
+#define	OA_FRAME_STAGE_CALLBACK				3	// user callback entered
+#define	OA_FRAME_STAGE_RETURNED				4	// user callback returned
+#define	OA_FRAME_STAGE_REQUEUED				5	// buffer is available again
+#define	OA_FRAME_STAGES								6
+
+// Intervals between stages.  Interval n for n > 0 is the time from stage
+// n-1 to stage n.  Interval 0 is the time from readout to requeue.
+
+#define	OA_FRAME_INTERVAL_TOTAL				0
+#define	OA_FRAME_INTERVAL_COPY				1
+#define	OA_FRAME_INTERVAL_QUEUE				2
+#define	OA_FRAME_INTERVAL_WAIT				3
+#define	OA_FRAME_INTERVAL_CALLBACK		4
+#define	OA_FRAME_INTERVAL_REQUEUE			5
+#define	OA_FRAME_INTERVALS						6
+
+// Histogram bin n counts intervals of at least 2^n and less than 2^(n+1)
+// nanoseconds.  The last bin also counts anything longer.
+
+#define	OA_FRAME_STATS_BINS						32
+
+typedef struct oaFrameStats {
+	uint64_t		frames;
+	uint64_t		droppedFrames;
+	uint64_t		callbackOverruns;
+	uint64_t		callbackOverrunTime;	// nanoseconds
+	unsigned int	queueDepth;
+	unsigned int	maxQueueDepth;
+	double			fps;
+	uint64_t		p50[ OA_FRAME_INTERVALS ];		// nanoseconds
+	uint64_t		p90[ OA_FRAME_INTERVALS ];
+	uint64_t		p99[ OA_FRAME_INTERVALS ];
+	uint64_t		max[ OA_FRAME_INTERVALS ];
+	uint64_t		histogram[ OA_FRAME_INTERVALS ][ OA_FRAME_STATS_BINS ];
+} oaFrameStats;
+
+extern const char*	oaFrameIntervalLabel[ OA_FRAME_INTERVALS ];
+
+#endif	/* OPENASTRO_CAMERA_STATS_H */
@@ -54,5 +54,6 @@
 #define	OA_ERR_SYMBOL_NOT_FOUND	23
 #define	OA_ERR_NOT_READABLE	24
 #define OA_ERR_NOT_WRITEABLE	25
+#define OA_ERR_SUPERSEDED	26
 
 #endif	/* OPENASTRO_ERRNO_H */
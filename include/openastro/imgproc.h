@@ -27,8 +27,265 @@
 #ifndef OPENASTRO_IMGPROC_H
 #define OPENASTRO_IMGPROC_H
 
+#include <stdint.h>
+
+// Focus scoring.  A context holds the workspace for scoring frames of one
+// size and format so that no memory is allocated per frame.
+
+typedef struct {
+  int		xSize;
+  int		ySize;
+  int		frameFormat;
+  int		workX;			// size of the image actually scored
+  int		workY;
+  int		fullScale;		// maximum luminance value
+  int		greenOffset;		// for raw colour
+  int		roiX;			// in frame pixels, zero size for all
+  int		roiY;
+  int		roiWidth;
+  int		roiHeight;
+  int		x0;			// in scored image pixels
+  int		y0;
+  int		x1;
+  int		y1;
+  void*		workspace;
+} oaFocusContext;
+
+extern int	oaFocusInit ( oaFocusContext*, int, int, int );
+extern int	oaFocusSetROI ( oaFocusContext*, int, int, int, int );
+extern int	oaFocusScoreFrame ( oaFocusContext*, void*, void*, double* );
+extern void	oaFocusFree ( oaFocusContext* );
 extern int	oaFocusScore ( void*, void*, int, int, int );
 
+// Frame grading metrics for lucky imaging
+
+#define	OA_GRADE_SOBEL				1	// mean Sobel gradient energy
+#define	OA_GRADE_LAPLACIAN		2	// variance of the Laplacian
+#define	OA_GRADE_PLANET				3	// Sobel energy limited to a bright disc
+
+extern int	oaGradeFrame ( void*, void*, int, int, int, int, double* );
+extern int	oaGradeFormatSupported ( int );
+
+// Exact histograms with a bin for every possible pixel value
+
+#define	OA_HISTOGRAM_GREY		0
+#define	OA_HISTOGRAM_RED		0
+#define	OA_HISTOGRAM_GREEN		1
+#define	OA_HISTOGRAM_BLUE		2
+
+#define	OA_HISTOGRAM_MAX_CHANNELS	3
+#define	OA_HISTOGRAM_MAX_THREADS	8
+
+typedef struct {
+  unsigned int		min;
+  unsigned int		max;
+  double		mean;
+  unsigned int		median;
+  unsigned int		low;		// 0.1 percentile
+  unsigned int		high;		// 99.9 percentile
+  uint64_t		pixels;
+  uint64_t		saturated;	// pixels at full scale
+} oaHistogramStats;
+
+typedef struct {
+  int			xSize;
+  int			ySize;
+  int			frameFormat;
+  int			numChannels;
+  int			numBins;
+  unsigned int		fullScale;
+  int			bytesPerSample;
+  int			numThreads;
+  int			subHistograms;
+  int			cfa[2][2];
+  uint32_t*		bins[ OA_HISTOGRAM_MAX_CHANNELS ];
+  oaHistogramStats	stats[ OA_HISTOGRAM_MAX_CHANNELS ];
+  void*			workspace;
+} oaHistogram;
+
+extern int		oaHistogramInit ( oaHistogram*, int, int, int, int );
+extern int		oaHistogramProcess ( oaHistogram*, void* );
+extern unsigned int	oaHistogramPercentile ( oaHistogram*, int, double );
+extern void		oaHistogramFree ( oaHistogram* );
+
+// Calibration of raw mono or colour frames with master bias, dark and
+// flat frames
+
+#define	OA_CALIBRATION_MAX_THREADS	8
+
+typedef struct {
+  int			xSize;
+  int			ySize;
+  int			frameFormat;
+  unsigned int		numPixels;
+  int			bytesPerSample;
+  unsigned int		maxValue;
+  int			nativeOrder;
+  int			numThreads;
+  uint16_t*		bias;
+  uint16_t*		dark;
+  int64_t		darkExposure;
+  int			scaleDark;
+  uint16_t*		invFlat;	// 4.12 fixed point
+  uint16_t*		offset;		// bias and dark combined
+  int64_t		offsetExposure;
+} oaCalibration;
+
+extern int	oaCalibrationInit ( oaCalibration*, int, int, int, int );
+extern int	oaCalibrationSetBias ( oaCalibration*, const uint16_t* );
+extern int	oaCalibrationSetDark ( oaCalibration*, const uint16_t*, int64_t,
+								int );
+extern int	oaCalibrationSetFlat ( oaCalibration*, const uint16_t* );
+extern int	oaCalibrationApply ( oaCalibration*, void*, int64_t );
+extern void	oaCalibrationFree ( oaCalibration* );
+
+#define	OA_MASTER_MEAN			0
+#define	OA_MASTER_MINMAX		1	// mean without each pixel's extremes
+#define	OA_MASTER_MEDIAN		2
+
+#define	OA_MASTER_MAX_THREADS		8
+
+typedef struct {
+  int			xSize;
+  int			ySize;
+  int			frameFormat;
+  int			method;
+  unsigned int		numPixels;
+  int			bytesPerSample;
+  int			nativeOrder;
+  int			numThreads;
+  unsigned int		numFrames;
+  float*		mean;
+  float*		m2;		// Welford sum of squared differences
+  uint16_t*		min;
+  uint16_t*		max;
+  int			tileFd;
+  void*			tileBuffer;
+  size_t		memoryLimit;
+} oaMasterBuilder;
+
+extern int	oaMasterInit ( oaMasterBuilder*, int, int, int, int,
+								const char*, size_t, int );
+extern int	oaMasterAddFrame ( oaMasterBuilder*, const void* );
+extern int	oaMasterFinish ( oaMasterBuilder*, uint16_t*, float* );
+extern void	oaMasterFree ( oaMasterBuilder* );
+
+#define	OA_HOTPIXEL_MAX_DETECT_FRAMES	255
+
+typedef struct {
+  int			xSize;
+  int			ySize;
+  int			frameFormat;
+  int			bytesPerSample;
+  int			nativeOrder;
+  int			step;		// distance to same-colour neighbours
+  unsigned int		numDefects;
+  uint32_t*		offsets;	// sorted
+  unsigned int		detectFrames;
+  uint8_t*		hits;		// per pixel, while auto-detecting
+} oaHotPixelMap;
+
+extern int	oaHotPixelInit ( oaHotPixelMap*, int, int, int );
+extern int	oaHotPixelFromDark ( oaHotPixelMap*, const uint16_t*, double );
+extern int	oaHotPixelDetectFrame ( oaHotPixelMap*, const void*, double );
+extern int	oaHotPixelDetectFinish ( oaHotPixelMap*, double );
+extern int	oaHotPixelSetList ( oaHotPixelMap*, const uint32_t*,
+								unsigned int );
+extern int	oaHotPixelIsDefect ( oaHotPixelMap*, uint32_t );
+extern int	oaHotPixelCorrect ( oaHotPixelMap*, void* );
+extern void	oaHotPixelFree ( oaHotPixelMap* );
+
+// Translation-only registration of mono or full colour frames against a
+// reference frame
+
+#define	OA_REGISTER_MAX_THREADS		8
+#define	OA_REGISTER_MAX_FFT_SIZE	1024
+
+typedef struct {
+  int			xSize;
+  int			ySize;
+  int			frameFormat;
+  int			channels;
+  int			bytesPerSample;
+  int			nativeOrder;
+  int			numThreads;
+  int			fftSize;
+  int			binning;	// of the coarse correlation window
+  int			coarseX;
+  int			coarseY;
+  int			fineX;
+  int			fineY;
+  int			haveReference;
+  double		peak;		// of the last correlation, 0 to 1
+  int			refined;	// last offset found at full resolution
+  float*		window;
+  float*		twiddle;
+  unsigned int*		bitReverse;
+  float*		refCoarse;	// reference spectra
+  float*		refFine;
+  float*		work;
+  float*		column;
+} oaRegistration;
+
+extern int	oaRegistrationInit ( oaRegistration*, int, int, int, int, int );
+extern int	oaRegistrationSetReference ( oaRegistration*, const void* );
+extern int	oaRegistrationMeasure ( oaRegistration*, const void*, double,
+								double*, double* );
+extern int	oaRegistrationShift ( oaRegistration*, const void*, void*,
+								double, double );
+extern void	oaRegistrationFree ( oaRegistration* );
+
+// Star detection on mono frames or the green pixels of raw colour frames
+
+#define	OA_STARS_MAX_THREADS		8
+
+typedef struct {
+  double		x;		// intensity weighted centroid
+  double		y;
+  double		flux;		// above the background
+  double		peak;
+  double		fwhm;
+  double		hfr;
+  unsigned int		area;		// in detection image pixels
+  int			saturated;
+} oaStar;
+
+typedef struct {
+  int			xSize;
+  int			ySize;
+  int			frameFormat;
+  int			workX;		// size of the detection image
+  int			workY;
+  int			scale;		// frame pixels per detection pixel
+  int			greenOffset;	// for raw colour
+  int			saturation;
+  int			numThreads;
+  double		sigmas;
+  unsigned int		minArea;
+  unsigned int		maxArea;
+  unsigned int		maxStars;
+  unsigned int		numStars;
+  oaStar*		stars;		// brightest first
+  double		medianFWHM;	// of the unsaturated stars
+  double		medianHFR;
+  int			gridX;		// background cells
+  int			gridY;
+  float*		background;
+  float*		noise;
+  double*		scratch;
+  void*			jobs;
+  void*			runs;
+  void*			candidates;
+  unsigned int		runSpace;
+} oaStarDetector;
+
+extern int	oaStarsInit ( oaStarDetector*, int, int, int, unsigned int,
+								int );
+extern int	oaStarsSetLimits ( oaStarDetector*, double, unsigned int,
+								unsigned int );
+extern int	oaStarsDetect ( oaStarDetector*, const void* );
+extern void	oaStarsFree ( oaStarDetector* );
+
 extern int	oaStackSum ( void**, unsigned int, void*, unsigned int,
 								unsigned int );
 extern int	oaStackMean ( void**, unsigned int, void*, unsigned int,
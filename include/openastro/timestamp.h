@@ -0,0 +1,56 @@
+/*****************************************************************************
+ *
+ * timestamp.h -- binary frame timestamps
+ *
+ * Copyright 2026 James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#ifndef OPENASTRO_TIMESTAMP_H
+#define OPENASTRO_TIMESTAMP_H
+
+#include <stdint.h>
+
+// A frame timestamp is taken once, as close to the data arriving as
+// possible, and carries both a monotonic time for measuring intervals
+// and the UTC wall clock time at the same instant.  Only writers that
+// need text should ever convert it to a string.
+
+typedef struct oaTimestamp {
+	uint64_t		monotonic;		// CLOCK_MONOTONIC, nanoseconds
+	int64_t			utc;					// nanoseconds since 1970-01-01T00:00:00Z
+} oaTimestamp;
+
+// Long enough for "CCYY-MM-DDThh:mm:ss.ssssss" and the terminating NUL
+
+#define	OA_TIMESTAMP_STRLEN		32
+
+// Number of decimal places given to oaTimestampFormat for milliseconds
+// and microseconds
+
+#define	OA_TIMESTAMP_MSEC			3
+#define	OA_TIMESTAMP_USEC			6
+
+extern void		oaTimestampNow ( oaTimestamp* );
+extern int		oaTimestampFormat ( const oaTimestamp*, char*, int, int );
+extern int		oaTimestampParse ( const char*, oaTimestamp* );
+
+#endif	/* OPENASTRO_TIMESTAMP_H */
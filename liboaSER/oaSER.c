@@ -37,10 +37,12 @@
 
 
 static void    _oaSERInitMicrosoftTimestamp();
-static int64_t _oaSERGetMicrosoftTimestamp ( const char*, int );
+static int64_t _oaSERGetMicrosoftTimestamp ( int64_t, int );
 static void    _oaSER32BitToLittleEndian ( int32_t, uint8_t* );
 static void    _oaSER64BitToLittleEndian ( int64_t, uint8_t* );
 static void    _oaSERnToLittleEndian ( int64_t, uint8_t*, uint8_t );
+static int64_t _oaSERnFromLittleEndian ( uint8_t*, uint8_t );
+static int     _oaSERReadFully ( int, void*, uint32_t );
 
 const int64_t  epochTicks          = 621355968000000000LL;
 const int64_t  ticksPerSecond      = 10000000;
@@ -49,6 +51,7 @@ static int64_t _offsetFromGMT      = 0;
 
 #define TIMESTAMP_BLOCK_COUNT 1024
 #define FRAME_COUNT_POSN      38
+#define HEADER_SIZE           178
 
 #if !HAVE_CREAT64
 #define creat64 creat
@@ -56,6 +59,9 @@ static int64_t _offsetFromGMT      = 0;
 #if !HAVE_LSEEK64
 #define lseek64 lseek
 #endif
+#if !HAVE_OPEN64
+#define open64 open
+#endif
 
 int
 oaSEROpen ( const char* filename, oaSERContext* context )
@@ -192,7 +198,7 @@ oaSERWriteHeader ( oaSERContext* context, oaSERHeader* userHeader )
 
 
 int
-oaSERWriteFrame ( oaSERContext* context, void* frame, const char* timestampStr )
+oaSERWriteFrame ( oaSERContext* context, void* frame, int64_t utcTime )
 {
   uint8_t  buffer[8];
   void*    writeableData = frame;
@@ -201,13 +207,9 @@ oaSERWriteFrame ( oaSERContext* context, void* frame, const char* timestampStr )
   unsigned int i, ret2;
   int      ret;
 
-  if ( timestampStr && *timestampStr ) {
-    int64_t now = _oaSERGetMicrosoftTimestamp ( timestampStr, 0 );
-    _oaSER64BitToLittleEndian ( now, buffer );
-  } else {
-    int64_t now = _oaSERGetMicrosoftTimestamp ( 0, 0 );
-    _oaSER64BitToLittleEndian ( now, buffer );
-  }
+  // utcTime is nanoseconds since the Unix epoch, or zero for "now"
+  _oaSER64BitToLittleEndian ( _oaSERGetMicrosoftTimestamp ( utcTime, 0 ),
+      buffer );
 
   if ( context->pixelDepth < 8 ) {
     t = context->transformBuffer;
@@ -284,6 +286,140 @@ oaSERClose ( oaSERContext* context )
 }
 
 
+/*
+ * Open an existing SER file for reading frames one at a time.  The header
+ * is returned with the LittleEndian flag the right way up, as it would be
+ * passed to oaSERWriteHeader().  A capture that was never finished may
+ * have a frame count of zero or more frames than the file holds, so only
+ * the frames actually in the file are read.
+ */
+
+int
+oaSEROpenRead ( const char* filename, oaSERContext* context,
+    oaSERHeader* header )
+{
+  uint8_t       buffer[ HEADER_SIZE ];
+  uint8_t*      p;
+  int           fd, bitPlanes = 1;
+  int64_t       end;
+  uint64_t      available;
+
+  memset ( context, 0, sizeof ( oaSERContext ));
+  context->SERfd = -1;
+  memset ( header, 0, sizeof ( oaSERHeader ));
+
+  if (( fd = open64 ( filename, O_RDONLY )) < 0 ) {
+    return -1;
+  }
+  if ( _oaSERReadFully ( fd, buffer, HEADER_SIZE )) {
+    close ( fd );
+    return -1;
+  }
+
+  memcpy ( header->FileID, buffer, 14 );
+  p = buffer + 14;
+  header->LuID = _oaSERnFromLittleEndian ( p, 4 );
+  header->ColorID = _oaSERnFromLittleEndian ( p + 4, 4 );
+  // See oaSERWriteHeader() for why this is inverted
+  header->LittleEndian = _oaSERnFromLittleEndian ( p + 8, 4 ) ? 0 : 1;
+  header->ImageWidth = _oaSERnFromLittleEndian ( p + 12, 4 );
+  header->ImageHeight = _oaSERnFromLittleEndian ( p + 16, 4 );
+  header->PixelDepth = _oaSERnFromLittleEndian ( p + 20, 4 );
+  header->FrameCount = _oaSERnFromLittleEndian ( p + 24, 4 );
+  p += 28;
+  memcpy ( header->Observer, p, OA_SER_MAX_STRING_LEN );
+  p += OA_SER_MAX_STRING_LEN;
+  memcpy ( header->Instrument, p, OA_SER_MAX_STRING_LEN );
+  p += OA_SER_MAX_STRING_LEN;
+  memcpy ( header->Telescope, p, OA_SER_MAX_STRING_LEN );
+  p += OA_SER_MAX_STRING_LEN;
+  header->DateTime = _oaSERnFromLittleEndian ( p, 8 );
+  header->DateTimeUTC = _oaSERnFromLittleEndian ( p + 8, 8 );
+
+  if ( header->ColorID == OA_SER_RGB || header->ColorID == OA_SER_BGR ) {
+    bitPlanes = 3;
+  }
+  if ( !header->ImageWidth || !header->ImageHeight ||
+      !header->PixelDepth || header->PixelDepth > 16 ) {
+    close ( fd );
+    return -1;
+  }
+
+  context->SERfd = fd;
+  context->frames = header->FrameCount;
+  context->pixelDepth = header->PixelDepth;
+  context->frameSize = ( header->PixelDepth > 8 ? 2 : 1 ) *
+      header->ImageWidth * header->ImageHeight * bitPlanes;
+
+  if (( end = lseek64 ( fd, 0, SEEK_END )) < 0 ||
+      lseek64 ( fd, HEADER_SIZE, SEEK_SET ) != HEADER_SIZE ) {
+    close ( fd );
+    context->SERfd = -1;
+    return -1;
+  }
+  available = ( end - HEADER_SIZE ) / context->frameSize;
+  if ( !context->frames || context->frames > available ) {
+    context->frames = available;
+  }
+  context->framesLeft = context->frames;
+  return 0;
+}
+
+
+/*
+ * Go back to the first frame
+ */
+
+int
+oaSERRewind ( oaSERContext* context )
+{
+  if ( lseek64 ( context->SERfd, HEADER_SIZE, SEEK_SET ) != HEADER_SIZE ) {
+    return -1;
+  }
+  context->framesLeft = context->frames;
+  return 0;
+}
+
+
+/*
+ * Read the next frame into the buffer, which must be at least as big as
+ * a frame.  Returns 1 if there are no more frames.
+ */
+
+int
+oaSERReadFrame ( oaSERContext* context, void* frame )
+{
+  if ( !context->framesLeft ) {
+    return 1;
+  }
+  if ( _oaSERReadFully ( context->SERfd, frame, context->frameSize )) {
+    return -1;
+  }
+  context->framesLeft--;
+  return 0;
+}
+
+
+static int
+_oaSERReadFully ( int fd, void* buffer, uint32_t length )
+{
+  uint8_t*      p = buffer;
+  ssize_t       ret;
+
+  while ( length ) {
+    if (( ret = read ( fd, p, length )) <= 0 ) {
+      if ( ret < 0 && errno == EINTR ) {
+        continue;
+      }
+      return -1;
+    }
+    p += ret;
+    length -= ret;
+  }
+  return 0;
+}
+
+
 static void
 _oaSERInitMicrosoftTimestamp()
 {
@@ -297,28 +433,19 @@ _oaSERInitMicrosoftTimestamp()
 
 
 static int64_t
-_oaSERGetMicrosoftTimestamp ( const char* timestamp, int utc )
+_oaSERGetMicrosoftTimestamp ( int64_t utcTime, int utc )
 {
   int64_t        stamp;
   struct timeval tv;
-  struct tm      tm;
-  int            millisecs;
-
-  if ( timestamp ) {
-    // timestamp is CCYY-MM-DDThh:mm:ss.sss
-    ( void ) sscanf ( timestamp, "%d-%d-%dT%d:%d:%d.%d", &tm.tm_year,
-        &tm.tm_mon, &tm.tm_mday, &tm.tm_hour, &tm.tm_min, &tm.tm_sec,
-        &millisecs );
-    tm.tm_mon--;
-    tm.tm_year -= 1900;
-    tm.tm_isdst = tm.tm_wday = tm.tm_yday = -1;
-    tv.tv_sec = timegm ( &tm );
-    tv.tv_usec = millisecs * 1000;
+
+  if ( utcTime ) {
+    // one tick is 100ns
+    stamp = utcTime / 100 + epochTicks;
   } else {
     gettimeofday ( &tv, 0 );
+    stamp = tv.tv_sec * ticksPerSecond + tv.tv_usec * ticksPerMicrosecond +
+        epochTicks;
   }
-  stamp = tv.tv_sec * ticksPerSecond + tv.tv_usec * ticksPerMicrosecond +
-      epochTicks;
   if ( !utc ) {
     stamp += _offsetFromGMT;
   }
@@ -349,3 +476,15 @@ _oaSERnToLittleEndian ( int64_t val, uint8_t* buf, uint8_t len )
     val >>= 8;
   }
 }
+
+
+static int64_t
+_oaSERnFromLittleEndian ( uint8_t* buf, uint8_t len )
+{
+  int64_t       val = 0;
+
+  while ( len-- > 0 ) {
+    val = ( val << 8 ) | buf[ len ];
+  }
+  return val;
+}
@@ -0,0 +1,107 @@
+/*****************************************************************************
+ *
+ * araviscallback.c -- Aravis camera callback handler
+ *
+ * Copyright 2026 James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <oa_common.h>
+
+#include <pthread.h>
+
+#include <openastro/camera.h>
+
+#include "oacamprivate.h"
+#include "unimplemented.h"
+#include "aravisprivate.h"
+#include "aravisoacam.h"
+#include "aravisstate.h"
+
+
+void*
+oacamAravisCallbackHandler ( void* param )
+{
+  oaCamera*				camera = param;
+  ARAVIS_STATE*		cameraInfo = camera->_private;
+  int							exitThread = 0, streaming;
+  CALLBACK*				callback;
+  void*						(*callbackFunc)( void*, void*, int, void* );
+  void*						frame;
+  int							frameLen;
+	ArvBuffer*			buffer;
+
+  do {
+    pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
+    exitThread = cameraInfo->stopCallbackThread;
+    pthread_mutex_unlock ( &cameraInfo->callbackQueueMutex );
+
+    if ( exitThread ) {
+      break;
+    } else {
+      // try to prevent busy-waiting
+      if ( oaDLListIsEmpty ( cameraInfo->callbackQueue )) {
+        pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
+        pthread_cond_wait ( &cameraInfo->callbackQueued,
+            &cameraInfo->callbackQueueMutex );
+        pthread_mutex_unlock ( &cameraInfo->callbackQueueMutex );
+      }
+    }
+
+    callback = oaDLListRemoveFromHead ( cameraInfo->callbackQueue );
+    if ( callback ) {
+      switch ( callback->callbackType ) {
+        case OA_CALLBACK_NEW_FRAME:
+          callbackFunc = callback->callback;
+          frame = callback->buffer;
+          frameLen = callback->bufferLen;
+          _oaSoftwareFrame ( camera, &frame, &frameLen, callback->metadata );
+          OA_FRAME_STATS_CB_STAMP ( cameraInfo, callback,
+              OA_FRAME_STAGE_CALLBACK );
+          callbackFunc ( callback->callbackArg, frame, frameLen,
+              callback->metadata );
+          OA_FRAME_STATS_CB_STAMP ( cameraInfo, callback,
+              OA_FRAME_STAGE_RETURNED );
+					// We can only requeue frames if we're still streaming.  The
+					// stream stays around until all the buffers have been returned,
+					// so it's safe to use here either way
+					buffer = cameraInfo->arvBuffers[ callback->bufferIdx ];
+					pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
+					streaming = ( cameraInfo->runMode == CAM_RUN_MODE_STREAMING ) ? 1 : 0;
+					pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
+					if ( streaming ) {
+						p_arv_stream_push_buffer ( cameraInfo->stream, buffer );
+					} else {
+						p_g_object_unref ( buffer );
+					}
+          OA_FRAME_STATS_CB_COMPLETE ( cameraInfo, callback );
+          _oaReturnBuffer ( cameraInfo );
+          break;
+        default:
+          oaLogWarning ( OA_LOG_CAMERA, "%s: unexpected callback type %d",
+              __func__, callback->callbackType );
+          break;
+      }
+    }
+  } while ( 1 );
+
+  return 0;
+}
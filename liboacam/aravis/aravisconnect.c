@@ -0,0 +1,616 @@
+/*****************************************************************************
+ *
+ * aravisconnect.c -- Initialise Aravis cameras
+ *
+ * Copyright 2026 James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <oa_common.h>
+
+#include <pthread.h>
+#include <openastro/camera.h>
+#include <openastro/util.h>
+#include <openastro/demosaic.h>
+
+#include "unimplemented.h"
+#include "oacamprivate.h"
+#include "aravisprivate.h"
+#include "aravisoacam.h"
+#include "aravisstate.h"
+#include "aravisnodes.h"
+
+
+static void	_aravisInitFunctionPointers ( oaCamera* );
+static int	_aravisGetRange ( ArvGcNode*, int, int64_t*, int64_t*, int64_t*,
+								int64_t* );
+static int	_aravisHasAuto ( ArvDevice*, const char* );
+
+// Where a GenICam name has changed across versions of the standard the
+// older one is listed second, so it's only used if the newer isn't there
+
+aravisFrameInfo	_aravisFrameFormats[] = {
+	{ "Mono8", OA_PIX_FMT_GREY8 },
+	{ "Mono10", OA_PIX_FMT_GREY10_16LE },
+	{ "Mono12", OA_PIX_FMT_GREY12_16LE },
+	{ "Mono16", OA_PIX_FMT_GREY16LE },
+	{ "RGB8", OA_PIX_FMT_RGB24 },
+	{ "RGB8Packed", OA_PIX_FMT_RGB24 },
+	{ "BGR8", OA_PIX_FMT_BGR24 },
+	{ "BGR8Packed", OA_PIX_FMT_BGR24 },
+	{ "BayerBG8", OA_PIX_FMT_BGGR8 },
+	{ "BayerBG10", OA_PIX_FMT_BGGR10_16LE },
+	{ "BayerBG12", OA_PIX_FMT_BGGR12_16LE },
+	{ "BayerBG16", OA_PIX_FMT_BGGR16LE },
+	{ "BayerGB8", OA_PIX_FMT_GBRG8 },
+	{ "BayerGB10", OA_PIX_FMT_GBRG10_16LE },
+	{ "BayerGB12", OA_PIX_FMT_GBRG12_16LE },
+	{ "BayerGB16", OA_PIX_FMT_GBRG16LE },
+	{ "BayerGR8", OA_PIX_FMT_GRBG8 },
+	{ "BayerGR10", OA_PIX_FMT_GRBG10_16LE },
+	{ "BayerGR12", OA_PIX_FMT_GRBG12_16LE },
+	{ "BayerGR16", OA_PIX_FMT_GRBG16LE },
+	{ "BayerRG8", OA_PIX_FMT_RGGB8 },
+	{ "BayerRG10", OA_PIX_FMT_RGGB10_16LE },
+	{ "BayerRG12", OA_PIX_FMT_RGGB12_16LE },
+	{ "BayerRG16", OA_PIX_FMT_RGGB16LE }
+};
+
+const int _aravisNumFrameFormats = sizeof ( _aravisFrameFormats ) /
+		sizeof ( aravisFrameInfo );
+
+// Largest socket buffer we'll offer.  Zero means let Aravis size it to
+// suit the frame
+
+#define	ARAVIS_MAX_SOCKET_BUFFER	( 64 * 1024 * 1024 )
+
+// Must be used before FREE_DATA_STRUCTS, which frees cameraInfo
+
+#define CLOSE_ARAVIS	\
+		p_g_object_unref ( cameraInfo->device );
+
+
+oaCamera*
+oaAravisInitCamera ( oaCameraDevice* device )
+{
+  oaCamera*					camera;
+	ARAVIS_STATE*			cameraInfo;
+  COMMON_INFO*			commonInfo;
+  DEVICE_INFO*			devInfo;
+	ArvDevice*				arvDevice;
+	ArvGcNode*				node;
+#ifdef ARAVIS_V08
+	GError*						error = 0;
+#endif
+	int								i, j, ret, binMax, oaFormat;
+	int64_t						imin, imax, istep, icurr;
+	int64_t						vmin, vmax, vstep, vcurr;
+	char							strBuff[64];
+
+  if ( _oaInitCameraStructs ( &camera, ( void* ) &cameraInfo,
+      sizeof ( ARAVIS_STATE ), &commonInfo ) != OA_ERR_NONE ) {
+    return 0;
+  }
+
+  _aravisInitFunctionPointers ( camera );
+
+  ( void ) strcpy ( camera->deviceName, device->deviceName );
+  camera->interface = device->interface;
+  cameraInfo->initialised = 0;
+  devInfo = device->_private;
+
+#ifdef ARAVIS_V08
+	arvDevice = p_arv_open_device ( devInfo->deviceId, &error );
+	if ( error ) {
+		oaLogError ( OA_LOG_CAMERA, "%s: arv_open_device ( %s ) failed: %s",
+				__func__, devInfo->deviceId, error->message );
+		p_g_error_free ( error );
+	}
+#else
+	arvDevice = p_arv_open_device ( devInfo->deviceId );
+#endif
+	if ( !arvDevice ) {
+		oaLogError ( OA_LOG_CAMERA, "%s: Can't open Aravis device %s", __func__,
+				devInfo->deviceId );
+		FREE_DATA_STRUCTS;
+		return 0;
+	}
+	cameraInfo->device = arvDevice;
+
+	// gain
+
+	node = 0;
+	if ( _aravisGetNode ( arvDevice, "Gain", 0x3, &node ) == OA_ERR_NONE ) {
+		( void ) strcpy ( cameraInfo->gainName, "Gain" );
+	} else if ( _aravisGetNode ( arvDevice, "GainRaw", 0x3, &node ) ==
+			OA_ERR_NONE ) {
+		( void ) strcpy ( cameraInfo->gainName, "GainRaw" );
+	} else {
+		node = 0;
+	}
+	if ( node ) {
+		cameraInfo->gainIsFloat = _aravisNodeIsFloat ( node );
+		if ( _aravisGetRange ( node, cameraInfo->gainIsFloat, &imin, &imax,
+				&istep, &icurr ) == OA_ERR_NONE ) {
+			camera->OA_CAM_CTRL_TYPE( OA_CAM_CTRL_GAIN ) = OA_CTRL_TYPE_INT32;
+			commonInfo->OA_CAM_CTRL_MIN( OA_CAM_CTRL_GAIN ) = imin;
+			commonInfo->OA_CAM_CTRL_MAX( OA_CAM_CTRL_GAIN ) = imax;
+			commonInfo->OA_CAM_CTRL_STEP( OA_CAM_CTRL_GAIN ) = istep;
+			commonInfo->OA_CAM_CTRL_DEF( OA_CAM_CTRL_GAIN ) = icurr;
+			if ( _aravisHasAuto ( arvDevice, "GainAuto" )) {
+				int autogain = OA_CAM_CTRL_MODE_AUTO( OA_CAM_CTRL_GAIN );
+				camera->OA_CAM_CTRL_TYPE( autogain ) = OA_CTRL_TYPE_BOOLEAN;
+				commonInfo->OA_CAM_CTRL_MIN( autogain ) = 0;
+				commonInfo->OA_CAM_CTRL_MAX( autogain ) = 1;
+				commonInfo->OA_CAM_CTRL_STEP( autogain ) = 1;
+				commonInfo->OA_CAM_CTRL_DEF( autogain ) = 0;
+			}
+		}
+	}
+
+	// exposure time, which we handle in microseconds as GenICam does
+
+	node = 0;
+	if ( _aravisGetNode ( arvDevice, "ExposureTime", 0x3, &node ) ==
+			OA_ERR_NONE ) {
+		( void ) strcpy ( cameraInfo->exposureTimeName, "ExposureTime" );
+	} else if ( _aravisGetNode ( arvDevice, "ExposureTimeAbs", 0x3, &node ) ==
+			OA_ERR_NONE ) {
+		( void ) strcpy ( cameraInfo->exposureTimeName, "ExposureTimeAbs" );
+	} else {
+		node = 0;
+	}
+	if ( node ) {
+		cameraInfo->exposureIsFloat = _aravisNodeIsFloat ( node );
+		if ( _aravisGetRange ( node, cameraInfo->exposureIsFloat, &imin, &imax,
+				&istep, &icurr ) == OA_ERR_NONE ) {
+			if ( imin < 1 ) {
+				imin = 1;
+			}
+			camera->OA_CAM_CTRL_TYPE( OA_CAM_CTRL_EXPOSURE_ABSOLUTE ) =
+					OA_CTRL_TYPE_INT64;
+			commonInfo->OA_CAM_CTRL_MIN( OA_CAM_CTRL_EXPOSURE_ABSOLUTE ) = imin;
+			commonInfo->OA_CAM_CTRL_MAX( OA_CAM_CTRL_EXPOSURE_ABSOLUTE ) = imax;
+			commonInfo->OA_CAM_CTRL_STEP( OA_CAM_CTRL_EXPOSURE_ABSOLUTE ) = 1;
+			commonInfo->OA_CAM_CTRL_DEF( OA_CAM_CTRL_EXPOSURE_ABSOLUTE ) = icurr;
+			if ( _aravisHasAuto ( arvDevice, "ExposureAuto" )) {
+				int autoexp = OA_CAM_CTRL_MODE_AUTO( OA_CAM_CTRL_EXPOSURE_ABSOLUTE );
+				camera->OA_CAM_CTRL_TYPE( autoexp ) = OA_CTRL_TYPE_BOOLEAN;
+				commonInfo->OA_CAM_CTRL_MIN( autoexp ) = 0;
+				commonInfo->OA_CAM_CTRL_MAX( autoexp ) = 1;
+				commonInfo->OA_CAM_CTRL_STEP( autoexp ) = 1;
+				commonInfo->OA_CAM_CTRL_DEF( autoexp ) = 0;
+			}
+		}
+	}
+
+	// horizontal and vertical flip
+
+	if ( _aravisGetNode ( arvDevice, "ReverseX", 0x3, &node ) == OA_ERR_NONE ) {
+		int flip = OA_CAM_CTRL_HFLIP;
+		camera->OA_CAM_CTRL_TYPE( flip ) = OA_CTRL_TYPE_BOOLEAN;
+		commonInfo->OA_CAM_CTRL_MIN( flip ) = 0;
+		commonInfo->OA_CAM_CTRL_MAX( flip ) = 1;
+		commonInfo->OA_CAM_CTRL_STEP( flip ) = 1;
+		commonInfo->OA_CAM_CTRL_DEF( flip ) = 0;
+	}
+	if ( _aravisGetNode ( arvDevice, "ReverseY", 0x3, &node ) == OA_ERR_NONE ) {
+		int flip = OA_CAM_CTRL_VFLIP;
+		camera->OA_CAM_CTRL_TYPE( flip ) = OA_CTRL_TYPE_BOOLEAN;
+		commonInfo->OA_CAM_CTRL_MIN( flip ) = 0;
+		commonInfo->OA_CAM_CTRL_MAX( flip ) = 1;
+		commonInfo->OA_CAM_CTRL_STEP( flip ) = 1;
+		commonInfo->OA_CAM_CTRL_DEF( flip ) = 0;
+	}
+
+	// binning, only where it's the same both ways
+
+	binMax = 1;
+	if ( _aravisGetNode ( arvDevice, "BinningHorizontal", 0x3, &node ) ==
+			OA_ERR_NONE && _aravisGetIntSettings ( node, &imin, &imax, &istep,
+			&icurr ) == OA_ERR_NONE && imax > 1 ) {
+		if ( _aravisGetNode ( arvDevice, "BinningVertical", 0x3, &node ) ==
+				OA_ERR_NONE && _aravisGetIntSettings ( node, &vmin, &vmax, &vstep,
+				&vcurr ) == OA_ERR_NONE && vmax > 1 ) {
+			if ( istep != 1 || vstep != 1 ) {
+				oaLogWarning ( OA_LOG_CAMERA,
+						"%s: Can't handle mismatched binning steps", __func__ );
+			} else {
+				binMax = ( imax > vmax ) ? vmax : imax;
+				if ( binMax > OA_MAX_BINNING ) {
+					binMax = OA_MAX_BINNING;
+				}
+				camera->OA_CAM_CTRL_TYPE( OA_CAM_CTRL_BINNING ) =
+						OA_CTRL_TYPE_INT32;
+				commonInfo->OA_CAM_CTRL_MIN( OA_CAM_CTRL_BINNING ) = 1;
+				commonInfo->OA_CAM_CTRL_MAX( OA_CAM_CTRL_BINNING ) = binMax;
+				commonInfo->OA_CAM_CTRL_STEP( OA_CAM_CTRL_BINNING ) = 1;
+				commonInfo->OA_CAM_CTRL_DEF( OA_CAM_CTRL_BINNING ) = 1;
+				( void ) _aravisSetInt ( arvDevice, "BinningHorizontal", 1 );
+				( void ) _aravisSetInt ( arvDevice, "BinningVertical", 1 );
+			}
+		}
+	}
+	cameraInfo->maxBinning = binMax;
+	cameraInfo->binMode = OA_BIN_MODE_NONE;
+
+	// frame size.  The offsets have to be cleared first or the maximum
+	// width and height will be reduced by them
+
+	( void ) _aravisSetInt ( arvDevice, "OffsetX", 0 );
+	( void ) _aravisSetInt ( arvDevice, "OffsetY", 0 );
+
+	camera->features.flags |= OA_CAM_FEATURE_ROI;
+	if (( ret = _aravisGetNode ( arvDevice, "Width", 0x3, &node )) ==
+			OA_ERR_NONE || ret == -OA_ERR_NOT_WRITEABLE ) {
+		if ( ret == -OA_ERR_NOT_WRITEABLE ) {
+			camera->features.flags &= ~OA_CAM_FEATURE_ROI;
+		}
+		ret = _aravisGetIntSettings ( node, &imin, &imax, &istep, &icurr );
+	}
+	if ( ret != OA_ERR_NONE ) {
+		oaLogError ( OA_LOG_CAMERA, "%s: Can't determine frame width", __func__ );
+		CLOSE_ARAVIS;
+		FREE_DATA_STRUCTS;
+		return 0;
+	}
+	cameraInfo->minResolutionX = imin;
+	cameraInfo->maxResolutionX = imax;
+	cameraInfo->xSizeStep = istep;
+
+	if (( ret = _aravisGetNode ( arvDevice, "Height", 0x3, &node )) ==
+			OA_ERR_NONE || ret == -OA_ERR_NOT_WRITEABLE ) {
+		if ( ret == -OA_ERR_NOT_WRITEABLE ) {
+			camera->features.flags &= ~OA_CAM_FEATURE_ROI;
+		}
+		ret = _aravisGetIntSettings ( node, &imin, &imax, &istep, &icurr );
+	}
+	if ( ret != OA_ERR_NONE ) {
+		oaLogError ( OA_LOG_CAMERA, "%s: Can't determine frame height",
+				__func__ );
+		CLOSE_ARAVIS;
+		FREE_DATA_STRUCTS;
+		return 0;
+	}
+	cameraInfo->minResolutionY = imin;
+	cameraInfo->maxResolutionY = imax;
+	cameraInfo->ySizeStep = istep;
+
+	if ( camera->features.flags & OA_CAM_FEATURE_ROI ) {
+		( void ) _aravisSetInt ( arvDevice, "Width", cameraInfo->maxResolutionX );
+		( void ) _aravisSetInt ( arvDevice, "Height",
+				cameraInfo->maxResolutionY );
+	}
+	cameraInfo->xSize = cameraInfo->maxResolutionX;
+	cameraInfo->ySize = cameraInfo->maxResolutionY;
+
+	// Find which frame formats are available
+
+	if (( ret = _aravisGetNode ( arvDevice, "PixelFormat", 0x1, &node )) !=
+			OA_ERR_NONE ) {
+		oaLogError ( OA_LOG_CAMERA, "%s: Can't get PixelFormat, err = %d",
+				__func__, ret );
+		CLOSE_ARAVIS;
+		FREE_DATA_STRUCTS;
+		return 0;
+	}
+
+	if ( _aravisGetEnum ( arvDevice, "PixelFormat", strBuff,
+			sizeof ( strBuff )) != OA_ERR_NONE ) {
+		*strBuff = 0;
+	}
+
+	cameraInfo->currentFrameFormat = -1;
+	for ( i = 0; i < _aravisNumFrameFormats; i++ ) {
+		oaFormat = _aravisFrameFormats[i].pixFormat;
+		if ( cameraInfo->pixelFormatNames[ oaFormat ] ||
+				!_aravisHasEnumValue ( node, _aravisFrameFormats[i].arvName )) {
+			continue;
+		}
+		cameraInfo->pixelFormatNames[ oaFormat ] = _aravisFrameFormats[i].arvName;
+		camera->frameFormats[ oaFormat ] = 1;
+		if ( !strcmp ( strBuff, _aravisFrameFormats[i].arvName )) {
+			cameraInfo->currentFrameFormat = oaFormat;
+		}
+		if ( oaFrameFormats[ oaFormat ].rawColour ) {
+			camera->features.flags |= OA_CAM_FEATURE_RAW_MODE;
+		}
+		if ( oaFrameFormats[ oaFormat ].fullColour ) {
+			camera->features.flags |= OA_CAM_FEATURE_DEMOSAIC_MODE;
+		}
+	}
+
+	if ( cameraInfo->currentFrameFormat < 0 ) {
+		// The camera is in a format we can't use, so pick the first we can
+		for ( i = 0; i < _aravisNumFrameFormats &&
+				cameraInfo->currentFrameFormat < 0; i++ ) {
+			oaFormat = _aravisFrameFormats[i].pixFormat;
+			if ( cameraInfo->pixelFormatNames[ oaFormat ] &&
+					_aravisSetEnum ( arvDevice, "PixelFormat",
+					cameraInfo->pixelFormatNames[ oaFormat ]) == OA_ERR_NONE ) {
+				cameraInfo->currentFrameFormat = oaFormat;
+			}
+		}
+	}
+	if ( cameraInfo->currentFrameFormat < 0 ) {
+		oaLogError ( OA_LOG_CAMERA, "%s: No usable frame format", __func__ );
+		CLOSE_ARAVIS;
+		FREE_DATA_STRUCTS;
+		return 0;
+	}
+  camera->OA_CAM_CTRL_TYPE( OA_CAM_CTRL_FRAME_FORMAT ) = OA_CTRL_TYPE_DISCRETE;
+	cameraInfo->currentBytesPerPixel =
+			oaFrameFormats[ cameraInfo->currentFrameFormat ].bytesPerPixel;
+	cameraInfo->imageBufferLength = cameraInfo->xSize * cameraInfo->ySize *
+			cameraInfo->currentBytesPerPixel;
+
+	for ( i = 1; i <= binMax; i++ ) {
+		if (!( cameraInfo->frameSizes[i].sizes = ( FRAMESIZE* ) malloc (
+					sizeof ( FRAMESIZE )))) {
+			oaLogError ( OA_LOG_CAMERA, "%s: malloc ( FRAMESIZE ) failed", __func__ );
+			for ( j = 1; j < i; j++ ) {
+				free (( void* ) cameraInfo->frameSizes[j].sizes );
+			}
+			CLOSE_ARAVIS;
+			FREE_DATA_STRUCTS;
+			return 0;
+		}
+		cameraInfo->frameSizes[i].sizes[0].x = cameraInfo->maxResolutionX / i;
+		cameraInfo->frameSizes[i].sizes[0].y = cameraInfo->maxResolutionY / i;
+		cameraInfo->frameSizes[i].numSizes = 1;
+	}
+
+	if ( _aravisGetNode ( arvDevice, "AcquisitionMode", 0x1, &node ) ==
+			OA_ERR_NONE && _aravisHasEnumValue ( node, "Continuous" )) {
+		camera->features.flags |= OA_CAM_FEATURE_STREAMING;
+	}
+	if (!( camera->features.flags & OA_CAM_FEATURE_STREAMING )) {
+		oaLogError ( OA_LOG_CAMERA, "%s: Camera doesn't support streaming",
+				__func__ );
+		for ( j = 1; j <= binMax; j++ ) {
+			free (( void* ) cameraInfo->frameSizes[j].sizes );
+		}
+		CLOSE_ARAVIS;
+		FREE_DATA_STRUCTS;
+		return 0;
+	}
+
+	// GigE Vision transport.  The packet size and inter-packet delay belong
+	// to the camera.  The socket buffer and packet resend settings belong to
+	// our end of the stream and are applied when it is created
+
+	if ( _aravisGetNode ( arvDevice, "GevSCPSPacketSize", 0x3, &node ) ==
+			OA_ERR_NONE ) {
+		cameraInfo->isGigE = 1;
+		if ( _aravisGetIntSettings ( node, &imin, &imax, &istep, &icurr ) ==
+				OA_ERR_NONE ) {
+			camera->OA_CAM_CTRL_TYPE( OA_CAM_CTRL_PACKET_SIZE ) =
+					OA_CTRL_TYPE_INT32;
+			commonInfo->OA_CAM_CTRL_MIN( OA_CAM_CTRL_PACKET_SIZE ) = imin;
+			commonInfo->OA_CAM_CTRL_MAX( OA_CAM_CTRL_PACKET_SIZE ) = imax;
+			commonInfo->OA_CAM_CTRL_STEP( OA_CAM_CTRL_PACKET_SIZE ) = istep;
+			commonInfo->OA_CAM_CTRL_DEF( OA_CAM_CTRL_PACKET_SIZE ) = icurr;
+		}
+		if ( _aravisGetNode ( arvDevice, "GevSCPD", 0x3, &node ) ==
+				OA_ERR_NONE && _aravisGetIntSettings ( node, &imin, &imax, &istep,
+				&icurr ) == OA_ERR_NONE ) {
+			camera->OA_CAM_CTRL_TYPE( OA_CAM_CTRL_PACKET_DELAY ) =
+					OA_CTRL_TYPE_INT32;
+			commonInfo->OA_CAM_CTRL_MIN( OA_CAM_CTRL_PACKET_DELAY ) = imin;
+			commonInfo->OA_CAM_CTRL_MAX( OA_CAM_CTRL_PACKET_DELAY ) = imax;
+			commonInfo->OA_CAM_CTRL_STEP( OA_CAM_CTRL_PACKET_DELAY ) = istep;
+			commonInfo->OA_CAM_CTRL_DEF( OA_CAM_CTRL_PACKET_DELAY ) = icurr;
+		}
+
+		camera->OA_CAM_CTRL_TYPE( OA_CAM_CTRL_SOCKET_BUFFER_SIZE ) =
+				OA_CTRL_TYPE_INT32;
+		commonInfo->OA_CAM_CTRL_MIN( OA_CAM_CTRL_SOCKET_BUFFER_SIZE ) = 0;
+		commonInfo->OA_CAM_CTRL_MAX( OA_CAM_CTRL_SOCKET_BUFFER_SIZE ) =
+				ARAVIS_MAX_SOCKET_BUFFER;
+		commonInfo->OA_CAM_CTRL_STEP( OA_CAM_CTRL_SOCKET_BUFFER_SIZE ) = 1;
+		commonInfo->OA_CAM_CTRL_DEF( OA_CAM_CTRL_SOCKET_BUFFER_SIZE ) = 0;
+		cameraInfo->socketBufferSize = 0;
+
+		camera->OA_CAM_CTRL_TYPE( OA_CAM_CTRL_PACKET_RESEND ) =
+				OA_CTRL_TYPE_BOOLEAN;
+		commonInfo->OA_CAM_CTRL_MIN( OA_CAM_CTRL_PACKET_RESEND ) = 0;
+		commonInfo->OA_CAM_CTRL_MAX( OA_CAM_CTRL_PACKET_RESEND ) = 1;
+		commonInfo->OA_CAM_CTRL_STEP( OA_CAM_CTRL_PACKET_RESEND ) = 1;
+		commonInfo->OA_CAM_CTRL_DEF( OA_CAM_CTRL_PACKET_RESEND ) = 1;
+		cameraInfo->packetResend = 1;
+
+		camera->OA_CAM_CTRL_TYPE( OA_CAM_CTRL_PACKETS_RESENT ) =
+				OA_CTRL_TYPE_READONLY;
+	}
+
+	// stream statistics
+
+	camera->OA_CAM_CTRL_TYPE( OA_CAM_CTRL_FRAMES_COMPLETED ) =
+			OA_CTRL_TYPE_READONLY;
+	camera->OA_CAM_CTRL_TYPE( OA_CAM_CTRL_FRAMES_FAILED ) =
+			OA_CTRL_TYPE_READONLY;
+  camera->OA_CAM_CTRL_TYPE( OA_CAM_CTRL_DROPPED ) = OA_CTRL_TYPE_READONLY;
+  camera->OA_CAM_CTRL_TYPE( OA_CAM_CTRL_DROPPED_RESET ) = OA_CTRL_TYPE_BUTTON;
+  commonInfo->OA_CAM_CTRL_MIN( OA_CAM_CTRL_DROPPED_RESET ) = 0;
+  commonInfo->OA_CAM_CTRL_MAX( OA_CAM_CTRL_DROPPED_RESET ) = 1;
+  commonInfo->OA_CAM_CTRL_STEP( OA_CAM_CTRL_DROPPED_RESET ) = 1;
+  commonInfo->OA_CAM_CTRL_DEF( OA_CAM_CTRL_DROPPED_RESET ) = 0;
+
+	// The stream fills these directly, so they're allocated when we know
+	// the payload size
+
+	cameraInfo->buffers = calloc ( OA_CAM_BUFFERS, sizeof ( frameBuffer ));
+
+  cameraInfo->stopControllerThread = cameraInfo->stopCallbackThread = 0;
+  cameraInfo->commandQueue = oaDLListCreate();
+  cameraInfo->callbackQueue = oaDLListCreate();
+	cameraInfo->nextBuffer = 0;
+	cameraInfo->configuredBuffers = OA_CAM_BUFFERS;
+	cameraInfo->buffersFree = OA_CAM_BUFFERS;
+
+  if ( pthread_create ( &( cameraInfo->controllerThread ), 0,
+      oacamAravisController, ( void* ) camera )) {
+		for ( j = 1; j <= OA_MAX_BINNING; j++ ) {
+			if ( cameraInfo->frameSizes[ j ].numSizes ) {
+				free (( void* ) cameraInfo->frameSizes[ j ].sizes );
+			}
+		}
+		free (( void* ) cameraInfo->buffers );
+    oaDLListDelete ( cameraInfo->commandQueue, 0 );
+    oaDLListDelete ( cameraInfo->callbackQueue, 0 );
+		CLOSE_ARAVIS;
+    FREE_DATA_STRUCTS;
+    return 0;
+  }
+  if ( pthread_create ( &( cameraInfo->callbackThread ), 0,
+      oacamAravisCallbackHandler, ( void* ) camera )) {
+
+    void* dummy;
+    cameraInfo->stopControllerThread = 1;
+    pthread_cond_broadcast ( &cameraInfo->commandQueued );
+    pthread_join ( cameraInfo->controllerThread, &dummy );
+		for ( j = 1; j <= OA_MAX_BINNING; j++ ) {
+			if ( cameraInfo->frameSizes[ j ].numSizes ) {
+				free (( void* ) cameraInfo->frameSizes[ j ].sizes );
+			}
+		}
+		free (( void* ) cameraInfo->buffers );
+    oaDLListDelete ( cameraInfo->commandQueue, 0 );
+    oaDLListDelete ( cameraInfo->callbackQueue, 0 );
+		CLOSE_ARAVIS;
+    FREE_DATA_STRUCTS;
+    return 0;
+  }
+
+  cameraInfo->initialised = 1;
+  return camera;
+}
+
+
+/**
+ * Get the range of an integer or float feature as integers
+ */
+
+static int
+_aravisGetRange ( ArvGcNode* node, int isFloat, int64_t* min, int64_t* max,
+		int64_t* step, int64_t* curr )
+{
+	double		fmin, fmax, fcurr;
+	int				ret;
+
+	if ( !isFloat ) {
+		return _aravisGetIntSettings ( node, min, max, step, curr );
+	}
+
+	if (( ret = _aravisGetFloatSettings ( node, &fmin, &fmax, &fcurr )) !=
+			OA_ERR_NONE ) {
+		return ret;
+	}
+	*min = ( int64_t )( fmin + 0.999 );
+	*max = ( int64_t ) fmax;
+	*step = 1;
+	*curr = ( int64_t )( fcurr + 0.5 );
+	if ( *curr < *min ) {
+		*curr = *min;
+	}
+	if ( *curr > *max ) {
+		*curr = *max;
+	}
+	return OA_ERR_NONE;
+}
+
+
+static int
+_aravisHasAuto ( ArvDevice* arvDevice, const char* name )
+{
+	ArvGcNode*		node;
+
+	if ( _aravisGetNode ( arvDevice, name, 0x3, &node ) != OA_ERR_NONE ) {
+		return 0;
+	}
+	return ( _aravisHasEnumValue ( node, "Off" ) &&
+			_aravisHasEnumValue ( node, "Continuous" )) ? 1 : 0;
+}
+
+
+static void
+_aravisInitFunctionPointers ( oaCamera* camera )
+{
+  camera->funcs.initCamera = oaAravisInitCamera;
+  camera->funcs.closeCamera = oaAravisCloseCamera;
+
+  camera->funcs.testControl = oaAravisCameraTestControl;
+  camera->funcs.getControlRange = oaAravisCameraGetControlRange;
+
+  camera->funcs.testROISize = oaAravisCameraTestROISize;
+
+  camera->funcs.hasAuto = oacamHasAuto;
+
+  camera->funcs.enumerateFrameSizes = oaAravisCameraGetFrameSizes;
+  camera->funcs.getFramePixelFormat = oaAravisCameraGetFramePixelFormat;
+}
+
+
+int
+oaAravisCloseCamera ( oaCamera* camera )
+{
+  void*						dummy;
+  ARAVIS_STATE*		cameraInfo;
+	int							j;
+
+  if ( camera ) {
+
+    cameraInfo = camera->_private;
+
+    cameraInfo->stopControllerThread = 1;
+    pthread_cond_broadcast ( &cameraInfo->commandQueued );
+    pthread_join ( cameraInfo->controllerThread, &dummy );
+
+    cameraInfo->stopCallbackThread = 1;
+    pthread_cond_broadcast ( &cameraInfo->callbackQueued );
+    pthread_join ( cameraInfo->callbackThread, &dummy );
+
+    CLOSE_ARAVIS;
+
+    for ( j = 0; j < OA_CAM_BUFFERS; j++ ) {
+      free (( void* ) cameraInfo->buffers[j].start );
+    }
+
+		for ( j = 1; j <= OA_MAX_BINNING; j++ ) {
+			if ( cameraInfo->frameSizes[ j ].numSizes ) {
+				free (( void* ) cameraInfo->frameSizes[ j ].sizes );
+			}
+		}
+
+    oacamFlushAsync ( cameraInfo );
+    oaDLListDelete ( cameraInfo->commandQueue, 1 );
+    oaDLListDelete ( cameraInfo->callbackQueue, 0 );
+
+		free (( void* ) cameraInfo->buffers );
+    free (( void* ) camera->_common );
+    free (( void* ) cameraInfo );
+    free (( void* ) camera );
+
+  } else {
+    return -OA_ERR_INVALID_CAMERA;
+  }
+  return OA_ERR_NONE;
+}
@@ -0,0 +1,112 @@
+/*****************************************************************************
+ *
+ * araviscontrol.c -- Aravis camera control functions
+ *
+ * Copyright 2026 James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <oa_common.h>
+
+#include <pthread.h>
+#include <openastro/camera.h>
+
+#include "oacamprivate.h"
+#include "aravisoacam.h"
+#include "aravisstate.h"
+
+
+int
+oaAravisCameraTestControl ( oaCamera* camera, int control,
+		oaControlValue* val )
+{
+  int32_t				val_s32;
+  int64_t				val_s64;
+  COMMON_INFO*	commonInfo = camera->_common;
+  ARAVIS_STATE*	cameraInfo = camera->_private;
+
+  if ( !camera->OA_CAM_CTRL_TYPE( control )) {
+    return -OA_ERR_INVALID_CONTROL;
+  }
+
+  if ( camera->OA_CAM_CTRL_TYPE( control ) != val->valueType ) {
+    return -OA_ERR_INVALID_CONTROL_TYPE;
+  }
+
+  switch ( control ) {
+
+    case OA_CAM_CTRL_GAIN:
+    case OA_CAM_CTRL_PACKET_SIZE:
+    case OA_CAM_CTRL_PACKET_DELAY:
+    case OA_CAM_CTRL_SOCKET_BUFFER_SIZE:
+      val_s32 = val->int32;
+      if ( val_s32 >= commonInfo->OA_CAM_CTRL_MIN( control ) &&
+          val_s32 <= commonInfo->OA_CAM_CTRL_MAX( control ) &&
+          ( 0 == ( val_s32 - commonInfo->OA_CAM_CTRL_MIN( control )) %
+          commonInfo->OA_CAM_CTRL_STEP( control ))) {
+        return OA_ERR_NONE;
+      }
+      break;
+
+    case OA_CAM_CTRL_BINNING:
+      val_s32 = val->int32;
+      if ( val_s32 >= 1 && val_s32 <= cameraInfo->maxBinning ) {
+        return OA_ERR_NONE;
+      }
+      break;
+
+    case OA_CAM_CTRL_EXPOSURE_ABSOLUTE:
+      val_s64 = val->int64;
+      if ( val_s64 >= commonInfo->OA_CAM_CTRL_MIN( control ) &&
+          val_s64 <= commonInfo->OA_CAM_CTRL_MAX( control )) {
+        return OA_ERR_NONE;
+      }
+      break;
+
+    case OA_CAM_CTRL_FRAME_FORMAT:
+      val_s32 = val->discrete;
+      if ( val_s32 >= 0 && val_s32 < OA_PIX_FMT_LAST_P1 &&
+          camera->frameFormats[ val_s32 ]) {
+        return OA_ERR_NONE;
+      }
+      break;
+
+    // This lot are all boolean, so we'll take any value
+    case OA_CAM_CTRL_HFLIP:
+    case OA_CAM_CTRL_VFLIP:
+    case OA_CAM_CTRL_MODE_AUTO( OA_CAM_CTRL_GAIN ):
+    case OA_CAM_CTRL_MODE_AUTO( OA_CAM_CTRL_EXPOSURE_ABSOLUTE ):
+    case OA_CAM_CTRL_PACKET_RESEND:
+    case OA_CAM_CTRL_DROPPED_RESET:
+      return OA_ERR_NONE;
+      break;
+
+    default:
+      // If we reach here it's because we don't recognise the control
+      oaLogError ( OA_LOG_CAMERA, "%s: Unrecognised control %d", __func__,
+					control );
+      return -OA_ERR_INVALID_CONTROL;
+      break;
+  }
+
+  // And if we reach here it's because the value wasn't valid
+  return -OA_ERR_OUT_OF_RANGE;
+}
@@ -0,0 +1,966 @@
+/*****************************************************************************
+ *
+ * araviscontroller.c -- Main controller for Aravis cameras
+ *
+ * Copyright 2026 James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <oa_common.h>
+
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/time.h>
+
+#include <openastro/camera.h>
+
+#include "oacamprivate.h"
+#include "unimplemented.h"
+#include "aravisprivate.h"
+#include "aravisoacam.h"
+#include "aravisstate.h"
+#include "aravisnodes.h"
+
+
+// How long to wait for a frame before going back to look for commands,
+// in microseconds
+
+#define	ARAVIS_FRAME_WAIT		20000
+
+static int	_processSetControl ( ARAVIS_STATE*, OA_COMMAND* );
+static int	_processGetControl ( ARAVIS_STATE*, OA_COMMAND* );
+static int	_processSetROI ( oaCamera*, OA_COMMAND* );
+static int	_setGeometry ( ARAVIS_STATE*, int64_t, int64_t, int64_t,
+								int64_t );
+static int	_processStreamingStart ( ARAVIS_STATE*, OA_COMMAND* );
+static int	_processStreamingStop ( ARAVIS_STATE*, OA_COMMAND* );
+static void	_queueFrame ( ARAVIS_STATE*, ArvBuffer* );
+static void	_stampReadout ( ARAVIS_STATE*, ArvBuffer*, int );
+static void	_getStreamStats ( ARAVIS_STATE*, uint64_t*, uint64_t*,
+								uint64_t*, uint64_t* );
+static void	_setStreamOptions ( ARAVIS_STATE* );
+static int	_doBinning ( ARAVIS_STATE*, int );
+static int	_doFrameFormat ( ARAVIS_STATE*, int );
+static int	_doPacketSize ( ARAVIS_STATE*, int );
+static int	_doStop ( ARAVIS_STATE* );
+static int	_doStart ( ARAVIS_STATE* );
+
+void*
+oacamAravisController ( void* param )
+{
+  oaCamera*							camera = param;
+  ARAVIS_STATE*					cameraInfo = camera->_private;
+  OA_COMMAND*						command;
+  int										exitThread = 0;
+  int										resultCode;
+  int										streaming = 0;
+	ArvBuffer*						buffer;
+
+  do {
+    pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
+    exitThread = cameraInfo->stopControllerThread;
+    pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
+    if ( exitThread ) {
+      break;
+    } else {
+      pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
+      // stop us busy-waiting
+      streaming = ( cameraInfo->runMode == CAM_RUN_MODE_STREAMING ) ? 1 : 0;
+      if ( !streaming && oaDLListIsEmpty ( cameraInfo->commandQueue )) {
+        pthread_cond_wait ( &cameraInfo->commandQueued,
+            &cameraInfo->commandQueueMutex );
+      }
+      pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
+    }
+    do {
+      command = oacamNextCommand ( cameraInfo );
+      if ( command ) {
+        switch ( command->commandType ) {
+          case OA_CMD_CONTROL_SET:
+            resultCode = _processSetControl ( cameraInfo, command );
+            break;
+          case OA_CMD_CONTROL_GET:
+            resultCode = _processGetControl ( cameraInfo, command );
+            break;
+					case OA_CMD_RESOLUTION_SET:
+          case OA_CMD_ROI_SET:
+            resultCode = _processSetROI ( camera, command );
+            break;
+          case OA_CMD_START_STREAMING:
+            resultCode = _processStreamingStart ( cameraInfo, command );
+            break;
+          case OA_CMD_STOP_STREAMING:
+            resultCode = _processStreamingStop ( cameraInfo, command );
+            break;
+          default:
+            oaLogWarning ( OA_LOG_CAMERA,
+								"%s: Invalid command type %d in controller", __func__,
+                command->commandType );
+            resultCode = -OA_ERR_INVALID_CONTROL;
+            break;
+        }
+        oacamCommandComplete ( cameraInfo, command, resultCode );
+      }
+    } while ( command );
+
+		pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
+		streaming = ( cameraInfo->runMode == CAM_RUN_MODE_STREAMING ) ? 1 : 0;
+		pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
+
+		if ( streaming ) {
+			// Every buffer the stream can hand back is one of ours, so there's
+			// no need to check for a free one first.  Once one frame has
+			// arrived, take any others that are already waiting before going
+			// back to look at the command queue
+			if (( buffer = p_arv_stream_timeout_pop_buffer ( cameraInfo->stream,
+					ARAVIS_FRAME_WAIT ))) {
+				do {
+					_queueFrame ( cameraInfo, buffer );
+				} while (( buffer = p_arv_stream_try_pop_buffer (
+						cameraInfo->stream )));
+			}
+		}
+
+  } while ( !exitThread );
+
+	// The callback thread is still running at this point, so it can hand
+	// back any frames it has before the stream is closed
+	if ( cameraInfo->runMode == CAM_RUN_MODE_STREAMING ) {
+		( void ) _doStop ( cameraInfo );
+	}
+
+  return 0;
+}
+
+
+/**
+ * Hand a buffer returned by the stream to the callback thread, or straight
+ * back to the stream if it doesn't hold a complete frame
+ */
+
+static void
+_queueFrame ( ARAVIS_STATE* cameraInfo, ArvBuffer* buffer )
+{
+	int						idx;
+	uint64_t			failed, underruns;
+	size_t				payload = 0;
+
+	idx = ( int )( intptr_t ) p_arv_buffer_get_user_data ( buffer );
+
+	if ( p_arv_buffer_get_status ( buffer ) != ARV_BUFFER_STATUS_SUCCESS ) {
+		p_arv_stream_push_buffer ( cameraInfo->stream, buffer );
+		_getStreamStats ( cameraInfo, 0, &failed, &underruns, 0 );
+		OA_CONTROL_MIRROR_READONLY ( cameraInfo, OA_CAM_CTRL_DROPPED,
+				failed + underruns - cameraInfo->droppedBase );
+		OA_FRAME_STATS_DROPPED ( cameraInfo );
+		return;
+	}
+
+	// The payload may be short of a full frame, or carry chunk data after
+	// the image, so only hand on what was received of the image itself
+	( void ) p_arv_buffer_get_data ( buffer, &payload );
+	if ( payload > cameraInfo->imageBufferLength ) {
+		payload = cameraInfo->imageBufferLength;
+	}
+	_stampReadout ( cameraInfo, buffer, idx );
+
+	cameraInfo->frameCallbacks[ idx ].callbackType = OA_CALLBACK_NEW_FRAME;
+	cameraInfo->frameCallbacks[ idx ].callback =
+			cameraInfo->streamingCallback.callback;
+	cameraInfo->frameCallbacks[ idx ].callbackArg =
+			cameraInfo->streamingCallback.callbackArg;
+	cameraInfo->frameCallbacks[ idx ].buffer = cameraInfo->buffers[ idx ].start;
+	cameraInfo->frameCallbacks[ idx ].bufferLen = payload;
+	cameraInfo->frameCallbacks[ idx ].bufferIdx = idx;
+	cameraInfo->frameCallbacks[ idx ].metadata = 0;
+	pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
+	OA_FRAME_STATS_QUEUED ( cameraInfo, idx );
+	oaDLListAddToTail ( cameraInfo->callbackQueue,
+			&cameraInfo->frameCallbacks[ idx ]);
+	cameraInfo->buffersFree--;
+	pthread_mutex_unlock ( &cameraInfo->callbackQueueMutex );
+	pthread_cond_broadcast ( &cameraInfo->callbackQueued );
+}
+
+
+/**
+ * Record when the frame arrived, so its timestamp isn't the time it was
+ * popped from the stream.  Aravis gives the host time the buffer was
+ * filled where it can.  Otherwise all there is is the camera's own clock,
+ * which is tied to the host clock at the first frame of the stream and
+ * again whenever it would put a frame in the future.
+ */
+
+static void
+_stampReadout ( ARAVIS_STATE* cameraInfo, ArvBuffer* buffer, int idx )
+{
+	oaTimestamp		now;
+	uint64_t			host, device, readout;
+
+	oaTimestampNow ( &now );
+	host = p_arv_buffer_get_system_timestamp ( buffer );
+	device = p_arv_buffer_get_timestamp ( buffer );
+
+	readout = now.monotonic;
+	if ( host && ( int64_t ) host <= now.utc &&
+			( uint64_t )( now.utc - ( int64_t ) host ) < now.monotonic ) {
+		readout = now.monotonic - ( uint64_t )( now.utc - ( int64_t ) host );
+	} else if ( device ) {
+		if ( cameraInfo->deviceTimeBase && device >= cameraInfo->deviceTimeBase ) {
+			readout = cameraInfo->hostTimeBase +
+					( device - cameraInfo->deviceTimeBase );
+		}
+		if ( readout >= now.monotonic ) {
+			readout = now.monotonic;
+			cameraInfo->deviceTimeBase = device;
+			cameraInfo->hostTimeBase = readout;
+		}
+	}
+	OA_FRAME_STATS_STAMP_AT ( cameraInfo, idx, OA_FRAME_STAGE_READOUT, readout );
+}
+
+
+/**
+ * Stream statistics since the camera was opened.  Aravis only counts for
+ * the lifetime of a stream, so add on whatever was saved from the streams
+ * that have already been closed.  Any of the results may be NULL
+ */
+
+static void
+_getStreamStats ( ARAVIS_STATE* cameraInfo, uint64_t* completed,
+		uint64_t* failed, uint64_t* underruns, uint64_t* resent )
+{
+	guint64			nCompleted = 0, nFailed = 0, nUnderruns = 0;
+	guint64			nResent = 0, nMissing = 0;
+
+	if ( cameraInfo->stream ) {
+		p_arv_stream_get_statistics ( cameraInfo->stream, &nCompleted, &nFailed,
+				&nUnderruns );
+		if ( cameraInfo->isGigE ) {
+			p_arv_gv_stream_get_statistics (( ArvGvStream* ) cameraInfo->stream,
+					&nResent, &nMissing );
+		}
+	}
+	if ( completed ) {
+		*completed = cameraInfo->completedFrames + nCompleted;
+	}
+	if ( failed ) {
+		*failed = cameraInfo->failedFrames + nFailed;
+	}
+	if ( underruns ) {
+		*underruns = cameraInfo->underruns + nUnderruns;
+	}
+	if ( resent ) {
+		*resent = cameraInfo->resentPackets + nResent;
+	}
+}
+
+
+/**
+ * Apply the receive-side GigE settings to the stream, if there is one
+ */
+
+static void
+_setStreamOptions ( ARAVIS_STATE* cameraInfo )
+{
+	if ( !cameraInfo->stream || !cameraInfo->isGigE ) {
+		return;
+	}
+	p_g_object_set ( cameraInfo->stream, "packet-resend",
+			cameraInfo->packetResend ? ARV_GV_STREAM_PACKET_RESEND_ALWAYS :
+			ARV_GV_STREAM_PACKET_RESEND_NEVER, NULL );
+	if ( cameraInfo->socketBufferSize ) {
+		p_g_object_set ( cameraInfo->stream, "socket-buffer",
+				ARV_GV_STREAM_SOCKET_BUFFER_FIXED, "socket-buffer-size",
+				cameraInfo->socketBufferSize, NULL );
+	} else {
+		p_g_object_set ( cameraInfo->stream, "socket-buffer",
+				ARV_GV_STREAM_SOCKET_BUFFER_AUTO, NULL );
+	}
+}
+
+
+static int
+_processSetControl ( ARAVIS_STATE* cameraInfo, OA_COMMAND* command )
+{
+  oaControlValue	*val = command->commandData;
+  int							control = command->controlId;
+	int							ret = OA_ERR_NONE;
+
+	switch ( control ) {
+
+		case OA_CAM_CTRL_BINNING:
+			if ( OA_CTRL_TYPE_INT32 != val->valueType ) {
+				oaLogError ( OA_LOG_CAMERA,
+						"%s: invalid control type %d where int32 expected", __func__,
+						val->valueType );
+				return -OA_ERR_INVALID_CONTROL_TYPE;
+			}
+			return _doBinning ( cameraInfo, val->int32 );
+			break;
+
+		case OA_CAM_CTRL_HFLIP:
+		case OA_CAM_CTRL_VFLIP:
+			if ( OA_CTRL_TYPE_BOOLEAN != val->valueType ) {
+				oaLogError ( OA_LOG_CAMERA,
+						"%s: invalid control type %d where bool expected", __func__,
+						val->valueType );
+				return -OA_ERR_INVALID_CONTROL_TYPE;
+			}
+			ret = _aravisSetBool ( cameraInfo->device, ( control ==
+					OA_CAM_CTRL_HFLIP ) ? "ReverseX" : "ReverseY", val->boolean );
+			break;
+
+		case OA_CAM_CTRL_GAIN:
+			if ( OA_CTRL_TYPE_INT32 != val->valueType ) {
+				oaLogError ( OA_LOG_CAMERA,
+						"%s: invalid control type %d where int32 expected", __func__,
+						val->valueType );
+				return -OA_ERR_INVALID_CONTROL_TYPE;
+			}
+			if ( cameraInfo->gainIsFloat ) {
+				ret = _aravisSetFloat ( cameraInfo->device, cameraInfo->gainName,
+						( double ) val->int32 );
+			} else {
+				ret = _aravisSetInt ( cameraInfo->device, cameraInfo->gainName,
+						val->int32 );
+			}
+			break;
+
+		case OA_CAM_CTRL_MODE_AUTO( OA_CAM_CTRL_GAIN ):
+			if ( OA_CTRL_TYPE_BOOLEAN != val->valueType ) {
+				oaLogError ( OA_LOG_CAMERA,
+						"%s: invalid control type %d where bool expected", __func__,
+						val->valueType );
+				return -OA_ERR_INVALID_CONTROL_TYPE;
+			}
+			ret = _aravisSetEnum ( cameraInfo->device, "GainAuto",
+					val->boolean ? "Continuous" : "Off" );
+			break;
+
+		case OA_CAM_CTRL_EXPOSURE_ABSOLUTE:
+			if ( OA_CTRL_TYPE_INT64 != val->valueType ) {
+				oaLogError ( OA_LOG_CAMERA,
+						"%s: invalid control type %d where int64 expected", __func__,
+						val->valueType );
+				return -OA_ERR_INVALID_CONTROL_TYPE;
+			}
+			if ( cameraInfo->exposureIsFloat ) {
+				ret = _aravisSetFloat ( cameraInfo->device,
+						cameraInfo->exposureTimeName, ( double ) val->int64 );
+			} else {
+				ret = _aravisSetInt ( cameraInfo->device,
+						cameraInfo->exposureTimeName, val->int64 );
+			}
+			break;
+
+		case OA_CAM_CTRL_MODE_AUTO( OA_CAM_CTRL_EXPOSURE_ABSOLUTE ):
+			if ( OA_CTRL_TYPE_BOOLEAN != val->valueType ) {
+				oaLogError ( OA_LOG_CAMERA,
+						"%s: invalid control type %d where bool expected", __func__,
+						val->valueType );
+				return -OA_ERR_INVALID_CONTROL_TYPE;
+			}
+			ret = _aravisSetEnum ( cameraInfo->device, "ExposureAuto",
+					val->boolean ? "Continuous" : "Off" );
+			break;
+
+		case OA_CAM_CTRL_FRAME_FORMAT:
+			if ( OA_CTRL_TYPE_DISCRETE != val->valueType ) {
+				oaLogError ( OA_LOG_CAMERA,
+						"%s: invalid control type %d where discrete expected",
+          __func__, val->valueType );
+				return -OA_ERR_INVALID_CONTROL_TYPE;
+			}
+			return _doFrameFormat ( cameraInfo, val->discrete );
+			break;
+
+		case OA_CAM_CTRL_PACKET_SIZE:
+			if ( OA_CTRL_TYPE_INT32 != val->valueType ) {
+				oaLogError ( OA_LOG_CAMERA,
+						"%s: invalid control type %d where int32 expected", __func__,
+						val->valueType );
+				return -OA_ERR_INVALID_CONTROL_TYPE;
+			}
+			return _doPacketSize ( cameraInfo, val->int32 );
+			break;
+
+		case OA_CAM_CTRL_PACKET_DELAY:
+			if ( OA_CTRL_TYPE_INT32 != val->valueType ) {
+				oaLogError ( OA_LOG_CAMERA,
+						"%s: invalid control type %d where int32 expected", __func__,
+						val->valueType );
+				return -OA_ERR_INVALID_CONTROL_TYPE;
+			}
+			ret = _aravisSetInt ( cameraInfo->device, "GevSCPD", val->int32 );
+			break;
+
+		case OA_CAM_CTRL_SOCKET_BUFFER_SIZE:
+			if ( OA_CTRL_TYPE_INT32 != val->valueType ) {
+				oaLogError ( OA_LOG_CAMERA,
+						"%s: invalid control type %d where int32 expected", __func__,
+						val->valueType );
+				return -OA_ERR_INVALID_CONTROL_TYPE;
+			}
+			cameraInfo->socketBufferSize = val->int32;
+			_setStreamOptions ( cameraInfo );
+			break;
+
+		case OA_CAM_CTRL_PACKET_RESEND:
+			if ( OA_CTRL_TYPE_BOOLEAN != val->valueType ) {
+				oaLogError ( OA_LOG_CAMERA,
+						"%s: invalid control type %d where bool expected", __func__,
+						val->valueType );
+				return -OA_ERR_INVALID_CONTROL_TYPE;
+			}
+			cameraInfo->packetResend = val->boolean ? 1 : 0;
+			_setStreamOptions ( cameraInfo );
+			break;
+
+		case OA_CAM_CTRL_DROPPED_RESET:
+		{
+			uint64_t		failed, underruns;
+
+			_getStreamStats ( cameraInfo, 0, &failed, &underruns, 0 );
+			cameraInfo->droppedBase = failed + underruns;
+			break;
+		}
+		default:
+			oaLogError ( OA_LOG_CAMERA, "%s: Unrecognised control %d", __func__,
+					control );
+			return -OA_ERR_INVALID_CONTROL;
+			break;
+  }
+
+	return ret;
+}
+
+
+static int
+_processGetControl ( ARAVIS_STATE* cameraInfo, OA_COMMAND* command )
+{
+  int							control = command->controlId;
+  oaControlValue*	val = command->resultData;
+	int							ret = OA_ERR_NONE;
+
+	switch ( control ) {
+
+		case OA_CAM_CTRL_BINNING:
+		{
+			int64_t		curr = 1;
+
+			val->valueType = OA_CTRL_TYPE_INT32;
+			// Just get the horizontal value here as we don't currently support
+			// binning differently in each direction
+			ret = _aravisGetInt ( cameraInfo->device, "BinningHorizontal", &curr );
+			val->int32 = curr;
+			break;
+		}
+		case OA_CAM_CTRL_HFLIP:
+		case OA_CAM_CTRL_VFLIP:
+		{
+			int				curr = 0;
+
+			val->valueType = OA_CTRL_TYPE_BOOLEAN;
+			ret = _aravisGetBool ( cameraInfo->device, ( control ==
+					OA_CAM_CTRL_HFLIP ) ? "ReverseX" : "ReverseY", &curr );
+			val->boolean = curr ? 1 : 0;
+			break;
+		}
+		case OA_CAM_CTRL_GAIN:
+		{
+			int64_t		curr = 0;
+			double		fcurr;
+
+			val->valueType = OA_CTRL_TYPE_INT32;
+			if ( cameraInfo->gainIsFloat ) {
+				if (( ret = _aravisGetFloat ( cameraInfo->device,
+						cameraInfo->gainName, &fcurr )) == OA_ERR_NONE ) {
+					curr = ( int64_t )( fcurr + 0.5 );
+				}
+			} else {
+				ret = _aravisGetInt ( cameraInfo->device, cameraInfo->gainName,
+						&curr );
+			}
+			val->int32 = curr;
+			break;
+		}
+		case OA_CAM_CTRL_EXPOSURE_ABSOLUTE:
+		{
+			int64_t		curr = 0;
+			double		fcurr;
+
+			val->valueType = OA_CTRL_TYPE_INT64;
+			if ( cameraInfo->exposureIsFloat ) {
+				if (( ret = _aravisGetFloat ( cameraInfo->device,
+						cameraInfo->exposureTimeName, &fcurr )) == OA_ERR_NONE ) {
+					curr = ( int64_t )( fcurr + 0.5 );
+				}
+			} else {
+				ret = _aravisGetInt ( cameraInfo->device,
+						cameraInfo->exposureTimeName, &curr );
+			}
+			val->int64 = curr;
+			break;
+		}
+		case OA_CAM_CTRL_MODE_AUTO( OA_CAM_CTRL_GAIN ):
+		case OA_CAM_CTRL_MODE_AUTO( OA_CAM_CTRL_EXPOSURE_ABSOLUTE ):
+		{
+			char			curr[64];
+
+			val->valueType = OA_CTRL_TYPE_BOOLEAN;
+			ret = _aravisGetEnum ( cameraInfo->device, ( control ==
+					OA_CAM_CTRL_MODE_AUTO( OA_CAM_CTRL_GAIN )) ? "GainAuto" :
+					"ExposureAuto", curr, sizeof ( curr ));
+			val->boolean = ( ret == OA_ERR_NONE && !strcmp ( curr, "Continuous" ));
+			break;
+		}
+		case OA_CAM_CTRL_FRAME_FORMAT:
+			val->valueType = OA_CTRL_TYPE_DISCRETE;
+			val->discrete = cameraInfo->currentFrameFormat;
+			break;
+
+		case OA_CAM_CTRL_PACKET_SIZE:
+		case OA_CAM_CTRL_PACKET_DELAY:
+		{
+			int64_t		curr = 0;
+
+			val->valueType = OA_CTRL_TYPE_INT32;
+			ret = _aravisGetInt ( cameraInfo->device, ( control ==
+					OA_CAM_CTRL_PACKET_SIZE ) ? "GevSCPSPacketSize" : "GevSCPD", &curr );
+			val->int32 = curr;
+			break;
+		}
+		case OA_CAM_CTRL_SOCKET_BUFFER_SIZE:
+			val->valueType = OA_CTRL_TYPE_INT32;
+			val->int32 = cameraInfo->socketBufferSize;
+			break;
+
+		case OA_CAM_CTRL_PACKET_RESEND:
+			val->valueType = OA_CTRL_TYPE_BOOLEAN;
+			val->boolean = cameraInfo->packetResend;
+			break;
+
+		case OA_CAM_CTRL_FRAMES_COMPLETED:
+		case OA_CAM_CTRL_FRAMES_FAILED:
+		case OA_CAM_CTRL_PACKETS_RESENT:
+		case OA_CAM_CTRL_DROPPED:
+		{
+			uint64_t	completed, failed, underruns, resent;
+
+			_getStreamStats ( cameraInfo, &completed, &failed, &underruns,
+					&resent );
+			val->valueType = OA_CTRL_TYPE_READONLY;
+			switch ( control ) {
+				case OA_CAM_CTRL_FRAMES_COMPLETED:
+					val->readonly = completed;
+					break;
+				case OA_CAM_CTRL_FRAMES_FAILED:
+					val->readonly = failed;
+					break;
+				case OA_CAM_CTRL_PACKETS_RESENT:
+					val->readonly = resent;
+					break;
+				default:
+					val->readonly = failed + underruns - cameraInfo->droppedBase;
+					break;
+			}
+			break;
+		}
+		default:
+			oaLogError ( OA_LOG_CAMERA, "%s: Unrecognised control %d", __func__,
+					control );
+			return -OA_ERR_INVALID_CONTROL;
+			break;
+  }
+
+  return ret;
+}
+
+
+static int
+_processSetROI ( oaCamera* camera, OA_COMMAND* command )
+{
+	ARAVIS_STATE*	cameraInfo = camera->_private;
+  FRAMESIZE*		size = command->commandData;
+	unsigned int	maxX, maxY, offsetX, offsetY;
+  unsigned int	restart = 0;
+	int64_t				oldOffsetX = 0, oldOffsetY = 0;
+	int						ret, startRet;
+
+	if (!( camera->features.flags & OA_CAM_FEATURE_ROI )) {
+		return -OA_ERR_INVALID_CONTROL;
+	}
+
+  if ( size->x == cameraInfo->xSize && size->y == cameraInfo->ySize ) {
+    return OA_ERR_NONE;
+  }
+
+	if ( size->x < ( unsigned int ) cameraInfo->minResolutionX ||
+			size->y < ( unsigned int ) cameraInfo->minResolutionY ) {
+		return -OA_ERR_OUT_OF_RANGE;
+	}
+	if (( size->x - cameraInfo->minResolutionX ) % cameraInfo->xSizeStep != 0 ) {
+		return -OA_ERR_OUT_OF_RANGE;
+  }
+	if (( size->y - cameraInfo->minResolutionY ) % cameraInfo->ySizeStep != 0 ) {
+		return -OA_ERR_OUT_OF_RANGE;
+  }
+
+	maxX = cameraInfo->maxResolutionX / cameraInfo->binMode;
+	maxY = cameraInfo->maxResolutionY / cameraInfo->binMode;
+	if ( size->x > maxX || size->y > maxY ) {
+		return -OA_ERR_OUT_OF_RANGE;
+	}
+	offsetX = ( maxX - size->x ) / 2;
+	offsetY = ( maxY - size->y ) / 2;
+
+  if ( cameraInfo->runMode == CAM_RUN_MODE_STREAMING ) {
+    restart = 1;
+    _doStop ( cameraInfo );
+  }
+
+	( void ) _aravisGetInt ( cameraInfo->device, "OffsetX", &oldOffsetX );
+	( void ) _aravisGetInt ( cameraInfo->device, "OffsetY", &oldOffsetY );
+
+	if (( ret = _setGeometry ( cameraInfo, size->x, size->y, offsetX,
+			offsetY )) == OA_ERR_NONE ) {
+		cameraInfo->xSize = size->x;
+		cameraInfo->ySize = size->y;
+		cameraInfo->imageBufferLength = size->x * size->y *
+				cameraInfo->currentBytesPerPixel;
+	} else {
+		// Put back what we had so the frame size we report stays true
+		oaLogError ( OA_LOG_CAMERA, "%s: camera rejected ROI %ux%u", __func__,
+				size->x, size->y );
+		( void ) _setGeometry ( cameraInfo, cameraInfo->xSize,
+				cameraInfo->ySize, oldOffsetX, oldOffsetY );
+	}
+
+  if ( restart ) {
+    if (( startRet = _doStart ( cameraInfo )) != OA_ERR_NONE &&
+				ret == OA_ERR_NONE ) {
+			ret = startRet;
+		}
+  }
+
+  return ret;
+}
+
+
+/**
+ * Set the frame size and offsets, clearing the offsets first so the new
+ * size is always allowed
+ */
+
+static int
+_setGeometry ( ARAVIS_STATE* cameraInfo, int64_t x, int64_t y,
+		int64_t offsetX, int64_t offsetY )
+{
+	int			ret;
+
+	( void ) _aravisSetInt ( cameraInfo->device, "OffsetX", 0 );
+	( void ) _aravisSetInt ( cameraInfo->device, "OffsetY", 0 );
+	if (( ret = _aravisSetInt ( cameraInfo->device, "Width", x )) !=
+			OA_ERR_NONE ) {
+		return ret;
+	}
+	if (( ret = _aravisSetInt ( cameraInfo->device, "Height", y )) !=
+			OA_ERR_NONE ) {
+		return ret;
+	}
+	if (( ret = _aravisSetInt ( cameraInfo->device, "OffsetX", offsetX )) !=
+			OA_ERR_NONE ) {
+		return ret;
+	}
+	return _aravisSetInt ( cameraInfo->device, "OffsetY", offsetY );
+}
+
+
+static int
+_processStreamingStart ( ARAVIS_STATE* cameraInfo, OA_COMMAND* command )
+{
+  CALLBACK*		cb = command->commandData;
+
+  if ( cameraInfo->runMode != CAM_RUN_MODE_STOPPED ) {
+    return -OA_ERR_INVALID_COMMAND;
+  }
+
+  cameraInfo->streamingCallback.callback = cb->callback;
+  cameraInfo->streamingCallback.callbackArg = cb->callbackArg;
+
+	if ( _aravisSetEnum ( cameraInfo->device, "AcquisitionMode",
+			"Continuous" ) != OA_ERR_NONE ) {
+		return -OA_ERR_SYSTEM_ERROR;
+	}
+
+  return _doStart ( cameraInfo );
+}
+
+
+/**
+ * Create the stream and give it all of our frame buffers.  The stream
+ * writes each frame straight into one of the buffers that is then passed
+ * to the callback, so there's no copying of frame data after it arrives
+ */
+
+static int
+_doStart ( ARAVIS_STATE* cameraInfo )
+{
+	int64_t					payloadSize;
+	void*						newBuffer;
+	int							i;
+#ifdef ARAVIS_V08
+	GError*					error = 0;
+#endif
+
+	if ( _aravisGetInt ( cameraInfo->device, "PayloadSize", &payloadSize ) !=
+			OA_ERR_NONE || payloadSize <= 0 ) {
+		oaLogError ( OA_LOG_CAMERA, "%s: can't get payload size", __func__ );
+		return -OA_ERR_SYSTEM_ERROR;
+	}
+
+	for ( i = 0; i < OA_CAM_BUFFERS; i++ ) {
+		if ( cameraInfo->buffers[i].length < ( size_t ) payloadSize ) {
+			if (!( newBuffer = realloc ( cameraInfo->buffers[i].start,
+					payloadSize ))) {
+				oaLogError ( OA_LOG_CAMERA, "%s: buffer realloc failed", __func__ );
+				return -OA_ERR_MEM_ALLOC;
+			}
+			cameraInfo->buffers[i].start = newBuffer;
+			cameraInfo->buffers[i].length = payloadSize;
+		}
+	}
+
+#ifdef ARAVIS_V08
+	cameraInfo->stream = p_arv_device_create_stream ( cameraInfo->device, 0, 0,
+			&error );
+	if ( error ) {
+		oaLogError ( OA_LOG_CAMERA, "%s: arv_device_create_stream failed: %s",
+				__func__, error->message );
+		p_g_error_free ( error );
+	}
+#else
+	cameraInfo->stream = p_arv_device_create_stream ( cameraInfo->device, 0,
+			0 );
+#endif
+	if ( !cameraInfo->stream ) {
+		oaLogError ( OA_LOG_CAMERA, "%s: can't create stream", __func__ );
+		return -OA_ERR_SYSTEM_ERROR;
+	}
+	_setStreamOptions ( cameraInfo );
+	cameraInfo->deviceTimeBase = cameraInfo->hostTimeBase = 0;
+
+	// We keep one reference to each ArvBuffer for ourselves.  The stream
+	// takes over the other each time the buffer is pushed to it, and gives
+	// it back when the buffer is popped
+	for ( i = 0; i < OA_CAM_BUFFERS; i++ ) {
+		cameraInfo->arvBuffers[i] = p_arv_buffer_new_full ( payloadSize,
+				cameraInfo->buffers[i].start, ( void* )( intptr_t ) i, 0 );
+		p_arv_stream_push_buffer ( cameraInfo->stream,
+				p_g_object_ref ( cameraInfo->arvBuffers[i] ));
+	}
+
+	if ( _aravisExecute ( cameraInfo->device, "AcquisitionStart" ) !=
+			OA_ERR_NONE ) {
+		p_g_object_unref ( cameraInfo->stream );
+		cameraInfo->stream = 0;
+		for ( i = 0; i < OA_CAM_BUFFERS; i++ ) {
+			p_g_object_unref ( cameraInfo->arvBuffers[i] );
+			cameraInfo->arvBuffers[i] = 0;
+		}
+		return -OA_ERR_SYSTEM_ERROR;
+	}
+
+  pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
+  cameraInfo->runMode = CAM_RUN_MODE_STREAMING;
+  pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
+
+  return OA_ERR_NONE;
+}
+
+
+static int
+_processStreamingStop ( ARAVIS_STATE* cameraInfo, OA_COMMAND* command )
+{
+  if ( cameraInfo->runMode != CAM_RUN_MODE_STREAMING ) {
+    return -OA_ERR_INVALID_COMMAND;
+  }
+
+  return _doStop ( cameraInfo );
+}
+
+
+static int
+_doStop ( ARAVIS_STATE* cameraInfo )
+{
+	guint64			nCompleted = 0, nFailed = 0, nUnderruns = 0;
+	guint64			nResent = 0, nMissing = 0;
+	int					i, ret = OA_ERR_NONE;
+
+  pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
+  cameraInfo->runMode = CAM_RUN_MODE_STOPPED;
+  pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
+
+	if ( _aravisExecute ( cameraInfo->device, "AcquisitionStop" ) !=
+			OA_ERR_NONE ) {
+		ret = -OA_ERR_SYSTEM_ERROR;
+	}
+
+	// The callback thread won't give frames back to the stream now, so once
+	// it has finished with them all the stream can go
+	_oaWaitForBuffers ( cameraInfo, cameraInfo->configuredBuffers );
+
+	p_arv_stream_get_statistics ( cameraInfo->stream, &nCompleted, &nFailed,
+			&nUnderruns );
+	if ( cameraInfo->isGigE ) {
+		p_arv_gv_stream_get_statistics (( ArvGvStream* ) cameraInfo->stream,
+				&nResent, &nMissing );
+	}
+	cameraInfo->completedFrames += nCompleted;
+	cameraInfo->failedFrames += nFailed;
+	cameraInfo->underruns += nUnderruns;
+	cameraInfo->resentPackets += nResent;
+
+	// Dropping the stream also drops its references to any buffers still
+	// queued on it
+	p_g_object_unref ( cameraInfo->stream );
+	cameraInfo->stream = 0;
+	for ( i = 0; i < OA_CAM_BUFFERS; i++ ) {
+		p_g_object_unref ( cameraInfo->arvBuffers[i] );
+		cameraInfo->arvBuffers[i] = 0;
+	}
+
+  return ret;
+}
+
+
+static int
+_doBinning ( ARAVIS_STATE* cameraInfo, int binMode )
+{
+	int				oldBinMode = cameraInfo->binMode;
+	int				restart = 0, err = OA_ERR_NONE, ret;
+	int64_t		val;
+
+	if ( binMode < 1 || binMode > cameraInfo->maxBinning ) {
+		return -OA_ERR_OUT_OF_RANGE;
+	}
+
+  if ( cameraInfo->runMode == CAM_RUN_MODE_STREAMING ) {
+    restart = 1;
+    _doStop ( cameraInfo );
+  }
+
+	if ( _aravisSetInt ( cameraInfo->device, "BinningHorizontal", binMode ) !=
+			OA_ERR_NONE ) {
+		err = OA_ERR_SYSTEM_ERROR;
+	} else {
+		if ( _aravisSetInt ( cameraInfo->device, "BinningVertical", binMode ) !=
+				OA_ERR_NONE ) {
+			( void ) _aravisSetInt ( cameraInfo->device, "BinningHorizontal",
+					oldBinMode );
+			err = OA_ERR_SYSTEM_ERROR;
+		} else {
+			if ( _aravisGetInt ( cameraInfo->device, "Width", &val ) ==
+					OA_ERR_NONE ) {
+				cameraInfo->xSize = val;
+			}
+			if ( _aravisGetInt ( cameraInfo->device, "Height", &val ) ==
+					OA_ERR_NONE ) {
+				cameraInfo->ySize = val;
+			}
+			cameraInfo->binMode = binMode;
+			cameraInfo->imageBufferLength = cameraInfo->xSize *
+					cameraInfo->ySize * cameraInfo->currentBytesPerPixel;
+		}
+	}
+
+  if ( restart ) {
+    if (( ret = _doStart ( cameraInfo )) != OA_ERR_NONE && !err ) {
+			return ret;
+		}
+  }
+
+  return -err;
+}
+
+
+static int
+_doFrameFormat ( ARAVIS_STATE* cameraInfo, int format )
+{
+  int							restart = 0, ret, startRet;
+	const char*			arvFormat;
+
+	if ( format < 0 || format >= OA_PIX_FMT_LAST_P1 ||
+			!( arvFormat = cameraInfo->pixelFormatNames[ format ])) {
+		return -OA_ERR_OUT_OF_RANGE;
+	}
+
+  if ( cameraInfo->runMode == CAM_RUN_MODE_STREAMING ) {
+    restart = 1;
+    _doStop ( cameraInfo );
+  }
+
+	if (( ret = _aravisSetEnum ( cameraInfo->device, "PixelFormat",
+			arvFormat )) == OA_ERR_NONE ) {
+		cameraInfo->currentFrameFormat = format;
+		cameraInfo->currentBytesPerPixel = oaFrameFormats[ format ].bytesPerPixel;
+		cameraInfo->imageBufferLength = cameraInfo->xSize * cameraInfo->ySize *
+				cameraInfo->currentBytesPerPixel;
+	}
+
+  if ( restart ) {
+    if (( startRet = _doStart ( cameraInfo )) != OA_ERR_NONE &&
+				ret == OA_ERR_NONE ) {
+			ret = startRet;
+		}
+  }
+
+  return ret;
+}
+
+
+/**
+ * The camera won't usually accept a new packet size whilst it's sending,
+ * so the stream has to be stopped to change it
+ */
+
+static int
+_doPacketSize ( ARAVIS_STATE* cameraInfo, int packetSize )
+{
+  int							restart = 0, ret, startRet;
+
+  if ( cameraInfo->runMode == CAM_RUN_MODE_STREAMING ) {
+    restart = 1;
+    _doStop ( cameraInfo );
+  }
+
+	ret = _aravisSetInt ( cameraInfo->device, "GevSCPSPacketSize", packetSize );
+
+  if ( restart ) {
+    if (( startRet = _doStart ( cameraInfo )) != OA_ERR_NONE &&
+				ret == OA_ERR_NONE ) {
+			ret = startRet;
+		}
+  }
+
+  return ret;
+}
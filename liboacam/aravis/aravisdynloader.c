@@ -0,0 +1,470 @@
+/*****************************************************************************
+ *
+ * aravisdynloader.c -- load the Aravis library at runtime
+ *
+ * Copyright 2026 James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <oa_common.h>
+
+#if HAVE_LIBDL
+#if HAVE_DLFCN_H
+#include <dlfcn.h>
+#endif
+#endif
+
+#include <openastro/errno.h>
+#include <openastro/util.h>
+
+#include "oacamprivate.h"
+#include "aravisprivate.h"
+
+// Pointers to Aravis functions so we can use them via libdl.
+
+void						( *p_arv_update_device_list )( void );
+unsigned int		( *p_arv_get_n_devices )( void );
+const char*		( *p_arv_get_device_id )( unsigned int );
+const char*		( *p_arv_get_device_vendor )( unsigned int );
+const char*		( *p_arv_get_device_model )( unsigned int );
+
+#ifdef ARAVIS_V08
+ArvDevice*			( *p_arv_open_device )( const char*, GError** );
+ArvStream*			( *p_arv_device_create_stream )( ArvDevice*,
+													ArvStreamCallback, void*, GError** );
+#else
+ArvDevice*			( *p_arv_open_device )( const char* );
+ArvStream*			( *p_arv_device_create_stream )( ArvDevice*,
+													ArvStreamCallback, void* );
+#endif
+ArvGcNode*			( *p_arv_device_get_feature )( ArvDevice*, const char* );
+
+gboolean				( *p_arv_gc_feature_node_is_available )(
+													ArvGcFeatureNode*, GError** );
+gboolean				( *p_arv_gc_feature_node_is_implemented )(
+													ArvGcFeatureNode*, GError** );
+gboolean				( *p_arv_gc_feature_node_is_locked )(
+													ArvGcFeatureNode*, GError** );
+GType					( *p_arv_gc_feature_node_get_value_type )(
+													ArvGcFeatureNode* );
+
+gint64					( *p_arv_gc_integer_get_min )( ArvGcInteger*, GError** );
+gint64					( *p_arv_gc_integer_get_max )( ArvGcInteger*, GError** );
+gint64					( *p_arv_gc_integer_get_inc )( ArvGcInteger*, GError** );
+gint64					( *p_arv_gc_integer_get_value )( ArvGcInteger*,
+													GError** );
+void						( *p_arv_gc_integer_set_value )( ArvGcInteger*, gint64,
+													GError** );
+double					( *p_arv_gc_float_get_min )( ArvGcFloat*, GError** );
+double					( *p_arv_gc_float_get_max )( ArvGcFloat*, GError** );
+double					( *p_arv_gc_float_get_value )( ArvGcFloat*, GError** );
+void						( *p_arv_gc_float_set_value )( ArvGcFloat*, double,
+													GError** );
+gboolean				( *p_arv_gc_boolean_get_value )( ArvGcBoolean*,
+													GError** );
+void						( *p_arv_gc_boolean_set_value )( ArvGcBoolean*,
+													gboolean, GError** );
+const char*		( *p_arv_gc_enumeration_get_string_value )(
+													ArvGcEnumeration*, GError** );
+void						( *p_arv_gc_enumeration_set_string_value )(
+													ArvGcEnumeration*, const char*, GError** );
+const char**		( *p_arv_gc_enumeration_get_available_string_values )(
+													ArvGcEnumeration*, guint*, GError** );
+void						( *p_arv_gc_command_execute )( ArvGcCommand*,
+													GError** );
+
+ArvBuffer*			( *p_arv_buffer_new_full )( size_t, void*, void*,
+													GDestroyNotify );
+ArvBufferStatus	( *p_arv_buffer_get_status )( ArvBuffer* );
+const void*		( *p_arv_buffer_get_user_data )( ArvBuffer* );
+const void*		( *p_arv_buffer_get_data )( ArvBuffer*, size_t* );
+guint64				( *p_arv_buffer_get_timestamp )( ArvBuffer* );
+guint64				( *p_arv_buffer_get_system_timestamp )( ArvBuffer* );
+
+void						( *p_arv_stream_push_buffer )( ArvStream*, ArvBuffer* );
+ArvBuffer*			( *p_arv_stream_timeout_pop_buffer )( ArvStream*,
+													guint64 );
+ArvBuffer*			( *p_arv_stream_try_pop_buffer )( ArvStream* );
+void						( *p_arv_stream_get_statistics )( ArvStream*, guint64*,
+													guint64*, guint64* );
+void						( *p_arv_gv_stream_get_statistics )( ArvGvStream*,
+													guint64*, guint64* );
+
+// GLib and GObject functions are found through libaravis's dependencies
+
+gpointer				( *p_g_object_ref )( gpointer );
+void						( *p_g_object_unref )( gpointer );
+void						( *p_g_object_set )( gpointer, const gchar*, ... );
+void						( *p_g_error_free )( GError* );
+void						( *p_g_free )( gpointer );
+
+#if HAVE_LIBDL
+static void*		_getDLSym ( void*, const char* );
+#endif
+
+/**
+ * Load libaravis and find all the functions we need from it
+ */
+
+int
+_aravisInitLibraryFunctionPointers ( void )
+{
+#if HAVE_LIBDL
+  static void*		libHandle = 0;
+
+	dlerror();
+  if ( !libHandle ) {
+    if (!( libHandle = dlopen ( ARAVIS_NAME, RTLD_LAZY ))) {
+      oaLogWarning ( OA_LOG_CAMERA, "%s: can't load %s, error '%s'", __func__,
+					ARAVIS_NAME, dlerror());
+      return OA_ERR_LIBRARY_NOT_FOUND;
+    }
+
+		if (!( *( void** )( &p_arv_update_device_list ) = _getDLSym ( libHandle,
+		    "arv_update_device_list" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+		if (!( *( void** )( &p_arv_get_n_devices ) = _getDLSym ( libHandle,
+		    "arv_get_n_devices" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+		if (!( *( void** )( &p_arv_get_device_id ) = _getDLSym ( libHandle,
+		    "arv_get_device_id" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+		if (!( *( void** )( &p_arv_get_device_vendor ) = _getDLSym ( libHandle,
+		    "arv_get_device_vendor" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+		if (!( *( void** )( &p_arv_get_device_model ) = _getDLSym ( libHandle,
+		    "arv_get_device_model" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+		if (!( *( void** )( &p_arv_open_device ) = _getDLSym ( libHandle,
+		    "arv_open_device" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+		if (!( *( void** )( &p_arv_device_create_stream ) = _getDLSym ( libHandle,
+		    "arv_device_create_stream" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+		if (!( *( void** )( &p_arv_device_get_feature ) = _getDLSym ( libHandle,
+		    "arv_device_get_feature" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+		if (!( *( void** )( &p_arv_gc_feature_node_is_available ) =
+		    _getDLSym ( libHandle, "arv_gc_feature_node_is_available" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+		if (!( *( void** )( &p_arv_gc_feature_node_is_implemented ) =
+		    _getDLSym ( libHandle, "arv_gc_feature_node_is_implemented" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+		if (!( *( void** )( &p_arv_gc_feature_node_is_locked ) =
+		    _getDLSym ( libHandle, "arv_gc_feature_node_is_locked" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+		if (!( *( void** )( &p_arv_gc_feature_node_get_value_type ) =
+		    _getDLSym ( libHandle, "arv_gc_feature_node_get_value_type" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+		if (!( *( void** )( &p_arv_gc_integer_get_min ) = _getDLSym ( libHandle,
+		    "arv_gc_integer_get_min" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+		if (!( *( void** )( &p_arv_gc_integer_get_max ) = _getDLSym ( libHandle,
+		    "arv_gc_integer_get_max" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+		if (!( *( void** )( &p_arv_gc_integer_get_inc ) = _getDLSym ( libHandle,
+		    "arv_gc_integer_get_inc" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+		if (!( *( void** )( &p_arv_gc_integer_get_value ) = _getDLSym ( libHandle,
+		    "arv_gc_integer_get_value" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+		if (!( *( void** )( &p_arv_gc_integer_set_value ) = _getDLSym ( libHandle,
+		    "arv_gc_integer_set_value" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+		if (!( *( void** )( &p_arv_gc_float_get_min ) = _getDLSym ( libHandle,
+		    "arv_gc_float_get_min" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+		if (!( *( void** )( &p_arv_gc_float_get_max ) = _getDLSym ( libHandle,
+		    "arv_gc_float_get_max" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+		if (!( *( void** )( &p_arv_gc_float_get_value ) = _getDLSym ( libHandle,
+		    "arv_gc_float_get_value" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+		if (!( *( void** )( &p_arv_gc_float_set_value ) = _getDLSym ( libHandle,
+		    "arv_gc_float_set_value" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+		if (!( *( void** )( &p_arv_gc_boolean_get_value ) = _getDLSym ( libHandle,
+		    "arv_gc_boolean_get_value" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+		if (!( *( void** )( &p_arv_gc_boolean_set_value ) = _getDLSym ( libHandle,
+		    "arv_gc_boolean_set_value" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+		if (!( *( void** )( &p_arv_gc_enumeration_get_string_value ) =
+		    _getDLSym ( libHandle, "arv_gc_enumeration_get_string_value" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+		if (!( *( void** )( &p_arv_gc_enumeration_set_string_value ) =
+		    _getDLSym ( libHandle, "arv_gc_enumeration_set_string_value" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+		if (!( *( void** )( &p_arv_gc_enumeration_get_available_string_values ) =
+		    _getDLSym ( libHandle,
+		    "arv_gc_enumeration_get_available_string_values" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+		if (!( *( void** )( &p_arv_gc_command_execute ) = _getDLSym ( libHandle,
+		    "arv_gc_command_execute" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+		if (!( *( void** )( &p_arv_buffer_new_full ) = _getDLSym ( libHandle,
+		    "arv_buffer_new_full" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+		if (!( *( void** )( &p_arv_buffer_get_status ) = _getDLSym ( libHandle,
+		    "arv_buffer_get_status" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+		if (!( *( void** )( &p_arv_buffer_get_user_data ) = _getDLSym ( libHandle,
+		    "arv_buffer_get_user_data" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+		if (!( *( void** )( &p_arv_buffer_get_data ) = _getDLSym ( libHandle,
+		    "arv_buffer_get_data" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+		if (!( *( void** )( &p_arv_buffer_get_timestamp ) = _getDLSym ( libHandle,
+		    "arv_buffer_get_timestamp" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+		if (!( *( void** )( &p_arv_buffer_get_system_timestamp ) =
+		    _getDLSym ( libHandle, "arv_buffer_get_system_timestamp" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+		if (!( *( void** )( &p_arv_stream_push_buffer ) = _getDLSym ( libHandle,
+		    "arv_stream_push_buffer" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+		if (!( *( void** )( &p_arv_stream_timeout_pop_buffer ) =
+		    _getDLSym ( libHandle, "arv_stream_timeout_pop_buffer" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+		if (!( *( void** )( &p_arv_stream_try_pop_buffer ) = _getDLSym ( libHandle,
+		    "arv_stream_try_pop_buffer" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+		if (!( *( void** )( &p_arv_stream_get_statistics ) = _getDLSym ( libHandle,
+		    "arv_stream_get_statistics" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+		if (!( *( void** )( &p_arv_gv_stream_get_statistics ) =
+		    _getDLSym ( libHandle, "arv_gv_stream_get_statistics" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+		if (!( *( void** )( &p_g_object_ref ) = _getDLSym ( libHandle,
+		    "g_object_ref" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+		if (!( *( void** )( &p_g_object_unref ) = _getDLSym ( libHandle,
+		    "g_object_unref" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+		if (!( *( void** )( &p_g_object_set ) = _getDLSym ( libHandle,
+		    "g_object_set" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+		if (!( *( void** )( &p_g_error_free ) = _getDLSym ( libHandle,
+		    "g_error_free" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+		if (!( *( void** )( &p_g_free ) = _getDLSym ( libHandle,
+		    "g_free" ))) {
+		  dlclose ( libHandle );
+			libHandle = 0;
+			return OA_ERR_SYMBOL_NOT_FOUND;
+		}
+  }
+
+#else /* HAVE_LIBDL */
+
+	p_arv_update_device_list = arv_update_device_list;
+	p_arv_get_n_devices = arv_get_n_devices;
+	p_arv_get_device_id = arv_get_device_id;
+	p_arv_get_device_vendor = arv_get_device_vendor;
+	p_arv_get_device_model = arv_get_device_model;
+	p_arv_open_device = arv_open_device;
+	p_arv_device_create_stream = arv_device_create_stream;
+	p_arv_device_get_feature = arv_device_get_feature;
+	p_arv_gc_feature_node_is_available = arv_gc_feature_node_is_available;
+	p_arv_gc_feature_node_is_implemented = arv_gc_feature_node_is_implemented;
+	p_arv_gc_feature_node_is_locked = arv_gc_feature_node_is_locked;
+	p_arv_gc_feature_node_get_value_type = arv_gc_feature_node_get_value_type;
+	p_arv_gc_integer_get_min = arv_gc_integer_get_min;
+	p_arv_gc_integer_get_max = arv_gc_integer_get_max;
+	p_arv_gc_integer_get_inc = arv_gc_integer_get_inc;
+	p_arv_gc_integer_get_value = arv_gc_integer_get_value;
+	p_arv_gc_integer_set_value = arv_gc_integer_set_value;
+	p_arv_gc_float_get_min = arv_gc_float_get_min;
+	p_arv_gc_float_get_max = arv_gc_float_get_max;
+	p_arv_gc_float_get_value = arv_gc_float_get_value;
+	p_arv_gc_float_set_value = arv_gc_float_set_value;
+	p_arv_gc_boolean_get_value = arv_gc_boolean_get_value;
+	p_arv_gc_boolean_set_value = arv_gc_boolean_set_value;
+	p_arv_gc_enumeration_get_string_value = arv_gc_enumeration_get_string_value;
+	p_arv_gc_enumeration_set_string_value = arv_gc_enumeration_set_string_value;
+	p_arv_gc_enumeration_get_available_string_values =
+			arv_gc_enumeration_get_available_string_values;
+	p_arv_gc_command_execute = arv_gc_command_execute;
+	p_arv_buffer_new_full = arv_buffer_new_full;
+	p_arv_buffer_get_status = arv_buffer_get_status;
+	p_arv_buffer_get_user_data = arv_buffer_get_user_data;
+	p_arv_buffer_get_data = arv_buffer_get_data;
+	p_arv_buffer_get_timestamp = arv_buffer_get_timestamp;
+	p_arv_buffer_get_system_timestamp = arv_buffer_get_system_timestamp;
+	p_arv_stream_push_buffer = arv_stream_push_buffer;
+	p_arv_stream_timeout_pop_buffer = arv_stream_timeout_pop_buffer;
+	p_arv_stream_try_pop_buffer = arv_stream_try_pop_buffer;
+	p_arv_stream_get_statistics = arv_stream_get_statistics;
+	p_arv_gv_stream_get_statistics = arv_gv_stream_get_statistics;
+	p_g_object_ref = g_object_ref;
+	p_g_object_unref = g_object_unref;
+	p_g_object_set = g_object_set;
+	p_g_error_free = g_error_free;
+	p_g_free = g_free;
+
+#endif /* HAVE_LIBDL */
+
+  return OA_ERR_NONE;
+}
+
+
+#if HAVE_LIBDL
+static void*
+_getDLSym ( void* libHandle, const char* symbol )
+{
+  void* addr;
+  char* error;
+
+  addr = dlsym ( libHandle, symbol );
+  if (( error = dlerror())) {
+    oaLogError ( OA_LOG_CAMERA, "%s: libaravis DL error: %s", __func__, error );
+    addr = 0;
+  }
+
+  return addr;
+}
+#endif
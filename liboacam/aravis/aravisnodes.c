@@ -0,0 +1,332 @@
+/*****************************************************************************
+ *
+ * aravisnodes.c -- GenICam feature access for Aravis cameras
+ *
+ * Copyright 2026 James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <oa_common.h>
+
+#include <openastro/errno.h>
+#include <openastro/util.h>
+
+#include "aravisprivate.h"
+#include "aravisnodes.h"
+
+
+static int		_failed ( GError*, const char*, const char* );
+static ArvGcNode*	_feature ( ArvDevice*, const char*, const char* );
+
+
+/**
+ * Find a feature, checking that the camera implements it and that it can
+ * be used right now.  readWrite has bit 1 set if the feature must also be
+ * writeable.  A feature the camera doesn't have isn't logged as an error
+ * as we go looking for plenty of optional ones.
+ */
+
+int
+_aravisGetNode ( ArvDevice* device, const char* name, int readWrite,
+		ArvGcNode** node )
+{
+	ArvGcFeatureNode*	feature;
+	GError*						error = 0;
+	gboolean					res;
+
+	if (!( *node = p_arv_device_get_feature ( device, name ))) {
+		return -OA_ERR_INVALID_CONTROL;
+	}
+	feature = ( ArvGcFeatureNode* ) *node;
+
+	res = p_arv_gc_feature_node_is_implemented ( feature, &error );
+	if ( _failed ( error, __func__, name )) {
+		return -OA_ERR_SYSTEM_ERROR;
+	}
+	if ( res ) {
+		res = p_arv_gc_feature_node_is_available ( feature, &error );
+		if ( _failed ( error, __func__, name )) {
+			return -OA_ERR_SYSTEM_ERROR;
+		}
+	}
+	if ( !res ) {
+		return -OA_ERR_NOT_READABLE;
+	}
+
+	if ( readWrite & 0x2 ) {
+		res = p_arv_gc_feature_node_is_locked ( feature, &error );
+		if ( _failed ( error, __func__, name )) {
+			return -OA_ERR_SYSTEM_ERROR;
+		}
+		if ( res ) {
+			return -OA_ERR_NOT_WRITEABLE;
+		}
+	}
+
+	return OA_ERR_NONE;
+}
+
+
+int
+_aravisGetIntSettings ( ArvGcNode* node, int64_t* min, int64_t* max,
+		int64_t* step, int64_t* curr )
+{
+	ArvGcInteger*		integer = ( ArvGcInteger* ) node;
+	GError*					error = 0;
+
+	*min = p_arv_gc_integer_get_min ( integer, &error );
+	if ( !error ) {
+		*max = p_arv_gc_integer_get_max ( integer, &error );
+	}
+	if ( !error ) {
+		*step = p_arv_gc_integer_get_inc ( integer, &error );
+	}
+	if ( !error ) {
+		*curr = p_arv_gc_integer_get_value ( integer, &error );
+	}
+	if ( _failed ( error, __func__, "integer" )) {
+		return -OA_ERR_SYSTEM_ERROR;
+	}
+	if ( *step < 1 ) {
+		*step = 1;
+	}
+	return OA_ERR_NONE;
+}
+
+
+int
+_aravisGetFloatSettings ( ArvGcNode* node, double* min, double* max,
+		double* curr )
+{
+	ArvGcFloat*			fnode = ( ArvGcFloat* ) node;
+	GError*					error = 0;
+
+	*min = p_arv_gc_float_get_min ( fnode, &error );
+	if ( !error ) {
+		*max = p_arv_gc_float_get_max ( fnode, &error );
+	}
+	if ( !error ) {
+		*curr = p_arv_gc_float_get_value ( fnode, &error );
+	}
+	if ( _failed ( error, __func__, "float" )) {
+		return -OA_ERR_SYSTEM_ERROR;
+	}
+	return OA_ERR_NONE;
+}
+
+
+int
+_aravisNodeIsFloat ( ArvGcNode* node )
+{
+	return ( p_arv_gc_feature_node_get_value_type (
+			( ArvGcFeatureNode* ) node ) == G_TYPE_DOUBLE ) ? 1 : 0;
+}
+
+
+int
+_aravisHasEnumValue ( ArvGcNode* node, const char* value )
+{
+	const char**		values;
+	guint						i, numValues = 0;
+	GError*					error = 0;
+	int							found = 0;
+
+	values = p_arv_gc_enumeration_get_available_string_values (
+			( ArvGcEnumeration* ) node, &numValues, &error );
+	if ( _failed ( error, __func__, value )) {
+		return 0;
+	}
+	for ( i = 0; i < numValues && !found; i++ ) {
+		if ( !strcmp ( values[i], value )) {
+			found = 1;
+		}
+	}
+	p_g_free ( values );
+	return found;
+}
+
+
+int
+_aravisGetInt ( ArvDevice* device, const char* name, int64_t* val )
+{
+	ArvGcNode*		node;
+	GError*				error = 0;
+
+	if (!( node = _feature ( device, name, __func__ ))) {
+		return -OA_ERR_INVALID_CONTROL;
+	}
+	*val = p_arv_gc_integer_get_value (( ArvGcInteger* ) node, &error );
+	return _failed ( error, __func__, name ) ? -OA_ERR_SYSTEM_ERROR :
+			OA_ERR_NONE;
+}
+
+
+int
+_aravisSetInt ( ArvDevice* device, const char* name, int64_t val )
+{
+	ArvGcNode*		node;
+	GError*				error = 0;
+
+	if (!( node = _feature ( device, name, __func__ ))) {
+		return -OA_ERR_INVALID_CONTROL;
+	}
+	p_arv_gc_integer_set_value (( ArvGcInteger* ) node, val, &error );
+	return _failed ( error, __func__, name ) ? -OA_ERR_SYSTEM_ERROR :
+			OA_ERR_NONE;
+}
+
+
+int
+_aravisGetFloat ( ArvDevice* device, const char* name, double* val )
+{
+	ArvGcNode*		node;
+	GError*				error = 0;
+
+	if (!( node = _feature ( device, name, __func__ ))) {
+		return -OA_ERR_INVALID_CONTROL;
+	}
+	*val = p_arv_gc_float_get_value (( ArvGcFloat* ) node, &error );
+	return _failed ( error, __func__, name ) ? -OA_ERR_SYSTEM_ERROR :
+			OA_ERR_NONE;
+}
+
+
+int
+_aravisSetFloat ( ArvDevice* device, const char* name, double val )
+{
+	ArvGcNode*		node;
+	GError*				error = 0;
+
+	if (!( node = _feature ( device, name, __func__ ))) {
+		return -OA_ERR_INVALID_CONTROL;
+	}
+	p_arv_gc_float_set_value (( ArvGcFloat* ) node, val, &error );
+	return _failed ( error, __func__, name ) ? -OA_ERR_SYSTEM_ERROR :
+			OA_ERR_NONE;
+}
+
+
+int
+_aravisGetBool ( ArvDevice* device, const char* name, int* val )
+{
+	ArvGcNode*		node;
+	GError*				error = 0;
+
+	if (!( node = _feature ( device, name, __func__ ))) {
+		return -OA_ERR_INVALID_CONTROL;
+	}
+	*val = p_arv_gc_boolean_get_value (( ArvGcBoolean* ) node, &error ) ? 1 : 0;
+	return _failed ( error, __func__, name ) ? -OA_ERR_SYSTEM_ERROR :
+			OA_ERR_NONE;
+}
+
+
+int
+_aravisSetBool ( ArvDevice* device, const char* name, int val )
+{
+	ArvGcNode*		node;
+	GError*				error = 0;
+
+	if (!( node = _feature ( device, name, __func__ ))) {
+		return -OA_ERR_INVALID_CONTROL;
+	}
+	p_arv_gc_boolean_set_value (( ArvGcBoolean* ) node, val ? 1 : 0, &error );
+	return _failed ( error, __func__, name ) ? -OA_ERR_SYSTEM_ERROR :
+			OA_ERR_NONE;
+}
+
+
+int
+_aravisGetEnum ( ArvDevice* device, const char* name, char* buffer,
+		size_t len )
+{
+	ArvGcNode*		node;
+	GError*				error = 0;
+	const char*		val;
+
+	if (!( node = _feature ( device, name, __func__ ))) {
+		return -OA_ERR_INVALID_CONTROL;
+	}
+	val = p_arv_gc_enumeration_get_string_value (( ArvGcEnumeration* ) node,
+			&error );
+	if ( _failed ( error, __func__, name )) {
+		return -OA_ERR_SYSTEM_ERROR;
+	}
+	( void ) strncpy ( buffer, val ? val : "", len - 1 );
+	buffer[ len - 1 ] = 0;
+	return OA_ERR_NONE;
+}
+
+
+int
+_aravisSetEnum ( ArvDevice* device, const char* name, const char* val )
+{
+	ArvGcNode*		node;
+	GError*				error = 0;
+
+	if (!( node = _feature ( device, name, __func__ ))) {
+		return -OA_ERR_INVALID_CONTROL;
+	}
+	p_arv_gc_enumeration_set_string_value (( ArvGcEnumeration* ) node, val,
+			&error );
+	return _failed ( error, __func__, name ) ? -OA_ERR_SYSTEM_ERROR :
+			OA_ERR_NONE;
+}
+
+
+int
+_aravisExecute ( ArvDevice* device, const char* name )
+{
+	ArvGcNode*		node;
+	GError*				error = 0;
+
+	if (!( node = _feature ( device, name, __func__ ))) {
+		return -OA_ERR_INVALID_CONTROL;
+	}
+	p_arv_gc_command_execute (( ArvGcCommand* ) node, &error );
+	return _failed ( error, __func__, name ) ? -OA_ERR_SYSTEM_ERROR :
+			OA_ERR_NONE;
+}
+
+
+static ArvGcNode*
+_feature ( ArvDevice* device, const char* name, const char* func )
+{
+	ArvGcNode*		node;
+
+	if (!( node = p_arv_device_get_feature ( device, name ))) {
+		oaLogError ( OA_LOG_CAMERA, "%s: feature '%s' not found", func, name );
+	}
+	return node;
+}
+
+
+static int
+_failed ( GError* error, const char* func, const char* name )
+{
+	if ( !error ) {
+		return 0;
+	}
+	oaLogError ( OA_LOG_CAMERA, "%s: '%s' failed: %s", func, name,
+			error->message );
+	p_g_error_free ( error );
+	return 1;
+}
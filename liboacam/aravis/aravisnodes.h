@@ -0,0 +1,47 @@
+/*****************************************************************************
+ *
+ * aravisnodes.h -- GenICam feature access for Aravis cameras
+ *
+ * Copyright 2026 James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#ifndef OA_ARAVIS_NODES_H
+#define OA_ARAVIS_NODES_H
+
+extern int	_aravisGetNode ( ArvDevice*, const char*, int, ArvGcNode** );
+extern int	_aravisGetIntSettings ( ArvGcNode*, int64_t*, int64_t*, int64_t*,
+								int64_t* );
+extern int	_aravisGetFloatSettings ( ArvGcNode*, double*, double*, double* );
+extern int	_aravisNodeIsFloat ( ArvGcNode* );
+extern int	_aravisHasEnumValue ( ArvGcNode*, const char* );
+
+extern int	_aravisGetInt ( ArvDevice*, const char*, int64_t* );
+extern int	_aravisSetInt ( ArvDevice*, const char*, int64_t );
+extern int	_aravisGetFloat ( ArvDevice*, const char*, double* );
+extern int	_aravisSetFloat ( ArvDevice*, const char*, double );
+extern int	_aravisGetBool ( ArvDevice*, const char*, int* );
+extern int	_aravisSetBool ( ArvDevice*, const char*, int );
+extern int	_aravisGetEnum ( ArvDevice*, const char*, char*, size_t );
+extern int	_aravisSetEnum ( ArvDevice*, const char*, const char* );
+extern int	_aravisExecute ( ArvDevice*, const char* );
+
+#endif	/* OA_ARAVIS_NODES_H */
@@ -27,32 +27,14 @@
 
 #include <oa_common.h>
 
-#if HAVE_LIBDL
-#if HAVE_DLFCN_H
-#include <dlfcn.h>
-#endif
-#endif
-#ifdef ARAVIS_V06
-#include <aravis-0.6/arv.h>
-#define ARAVIS_NAME "libaravis-0.6.so.0"
-#endif
-#ifdef ARAVIS_V08
-#include <aravis-0.8/arv.h>
-#define ARAVIS_NAME "libaravis-0.8.so.0"
-#endif
-
 #include <openastro/camera.h>
 #include <openastro/util.h>
 #include <openastro/demosaic.h>
 
 #include "oacamprivate.h"
 #include "unimplemented.h"
-
-// Pointers to Aravis functions so we can use them via libdl.
-
-#if HAVE_LIBDL
-//static void*		_getDLSym ( void*, const char* );
-#endif
+#include "aravisprivate.h"
+#include "aravisoacam.h"
 
 /**
  * Cycle through the list of cameras returned by the Aravis library
@@ -62,20 +44,68 @@ int
 oaAravisGetCameras ( CAMERA_LIST* deviceList, unsigned long featureFlags,
 		int flags )
 {
-#if HAVE_LIBDL
-  static void*		libHandle = 0;
+	unsigned int			i, numCameras, numFound = 0;
+	const char*				deviceId;
+	const char*				vendor;
+	const char*				model;
+	oaCameraDevice*		dev;
+	DEVICE_INFO*			_private;
+	int								ret;
+
+	if (( ret = _aravisInitLibraryFunctionPointers()) != OA_ERR_NONE ) {
+		return ret;
+	}
+
+	p_arv_update_device_list();
+	if (!( numCameras = p_arv_get_n_devices())) {
+		return 0;
+	}
+
+	for ( i = 0; i < numCameras; i++ ) {
+		if (!( deviceId = p_arv_get_device_id ( i ))) {
+			continue;
+		}
 
-  if ( !libHandle ) {
-    if (!( libHandle = dlopen( ARAVIS_NAME, RTLD_LAZY ))) {
-      return 0;
-    }
-  }
+		if (!( dev = malloc ( sizeof ( oaCameraDevice )))) {
+			_oaFreeCameraDeviceList ( deviceList );
+			return -OA_ERR_MEM_ALLOC;
+		}
 
-  dlerror();
+		if (!( _private = malloc ( sizeof ( DEVICE_INFO )))) {
+			( void ) free (( void* ) dev );
+			return -OA_ERR_MEM_ALLOC;
+		}
+		oaLogDebug ( OA_LOG_CAMERA, "%s: allocated @ %p for camera device",
+				__func__, dev );
 
-#else /* HAVE_LIBDL */
+		_oaInitCameraDeviceFunctionPointers ( dev );
+		dev->interface = OA_CAM_IF_ARAVIS;
+		vendor = p_arv_get_device_vendor ( i );
+		model = p_arv_get_device_model ( i );
+		if ( model && *model && vendor && *vendor ) {
+			( void ) snprintf ( dev->deviceName, OA_MAX_NAME_LEN, "%s %s",
+					vendor, model );
+		} else if ( model && *model ) {
+			( void ) strncpy ( dev->deviceName, model, OA_MAX_NAME_LEN );
+		} else {
+			( void ) strncpy ( dev->deviceName, deviceId, OA_MAX_NAME_LEN );
+		}
+		dev->_private = _private;
+		dev->initCamera = oaAravisInitCamera;
+		_private->devIndex = i;
+		// The index may change as cameras come and go, so the device id is
+		// what we open the camera with
+		( void ) strncpy ( _private->deviceId, deviceId, OA_MAX_DEVICEID_LEN );
+		_private->deviceId[ OA_MAX_DEVICEID_LEN ] = 0;
 
-#endif /* HAVE_LIBDL */
+		if (( ret = _oaCheckCameraArraySize ( deviceList )) < 0 ) {
+			( void ) free (( void* ) dev );
+			( void ) free (( void* ) _private );
+			return ret;
+		}
+		deviceList->cameraList[ deviceList->numCameras++ ] = dev;
+		numFound++;
+	}
 
-	return 0;
+	return numFound;
 }
@@ -35,19 +35,14 @@ extern int				oaAravisCloseCamera ( oaCamera* );
 extern int				oaAravisCameraTestControl ( oaCamera*, int, oaControlValue* );
 extern int				oaAravisCameraGetControlRange ( oaCamera*, int, int64_t*,
 											int64_t*, int64_t*, int64_t* );
-extern int        oaAravisCameraGetControlDiscreteSet ( oaCamera*, int,
-                      int32_t*, int64_t** );
 
-extern int				oaAravisCameraSetROI ( oaCamera*, int, int );
 extern int				oaAravisCameraTestROISize ( oaCamera*, unsigned int,
 											unsigned int, unsigned int*, unsigned int* );
 
 extern void*			oacamAravisController ( void* );
-extern void*			oacamAraviscallbackHandler ( void* );
+extern void*			oacamAravisCallbackHandler ( void* );
 
 extern const FRAMESIZES* oaAravisCameraGetFrameSizes ( oaCamera* );
 extern int				oaAravisCameraGetFramePixelFormat ( oaCamera* );
 
-extern const char*	oaAravisCameraGetMenuString ( oaCamera*, int, int );
-
 #endif	/* OA_ARAVIS_OACAM_H */
@@ -0,0 +1,126 @@
+/*****************************************************************************
+ *
+ * aravisprivate.h -- Aravis library function pointers and shared data
+ *
+ * Copyright 2026 James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#ifndef OA_ARAVIS_PRIVATE_H
+#define OA_ARAVIS_PRIVATE_H
+
+#ifdef ARAVIS_V06
+#include <aravis-0.6/arv.h>
+#define ARAVIS_NAME "libaravis-0.6.so.0"
+#endif
+#ifdef ARAVIS_V08
+#include <aravis-0.8/arv.h>
+#define ARAVIS_NAME "libaravis-0.8.so.0"
+#endif
+
+extern int						_aravisInitLibraryFunctionPointers ( void );
+
+extern void						( *p_arv_update_device_list )( void );
+extern unsigned int		( *p_arv_get_n_devices )( void );
+extern const char*		( *p_arv_get_device_id )( unsigned int );
+extern const char*		( *p_arv_get_device_vendor )( unsigned int );
+extern const char*		( *p_arv_get_device_model )( unsigned int );
+
+#ifdef ARAVIS_V08
+extern ArvDevice*			( *p_arv_open_device )( const char*, GError** );
+extern ArvStream*			( *p_arv_device_create_stream )( ArvDevice*,
+													ArvStreamCallback, void*, GError** );
+#else
+extern ArvDevice*			( *p_arv_open_device )( const char* );
+extern ArvStream*			( *p_arv_device_create_stream )( ArvDevice*,
+													ArvStreamCallback, void* );
+#endif
+extern ArvGcNode*			( *p_arv_device_get_feature )( ArvDevice*, const char* );
+
+extern gboolean				( *p_arv_gc_feature_node_is_available )(
+													ArvGcFeatureNode*, GError** );
+extern gboolean				( *p_arv_gc_feature_node_is_implemented )(
+													ArvGcFeatureNode*, GError** );
+extern gboolean				( *p_arv_gc_feature_node_is_locked )(
+													ArvGcFeatureNode*, GError** );
+extern GType					( *p_arv_gc_feature_node_get_value_type )(
+													ArvGcFeatureNode* );
+
+extern gint64					( *p_arv_gc_integer_get_min )( ArvGcInteger*, GError** );
+extern gint64					( *p_arv_gc_integer_get_max )( ArvGcInteger*, GError** );
+extern gint64					( *p_arv_gc_integer_get_inc )( ArvGcInteger*, GError** );
+extern gint64					( *p_arv_gc_integer_get_value )( ArvGcInteger*,
+													GError** );
+extern void						( *p_arv_gc_integer_set_value )( ArvGcInteger*, gint64,
+													GError** );
+extern double					( *p_arv_gc_float_get_min )( ArvGcFloat*, GError** );
+extern double					( *p_arv_gc_float_get_max )( ArvGcFloat*, GError** );
+extern double					( *p_arv_gc_float_get_value )( ArvGcFloat*, GError** );
+extern void						( *p_arv_gc_float_set_value )( ArvGcFloat*, double,
+													GError** );
+extern gboolean				( *p_arv_gc_boolean_get_value )( ArvGcBoolean*,
+													GError** );
+extern void						( *p_arv_gc_boolean_set_value )( ArvGcBoolean*,
+													gboolean, GError** );
+extern const char*		( *p_arv_gc_enumeration_get_string_value )(
+													ArvGcEnumeration*, GError** );
+extern void						( *p_arv_gc_enumeration_set_string_value )(
+													ArvGcEnumeration*, const char*, GError** );
+extern const char**		( *p_arv_gc_enumeration_get_available_string_values )(
+													ArvGcEnumeration*, guint*, GError** );
+extern void						( *p_arv_gc_command_execute )( ArvGcCommand*,
+													GError** );
+
+extern ArvBuffer*			( *p_arv_buffer_new_full )( size_t, void*, void*,
+													GDestroyNotify );
+extern ArvBufferStatus	( *p_arv_buffer_get_status )( ArvBuffer* );
+extern const void*		( *p_arv_buffer_get_user_data )( ArvBuffer* );
+extern const void*		( *p_arv_buffer_get_data )( ArvBuffer*, size_t* );
+extern guint64				( *p_arv_buffer_get_timestamp )( ArvBuffer* );
+extern guint64				( *p_arv_buffer_get_system_timestamp )( ArvBuffer* );
+
+extern void						( *p_arv_stream_push_buffer )( ArvStream*, ArvBuffer* );
+extern ArvBuffer*			( *p_arv_stream_timeout_pop_buffer )( ArvStream*,
+													guint64 );
+extern ArvBuffer*			( *p_arv_stream_try_pop_buffer )( ArvStream* );
+extern void						( *p_arv_stream_get_statistics )( ArvStream*, guint64*,
+													guint64*, guint64* );
+extern void						( *p_arv_gv_stream_get_statistics )( ArvGvStream*,
+													guint64*, guint64* );
+
+// GLib and GObject, which libaravis brings with it
+
+extern gpointer				( *p_g_object_ref )( gpointer );
+extern void						( *p_g_object_unref )( gpointer );
+extern void						( *p_g_object_set )( gpointer, const gchar*, ... );
+extern void						( *p_g_error_free )( GError* );
+extern void						( *p_g_free )( gpointer );
+
+
+typedef struct {
+	const char*		arvName;
+	int						pixFormat;
+} aravisFrameInfo;
+
+extern aravisFrameInfo	_aravisFrameFormats[];
+extern const int				_aravisNumFrameFormats;
+
+#endif	/* OA_ARAVIS_PRIVATE_H */
@@ -0,0 +1,84 @@
+/*****************************************************************************
+ *
+ * aravisstate.h -- Aravis camera state
+ *
+ * Copyright 2026 James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#ifndef OA_ARAVIS_STATE_H
+#define OA_ARAVIS_STATE_H
+
+#include <openastro/util.h>
+
+#include "sharedState.h"
+#include "aravisprivate.h"
+
+
+typedef struct ARAVIS_STATE {
+
+#include "sharedDecs.h"
+
+	// connection data
+	ArvDevice*			device;
+	ArvStream*			stream;
+	// wrappers for our own frame buffers, so the stream fills them directly
+	ArvBuffer*			arvBuffers[ OA_CAM_BUFFERS ];
+	int							isGigE;
+
+  // buffering for image transfers
+  frameBuffer*		buffers;
+
+  // camera status
+	int							gainIsFloat;
+	char						gainName[16];
+	int							exposureIsFloat;
+	char						exposureTimeName[16];
+	int							minResolutionX;
+	int							minResolutionY;
+	int							xSizeStep;
+	int							ySizeStep;
+	int							maxBinning;
+	const char*			pixelFormatNames[ OA_PIX_FMT_LAST_P1 ];
+
+  // image settings
+  int							currentFrameFormat;
+  unsigned int		binMode;
+	float						currentBytesPerPixel;
+
+	// GigE stream settings, applied when the stream is created
+	int							socketBufferSize;	// zero for automatic
+	int							packetResend;
+
+	// stream statistics, carried over from streams already closed
+	uint64_t				completedFrames;
+	uint64_t				failedFrames;
+	uint64_t				underruns;
+	uint64_t				resentPackets;
+	uint64_t				droppedBase;
+
+	// device clock time of a frame and the host monotonic time it was
+	// taken to match, for buffers with no host timestamp of their own
+	uint64_t				deviceTimeBase;
+	uint64_t				hostTimeBase;
+} ARAVIS_STATE;
+
+#endif	/* OA_ARAVIS_STATE_H */
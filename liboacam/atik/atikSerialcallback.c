@@ -47,6 +47,8 @@ oacamAtikSerialcallbackHandler ( void* param )
   int			exitThread = 0;
   CALLBACK*		callback;
   void*			(*callbackFunc)( void*, void*, int, void* );
+  void*			frame;
+  int				frameLen;
 
   do {
     pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
@@ -70,9 +72,16 @@ oacamAtikSerialcallbackHandler ( void* param )
       switch ( callback->callbackType ) {
         case OA_CALLBACK_NEW_FRAME:
           callbackFunc = callback->callback;
-          callbackFunc ( callback->callbackArg, callback->buffer,
-              callback->bufferLen, 0 );
+          frame = callback->buffer;
+          frameLen = callback->bufferLen;
+          _oaSoftwareFrame ( camera, &frame, &frameLen, 0 );
+          OA_FRAME_STATS_CB_STAMP ( cameraInfo, callback,
+              OA_FRAME_STAGE_CALLBACK );
+          callbackFunc ( callback->callbackArg, frame, frameLen, 0 );
+          OA_FRAME_STATS_CB_STAMP ( cameraInfo, callback,
+              OA_FRAME_STAGE_RETURNED );
           // We can only requeue frames if we're still streaming
+          OA_FRAME_STATS_CB_COMPLETE ( cameraInfo, callback );
           pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
           cameraInfo->buffersFree++;
           pthread_mutex_unlock ( &cameraInfo->callbackQueueMutex );
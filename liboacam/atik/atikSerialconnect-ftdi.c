@@ -564,6 +564,7 @@ oaAtikSerialCloseCamera ( oaCamera* camera )
     ftdi_usb_close ( cameraInfo->ftdiContext );
     ftdi_free ( cameraInfo->ftdiContext );
 
+    oacamFlushAsync ( cameraInfo );
     oaDLListDelete ( cameraInfo->commandQueue, 1 );
     oaDLListDelete ( cameraInfo->callbackQueue, 0 );
 
@@ -477,6 +477,7 @@ oaAtikSerialCloseCamera ( oaCamera* camera )
 
     close ( cameraInfo->fd );
 
+    oacamFlushAsync ( cameraInfo );
     oaDLListDelete ( cameraInfo->commandQueue, 1 );
     oaDLListDelete ( cameraInfo->callbackQueue, 0 );
 
@@ -80,7 +80,7 @@ oacamAtikSerialcontroller ( void* param )
       pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
     }
     do {
-      command = oaDLListRemoveFromHead ( cameraInfo->commandQueue );
+      command = oacamNextCommand ( cameraInfo );
       if ( command ) {
         switch ( command->commandType ) {
           case OA_CMD_CONTROL_SET:
@@ -104,15 +104,7 @@ oacamAtikSerialcontroller ( void* param )
             resultCode = -OA_ERR_INVALID_CONTROL;
             break;
         }
-        if ( command->callback ) {
-					oaLogWarning ( OA_LOG_CAMERA, "%s: command has callback" );
-        } else {
-          pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
-          command->completed = 1;
-          command->resultCode = resultCode;
-          pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
-          pthread_cond_broadcast ( &cameraInfo->commandComplete );
-        }
+        oacamCommandComplete ( cameraInfo, command, resultCode );
       }
     } while ( command );
 
@@ -172,6 +164,7 @@ oacamAtikSerialcontroller ( void* param )
             cameraInfo->frameCallbacks[ nextBuffer ].bufferLen =
                 cameraInfo->imageBufferLength;
             pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
+            OA_FRAME_STATS_QUEUED ( cameraInfo, nextBuffer );
             oaDLListAddToTail ( cameraInfo->callbackQueue,
                 &cameraInfo->frameCallbacks[ nextBuffer ]);
             cameraInfo->buffersFree--;
@@ -468,6 +461,9 @@ _doReadExposure ( AtikSerial_STATE* cameraInfo )
 				__func__, cameraInfo->imageBufferLength,
 				( int ) ( p - cameraInfo->xferBuffer ));
     cameraInfo->droppedFrames++;
+    OA_CONTROL_MIRROR_READONLY ( cameraInfo, OA_CAM_CTRL_DROPPED,
+        cameraInfo->droppedFrames );
+    OA_FRAME_STATS_DROPPED ( cameraInfo );
   }
 
   if ( cameraInfo->write ( cameraInfo, ampOffCmd, 5 )) {
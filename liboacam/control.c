@@ -161,7 +161,15 @@ const char* oaCameraControlLabel[ OA_CAM_CTRL_LAST_P1 ] = {
 	"Battery Level",
 	"Conversion Gain",
 	"Bulb Mode",
-	"Brightness Target"
+	"Brightness Target",
+	"Frame Buffers",
+	"Packet Size",
+	"Packet Delay",
+	"Socket Buffer Size",
+	"Packet Resend",
+	"Frames Completed",
+	"Frames Failed",
+	"Packets Resent"
 };
 
 const char* oaCameraPresetAWBLabel[ OA_AWB_PRESET_LAST_P1 ] = {
@@ -355,6 +363,12 @@ oacamReadControl ( oaCamera* camera, int control,
   SHARED_STATE*  cameraInfo = camera->_private;
   int     retval;
 
+	// Values read recently enough don't need to go to the camera
+
+	if ( _oaControlMirrorGet ( &cameraInfo->controlMirror, control, val )) {
+		return OA_ERR_NONE;
+	}
+
   // Could do more validation here, but it's a bit messy to do here
   // and in the controller too.
 
@@ -364,7 +378,7 @@ oacamReadControl ( oaCamera* camera, int control,
   command.resultData = val;
 
   oaDLListAddToTail ( cameraInfo->commandQueue, &command );
-  pthread_cond_broadcast ( &cameraInfo->commandQueued );
+  oacamWakeController ( cameraInfo );
   pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
   while ( !command.completed ) {
     pthread_cond_wait ( &cameraInfo->commandComplete,
@@ -396,7 +410,7 @@ oacamStartStreaming ( oaCamera* camera,
   command.commandData = ( void* ) &callbackData;
 
   oaDLListAddToTail ( cameraInfo->commandQueue, &command );
-  pthread_cond_broadcast ( &cameraInfo->commandQueued );
+  oacamWakeController ( cameraInfo );
   pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
   while ( !command.completed ) {
     pthread_cond_wait ( &cameraInfo->commandComplete,
@@ -433,7 +447,7 @@ oacamStopStreaming ( oaCamera* camera )
   command.commandType = OA_CMD_STOP_STREAMING;
 
   oaDLListAddToTail ( cameraInfo->commandQueue, &command );
-  pthread_cond_broadcast ( &cameraInfo->commandQueued );
+  oacamWakeController ( cameraInfo );
   pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
   while ( !command.completed ) {
     pthread_cond_wait ( &cameraInfo->commandComplete,
@@ -448,27 +462,46 @@ oacamStopStreaming ( oaCamera* camera )
 }
 
 
+static int
+_checkControlType ( oaCamera* camera, int control, const oaControlValue* val )
+{
+	int		modifier, baseVal;
+
+	modifier = OA_CAM_CTRL_MODIFIER( control );
+	baseVal = OA_CAM_CTRL_MODE_BASE ( control );
+	if ( val->valueType != camera->controlType[ modifier ][ baseVal ] ) {
+		oaLogError ( OA_LOG_CAMERA, "%s: invalid control type %d for control %d",
+            __func__, val->valueType, control  );
+		return -OA_ERR_INVALID_CONTROL_TYPE;
+	}
+	return OA_ERR_NONE;
+}
+
+
 int
 oacamSetControl ( oaCamera* camera, int control, oaControlValue* val,
     int dontWait )
 {
   OA_COMMAND	command;
   SHARED_STATE*	cameraInfo;
+  ASYNC_COMMAND**	p;
   int		retval = OA_ERR_NONE;
-	int		modifier, baseVal;
 
   oaLogInfo ( OA_LOG_CAMERA, "%s ( %p, %d, %p, %d ): entered", __func__,
 			camera, control, val, dontWait );
 
-	modifier = OA_CAM_CTRL_MODIFIER( control );
-	baseVal = OA_CAM_CTRL_MODE_BASE ( control );
-	if ( val->valueType != camera->controlType[ modifier ][ baseVal ] ) {
-		oaLogError ( OA_LOG_CAMERA, "%s: invalid control type %d for control %d",
-            __func__, val->valueType, control  );
-		return -OA_ERR_INVALID_CONTROL_TYPE;
+	if (( retval = _checkControlType ( camera, control, val )) !=
+			OA_ERR_NONE ) {
+		return retval;
 	}
  
-  // At this point we have a new control setting that we think is good
+  // At this point we have a new control setting that we think is good.
+	// If the caller doesn't want to wait then the command can't live on our
+	// stack, so hand it over to the asynchronous code to copy
+
+	if ( dontWait ) {
+		return oacamSetControlAsync ( camera, control, val, 0, 0 );
+	}
 
   OA_CLEAR ( command );
   command.commandType = OA_CMD_CONTROL_SET;
@@ -476,17 +509,28 @@ oacamSetControl ( oaCamera* camera, int control, oaControlValue* val,
   command.commandData = val;
 
   cameraInfo = camera->_private;
+
+	// An asynchronous change to this control still waiting in the queue
+	// will now be made before this one, so later asynchronous changes
+	// mustn't be merged into it or this value would overwrite them
+	pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
+	for ( p = &cameraInfo->asyncPending; *p; p = &( *p )->nextPending ) {
+		if (( *p )->command.controlId == ( unsigned int ) control ) {
+			*p = ( *p )->nextPending;
+			break;
+		}
+	}
   oaDLListAddToTail ( cameraInfo->commandQueue, &command );
-  pthread_cond_broadcast ( &cameraInfo->commandQueued );
-  if ( !dontWait ) {
-    pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
-    while ( !command.completed ) {
-      pthread_cond_wait ( &cameraInfo->commandComplete,
-          &cameraInfo->commandQueueMutex );
-    }
-    pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
-    retval = command.resultCode;
+	pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
+
+  oacamWakeController ( cameraInfo );
+  pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
+  while ( !command.completed ) {
+    pthread_cond_wait ( &cameraInfo->commandComplete,
+        &cameraInfo->commandQueueMutex );
   }
+  pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
+  retval = command.resultCode;
 
 	oaLogInfo ( OA_LOG_CAMERA, "%s: exiting", __func__ );
 
@@ -494,6 +538,145 @@ oacamSetControl ( oaCamera* camera, int control, oaControlValue* val,
 }
 
 
+int
+oacamSetControlAsync ( oaCamera* camera, int control, oaControlValue* val,
+		void ( *callback )( void*, int ), void* callbackArg )
+{
+	return oacamSetControls ( camera, 1, &control, val, callback,
+			callbackArg );
+}
+
+
+/**
+ * Queue changes to a number of controls without waiting for them to be
+ * made.  The controller thread drains its whole queue before it goes back
+ * to handling frames, so a batch queued together is applied together.
+ *
+ * If a change to the same control is still waiting in the queue, and no
+ * synchronous change to it has been queued since, the new value replaces
+ * the old one in its place in the queue rather than being queued as well,
+ * so a burst of changes (from a slider being dragged, say) becomes a
+ * single write to the camera.  A batch with a change overtaken this way
+ * completes with -OA_ERR_SUPERSEDED unless another of its changes failed
+ * outright.
+ *
+ * When all of the batch's changes have been made, callback (if given) is
+ * called with callbackArg and the first error returned, normally from the
+ * controller thread.  It must not wait for anything else on the camera's
+ * command queue.
+ */
+
+int
+oacamSetControls ( oaCamera* camera, int count, const int* controls,
+		const oaControlValue* values, void ( *callback )( void*, int ),
+		void* callbackArg )
+{
+	SHARED_STATE*		cameraInfo = camera->_private;
+	ASYNC_BATCH*		batch;
+	ASYNC_BATCH*		previous;
+	ASYNC_BATCH*		done = 0;
+	ASYNC_COMMAND*	spare = 0;
+	ASYNC_COMMAND*	command;
+	int							i, ret, queued = 0;
+
+	if ( count < 1 ) {
+		return -OA_ERR_OUT_OF_RANGE;
+	}
+	for ( i = 0; i < count; i++ ) {
+		if (( ret = _checkControlType ( camera, controls[i], &values[i] )) !=
+				OA_ERR_NONE ) {
+			return ret;
+		}
+	}
+
+	// Allocate everything up front so that nothing can fail once we start
+	// putting commands on the queue
+
+	if (!( batch = calloc ( 1, sizeof ( ASYNC_BATCH )))) {
+		oaLogError ( OA_LOG_CAMERA, "%s: malloc of batch failed", __func__ );
+		return -OA_ERR_MEM_ALLOC;
+	}
+	batch->callback = callback;
+	batch->callbackArg = callbackArg;
+	for ( i = 0; i < count; i++ ) {
+		if (!( command = calloc ( 1, sizeof ( ASYNC_COMMAND )))) {
+			oaLogError ( OA_LOG_CAMERA, "%s: malloc of command failed", __func__ );
+			while ( spare ) {
+				command = spare->nextPending;
+				free (( void* ) spare );
+				spare = command;
+			}
+			free (( void* ) batch );
+			return -OA_ERR_MEM_ALLOC;
+		}
+		command->nextPending = spare;
+		spare = command;
+	}
+
+	pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
+	for ( i = 0; i < count; i++ ) {
+		command = cameraInfo->asyncPending;
+		while ( command && command->command.controlId !=
+				( unsigned int ) controls[i] ) {
+			command = command->nextPending;
+		}
+		if ( command ) {
+			command->value = values[i];
+			previous = command->command.callback;
+			if ( previous != batch ) {
+				if ( previous->resultCode == OA_ERR_NONE ) {
+					previous->resultCode = -OA_ERR_SUPERSEDED;
+				}
+				if ( !--previous->remaining ) {
+					previous->nextDone = done;
+					done = previous;
+				}
+				command->command.callback = batch;
+				batch->remaining++;
+			}
+		} else {
+			command = spare;
+			spare = spare->nextPending;
+			command->command.commandType = OA_CMD_CONTROL_SET;
+			command->command.controlId = controls[i];
+			command->command.commandData = &command->value;
+			command->command.callback = batch;
+			command->value = values[i];
+			command->nextPending = cameraInfo->asyncPending;
+			cameraInfo->asyncPending = command;
+			batch->remaining++;
+			oaDLListAddToTail ( cameraInfo->commandQueue, command );
+			queued++;
+		}
+	}
+	pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
+
+	if ( queued ) {
+		oacamWakeController ( cameraInfo );
+	}
+
+	while ( spare ) {
+		command = spare->nextPending;
+		free (( void* ) spare );
+		spare = command;
+	}
+
+	// Batches that had all their changes overtaken by this one are finished
+	// now
+
+	while ( done ) {
+		previous = done->nextDone;
+		if ( done->callback ) {
+			done->callback ( done->callbackArg, done->resultCode );
+		}
+		free (( void* ) done );
+		done = previous;
+	}
+
+	return OA_ERR_NONE;
+}
+
+
 int
 oacamStartExposure ( oaCamera* camera,
     void* (*callback)(void*, void*, int, void* ), void* callbackArg )
@@ -513,7 +696,7 @@ oacamStartExposure ( oaCamera* camera,
   command.commandData = ( void* ) &callbackData;
 
   oaDLListAddToTail ( cameraInfo->commandQueue, &command );
-  pthread_cond_broadcast ( &cameraInfo->commandQueued );
+  oacamWakeController ( cameraInfo );
   pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
   while ( !command.completed ) {
     pthread_cond_wait ( &cameraInfo->commandComplete,
@@ -541,7 +724,7 @@ oacamAbortExposure ( oaCamera* camera )
   command.commandType = OA_CMD_ABORT_EXPOSURE;
 
   oaDLListAddToTail ( cameraInfo->commandQueue, &command );
-  pthread_cond_broadcast ( &cameraInfo->commandQueued );
+  oacamWakeController ( cameraInfo );
   pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
   while ( !command.completed ) {
     pthread_cond_wait ( &cameraInfo->commandComplete,
@@ -571,8 +754,11 @@ oacamSetResolution ( oaCamera* camera, int x, int y )
   oaLogDebug ( OA_LOG_CAMERA, "%s: setting resolution to %dx%d", __func__, x, y );
   command.commandData = &s;
   cameraInfo = camera->_private;
+  // a software ROI doesn't survive a change of resolution any more than a
+  // hardware one would
+  __atomic_store_n ( &cameraInfo->softROI, 0, __ATOMIC_RELEASE );
   oaDLListAddToTail ( cameraInfo->commandQueue, &command );
-  pthread_cond_broadcast ( &cameraInfo->commandQueued );
+  oacamWakeController ( cameraInfo );
   pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
   while ( !command.completed ) {
     pthread_cond_wait ( &cameraInfo->commandComplete,
@@ -593,6 +779,10 @@ oacamSetROI ( oaCamera* camera, int x, int y )
   SHARED_STATE*	cameraInfo = camera->_private;
   int						retval;
 
+  if ( oaHasSoftwareROI ( camera )) {
+    return _oaSoftwareSetROI ( camera, x, y );
+  }
+
   OA_CLEAR ( command );
   command.commandType = OA_CMD_ROI_SET;
   s.x = x;
@@ -600,7 +790,7 @@ oacamSetROI ( oaCamera* camera, int x, int y )
   command.commandData = &s;
   cameraInfo = camera->_private;
   oaDLListAddToTail ( cameraInfo->commandQueue, &command );
-  pthread_cond_broadcast ( &cameraInfo->commandQueued );
+  oacamWakeController ( cameraInfo );
   pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
   while ( !command.completed ) {
     pthread_cond_wait ( &cameraInfo->commandComplete,
@@ -628,7 +818,7 @@ oacamSetFrameInterval ( oaCamera* camera, int numerator, int denominator )
   command.commandData = &r;
   cameraInfo = camera->_private;
   oaDLListAddToTail ( cameraInfo->commandQueue, &command );
-  pthread_cond_broadcast ( &cameraInfo->commandQueued );
+  oacamWakeController ( cameraInfo );
   pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
   while ( !command.completed ) {
     pthread_cond_wait ( &cameraInfo->commandComplete,
@@ -645,32 +835,12 @@ uint64_t
 oacamExposureTimeLeft ( oaCamera* camera )
 {
   SHARED_STATE*   cameraInfo = camera->_private;
-	struct timeval	now;
-	int64_t					endSecs, endNanoSecs, leftSecs, leftNanoSecs;
-	uint64_t				usecs;
 
 	if ( cameraInfo->runMode != CAM_RUN_MODE_SINGLE_SHOT ) {
 		return 0;
 	}
 
-	// FIX ME -- Yeah, this might get mangled by timer.c:oacamStartTimer()
-	// whilst we're reading it
-
-  endSecs = cameraInfo->timerEnd.tv_sec;
-  endNanoSecs = cameraInfo->timerEnd.tv_nsec;
-	gettimeofday ( &now, 0 );
-	leftSecs = endSecs - now.tv_sec;
-	leftNanoSecs = endNanoSecs - now.tv_usec * 1000;
-	if ( leftNanoSecs < 0 ) {
-		leftSecs--;
-		leftNanoSecs += 1000000000;
-	}
-  if ( leftSecs < 0 ) {
-		return 0;
-	}
-
-	usecs = leftSecs * 1000000 + leftNanoSecs / 1000;
-	return usecs;
+	return oacamTimerRemaining ( cameraInfo );
 }
 
 
@@ -0,0 +1,228 @@
+/*****************************************************************************
+ *
+ * controlMirror.c -- cached copies of camera control values
+ *
+ * Copyright 2026 James Fidell (james@openastroproject.org)
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+
+#include <oa_common.h>
+
+#include <openastro/camera.h>
+#include <openastro/util.h>
+
+#include "oacamprivate.h"
+#include "sharedState.h"
+
+
+static CONTROL_MIRROR_ENTRY*	_entry ( CONTROL_MIRROR*, int );
+static void			_write ( CONTROL_MIRROR_ENTRY*, uint8_t, int64_t, uint64_t );
+
+
+void
+_oaControlMirrorInit ( CONTROL_MIRROR* mirror )
+{
+	mirror->entry[ OA_CAM_CTRL_MODIFIER_STD ][ OA_CAM_CTRL_TEMPERATURE ].maxAge =
+			( uint64_t ) OA_MIRROR_TEMPERATURE_AGE * 1000;
+	mirror->entry[ OA_CAM_CTRL_MODIFIER_STD ][ OA_CAM_CTRL_DROPPED ].maxAge =
+			( uint64_t ) OA_MIRROR_DROPPED_AGE * 1000;
+}
+
+
+/**
+ * Record a value for a control.  Strings and buttons aren't kept.
+ */
+
+void
+_oaControlMirrorSet ( CONTROL_MIRROR* mirror, int control,
+		const oaControlValue* val )
+{
+	CONTROL_MIRROR_ENTRY*	entry;
+	int64_t								value;
+
+	if (!( entry = _entry ( mirror, control ))) {
+		return;
+	}
+
+	switch ( val->valueType ) {
+		case OA_CTRL_TYPE_INT32:
+			value = val->int32;
+			break;
+		case OA_CTRL_TYPE_INT64:
+			value = val->int64;
+			break;
+		case OA_CTRL_TYPE_READONLY:
+			value = val->readonly;
+			break;
+		case OA_CTRL_TYPE_BOOLEAN:
+			value = val->boolean;
+			break;
+		case OA_CTRL_TYPE_MENU:
+			value = val->menu;
+			break;
+		case OA_CTRL_TYPE_DISCRETE:
+		case OA_CTRL_TYPE_DISC_MENU:
+			value = val->discrete;
+			break;
+		default:
+			return;
+	}
+
+	_write ( entry, val->valueType, value, _oaMonotonicTime());
+}
+
+
+void
+_oaControlMirrorInvalidate ( CONTROL_MIRROR* mirror, int control )
+{
+	CONTROL_MIRROR_ENTRY*	entry;
+
+	if (( entry = _entry ( mirror, control ))) {
+		_write ( entry, 0, 0, 0 );
+	}
+}
+
+
+/**
+ * Fill in val from the mirror if there's a value for the control that is
+ * recent enough by the control's policy.  Returns 1 if it did, or 0 if
+ * the camera needs to be asked.
+ */
+
+int
+_oaControlMirrorGet ( CONTROL_MIRROR* mirror, int control,
+		oaControlValue* val )
+{
+	CONTROL_MIRROR_ENTRY*	entry;
+	uint32_t							seq;
+	uint8_t								valueType;
+	int64_t								value;
+	uint64_t							updated, maxAge;
+
+	if (!( entry = _entry ( mirror, control ))) {
+		return 0;
+	}
+	if (!( maxAge = __atomic_load_n ( &entry->maxAge, __ATOMIC_RELAXED ))) {
+		return 0;
+	}
+
+	seq = __atomic_load_n ( &entry->seq, __ATOMIC_ACQUIRE );
+	if ( seq & 1 ) {
+		return 0;
+	}
+	valueType = __atomic_load_n ( &entry->valueType, __ATOMIC_RELAXED );
+	value = __atomic_load_n ( &entry->value, __ATOMIC_RELAXED );
+	updated = __atomic_load_n ( &entry->updated, __ATOMIC_RELAXED );
+	__atomic_thread_fence ( __ATOMIC_ACQUIRE );
+	if ( __atomic_load_n ( &entry->seq, __ATOMIC_RELAXED ) != seq ) {
+		return 0;
+	}
+
+	if ( !updated || _oaMonotonicTime() - updated > maxAge ) {
+		return 0;
+	}
+
+	val->valueType = valueType;
+	switch ( valueType ) {
+		case OA_CTRL_TYPE_INT32:
+			val->int32 = value;
+			break;
+		case OA_CTRL_TYPE_INT64:
+			val->int64 = value;
+			break;
+		case OA_CTRL_TYPE_READONLY:
+			val->readonly = value;
+			break;
+		case OA_CTRL_TYPE_BOOLEAN:
+			val->boolean = value;
+			break;
+		case OA_CTRL_TYPE_MENU:
+			val->menu = value;
+			break;
+		case OA_CTRL_TYPE_DISCRETE:
+		case OA_CTRL_TYPE_DISC_MENU:
+			val->discrete = value;
+			break;
+	}
+	return 1;
+}
+
+
+/**
+ * Set how old (in microseconds) a value for the given control may be and
+ * still be returned by readControl() without asking the camera.  Zero
+ * turns the mirror off for the control.
+ */
+
+int
+oacamSetControlMaxAge ( oaCamera* camera, int control, uint64_t maxAge )
+{
+	SHARED_STATE*					cameraInfo = camera->_private;
+	CONTROL_MIRROR_ENTRY*	entry;
+
+	if (!( entry = _entry ( &cameraInfo->controlMirror, control ))) {
+		return -OA_ERR_INVALID_CONTROL;
+	}
+	__atomic_store_n ( &entry->maxAge, maxAge * 1000, __ATOMIC_RELAXED );
+	return OA_ERR_NONE;
+}
+
+
+static CONTROL_MIRROR_ENTRY*
+_entry ( CONTROL_MIRROR* mirror, int control )
+{
+	int			modifier, baseVal;
+
+	if ( control < 0 ) {
+		return 0;
+	}
+	modifier = OA_CAM_CTRL_MODIFIER( control );
+	baseVal = OA_CAM_CTRL_MODE_BASE( control );
+	if ( modifier >= OA_CAM_CTRL_MODIFIERS_LAST_P1 ||
+			baseVal >= OA_CAM_CTRL_LAST_P1 ) {
+		return 0;
+	}
+	return &mirror->entry[ modifier ][ baseVal ];
+}
+
+
+static void
+_write ( CONTROL_MIRROR_ENTRY* entry, uint8_t valueType, int64_t value,
+		uint64_t updated )
+{
+	uint32_t		seq;
+
+	// Writers are rare and quick, so if two collide one just spins until
+	// the other is done
+
+	seq = __atomic_load_n ( &entry->seq, __ATOMIC_RELAXED );
+	do {
+		while ( seq & 1 ) {
+			seq = __atomic_load_n ( &entry->seq, __ATOMIC_RELAXED );
+		}
+	} while ( !__atomic_compare_exchange_n ( &entry->seq, &seq, seq + 1, 0,
+			__ATOMIC_ACQUIRE, __ATOMIC_RELAXED ));
+	__atomic_thread_fence ( __ATOMIC_RELEASE );
+
+	__atomic_store_n ( &entry->valueType, valueType, __ATOMIC_RELAXED );
+	__atomic_store_n ( &entry->value, value, __ATOMIC_RELAXED );
+	__atomic_store_n ( &entry->updated, updated, __ATOMIC_RELAXED );
+	__atomic_store_n ( &entry->seq, seq + 2, __ATOMIC_RELEASE );
+}
@@ -0,0 +1,75 @@
+/*****************************************************************************
+ *
+ * controlMirror.h -- cached copies of camera control values
+ *
+ * Copyright 2026 James Fidell (james@openastroproject.org)
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+
+#ifndef OA_CONTROL_MIRROR_H
+#define OA_CONTROL_MIRROR_H
+
+#include <stdint.h>
+
+#include <openastro/camera.h>
+
+// How long values of some controls may be given back from the mirror
+// without asking the camera again.  Everything else goes to the camera
+// every time unless the application asks otherwise.
+
+#define	OA_MIRROR_TEMPERATURE_AGE		2000000
+#define	OA_MIRROR_DROPPED_AGE				500000
+
+typedef struct CONTROL_MIRROR_ENTRY {
+	uint32_t		seq;		// odd whilst being written
+	uint8_t			valueType;
+	int64_t			value;
+	uint64_t		updated;	// monotonic time in ns, zero if not valid
+	uint64_t		maxAge;		// in ns, zero to always ask the camera
+} CONTROL_MIRROR_ENTRY;
+
+// Entries are written by the controller thread as commands complete and
+// by any driver thread that learns a new value.  Readers don't lock: each
+// entry is a sequence lock, and a reader that races with a writer just
+// asks the camera instead.
+
+typedef struct CONTROL_MIRROR {
+	CONTROL_MIRROR_ENTRY	entry[ OA_CAM_CTRL_MODIFIERS_LAST_P1 ][
+													OA_CAM_CTRL_LAST_P1 ];
+} CONTROL_MIRROR;
+
+extern void		_oaControlMirrorInit ( CONTROL_MIRROR* );
+extern void		_oaControlMirrorSet ( CONTROL_MIRROR*, int,
+									const oaControlValue* );
+extern void		_oaControlMirrorInvalidate ( CONTROL_MIRROR*, int );
+extern int		_oaControlMirrorGet ( CONTROL_MIRROR*, int, oaControlValue* );
+
+// For drivers pushing values they've learned without being asked, such as
+// a dropped frame count
+
+#define	OA_CONTROL_MIRROR_READONLY(c,ctrl,v) \
+		do { \
+			oaControlValue	_mv; \
+			_mv.valueType = OA_CTRL_TYPE_READONLY; \
+			_mv.readonly = ( v ); \
+			_oaControlMirrorSet ( &( c )->controlMirror, ( ctrl ), &_mv ); \
+		} while ( 0 )
+
+#endif	/* OA_CONTROL_MIRROR_H */
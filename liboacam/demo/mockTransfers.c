@@ -0,0 +1,221 @@
+/*****************************************************************************
+ *
+ * mockTransfers.c
+ *
+ * check program driving the USB transfer engine through the mock transport
+ *
+ * Copyright 2026
+ *   James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <openastro/errno.h>
+
+#include "usbTransfer.h"
+
+#define	NUM_TRANSFERS		4
+#define	TRANSFER_SIZE		1024
+#define	STREAM_SIZE			( 256 * TRANSFER_SIZE )
+
+// The "driver" end: a single buffer that the stream is reserved from in
+// order, as a camera driver would reserve space in its frame buffers
+
+typedef struct {
+	unsigned char*	buffer;
+	uint64_t				delivered;
+	uint64_t				nextReserve;
+	unsigned int		payloads;
+	unsigned int		restarts;
+} mockDriver;
+
+static unsigned char	stream[ STREAM_SIZE ];
+static uint64_t				sent;
+static int						failures;
+
+static int						_payload ( void*, unsigned char*, unsigned int );
+static unsigned char*	_reserve ( void*, unsigned int, int, uint64_t );
+static void						_send ( USB_TRANSFER_ENGINE*, unsigned int, int );
+static void						_check ( int, const char* );
+static void						_checkStream ( mockDriver*, const char* );
+
+
+int
+main()
+{
+	USB_TRANSFER_ENGINE		engine;
+	mockDriver						driver;
+	unsigned int					i, payloads;
+
+	for ( i = 0; i < STREAM_SIZE; i++ ) {
+		stream[i] = ( i * 7 + 3 ) & 0xff;
+	}
+	memset ( &driver, 0, sizeof ( driver ));
+	if (!( driver.buffer = calloc ( 1, STREAM_SIZE ))) {
+		fprintf ( stderr, "buffer allocation failed\n" );
+		return 1;
+	}
+
+	_check ( _oaUSBTransferInit ( &engine, &oaUSBMockTransport, 0, 0x81, 0,
+			_payload, _reserve, &driver ) == OA_ERR_NONE, "init" );
+	_check ( _oaUSBTransferStart ( &engine, NUM_TRANSFERS, TRANSFER_SIZE ) ==
+			OA_ERR_NONE, "start" );
+	_check ( engine.inFlight == NUM_TRANSFERS, "all transfers submitted" );
+
+	// Full transfers go straight into the reserved space
+
+	for ( i = 0; i < 2 * NUM_TRANSFERS; i++ ) {
+		_send ( &engine, TRANSFER_SIZE, OA_USB_XFER_COMPLETED );
+	}
+	_checkStream ( &driver, "full transfers" );
+	_check ( engine.directBytes == sent && !engine.stagedBytes,
+			"full transfers are all direct" );
+	_check ( !engine.resync, "no resync after full transfers" );
+	_check ( engine.inFlight == NUM_TRANSFERS, "full transfers resubmitted" );
+
+	// A short transfer leaves the rest of the stream in the wrong place
+	// until everything already reserved has come back
+
+	_send ( &engine, TRANSFER_SIZE / 3, OA_USB_XFER_COMPLETED );
+	_check ( engine.resync == 1, "short transfer sets resync" );
+	_check ( engine.directInFlight == NUM_TRANSFERS - 1,
+			"transfer after short one is staged" );
+	for ( i = 0; i < 2 * NUM_TRANSFERS; i++ ) {
+		_send ( &engine, TRANSFER_SIZE, OA_USB_XFER_COMPLETED );
+	}
+	_checkStream ( &driver, "short transfer" );
+	_check ( engine.stagedBytes > 0, "short transfer used staging" );
+	_check ( !engine.resync && driver.restarts == 2,
+			"reservations restarted after short transfer" );
+
+	// A retried transfer delivers nothing and gives up its place
+
+	_send ( &engine, 0, OA_USB_XFER_RETRY );
+	_check ( engine.resync == 1, "retry sets resync" );
+	_check ( engine.inFlight == NUM_TRANSFERS, "retried transfer resubmitted" );
+	for ( i = 0; i < 2 * NUM_TRANSFERS; i++ ) {
+		_send ( &engine, TRANSFER_SIZE, OA_USB_XFER_COMPLETED );
+	}
+	_checkStream ( &driver, "retry" );
+	_check ( !engine.resync && driver.restarts == 3,
+			"reservations restarted after retry" );
+
+	// Stopping cancels everything in flight without delivering anything
+
+	payloads = driver.payloads;
+	_check ( _oaUSBTransferStop ( &engine ) == OA_ERR_NONE, "stop" );
+	_check ( !engine.inFlight && !engine.directInFlight,
+			"stop cancels transfers in flight" );
+	_check ( !engine.transfers, "stop releases transfers" );
+	_check ( driver.payloads == payloads, "no payload from cancelled transfers" );
+	_check ( _oaUSBMockComplete ( &engine, stream, TRANSFER_SIZE,
+			OA_USB_XFER_COMPLETED ) < 0, "nothing to complete after stop" );
+
+	_oaUSBTransferFree ( &engine );
+	free (( void* ) driver.buffer );
+
+	if ( failures ) {
+		fprintf ( stderr, "%d check(s) failed\n", failures );
+		return 1;
+	}
+	printf ( "all mock transfer checks passed\n" );
+	return 0;
+}
+
+
+static int
+_payload ( void* arg, unsigned char* data, unsigned int length )
+{
+	mockDriver*			driver = arg;
+	unsigned char*	target = driver->buffer + driver->delivered;
+
+	if ( data != target ) {
+		memmove ( target, data, length );
+	}
+	driver->delivered += length;
+	driver->payloads++;
+	return 0;
+}
+
+
+static unsigned char*
+_reserve ( void* arg, unsigned int length, int restart, uint64_t inFlight )
+{
+	mockDriver*			driver = arg;
+	unsigned char*	p;
+
+	if ( restart ) {
+		driver->nextReserve = driver->delivered + inFlight;
+		driver->restarts++;
+	}
+	if ( driver->nextReserve + length > STREAM_SIZE ) {
+		return 0;
+	}
+	p = driver->buffer + driver->nextReserve;
+	driver->nextReserve += length;
+	return p;
+}
+
+
+// Play the device, completing the oldest transfer with the next length
+// bytes of the stream
+
+static void
+_send ( USB_TRANSFER_ENGINE* engine, unsigned int length, int status )
+{
+	int		ret;
+
+	if ( sent + length > STREAM_SIZE ) {
+		_check ( 0, "stream long enough" );
+		return;
+	}
+	ret = _oaUSBMockComplete ( engine, stream + sent, length, status );
+	_check ( ret >= 0, "mock completion" );
+	if ( ret > 0 ) {
+		sent += ret;
+	}
+}
+
+
+static void
+_check ( int ok, const char* what )
+{
+	if ( !ok ) {
+		fprintf ( stderr, "FAILED: %s\n", what );
+		failures++;
+	}
+}
+
+
+static void
+_checkStream ( mockDriver* driver, const char* what )
+{
+	char		msg[ 128 ];
+
+	snprintf ( msg, sizeof ( msg ), "%s: all data delivered", what );
+	_check ( driver->delivered == sent, msg );
+	snprintf ( msg, sizeof ( msg ), "%s: data in stream order", what );
+	_check ( !memcmp ( driver->buffer, stream, sent ), msg );
+}
@@ -44,6 +44,8 @@ oacamDummyCallbackHandler ( void* param )
   CALLBACK*		callback;
   int			exitThread = 0;
   void*			(*callbackFunc)( void*, void*, int, void* );
+  void*			frame;
+  int				frameLen;
 
   do {
     pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
@@ -53,13 +55,14 @@ oacamDummyCallbackHandler ( void* param )
     if ( exitThread ) {
       break;
     } else {
-      // try to prevent busy-waiting
+      // try to prevent busy-waiting.  The test has to be made with the
+      // lock held or a frame queued in between could be missed.
+      pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
       if ( oaDLListIsEmpty ( cameraInfo->callbackQueue )) {
-        pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
         pthread_cond_wait ( &cameraInfo->callbackQueued,
             &cameraInfo->callbackQueueMutex );
-        pthread_mutex_unlock ( &cameraInfo->callbackQueueMutex );
       }
+      pthread_mutex_unlock ( &cameraInfo->callbackQueueMutex );
     }
 
     callback = oaDLListRemoveFromHead ( cameraInfo->callbackQueue );
@@ -67,11 +70,20 @@ oacamDummyCallbackHandler ( void* param )
       switch ( callback->callbackType ) {
         case OA_CALLBACK_NEW_FRAME:
           callbackFunc = callback->callback;
-          callbackFunc ( callback->callbackArg, callback->buffer,
-              callback->bufferLen, 0 );
+          frame = callback->buffer;
+          frameLen = callback->bufferLen;
+          _oaSoftwareFrame ( camera, &frame, &frameLen, 0 );
+          OA_FRAME_STATS_CB_STAMP ( cameraInfo, callback,
+              OA_FRAME_STAGE_CALLBACK );
+          callbackFunc ( callback->callbackArg, frame, frameLen, 0 );
+          OA_FRAME_STATS_CB_STAMP ( cameraInfo, callback,
+              OA_FRAME_STAGE_RETURNED );
+          OA_FRAME_STATS_CB_COMPLETE ( cameraInfo, callback );
           pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
           cameraInfo->buffersFree++;
           pthread_mutex_unlock ( &cameraInfo->callbackQueueMutex );
+          // the controller may be waiting for a buffer to come back
+          pthread_cond_broadcast ( &cameraInfo->callbackQueued );
           break;
         default:
           oaLogError ( OA_LOG_CAMERA, "%s: unexpected callback type %d",
@@ -0,0 +1,214 @@
+/*****************************************************************************
+ *
+ * dummyConfig.c -- configuration of the synthetic image source
+ *
+ * Copyright 2026 James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <oa_common.h>
+
+#include <pthread.h>
+
+#include <openastro/camera.h>
+#include <openastro/util.h>
+#include <openastro/video/formats.h>
+
+#include "oacamprivate.h"
+#include "dummyoacam.h"
+
+
+static pthread_mutex_t	configMutex = PTHREAD_MUTEX_INITIALIZER;
+static oaDummyConfig		userConfig;
+static int							userConfigSet = 0;
+
+
+void
+oaDummyDefaultConfig ( oaDummyConfig* config )
+{
+	memset ( config, 0, sizeof ( oaDummyConfig ));
+	config->scene = OA_DUMMY_SCENE_STARS;
+	config->format = OA_PIX_FMT_GREY16LE;
+	config->xSize = 1920;
+	config->ySize = 1080;
+	config->frameRate = 50;
+	config->mode = OA_DUMMY_MODE_PACED;
+	config->seed = 1;
+	config->numStars = 500;
+	config->seeing = 3.0;
+	config->jitter = 1.5;
+	config->noise = 200;
+}
+
+
+int
+oaDummyParseConfig ( const char* str, oaDummyConfig* config )
+{
+	char					buffer[ OA_DUMMY_MAX_PATH + 64 ];
+	char*					key;
+	char*					value;
+	char*					next;
+	const DUMMY_FORMAT*	format;
+	unsigned int	x, y;
+
+	if ( strlen ( str ) >= sizeof ( buffer )) {
+		return -OA_ERR_OUT_OF_RANGE;
+	}
+	( void ) strcpy ( buffer, str );
+
+	for ( key = buffer; key && *key; key = next ) {
+		if (( next = strchr ( key, ',' ))) {
+			*next++ = 0;
+		}
+		if (!( value = strchr ( key, '=' ))) {
+			oaLogError ( OA_LOG_CAMERA, "%s: no value for '%s'", __func__, key );
+			return -OA_ERR_INVALID_COMMAND;
+		}
+		*value++ = 0;
+
+		if ( !strcmp ( key, "scene" )) {
+			if ( !strcmp ( value, "stars" )) {
+				config->scene = OA_DUMMY_SCENE_STARS;
+			} else if ( !strcmp ( value, "planet" )) {
+				config->scene = OA_DUMMY_SCENE_PLANET;
+			} else if ( !strcmp ( value, "ser" )) {
+				config->scene = OA_DUMMY_SCENE_SER;
+			} else {
+				oaLogError ( OA_LOG_CAMERA, "%s: unknown scene '%s'", __func__,
+						value );
+				return -OA_ERR_OUT_OF_RANGE;
+			}
+		} else if ( !strcmp ( key, "size" )) {
+			if ( sscanf ( value, "%ux%u", &x, &y ) != 2 || !x || !y ) {
+				oaLogError ( OA_LOG_CAMERA, "%s: invalid size '%s'", __func__,
+						value );
+				return -OA_ERR_OUT_OF_RANGE;
+			}
+			config->xSize = x;
+			config->ySize = y;
+		} else if ( !strcmp ( key, "format" )) {
+			if (!( format = _dummyFormatByName ( value ))) {
+				oaLogError ( OA_LOG_CAMERA, "%s: unsupported format '%s'", __func__,
+						value );
+				return -OA_ERR_OUT_OF_RANGE;
+			}
+			config->format = format->format;
+		} else if ( !strcmp ( key, "fps" )) {
+			config->frameRate = atof ( value );
+		} else if ( !strcmp ( key, "mode" )) {
+			if ( !strcmp ( value, "paced" )) {
+				config->mode = OA_DUMMY_MODE_PACED;
+			} else if ( !strcmp ( value, "asap" )) {
+				config->mode = OA_DUMMY_MODE_ASAP;
+			} else {
+				oaLogError ( OA_LOG_CAMERA, "%s: unknown mode '%s'", __func__,
+						value );
+				return -OA_ERR_OUT_OF_RANGE;
+			}
+		} else if ( !strcmp ( key, "seed" )) {
+			config->seed = strtoul ( value, 0, 0 );
+		} else if ( !strcmp ( key, "stars" )) {
+			config->numStars = strtoul ( value, 0, 0 );
+		} else if ( !strcmp ( key, "seeing" )) {
+			config->seeing = atof ( value );
+		} else if ( !strcmp ( key, "jitter" )) {
+			config->jitter = atof ( value );
+		} else if ( !strcmp ( key, "noise" )) {
+			config->noise = strtoul ( value, 0, 0 );
+		} else if ( !strcmp ( key, "ser" )) {
+			( void ) strncpy ( config->serFile, value, OA_DUMMY_MAX_PATH - 1 );
+			config->scene = OA_DUMMY_SCENE_SER;
+		} else {
+			oaLogError ( OA_LOG_CAMERA, "%s: unknown key '%s'", __func__, key );
+			return -OA_ERR_INVALID_COMMAND;
+		}
+	}
+
+	return OA_ERR_NONE;
+}
+
+
+int
+oaDummySetConfig ( const oaDummyConfig* config )
+{
+	if ( config ) {
+		if ( config->scene != OA_DUMMY_SCENE_SER ) {
+			if ( !_dummyFormat ( config->format )) {
+				return -OA_ERR_OUT_OF_RANGE;
+			}
+			if ( !config->xSize || !config->ySize || ( config->xSize % 2 ) ||
+					( config->ySize % 2 )) {
+				return -OA_ERR_INVALID_SIZE;
+			}
+		} else if ( !*config->serFile ) {
+			return -OA_ERR_INVALID_COMMAND;
+		}
+		if ( config->frameRate < 0 || config->seeing < 0 || config->jitter < 0 ) {
+			return -OA_ERR_OUT_OF_RANGE;
+		}
+	}
+
+	pthread_mutex_lock ( &configMutex );
+	if ( config ) {
+		userConfig = *config;
+		userConfigSet = 1;
+	} else {
+		userConfigSet = 0;
+	}
+	pthread_mutex_unlock ( &configMutex );
+
+	oaInvalidateCameraList();
+	return OA_ERR_NONE;
+}
+
+
+/**
+ * Fetch the current configuration.  Returns true if the dummy cameras
+ * should be made available, which is the case if either the application
+ * has set a configuration or the environment variable is set.
+ */
+
+int
+_dummyGetConfig ( oaDummyConfig* config )
+{
+	const char*		env;
+	int						enabled = 0;
+
+	oaDummyDefaultConfig ( config );
+
+	pthread_mutex_lock ( &configMutex );
+	if ( userConfigSet ) {
+		*config = userConfig;
+		enabled = 1;
+	}
+	pthread_mutex_unlock ( &configMutex );
+
+	if ( !enabled && ( env = getenv ( OA_DUMMY_CAMERA_ENV ))) {
+		if ( oaDummyParseConfig ( env, config ) != OA_ERR_NONE ) {
+			oaLogWarning ( OA_LOG_CAMERA, "%s: ignoring invalid %s", __func__,
+					OA_DUMMY_CAMERA_ENV );
+			oaDummyDefaultConfig ( config );
+		}
+		enabled = 1;
+	}
+
+	return enabled;
+}
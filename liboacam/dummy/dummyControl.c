@@ -27,6 +27,7 @@
 
 #include <oa_common.h>
 #include <openastro/camera.h>
+#include <openastro/video/formats.h>
 
 #include <pthread.h>
 
@@ -55,8 +56,14 @@ oaDummyCameraTestControl ( oaCamera* camera, int control,
   }
 
   switch ( control ) {
-    case OA_CAM_CTRL_GAIN:
     case OA_CAM_CTRL_EXPOSURE_ABSOLUTE:
+      if ( val->int64 >= commonInfo->OA_CAM_CTRL_MIN( control ) &&
+          val->int64 <= commonInfo->OA_CAM_CTRL_MAX( control )) {
+        return OA_ERR_NONE;
+      }
+      break;
+
+    case OA_CAM_CTRL_GAIN:
     // case OA_CAM_CTRL_GAMMA:
     case OA_CAM_CTRL_BRIGHTNESS:
       val_s32 = val->int32;
@@ -82,9 +89,18 @@ oaDummyCameraTestControl ( oaCamera* camera, int control,
       break;
     }
 
+    case OA_CAM_CTRL_FRAME_FORMAT:
+      val_s32 = val->discrete;
+      if ( val_s32 >= 0 && val_s32 < OA_PIX_FMT_LAST_P1 &&
+          camera->frameFormats[ val_s32 ]) {
+        return OA_ERR_NONE;
+      }
+      break;
+
     // This lot are all boolean, so we'll take any value
     case OA_CAM_CTRL_HFLIP:
     case OA_CAM_CTRL_VFLIP:
+    case OA_CAM_CTRL_DROPPED_RESET:
       return OA_ERR_NONE;
       break;
 
@@ -102,3 +118,30 @@ oaDummyCameraTestControl ( oaCamera* camera, int control,
 
   return -OA_ERR_OUT_OF_RANGE;
 }
+
+
+int
+oaDummyCameraSetResolution ( oaCamera* camera, int x, int y )
+{
+  FRAMESIZE		s;
+  OA_COMMAND		command;
+  DUMMY_STATE*	cameraInfo = camera->_private;
+  int			retval;
+
+  OA_CLEAR ( command );
+  command.commandType = OA_CMD_RESOLUTION_SET;
+  s.x = x;
+  s.y = y;
+  command.commandData = &s;
+  oaDLListAddToTail ( cameraInfo->commandQueue, &command );
+  pthread_cond_broadcast ( &cameraInfo->commandQueued );
+  pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
+  while ( !command.completed ) {
+    pthread_cond_wait ( &cameraInfo->commandComplete,
+        &cameraInfo->commandQueueMutex );
+  }
+  pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
+  retval = command.resultCode;
+
+  return retval;
+}
@@ -29,7 +29,9 @@
 #include <pthread.h>
 
 #include <openastro/camera.h>
+#include <openastro/video/formats.h>
 #include <sys/time.h>
+#include <time.h>
 
 #include "oacamprivate.h"
 #include "unimplemented.h"
@@ -41,6 +43,9 @@ static int	_processSetControl ( oaCamera*, OA_COMMAND* );
 static int	_processGetControl ( oaCamera*, OA_COMMAND* );
 static int	_processStreamingStart ( DUMMY_STATE*, OA_COMMAND* );
 static int	_processStreamingStop ( DUMMY_STATE*, OA_COMMAND* );
+static int	_processSetResolution ( DUMMY_STATE*, OA_COMMAND* );
+static void	_updateFrameInterval ( DUMMY_STATE* );
+static int	_frameDue ( DUMMY_STATE* );
 
 
 void*
@@ -64,15 +69,29 @@ oacamDummyController ( void* param )
       pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
       // stop us busy-waiting
       streaming = ( cameraInfo->runMode == CAM_RUN_MODE_STREAMING ) ? 1 : 0;
-      if ( !streaming && oaDLListIsEmpty ( cameraInfo->commandQueue )) {
-        pthread_cond_wait ( &cameraInfo->commandQueued,
-            &cameraInfo->commandQueueMutex );
+      if ( oaDLListIsEmpty ( cameraInfo->commandQueue )) {
+        if ( !streaming ) {
+          pthread_cond_wait ( &cameraInfo->commandQueued,
+              &cameraInfo->commandQueueMutex );
+        } else {
+          // wait until the next frame is due unless a command arrives
+          // first
+          uint64_t now = _oaMonotonicTime();
+          if ( cameraInfo->frameInterval && cameraInfo->nextFrameTime > now ) {
+            struct timespec	waitUntil;
+
+            _oaDeadline ( &waitUntil,
+                ( cameraInfo->nextFrameTime - now + 999 ) / 1000 );
+            pthread_cond_timedwait ( &cameraInfo->commandQueued,
+                &cameraInfo->commandQueueMutex, &waitUntil );
+          }
+        }
       }
       pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
     }
 
     do {
-      command = oaDLListRemoveFromHead ( cameraInfo->commandQueue );
+      command = oacamNextCommand ( cameraInfo );
       if ( command ) {
         switch ( command->commandType ) {
           case OA_CMD_CONTROL_SET:
@@ -87,23 +106,19 @@ oacamDummyController ( void* param )
           case OA_CMD_STOP_STREAMING:
             resultCode = _processStreamingStop ( cameraInfo, command );
             break;
+          case OA_CMD_RESOLUTION_SET:
+          case OA_CMD_ROI_SET:
+            resultCode = _processSetResolution ( cameraInfo, command );
+            break;
           default:
             resultCode = -OA_ERR_INVALID_CONTROL;
             break;
         }
-        if ( command->callback ) {
-					oaLogWarning ( OA_LOG_CAMERA, "%s: command has callback", __func__ );
-        } else {
-          pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
-          command->completed = 1;
-          command->resultCode = resultCode;
-          pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
-          pthread_cond_broadcast ( &cameraInfo->commandComplete );
-        }
+        oacamCommandComplete ( cameraInfo, command, resultCode );
       }
     } while ( command );
 
-    if ( streaming ) {
+    if ( streaming && _frameDue ( cameraInfo )) {
 
       pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
       imageBufferLength = cameraInfo->imageBufferLength;
@@ -111,8 +126,27 @@ oacamDummyController ( void* param )
 
       pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
       buffersFree = cameraInfo->buffersFree;
+      if ( !buffersFree && !cameraInfo->frameInterval ) {
+        // Running flat out, so wait for the application to hand a buffer
+        // back rather than spinning.  The timeout means commands still
+        // get seen.
+        struct timespec	waitUntil;
+
+        _oaDeadline ( &waitUntil, 10000 );
+        pthread_cond_timedwait ( &cameraInfo->callbackQueued,
+            &cameraInfo->callbackQueueMutex, &waitUntil );
+        buffersFree = cameraInfo->buffersFree;
+      }
       pthread_mutex_unlock ( &cameraInfo->callbackQueueMutex );
 
+      if ( !buffersFree && cameraInfo->frameInterval ) {
+        // The sensor doesn't wait, so this frame is lost
+        cameraInfo->droppedFrames++;
+        OA_CONTROL_MIRROR_READONLY ( cameraInfo, OA_CAM_CTRL_DROPPED,
+            cameraInfo->droppedFrames );
+        OA_FRAME_STATS_DROPPED ( cameraInfo );
+      }
+
       if ( buffersFree ) {
         nextBuffer = cameraInfo->nextBuffer;
 
@@ -121,6 +155,12 @@ oacamDummyController ( void* param )
         pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
 
         if ( !exitThread ) {
+          OA_FRAME_STATS_STAMP ( cameraInfo, nextBuffer,
+              OA_FRAME_STAGE_READOUT );
+          _dummyRenderFrame ( cameraInfo,
+              cameraInfo->buffers[ nextBuffer ].start );
+          OA_FRAME_STATS_STAMP ( cameraInfo, nextBuffer,
+              OA_FRAME_STAGE_COPIED );
           cameraInfo->frameCallbacks[ nextBuffer ].callbackType =
               OA_CALLBACK_NEW_FRAME;
           cameraInfo->frameCallbacks[ nextBuffer ].callback =
@@ -131,9 +171,10 @@ oacamDummyController ( void* param )
               cameraInfo->buffers[ nextBuffer ].start;
           cameraInfo->frameCallbacks[ nextBuffer ].bufferLen =
               imageBufferLength;
+          pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
+          OA_FRAME_STATS_QUEUED ( cameraInfo, nextBuffer );
           oaDLListAddToTail ( cameraInfo->callbackQueue,
               &cameraInfo->frameCallbacks[ nextBuffer ]);
-          pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
           cameraInfo->buffersFree--;
           cameraInfo->nextBuffer = ( nextBuffer + 1 ) %
               cameraInfo->configuredBuffers;
@@ -172,10 +213,27 @@ _processSetControl ( oaCamera* camera, OA_COMMAND* command )
 
     case OA_CAM_CTRL_EXPOSURE_ABSOLUTE:
       pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
-      cameraInfo->currentAbsoluteExposure = val->int32;
+      cameraInfo->currentAbsoluteExposure = val->int64;
+      _updateFrameInterval ( cameraInfo );
       pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
       break;
 
+    case OA_CAM_CTRL_FRAME_FORMAT:
+      if ( val->discrete < 0 || val->discrete >= OA_PIX_FMT_LAST_P1 ||
+          !camera->frameFormats[ val->discrete ]) {
+        return -OA_ERR_OUT_OF_RANGE;
+      }
+      pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
+      cameraInfo->currentFormat = val->discrete;
+      cameraInfo->imageBufferLength = _dummyFrameLength (
+          cameraInfo->currentFormat, cameraInfo->xSize, cameraInfo->ySize );
+      pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
+      break;
+
+    case OA_CAM_CTRL_DROPPED_RESET:
+      cameraInfo->droppedFrames = 0;
+      break;
+
     case OA_CAM_CTRL_BINNING:
       cameraInfo->binMode = val->discrete;
       break;
@@ -230,8 +288,18 @@ _processGetControl ( oaCamera* camera, OA_COMMAND* command )
       break;
 
     case OA_CAM_CTRL_EXPOSURE_ABSOLUTE:
-				val->valueType = OA_CTRL_TYPE_INT32;
-				val->int32 = cameraInfo->currentAbsoluteExposure;
+				val->valueType = OA_CTRL_TYPE_INT64;
+				val->int64 = cameraInfo->currentAbsoluteExposure;
+      break;
+
+    case OA_CAM_CTRL_FRAME_FORMAT:
+			val->valueType = OA_CTRL_TYPE_DISCRETE;
+			val->discrete = cameraInfo->currentFormat;
+      break;
+
+    case OA_CAM_CTRL_DROPPED:
+			val->valueType = OA_CTRL_TYPE_READONLY;
+			val->readonly = cameraInfo->droppedFrames;
       break;
 
     case OA_CAM_CTRL_BINNING:
@@ -282,6 +350,8 @@ _processStreamingStart ( DUMMY_STATE* cameraInfo, OA_COMMAND* command )
   cameraInfo->streamingCallback.callback = cb->callback;
   cameraInfo->streamingCallback.callbackArg = cb->callbackArg;
   pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
+  _updateFrameInterval ( cameraInfo );
+  cameraInfo->nextFrameTime = _oaMonotonicTime();
   cameraInfo->runMode = CAM_RUN_MODE_STREAMING;
   pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
   return OA_ERR_NONE;
@@ -300,3 +370,75 @@ _processStreamingStop ( DUMMY_STATE* cameraInfo, OA_COMMAND* command )
   pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
   return OA_ERR_NONE;
 }
+
+
+static int
+_processSetResolution ( DUMMY_STATE* cameraInfo, OA_COMMAND* command )
+{
+  FRAMESIZE*	size = command->commandData;
+
+  if ( !size->x || !size->y || ( size->x % 2 ) || ( size->y % 2 ) ||
+      size->x > cameraInfo->maxResolutionX ||
+      size->y > cameraInfo->maxResolutionY ) {
+    return -OA_ERR_INVALID_SIZE;
+  }
+  if ( cameraInfo->serOpen && ( size->x != cameraInfo->maxResolutionX ||
+      size->y != cameraInfo->maxResolutionY )) {
+    return -OA_ERR_INVALID_SIZE;
+  }
+
+  pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
+  cameraInfo->xSize = size->x;
+  cameraInfo->ySize = size->y;
+  cameraInfo->imageBufferLength = _dummyFrameLength (
+      cameraInfo->currentFormat, cameraInfo->xSize, cameraInfo->ySize );
+  pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
+  return OA_ERR_NONE;
+}
+
+
+/**
+ * The synthetic camera runs at the configured frame rate if it has one,
+ * otherwise every camera runs at the rate set by the exposure time.  Must
+ * be called with the command queue mutex held.
+ */
+
+static void
+_updateFrameInterval ( DUMMY_STATE* cameraInfo )
+{
+  if ( cameraInfo->config.mode == OA_DUMMY_MODE_ASAP ) {
+    cameraInfo->frameInterval = 0;
+  } else if ( cameraInfo->cameraType == DUMMY_TYPE_SYNTHETIC &&
+      cameraInfo->config.frameRate > 0 ) {
+    cameraInfo->frameInterval = 1000000000.0 / cameraInfo->config.frameRate;
+  } else {
+    cameraInfo->frameInterval = ( uint64_t )
+        cameraInfo->currentAbsoluteExposure * 1000;
+  }
+}
+
+
+/**
+ * Returns true if it's time to generate the next frame, and if so moves
+ * the schedule on to the one after
+ */
+
+static int
+_frameDue ( DUMMY_STATE* cameraInfo )
+{
+  uint64_t	now;
+
+  if ( !cameraInfo->frameInterval ) {
+    return 1;
+  }
+  now = _oaMonotonicTime();
+  if ( now < cameraInfo->nextFrameTime ) {
+    return 0;
+  }
+  cameraInfo->nextFrameTime += cameraInfo->frameInterval;
+  if ( cameraInfo->nextFrameTime < now ) {
+    // We've fallen more than a frame behind, so don't try to catch up
+    cameraInfo->nextFrameTime = now + cameraInfo->frameInterval;
+  }
+  return 1;
+}
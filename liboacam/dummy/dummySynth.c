@@ -0,0 +1,510 @@
+/*****************************************************************************
+ *
+ * dummySynth.c -- synthetic image generation for the dummy cameras
+ *
+ * Copyright 2026 James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <oa_common.h>
+
+#include <pthread.h>
+#include <math.h>
+
+#include <openastro/camera.h>
+#include <openastro/util.h>
+#include <openastro/SER.h>
+#include <openastro/video/formats.h>
+
+#include "oacamprivate.h"
+#include "dummyoacam.h"
+#include "dummystate.h"
+
+#define	NOISE_TABLE_SIZE		65536
+#define	SKY_LEVEL						1024
+#define	PLANET_LEVEL				40000
+
+static const DUMMY_FORMAT	formats[] = {
+	{ "GREY8", OA_PIX_FMT_GREY8, 8, DUMMY_PACK_8, 0 },
+	{ "GREY10P", OA_PIX_FMT_GREY10P, 10, DUMMY_PACK_10P, 0 },
+	{ "GREY12P", OA_PIX_FMT_GREY12P, 12, DUMMY_PACK_12P, 0 },
+	{ "GREY10_16LE", OA_PIX_FMT_GREY10_16LE, 10, DUMMY_PACK_16LE, 0 },
+	{ "GREY12_16LE", OA_PIX_FMT_GREY12_16LE, 12, DUMMY_PACK_16LE, 0 },
+	{ "GREY16LE", OA_PIX_FMT_GREY16LE, 16, DUMMY_PACK_16LE, 0 },
+	{ "GREY16BE", OA_PIX_FMT_GREY16BE, 16, DUMMY_PACK_16BE, 0 },
+	{ "RGGB8", OA_PIX_FMT_RGGB8, 8, DUMMY_PACK_8, "RGGB" },
+	{ "BGGR8", OA_PIX_FMT_BGGR8, 8, DUMMY_PACK_8, "BGGR" },
+	{ "GRBG8", OA_PIX_FMT_GRBG8, 8, DUMMY_PACK_8, "GRBG" },
+	{ "GBRG8", OA_PIX_FMT_GBRG8, 8, DUMMY_PACK_8, "GBRG" },
+	{ "RGGB10_16LE", OA_PIX_FMT_RGGB10_16LE, 10, DUMMY_PACK_16LE, "RGGB" },
+	{ "BGGR10_16LE", OA_PIX_FMT_BGGR10_16LE, 10, DUMMY_PACK_16LE, "BGGR" },
+	{ "GRBG10_16LE", OA_PIX_FMT_GRBG10_16LE, 10, DUMMY_PACK_16LE, "GRBG" },
+	{ "GBRG10_16LE", OA_PIX_FMT_GBRG10_16LE, 10, DUMMY_PACK_16LE, "GBRG" },
+	{ "RGGB12_16LE", OA_PIX_FMT_RGGB12_16LE, 12, DUMMY_PACK_16LE, "RGGB" },
+	{ "BGGR12_16LE", OA_PIX_FMT_BGGR12_16LE, 12, DUMMY_PACK_16LE, "BGGR" },
+	{ "GRBG12_16LE", OA_PIX_FMT_GRBG12_16LE, 12, DUMMY_PACK_16LE, "GRBG" },
+	{ "GBRG12_16LE", OA_PIX_FMT_GBRG12_16LE, 12, DUMMY_PACK_16LE, "GBRG" },
+	{ "RGGB16LE", OA_PIX_FMT_RGGB16LE, 16, DUMMY_PACK_16LE, "RGGB" },
+	{ "BGGR16LE", OA_PIX_FMT_BGGR16LE, 16, DUMMY_PACK_16LE, "BGGR" },
+	{ "GRBG16LE", OA_PIX_FMT_GRBG16LE, 16, DUMMY_PACK_16LE, "GRBG" },
+	{ "GBRG16LE", OA_PIX_FMT_GBRG16LE, 16, DUMMY_PACK_16LE, "GBRG" },
+	{ "RGGB16BE", OA_PIX_FMT_RGGB16BE, 16, DUMMY_PACK_16BE, "RGGB" },
+	{ "BGGR16BE", OA_PIX_FMT_BGGR16BE, 16, DUMMY_PACK_16BE, "BGGR" },
+	{ "GRBG16BE", OA_PIX_FMT_GRBG16BE, 16, DUMMY_PACK_16BE, "GRBG" },
+	{ "GBRG16BE", OA_PIX_FMT_GBRG16BE, 16, DUMMY_PACK_16BE, "GBRG" },
+	{ 0, 0, 0, 0, 0 }
+};
+
+static uint32_t		_random ( uint32_t* );
+static double			_gaussian ( uint32_t* );
+static void				_addStar ( DUMMY_STATE*, double, double, double, double );
+static void				_drawPlanet ( DUMMY_STATE* );
+
+
+const DUMMY_FORMAT*
+_dummyFormat ( int format )
+{
+	const DUMMY_FORMAT*	f;
+
+	for ( f = formats; f->name; f++ ) {
+		if ( f->format == format ) {
+			return f;
+		}
+	}
+	return 0;
+}
+
+
+const DUMMY_FORMAT*
+_dummyFormatByName ( const char* name )
+{
+	const DUMMY_FORMAT*	f;
+
+	if ( !strncmp ( name, "OA_PIX_FMT_", 11 )) {
+		name += 11;
+	}
+	for ( f = formats; f->name; f++ ) {
+		if ( !strcasecmp ( f->name, name )) {
+			return f;
+		}
+	}
+	return 0;
+}
+
+
+const DUMMY_FORMAT*
+_dummyFormatList ( void )
+{
+	return formats;
+}
+
+
+unsigned int
+_dummyFrameLength ( int format, unsigned int x, unsigned int y )
+{
+	const DUMMY_FORMAT*	f;
+
+	if (!( f = _dummyFormat ( format ))) {
+		return 0;
+	}
+	switch ( f->packing ) {
+		case DUMMY_PACK_8:
+			return x * y;
+		case DUMMY_PACK_10P:
+			return ( x * y * 10 + 7 ) / 8;
+		case DUMMY_PACK_12P:
+			return x * y * 3 / 2;
+	}
+	return x * y * 2;
+}
+
+
+/**
+ * Open a SER file for replay and take the frame size and format from its
+ * header.  Only monochrome and Bayer files are supported.
+ */
+
+int
+_dummyOpenSER ( DUMMY_STATE* cameraInfo )
+{
+	oaSERHeader		header;
+	const char*		cfa;
+	char					name[ 16 ];
+
+	if ( oaSEROpenRead ( cameraInfo->config.serFile, &cameraInfo->ser,
+			&header )) {
+		oaLogError ( OA_LOG_CAMERA, "%s: can't read SER file %s", __func__,
+				cameraInfo->config.serFile );
+		return -OA_ERR_SYSTEM_ERROR;
+	}
+
+	switch ( header.ColorID ) {
+		case OA_SER_MONO:
+			cfa = 0;
+			break;
+		case OA_SER_BAYER_RGGB:
+			cfa = "RGGB";
+			break;
+		case OA_SER_BAYER_GRBG:
+			cfa = "GRBG";
+			break;
+		case OA_SER_BAYER_GBRG:
+			cfa = "GBRG";
+			break;
+		case OA_SER_BAYER_BGGR:
+			cfa = "BGGR";
+			break;
+		default:
+			oaLogError ( OA_LOG_CAMERA, "%s: unsupported SER colour id %d",
+					__func__, header.ColorID );
+			oaSERClose ( &cameraInfo->ser );
+			return -OA_ERR_UNSUPPORTED_FORMAT;
+	}
+
+	// Truncated files are fine as long as there's at least one frame
+	if ( !cameraInfo->ser.frames ) {
+		oaLogError ( OA_LOG_CAMERA, "%s: no frames in %s", __func__,
+				cameraInfo->config.serFile );
+		oaSERClose ( &cameraInfo->ser );
+		return -OA_ERR_SYSTEM_ERROR;
+	}
+
+	( void ) snprintf ( name, sizeof ( name ), "%s%s", cfa ? cfa : "GREY",
+			header.PixelDepth > 8 ? ( header.LittleEndian ? "16LE" : "16BE" ) :
+			"8" );
+
+	cameraInfo->serOpen = 1;
+	cameraInfo->config.xSize = header.ImageWidth;
+	cameraInfo->config.ySize = header.ImageHeight;
+	cameraInfo->config.format = _dummyFormatByName ( name )->format;
+	return OA_ERR_NONE;
+}
+
+
+/**
+ * Build the scene that frames are cut from.  The scene is larger than the
+ * sensor by enough to allow for the image motion, so each frame is just a
+ * shifted window onto it plus noise.
+ */
+
+int
+_dummyInitScene ( DUMMY_STATE* cameraInfo )
+{
+	oaDummyConfig*	config = &cameraInfo->config;
+	uint32_t				rng;
+	unsigned int		i;
+	double					x, y, peak;
+
+	if ( config->scene == OA_DUMMY_SCENE_SER ) {
+		return OA_ERR_NONE;
+	}
+
+	cameraInfo->sceneMargin = ( unsigned int ) ceil ( config->jitter * 4 ) + 2;
+	cameraInfo->sceneWidth = cameraInfo->maxResolutionX +
+			2 * cameraInfo->sceneMargin;
+	cameraInfo->sceneHeight = cameraInfo->maxResolutionY +
+			2 * cameraInfo->sceneMargin;
+
+	if (!( cameraInfo->scene = malloc ( sizeof ( uint16_t ) *
+			cameraInfo->sceneWidth * cameraInfo->sceneHeight ))) {
+		oaLogError ( OA_LOG_CAMERA, "%s: malloc of scene failed", __func__ );
+		return -OA_ERR_MEM_ALLOC;
+	}
+	if (!( cameraInfo->noise = malloc ( sizeof ( int16_t ) *
+			NOISE_TABLE_SIZE ))) {
+		oaLogError ( OA_LOG_CAMERA, "%s: malloc of noise table failed",
+				__func__ );
+		free (( void* ) cameraInfo->scene );
+		cameraInfo->scene = 0;
+		return -OA_ERR_MEM_ALLOC;
+	}
+
+	// Everything is derived from the seed so that a given configuration
+	// always produces the same sequence of frames
+
+	rng = config->seed ? config->seed : 1;
+	for ( i = 0; i < NOISE_TABLE_SIZE; i++ ) {
+		x = _gaussian ( &rng ) * config->noise;
+		cameraInfo->noise[i] = ( x > 32767 ) ? 32767 : ( x < -32768 ) ? -32768 : x;
+	}
+
+	for ( i = 0; i < cameraInfo->sceneWidth * cameraInfo->sceneHeight; i++ ) {
+		cameraInfo->scene[i] = SKY_LEVEL;
+	}
+
+	if ( config->scene == OA_DUMMY_SCENE_PLANET ) {
+		_drawPlanet ( cameraInfo );
+		cameraInfo->cfaGain[0][0] = 256;	// red
+		cameraInfo->cfaGain[0][1] = 224;	// green
+		cameraInfo->cfaGain[1][0] = 160;	// blue
+	} else {
+		for ( i = 0; i < config->numStars; i++ ) {
+			x = ( _random ( &rng ) / 4294967296.0 ) * cameraInfo->sceneWidth;
+			y = ( _random ( &rng ) / 4294967296.0 ) * cameraInfo->sceneHeight;
+			// Mostly faint stars with the occasional bright one
+			peak = 60000.0 * pow ( 2.0, -( _random ( &rng ) / 4294967296.0 ) * 8 );
+			_addStar ( cameraInfo, x, y, peak, config->seeing );
+		}
+		cameraInfo->cfaGain[0][0] = 232;
+		cameraInfo->cfaGain[0][1] = 256;
+		cameraInfo->cfaGain[1][0] = 216;
+	}
+	cameraInfo->rngState = rng;
+
+	return OA_ERR_NONE;
+}
+
+
+void
+_dummyFreeScene ( DUMMY_STATE* cameraInfo )
+{
+	if ( cameraInfo->scene ) {
+		free (( void* ) cameraInfo->scene );
+		cameraInfo->scene = 0;
+	}
+	if ( cameraInfo->noise ) {
+		free (( void* ) cameraInfo->noise );
+		cameraInfo->noise = 0;
+	}
+	if ( cameraInfo->serOpen ) {
+		oaSERClose ( &cameraInfo->ser );
+		cameraInfo->serOpen = 0;
+	}
+}
+
+
+/**
+ * Write the next frame into the given buffer in the current format and
+ * frame size.  Called from the controller thread only.
+ */
+
+void
+_dummyRenderFrame ( DUMMY_STATE* cameraInfo, void* buffer )
+{
+	const DUMMY_FORMAT*	fmt;
+	uint8_t*						t = buffer;
+	uint16_t*						s;
+	uint32_t						rng, noiseIndex, scale, offset, gain[2][2];
+	uint64_t						bitBuffer = 0;
+	unsigned int				x, y, xSize, ySize, x0, y0, shift, bitCount = 0;
+	int									dx, dy, v, margin;
+	uint16_t						prev = 0;
+
+	if ( cameraInfo->serOpen ) {
+		// Go round again from the start once the file runs out
+		if ( oaSERReadFrame ( &cameraInfo->ser, buffer )) {
+			if ( oaSERRewind ( &cameraInfo->ser ) ||
+					oaSERReadFrame ( &cameraInfo->ser, buffer )) {
+				oaLogError ( OA_LOG_CAMERA, "%s: can't read SER frame", __func__ );
+			}
+		}
+		cameraInfo->frameNumber++;
+		return;
+	}
+
+	if (!( fmt = _dummyFormat ( cameraInfo->currentFormat ))) {
+		return;
+	}
+
+	// Each frame has its own generator state so any frame can be
+	// reproduced on its own
+
+	rng = ( cameraInfo->rngState ^ ( uint32_t ) ( cameraInfo->frameNumber *
+			2654435761U )) | 1;
+	_random ( &rng );
+	margin = cameraInfo->sceneMargin;
+	dx = lrint ( _gaussian ( &rng ) * cameraInfo->config.jitter );
+	dy = lrint ( _gaussian ( &rng ) * cameraInfo->config.jitter );
+	dx = ( dx > margin ) ? margin : ( dx < -margin ) ? -margin : dx;
+	dy = ( dy > margin ) ? margin : ( dy < -margin ) ? -margin : dy;
+	noiseIndex = _random ( &rng );
+
+	xSize = cameraInfo->xSize;
+	ySize = cameraInfo->ySize;
+	x0 = margin + dx + ( cameraInfo->maxResolutionX - xSize ) / 2;
+	y0 = margin + dy + ( cameraInfo->maxResolutionY - ySize ) / 2;
+
+	// Gain of 50 is unity and brightness is a pedestal.  The per-pixel
+	// multiplier ends up as a 16.16 fixed point value.
+	scale = cameraInfo->currentGain * 256 / 50;
+	offset = cameraInfo->currentBrightness * 256;
+	shift = 16 - fmt->bits;
+
+	for ( y = 0; y < 2; y++ ) {
+		for ( x = 0; x < 2; x++ ) {
+			if ( !fmt->cfa ) {
+				gain[y][x] = scale * 256;
+			} else {
+				switch ( fmt->cfa[ y * 2 + x ] ) {
+					case 'R':
+						gain[y][x] = scale * cameraInfo->cfaGain[0][0];
+						break;
+					case 'B':
+						gain[y][x] = scale * cameraInfo->cfaGain[1][0];
+						break;
+					default:
+						gain[y][x] = scale * cameraInfo->cfaGain[0][1];
+						break;
+				}
+			}
+		}
+	}
+
+	for ( y = 0; y < ySize; y++ ) {
+		s = cameraInfo->scene + ( y0 + y ) * cameraInfo->sceneWidth + x0;
+		for ( x = 0; x < xSize; x++ ) {
+			v = (( uint64_t ) s[x] * gain[ y & 1 ][ x & 1 ] >> 16 ) + offset +
+					cameraInfo->noise[ noiseIndex++ & ( NOISE_TABLE_SIZE - 1 )];
+			v = ( v < 0 ) ? 0 : ( v > 65535 ) ? 65535 : v;
+			v >>= shift;
+
+			switch ( fmt->packing ) {
+				case DUMMY_PACK_8:
+					*t++ = v;
+					break;
+				case DUMMY_PACK_16LE:
+					*t++ = v & 0xff;
+					*t++ = v >> 8;
+					break;
+				case DUMMY_PACK_16BE:
+					*t++ = v >> 8;
+					*t++ = v & 0xff;
+					break;
+				case DUMMY_PACK_10P:
+					// LSB-first bit stream, as GenICam Mono10p
+					bitBuffer |= ( uint64_t ) v << bitCount;
+					bitCount += 10;
+					while ( bitCount >= 8 ) {
+						*t++ = bitBuffer & 0xff;
+						bitBuffer >>= 8;
+						bitCount -= 8;
+					}
+					break;
+				case DUMMY_PACK_12P:
+					// Same layout as oaLittleEndianPackedGrey12ToGrey16() expects
+					if (( x & 1 ) == 0 ) {
+						prev = v;
+					} else {
+						*t++ = prev >> 4;
+						*t++ = ( prev & 0x0f ) | (( v & 0x0f ) << 4 );
+						*t++ = v >> 4;
+					}
+					break;
+			}
+		}
+	}
+	if ( bitCount ) {
+		*t = bitBuffer & 0xff;
+	}
+
+	cameraInfo->frameNumber++;
+}
+
+
+static void
+_addStar ( DUMMY_STATE* cameraInfo, double cx, double cy, double peak,
+		double fwhm )
+{
+	double				sigma, twoSigmaSq, d2, v;
+	int						x, y, x1, x2, y1, y2, r;
+	uint16_t*			p;
+
+	sigma = ( fwhm > 0.5 ? fwhm : 0.5 ) / 2.3548;
+	twoSigmaSq = 2 * sigma * sigma;
+	r = ( int ) ceil ( sigma * 4 );
+	x1 = ( cx - r < 0 ) ? 0 : cx - r;
+	y1 = ( cy - r < 0 ) ? 0 : cy - r;
+	x2 = ( cx + r >= cameraInfo->sceneWidth ) ? cameraInfo->sceneWidth - 1 :
+			cx + r;
+	y2 = ( cy + r >= cameraInfo->sceneHeight ) ? cameraInfo->sceneHeight - 1 :
+			cy + r;
+
+	for ( y = y1; y <= y2; y++ ) {
+		p = cameraInfo->scene + y * cameraInfo->sceneWidth;
+		for ( x = x1; x <= x2; x++ ) {
+			d2 = ( x + 0.5 - cx ) * ( x + 0.5 - cx ) +
+					( y + 0.5 - cy ) * ( y + 0.5 - cy );
+			v = p[x] + peak * exp ( -d2 / twoSigmaSq );
+			p[x] = ( v > 65535 ) ? 65535 : v;
+		}
+	}
+}
+
+
+/**
+ * A limb-darkened disc with some banding, roughly the size of Jupiter on a
+ * typical planetary setup
+ */
+
+static void
+_drawPlanet ( DUMMY_STATE* cameraInfo )
+{
+	double				cx, cy, radius, r2, mu, band, v, yr;
+	unsigned int	x, y;
+	uint16_t*			p;
+
+	cx = cameraInfo->sceneWidth / 2.0;
+	cy = cameraInfo->sceneHeight / 2.0;
+	radius = (( cameraInfo->maxResolutionX < cameraInfo->maxResolutionY ) ?
+			cameraInfo->maxResolutionX : cameraInfo->maxResolutionY ) * 0.35;
+
+	for ( y = 0; y < cameraInfo->sceneHeight; y++ ) {
+		p = cameraInfo->scene + y * cameraInfo->sceneWidth;
+		yr = ( y + 0.5 - cy ) / radius;
+		band = 1.0 - 0.18 * cos ( yr * M_PI * 5.5 ) * cos ( yr * M_PI * 1.3 );
+		for ( x = 0; x < cameraInfo->sceneWidth; x++ ) {
+			r2 = (( x + 0.5 - cx ) * ( x + 0.5 - cx ) + ( y + 0.5 - cy ) *
+					( y + 0.5 - cy )) / ( radius * radius );
+			if ( r2 < 1.0 ) {
+				mu = sqrt ( 1.0 - r2 );
+				v = SKY_LEVEL + PLANET_LEVEL * ( 0.35 + 0.65 * mu ) * band;
+				// soften the limb over a pixel or so
+				if ( r2 > 0.98 ) {
+					v = SKY_LEVEL + ( v - SKY_LEVEL ) * ( 1.0 - r2 ) / 0.02;
+				}
+				p[x] = ( v > 65535 ) ? 65535 : v;
+			}
+		}
+	}
+}
+
+
+static uint32_t
+_random ( uint32_t* state )
+{
+	uint32_t		x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return *state = x;
+}
+
+
+static double
+_gaussian ( uint32_t* state )
+{
+	double		u1, u2;
+
+	u1 = ( _random ( state ) + 1.0 ) / 4294967297.0;
+	u2 = _random ( state ) / 4294967296.0;
+	return sqrt ( -2.0 * log ( u1 )) * cos ( 2 * M_PI * u2 );
+}
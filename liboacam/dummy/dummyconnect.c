@@ -42,6 +42,8 @@
 static void _dummyInitFunctionPointers ( oaCamera* );
 static int	_initAstroCamera ( oaCamera*, DUMMY_STATE*, COMMON_INFO* );
 static int	_initDSLR ( oaCamera*, DUMMY_STATE*, COMMON_INFO* );
+static int	_initSynthetic ( oaCamera*, DUMMY_STATE* );
+static void	_freeFrameSizes ( DUMMY_STATE* );
 
 /**
  * Initialise a given camera device
@@ -54,7 +56,8 @@ oaDummyInitCamera ( oaCameraDevice* device )
   DEVICE_INFO*		devInfo;
   DUMMY_STATE*		cameraInfo;
   COMMON_INFO*		commonInfo;
-  int          		i, j, multiplier, ret;
+  int          		i, j, ret;
+  unsigned int		bufferLength;
 
 	oaLogInfo ( OA_LOG_CAMERA, "%s ( %p ): entered", __func__, device );
 
@@ -71,6 +74,7 @@ oaDummyInitCamera ( oaCameraDevice* device )
   camera->interface = device->interface;
   cameraInfo->index = devInfo->devIndex;
   cameraInfo->cameraType = devInfo->devType;
+  ( void ) _dummyGetConfig ( &cameraInfo->config );
 
   OA_CLEAR ( camera->controlType );
   OA_CLEAR ( camera->features );
@@ -79,7 +83,7 @@ oaDummyInitCamera ( oaCameraDevice* device )
 
   cameraInfo->runMode = CAM_RUN_MODE_STOPPED;
 
-	if ( cameraInfo->cameraType < 2 ) {
+	if ( cameraInfo->cameraType != DUMMY_TYPE_DSLR ) {
 		ret = _initAstroCamera ( camera, cameraInfo, commonInfo );
 	} else {
 		ret = _initDSLR ( camera, cameraInfo, commonInfo );
@@ -94,12 +98,25 @@ oaDummyInitCamera ( oaCameraDevice* device )
   cameraInfo->buffers = 0;
   cameraInfo->configuredBuffers = 0;
 
-  multiplier = cameraInfo->cameraType ? 2 : 1;
-  cameraInfo->imageBufferLength = cameraInfo->maxResolutionX *
-      cameraInfo->maxResolutionY * multiplier;
-  cameraInfo->buffers = calloc ( OA_CAM_BUFFERS, sizeof ( frameBuffer ));
+  // Buffers are big enough for the largest frame in any format the
+  // camera offers, so changing format or size never reallocates them
+  cameraInfo->imageBufferLength = _dummyFrameLength (
+      cameraInfo->currentFormat, cameraInfo->xSize, cameraInfo->ySize );
+  if ( cameraInfo->serOpen ) {
+    bufferLength = cameraInfo->ser.frameSize;
+  } else {
+    bufferLength = cameraInfo->maxResolutionX * cameraInfo->maxResolutionY * 2;
+  }
+  if (!( cameraInfo->buffers = calloc ( OA_CAM_BUFFERS,
+      sizeof ( frameBuffer )))) {
+    oaLogError ( OA_LOG_CAMERA, "%s: calloc of buffers failed", __func__ );
+    _dummyFreeScene ( cameraInfo );
+    _freeFrameSizes ( cameraInfo );
+    FREE_DATA_STRUCTS;
+    return 0;
+  }
   for ( i = 0; i < OA_CAM_BUFFERS; i++ ) {
-    void* m = malloc ( cameraInfo->imageBufferLength );
+    void* m = malloc ( bufferLength );
     if ( m ) {
       cameraInfo->buffers[i].start = m;
       cameraInfo->configuredBuffers++;
@@ -110,15 +127,25 @@ oaDummyInitCamera ( oaCameraDevice* device )
           free (( void* ) cameraInfo->buffers[j].start );
         }
       }
-      for ( j = 1; j <= OA_MAX_BINNING; j++ ) {
-        if ( cameraInfo->frameSizes[j].sizes ) {
-          free (( void* ) cameraInfo->frameSizes[j].sizes );
-        }
-      }
+      free (( void* ) cameraInfo->buffers );
+      _dummyFreeScene ( cameraInfo );
+      _freeFrameSizes ( cameraInfo );
       FREE_DATA_STRUCTS;
       return 0;
     }
   }
+
+  if ( cameraInfo->cameraType != DUMMY_TYPE_DSLR &&
+      _dummyInitScene ( cameraInfo ) != OA_ERR_NONE ) {
+    for ( i = 0; i < OA_CAM_BUFFERS; i++ ) {
+      free (( void* ) cameraInfo->buffers[i].start );
+    }
+    free (( void* ) cameraInfo->buffers );
+    _dummyFreeScene ( cameraInfo );
+    _freeFrameSizes ( cameraInfo );
+    FREE_DATA_STRUCTS;
+    return 0;
+  }
   cameraInfo->nextBuffer = 0;
   cameraInfo->buffersFree = OA_CAM_BUFFERS;
 
@@ -131,10 +158,9 @@ oaDummyInitCamera ( oaCameraDevice* device )
     for ( i = 0; i < OA_CAM_BUFFERS; i++ ) {
       free (( void* ) cameraInfo->buffers[i].start );
     }
-    for ( i = 1; i <= OA_MAX_BINNING; i++ ) {
-      if ( cameraInfo->frameSizes[i].sizes )
-        free (( void* ) cameraInfo->frameSizes[i].sizes );
-    }
+    free (( void* ) cameraInfo->buffers );
+    _dummyFreeScene ( cameraInfo );
+    _freeFrameSizes ( cameraInfo );
     oaDLListDelete ( cameraInfo->commandQueue, 0 );
     oaDLListDelete ( cameraInfo->callbackQueue, 0 );
     FREE_DATA_STRUCTS;
@@ -152,10 +178,9 @@ oaDummyInitCamera ( oaCameraDevice* device )
     for ( i = 0; i < OA_CAM_BUFFERS; i++ ) {
       free (( void* ) cameraInfo->buffers[i].start );
     }
-    for ( i = 1; i <= OA_MAX_BINNING; i++ ) {
-      if ( cameraInfo->frameSizes[i].sizes )
-        free (( void* ) cameraInfo->frameSizes[i].sizes );
-    }
+    free (( void* ) cameraInfo->buffers );
+    _dummyFreeScene ( cameraInfo );
+    _freeFrameSizes ( cameraInfo );
     oaDLListDelete ( cameraInfo->commandQueue, 0 );
     oaDLListDelete ( cameraInfo->callbackQueue, 0 );
     FREE_DATA_STRUCTS;
@@ -183,6 +208,22 @@ _dummyInitFunctionPointers ( oaCamera* camera )
   camera->funcs.enumerateFrameSizes = oaDummyCameraGetFrameSizes;
   camera->funcs.getFramePixelFormat = oaDummyCameraGetFramePixelFormat;
   camera->funcs.testROISize = oaDummyCameraTestROISize;
+  camera->funcs.setResolution = oaDummyCameraSetResolution;
+  camera->funcs.setROI = oaDummyCameraSetResolution;
+}
+
+
+static void
+_freeFrameSizes ( DUMMY_STATE* cameraInfo )
+{
+  int		j;
+
+  for ( j = 1; j <= OA_MAX_BINNING; j++ ) {
+    if ( cameraInfo->frameSizes[j].sizes ) {
+      free (( void* ) cameraInfo->frameSizes[j].sizes );
+      cameraInfo->frameSizes[j].sizes = 0;
+    }
+  }
 }
 
 
@@ -212,11 +253,10 @@ oaDummyCloseCamera ( oaCamera* camera )
         }
       }
     }
-    for ( j = 1; j <= OA_MAX_BINNING; j++ ) {
-      if ( cameraInfo->frameSizes[j].sizes )
-        free (( void* ) cameraInfo->frameSizes[j].sizes );
-    }
+    _freeFrameSizes ( cameraInfo );
+    _dummyFreeScene ( cameraInfo );
 
+    oacamFlushAsync ( cameraInfo );
     oaDLListDelete ( cameraInfo->commandQueue, 1 );
     oaDLListDelete ( cameraInfo->callbackQueue, 0 );
 
@@ -250,11 +290,12 @@ _initAstroCamera ( oaCamera* camera, DUMMY_STATE* cameraInfo,
 	// this is in microseconds
   commonInfo->OA_CAM_CTRL_MIN( OA_CAM_CTRL_EXPOSURE_ABSOLUTE ) = 1000;
   commonInfo->OA_CAM_CTRL_MAX( OA_CAM_CTRL_EXPOSURE_ABSOLUTE ) =
-			cameraInfo->cameraType ? 300000000 : 30000000;
+			( cameraInfo->cameraType == DUMMY_TYPE_DSO ) ? 300000000 :
+			30000000;
   commonInfo->OA_CAM_CTRL_STEP( OA_CAM_CTRL_EXPOSURE_ABSOLUTE ) = 1;
   commonInfo->OA_CAM_CTRL_DEF( OA_CAM_CTRL_EXPOSURE_ABSOLUTE ) =
 			cameraInfo->currentAbsoluteExposure =
-			cameraInfo->cameraType ? 1000000 : 10000;
+			cameraInfo->cameraType == DUMMY_TYPE_DSO ? 1000000 : 10000;
 
 	// Skip gamma for the moment
 	/*
@@ -317,6 +358,12 @@ _initAstroCamera ( oaCamera* camera, DUMMY_STATE* cameraInfo,
   camera->features.flags |= OA_CAM_FEATURE_READABLE_CONTROLS;
   camera->features.flags |= OA_CAM_FEATURE_FIXED_FRAME_SIZES;
   camera->OA_CAM_CTRL_TYPE( OA_CAM_CTRL_FRAME_FORMAT ) = OA_CTRL_TYPE_DISCRETE;
+  camera->OA_CAM_CTRL_TYPE( OA_CAM_CTRL_DROPPED ) = OA_CTRL_TYPE_READONLY;
+  camera->OA_CAM_CTRL_TYPE( OA_CAM_CTRL_DROPPED_RESET ) = OA_CTRL_TYPE_BUTTON;
+  commonInfo->OA_CAM_CTRL_MIN( OA_CAM_CTRL_DROPPED_RESET ) = 0;
+  commonInfo->OA_CAM_CTRL_MAX( OA_CAM_CTRL_DROPPED_RESET ) = 1;
+  commonInfo->OA_CAM_CTRL_STEP( OA_CAM_CTRL_DROPPED_RESET ) = 1;
+  commonInfo->OA_CAM_CTRL_DEF( OA_CAM_CTRL_DROPPED_RESET ) = 0;
   cameraInfo->binMode = OA_BIN_MODE_NONE;
 
   for ( i = 1; i <= OA_MAX_BINNING; i++ ) {
@@ -325,8 +372,11 @@ _initAstroCamera ( oaCamera* camera, DUMMY_STATE* cameraInfo,
   }
 
 	switch ( cameraInfo->cameraType ) {
-		case 0:  // planetary
+		case DUMMY_TYPE_PLANETARY:
       camera->frameFormats[ OA_PIX_FMT_GRBG8 ] = 1;
+      cameraInfo->currentFormat = OA_PIX_FMT_GRBG8;
+      cameraInfo->colour = 1;
+      cameraInfo->config.scene = OA_DUMMY_SCENE_PLANET;
 			camera->features.flags |= OA_CAM_FEATURE_RAW_MODE;
 			cameraInfo->maxResolutionX = 1280;
 			cameraInfo->maxResolutionY = 960;
@@ -335,14 +385,15 @@ _initAstroCamera ( oaCamera* camera, DUMMY_STATE* cameraInfo,
           18, sizeof ( FRAMESIZE )))) {
         oaLogError ( OA_LOG_CAMERA, "%s: calloc ( FRAMESIZE ) failed",
 						__func__ );
-        return 0;
+        return -OA_ERR_MEM_ALLOC;
       }
       if (!( cameraInfo->frameSizes[2].sizes =
           ( FRAMESIZE* ) malloc ( sizeof ( FRAMESIZE )))) {
         oaLogError ( OA_LOG_CAMERA, "%s: malloc ( FRAMESIZE ) failed",
 						__func__ );
         free (( void* ) cameraInfo->frameSizes[1].sizes );
-        return 0;
+        cameraInfo->frameSizes[1].sizes = 0;
+        return -OA_ERR_MEM_ALLOC;
       }
       cameraInfo->frameSizes[1].sizes[0].x = 1280;
       cameraInfo->frameSizes[1].sizes[0].y = 960;
@@ -390,16 +441,27 @@ _initAstroCamera ( oaCamera* camera, DUMMY_STATE* cameraInfo,
       camera->features.pixelSizeY = 3750;
 			break;
 
-		case 1:  // DSO
-      camera->frameFormats[ OA_PIX_FMT_GREY16BE ] = 16;
+		case DUMMY_TYPE_DSO:
+      camera->frameFormats[ OA_PIX_FMT_GREY16BE ] = 1;
+      cameraInfo->currentFormat = OA_PIX_FMT_GREY16BE;
+      cameraInfo->colour = 0;
+      cameraInfo->config.scene = OA_DUMMY_SCENE_STARS;
 			camera->features.flags |= OA_CAM_FEATURE_DEMOSAIC_MODE;
 			cameraInfo->maxResolutionX = 4656;
-			cameraInfo->maxResolutionY = 3250;
+			cameraInfo->maxResolutionY = 3520;
       if (!( cameraInfo->frameSizes[1].sizes = ( FRAMESIZE* ) calloc (
           6, sizeof ( FRAMESIZE )))) {
         oaLogError ( OA_LOG_CAMERA, "%s: calloc ( FRAMESIZE ) failed",
 						__func__ );
-        return 0;
+        return -OA_ERR_MEM_ALLOC;
+      }
+      if (!( cameraInfo->frameSizes[2].sizes =
+          ( FRAMESIZE* ) malloc ( sizeof ( FRAMESIZE )))) {
+        oaLogError ( OA_LOG_CAMERA, "%s: malloc ( FRAMESIZE ) failed",
+						__func__ );
+        free (( void* ) cameraInfo->frameSizes[1].sizes );
+        cameraInfo->frameSizes[1].sizes = 0;
+        return -OA_ERR_MEM_ALLOC;
       }
 
       cameraInfo->frameSizes[1].sizes[0].x = 4656;
@@ -423,12 +485,89 @@ _initAstroCamera ( oaCamera* camera, DUMMY_STATE* cameraInfo,
       camera->features.pixelSizeX = 3800;
       camera->features.pixelSizeY = 3800;
 			break;
+
+		case DUMMY_TYPE_SYNTHETIC:
+			return _initSynthetic ( camera, cameraInfo );
   }
 
 	return OA_ERR_NONE;
 }
 
 
+/**
+ * The synthetic camera takes its frame size and format from the dummy
+ * configuration and offers the other formats of the same family, so it
+ * can be used to exercise the unpacking and demosaic code paths
+ */
+
+static int
+_initSynthetic ( oaCamera* camera, DUMMY_STATE* cameraInfo )
+{
+	const DUMMY_FORMAT*	fmt;
+	const DUMMY_FORMAT*	f;
+	unsigned int				x, y;
+	int									ret;
+
+	if ( cameraInfo->config.scene == OA_DUMMY_SCENE_SER ) {
+		if (( ret = _dummyOpenSER ( cameraInfo )) != OA_ERR_NONE ) {
+			return ret;
+		}
+	}
+
+	if (!( fmt = _dummyFormat ( cameraInfo->config.format ))) {
+		oaLogError ( OA_LOG_CAMERA, "%s: unsupported format %d", __func__,
+				cameraInfo->config.format );
+		_dummyFreeScene ( cameraInfo );
+		return -OA_ERR_UNSUPPORTED_FORMAT;
+	}
+
+	cameraInfo->currentFormat = fmt->format;
+	cameraInfo->colour = fmt->cfa ? 1 : 0;
+	if ( cameraInfo->serOpen ) {
+		// Replaying a file can't change what's in it
+		camera->frameFormats[ fmt->format ] = 1;
+	} else {
+		for ( f = _dummyFormatList(); f->name; f++ ) {
+			if (( !fmt->cfa && !f->cfa ) || ( fmt->cfa && f->cfa &&
+					!strcmp ( fmt->cfa, f->cfa ))) {
+				camera->frameFormats[ f->format ] = 1;
+			}
+		}
+	}
+	if ( cameraInfo->colour ) {
+		camera->features.flags |= OA_CAM_FEATURE_RAW_MODE;
+	} else {
+		camera->features.flags |= OA_CAM_FEATURE_DEMOSAIC_MODE;
+	}
+	camera->features.flags |= OA_CAM_FEATURE_STREAMING;
+
+	x = cameraInfo->maxResolutionX = cameraInfo->config.xSize;
+	y = cameraInfo->maxResolutionY = cameraInfo->config.ySize;
+
+	if (!( cameraInfo->frameSizes[1].sizes = ( FRAMESIZE* ) calloc (
+			2, sizeof ( FRAMESIZE )))) {
+		oaLogError ( OA_LOG_CAMERA, "%s: calloc ( FRAMESIZE ) failed",
+				__func__ );
+		_dummyFreeScene ( cameraInfo );
+		return -OA_ERR_MEM_ALLOC;
+	}
+	cameraInfo->frameSizes[1].sizes[0].x = x;
+	cameraInfo->frameSizes[1].sizes[0].y = y;
+	cameraInfo->frameSizes[1].numSizes = 1;
+	if ( !cameraInfo->serOpen && x >= 4 && y >= 4 ) {
+		// Keep the half size even so packed formats stay whole
+		cameraInfo->frameSizes[1].sizes[1].x = ( x / 2 ) & ~1;
+		cameraInfo->frameSizes[1].sizes[1].y = ( y / 2 ) & ~1;
+		cameraInfo->frameSizes[1].numSizes = 2;
+	}
+
+	camera->features.pixelSizeX = 2900;
+	camera->features.pixelSizeY = 2900;
+
+	return OA_ERR_NONE;
+}
+
+
 static int
 _initDSLR ( oaCamera* camera, DUMMY_STATE* cameraInfo,
 		COMMON_INFO* commonInfo )
@@ -35,6 +35,16 @@
 
 #define	NUM_DUMMIES	3
 
+// The DSLR dummy isn't offered yet as it can't capture anything
+
+static const char*	dummyNames[ NUM_DUMMIES ] = {
+	"Planetary cam", "DSO cam", "Synthetic cam"
+};
+static const int		dummyTypes[ NUM_DUMMIES ] = {
+	DUMMY_TYPE_PLANETARY, DUMMY_TYPE_DSO, DUMMY_TYPE_SYNTHETIC
+};
+
+
 int
 oaDummyGetCameras ( CAMERA_LIST* deviceList, unsigned long featureFlags,
 		int flags )
@@ -43,15 +53,18 @@ oaDummyGetCameras ( CAMERA_LIST* deviceList, unsigned long featureFlags,
   int							ret;
   oaCameraDevice*	dev[ NUM_DUMMIES ];
   DEVICE_INFO*		_private[ NUM_DUMMIES ];
+	oaDummyConfig		config;
 
-	// Create three cameras -- one planetary, one astro DSO and one DSLR
+	// The dummies only appear if they've been asked for
+	if ( !_dummyGetConfig ( &config )) {
+		return 0;
+	}
 
 	for ( i = 0; i < NUM_DUMMIES; i++ ) {
 		if (!( dev[i] = malloc ( sizeof ( oaCameraDevice )))) {
-			if ( i ) {
-				for ( j = 0; j < i; j++ ) {
-					( void ) free (( void* ) dev[j] );
-				}
+			for ( j = 0; j < i; j++ ) {
+				( void ) free (( void* ) dev[j] );
+				( void ) free (( void* ) _private[j] );
 			}
 			return -OA_ERR_MEM_ALLOC;
 		}
@@ -66,25 +79,22 @@ oaDummyGetCameras ( CAMERA_LIST* deviceList, unsigned long featureFlags,
 		}
 		oaLogDebug ( OA_LOG_CAMERA, "%s: allocated @ %p for camera device",
 				__func__, dev[i] );
-		_private[i]->devType = 0;
-		_private[i]->devIndex = 0;
+		_oaInitCameraDeviceFunctionPointers ( dev[i] );
+		_private[i]->devType = dummyTypes[i];
+		_private[i]->devIndex = i;
 		dev[i]->interface = OA_CAM_IF_DUMMY;
 		dev[i]->_private = _private[i];
 		dev[i]->initCamera = oaDummyInitCamera;
-		_oaInitCameraDeviceFunctionPointers ( dev[i] );
+		( void ) strncpy ( dev[i]->deviceName, dummyNames[i], OA_MAX_NAME_LEN );
   }
 
-	( void ) strncpy ( dev[0]->deviceName, "Planetary cam", OA_MAX_NAME_LEN );
-	( void ) strncpy ( dev[1]->deviceName, "DSO cam", OA_MAX_NAME_LEN );
-	( void ) strncpy ( dev[2]->deviceName, "DSLR", OA_MAX_NAME_LEN );
-
-	for ( i = 0; i < 2; i++ ) {
+	for ( i = 0; i < NUM_DUMMIES; i++ ) {
     if (( ret = _oaCheckCameraArraySize ( deviceList )) < 0 ) {
-			for ( j = 0; j < NUM_DUMMIES; j++ ) {
+			for ( j = i; j < NUM_DUMMIES; j++ ) {
 				( void ) free (( void* ) dev[j] );
 				( void ) free (( void* ) _private[j] );
-				return ret;
 			}
+			return ret;
     }
     deviceList->cameraList[ deviceList->numCameras++ ] = dev[i];
   }
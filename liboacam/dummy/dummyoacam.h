@@ -27,6 +27,11 @@
 #ifndef DUMMY_OACAM_H
 #define DUMMY_OACAM_H
 
+#define	DUMMY_TYPE_PLANETARY	0
+#define	DUMMY_TYPE_DSO				1
+#define	DUMMY_TYPE_DSLR				2
+#define	DUMMY_TYPE_SYNTHETIC	3
+
 extern int		oaDummyGetCameras ( CAMERA_LIST*, unsigned long, int );
 extern oaCamera*	oaDummyInitCamera ( oaCameraDevice* );
 extern int              oaDummyCloseCamera ( oaCamera* );
@@ -44,4 +49,34 @@ extern int		oaDummyCameraGetFramePixelFormat ( oaCamera* );
 extern int    oaDummyCameraTestROISize ( oaCamera*, unsigned int,
 								unsigned int, unsigned int*, unsigned int* );
 
+// How pixel values are laid out in the frame buffer
+
+#define	DUMMY_PACK_8					1
+#define	DUMMY_PACK_16LE				2
+#define	DUMMY_PACK_16BE				3
+#define	DUMMY_PACK_10P				4
+#define	DUMMY_PACK_12P				5
+
+typedef struct DUMMY_FORMAT {
+	const char*		name;
+	int						format;
+	unsigned int	bits;
+	int						packing;
+	const char*		cfa;			// 0 for monochrome
+} DUMMY_FORMAT;
+
+struct DUMMY_STATE;
+
+extern int		oaDummyCameraSetResolution ( oaCamera*, int, int );
+
+extern int		_dummyGetConfig ( oaDummyConfig* );
+extern const DUMMY_FORMAT*	_dummyFormat ( int );
+extern const DUMMY_FORMAT*	_dummyFormatByName ( const char* );
+extern const DUMMY_FORMAT*	_dummyFormatList ( void );
+extern unsigned int	_dummyFrameLength ( int, unsigned int, unsigned int );
+extern int		_dummyOpenSER ( struct DUMMY_STATE* );
+extern int		_dummyInitScene ( struct DUMMY_STATE* );
+extern void		_dummyFreeScene ( struct DUMMY_STATE* );
+extern void		_dummyRenderFrame ( struct DUMMY_STATE*, void* );
+
 #endif	/* DUMMY_OACAM_H */
@@ -28,6 +28,7 @@
 #define OA_DUMMY_STATE_H
 
 #include <openastro/util.h>
+#include <openastro/SER.h>
 
 #include "sharedState.h"
 
@@ -50,6 +51,24 @@ typedef struct DUMMY_STATE {
   uint32_t		currentVFlip;
   // image settings
 	int			binModes[16];
+	int			currentFormat;
+	int			colour;
+	uint64_t		droppedFrames;
+	// synthetic image generation
+	oaDummyConfig		config;
+	uint64_t		frameInterval;
+	uint64_t		nextFrameTime;
+	uint64_t		frameNumber;
+	uint16_t*		scene;
+	unsigned int		sceneWidth;
+	unsigned int		sceneHeight;
+	unsigned int		sceneMargin;
+	int16_t*		noise;
+	uint32_t		rngState;
+	unsigned int		cfaGain[2][2];
+	// SER file replay
+	oaSERContext		ser;
+	int			serOpen;
 } DUMMY_STATE;
 
 #endif	/* OA_DUMMY_STATE_H */
@@ -1526,6 +1526,7 @@ oaEUVCCloseCamera ( oaCamera* camera )
 
     pthread_cond_broadcast ( &cameraInfo->commandQueued );
     pthread_join ( cameraInfo->controllerThread, &dummy );
+    oacamFlushAsync ( cameraInfo );
 
     cameraInfo->stopCallbackThread = 1;
     pthread_cond_broadcast ( &cameraInfo->callbackQueued );
@@ -79,7 +79,7 @@ oacamEUVCcontroller ( void* param )
       pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
     }
     do {
-      command = oaDLListRemoveFromHead ( cameraInfo->commandQueue );
+      command = oacamNextCommand ( cameraInfo );
       if ( command ) {
         switch ( command->commandType ) {
           case OA_CMD_CONTROL_SET:
@@ -109,15 +109,7 @@ oacamEUVCcontroller ( void* param )
             resultCode = -OA_ERR_INVALID_CONTROL;
             break;
         }
-        if ( command->callback ) {
-					oaLogError ( OA_LOG_CAMERA, "%s: command has callback", __func__ );
-        } else {
-          pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
-          command->completed = 1;
-          command->resultCode = resultCode;
-          pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
-          pthread_cond_broadcast ( &cameraInfo->commandComplete );
-        }
+        oacamCommandComplete ( cameraInfo, command, resultCode );
       }
     } while ( command );
   } while ( !exitThread );
@@ -1445,6 +1437,9 @@ _processPayload ( oaCamera* camera, unsigned char* buffer, unsigned int len )
     } else {
       pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
       cameraInfo->droppedFrames++;
+      OA_CONTROL_MIRROR_READONLY ( cameraInfo, OA_CAM_CTRL_DROPPED,
+          cameraInfo->droppedFrames );
+      OA_FRAME_STATS_DROPPED ( cameraInfo );
       cameraInfo->receivedBytes = 0;
       pthread_mutex_unlock ( &cameraInfo->callbackQueueMutex );
     }
@@ -1468,6 +1463,7 @@ _releaseFrame ( EUVC_STATE* cameraInfo )
   cameraInfo->frameCallbacks[ nextBuffer ].bufferLen =
       cameraInfo->imageBufferLength;
   pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
+  OA_FRAME_STATS_QUEUED ( cameraInfo, nextBuffer );
   oaDLListAddToTail ( cameraInfo->callbackQueue,
       &cameraInfo->frameCallbacks[ nextBuffer ]);
   cameraInfo->buffersFree--;
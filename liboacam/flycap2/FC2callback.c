@@ -46,6 +46,8 @@ oacamFC2callbackHandler ( void* param )
   int			exitThread = 0;
   CALLBACK*		callback;
   void*			(*callbackFunc)( void*, void*, int, void* );
+  void*			frame;
+  int				frameLen;
 
   do {
     pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
@@ -69,8 +71,16 @@ oacamFC2callbackHandler ( void* param )
       switch ( callback->callbackType ) {
         case OA_CALLBACK_NEW_FRAME:
           callbackFunc = callback->callback;
-          callbackFunc ( callback->callbackArg, callback->buffer,
-              callback->bufferLen, callback->metadata );
+          frame = callback->buffer;
+          frameLen = callback->bufferLen;
+          _oaSoftwareFrame ( camera, &frame, &frameLen, callback->metadata );
+          OA_FRAME_STATS_CB_STAMP ( cameraInfo, callback,
+              OA_FRAME_STAGE_CALLBACK );
+          callbackFunc ( callback->callbackArg, frame, frameLen,
+              callback->metadata );
+          OA_FRAME_STATS_CB_STAMP ( cameraInfo, callback,
+              OA_FRAME_STAGE_RETURNED );
+          OA_FRAME_STATS_CB_COMPLETE ( cameraInfo, callback );
           pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
           cameraInfo->buffersFree++;
           pthread_mutex_unlock ( &cameraInfo->callbackQueueMutex );
@@ -1583,6 +1583,7 @@ oaFC2CloseCamera ( oaCamera* camera )
 			}
 		}
 
+    oacamFlushAsync ( cameraInfo );
     oaDLListDelete ( cameraInfo->commandQueue, 1 );
     oaDLListDelete ( cameraInfo->callbackQueue, 0 );
 
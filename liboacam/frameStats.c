@@ -0,0 +1,442 @@
+/*****************************************************************************
+ *
+ * frameStats.c -- per-frame latency and throughput statistics
+ *
+ * Copyright 2026 James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <oa_common.h>
+
+#include <pthread.h>
+#if HAVE_TIME_H
+#include <time.h>
+#endif
+
+#include <openastro/camera.h>
+#include <openastro/util.h>
+
+#include "oacamprivate.h"
+#include "sharedState.h"
+
+
+const char* oaFrameIntervalLabel[ OA_FRAME_INTERVALS ] = {
+	"total",
+	"copy",
+	"queue",
+	"wait",
+	"callback",
+	"requeue"
+};
+
+static int		_copyRing ( FRAME_STATS*, FRAME_RECORD* );
+static int		_compareU64 ( const void*, const void* );
+
+
+uint64_t
+_oaMonotonicTime ( void )
+{
+#if HAVE_CLOCK_GETTIME && defined(CLOCK_MONOTONIC)
+	struct timespec		t;
+
+	clock_gettime ( CLOCK_MONOTONIC, &t );
+	return ( uint64_t ) t.tv_sec * 1000000000 + t.tv_nsec;
+#else
+	struct timeval		t;
+
+	gettimeofday ( &t, 0 );
+	return ( uint64_t ) t.tv_sec * 1000000000 + t.tv_usec * 1000;
+#endif
+}
+
+
+void
+_oaFrameStatsStamp ( FRAME_STATS* stats, int idx, int stage )
+{
+	if ( idx < 0 || idx >= OA_CAM_BUFFERS ) {
+		return;
+	}
+	stats->pending[ idx ][ stage ] = _oaMonotonicTime();
+}
+
+
+/**
+ * As _oaFrameStatsStamp(), for drivers that know when a stage happened
+ * better than the time they get to record it, such as a readout time
+ * from the camera or its library.  The time is on the _oaMonotonicTime()
+ * clock.
+ */
+
+void
+_oaFrameStatsStampAt ( FRAME_STATS* stats, int idx, int stage, uint64_t t )
+{
+	if ( idx < 0 || idx >= OA_CAM_BUFFERS ) {
+		return;
+	}
+	stats->pending[ idx ][ stage ] = t;
+}
+
+
+void
+_oaFrameStatsQueued ( FRAME_STATS* stats, int idx, int depth )
+{
+	uint64_t*		stamp;
+	int					i;
+
+	if ( idx < 0 || idx >= OA_CAM_BUFFERS ) {
+		return;
+	}
+
+	// Drivers that can't tell when the data arrived or when it was copied
+	// only stamp the queueing, so backfill those stages.  The stage
+	// intervals for them will read as zero.
+
+	stamp = stats->pending[ idx ];
+	stamp[ OA_FRAME_STAGE_QUEUED ] = _oaMonotonicTime();
+	for ( i = OA_FRAME_STAGE_COPIED; i >= OA_FRAME_STAGE_READOUT; i-- ) {
+		if ( !stamp[i] || stamp[i] > stamp[i+1] ) {
+			stamp[i] = stamp[i+1];
+		}
+	}
+
+	if ( depth < 0 ) {
+		depth = 0;
+	}
+	__atomic_store_n ( &stats->queueDepth, depth, __ATOMIC_RELAXED );
+	if (( unsigned int ) depth > stats->maxQueueDepth ) {
+		__atomic_store_n ( &stats->maxQueueDepth, depth, __ATOMIC_RELAXED );
+	}
+}
+
+
+void
+_oaFrameStatsDropped ( FRAME_STATS* stats )
+{
+	__atomic_fetch_add ( &stats->droppedFrames, 1, __ATOMIC_RELAXED );
+}
+
+
+/**
+ * Give the frame a binary timestamp taken from its readout time, so it
+ * reaches the callback with the time the data arrived rather than the
+ * time the application got around to looking at it.  Drivers that don't
+ * supply their own metadata get the per-buffer one from the shared state.
+ * Must be called after _oaFrameStatsQueued() so the readout stage is set.
+ */
+
+void
+_oaFrameStatsTimestamp ( FRAME_STATS* stats, CALLBACK* callback,
+		FRAME_METADATA* shared, int idx )
+{
+	FRAME_METADATA*	metadata = callback->metadata;
+	oaTimestamp			now;
+	uint64_t				readout;
+
+	if ( idx < 0 || idx >= OA_CAM_BUFFERS ) {
+		return;
+	}
+
+	if ( !metadata || metadata == shared ) {
+		shared->frameCounterValid = shared->gpsTimeValid = 0;
+		shared->dmabufValid = 0;
+		metadata = callback->metadata = shared;
+	}
+
+	oaTimestampNow ( &now );
+	readout = stats->pending[ idx ][ OA_FRAME_STAGE_READOUT ];
+	if ( readout && readout <= now.monotonic ) {
+		metadata->timestamp.monotonic = readout;
+		metadata->timestamp.utc = now.utc - ( int64_t )( now.monotonic - readout );
+	} else {
+		metadata->timestamp = now;
+	}
+	metadata->timestampValid = 1;
+}
+
+
+void
+_oaFrameStatsComplete ( FRAME_STATS* stats, int idx )
+{
+	uint64_t*			stamp;
+	FRAME_RECORD*	rec;
+	uint64_t			seq, interval, callbackTime;
+	int						i, bin;
+
+	if ( idx < 0 || idx >= OA_CAM_BUFFERS ) {
+		return;
+	}
+
+	stamp = stats->pending[ idx ];
+	stamp[ OA_FRAME_STAGE_REQUEUED ] = _oaMonotonicTime();
+	if ( !stamp[ OA_FRAME_STAGE_QUEUED ] ) {
+		// Not stamped by the controller, so there's nothing useful to keep
+		memset ( stamp, 0, sizeof ( stats->pending[0] ));
+		return;
+	}
+	if ( !stamp[ OA_FRAME_STAGE_CALLBACK ] ) {
+		stamp[ OA_FRAME_STAGE_CALLBACK ] = stamp[ OA_FRAME_STAGE_QUEUED ];
+	}
+	if ( !stamp[ OA_FRAME_STAGE_RETURNED ] ) {
+		stamp[ OA_FRAME_STAGE_RETURNED ] = stamp[ OA_FRAME_STAGE_REQUEUED ];
+	}
+
+	// The ring is written only from here, which is only ever called from
+	// the callback thread.  The sequence number is cleared first and set
+	// last so readers can tell if they raced with an update.
+
+	seq = stats->nextSeq++;
+	rec = &stats->ring[ seq % OA_FRAME_STATS_RING ];
+	__atomic_store_n ( &rec->seq, 0, __ATOMIC_RELEASE );
+	memcpy ( rec->stamp, stamp, sizeof ( rec->stamp ));
+	__atomic_store_n ( &rec->seq, seq + 1, __ATOMIC_RELEASE );
+
+	for ( i = 0; i < OA_FRAME_INTERVALS; i++ ) {
+		if ( i == OA_FRAME_INTERVAL_TOTAL ) {
+			interval = stamp[ OA_FRAME_STAGE_REQUEUED ] -
+					stamp[ OA_FRAME_STAGE_READOUT ];
+		} else {
+			interval = stamp[i] - stamp[i-1];
+		}
+		for ( bin = 0; bin < OA_FRAME_STATS_BINS - 1 && ( interval >> ( bin + 1 ));
+				bin++ );
+		stats->histogram[i][ bin ]++;
+	}
+
+	// An overrun is a callback taking longer than the time between frames
+	// arriving.  The frame interval is smoothed to avoid jitter in the
+	// arrival times counting as overruns.
+
+	if ( stats->lastReadout && stamp[ OA_FRAME_STAGE_READOUT ] >
+			stats->lastReadout ) {
+		interval = stamp[ OA_FRAME_STAGE_READOUT ] - stats->lastReadout;
+		if ( stats->frameInterval ) {
+			stats->frameInterval = ( stats->frameInterval * 7 + interval ) / 8;
+		} else {
+			stats->frameInterval = interval;
+		}
+	}
+	stats->lastReadout = stamp[ OA_FRAME_STAGE_READOUT ];
+	callbackTime = stamp[ OA_FRAME_STAGE_RETURNED ] -
+			stamp[ OA_FRAME_STAGE_CALLBACK ];
+	if ( stats->frameInterval && callbackTime > stats->frameInterval ) {
+		stats->callbackOverruns++;
+		stats->callbackOverrunTime += callbackTime - stats->frameInterval;
+	}
+
+	__atomic_store_n ( &stats->frames, stats->frames + 1, __ATOMIC_RELEASE );
+	memset ( stamp, 0, sizeof ( stats->pending[0] ));
+}
+
+
+int
+oaGetFrameStats ( oaCamera* camera, oaFrameStats* result )
+{
+	SHARED_STATE*		cameraInfo;
+	FRAME_STATS*		stats;
+	FRAME_RECORD*		records;
+	uint64_t*				durations;
+	uint64_t				first, last;
+	int							numRecords, i, j;
+
+	if ( !camera || !result ) {
+		return -OA_ERR_INVALID_CAMERA;
+	}
+	cameraInfo = camera->_private;
+	stats = &cameraInfo->frameStats;
+
+	memset ( result, 0, sizeof ( oaFrameStats ));
+	result->frames = __atomic_load_n ( &stats->frames, __ATOMIC_ACQUIRE );
+	result->droppedFrames = __atomic_load_n ( &stats->droppedFrames,
+			__ATOMIC_RELAXED );
+	result->callbackOverruns = stats->callbackOverruns;
+	result->callbackOverrunTime = stats->callbackOverrunTime;
+	result->queueDepth = __atomic_load_n ( &stats->queueDepth,
+			__ATOMIC_RELAXED );
+	result->maxQueueDepth = __atomic_load_n ( &stats->maxQueueDepth,
+			__ATOMIC_RELAXED );
+	memcpy ( result->histogram, stats->histogram, sizeof ( result->histogram ));
+
+	if (!( records = malloc ( OA_FRAME_STATS_RING * sizeof ( FRAME_RECORD )))) {
+		return -OA_ERR_MEM_ALLOC;
+	}
+	if (!( durations = malloc ( OA_FRAME_STATS_RING * sizeof ( uint64_t )))) {
+		free (( void* ) records );
+		return -OA_ERR_MEM_ALLOC;
+	}
+
+	if (( numRecords = _copyRing ( stats, records )) > 0 ) {
+		first = last = records[0].stamp[ OA_FRAME_STAGE_READOUT ];
+		for ( j = 1; j < numRecords; j++ ) {
+			if ( records[j].stamp[ OA_FRAME_STAGE_READOUT ] < first ) {
+				first = records[j].stamp[ OA_FRAME_STAGE_READOUT ];
+			}
+			if ( records[j].stamp[ OA_FRAME_STAGE_READOUT ] > last ) {
+				last = records[j].stamp[ OA_FRAME_STAGE_READOUT ];
+			}
+		}
+		if ( numRecords > 1 && last > first ) {
+			result->fps = ( numRecords - 1 ) * 1000000000.0 / ( last - first );
+		}
+
+		for ( i = 0; i < OA_FRAME_INTERVALS; i++ ) {
+			for ( j = 0; j < numRecords; j++ ) {
+				if ( i == OA_FRAME_INTERVAL_TOTAL ) {
+					durations[j] = records[j].stamp[ OA_FRAME_STAGE_REQUEUED ] -
+							records[j].stamp[ OA_FRAME_STAGE_READOUT ];
+				} else {
+					durations[j] = records[j].stamp[i] - records[j].stamp[i-1];
+				}
+			}
+			qsort ( durations, numRecords, sizeof ( uint64_t ), _compareU64 );
+			result->p50[i] = durations[ numRecords * 50 / 100 ];
+			result->p90[i] = durations[ numRecords * 90 / 100 ];
+			result->p99[i] = durations[ numRecords * 99 / 100 ];
+			result->max[i] = durations[ numRecords - 1 ];
+		}
+	}
+
+	free (( void* ) durations );
+	free (( void* ) records );
+	return OA_ERR_NONE;
+}
+
+
+int
+oaResetFrameStats ( oaCamera* camera )
+{
+	SHARED_STATE*		cameraInfo;
+	FRAME_STATS*		stats;
+
+	if ( !camera ) {
+		return -OA_ERR_INVALID_CAMERA;
+	}
+	cameraInfo = camera->_private;
+	stats = &cameraInfo->frameStats;
+
+	// The ring itself is left alone because the callback thread may be
+	// writing to it.  Only the cumulative values are cleared.
+
+	__atomic_store_n ( &stats->frames, 0, __ATOMIC_RELEASE );
+	__atomic_store_n ( &stats->droppedFrames, 0, __ATOMIC_RELAXED );
+	__atomic_store_n ( &stats->maxQueueDepth, 0, __ATOMIC_RELAXED );
+	stats->callbackOverruns = 0;
+	stats->callbackOverrunTime = 0;
+	memset ( stats->histogram, 0, sizeof ( stats->histogram ));
+	return OA_ERR_NONE;
+}
+
+
+int
+oaWriteFrameStatsCSV ( oaCamera* camera, const char* filename )
+{
+	SHARED_STATE*		cameraInfo;
+	FRAME_RECORD*		records;
+	FILE*						fp;
+	uint64_t*				s;
+	int							numRecords, i, j;
+
+	if ( !camera ) {
+		return -OA_ERR_INVALID_CAMERA;
+	}
+	cameraInfo = camera->_private;
+
+	if (!( records = malloc ( OA_FRAME_STATS_RING * sizeof ( FRAME_RECORD )))) {
+		return -OA_ERR_MEM_ALLOC;
+	}
+	numRecords = _copyRing ( &cameraInfo->frameStats, records );
+
+	if (!( fp = fopen ( filename, "w" ))) {
+		oaLogError ( OA_LOG_CAMERA, "%s: can't open %s for writing", __func__,
+				filename );
+		free (( void* ) records );
+		return -OA_ERR_SYSTEM_ERROR;
+	}
+
+	fprintf ( fp, "frame,readout,copied,queued,callback,returned,requeued" );
+	for ( i = 0; i < OA_FRAME_INTERVALS; i++ ) {
+		fprintf ( fp, ",%s_ns", oaFrameIntervalLabel[i] );
+	}
+	fputc ( '\n', fp );
+
+	for ( j = 0; j < numRecords; j++ ) {
+		s = records[j].stamp;
+		fprintf ( fp, "%llu", ( unsigned long long ) records[j].seq - 1 );
+		for ( i = 0; i < OA_FRAME_STAGES; i++ ) {
+			fprintf ( fp, ",%llu", ( unsigned long long ) s[i] );
+		}
+		fprintf ( fp, ",%llu", ( unsigned long long ) (
+				s[ OA_FRAME_STAGE_REQUEUED ] - s[ OA_FRAME_STAGE_READOUT ] ));
+		for ( i = 1; i < OA_FRAME_INTERVALS; i++ ) {
+			fprintf ( fp, ",%llu", ( unsigned long long ) ( s[i] - s[i-1] ));
+		}
+		fputc ( '\n', fp );
+	}
+
+	free (( void* ) records );
+	if ( fclose ( fp )) {
+		return -OA_ERR_SYSTEM_ERROR;
+	}
+	return OA_ERR_NONE;
+}
+
+
+/**
+ * Take a consistent copy of the completed records in the ring, oldest
+ * first, without locking out the callback thread.  Any record that was
+ * being rewritten whilst it was copied is skipped.
+ */
+
+static int
+_copyRing ( FRAME_STATS* stats, FRAME_RECORD* records )
+{
+	FRAME_RECORD*		rec;
+	uint64_t				next, start, seq, seqAfter, n;
+	int							count = 0;
+
+	next = __atomic_load_n ( &stats->nextSeq, __ATOMIC_ACQUIRE );
+	start = ( next > OA_FRAME_STATS_RING ) ? next - OA_FRAME_STATS_RING : 0;
+
+	for ( n = start; n < next; n++ ) {
+		rec = &stats->ring[ n % OA_FRAME_STATS_RING ];
+		seq = __atomic_load_n ( &rec->seq, __ATOMIC_ACQUIRE );
+		if ( seq != n + 1 ) {
+			continue;
+		}
+		memcpy ( records[ count ].stamp, rec->stamp, sizeof ( rec->stamp ));
+		__atomic_thread_fence ( __ATOMIC_ACQUIRE );
+		seqAfter = __atomic_load_n ( &rec->seq, __ATOMIC_RELAXED );
+		if ( seqAfter == seq ) {
+			records[ count ].seq = seq;
+			count++;
+		}
+	}
+	return count;
+}
+
+
+static int
+_compareU64 ( const void* a, const void* b )
+{
+	uint64_t	x = *( const uint64_t* ) a;
+	uint64_t	y = *( const uint64_t* ) b;
+
+	return ( x > y ) - ( x < y );
+}
@@ -0,0 +1,102 @@
+/*****************************************************************************
+ *
+ * frameStats.h -- per-frame timestamp collection, shared by all drivers
+ *
+ * Copyright 2026 James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#ifndef OA_FRAME_STATS_H
+#define OA_FRAME_STATS_H
+
+#include <stdint.h>
+
+#include <openastro/camera.h>
+#include <openastro/controller.h>
+#include <openastro/camera/stats.h>
+
+// Number of completed frames for which full timestamps are retained
+
+#define	OA_FRAME_STATS_RING		1024
+
+typedef struct FRAME_RECORD {
+	uint64_t		seq;		// zero whilst being written
+	uint64_t		stamp[ OA_FRAME_STAGES ];
+} FRAME_RECORD;
+
+// Stages up to OA_FRAME_STAGE_QUEUED are stamped by the controller thread
+// and the rest by the callback thread.  The callback queue's mutex orders
+// the two, so the only data that needs any care is the ring, which is
+// read without locking by oaGetFrameStats() and friends.
+
+typedef struct FRAME_STATS {
+	uint64_t		pending[ OA_CAM_BUFFERS ][ OA_FRAME_STAGES ];
+	FRAME_RECORD	ring[ OA_FRAME_STATS_RING ];
+	uint64_t		nextSeq;
+	uint64_t		frames;
+	uint64_t		droppedFrames;
+	uint64_t		callbackOverruns;
+	uint64_t		callbackOverrunTime;
+	unsigned int	queueDepth;
+	unsigned int	maxQueueDepth;
+	uint64_t		lastReadout;
+	uint64_t		frameInterval;
+	uint64_t		histogram[ OA_FRAME_INTERVALS ][ OA_FRAME_STATS_BINS ];
+} FRAME_STATS;
+
+extern uint64_t	_oaMonotonicTime ( void );
+extern void			_oaFrameStatsStamp ( FRAME_STATS*, int, int );
+extern void			_oaFrameStatsStampAt ( FRAME_STATS*, int, int, uint64_t );
+extern void			_oaFrameStatsQueued ( FRAME_STATS*, int, int );
+extern void			_oaFrameStatsDropped ( FRAME_STATS* );
+extern void			_oaFrameStatsComplete ( FRAME_STATS*, int );
+extern void			_oaFrameStatsTimestamp ( FRAME_STATS*, CALLBACK*,
+										FRAME_METADATA*, int );
+
+// Convenience wrappers for use in the drivers' controller and callback
+// threads, where the buffer index is usually only known implicitly from
+// the CALLBACK structure
+//
+// OA_FRAME_STATS_QUEUED() must be used with the callback queue's mutex
+// held, just before the frame is added to the queue, so the queue depth
+// it records is consistent with buffersFree
+
+#define	OA_FRAME_STATS_STAMP(c,i,s) \
+		_oaFrameStatsStamp ( &( c )->frameStats, ( i ), ( s ))
+#define	OA_FRAME_STATS_STAMP_AT(c,i,s,t) \
+		_oaFrameStatsStampAt ( &( c )->frameStats, ( i ), ( s ), ( t ))
+#define	OA_FRAME_STATS_QUEUED(c,i) \
+		do { \
+			_oaFrameStatsQueued ( &( c )->frameStats, ( i ), \
+					( c )->configuredBuffers - ( c )->buffersFree + 1 ); \
+			_oaFrameStatsTimestamp ( &( c )->frameStats, \
+					&( c )->frameCallbacks[ i ], &( c )->frameMetadata[ i ], ( i )); \
+		} while ( 0 )
+#define	OA_FRAME_STATS_DROPPED(c) \
+		_oaFrameStatsDropped ( &( c )->frameStats )
+#define	OA_FRAME_STATS_CB_STAMP(c,cb,s) \
+		_oaFrameStatsStamp ( &( c )->frameStats, \
+		( int )(( cb ) - ( c )->frameCallbacks ), ( s ))
+#define	OA_FRAME_STATS_CB_COMPLETE(c,cb) \
+		_oaFrameStatsComplete ( &( c )->frameStats, \
+		( int )(( cb ) - ( c )->frameCallbacks ))
+
+#endif	/* OA_FRAME_STATS_H */
@@ -835,6 +835,7 @@ oaGP2InitCamera ( oaCameraDevice* device )
     cameraInfo->stopControllerThread = 1;
     pthread_cond_broadcast ( &cameraInfo->commandQueued );
     pthread_join ( cameraInfo->controllerThread, &dummy );
+		oacamAbortTimer ( cameraInfo );
     oaLogError ( OA_LOG_CAMERA, "%s: callback thread creation failed",
 				__func__ );
 		_gp2CloseCamera ( cameraInfo->handle, cameraInfo->ctx );
@@ -1024,6 +1025,7 @@ oaGP2CloseCamera ( oaCamera* camera )
     cameraInfo->stopControllerThread = 1;
     pthread_cond_broadcast ( &cameraInfo->commandQueued );
     pthread_join ( cameraInfo->controllerThread, &dummy );
+		oacamAbortTimer ( cameraInfo );
 
 /*
     cameraInfo->stopCallbackThread = 1;
@@ -1042,6 +1044,7 @@ oaGP2CloseCamera ( oaCamera* camera )
       }
     }
 
+    oacamFlushAsync ( cameraInfo );
     oaDLListDelete ( cameraInfo->commandQueue, 1 );
     oaDLListDelete ( cameraInfo->callbackQueue, 0 );
 
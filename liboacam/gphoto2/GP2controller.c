@@ -80,7 +80,7 @@ oacamGP2controller ( void* param )
       pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
     }
     do {
-      command = oaDLListRemoveFromHead ( cameraInfo->commandQueue );
+      command = oacamNextCommand ( cameraInfo );
       if ( command ) {
         switch ( command->commandType ) {
           case OA_CMD_CONTROL_GET:
@@ -101,15 +101,7 @@ oacamGP2controller ( void* param )
             resultCode = -OA_ERR_INVALID_CONTROL;
             break;
         }
-        if ( command->callback ) {
-					oaLogWarning ( OA_LOG_CAMERA, "%s: command has callback", __func__ );
-        } else {
-          pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
-          command->completed = 1;
-          command->resultCode = resultCode;
-          pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
-          pthread_cond_broadcast ( &cameraInfo->commandComplete );
-        }
+        oacamCommandComplete ( cameraInfo, command, resultCode );
       }
     } while ( command );
 
@@ -540,10 +532,12 @@ _handleCompletedExposure ( GP2_STATE* cameraInfo )
 				cameraInfo->buffers[ nextBuffer ].start;
 		cameraInfo->frameCallbacks[ nextBuffer ].bufferLen = size;
 		pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
+		OA_FRAME_STATS_QUEUED ( cameraInfo, nextBuffer );
 		oaDLListAddToTail ( cameraInfo->callbackQueue,
 				&cameraInfo->frameCallbacks[ nextBuffer ]);
 		cameraInfo->buffersFree--;
-		cameraInfo->nextBuffer = ( nextBuffer + 1 ) % cameraInfo->configuredBuffers;		pthread_mutex_unlock ( &cameraInfo->callbackQueueMutex );
+		cameraInfo->nextBuffer = ( nextBuffer + 1 ) % cameraInfo->configuredBuffers;
+		pthread_mutex_unlock ( &cameraInfo->callbackQueueMutex );
 		pthread_cond_broadcast ( &cameraInfo->callbackQueued );
 	}
 
@@ -0,0 +1,171 @@
+/*****************************************************************************
+ *
+ * hotplug.c -- watch for devices arriving and leaving so that the cached
+ *              camera list can be invalidated
+ *
+ * Copyright 2026
+ *   James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <oa_common.h>
+
+#include <pthread.h>
+
+#if HAVE_LIBUDEV
+#include <libudev.h>
+#endif
+
+#include <openastro/camera.h>
+#include <openastro/util.h>
+
+#include "oacamprivate.h"
+
+
+#if HAVE_LIBUDEV
+
+static pthread_mutex_t				hotplugMutex = PTHREAD_MUTEX_INITIALIZER;
+static struct udev*						udev = 0;
+static struct udev_monitor*		monitor = 0;
+static int										monitorFailed = 0;
+
+// Subsystems in which a device arriving or leaving might mean a camera
+// has appeared or disappeared.  "usb" covers almost everything, but V4L2
+// and IIDC devices can appear some time after the USB device does, and
+// GigE cameras don't show up in "usb" at all.
+
+static const char*		watchedSubsystems[] = {
+	"usb", "video4linux", "firewire", "net", 0
+};
+
+
+static int
+_oaHotplugStartMonitor ( void )
+{
+	int		i;
+
+	if (!( udev = udev_new())) {
+		oaLogError ( OA_LOG_CAMERA, "%s: can't get connection to udev",
+				__func__ );
+		return -OA_ERR_SYSTEM_ERROR;
+	}
+
+	if (!( monitor = udev_monitor_new_from_netlink ( udev, "udev" ))) {
+		oaLogError ( OA_LOG_CAMERA, "%s: can't create udev monitor", __func__ );
+		udev_unref ( udev );
+		udev = 0;
+		return -OA_ERR_SYSTEM_ERROR;
+	}
+
+	for ( i = 0; watchedSubsystems[i]; i++ ) {
+		udev_monitor_filter_add_match_subsystem_devtype ( monitor,
+				watchedSubsystems[i], 0 );
+	}
+
+	if ( udev_monitor_enable_receiving ( monitor ) < 0 ) {
+		oaLogError ( OA_LOG_CAMERA, "%s: can't enable udev monitor", __func__ );
+		udev_monitor_unref ( monitor );
+		udev_unref ( udev );
+		monitor = 0;
+		udev = 0;
+		return -OA_ERR_SYSTEM_ERROR;
+	}
+
+	return OA_ERR_NONE;
+}
+
+#endif	/* HAVE_LIBUDEV */
+
+
+/**
+ * Start watching for hotplug events.  Returns true if a change since the
+ * last call can be reliably detected, in which case the caller may cache
+ * the result of a camera scan.
+ */
+
+int
+_oaHotplugArm ( void )
+{
+#if HAVE_LIBUDEV
+	int		ret = 0;
+
+	pthread_mutex_lock ( &hotplugMutex );
+	if ( !monitor && !monitorFailed ) {
+		if ( _oaHotplugStartMonitor() != OA_ERR_NONE ) {
+			monitorFailed = 1;
+		}
+	}
+	ret = monitor ? 1 : 0;
+	pthread_mutex_unlock ( &hotplugMutex );
+	return ret;
+#else
+	return 0;
+#endif
+}
+
+
+/**
+ * Drain any queued udev events.  The monitor socket is non-blocking, so
+ * this never waits.  Returns true if anything was seen that might mean the
+ * set of attached cameras has changed.
+ */
+
+int
+_oaHotplugChanged ( void )
+{
+#if HAVE_LIBUDEV
+	struct udev_device*		dev;
+	const char*						action;
+	int										changed = 0;
+
+	pthread_mutex_lock ( &hotplugMutex );
+	if ( !monitor ) {
+		pthread_mutex_unlock ( &hotplugMutex );
+		return 1;
+	}
+
+	errno = 0;
+	while (( dev = udev_monitor_receive_device ( monitor ))) {
+		if (( action = udev_device_get_action ( dev ))) {
+			if ( !strcmp ( action, "add" ) || !strcmp ( action, "remove" ) ||
+					!strcmp ( action, "bind" ) || !strcmp ( action, "unbind" )) {
+				oaLogDebug ( OA_LOG_CAMERA, "%s: %s %s", __func__, action,
+						udev_device_get_syspath ( dev ));
+				changed = 1;
+			}
+		}
+		udev_device_unref ( dev );
+	}
+
+	// If the socket buffer overflowed then events have been lost and we
+	// can't know what happened
+
+	if ( errno == ENOBUFS ) {
+		oaLogWarning ( OA_LOG_CAMERA, "%s: udev events lost", __func__ );
+		changed = 1;
+	}
+	pthread_mutex_unlock ( &hotplugMutex );
+
+	return changed;
+#else
+	return 1;
+#endif
+}
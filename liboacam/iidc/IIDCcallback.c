@@ -46,6 +46,8 @@ oacamIIDCcallbackHandler ( void* param )
   int			exitThread = 0;
   CALLBACK*		callback;
   void*			(*callbackFunc)( void*, void*, int, void* );
+  void*			frame;
+  int				frameLen;
   dc1394video_frame_t*	frameData;
 
   do {
@@ -71,8 +73,14 @@ oacamIIDCcallbackHandler ( void* param )
         case OA_CALLBACK_NEW_FRAME:
           callbackFunc = callback->callback;
           frameData = callback->buffer;
-          callbackFunc ( callback->callbackArg, frameData->image,
-              callback->bufferLen, 0 );
+          frame = frameData->image;
+          frameLen = callback->bufferLen;
+          _oaSoftwareFrame ( camera, &frame, &frameLen, 0 );
+          OA_FRAME_STATS_CB_STAMP ( cameraInfo, callback,
+              OA_FRAME_STAGE_CALLBACK );
+          callbackFunc ( callback->callbackArg, frame, frameLen, 0 );
+          OA_FRAME_STATS_CB_STAMP ( cameraInfo, callback,
+              OA_FRAME_STAGE_RETURNED );
           // We can only requeue frames if we're still streaming
           pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
           if ( cameraInfo->runMode == CAM_RUN_MODE_STREAMING ) {
@@ -80,6 +88,7 @@ oacamIIDCcallbackHandler ( void* param )
 								callback->buffer );
           }
           pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
+          OA_FRAME_STATS_CB_COMPLETE ( cameraInfo, callback );
           pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
           cameraInfo->buffersFree++;
           pthread_mutex_unlock ( &cameraInfo->callbackQueueMutex );
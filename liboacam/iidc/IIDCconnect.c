@@ -1115,6 +1115,7 @@ oaIIDCCloseCamera ( oaCamera* camera )
     }
     free (( void* ) cameraInfo->frameSizes[1].sizes );
 
+    oacamFlushAsync ( cameraInfo );
     oaDLListDelete ( cameraInfo->commandQueue, 1 );
     oaDLListDelete ( cameraInfo->callbackQueue, 0 );
 
@@ -78,7 +78,7 @@ oacamIIDCcontroller ( void* param )
       pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
     }
     do {
-      command = oaDLListRemoveFromHead ( cameraInfo->commandQueue );
+      command = oacamNextCommand ( cameraInfo );
       if ( command ) {
         switch ( command->commandType ) {
           case OA_CMD_CONTROL_SET:
@@ -106,16 +106,7 @@ oacamIIDCcontroller ( void* param )
             resultCode = -OA_ERR_INVALID_CONTROL;
             break;
         }
-        if ( command->callback ) {
-					oaLogWarning ( OA_LOG_CAMERA, "%s: CONT: command has callback",
-							__func__ );
-        } else {
-          pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
-          command->completed = 1;
-          command->resultCode = resultCode;
-          pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
-          pthread_cond_broadcast ( &cameraInfo->commandComplete );
-        }
+        oacamCommandComplete ( cameraInfo, command, resultCode );
       }
     } while ( command );
 
@@ -166,6 +157,7 @@ oacamIIDCcontroller ( void* param )
               cameraInfo->frameCallbacks[ nextBuffer ].bufferLen =
                   cameraInfo->currentFrame->image_bytes;
               pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
+              OA_FRAME_STATS_QUEUED ( cameraInfo, nextBuffer );
               oaDLListAddToTail ( cameraInfo->callbackQueue,
                   &cameraInfo->frameCallbacks[ nextBuffer ]);
               cameraInfo->buffersFree--;
@@ -30,6 +30,7 @@
 #if HAVE_LIMITS_H
 #include <limits.h> 
 #endif
+#include <pthread.h>
 #if HAVE_LIBFLYCAPTURE2
 #include <flycapture/C/FlyCapture2_C.h>
 #endif
@@ -122,6 +123,7 @@
 #if HAVE_PLAYERONE
 #include "playerone/POAoacam.h"
 #endif
+#include "dummy/dummyoacam.h"
 
 
 oaInterface	oaCameraInterfaces[] = {
@@ -453,10 +455,10 @@ oaInterface	oaCameraInterfaces[] = {
   { 0, "", "", 0, 0, OA_UDC_FLAG_NONE },
 #endif
   {
-		0,
+		OA_CAM_IF_DUMMY,
 		"Dummy Camera",
-		"",
-		0,
+		"DUMMY",
+		oaDummyGetCameras,
 		0,
 		OA_UDC_FLAG_NONE
 	},
@@ -465,47 +467,393 @@ oaInterface	oaCameraInterfaces[] = {
 
 
 char*               installPathRoot = 0;
-static CAMERA_LIST	list;
+
+// Each interface is enumerated in its own thread so that one slow SDK
+// doesn't hold up all the others.  If a backend hasn't returned by the
+// deadline its results are abandoned and it cleans up after itself
+// whenever it does finally finish.
+
+typedef struct {
+  int						interfaceIndex;
+  unsigned long	featureFlags;
+  CAMERA_LIST		list;
+  int						result;
+  int						done;
+  int						abandoned;
+} ENUM_JOB;
+
+static pthread_mutex_t	enumMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t		enumDone = PTHREAD_COND_INITIALIZER;
+static int							enumBusy[ OA_CAM_IF_COUNT ];
+static unsigned int			enumTimeoutMsec = OA_CAM_ENUMERATE_TIMEOUT;
+
+// Every list handed out by oaGetCameras() is a reference-counted snapshot
+// of one scan, so any number of threads can hold lists (and open cameras
+// from them) at once.  The device entries in a snapshot stay where they
+// are until the last holder releases it.  The most recent scan also holds
+// a reference to itself so it can be handed out again until a hotplug
+// event says it may be out of date.
+//
+// listMutex protects the snapshots and their counts.  scanMutex just
+// stops two threads scanning the hardware at the same time; the second
+// one will usually find the first one's result waiting for it.
+
+typedef struct CAMERA_SNAPSHOT {
+  CAMERA_LIST							list;
+  unsigned long						featureFlags;
+  unsigned int						refs;
+  int											valid;
+  struct CAMERA_SNAPSHOT*	next;
+} CAMERA_SNAPSHOT;
+
+static pthread_mutex_t	listMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t	scanMutex = PTHREAD_MUTEX_INITIALIZER;
+static CAMERA_SNAPSHOT*	snapshots = 0;
+static CAMERA_SNAPSHOT*	currentList = 0;
+
+static void*		_oaEnumerateInterface ( void* );
+static void			_oaFreeEnumJob ( ENUM_JOB* );
+static int			_oaCachedCameraList ( oaCameraDevice***, unsigned long );
+static void			_oaReleaseSnapshot ( CAMERA_SNAPSHOT* );
+static void			_oaDropCurrentList ( void );
+
 
 int
-oaGetCameras( oaCameraDevice*** deviceList, unsigned long featureFlags )
+oaGetCameras ( oaCameraDevice*** deviceList, unsigned long featureFlags )
 {
-  int           i, err;
+  int							i, err, numJobs, complete, timedOut;
+  ENUM_JOB*				jobs[ OA_CAM_IF_COUNT ];
+  ENUM_JOB*				job;
+  CAMERA_SNAPSHOT*	snapshot;
+  pthread_t				thread;
+  pthread_attr_t	attr;
+  struct timeval	now;
+  struct timespec	deadline;
+  unsigned int		j;
+  int							ret = OA_ERR_NONE;
+
+  if (( ret = _oaCachedCameraList ( deviceList, featureFlags )) >= 0 ) {
+    return ret;
+  }
+
+  // Someone else may have finished scanning whilst we waited our turn
+
+  pthread_mutex_lock ( &scanMutex );
+  if (( ret = _oaCachedCameraList ( deviceList, featureFlags )) >= 0 ) {
+    pthread_mutex_unlock ( &scanMutex );
+    return ret;
+  }
+  ret = OA_ERR_NONE;
+
+  // The array is allocated up front even if nothing is found so that every
+  // list handed out can be told apart when it comes back
+
+  if (!( snapshot = calloc ( 1, sizeof ( CAMERA_SNAPSHOT ))) ||
+      _oaCheckCameraArraySize ( &snapshot->list ) < 0 ) {
+    if ( snapshot ) {
+      free (( void* ) snapshot );
+    }
+    pthread_mutex_unlock ( &scanMutex );
+    return -OA_ERR_MEM_ALLOC;
+  }
+  snapshot->featureFlags = featureFlags;
+
+  // Arm the hotplug monitor before scanning so that anything that changes
+  // whilst the scan is in progress invalidates the result
+
+  pthread_mutex_lock ( &listMutex );
+  ( void ) _oaHotplugArm();
+  ( void ) _oaHotplugChanged();
+  pthread_mutex_unlock ( &listMutex );
+
+  pthread_attr_init ( &attr );
+  pthread_attr_setdetachstate ( &attr, PTHREAD_CREATE_DETACHED );
+
+  numJobs = 0;
+  for ( i = 0; i < OA_CAM_IF_COUNT; i++ ) {
+    jobs[i] = 0;
+    if ( !oaCameraInterfaces[i].interfaceType ) {
+      continue;
+    }
+    pthread_mutex_lock ( &enumMutex );
+    if ( enumBusy[i] ) {
+      pthread_mutex_unlock ( &enumMutex );
+      oaLogWarning ( OA_LOG_CAMERA,
+          "%s: previous scan of %s interface still running, skipped",
+          __func__, oaCameraInterfaces[i].name );
+      continue;
+    }
+    pthread_mutex_unlock ( &enumMutex );
+    if (!( job = calloc ( 1, sizeof ( ENUM_JOB )))) {
+      ret = -OA_ERR_MEM_ALLOC;
+      break;
+    }
+    job->interfaceIndex = i;
+    job->featureFlags = featureFlags;
+    pthread_mutex_lock ( &enumMutex );
+    enumBusy[i] = 1;
+    pthread_mutex_unlock ( &enumMutex );
+    if ( pthread_create ( &thread, &attr, _oaEnumerateInterface,
+        ( void* ) job )) {
+      oaLogWarning ( OA_LOG_CAMERA, "%s: can't create thread, scanning %s "
+          "interface inline", __func__, oaCameraInterfaces[i].name );
+      ( void ) _oaEnumerateInterface (( void* ) job );
+    }
+    jobs[i] = job;
+    numJobs++;
+  }
+  pthread_attr_destroy ( &attr );
+
+  gettimeofday ( &now, 0 );
+  deadline.tv_sec = now.tv_sec + enumTimeoutMsec / 1000;
+  deadline.tv_nsec = now.tv_usec * 1000 + ( enumTimeoutMsec % 1000 ) * 1000000;
+  if ( deadline.tv_nsec >= 1000000000 ) {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000;
+  }
+
+  // Wait for everything to finish or the deadline to pass, whichever comes
+  // first
+
+  pthread_mutex_lock ( &enumMutex );
+  do {
+    complete = 0;
+    for ( i = 0; i < OA_CAM_IF_COUNT; i++ ) {
+      if ( jobs[i] && jobs[i]->done ) {
+        complete++;
+      }
+    }
+    if ( complete == numJobs ) {
+      break;
+    }
+  } while ( pthread_cond_timedwait ( &enumDone, &enumMutex, &deadline ) !=
+      ETIMEDOUT );
 
-  list.cameraList = 0;
-  list.numCameras = list.maxCameras = 0;
+  // Merge the results in interface table order so the list comes out the
+  // same way every time regardless of which thread finished first
 
+  timedOut = 0;
   for ( i = 0; i < OA_CAM_IF_COUNT; i++ ) {
-    if ( oaCameraInterfaces[i].interfaceType ) {
-      if (( err = oaCameraInterfaces[i].enumerate ( &list, featureFlags,
-          oaCameraInterfaces[i].flags )) < 0 ) {
-				if ( err != OA_ERR_LIBRARY_NOT_FOUND && err !=
-						OA_ERR_SYMBOL_NOT_FOUND ) {
-					_oaFreeCameraDeviceList ( &list );
-					list.numCameras = 0;
-					list.cameraList = 0;
-					return err;
-				}
+    if (!( job = jobs[i] )) {
+      continue;
+    }
+    if ( !job->done ) {
+      oaLogWarning ( OA_LOG_CAMERA, "%s: %s interface timed out after %ums",
+          __func__, oaCameraInterfaces[i].name, enumTimeoutMsec );
+      job->abandoned = 1;
+      timedOut = 1;
+      jobs[i] = 0;
+      continue;
+    }
+    err = job->result;
+    if ( err < 0 && err != OA_ERR_LIBRARY_NOT_FOUND &&
+        err != OA_ERR_SYMBOL_NOT_FOUND && ret == OA_ERR_NONE ) {
+      ret = err;
+    }
+    if ( ret == OA_ERR_NONE ) {
+      for ( j = 0; j < job->list.numCameras; j++ ) {
+        if (( err = _oaCheckCameraArraySize ( &snapshot->list )) < 0 ) {
+          ret = err;
+          break;
+        }
+        snapshot->list.cameraList[ snapshot->list.numCameras++ ] =
+            job->list.cameraList[j];
+        job->list.cameraList[j] = 0;
       }
     }
   }
-  
-  *deviceList = list.cameraList;
-  return list.numCameras;
+  pthread_mutex_unlock ( &enumMutex );
+
+  for ( i = 0; i < OA_CAM_IF_COUNT; i++ ) {
+    if ( jobs[i] ) {
+      _oaFreeEnumJob ( jobs[i] );
+    }
+  }
+
+  if ( ret != OA_ERR_NONE ) {
+    pthread_mutex_unlock ( &scanMutex );
+    _oaFreeCameraDeviceList ( &snapshot->list );
+    free (( void* ) snapshot );
+    return ret;
+  }
+
+  // Don't trust the list next time if anything failed to report in or
+  // something changed whilst we were looking.  One reference is for the
+  // caller and one for the cache.
+
+  pthread_mutex_lock ( &listMutex );
+  _oaDropCurrentList();
+  snapshot->valid = !timedOut && _oaHotplugArm() && !_oaHotplugChanged();
+  snapshot->refs = 2;
+  snapshot->next = snapshots;
+  snapshots = snapshot;
+  currentList = snapshot;
+  *deviceList = snapshot->list.cameraList;
+  ret = snapshot->list.numCameras;
+  pthread_mutex_unlock ( &listMutex );
+  pthread_mutex_unlock ( &scanMutex );
+
+  return ret;
+}
+
+
+/**
+ * Hand out another reference to the most recent scan if it is still good.
+ * Returns the number of cameras in the list, or -1 if a new scan is needed
+ */
+
+static int
+_oaCachedCameraList ( oaCameraDevice*** deviceList,
+    unsigned long featureFlags )
+{
+  int		ret = -1;
+
+  // A cached list is only worth having if we can tell when it's stale
+
+  pthread_mutex_lock ( &listMutex );
+  if ( currentList ) {
+    if ( currentList->valid && _oaHotplugArm() && !_oaHotplugChanged()) {
+      if ( featureFlags == currentList->featureFlags ) {
+        oaLogDebug ( OA_LOG_CAMERA, "%s: returning cached camera list",
+            __func__ );
+        currentList->refs++;
+        *deviceList = currentList->list.cameraList;
+        ret = currentList->list.numCameras;
+      }
+    } else {
+      _oaDropCurrentList();
+    }
+  }
+  pthread_mutex_unlock ( &listMutex );
+  return ret;
+}
+
+
+/**
+ * Stop caching the current list.  Anyone still holding it keeps it until
+ * they release it.  Must be called with listMutex held
+ */
+
+static void
+_oaDropCurrentList ( void )
+{
+  if ( currentList ) {
+    _oaReleaseSnapshot ( currentList );
+    currentList = 0;
+  }
+}
+
+
+/**
+ * Drop one reference to a snapshot, freeing it when the last one goes.
+ * Must be called with listMutex held
+ */
+
+static void
+_oaReleaseSnapshot ( CAMERA_SNAPSHOT* snapshot )
+{
+  CAMERA_SNAPSHOT**	prev;
+
+  if ( --snapshot->refs ) {
+    return;
+  }
+
+  for ( prev = &snapshots; *prev; prev = &( *prev )->next ) {
+    if ( *prev == snapshot ) {
+      *prev = snapshot->next;
+      break;
+    }
+  }
+  _oaFreeCameraDeviceList ( &snapshot->list );
+  free (( void* ) snapshot );
+}
+
+
+static void*
+_oaEnumerateInterface ( void* param )
+{
+  ENUM_JOB*		job = param;
+  int					i = job->interfaceIndex;
+  int					abandoned;
+
+  job->result = oaCameraInterfaces[i].enumerate ( &job->list,
+      job->featureFlags, oaCameraInterfaces[i].flags );
+
+  pthread_mutex_lock ( &enumMutex );
+  enumBusy[i] = 0;
+  job->done = 1;
+  abandoned = job->abandoned;
+  pthread_mutex_unlock ( &enumMutex );
+  pthread_cond_broadcast ( &enumDone );
+
+  if ( abandoned ) {
+    oaLogInfo ( OA_LOG_CAMERA, "%s: late result from %s interface discarded",
+        __func__, oaCameraInterfaces[i].name );
+    _oaFreeEnumJob ( job );
+  }
+  return 0;
+}
+
+
+static void
+_oaFreeEnumJob ( ENUM_JOB* job )
+{
+  unsigned int		i;
+
+  // Entries that were moved into the main list have been zeroed, so only
+  // anything left over gets freed here
+
+  for ( i = 0; i < job->list.numCameras; i++ ) {
+    if ( job->list.cameraList[i] ) {
+      free (( void* ) job->list.cameraList[i] );
+    }
+  }
+  if ( job->list.cameraList ) {
+    free (( void* ) job->list.cameraList );
+  }
+  free (( void* ) job );
 }
 
 
 void
 oaReleaseCameras ( oaCameraDevice** deviceList )
 {
-  // This is a bit cack-handed because we don't know from the data
-  // passed in how many cameras were found last time so we have to
-  // consult a static global instead.
-
-  _oaFreeCameraDeviceList ( &list );
-  list.numCameras = 0;
-  list.cameraList = 0;
-  return;
+  CAMERA_SNAPSHOT*	snapshot;
+
+  // The list passed in is matched back to the snapshot it came from, so
+  // lists from different scans can be released in any order.  If this was
+  // the most recent scan and it's still good, the cache's own reference
+  // keeps it around for next time.
+
+  pthread_mutex_lock ( &listMutex );
+  for ( snapshot = snapshots; snapshot; snapshot = snapshot->next ) {
+    if ( snapshot->list.cameraList == deviceList ) {
+      _oaReleaseSnapshot ( snapshot );
+      break;
+    }
+  }
+  pthread_mutex_unlock ( &listMutex );
+
+  if ( !snapshot ) {
+    oaLogWarning ( OA_LOG_CAMERA, "%s: camera list %p is not known", __func__,
+        deviceList );
+  }
+}
+
+
+void
+oaInvalidateCameraList ( void )
+{
+  pthread_mutex_lock ( &listMutex );
+  _oaDropCurrentList();
+  pthread_mutex_unlock ( &listMutex );
+}
+
+
+void
+oaSetCameraEnumerationTimeout ( unsigned int msec )
+{
+  enumTimeoutMsec = msec ? msec : OA_CAM_ENUMERATE_TIMEOUT;
 }
 
 
@@ -33,6 +33,34 @@
 
 #define OA_CLEAR(x)	memset ( &(x), 0, sizeof ( x ))
 
+// Return values for _oaControllerWait()
+
+#define	OA_WAIT_TIMEOUT		0
+#define	OA_WAIT_COMMAND		1
+#define	OA_WAIT_STOP			2
+
+// An asynchronous control change.  The OA_COMMAND must come first so that
+// the controller can treat it as any other queued command.  The command's
+// callback field points at the batch the command belongs to, which is
+// how the controller tells it apart from a synchronous command on the
+// caller's stack.
+
+struct ASYNC_BATCH;
+
+typedef struct ASYNC_COMMAND {
+  OA_COMMAND						command;
+  oaControlValue				value;
+  struct ASYNC_COMMAND*	nextPending;
+} ASYNC_COMMAND;
+
+typedef struct ASYNC_BATCH {
+  unsigned int					remaining;
+  int										resultCode;
+  void									( *callback )( void*, int );
+  void*									callbackArg;
+  struct ASYNC_BATCH*		nextDone;
+} ASYNC_BATCH;
+
 typedef struct {
   oaCameraDevice**      cameraList;
   unsigned int          numCameras;
@@ -49,8 +77,13 @@ typedef struct {
 extern int				oacamHasAuto ( oaCamera*, int );
 
 extern int				oacamReadControl ( oaCamera*, int, oaControlValue* );
+extern int				oacamSetControlMaxAge ( oaCamera*, int, uint64_t );
 extern int64_t		oacamGetControlValue ( oaControlValue* );
 extern int				oacamSetControl ( oaCamera*, int, oaControlValue*, int );
+extern int				oacamSetControlAsync ( oaCamera*, int, oaControlValue*,
+											void (*)( void*, int ), void* );
+extern int				oacamSetControls ( oaCamera*, int, const int*,
+											const oaControlValue*, void (*)( void*, int ), void* );
 extern int				oacamStartStreaming ( oaCamera*, void* (*)(void*, void*,
 											int, void* ), void* );
 extern int				oacamIsStreaming ( oaCamera* );
@@ -69,7 +102,34 @@ extern int				_oaInitCameraStructs ( oaCamera**, void**, size_t,
 											COMMON_INFO**);
 extern int				oacamStartTimer ( uint64_t, void* );
 extern void				oacamAbortTimer ( void* );
+extern uint64_t			oacamTimerRemaining ( void* );
+extern void				oacamWakeController ( void* );
+extern OA_COMMAND*		oacamNextCommand ( void* );
+extern void				oacamCommandComplete ( void*, OA_COMMAND*, int );
+extern void				oacamFlushAsync ( void* );
+extern void				_oaDeadline ( struct timespec*, uint64_t );
+extern int				_oaControllerWait ( void*, const struct timespec*, int );
+extern void				_oaWaitForBuffers ( void*, int );
+extern void				_oaReturnBuffer ( void* );
+extern void				_oaSoftwareFrame ( oaCamera*, void**, int*, void* );
+extern void*			_oaFrameScratch ( int, size_t );
+extern void				_oaSoftBinFrame ( oaCamera*, unsigned int, unsigned int,
+											void**, int* );
+extern void				_oaSoftROISize ( oaCamera*, unsigned int*, unsigned int* );
+extern int				_oaSoftwareSetROI ( oaCamera*, int, int );
+extern int				_oaSoftwareTestROISize ( oaCamera*, unsigned int,
+											unsigned int, unsigned int*, unsigned int* );
+
+extern int				_oaHotplugArm ( void );
+extern int				_oaHotplugChanged ( void );
+
 
+// Per-thread buffers for frames processed in software
+
+#define	OA_SCRATCH_ROI					0
+#define	OA_SCRATCH_BIN					1
+#define	OA_SCRATCH_BIN_ROW			2
+#define	OA_SCRATCH_SLOTS				3
 
 extern char*		installPathRoot;
 
@@ -83,6 +143,10 @@ extern char*		installPathRoot;
 #define OA_CAM_CTRL_AUTO_DEF(x)         defVal[OA_CAM_CTRL_MODIFIER_AUTO][OA_CAM_CTRL_MODE_BASE(x)]
 #define OA_CAM_CTRL_AUTO_STEP(x)        stepVal[OA_CAM_CTRL_MODIFIER_AUTO][OA_CAM_CTRL_MODE_BASE(x)]
 
+// Default time allowed for any one interface to enumerate its cameras,
+// in milliseconds
+#define OA_CAM_ENUMERATE_TIMEOUT	5000
+
 #define CAM_RUN_MODE_STOPPED			0
 #define	CAM_RUN_MODE_STREAMING		1
 #define	CAM_RUN_MODE_SINGLE_SHOT	2
@@ -90,11 +154,9 @@ extern char*		installPathRoot;
 #define FREE_DATA_STRUCTS		\
 	pthread_mutex_destroy ( &cameraInfo->commandQueueMutex ); \
 	pthread_mutex_destroy ( &cameraInfo->callbackQueueMutex ); \
-	pthread_mutex_destroy ( &cameraInfo->timerMutex ); \
 	pthread_cond_destroy ( &cameraInfo->callbackQueued ); \
 	pthread_cond_destroy ( &cameraInfo->commandQueued ); \
 	pthread_cond_destroy ( &cameraInfo->commandComplete ); \
-	pthread_cond_destroy ( &cameraInfo->timerState ); \
 	free (( void* ) commonInfo ); \
 	free (( void* ) cameraInfo ); \
 	free (( void* ) camera )
@@ -45,6 +45,8 @@ oacamPylonCallbackHandler ( void* param )
   int							exitThread = 0, streaming;
   CALLBACK*				callback;
   void*						(*callbackFunc)( void*, void*, int, void* );
+  void*						frame;
+  int							frameLen;
 
   do {
     pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
@@ -68,8 +70,15 @@ oacamPylonCallbackHandler ( void* param )
       switch ( callback->callbackType ) {
         case OA_CALLBACK_NEW_FRAME:
           callbackFunc = callback->callback;
-          callbackFunc ( callback->callbackArg, callback->buffer,
-              callback->bufferLen, callback->metadata );
+          frame = callback->buffer;
+          frameLen = callback->bufferLen;
+          _oaSoftwareFrame ( camera, &frame, &frameLen, callback->metadata );
+          OA_FRAME_STATS_CB_STAMP ( cameraInfo, callback,
+              OA_FRAME_STAGE_CALLBACK );
+          callbackFunc ( callback->callbackArg, frame, frameLen,
+              callback->metadata );
+          OA_FRAME_STATS_CB_STAMP ( cameraInfo, callback,
+              OA_FRAME_STAGE_RETURNED );
 					// We can only requeue frames if we're still streaming
 					pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
 					streaming = ( cameraInfo->runMode == CAM_RUN_MODE_STREAMING ) ? 1 : 0;					pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
@@ -78,6 +87,7 @@ oacamPylonCallbackHandler ( void* param )
 								cameraInfo->bufferHandle[ callback->bufferIdx ],
 								( void* ) &( cameraInfo->ctx[ callback->bufferIdx ]));
 					}
+          OA_FRAME_STATS_CB_COMPLETE ( cameraInfo, callback );
           pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
           cameraInfo->buffersFree++;
           pthread_mutex_unlock ( &cameraInfo->callbackQueueMutex );
@@ -1216,6 +1216,7 @@ oaPylonCloseCamera ( oaCamera* camera )
 			}
 		}
 
+    oacamFlushAsync ( cameraInfo );
     oaDLListDelete ( cameraInfo->commandQueue, 1 );
     oaDLListDelete ( cameraInfo->callbackQueue, 0 );
 
@@ -81,7 +81,7 @@ oacamPylonController ( void* param )
       pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
     }
     do {
-      command = oaDLListRemoveFromHead ( cameraInfo->commandQueue );
+      command = oacamNextCommand ( cameraInfo );
       if ( command ) {
         switch ( command->commandType ) {
           case OA_CMD_CONTROL_SET:
@@ -108,14 +108,7 @@ oacamPylonController ( void* param )
             resultCode = -OA_ERR_INVALID_CONTROL;
             break;
         }
-        if ( command->callback ) {
-        } else {
-          pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
-          command->completed = 1;
-          command->resultCode = resultCode;
-          pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
-          pthread_cond_broadcast ( &cameraInfo->commandComplete );
-        }
+        oacamCommandComplete ( cameraInfo, command, resultCode );
       }
     } while ( command );
 
@@ -176,6 +169,7 @@ oacamPylonController ( void* param )
 							cameraInfo->imageBufferLength;
 					cameraInfo->frameCallbacks[ nextBuffer ].bufferIdx = bufferIdx;
 					pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
+					OA_FRAME_STATS_QUEUED ( cameraInfo, nextBuffer );
 					oaDLListAddToTail ( cameraInfo->callbackQueue,
 							&cameraInfo->frameCallbacks[ nextBuffer ]);
 					cameraInfo->buffersFree--;
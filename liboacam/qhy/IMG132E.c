@@ -41,7 +41,6 @@
 
 
 static void		_IMG132EInitFunctionPointers ( oaCamera* );
-void*			_img132eEventHandler ( void* );
 
 static int		oaIMG132ECameraGetFramePixelFormat ( oaCamera* );
 static const FRAMESIZES* oaIMG132ECameraGetFrameSizes ( oaCamera* );
@@ -55,10 +54,9 @@ static int		oaIMG132ECloseCamera ( oaCamera* );
 int
 _IMG132EInitCamera ( oaCamera* camera )
 {
-  int		i, j;
+  int		i, j, ret;
   QHY_STATE*	cameraInfo = camera->_private;
   COMMON_INFO*	commonInfo = camera->_common;
-  void*		dummy;
 
   oaLogInfo ( OA_LOG_CAMERA, "%s ( %p ): entered", __func__, camera );
 
@@ -152,15 +150,18 @@ _IMG132EInitCamera ( oaCamera* camera )
     return -OA_ERR_SYSTEM_ERROR;
   }
 
-  pthread_create ( &cameraInfo->eventHandler, 0, _img132eEventHandler,
-      ( void* ) cameraInfo );
+  if (( ret = _oaUSBEventThreadStart ( cameraInfo->usbContext )) !=
+      OA_ERR_NONE ) {
+    oaLogError ( OA_LOG_CAMERA, "%s: can't start USB event thread", __func__ );
+    free (( void* ) cameraInfo->frameSizes[1].sizes );
+    return ret;
+  }
 
   if (!( cameraInfo->buffers = calloc ( OA_CAM_BUFFERS,
       sizeof ( frameBuffer )))) {
     oaLogError ( OA_LOG_CAMERA, "%s: malloc of buffer array failed",
 				__func__ );
-    cameraInfo->stopCallbackThread = 1;
-    pthread_join ( cameraInfo->eventHandler, &dummy );
+    _oaUSBEventThreadStop ( cameraInfo->usbContext );
     free (( void* ) cameraInfo->frameSizes[1].sizes );
     return -OA_ERR_MEM_ALLOC;
   }
@@ -177,8 +178,7 @@ _IMG132EInitCamera ( oaCamera* camera )
           free (( void* ) cameraInfo->buffers[j].start );
         }
       }
-      cameraInfo->stopCallbackThread = 1;
-      pthread_join ( cameraInfo->eventHandler, &dummy );
+      _oaUSBEventThreadStop ( cameraInfo->usbContext );
       free (( void* ) cameraInfo->buffers );
       free (( void* ) cameraInfo->frameSizes[1].sizes );
       return -OA_ERR_MEM_ALLOC;
@@ -195,8 +195,7 @@ _IMG132EInitCamera ( oaCamera* camera )
     for ( j = 0; j < OA_CAM_BUFFERS; j++ ) {
       free (( void* ) cameraInfo->buffers[j].start );
     }
-    cameraInfo->stopCallbackThread = 1;
-    pthread_join ( cameraInfo->eventHandler, &dummy );
+    _oaUSBEventThreadStop ( cameraInfo->usbContext );
     free (( void* ) cameraInfo->frameSizes[1].sizes );
     free (( void* ) cameraInfo->buffers );
     free (( void* ) camera->_common );
@@ -216,8 +215,7 @@ _IMG132EInitCamera ( oaCamera* camera )
     for ( j = 0; j < OA_CAM_BUFFERS; j++ ) {
       free (( void* ) cameraInfo->buffers[j].start );
     }
-    cameraInfo->stopCallbackThread = 1;
-    pthread_join ( cameraInfo->eventHandler, &dummy );
+    _oaUSBEventThreadStop ( cameraInfo->usbContext );
     free (( void* ) cameraInfo->frameSizes[1].sizes );
     free (( void* ) cameraInfo->buffers );
     free (( void* ) camera->_common );
@@ -279,6 +277,9 @@ oaIMG132ECloseCamera ( oaCamera* camera )
     pthread_cond_broadcast ( &cameraInfo->callbackQueued );
     pthread_join ( cameraInfo->callbackThread, &dummy );
 
+    _oaUSBTransferFree ( &cameraInfo->transferEngine );
+    _oaUSBEventThreadStop ( cameraInfo->usbContext );
+
     libusb_release_interface ( cameraInfo->usbHandle, 0 );
     libusb_close ( cameraInfo->usbHandle );
     libusb_exit ( cameraInfo->usbContext );
@@ -293,6 +294,7 @@ oaIMG132ECloseCamera ( oaCamera* camera )
 
     free (( void* ) cameraInfo->frameSizes[1].sizes );
 
+    oacamFlushAsync ( cameraInfo );
     oaDLListDelete ( cameraInfo->commandQueue, 1 );
     oaDLListDelete ( cameraInfo->callbackQueue, 0 );
 
@@ -310,25 +312,6 @@ oaIMG132ECloseCamera ( oaCamera* camera )
 }
 
 
-void*
-_img132eEventHandler ( void* param )
-{
-  struct timeval        tv;
-  QHY_STATE*            cameraInfo = param;
-  int                   exitThread;
-
-  tv.tv_sec = 1;
-  tv.tv_usec = 0;
-  do { 
-    libusb_handle_events_timeout_completed ( cameraInfo->usbContext, &tv, 0 );
-    pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
-    exitThread = cameraInfo->stopCallbackThread;
-    pthread_mutex_unlock ( &cameraInfo->callbackQueueMutex );
-  } while ( !exitThread );
-  return 0;
-}
-
-
 static int
 oaIMG132ECameraGetFramePixelFormat ( oaCamera* camera )
 {
@@ -63,6 +63,10 @@
 #define CAM_QHY5RIIC    34
 #define CAM_QHY5HII     35
 
-#define QHY_NUM_TRANSFER_BUFS	16
+// Each transfer is a whole frame, so this is also the number of frames
+// in flight.  It needs to be comfortably less than OA_CAM_BUFFERS for the
+// transfers to be able to go straight into the frame buffers
+
+#define QHY_NUM_TRANSFER_BUFS	4
 
 #endif	/* OA_QHY_H */
@@ -285,6 +285,7 @@ oaQHY5CloseCamera ( oaCamera* camera )
 
     free (( void* ) cameraInfo->frameSizes[1].sizes );
 
+    oacamFlushAsync ( cameraInfo );
     oaDLListDelete ( cameraInfo->commandQueue, 1 );
     oaDLListDelete ( cameraInfo->callbackQueue, 0 );
 
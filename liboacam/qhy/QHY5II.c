@@ -41,7 +41,6 @@
 
 
 static void		_QHY5IIInitFunctionPointers ( oaCamera* );
-void*			_qhy5iiEventHandler ( void* );
 
 static int		oaQHY5IICameraGetFramePixelFormat ( oaCamera* );
 static const FRAMESIZES* oaQHY5IICameraGetFrameSizes ( oaCamera* );
@@ -55,10 +54,9 @@ static int		oaQHY5IICloseCamera ( oaCamera* );
 int
 _QHY5IIInitCamera ( oaCamera* camera )
 {
-  int		i, j;
+  int		i, j, ret;
   QHY_STATE*	cameraInfo = camera->_private;
   COMMON_INFO*	commonInfo = camera->_common;
-  void		*dummy;
 
   oaLogInfo ( OA_LOG_CAMERA, "%s ( %p ): entered", __func__, camera );
 
@@ -152,8 +150,12 @@ _QHY5IIInitCamera ( oaCamera* camera )
   camera->OA_CAM_CTRL_TYPE( OA_CAM_CTRL_DROPPED ) = OA_CTRL_TYPE_READONLY;
   camera->OA_CAM_CTRL_TYPE( OA_CAM_CTRL_DROPPED_RESET ) = OA_CTRL_TYPE_BUTTON;
 
-  pthread_create ( &cameraInfo->eventHandler, 0, _qhy5iiEventHandler,
-      ( void* ) cameraInfo );
+  if (( ret = _oaUSBEventThreadStart ( cameraInfo->usbContext )) !=
+      OA_ERR_NONE ) {
+    oaLogError ( OA_LOG_CAMERA, "%s: can't start USB event thread", __func__ );
+    free (( void* ) cameraInfo->frameSizes[1].sizes );
+    return ret;
+  }
 
   cameraInfo->buffers = 0;
   cameraInfo->configuredBuffers = 0;
@@ -167,8 +169,7 @@ _QHY5IIInitCamera ( oaCamera* camera )
   if (!( cameraInfo->buffers = calloc ( OA_CAM_BUFFERS,
       sizeof ( frameBuffer )))) {
     oaLogError ( OA_LOG_CAMERA, "%s: malloc of buffer array failed", __func__ );
-    cameraInfo->stopCallbackThread = 1;
-    pthread_join ( cameraInfo->eventHandler, &dummy );
+    _oaUSBEventThreadStop ( cameraInfo->usbContext );
     free (( void* ) cameraInfo->frameSizes[1].sizes );
     return -OA_ERR_MEM_ALLOC;
   }
@@ -185,8 +186,7 @@ _QHY5IIInitCamera ( oaCamera* camera )
           free (( void* ) cameraInfo->buffers[j].start );
         }
       }
-      cameraInfo->stopCallbackThread = 1;
-      pthread_join ( cameraInfo->eventHandler, &dummy );
+      _oaUSBEventThreadStop ( cameraInfo->usbContext );
       free (( void* ) cameraInfo->buffers );
       free (( void* ) cameraInfo->frameSizes[1].sizes );
       return -OA_ERR_MEM_ALLOC;
@@ -203,8 +203,7 @@ _QHY5IIInitCamera ( oaCamera* camera )
     for ( j = 0; j < OA_CAM_BUFFERS; j++ ) {
       free (( void* ) cameraInfo->buffers[j].start );
     }
-    cameraInfo->stopCallbackThread = 1;
-    pthread_join ( cameraInfo->eventHandler, &dummy );
+    _oaUSBEventThreadStop ( cameraInfo->usbContext );
     free (( void* ) cameraInfo->buffers );
     free (( void* ) cameraInfo->frameSizes[1].sizes );
     free (( void* ) camera->_common );
@@ -224,8 +223,7 @@ _QHY5IIInitCamera ( oaCamera* camera )
     for ( j = 0; j < OA_CAM_BUFFERS; j++ ) {
       free (( void* ) cameraInfo->buffers[j].start );
     }
-    cameraInfo->stopCallbackThread = 1;
-    pthread_join ( cameraInfo->eventHandler, &dummy );
+    _oaUSBEventThreadStop ( cameraInfo->usbContext );
     free (( void* ) cameraInfo->buffers );
     free (( void* ) cameraInfo->frameSizes[1].sizes );
     free (( void* ) camera->_common );
@@ -290,7 +288,8 @@ oaQHY5IICloseCamera ( oaCamera* camera )
     pthread_cond_broadcast ( &cameraInfo->callbackQueued );
     pthread_join ( cameraInfo->callbackThread, &dummy );
 
-    pthread_join ( cameraInfo->eventHandler, &dummy );
+    _oaUSBTransferFree ( &cameraInfo->transferEngine );
+    _oaUSBEventThreadStop ( cameraInfo->usbContext );
 
     libusb_release_interface ( cameraInfo->usbHandle, 0 );
     libusb_close ( cameraInfo->usbHandle );
@@ -306,6 +305,7 @@ oaQHY5IICloseCamera ( oaCamera* camera )
 
     free (( void* ) cameraInfo->frameSizes[1].sizes );
 
+    oacamFlushAsync ( cameraInfo );
     oaDLListDelete ( cameraInfo->commandQueue, 1 );
     oaDLListDelete ( cameraInfo->callbackQueue, 0 );
 
@@ -323,25 +323,6 @@ oaQHY5IICloseCamera ( oaCamera* camera )
 }
 
 
-void*
-_qhy5iiEventHandler ( void* param )
-{
-  struct timeval        tv;
-  QHY_STATE*            cameraInfo = param;
-  int                   exitThread;
-
-  tv.tv_sec = 1;
-  tv.tv_usec = 0;
-  do { 
-    libusb_handle_events_timeout_completed ( cameraInfo->usbContext, &tv, 0 );
-    pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
-    exitThread = cameraInfo->stopCallbackThread;
-    pthread_mutex_unlock ( &cameraInfo->callbackQueueMutex );
-  } while ( !exitThread );
-  return 0;
-}
-
-
 static int
 oaQHY5IICameraGetFramePixelFormat ( oaCamera* camera )
 {
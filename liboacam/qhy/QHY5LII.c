@@ -41,7 +41,6 @@
 
 
 static void		_QHY5LIIInitFunctionPointers ( oaCamera* );
-void*			_qhy5liiEventHandler ( void* );
 
 static int		oaQHY5LIICameraGetFramePixelFormat ( oaCamera* );
 static const FRAMESIZES* oaQHY5LIICameraGetFrameSizes ( oaCamera* );
@@ -55,7 +54,7 @@ static int		oaQHY5LIICloseCamera ( oaCamera* );
 int
 _QHY5LIIInitCamera ( oaCamera* camera )
 {
-  int		i, j;
+  int		i, j, ret;
   unsigned char	buf[4];
   QHY_STATE*	cameraInfo = camera->_private;
   COMMON_INFO*	commonInfo = camera->_common;
@@ -180,8 +179,12 @@ _QHY5LIIInitCamera ( oaCamera* camera )
   camera->OA_CAM_CTRL_TYPE( OA_CAM_CTRL_DROPPED ) = OA_CTRL_TYPE_READONLY;
   camera->OA_CAM_CTRL_TYPE( OA_CAM_CTRL_DROPPED_RESET ) = OA_CTRL_TYPE_BUTTON;
 
-  pthread_create ( &cameraInfo->eventHandler, 0, _qhy5liiEventHandler,
-      ( void* ) cameraInfo );
+  if (( ret = _oaUSBEventThreadStart ( cameraInfo->usbContext )) !=
+      OA_ERR_NONE ) {
+    oaLogError ( OA_LOG_CAMERA, "%s: can't start USB event thread", __func__ );
+    free (( void* ) cameraInfo->frameSizes[1].sizes );
+    return ret;
+  }
 
   cameraInfo->buffers = 0;
   cameraInfo->configuredBuffers = 0;
@@ -195,8 +198,7 @@ _QHY5LIIInitCamera ( oaCamera* camera )
   if (!( cameraInfo->buffers = calloc ( OA_CAM_BUFFERS,
       sizeof ( frameBuffer )))) {
     oaLogError ( OA_LOG_CAMERA, "%s: malloc of buffer array failed", __func__ );
-    cameraInfo->stopCallbackThread = 1;
-    pthread_join ( cameraInfo->eventHandler, &dummy );
+    _oaUSBEventThreadStop ( cameraInfo->usbContext );
     free (( void* ) cameraInfo->frameSizes[1].sizes );
     return -OA_ERR_MEM_ALLOC;
   }
@@ -229,8 +231,7 @@ _QHY5LIIInitCamera ( oaCamera* camera )
     for ( j = 0; j < OA_CAM_BUFFERS; j++ ) {
       free (( void* ) cameraInfo->buffers[j].start );
     }
-    cameraInfo->stopCallbackThread = 1;
-    pthread_join ( cameraInfo->eventHandler, &dummy );
+    _oaUSBEventThreadStop ( cameraInfo->usbContext );
     free (( void* ) cameraInfo->buffers );
     free (( void* ) cameraInfo->frameSizes[1].sizes );
     free (( void* ) camera->_common );
@@ -246,7 +247,7 @@ _QHY5LIIInitCamera ( oaCamera* camera )
     cameraInfo->stopControllerThread = 1;
     pthread_cond_broadcast ( &cameraInfo->commandQueued );
     pthread_join ( cameraInfo->controllerThread, &dummy );
-    pthread_join ( cameraInfo->eventHandler, &dummy );
+    _oaUSBEventThreadStop ( cameraInfo->usbContext );
     for ( j = 0; j < OA_CAM_BUFFERS; j++ ) {
       free (( void* ) cameraInfo->buffers[j].start );
     }
@@ -314,7 +315,8 @@ oaQHY5LIICloseCamera ( oaCamera* camera )
     pthread_cond_broadcast ( &cameraInfo->callbackQueued );
     pthread_join ( cameraInfo->callbackThread, &dummy );
 
-    pthread_join ( cameraInfo->eventHandler, &dummy );
+    _oaUSBTransferFree ( &cameraInfo->transferEngine );
+    _oaUSBEventThreadStop ( cameraInfo->usbContext );
 
     libusb_release_interface ( cameraInfo->usbHandle, 0 );
     libusb_close ( cameraInfo->usbHandle );
@@ -330,6 +332,7 @@ oaQHY5LIICloseCamera ( oaCamera* camera )
 
     free (( void* ) cameraInfo->frameSizes[1].sizes );
 
+    oacamFlushAsync ( cameraInfo );
     oaDLListDelete ( cameraInfo->commandQueue, 1 );
     oaDLListDelete ( cameraInfo->callbackQueue, 0 );
 
@@ -347,25 +350,6 @@ oaQHY5LIICloseCamera ( oaCamera* camera )
 }
 
 
-void*
-_qhy5liiEventHandler ( void* param )
-{ 
-  struct timeval        tv;
-  QHY_STATE*            cameraInfo = param;
-  int                   exitThread;
-
-  tv.tv_sec = 1;
-  tv.tv_usec = 0;
-  do { 
-    libusb_handle_events_timeout_completed ( cameraInfo->usbContext, &tv, 0 );
-    pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
-    exitThread = cameraInfo->stopCallbackThread;
-    pthread_mutex_unlock ( &cameraInfo->callbackQueueMutex );
-  } while ( !exitThread );
-  return 0;
-}
-    
-
 static int
 oaQHY5LIICameraGetFramePixelFormat ( oaCamera* camera )
 {
@@ -101,7 +101,7 @@ static void	_initialiseRegisters ( QHY_STATE* );
 static void	_setPLLRegister ( QHY_STATE*, unsigned int );
 static int	_abortFrame ( QHY_STATE* );
 static int	_doReadTemperature ( QHY_STATE* );
-static void     _processPayload ( oaCamera*, unsigned char*, unsigned int );
+static int      _processPayload ( void*, unsigned char*, unsigned int );
 static void     _releaseFrame ( QHY_STATE* );
 
 
@@ -131,7 +131,7 @@ oacamQHY5LIIcontroller ( void* param )
       pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
     }
     do {
-      command = oaDLListRemoveFromHead ( cameraInfo->commandQueue );
+      command = oacamNextCommand ( cameraInfo );
       if ( command ) {
         switch ( command->commandType ) {
           case OA_CMD_CONTROL_SET:
@@ -155,15 +155,7 @@ oacamQHY5LIIcontroller ( void* param )
             resultCode = -OA_ERR_INVALID_CONTROL;
             break;
         }
-        if ( command->callback ) {
-					oaLogError ( OA_LOG_CAMERA, "%s: command has callback", __func__ );
-        } else {
-          pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
-          command->completed = 1;
-          command->resultCode = resultCode;
-          pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
-          pthread_cond_broadcast ( &cameraInfo->commandComplete );
-        }
+        oacamCommandComplete ( cameraInfo, command, resultCode );
       }
     } while ( command );
   } while ( !exitThread );
@@ -818,100 +810,12 @@ _processGetControl ( QHY_STATE* cameraInfo, OA_COMMAND* command )
 }
 
 
-libusb_transfer_cb_fn
-_qhy5liiVideoStreamCallback ( struct libusb_transfer* transfer )
-{ 
-  oaCamera*     camera = transfer->user_data;
-  QHY_STATE*    cameraInfo = camera->_private;
-  int           resubmit = 1, streaming;
-
-  switch ( transfer->status ) {
-  
-    case LIBUSB_TRANSFER_COMPLETED:
-      if ( transfer->num_iso_packets == 0 ) { // bulk mode transfer
-        _processPayload ( camera, transfer->buffer, transfer->actual_length );
-      } else {
-        oaLogError ( OA_LOG_CAMERA, "%s: Unexpected isochronous transfer",
-						__func__ );
-      } 
-      break;
-    
-    case LIBUSB_TRANSFER_CANCELLED:
-    case LIBUSB_TRANSFER_ERROR:
-    case LIBUSB_TRANSFER_NO_DEVICE:
-    {
-      int i;
-
-      pthread_mutex_lock ( &cameraInfo->videoCallbackMutex );
-
-      for ( i = 0; i < QHY_NUM_TRANSFER_BUFS; i++ ) {
-        if ( cameraInfo->transfers[i] == transfer ) {
-          free ( transfer->buffer );
-          libusb_free_transfer ( transfer );
-          cameraInfo->transfers[i] = 0;
-          break;
-        }
-      }
-
-      if ( QHY_NUM_TRANSFER_BUFS == i ) {
-        oaLogError ( OA_LOG_CAMERA, "%s: transfer %p not found; not freeing!",
-						__func__, transfer );
-      }
-
-      resubmit = 0;
-
-      pthread_mutex_unlock ( &cameraInfo->videoCallbackMutex );
-      break;
-    }
-    case LIBUSB_TRANSFER_TIMED_OUT:
-      break;
-
-    case LIBUSB_TRANSFER_STALL:
-    case LIBUSB_TRANSFER_OVERFLOW:
-      oaLogError ( OA_LOG_CAMERA, "%s: retrying transfer, status = %d (%s)",
-					__func__, transfer->status, libusb_error_name ( transfer->status ));
-      break;
-  }
-
-  if ( resubmit ) {
-    pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
-    streaming = ( cameraInfo->runMode == CAM_RUN_MODE_STREAMING ) ? 1 : 0;
-    pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
-    if ( streaming ) {
-      libusb_submit_transfer ( transfer );
-    } else {
-      int i;
-      pthread_mutex_lock ( &cameraInfo->videoCallbackMutex );
-      // Mark transfer deleted
-      for ( i = 0; i < QHY_NUM_TRANSFER_BUFS; i++ ) {
-        if ( cameraInfo->transfers[i] == transfer ) {
-          oaLogError ( OA_LOG_CAMERA, "%s: Freeing orphan transfer %d (%p)",
-							__func__, i, transfer );
-          free ( transfer->buffer );
-          libusb_free_transfer ( transfer );
-          cameraInfo->transfers[i] = 0;
-        }
-      }
-      if ( QHY_NUM_TRANSFER_BUFS == i ) {
-        oaLogError ( OA_LOG_CAMERA,
-						"%s: orphan transfer %p not found; not freeing!", __func__,
-            transfer );
-      }
-      pthread_mutex_unlock ( &cameraInfo->videoCallbackMutex );
-    }
-  }
-
-  return 0;
-}
-
-
 static int
 _processStreamingStart ( oaCamera* camera, OA_COMMAND* command )
 {
   QHY_STATE*			cameraInfo = camera->_private;
   CALLBACK*			cb;
-  int				txId, ret, txBufferSize, numTxBuffers;
-  struct libusb_transfer*	transfer;
+  int				ret;
   unsigned char	buf[1] = { 100 };
 
   if ( cameraInfo->runMode != CAM_RUN_MODE_STOPPED ) {
@@ -924,51 +828,13 @@ _processStreamingStart ( oaCamera* camera, OA_COMMAND* command )
     cameraInfo->streamingCallback.callbackArg = cb->callbackArg;
   }
 
-  txBufferSize = cameraInfo->captureLength;
-  // This is a guess
-  numTxBuffers = 8;
-  if ( numTxBuffers < 8 ) {
-    numTxBuffers = 8;
-  }
-  if ( numTxBuffers > 100 ) {
-    numTxBuffers = 100;
-  }
-  for ( txId = 0; txId < QHY_NUM_TRANSFER_BUFS; txId++ ) {
-    if ( txId < numTxBuffers ) {
-      transfer = libusb_alloc_transfer(0);
-      cameraInfo->transfers[ txId ] = transfer;
-      if (!( cameraInfo->transferBuffers [ txId ] =
-          malloc ( txBufferSize ))) {
-        oaLogError ( OA_LOG_CAMERA, "%s: malloc failed.  Need to free buffer",
-						__func__ );
-        return -OA_ERR_SYSTEM_ERROR;
-      }
-      libusb_fill_bulk_transfer ( transfer, cameraInfo->usbHandle,
-          QHY_BULK_ENDP_IN, cameraInfo->transferBuffers [ txId ],
-          txBufferSize, ( libusb_transfer_cb_fn ) _qhy5liiVideoStreamCallback,
-          camera, USB2_TIMEOUT );
-    } else {
-      cameraInfo->transfers[ txId ] = 0;
-    }
-  }
-
-  for ( txId = 0; txId < numTxBuffers; txId++ ) {
-    if (( ret = libusb_submit_transfer ( cameraInfo->transfers [ txId ]))) {
-      break;
-    }
-  }
-
-  // free up any transfer buffers that we're not using
-  if ( ret && txId > 0 ) {
-    for ( ; txId < QHY_NUM_TRANSFER_BUFS; txId++) {
-      if ( cameraInfo->transfers[ txId ] ) {
-        if ( cameraInfo->transfers[ txId ]->buffer ) {
-          free ( cameraInfo->transfers[ txId ]->buffer );
-        }
-        libusb_free_transfer ( cameraInfo->transfers[ txId ]);
-        cameraInfo->transfers[ txId ] = 0;
-      }
-    }
+  _oaUSBTransferInit ( &cameraInfo->transferEngine, &oaUSBLibusbTransport,
+      cameraInfo->usbHandle, QHY_BULK_ENDP_IN, USB2_TIMEOUT, _processPayload,
+      _qhyReserveFrameSpace, camera );
+  if (( ret = _oaUSBTransferStart ( &cameraInfo->transferEngine,
+      QHY_NUM_TRANSFER_BUFS, cameraInfo->captureLength )) != OA_ERR_NONE ) {
+    _oaUSBTransferFree ( &cameraInfo->transferEngine );
+    return ret;
   }
 
   _usbControlMsg ( cameraInfo, QHY_CMD_DEFAULT_OUT, QHY_REQ_BEGIN_VIDEO,
@@ -985,7 +851,6 @@ _processStreamingStart ( oaCamera* camera, OA_COMMAND* command )
 static int
 _processStreamingStop ( QHY_STATE* cameraInfo, OA_COMMAND* command )
 {
-  int		queueEmpty, i, res, allReleased;
   unsigned char	buf[4] = { 0, 0, 0, 0 };
 
   if ( cameraInfo->runMode != CAM_RUN_MODE_STREAMING ) {
@@ -998,60 +863,30 @@ _processStreamingStop ( QHY_STATE* cameraInfo, OA_COMMAND* command )
   cameraInfo->runMode = CAM_RUN_MODE_STOPPED;
   pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
 
-  pthread_mutex_lock ( &cameraInfo->videoCallbackMutex );
-  for ( i = 0; i < QHY_NUM_TRANSFER_BUFS; i++ ) {
-    if ( cameraInfo->transfers[i] ) {
-      res = libusb_cancel_transfer ( cameraInfo->transfers[i] );
-      if ( res < 0 && res != LIBUSB_ERROR_NOT_FOUND ) {
-        free ( cameraInfo->transfers[i]->buffer );
-        libusb_free_transfer ( cameraInfo->transfers[i] );
-        cameraInfo->transfers[i] = 0;
-      }
-    }
-  }
-  pthread_mutex_unlock ( &cameraInfo->videoCallbackMutex );
-
-  do {
-    allReleased = 1;
-    for ( i = 0; i < QHY_NUM_TRANSFER_BUFS && allReleased; i++ ) {
-      pthread_mutex_lock ( &cameraInfo->videoCallbackMutex );
-      if ( cameraInfo->transfers[i] ) {
-        allReleased = 0;
-      }
-      pthread_mutex_unlock ( &cameraInfo->videoCallbackMutex );
-    }
-    if ( !allReleased ) {
-      usleep ( 100 ); // FIX ME -- lazy.  should use a pthread condition?
-    }
-  } while ( !allReleased );
+  _oaUSBTransferFree ( &cameraInfo->transferEngine );
 
   // We wait here until the callback queue has drained otherwise a future
   // close of the camera could rip the image frame out from underneath the
   // callback
 
-  queueEmpty = 0;
-  do {
-    pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
-    queueEmpty = ( OA_CAM_BUFFERS == cameraInfo->buffersFree ) ? 1 : 0;
-    pthread_mutex_unlock ( &cameraInfo->callbackQueueMutex );
-    if ( !queueEmpty ) {
-      usleep ( 10000 );
-    }
-  } while ( !queueEmpty );
+  _oaWaitForBuffers ( cameraInfo, OA_CAM_BUFFERS );
 
   return OA_ERR_NONE;
 }
 
 
-static void
-_processPayload ( oaCamera* camera, unsigned char* buffer, unsigned int len )
+static int
+_processPayload ( void* arg, unsigned char* buffer, unsigned int len )
 {
+  oaCamera*             camera = arg;
   QHY_STATE*            cameraInfo = camera->_private;
   unsigned int          buffersFree, dropFrame;
   unsigned char*	p;
+  unsigned char*        frame;
+  int                   resync = 0;
 
   if ( 0 == len ) {
-    return;
+    return 0;
   }
  
   dropFrame = 0;
@@ -1061,9 +896,17 @@ _processPayload ( oaCamera* camera, unsigned char* buffer, unsigned int len )
   pthread_mutex_unlock ( &cameraInfo->callbackQueueMutex );
   if ( buffersFree && ( cameraInfo->receivedBytes + len ) <=
       cameraInfo->captureLength ) {
-    memcpy (( unsigned char* ) cameraInfo->buffers[
-        cameraInfo->nextBuffer ].start + cameraInfo->receivedBytes,
-        buffer, len );
+    if ( !cameraInfo->receivedBytes ) {
+      OA_FRAME_STATS_STAMP ( cameraInfo, cameraInfo->nextBuffer,
+          OA_FRAME_STAGE_READOUT );
+    }
+    frame = ( unsigned char* ) cameraInfo->buffers[
+        cameraInfo->nextBuffer ].start + cameraInfo->receivedBytes;
+    // Unless the stream has got out of step the transfer will have gone
+    // straight into the frame buffer
+    if ( frame != buffer ) {
+      memmove ( frame, buffer, len );
+    }
     cameraInfo->receivedBytes += len;
     // It seems that the last five bytes of the frame should be
     // 0xaa, 0x11, 0xcc, 0xee, 0xXX
@@ -1076,6 +919,7 @@ _processPayload ( oaCamera* camera, unsigned char* buffer, unsigned int len )
       } else {
         if ( cameraInfo->receivedBytes == QHY5LII_EOF_LEN ) {
           cameraInfo->receivedBytes = 0;
+          resync = OA_USB_PAYLOAD_RESYNC;
         } else {
           dropFrame = 1;
         }
@@ -1088,9 +932,15 @@ _processPayload ( oaCamera* camera, unsigned char* buffer, unsigned int len )
   if ( dropFrame ) {
     pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
     cameraInfo->droppedFrames++;
+    OA_CONTROL_MIRROR_READONLY ( cameraInfo, OA_CAM_CTRL_DROPPED,
+        cameraInfo->droppedFrames );
+    OA_FRAME_STATS_DROPPED ( cameraInfo );
     cameraInfo->receivedBytes = 0;
     pthread_mutex_unlock ( &cameraInfo->callbackQueueMutex );
+    resync = OA_USB_PAYLOAD_RESYNC;
   }
+
+  return resync;
 }
 
 
@@ -1109,12 +959,17 @@ _releaseFrame ( QHY_STATE* cameraInfo )
       cameraInfo->buffers[ nextBuffer ].start;
   cameraInfo->frameCallbacks[ nextBuffer ].bufferLen =
       cameraInfo->frameSize;
+  OA_FRAME_STATS_STAMP ( cameraInfo, nextBuffer, OA_FRAME_STAGE_COPIED );
   pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
+  OA_FRAME_STATS_QUEUED ( cameraInfo, nextBuffer );
   oaDLListAddToTail ( cameraInfo->callbackQueue,
       &cameraInfo->frameCallbacks[ nextBuffer ]);
   cameraInfo->buffersFree--;
   cameraInfo->nextBuffer = ( nextBuffer + 1 ) % cameraInfo->configuredBuffers;
   cameraInfo->receivedBytes = 0;
+  if ( cameraInfo->reserveAhead ) {
+    cameraInfo->reserveAhead--;
+  }
   pthread_mutex_unlock ( &cameraInfo->callbackQueueMutex );
   pthread_cond_broadcast ( &cameraInfo->callbackQueued );
 }
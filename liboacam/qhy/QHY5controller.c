@@ -61,7 +61,8 @@ oacamQHY5controller ( void* param )
   OA_COMMAND*		command;
   int			exitThread = 0;
   int			resultCode, streaming = 0;
-  int			maxWaitTime, frameWait;
+  unsigned int		exposure;
+  struct timespec	exposureEnd;
   int			nextBuffer, buffersFree;
   unsigned int		x, y;
   uint8_t*		s;
@@ -86,7 +87,7 @@ oacamQHY5controller ( void* param )
       pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
     }
     do {
-      command = oaDLListRemoveFromHead ( cameraInfo->commandQueue );
+      command = oacamNextCommand ( cameraInfo );
       if ( command ) {
         switch ( command->commandType ) {
           case OA_CMD_CONTROL_SET:
@@ -110,15 +111,7 @@ oacamQHY5controller ( void* param )
             resultCode = -OA_ERR_INVALID_CONTROL;
             break;
         }
-        if ( command->callback ) {
-					oaLogError ( OA_LOG_CAMERA, "%s: command has callback", __func__ );
-        } else {
-          pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
-          command->completed = 1;
-          command->resultCode = resultCode;
-          pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
-          pthread_cond_broadcast ( &cameraInfo->commandComplete );
-        }
+        oacamCommandComplete ( cameraInfo, command, resultCode );
       }
     } while ( command );
 
@@ -128,13 +121,14 @@ oacamQHY5controller ( void* param )
 
     if ( streaming ) {
       pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
-      maxWaitTime = frameWait = cameraInfo->requestedExposure;
+      exposure = cameraInfo->requestedExposure;
       pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
       _doStartExposure ( cameraInfo );
-      while ( !exitThread && maxWaitTime > 0 ) {
-        usleep ( frameWait );
-        maxWaitTime -= frameWait;
-      }
+      _oaDeadline ( &exposureEnd, exposure );
+      // Commands that arrive mid-exposure wait for the readout, but closing
+      // the camera doesn't have to
+      exitThread = ( _oaControllerWait ( cameraInfo, &exposureEnd, 0 ) ==
+          OA_WAIT_STOP ) ? 1 : 0;
       if ( !exitThread ) {
         if ( !_doReadExposure ( cameraInfo )) {
           pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
@@ -166,6 +160,7 @@ oacamQHY5controller ( void* param )
             cameraInfo->frameCallbacks[ nextBuffer ].bufferLen =
                 cameraInfo->imageBufferLength;
             pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
+            OA_FRAME_STATS_QUEUED ( cameraInfo, nextBuffer );
             oaDLListAddToTail ( cameraInfo->callbackQueue,
                 &cameraInfo->frameCallbacks[ nextBuffer ]);
             cameraInfo->buffersFree--;
@@ -406,6 +401,7 @@ _processStreamingStart ( oaCamera* camera, OA_COMMAND* command )
 {
   QHY_STATE*	cameraInfo = camera->_private;
   CALLBACK*	cb = command->commandData;
+  struct timespec	exposureEnd;
 
   if ( cameraInfo->runMode != CAM_RUN_MODE_STOPPED ) {
     return -OA_ERR_INVALID_COMMAND;
@@ -418,7 +414,8 @@ _processStreamingStart ( oaCamera* camera, OA_COMMAND* command )
   cameraInfo->captureHeight = _doCameraConfig ( cameraInfo, command );
   cameraInfo->captureLength = cameraInfo->captureHeight * QHY5_SENSOR_WIDTH;
   _doStartExposure ( cameraInfo );
-  usleep ( cameraInfo->requestedExposure );
+  _oaDeadline ( &exposureEnd, cameraInfo->requestedExposure );
+  ( void ) _oaControllerWait ( cameraInfo, &exposureEnd, 0 );
   _doReadExposure ( cameraInfo );
   cameraInfo->captureHeight = _doCameraConfig ( cameraInfo, command );
 
@@ -433,8 +430,6 @@ _processStreamingStart ( oaCamera* camera, OA_COMMAND* command )
 static int
 _processStreamingStop ( QHY_STATE* cameraInfo, OA_COMMAND* command )
 {
-  int		queueEmpty;
-
   if ( cameraInfo->runMode != CAM_RUN_MODE_STREAMING ) {
     return -OA_ERR_INVALID_COMMAND;
   }
@@ -447,15 +442,7 @@ _processStreamingStop ( QHY_STATE* cameraInfo, OA_COMMAND* command )
   // close of the camera could rip the image frame out from underneath the
   // callback
 
-  queueEmpty = 0;
-  do {
-    pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
-    queueEmpty = ( OA_CAM_BUFFERS == cameraInfo->buffersFree ) ? 1 : 0;
-    pthread_mutex_unlock ( &cameraInfo->callbackQueueMutex );
-    if ( !queueEmpty ) {
-      usleep ( 10000 );
-    }
-  } while ( !queueEmpty );
+  _oaWaitForBuffers ( cameraInfo, OA_CAM_BUFFERS );
 
   return OA_ERR_NONE;
 }
@@ -499,6 +486,9 @@ _doReadExposure ( QHY_STATE* cameraInfo )
       USB2_TIMEOUT );
   if ( ret ) {
     cameraInfo->droppedFrames++;
+    OA_CONTROL_MIRROR_READONLY ( cameraInfo, OA_CAM_CTRL_DROPPED,
+        cameraInfo->droppedFrames );
+    OA_FRAME_STATS_DROPPED ( cameraInfo );
     return ret;
   }
   if ( readSize != cameraInfo->captureLength ) {
@@ -506,6 +496,9 @@ _doReadExposure ( QHY_STATE* cameraInfo )
 				"%s: readExposure: USB bulk transfer was short. %d != %d", __func__,
         readSize, cameraInfo->captureLength );
     cameraInfo->droppedFrames++;
+    OA_CONTROL_MIRROR_READONLY ( cameraInfo, OA_CAM_CTRL_DROPPED,
+        cameraInfo->droppedFrames );
+    OA_FRAME_STATS_DROPPED ( cameraInfo );
     return -OA_ERR_CAMERA_IO;
   }
   return OA_ERR_NONE;
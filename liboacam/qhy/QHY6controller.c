@@ -61,7 +61,8 @@ oacamQHY6controller ( void* param )
   OA_COMMAND*		command;
   int			exitThread = 0;
   int			resultCode, streaming = 0;
-  int			maxWaitTime, frameWait;
+  unsigned int		exposure;
+  struct timespec	exposureEnd;
   int			nextBuffer, buffersFree, rowBytes;
   unsigned int		i, reorderFrame;
   unsigned char*	evenSrc;
@@ -87,7 +88,7 @@ oacamQHY6controller ( void* param )
       pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
     }
     do {
-      command = oaDLListRemoveFromHead ( cameraInfo->commandQueue );
+      command = oacamNextCommand ( cameraInfo );
       if ( command ) {
         switch ( command->commandType ) {
           case OA_CMD_CONTROL_SET:
@@ -111,15 +112,7 @@ oacamQHY6controller ( void* param )
             resultCode = -OA_ERR_INVALID_CONTROL;
             break;
         }
-        if ( command->callback ) {
-					oaLogError ( OA_LOG_CAMERA, "%s: command has callback", __func__ );
-        } else {
-          pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
-          command->completed = 1;
-          command->resultCode = resultCode;
-          pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
-          pthread_cond_broadcast ( &cameraInfo->commandComplete );
-        }
+        oacamCommandComplete ( cameraInfo, command, resultCode );
       }
     } while ( command );
 
@@ -133,19 +126,14 @@ oacamQHY6controller ( void* param )
       oddSrc = cameraInfo->xferBuffer + cameraInfo->frameSize / 2;
       rowBytes = cameraInfo->xSize * 2;
       reorderFrame = ( OA_BIN_MODE_2x2 == cameraInfo->binMode ) ? 0 : 1;
-      maxWaitTime = frameWait = cameraInfo->currentExposure;
+      exposure = cameraInfo->currentExposure;
       pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
       _doStartExposure ( cameraInfo );
-      if ( frameWait > 1000 ) {
-        frameWait = 1000;
-      }
-      while ( !exitThread && maxWaitTime > 0 ) {
-        usleep ( frameWait );
-        maxWaitTime -= frameWait;
-        pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
-        exitThread = cameraInfo->stopControllerThread;
-        pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
-      }
+      _oaDeadline ( &exposureEnd, exposure );
+      // Commands that arrive mid-exposure wait for the readout, but closing
+      // the camera doesn't have to
+      exitThread = ( _oaControllerWait ( cameraInfo, &exposureEnd, 0 ) ==
+          OA_WAIT_STOP ) ? 1 : 0;
       if ( !exitThread ) {
         if ( !_doReadExposure ( cameraInfo )) {
           pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
@@ -189,6 +177,7 @@ oacamQHY6controller ( void* param )
             cameraInfo->frameCallbacks[ nextBuffer ].bufferLen =
                 cameraInfo->frameSize;
             pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
+            OA_FRAME_STATS_QUEUED ( cameraInfo, nextBuffer );
             oaDLListAddToTail ( cameraInfo->callbackQueue,
                 &cameraInfo->frameCallbacks[ nextBuffer ]);
             cameraInfo->buffersFree--;
@@ -460,8 +449,6 @@ _processStreamingStart ( oaCamera* camera, OA_COMMAND* command )
 static int
 _processStreamingStop ( QHY_STATE* cameraInfo, OA_COMMAND* command )
 {
-  int		queueEmpty;
-
   if ( cameraInfo->runMode != CAM_RUN_MODE_STREAMING ) {
     return -OA_ERR_INVALID_COMMAND;
   }
@@ -474,15 +461,7 @@ _processStreamingStop ( QHY_STATE* cameraInfo, OA_COMMAND* command )
   // close of the camera could rip the image frame out from underneath the
   // callback
 
-  queueEmpty = 0;
-  do {
-    pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
-    queueEmpty = ( OA_CAM_BUFFERS == cameraInfo->buffersFree ) ? 1 : 0;
-    pthread_mutex_unlock ( &cameraInfo->callbackQueueMutex );
-    if ( !queueEmpty ) {
-      usleep ( 10000 );
-    }
-  } while ( !queueEmpty );
+  _oaWaitForBuffers ( cameraInfo, OA_CAM_BUFFERS );
 
   return OA_ERR_NONE;
 }
@@ -514,6 +493,9 @@ _doReadExposure ( QHY_STATE* cameraInfo )
     oaLogError ( OA_LOG_CAMERA,
 				"%s: readExposure: USB bulk transfer failed, err = %d", __func__, ret );
     cameraInfo->droppedFrames++;
+    OA_CONTROL_MIRROR_READONLY ( cameraInfo, OA_CAM_CTRL_DROPPED,
+        cameraInfo->droppedFrames );
+    OA_FRAME_STATS_DROPPED ( cameraInfo );
     return -OA_ERR_CAMERA_IO;
   }
   if ( readSize != expectedSize ) {
@@ -521,6 +503,9 @@ _doReadExposure ( QHY_STATE* cameraInfo )
 				"%s: readExposure: USB bulk transfer was short. %d != %d", __func__,
         readSize, expectedSize );
     cameraInfo->droppedFrames++;
+    OA_CONTROL_MIRROR_READONLY ( cameraInfo, OA_CAM_CTRL_DROPPED,
+        cameraInfo->droppedFrames );
+    OA_FRAME_STATS_DROPPED ( cameraInfo );
     return -OA_ERR_CAMERA_IO;
   }
   return OA_ERR_NONE;
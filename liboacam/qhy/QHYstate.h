@@ -33,6 +33,7 @@
 #include <pthread.h>
 
 #include "sharedState.h"
+#include "usbTransfer.h"
 
 
 typedef struct QHY_STATE {
@@ -48,8 +49,9 @@ typedef struct QHY_STATE {
   // buffering for image transfers
   frameBuffer*     buffers;
   unsigned int          captureLength;
-  struct libusb_transfer* transfers [ QHY_NUM_TRANSFER_BUFS ];
-  uint8_t*		transferBuffers [ QHY_NUM_TRANSFER_BUFS ];
+  USB_TRANSFER_ENGINE	transferEngine;
+  unsigned int		reserveAhead;
+  unsigned int		reserveOffset;
   // camera status
   uint64_t		droppedFrames;
   unsigned int          isColour;
@@ -88,8 +90,6 @@ typedef struct QHY_STATE {
   unsigned int          correctedExposureTime;
   // thread management
   pthread_mutex_t       usbMutex;
-  pthread_t		eventHandler;
-  pthread_mutex_t	videoCallbackMutex;
 } QHY_STATE;
 
 #endif	/* OA_QHY_STATE_H */
@@ -202,3 +202,49 @@ qhyStatusCallback ( struct libusb_transfer* transfer )
   }
   return;
 }
+
+
+/**
+ * Reserve callback for the shared transfer engine.  Hands out the next
+ * "length" bytes of the frame buffers as the stream should fill them,
+ * as long as the frame buffer concerned is free and the transfer won't
+ * run off the end of the frame.  Otherwise the transfer is staged and
+ * copied into place when it completes.
+ */
+
+unsigned char*
+_qhyReserveFrameSpace ( void* arg, unsigned int length, int restart,
+    uint64_t pending )
+{
+  oaCamera*		camera = arg;
+  QHY_STATE*		cameraInfo = camera->_private;
+  unsigned int		buffersFree, slot;
+  unsigned char*	space = 0;
+
+  if ( restart ) {
+    pending += cameraInfo->receivedBytes;
+    cameraInfo->reserveAhead = pending / cameraInfo->captureLength;
+    cameraInfo->reserveOffset = pending % cameraInfo->captureLength;
+  }
+
+  pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
+  buffersFree = cameraInfo->buffersFree;
+  pthread_mutex_unlock ( &cameraInfo->callbackQueueMutex );
+
+  if ( cameraInfo->reserveAhead < buffersFree && cameraInfo->reserveOffset +
+      length <= cameraInfo->captureLength ) {
+    slot = ( cameraInfo->nextBuffer + cameraInfo->reserveAhead ) %
+        cameraInfo->configuredBuffers;
+    space = ( unsigned char* ) cameraInfo->buffers[ slot ].start +
+        cameraInfo->reserveOffset;
+  }
+
+  // The stream moves on whether the transfer is direct or not
+  cameraInfo->reserveOffset += length;
+  while ( cameraInfo->reserveOffset >= cameraInfo->captureLength ) {
+    cameraInfo->reserveOffset -= cameraInfo->captureLength;
+    cameraInfo->reserveAhead++;
+  }
+
+  return space;
+}
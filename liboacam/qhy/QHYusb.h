@@ -36,6 +36,8 @@ extern int            _i2cWrite16 ( QHY_STATE*, unsigned short,
 extern unsigned short _i2cRead16 ( QHY_STATE*, unsigned short );
 extern int            _i2cWriteIMX035 ( QHY_STATE*, unsigned char,
                           unsigned char );
+extern unsigned char* _qhyReserveFrameSpace ( void*, unsigned int, int,
+                          uint64_t );
 
 
 #define QHY_CMD_CLEAR_FEATURE	0x01
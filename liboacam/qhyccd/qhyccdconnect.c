@@ -485,6 +485,7 @@ oaQHYCCDInitCamera ( oaCameraDevice* device )
     cameraInfo->stopControllerThread = 1;
     pthread_cond_broadcast ( &cameraInfo->commandQueued );
     pthread_join ( cameraInfo->controllerThread, &dummy );
+		oacamAbortTimer ( cameraInfo );
     for ( j = 0; j < OA_CAM_BUFFERS; j++ ) {
       free (( void* ) cameraInfo->buffers[j].start );
       cameraInfo->buffers[j].start = 0;
@@ -539,6 +540,7 @@ oaQHYCCDCloseCamera ( oaCamera* camera )
     cameraInfo->stopControllerThread = 1;
     pthread_cond_broadcast ( &cameraInfo->commandQueued );
     pthread_join ( cameraInfo->controllerThread, &dummy );
+		oacamAbortTimer ( cameraInfo );
   
     cameraInfo->stopCallbackThread = 1;
     pthread_cond_broadcast ( &cameraInfo->callbackQueued );
@@ -546,6 +548,7 @@ oaQHYCCDCloseCamera ( oaCamera* camera )
 
     ( p_CloseQHYCCD ) ( cameraInfo->handle );
 
+    oacamFlushAsync ( cameraInfo );
     oaDLListDelete ( cameraInfo->commandQueue, 1 );
     oaDLListDelete ( cameraInfo->callbackQueue, 0 );
 
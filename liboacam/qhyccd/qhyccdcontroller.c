@@ -82,7 +82,7 @@ oacamQHYCCDcontroller ( void* param )
       pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
     }
     do {
-      command = oaDLListRemoveFromHead ( cameraInfo->commandQueue );
+      command = oacamNextCommand ( cameraInfo );
       if ( command ) {
         switch ( command->commandType ) {
           case OA_CMD_CONTROL_SET:
@@ -115,14 +115,7 @@ oacamQHYCCDcontroller ( void* param )
             resultCode = -OA_ERR_INVALID_CONTROL;
             break;
         }
-        if ( command->callback ) {
-        } else {
-          pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
-          command->completed = 1;
-          command->resultCode = resultCode;
-          pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
-          pthread_cond_broadcast ( &cameraInfo->commandComplete );
-        }
+        oacamCommandComplete ( cameraInfo, command, resultCode );
       }
     } while ( command );
 
@@ -174,9 +167,10 @@ oacamQHYCCDcontroller ( void* param )
 								cameraInfo->buffers[ nextBuffer ].start;
 						cameraInfo->frameCallbacks[ nextBuffer ].bufferLen =
 								imageBufferLength;
+						pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
+						OA_FRAME_STATS_QUEUED ( cameraInfo, nextBuffer );
 						oaDLListAddToTail ( cameraInfo->callbackQueue,
 								&cameraInfo->frameCallbacks[ nextBuffer ]);
-						pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
 						cameraInfo->buffersFree--;
 						cameraInfo->nextBuffer = ( nextBuffer + 1 ) %
 								cameraInfo->configuredBuffers;
@@ -677,9 +671,10 @@ _timerCallback ( void* param )
         cameraInfo->buffers[ nextBuffer ].start;
     cameraInfo->frameCallbacks[ nextBuffer ].bufferLen =
         cameraInfo->imageBufferLength;
+    pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
+    OA_FRAME_STATS_QUEUED ( cameraInfo, nextBuffer );
     oaDLListAddToTail ( cameraInfo->callbackQueue,
         &cameraInfo->frameCallbacks[ nextBuffer ]);
-    pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
     cameraInfo->buffersFree--;
     cameraInfo->nextBuffer = ( nextBuffer + 1 ) %
         cameraInfo->configuredBuffers;
@@ -0,0 +1,297 @@
+/*****************************************************************************
+ *
+ * session.c -- running several cameras together
+ *
+ * Copyright 2026 James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <oa_common.h>
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <openastro/camera.h>
+#include <openastro/util.h>
+
+#include "oacamprivate.h"
+#include "frameStats.h"
+
+
+typedef struct SESSION_CAMERA {
+	struct oaCameraSession*	session;
+	oaCamera*								camera;
+	unsigned int						index;
+	oaSessionCallback				callback;
+	void*										callbackArg;
+	uint64_t								sequence;
+	pthread_mutex_t					mutex;
+	pthread_cond_t					idle;
+	int											active;
+	unsigned int						inCallback;
+} SESSION_CAMERA;
+
+struct oaCameraSession {
+	pthread_mutex_t					mutex;
+	SESSION_CAMERA*					cameras[ OA_SESSION_MAX_CAMERAS ];
+	unsigned int						numCameras;
+	uint64_t								epoch;
+	int											running;
+};
+
+static void*	_oaSessionFrame ( void*, void*, int, void* );
+static void		_oaSessionStopCameras ( oaCameraSession*, unsigned int );
+
+
+oaCameraSession*
+oaSessionCreate ( void )
+{
+	oaCameraSession*	session;
+
+	if (!( session = calloc ( 1, sizeof ( oaCameraSession )))) {
+		oaLogError ( OA_LOG_CAMERA, "%s: malloc failed", __func__ );
+		return 0;
+	}
+	pthread_mutex_init ( &session->mutex, 0 );
+	return session;
+}
+
+
+int
+oaSessionAddCamera ( oaCameraSession* session, oaCamera* camera,
+		oaSessionCallback callback, void* callbackArg )
+{
+	SESSION_CAMERA*		member;
+	unsigned int			i;
+	int								ret;
+
+	if ( !session || !camera || !callback ) {
+		return -OA_ERR_INVALID_COMMAND;
+	}
+
+	pthread_mutex_lock ( &session->mutex );
+	if ( session->running ) {
+		pthread_mutex_unlock ( &session->mutex );
+		oaLogError ( OA_LOG_CAMERA, "%s: session is running", __func__ );
+		return -OA_ERR_INVALID_COMMAND;
+	}
+	for ( i = 0; i < session->numCameras; i++ ) {
+		if ( session->cameras[i]->camera == camera ) {
+			pthread_mutex_unlock ( &session->mutex );
+			oaLogError ( OA_LOG_CAMERA, "%s: camera is already in the session",
+					__func__ );
+			return -OA_ERR_INVALID_COMMAND;
+		}
+	}
+	if ( session->numCameras == OA_SESSION_MAX_CAMERAS ) {
+		pthread_mutex_unlock ( &session->mutex );
+		oaLogError ( OA_LOG_CAMERA, "%s: session is full", __func__ );
+		return -OA_ERR_OUT_OF_RANGE;
+	}
+	if (!( member = calloc ( 1, sizeof ( SESSION_CAMERA )))) {
+		pthread_mutex_unlock ( &session->mutex );
+		oaLogError ( OA_LOG_CAMERA, "%s: malloc failed", __func__ );
+		return -OA_ERR_MEM_ALLOC;
+	}
+	member->session = session;
+	member->camera = camera;
+	member->callback = callback;
+	member->callbackArg = callbackArg;
+	pthread_mutex_init ( &member->mutex, 0 );
+	pthread_cond_init ( &member->idle, 0 );
+	ret = member->index = session->numCameras;
+	session->cameras[ session->numCameras++ ] = member;
+	pthread_mutex_unlock ( &session->mutex );
+
+	return ret;
+}
+
+
+/**
+ * The clock is started before any camera so that nothing can arrive with
+ * a timestamp from before the session began
+ */
+
+int
+oaSessionStart ( oaCameraSession* session )
+{
+	SESSION_CAMERA*		member;
+	unsigned int			i;
+	int								ret = OA_ERR_NONE;
+
+	pthread_mutex_lock ( &session->mutex );
+	if ( session->running ) {
+		pthread_mutex_unlock ( &session->mutex );
+		return OA_ERR_NONE;
+	}
+
+	session->epoch = _oaMonotonicTime();
+	for ( i = 0; i < session->numCameras; i++ ) {
+		member = session->cameras[i];
+		pthread_mutex_lock ( &member->mutex );
+		member->sequence = 0;
+		member->active = 1;
+		pthread_mutex_unlock ( &member->mutex );
+		if (( ret = member->camera->funcs.startStreaming ( member->camera,
+				_oaSessionFrame, member )) != OA_ERR_NONE ) {
+			oaLogError ( OA_LOG_CAMERA, "%s: camera %u (%s) failed to start, "
+					"error %d", __func__, i, member->camera->deviceName, ret );
+			_oaSessionStopCameras ( session, i + 1 );
+			break;
+		}
+	}
+	session->running = ( ret == OA_ERR_NONE );
+	pthread_mutex_unlock ( &session->mutex );
+
+	return ret;
+}
+
+
+int
+oaSessionStop ( oaCameraSession* session )
+{
+	pthread_mutex_lock ( &session->mutex );
+	if ( session->running ) {
+		_oaSessionStopCameras ( session, session->numCameras );
+		session->running = 0;
+	}
+	pthread_mutex_unlock ( &session->mutex );
+
+	return OA_ERR_NONE;
+}
+
+
+uint64_t
+oaSessionTime ( oaCameraSession* session )
+{
+	uint64_t		t = 0;
+
+	pthread_mutex_lock ( &session->mutex );
+	if ( session->running ) {
+		t = _oaMonotonicTime() - session->epoch;
+	}
+	pthread_mutex_unlock ( &session->mutex );
+
+	return t;
+}
+
+
+void
+oaSessionFree ( oaCameraSession* session )
+{
+	SESSION_CAMERA*		member;
+	unsigned int			i;
+
+	if ( !session ) {
+		return;
+	}
+
+	( void ) oaSessionStop ( session );
+	for ( i = 0; i < session->numCameras; i++ ) {
+		member = session->cameras[i];
+		pthread_mutex_destroy ( &member->mutex );
+		pthread_cond_destroy ( &member->idle );
+		free (( void* ) member );
+	}
+	pthread_mutex_destroy ( &session->mutex );
+	free (( void* ) session );
+}
+
+
+/**
+ * Stop the first count cameras in the session.  Each one stops accepting
+ * frames before it is told to stop streaming and isn't considered stopped
+ * until any callback it is in the middle of has returned, so the caller
+ * knows no more session callbacks will be made once this returns.  Must be
+ * called with the session locked
+ */
+
+static void
+_oaSessionStopCameras ( oaCameraSession* session, unsigned int count )
+{
+	SESSION_CAMERA*		member;
+	unsigned int			i;
+	int								err;
+
+	for ( i = 0; i < count; i++ ) {
+		member = session->cameras[i];
+		pthread_mutex_lock ( &member->mutex );
+		member->active = 0;
+		pthread_mutex_unlock ( &member->mutex );
+		if ( member->camera->funcs.isStreaming ( member->camera ) &&
+				( err = member->camera->funcs.stopStreaming ( member->camera )) !=
+				OA_ERR_NONE ) {
+			oaLogWarning ( OA_LOG_CAMERA, "%s: camera %u failed to stop, error %d",
+					__func__, i, err );
+		}
+		pthread_mutex_lock ( &member->mutex );
+		while ( member->inCallback ) {
+			pthread_cond_wait ( &member->idle, &member->mutex );
+		}
+		pthread_mutex_unlock ( &member->mutex );
+	}
+}
+
+
+/**
+ * Runs on each camera's own callback thread, so the only lock taken is
+ * the camera's own.  The driver's readout timestamp is used if there is
+ * one as it's much closer to the actual exposure than the time the frame
+ * reaches the callback.
+ */
+
+static void*
+_oaSessionFrame ( void* arg, void* buffer, int length, void* metadata )
+{
+	SESSION_CAMERA*		member = arg;
+	FRAME_METADATA*		frameData = metadata;
+	oaSessionFrame		frame;
+	uint64_t					t, epoch;
+
+	if ( frameData && frameData->timestampValid ) {
+		t = frameData->timestamp.monotonic;
+	} else {
+		t = _oaMonotonicTime();
+	}
+
+	pthread_mutex_lock ( &member->mutex );
+	if ( !member->active ) {
+		pthread_mutex_unlock ( &member->mutex );
+		return 0;
+	}
+	member->inCallback++;
+	frame.sequence = member->sequence++;
+	pthread_mutex_unlock ( &member->mutex );
+
+	epoch = member->session->epoch;
+	frame.cameraIndex = member->index;
+	frame.sessionTime = t > epoch ? t - epoch : 0;
+	frame.metadata = frameData;
+	( void ) member->callback ( member->callbackArg, buffer, length, &frame );
+
+	pthread_mutex_lock ( &member->mutex );
+	if ( !--member->inCallback ) {
+		pthread_cond_broadcast ( &member->idle );
+	}
+	pthread_mutex_unlock ( &member->mutex );
+
+	return 0;
+}
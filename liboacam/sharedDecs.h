@@ -37,20 +37,20 @@
   pthread_mutex_t		commandQueueMutex;
   pthread_cond_t		commandComplete;
   pthread_cond_t		commandQueued;
+  int								controllerEventFd;
   int								stopControllerThread;
   pthread_t					callbackThread;
   pthread_mutex_t		callbackQueueMutex;
   pthread_cond_t		callbackQueued;
   CALLBACK					frameCallbacks[ OA_CAM_BUFFERS ];
   int								stopCallbackThread;
-	pthread_t					timerThread;
-	pthread_cond_t		timerState;
-	pthread_mutex_t		timerMutex;
-	struct timespec		timerEnd;
+	uint64_t					timerDeadline;
+	unsigned int			timerSlot;
 	void							( *timerCallback )( void* );
 	int								timerActive;
   // queues for controls and callbacks
   DL_LIST						commandQueue;
+	struct ASYNC_COMMAND*	asyncPending;
   DL_LIST						callbackQueue;
   // streaming
   CALLBACK					streamingCallback;
@@ -69,5 +69,12 @@
 	// common camera settings
   unsigned int			xSize;
   unsigned int			ySize;
+	uint64_t					softROI;			// x << 32 | y, zero if off
+	int								softBinning;	// factor | flags << 8, zero if off
+	// per-frame timing
+	FRAME_STATS				frameStats;
+	FRAME_METADATA		frameMetadata[ OA_CAM_BUFFERS ];
+	// last known control values
+	CONTROL_MIRROR		controlMirror;
 
 	// END OF COMMON DATA
@@ -32,6 +32,9 @@
 
 #include <openastro/camera.h>
 
+#include "frameStats.h"
+#include "controlMirror.h"
+
 
 typedef struct FRAME_BUFFER {
 	void*			start;
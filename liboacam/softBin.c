@@ -0,0 +1,541 @@
+/*****************************************************************************
+ *
+ * softBin.c -- software binning of frames before the callback
+ *
+ * Copyright 2026 James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <oa_common.h>
+
+#include <stdint.h>
+
+#include <openastro/camera.h>
+#include <openastro/util.h>
+#include <openastro/video/formats.h>
+
+#include "oacamprivate.h"
+#include "sharedState.h"
+
+
+typedef struct SOFT_BIN_FORMAT {
+	int							format;
+	int							bytes;
+	int							bigEndian;
+	const char*			cfa;
+} SOFT_BIN_FORMAT;
+
+static const SOFT_BIN_FORMAT	_formats[] = {
+	{ OA_PIX_FMT_GREY8, 1, 0, 0 },
+	{ OA_PIX_FMT_GREY16LE, 2, 0, 0 },
+	{ OA_PIX_FMT_GREY16BE, 2, 1, 0 },
+	{ OA_PIX_FMT_GREY10_16LE, 2, 0, 0 },
+	{ OA_PIX_FMT_GREY10_16BE, 2, 1, 0 },
+	{ OA_PIX_FMT_GREY12_16LE, 2, 0, 0 },
+	{ OA_PIX_FMT_GREY12_16BE, 2, 1, 0 },
+	{ OA_PIX_FMT_GREY14_16LE, 2, 0, 0 },
+	{ OA_PIX_FMT_GREY14_16BE, 2, 1, 0 },
+	{ OA_PIX_FMT_BGGR8, 1, 0, "BGGR" },
+	{ OA_PIX_FMT_RGGB8, 1, 0, "RGGB" },
+	{ OA_PIX_FMT_GBRG8, 1, 0, "GBRG" },
+	{ OA_PIX_FMT_GRBG8, 1, 0, "GRBG" },
+	{ OA_PIX_FMT_BGGR16LE, 2, 0, "BGGR" },
+	{ OA_PIX_FMT_BGGR16BE, 2, 1, "BGGR" },
+	{ OA_PIX_FMT_RGGB16LE, 2, 0, "RGGB" },
+	{ OA_PIX_FMT_RGGB16BE, 2, 1, "RGGB" },
+	{ OA_PIX_FMT_GBRG16LE, 2, 0, "GBRG" },
+	{ OA_PIX_FMT_GBRG16BE, 2, 1, "GBRG" },
+	{ OA_PIX_FMT_GRBG16LE, 2, 0, "GRBG" },
+	{ OA_PIX_FMT_GRBG16BE, 2, 1, "GRBG" },
+	{ OA_PIX_FMT_BGGR10_16LE, 2, 0, "BGGR" },
+	{ OA_PIX_FMT_BGGR10_16BE, 2, 1, "BGGR" },
+	{ OA_PIX_FMT_RGGB10_16LE, 2, 0, "RGGB" },
+	{ OA_PIX_FMT_RGGB10_16BE, 2, 1, "RGGB" },
+	{ OA_PIX_FMT_GBRG10_16LE, 2, 0, "GBRG" },
+	{ OA_PIX_FMT_GBRG10_16BE, 2, 1, "GBRG" },
+	{ OA_PIX_FMT_GRBG10_16LE, 2, 0, "GRBG" },
+	{ OA_PIX_FMT_GRBG10_16BE, 2, 1, "GRBG" },
+	{ OA_PIX_FMT_BGGR12_16LE, 2, 0, "BGGR" },
+	{ OA_PIX_FMT_BGGR12_16BE, 2, 1, "BGGR" },
+	{ OA_PIX_FMT_RGGB12_16LE, 2, 0, "RGGB" },
+	{ OA_PIX_FMT_RGGB12_16BE, 2, 1, "RGGB" },
+	{ OA_PIX_FMT_GBRG12_16LE, 2, 0, "GBRG" },
+	{ OA_PIX_FMT_GBRG12_16BE, 2, 1, "GBRG" },
+	{ OA_PIX_FMT_GRBG12_16LE, 2, 0, "GRBG" },
+	{ OA_PIX_FMT_GRBG12_16BE, 2, 1, "GRBG" },
+	{ OA_PIX_FMT_BGGR14_16LE, 2, 0, "BGGR" },
+	{ OA_PIX_FMT_BGGR14_16BE, 2, 1, "BGGR" },
+	{ OA_PIX_FMT_RGGB14_16LE, 2, 0, "RGGB" },
+	{ OA_PIX_FMT_RGGB14_16BE, 2, 1, "RGGB" },
+	{ OA_PIX_FMT_GBRG14_16LE, 2, 0, "GBRG" },
+	{ OA_PIX_FMT_GBRG14_16BE, 2, 1, "GBRG" },
+	{ OA_PIX_FMT_GRBG14_16LE, 2, 0, "GRBG" },
+	{ OA_PIX_FMT_GRBG14_16BE, 2, 1, "GRBG" },
+	{ 0, 0, 0, 0 }
+};
+
+static const SOFT_BIN_FORMAT*	_findFormat ( int );
+static int			_binnedFrame ( oaCamera*, unsigned int, unsigned int, int,
+										const SOFT_BIN_FORMAT**, int*, unsigned int*,
+										unsigned int* );
+static void			_binMono ( const SOFT_BIN_FORMAT*, const unsigned char*,
+										unsigned char*, uint32_t*, unsigned int, unsigned int,
+										int, int );
+static void			_binSuperPixel ( const SOFT_BIN_FORMAT*, const unsigned char*,
+										unsigned char*, uint32_t*, unsigned int, unsigned int,
+										int, int );
+
+
+/**
+ * Turn software binning on or off.  A factor of 1 turns it off.  The
+ * change takes effect from the next frame handed to the callback thread.
+ */
+
+int
+oaSetSoftwareBinning ( oaCamera* camera, int factor, int flags )
+{
+	SHARED_STATE*		cameraInfo;
+
+	if ( !camera ) {
+		return -OA_ERR_INVALID_CAMERA;
+	}
+	if ( factor < 1 || factor > OA_SOFT_BIN_MAX_FACTOR ) {
+		oaLogError ( OA_LOG_CAMERA, "%s: invalid binning factor %d", __func__,
+				factor );
+		return -OA_ERR_OUT_OF_RANGE;
+	}
+	if ( flags & ~( OA_SOFT_BIN_SUM | OA_SOFT_BIN_MONO )) {
+		oaLogError ( OA_LOG_CAMERA, "%s: invalid binning flags 0x%x", __func__,
+				flags );
+		return -OA_ERR_OUT_OF_RANGE;
+	}
+
+	cameraInfo = camera->_private;
+	__atomic_store_n ( &cameraInfo->softBinning,
+			factor > 1 ? ( factor | ( flags << 8 )) : 0, __ATOMIC_RELEASE );
+	return OA_ERR_NONE;
+}
+
+
+/**
+ * Describe the frames the callback will be given with the current
+ * binning setting, frame format and frame size (after any software ROI).
+ * If the frames can't be binned the unbinned format and size are returned
+ * along with -OA_ERR_INVALID_BIT_DEPTH.
+ */
+
+int
+oaGetSoftwareBinnedFormat ( oaCamera* camera, int* format,
+		unsigned int* xSize, unsigned int* ySize )
+{
+	SHARED_STATE*						cameraInfo;
+	const SOFT_BIN_FORMAT*	fmt;
+	unsigned int						frameX, frameY;
+	int											setting;
+
+	if ( !camera ) {
+		return -OA_ERR_INVALID_CAMERA;
+	}
+	cameraInfo = camera->_private;
+	setting = __atomic_load_n ( &cameraInfo->softBinning, __ATOMIC_ACQUIRE );
+	_oaSoftROISize ( camera, &frameX, &frameY );
+	if ( _binnedFrame ( camera, frameX, frameY, setting, &fmt, format, xSize,
+			ySize ) < 0 ) {
+		*format = camera->funcs.getFramePixelFormat ( camera );
+		*xSize = frameX;
+		*ySize = frameY;
+		return setting ? -OA_ERR_INVALID_BIT_DEPTH : OA_ERR_NONE;
+	}
+	return OA_ERR_NONE;
+}
+
+
+/**
+ * Bin a frame of xSize x ySize pixels if binning is enabled and the frame
+ * is one we can handle, replacing *frame and *length with the binned
+ * frame.  Anything else (a frame of the wrong size because the resolution
+ * changed underneath us, for example) goes through untouched.
+ */
+
+void
+_oaSoftBinFrame ( oaCamera* camera, unsigned int xSize, unsigned int ySize,
+		void** frame, int* length )
+{
+	SHARED_STATE*						cameraInfo = camera->_private;
+	const SOFT_BIN_FORMAT*	fmt;
+	unsigned char*					out;
+	uint32_t*								acc;
+	unsigned int						outX, outY;
+	size_t									outSize;
+	int											setting, factor, outFormat, superPixel;
+
+	if (!( setting = __atomic_load_n ( &cameraInfo->softBinning,
+			__ATOMIC_ACQUIRE ))) {
+		return;
+	}
+	if (( superPixel = _binnedFrame ( camera, xSize, ySize, setting, &fmt,
+			&outFormat, &outX, &outY )) < 0 ) {
+		return;
+	}
+	if (( size_t ) *length != ( size_t ) xSize * ySize * fmt->bytes ) {
+		return;
+	}
+	factor = setting & 0xff;
+	outSize = ( size_t ) outX * outY * fmt->bytes * ( superPixel ? 3 : 1 );
+
+	if (!( out = _oaFrameScratch ( OA_SCRATCH_BIN, outSize )) ||
+			!( acc = _oaFrameScratch ( OA_SCRATCH_BIN_ROW, ( size_t ) outX *
+			( superPixel ? 3 : 1 ) * sizeof ( uint32_t )))) {
+		return;
+	}
+
+	if ( superPixel ) {
+		_binSuperPixel ( fmt, *frame, out, acc, xSize, ySize, factor,
+				setting >> 8 );
+	} else {
+		_binMono ( fmt, *frame, out, acc, xSize, ySize, factor, setting >> 8 );
+	}
+	*frame = out;
+	*length = outSize;
+}
+
+
+static const SOFT_BIN_FORMAT*
+_findFormat ( int format )
+{
+	const SOFT_BIN_FORMAT*	fmt;
+
+	for ( fmt = _formats; fmt->format; fmt++ ) {
+		if ( fmt->format == format ) {
+			return fmt;
+		}
+	}
+	return 0;
+}
+
+
+/**
+ * Work out what the current frames will look like binned.  Returns 1 for
+ * colour super-pixel output, 0 for mono and -1 if the frames can't be
+ * binned.
+ */
+
+static int
+_binnedFrame ( oaCamera* camera, unsigned int frameX, unsigned int frameY,
+		int setting, const SOFT_BIN_FORMAT** fmt, int* format,
+		unsigned int* xSize, unsigned int* ySize )
+{
+	int			factor = setting & 0xff;
+	int			flags = setting >> 8;
+	int			superPixel;
+
+	if ( factor < 2 ) {
+		return -1;
+	}
+	if (!( *fmt = _findFormat ( camera->funcs.getFramePixelFormat ( camera )))) {
+		return -1;
+	}
+	if ( frameX < ( unsigned int ) factor || frameY < ( unsigned int ) factor ) {
+		return -1;
+	}
+
+	superPixel = ( *fmt )->cfa && !( flags & OA_SOFT_BIN_MONO ) &&
+			!( factor & 1 );
+	if ( superPixel ) {
+		*format = ( *fmt )->bytes == 1 ? OA_PIX_FMT_RGB24 :
+				( *fmt )->bigEndian ? OA_PIX_FMT_RGB48BE : OA_PIX_FMT_RGB48LE;
+	} else {
+		*format = ( *fmt )->bytes == 1 ? OA_PIX_FMT_GREY8 :
+				( *fmt )->bigEndian ? OA_PIX_FMT_GREY16BE : OA_PIX_FMT_GREY16LE;
+	}
+	*xSize = frameX / factor;
+	*ySize = frameY / factor;
+	return superPixel;
+}
+
+
+// The row kernels are written so that the compiler can vectorise them
+// once the factor is known, hence the switch on the factor in the callers
+// rather than passing it straight through.
+
+static inline __attribute__(( always_inline )) void
+_sumRow8 ( const uint8_t* in, uint32_t* acc, unsigned int width, int factor )
+{
+	unsigned int		x;
+	int							k;
+	uint32_t				s;
+
+	for ( x = 0; x < width; x++ ) {
+		s = 0;
+		for ( k = 0; k < factor; k++ ) {
+			s += in[ x * factor + k ];
+		}
+		acc[x] += s;
+	}
+}
+
+
+static inline __attribute__(( always_inline )) void
+_sumRow16 ( const uint16_t* in, uint32_t* acc, unsigned int width,
+		int factor, int swap )
+{
+	unsigned int		x;
+	int							k;
+	uint32_t				s;
+
+	if ( swap ) {
+		for ( x = 0; x < width; x++ ) {
+			s = 0;
+			for ( k = 0; k < factor; k++ ) {
+				s += __builtin_bswap16 ( in[ x * factor + k ] );
+			}
+			acc[x] += s;
+		}
+	} else {
+		for ( x = 0; x < width; x++ ) {
+			s = 0;
+			for ( k = 0; k < factor; k++ ) {
+				s += in[ x * factor + k ];
+			}
+			acc[x] += s;
+		}
+	}
+}
+
+
+// For colour each row of the block alternates between two colours, c0 in
+// the even columns and c1 in the odd ones, which are summed separately
+// into the three accumulators for each output pixel
+
+static inline __attribute__(( always_inline )) void
+_sumCFARow8 ( const uint8_t* in, uint32_t* acc, unsigned int width,
+		int factor, int c0, int c1 )
+{
+	unsigned int		x;
+	int							k;
+	uint32_t				s0, s1;
+
+	for ( x = 0; x < width; x++ ) {
+		s0 = s1 = 0;
+		for ( k = 0; k < factor; k += 2 ) {
+			s0 += in[ x * factor + k ];
+			s1 += in[ x * factor + k + 1 ];
+		}
+		acc[ x * 3 + c0 ] += s0;
+		acc[ x * 3 + c1 ] += s1;
+	}
+}
+
+
+static inline __attribute__(( always_inline )) void
+_sumCFARow16 ( const uint16_t* in, uint32_t* acc, unsigned int width,
+		int factor, int c0, int c1, int swap )
+{
+	unsigned int		x;
+	int							k;
+	uint32_t				s0, s1;
+
+	for ( x = 0; x < width; x++ ) {
+		s0 = s1 = 0;
+		for ( k = 0; k < factor; k += 2 ) {
+			if ( swap ) {
+				s0 += __builtin_bswap16 ( in[ x * factor + k ] );
+				s1 += __builtin_bswap16 ( in[ x * factor + k + 1 ] );
+			} else {
+				s0 += in[ x * factor + k ];
+				s1 += in[ x * factor + k + 1 ];
+			}
+		}
+		acc[ x * 3 + c0 ] += s0;
+		acc[ x * 3 + c1 ] += s1;
+	}
+}
+
+
+static void
+_sumRow ( const SOFT_BIN_FORMAT* fmt, const unsigned char* in, uint32_t* acc,
+		unsigned int width, int factor )
+{
+	if ( fmt->bytes == 1 ) {
+		switch ( factor ) {
+			case 2:
+				_sumRow8 ( in, acc, width, 2 );
+				break;
+			case 3:
+				_sumRow8 ( in, acc, width, 3 );
+				break;
+			default:
+				_sumRow8 ( in, acc, width, 4 );
+				break;
+		}
+	} else {
+		switch ( factor ) {
+			case 2:
+				_sumRow16 (( const uint16_t* ) in, acc, width, 2, fmt->bigEndian );
+				break;
+			case 3:
+				_sumRow16 (( const uint16_t* ) in, acc, width, 3, fmt->bigEndian );
+				break;
+			default:
+				_sumRow16 (( const uint16_t* ) in, acc, width, 4, fmt->bigEndian );
+				break;
+		}
+	}
+}
+
+
+static void
+_sumCFARow ( const SOFT_BIN_FORMAT* fmt, const unsigned char* in,
+		uint32_t* acc, unsigned int width, int factor, int c0, int c1 )
+{
+	if ( fmt->bytes == 1 ) {
+		if ( factor == 2 ) {
+			_sumCFARow8 ( in, acc, width, 2, c0, c1 );
+		} else {
+			_sumCFARow8 ( in, acc, width, 4, c0, c1 );
+		}
+	} else {
+		if ( factor == 2 ) {
+			_sumCFARow16 (( const uint16_t* ) in, acc, width, 2, c0, c1,
+					fmt->bigEndian );
+		} else {
+			_sumCFARow16 (( const uint16_t* ) in, acc, width, 4, c0, c1,
+					fmt->bigEndian );
+		}
+	}
+}
+
+
+/**
+ * Write out the accumulated values for a row of pixels, each divided by
+ * its sample count (rounding to nearest) and clipped to the range of the
+ * output.  The division is done as a multiplication by the reciprocal,
+ * which is exact for any total a block of four by four samples can make.
+ */
+
+static void
+_storeRow ( const SOFT_BIN_FORMAT* fmt, const uint32_t* acc,
+		unsigned char* out, unsigned int pixels, int channels,
+		const uint32_t* divisor )
+{
+	unsigned int		i;
+	uint64_t				recip[3];
+	uint32_t				v, max;
+	uint16_t*				out16 = ( uint16_t* ) out;
+	int							c;
+
+	for ( c = 0; c < channels; c++ ) {
+		recip[c] = (( 1ULL << 32 ) + divisor[c] - 1 ) / divisor[c];
+	}
+	max = fmt->bytes == 1 ? 0xff : 0xffff;
+	for ( i = 0; i < pixels; i++ ) {
+		for ( c = 0; c < channels; c++ ) {
+			v = (( uint64_t )( *acc + divisor[c] / 2 ) * recip[c] ) >> 32;
+			acc++;
+			if ( v > max ) {
+				v = max;
+			}
+			if ( fmt->bytes == 1 ) {
+				*out++ = v;
+			} else {
+				*out16++ = fmt->bigEndian ? __builtin_bswap16 ( v ) : v;
+			}
+		}
+	}
+}
+
+
+static void
+_binMono ( const SOFT_BIN_FORMAT* fmt, const unsigned char* in,
+		unsigned char* out, uint32_t* acc, unsigned int xSize,
+		unsigned int ySize, int factor, int flags )
+{
+	unsigned int		outX = xSize / factor;
+	unsigned int		outY = ySize / factor;
+	unsigned int		x, y;
+	size_t					rowBytes = ( size_t ) xSize * fmt->bytes;
+	uint32_t				divisor;
+	int							r;
+
+	divisor = ( flags & OA_SOFT_BIN_SUM ) ? 1 : factor * factor;
+
+	for ( y = 0; y < outY; y++ ) {
+		for ( x = 0; x < outX; x++ ) {
+			acc[x] = 0;
+		}
+		for ( r = 0; r < factor; r++ ) {
+			_sumRow ( fmt, in + ( y * factor + r ) * rowBytes, acc, outX, factor );
+		}
+		_storeRow ( fmt, acc, out + ( size_t ) y * outX * fmt->bytes, outX, 1,
+				&divisor );
+	}
+}
+
+
+static int
+_colour ( char c )
+{
+	return c == 'R' ? 0 : c == 'G' ? 1 : 2;
+}
+
+
+/**
+ * Each factor x factor block of colour filter data becomes one RGB pixel.
+ * There are twice as many green samples as red or blue in each block, so
+ * when summing the green total is halved to keep the colours balanced.
+ */
+
+static void
+_binSuperPixel ( const SOFT_BIN_FORMAT* fmt, const unsigned char* in,
+		unsigned char* out, uint32_t* acc, unsigned int xSize,
+		unsigned int ySize, int factor, int flags )
+{
+	unsigned int		outX = xSize / factor;
+	unsigned int		outY = ySize / factor;
+	unsigned int		x, y;
+	size_t					rowBytes = ( size_t ) xSize * fmt->bytes;
+	uint32_t				divisor[3];
+	uint32_t				samples = ( factor / 2 ) * ( factor / 2 );
+	int							r, colour[2][2];
+
+	for ( r = 0; r < 4; r++ ) {
+		colour[ r >> 1 ][ r & 1 ] = _colour ( fmt->cfa[r] );
+	}
+	if ( flags & OA_SOFT_BIN_SUM ) {
+		divisor[0] = divisor[2] = 1;
+		divisor[1] = 2;
+	} else {
+		divisor[0] = divisor[2] = samples;
+		divisor[1] = samples * 2;
+	}
+
+	for ( y = 0; y < outY; y++ ) {
+		for ( x = 0; x < outX * 3; x++ ) {
+			acc[x] = 0;
+		}
+		for ( r = 0; r < factor; r++ ) {
+			_sumCFARow ( fmt, in + ( y * factor + r ) * rowBytes, acc, outX,
+					factor, colour[ r & 1 ][0], colour[ r & 1 ][1] );
+		}
+		_storeRow ( fmt, acc, out + ( size_t ) y * outX * 3 * fmt->bytes,
+				outX, 3, divisor );
+	}
+}
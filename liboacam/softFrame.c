@@ -0,0 +1,310 @@
+/*****************************************************************************
+ *
+ * softFrame.c -- software ROI and per-frame processing before the callback
+ *
+ * Copyright 2026 James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <oa_common.h>
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <openastro/camera.h>
+#include <openastro/util.h>
+#include <openastro/video/formats.h>
+
+#include "oacamprivate.h"
+#include "sharedState.h"
+
+
+// Frames processed in software are written to buffers belonging to the
+// thread running the callbacks, so they go when the camera is closed and
+// that thread exits without any help from the driver
+
+typedef struct FRAME_SCRATCH {
+	void*						buffer[ OA_SCRATCH_SLOTS ];
+	size_t					size[ OA_SCRATCH_SLOTS ];
+} FRAME_SCRATCH;
+
+static pthread_once_t		_scratchOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t		_scratchKey;
+
+static void			_createScratchKey ( void );
+static void			_freeScratch ( void* );
+static int			_cropGeometry ( oaCamera*, unsigned int*, unsigned int*,
+										unsigned int*, unsigned int*, unsigned int* );
+static void			_cropFrame ( oaCamera*, unsigned int*, unsigned int*, void**,
+										int* );
+
+
+/**
+ * Called by the driver callback threads just before a frame is handed to
+ * the user's callback.  The frame is cropped to any software ROI and then
+ * binned if software binning is enabled.  *frame and *length are replaced
+ * with the result, which stays valid until the next call from the same
+ * thread.
+ */
+
+void
+_oaSoftwareFrame ( oaCamera* camera, void** frame, int* length,
+		void* metadata )
+{
+	SHARED_STATE*			cameraInfo = camera->_private;
+	FRAME_METADATA*		frameMetadata = metadata;
+	unsigned int			xSize = cameraInfo->xSize;
+	unsigned int			ySize = cameraInfo->ySize;
+	void*							original = *frame;
+
+	_cropFrame ( camera, &xSize, &ySize, frame, length );
+	_oaSoftBinFrame ( camera, xSize, ySize, frame, length );
+
+	// the data is no longer the whole of the driver's buffer
+	if ( *frame != original && frameMetadata ) {
+		frameMetadata->dmabufValid = 0;
+	}
+}
+
+
+/**
+ * Return a buffer of at least size bytes for the calling thread, growing
+ * it if need be.  The contents are kept between calls.
+ */
+
+void*
+_oaFrameScratch ( int slot, size_t size )
+{
+	FRAME_SCRATCH*	scratch;
+	void*						p;
+
+	pthread_once ( &_scratchOnce, _createScratchKey );
+	if (!( scratch = pthread_getspecific ( _scratchKey ))) {
+		if (!( scratch = calloc ( 1, sizeof ( FRAME_SCRATCH )))) {
+			oaLogError ( OA_LOG_CAMERA, "%s: scratch allocation failed", __func__ );
+			return 0;
+		}
+		pthread_setspecific ( _scratchKey, scratch );
+	}
+	if ( scratch->size[ slot ] < size ) {
+		if (!( p = realloc ( scratch->buffer[ slot ], size ))) {
+			oaLogError ( OA_LOG_CAMERA, "%s: allocation of %lu bytes failed",
+					__func__, ( unsigned long ) size );
+			return 0;
+		}
+		scratch->buffer[ slot ] = p;
+		scratch->size[ slot ] = size;
+	}
+	return scratch->buffer[ slot ];
+}
+
+
+static void
+_createScratchKey ( void )
+{
+	pthread_key_create ( &_scratchKey, _freeScratch );
+}
+
+
+static void
+_freeScratch ( void* p )
+{
+	FRAME_SCRATCH*	scratch = p;
+	int							i;
+
+	for ( i = 0; i < OA_SCRATCH_SLOTS; i++ ) {
+		free ( scratch->buffer[i] );
+	}
+	free ( p );
+}
+
+
+/**
+ * Cameras that can't set an ROI themselves, and leave setROI() to the
+ * library, get one in software instead
+ */
+
+int
+oaHasSoftwareROI ( oaCamera* camera )
+{
+	if ( !camera ) {
+		return 0;
+	}
+	return ( camera->features.flags & OA_CAM_FEATURE_ROI ) ? 0 :
+			( camera->funcs.setROI == oacamSetROI );
+}
+
+
+/**
+ * Set a software ROI, centred in the frame the camera delivers.  As for
+ * hardware ROI the size must be even (to keep colour filter data intact)
+ * and no larger than the current resolution.  Setting the ROI to the full
+ * frame or changing the resolution turns it off again.
+ */
+
+int
+_oaSoftwareSetROI ( oaCamera* camera, int x, int y )
+{
+	SHARED_STATE*		cameraInfo = camera->_private;
+	uint64_t				roi;
+
+	if ( x <= 0 || y <= 0 || ( x % 2 ) || ( y % 2 ) ||
+			( unsigned int ) x > cameraInfo->xSize ||
+			( unsigned int ) y > cameraInfo->ySize ) {
+		oaLogError ( OA_LOG_CAMERA, "%s: invalid ROI %dx%d for %ux%u frame",
+				__func__, x, y, cameraInfo->xSize, cameraInfo->ySize );
+		return -OA_ERR_INVALID_SIZE;
+	}
+
+	if (( unsigned int ) x == cameraInfo->xSize &&
+			( unsigned int ) y == cameraInfo->ySize ) {
+		roi = 0;
+	} else {
+		roi = (( uint64_t ) x << 32 ) | ( unsigned int ) y;
+	}
+	__atomic_store_n ( &cameraInfo->softROI, roi, __ATOMIC_RELEASE );
+	return OA_ERR_NONE;
+}
+
+
+int
+_oaSoftwareTestROISize ( oaCamera* camera, unsigned int tryX,
+		unsigned int tryY, unsigned int* suggX, unsigned int* suggY )
+{
+	SHARED_STATE*		cameraInfo = camera->_private;
+
+	if ( tryX && tryY && !( tryX % 2 ) && !( tryY % 2 ) &&
+			tryX <= cameraInfo->xSize && tryY <= cameraInfo->ySize ) {
+		return OA_ERR_NONE;
+	}
+
+	*suggX = tryX > cameraInfo->xSize ? cameraInfo->xSize : tryX;
+	*suggY = tryY > cameraInfo->ySize ? cameraInfo->ySize : tryY;
+	*suggX &= ~1U;
+	*suggY &= ~1U;
+	if ( !*suggX ) {
+		*suggX = 2;
+	}
+	if ( !*suggY ) {
+		*suggY = 2;
+	}
+	return -OA_ERR_INVALID_SIZE;
+}
+
+
+/**
+ * The size of frame the callback will see after any software ROI, but
+ * before binning
+ */
+
+void
+_oaSoftROISize ( oaCamera* camera, unsigned int* xSize, unsigned int* ySize )
+{
+	unsigned int		x0, y0, bytes;
+
+	if ( _cropGeometry ( camera, xSize, ySize, &x0, &y0, &bytes ) < 0 ) {
+		SHARED_STATE*		cameraInfo = camera->_private;
+
+		*xSize = cameraInfo->xSize;
+		*ySize = cameraInfo->ySize;
+	}
+}
+
+
+/**
+ * Work out the size and offset of the software ROI within the current
+ * frame.  Offsets are kept even so the colour filter pattern of the
+ * cropped frame is the same as the original.  Returns -1 if there's no
+ * ROI or the current frame format can't be cropped.
+ */
+
+static int
+_cropGeometry ( oaCamera* camera, unsigned int* xSize, unsigned int* ySize,
+		unsigned int* x0, unsigned int* y0, unsigned int* bytes )
+{
+	SHARED_STATE*		cameraInfo = camera->_private;
+	uint64_t				roi;
+	int							format;
+
+	if (!( roi = __atomic_load_n ( &cameraInfo->softROI, __ATOMIC_ACQUIRE ))) {
+		return -1;
+	}
+	*xSize = roi >> 32;
+	*ySize = roi & 0xffffffff;
+	if ( *xSize > cameraInfo->xSize || *ySize > cameraInfo->ySize ) {
+		return -1;
+	}
+
+	format = camera->funcs.getFramePixelFormat ( camera );
+	if ( format <= 0 || format >= OA_PIX_FMT_LAST_P1 ||
+			oaFrameFormats[ format ].planar || oaFrameFormats[ format ].packed ||
+			oaFrameFormats[ format ].bytesPerPixel < 1 ||
+			oaFrameFormats[ format ].bytesPerPixel !=
+			( unsigned int ) oaFrameFormats[ format ].bytesPerPixel ) {
+		return -1;
+	}
+	*bytes = oaFrameFormats[ format ].bytesPerPixel;
+	*x0 = (( cameraInfo->xSize - *xSize ) / 2 ) & ~1U;
+	*y0 = (( cameraInfo->ySize - *ySize ) / 2 ) & ~1U;
+	return 0;
+}
+
+
+/**
+ * Crop a frame to the software ROI.  Only the ROI is copied.  If it is
+ * the full width of the frame no copy is needed at all.
+ */
+
+static void
+_cropFrame ( oaCamera* camera, unsigned int* xSize,
+		unsigned int* ySize, void** frame, int* length )
+{
+	SHARED_STATE*		cameraInfo = camera->_private;
+	const unsigned char*	in;
+	unsigned char*	out;
+	unsigned int		cropX, cropY, x0, y0, bytes, row;
+	size_t					stride, rowBytes;
+
+	if ( _cropGeometry ( camera, &cropX, &cropY, &x0, &y0, &bytes ) < 0 ) {
+		return;
+	}
+	stride = ( size_t ) cameraInfo->xSize * bytes;
+	if (( size_t ) *length != stride * cameraInfo->ySize ) {
+		return;
+	}
+	rowBytes = ( size_t ) cropX * bytes;
+	in = ( const unsigned char* ) *frame + y0 * stride + x0 * bytes;
+
+	if ( cropX == cameraInfo->xSize ) {
+		*frame = ( void* ) in;
+	} else {
+		if (!( out = _oaFrameScratch ( OA_SCRATCH_ROI, rowBytes * cropY ))) {
+			return;
+		}
+		for ( row = 0; row < cropY; row++ ) {
+			memcpy ( out + row * rowBytes, in + row * stride, rowBytes );
+		}
+		*frame = out;
+	}
+	*length = rowBytes * cropY;
+	*xSize = cropX;
+	*ySize = cropY;
+}
@@ -3893,6 +3893,7 @@ oaSpinCloseCamera ( oaCamera* camera )
 			}
 		}
 
+    oacamFlushAsync ( cameraInfo );
     oaDLListDelete ( cameraInfo->commandQueue, 1 );
     oaDLListDelete ( cameraInfo->callbackQueue, 0 );
 
@@ -860,6 +860,7 @@ oaSVBInitCamera ( oaCameraDevice* device )
     cameraInfo->stopControllerThread = 1;
     pthread_cond_broadcast ( &cameraInfo->commandQueued );
     pthread_join ( cameraInfo->controllerThread, &dummy );
+		oacamAbortTimer ( cameraInfo );
 
     for ( i = 0; i < OA_CAM_BUFFERS; i++ ) {
       free (( void* ) cameraInfo->buffers[i].start );
@@ -917,6 +918,7 @@ oaSVBCloseCamera ( oaCamera* camera )
     cameraInfo->stopControllerThread = 1;
     pthread_cond_broadcast ( &cameraInfo->commandQueued );
     pthread_join ( cameraInfo->controllerThread, &dummy );
+		oacamAbortTimer ( cameraInfo );
 
     cameraInfo->stopCallbackThread = 1;
     pthread_cond_broadcast ( &cameraInfo->callbackQueued );
@@ -936,6 +938,7 @@ oaSVBCloseCamera ( oaCamera* camera )
         free (( void* ) cameraInfo->frameSizes[j].sizes );
     }
 
+    oacamFlushAsync ( cameraInfo );
     oaDLListDelete ( cameraInfo->commandQueue, 1 );
     oaDLListDelete ( cameraInfo->callbackQueue, 0 );
 
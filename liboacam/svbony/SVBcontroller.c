@@ -81,7 +81,7 @@ oacamSVBcontroller ( void* param )
     }
 
     do {
-      command = oaDLListRemoveFromHead ( cameraInfo->commandQueue );
+      command = oacamNextCommand ( cameraInfo );
       if ( command ) {
         switch ( command->commandType ) {
           case OA_CMD_CONTROL_SET:
@@ -111,15 +111,7 @@ oacamSVBcontroller ( void* param )
             resultCode = -OA_ERR_INVALID_CONTROL;
             break;
         }
-        if ( command->callback ) {
-					oaLogWarning ( OA_LOG_CAMERA, "%s: command has callback", __func__ );
-        } else {
-          pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
-          command->completed = 1;
-          command->resultCode = resultCode;
-          pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
-          pthread_cond_broadcast ( &cameraInfo->commandComplete );
-        }
+        oacamCommandComplete ( cameraInfo, command, resultCode );
       }
     } while ( command );
 
@@ -171,9 +163,10 @@ oacamSVBcontroller ( void* param )
                 cameraInfo->buffers[ nextBuffer ].start;
             cameraInfo->frameCallbacks[ nextBuffer ].bufferLen =
                 imageBufferLength;
+            pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
+            OA_FRAME_STATS_QUEUED ( cameraInfo, nextBuffer );
             oaDLListAddToTail ( cameraInfo->callbackQueue,
                 &cameraInfo->frameCallbacks[ nextBuffer ]);
-            pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
             cameraInfo->buffersFree--;
             cameraInfo->nextBuffer = ( nextBuffer + 1 ) %
                 cameraInfo->configuredBuffers;
@@ -941,7 +934,6 @@ _timerCallback ( void* param )
 	int									ret, buffersFree, nextBuffer;
 	SVB_EXPOSURE_STATUS	status;
 
-retry:
 	if (( ret = p_SVBGetExpStatus ( cameraInfo->cameraId, &status )) < 0 ) {
 		oaLogError ( OA_LOG_CAMERA, "%s: SVBGetExpStatus failed, error %d",
 				__func__, ret );
@@ -953,9 +945,10 @@ retry:
 
 	if ( status != SVB_EXP_SUCCESS ) {
 		if ( status == SVB_EXP_WORKING ) {
-			// FIX ME -- busy waiting here is pretty ugly :(
-			usleep(100000);
-			goto retry;
+			// not finished yet, so check again shortly rather than holding up
+			// the timer thread
+			oacamStartTimer ( 100000, cameraInfo );
+			return;
 		}
 		oaLogWarning ( OA_LOG_CAMERA, "%s: SVBGetExpStatus returned status %d",
 				__func__, status );
@@ -993,9 +986,10 @@ retry:
         cameraInfo->buffers[ nextBuffer ].start;
     cameraInfo->frameCallbacks[ nextBuffer ].bufferLen =
         cameraInfo->imageBufferLength;
+    pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
+    OA_FRAME_STATS_QUEUED ( cameraInfo, nextBuffer );
     oaDLListAddToTail ( cameraInfo->callbackQueue,
         &cameraInfo->frameCallbacks[ nextBuffer ]);
-    pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
     cameraInfo->buffersFree--;
     cameraInfo->nextBuffer = ( nextBuffer + 1 ) %
         cameraInfo->configuredBuffers;
@@ -88,7 +88,7 @@ oacamSXcontroller ( void* param )
       pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
     }
     do {
-      command = oaDLListRemoveFromHead ( cameraInfo->commandQueue );
+      command = oacamNextCommand ( cameraInfo );
       if ( command ) {
         switch ( command->commandType ) {
           case OA_CMD_CONTROL_SET:
@@ -113,16 +113,7 @@ oacamSXcontroller ( void* param )
             resultCode = -OA_ERR_INVALID_CONTROL;
             break;
         }
-        if ( command->callback ) {
-					oaLogWarning ( OA_LOG_CAMERA, "%s: CONT: command has callback",
-							__func__ );
-        } else {
-          pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
-          command->completed = 1;
-          command->resultCode = resultCode;
-          pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
-          pthread_cond_broadcast ( &cameraInfo->commandComplete );
-        }
+        oacamCommandComplete ( cameraInfo, command, resultCode );
       }
     } while ( command );
 
@@ -152,6 +143,8 @@ oacamSXcontroller ( void* param )
           pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
           if ( buffersFree && streaming ) {
             nextBuffer = cameraInfo->nextBuffer;
+            OA_FRAME_STATS_STAMP ( cameraInfo, nextBuffer,
+                OA_FRAME_STAGE_READOUT );
             if ( cameraInfo->isInterlaced ) {
 							if ( OA_BIN_MODE_NONE == cameraInfo->binMode ) {
 								rowLength = cameraInfo->xImageSize * cameraInfo->bytesPerPixel;
@@ -174,6 +167,8 @@ oacamSXcontroller ( void* param )
 										cameraInfo->xferBuffer, cameraInfo->actualImageLength );
 							}
 						}
+            OA_FRAME_STATS_STAMP ( cameraInfo, nextBuffer,
+                OA_FRAME_STAGE_COPIED );
             cameraInfo->frameCallbacks[ nextBuffer ].callbackType =
                 OA_CALLBACK_NEW_FRAME;
             cameraInfo->frameCallbacks[ nextBuffer ].callback =
@@ -185,6 +180,7 @@ oacamSXcontroller ( void* param )
             cameraInfo->frameCallbacks[ nextBuffer ].bufferLen =
 								cameraInfo->actualImageLength;
             pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
+            OA_FRAME_STATS_QUEUED ( cameraInfo, nextBuffer );
             oaDLListAddToTail ( cameraInfo->callbackQueue,
                 &cameraInfo->frameCallbacks[ nextBuffer ]);
             cameraInfo->buffersFree--;
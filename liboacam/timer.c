@@ -2,7 +2,7 @@
  *
  * timer.c -- camera library timer
  *
- * Copyright 2019
+ * Copyright 2019,2026
  *   James Fidell (james@openastroproject.org)
  *
  * License:
@@ -36,70 +36,298 @@
 #include "sharedState.h"
 
 
-void*		_oacamTimerThread ( void* param );
+/*
+ * All cameras share one timer thread, started the first time a timer is
+ * needed and left running until the process exits.  Each camera can have
+ * at most one timer pending, so the camera state itself is the handle and
+ * pending timers are kept in a binary min-heap ordered by their deadline on
+ * the monotonic clock, making starting and aborting a timer O(log n).
+ * Callbacks are made from the timer thread without the timer lock held, so
+ * they may restart their own timer, but they should not block for long as
+ * all other cameras' timers will be held up until they return.
+ */
+
+#define	TIMER_HEAP_INITIAL_SIZE		16
+
+typedef struct {
+	pthread_mutex_t		mutex;
+	pthread_cond_t		changed;
+	pthread_cond_t		callbackDone;
+	pthread_t					thread;
+	int								started;
+	SHARED_STATE**		heap;
+	unsigned int			heapSize;
+	unsigned int			numTimers;
+	SHARED_STATE*			running;
+} TIMER_SERVICE;
+
+static TIMER_SERVICE		timerService = {
+	.mutex = PTHREAD_MUTEX_INITIALIZER,
+	.callbackDone = PTHREAD_COND_INITIALIZER
+};
+static pthread_once_t		timerInitOnce = PTHREAD_ONCE_INIT;
+
+static void		_timerServiceInit ( void );
+static void*	_timerThread ( void* );
+static void		_timerWait ( uint64_t );
+static void		_heapSwap ( unsigned int, unsigned int );
+static void		_heapUp ( unsigned int );
+static void		_heapDown ( unsigned int );
+static void		_heapRemove ( SHARED_STATE* );
 
 
 int
 oacamStartTimer ( uint64_t delayusec, void* param )
 {
 	SHARED_STATE*		cameraInfo = param;
-	struct timeval	now;
-	uint64_t				delaySec;
-	uint64_t				nanoSecs;
-	uint64_t				delayNanoSecs;
-
-	gettimeofday ( &now, 0 );
-	delaySec = delayusec / 1000000;
-	nanoSecs = ( delayusec - delaySec * 1000000 ) * 1000;
-	cameraInfo->timerEnd.tv_sec = now.tv_sec + delaySec;
-	delayNanoSecs = now.tv_usec * 1000 + nanoSecs;
-	if ( delayNanoSecs > 1000000000 ) {
-		cameraInfo->timerEnd.tv_sec++;
-		delayNanoSecs -= 1000000000;
+	SHARED_STATE**	newHeap;
+	unsigned int		newSize;
+
+	pthread_once ( &timerInitOnce, _timerServiceInit );
+	if ( !timerService.started ) {
+		return -OA_ERR_SYSTEM_ERROR;
 	}
-	cameraInfo->timerEnd.tv_nsec = delayNanoSecs;
 
-	if ( !cameraInfo->stopControllerThread ) {
-		if ( pthread_create ( &( cameraInfo->timerThread ), 0, _oacamTimerThread,
-				( void* ) cameraInfo )) {
-			return -OA_ERR_SYSTEM_ERROR;
+	pthread_mutex_lock ( &timerService.mutex );
+	if ( cameraInfo->stopControllerThread ) {
+		pthread_mutex_unlock ( &timerService.mutex );
+		return OA_ERR_NONE;
+	}
+
+	cameraInfo->timerDeadline = _oaMonotonicTime() + delayusec * 1000;
+	if ( cameraInfo->timerActive ) {
+		// already queued, so just move it to its new place
+		_heapUp ( cameraInfo->timerSlot );
+		_heapDown ( cameraInfo->timerSlot );
+	} else {
+		if ( timerService.numTimers == timerService.heapSize ) {
+			newSize = timerService.heapSize ? timerService.heapSize * 2 :
+					TIMER_HEAP_INITIAL_SIZE;
+			if (!( newHeap = realloc ( timerService.heap, newSize *
+					sizeof ( SHARED_STATE* )))) {
+				pthread_mutex_unlock ( &timerService.mutex );
+				oaLogError ( OA_LOG_CAMERA, "%s: timer heap allocation failed",
+						__func__ );
+				return -OA_ERR_MEM_ALLOC;
+			}
+			timerService.heap = newHeap;
+			timerService.heapSize = newSize;
 		}
+		cameraInfo->timerSlot = timerService.numTimers++;
+		timerService.heap[ cameraInfo->timerSlot ] = cameraInfo;
 		cameraInfo->timerActive = 1;
+		_heapUp ( cameraInfo->timerSlot );
 	}
 
+	if ( timerService.heap[0] == cameraInfo ) {
+		pthread_cond_signal ( &timerService.changed );
+	}
+	pthread_mutex_unlock ( &timerService.mutex );
+
 	return OA_ERR_NONE;
 }
 
 
-void*
-_oacamTimerThread ( void* param )
+/**
+ * Cancel any pending timer for the camera.  If the camera's callback is
+ * running at the time this waits for it to finish (unless called from the
+ * callback itself), so once it returns the callback will not be called
+ * again until the timer is restarted.  Callers must not hold any lock the
+ * callback might take.
+ */
+
+void
+oacamAbortTimer ( void* param )
 {
 	SHARED_STATE*		cameraInfo = param;
-	int							ret;
-
-	pthread_mutex_lock ( &( cameraInfo->timerMutex ));
-	ret = pthread_cond_timedwait ( &( cameraInfo->timerState ),
-			&( cameraInfo->timerMutex ), &( cameraInfo->timerEnd ));
-	pthread_mutex_unlock ( &( cameraInfo->timerMutex ));
-
-	if ( ret ) {
-		if ( ret == ETIMEDOUT && !cameraInfo->stopControllerThread ) {
-			cameraInfo->timerCallback ( cameraInfo );
-		} else {
-			oaLogError ( OA_LOG_CAMERA, "%s: timer condition failed with error %d",
-					__func__, ret );
+
+	pthread_mutex_lock ( &timerService.mutex );
+	if ( timerService.started &&
+			!pthread_equal ( pthread_self(), timerService.thread )) {
+		while ( timerService.running == cameraInfo ) {
+			pthread_cond_wait ( &timerService.callbackDone, &timerService.mutex );
 		}
 	}
+	if ( cameraInfo->timerActive ) {
+		_heapRemove ( cameraInfo );
+	}
+	pthread_mutex_unlock ( &timerService.mutex );
+}
+
+
+/**
+ * Return the number of microseconds until the camera's most recently
+ * started timer expires, or zero if it already has.
+ */
+
+uint64_t
+oacamTimerRemaining ( void* param )
+{
+	SHARED_STATE*		cameraInfo = param;
+	uint64_t				now, deadline;
+
+	pthread_mutex_lock ( &timerService.mutex );
+	deadline = cameraInfo->timerDeadline;
+	pthread_mutex_unlock ( &timerService.mutex );
+
+	now = _oaMonotonicTime();
+	return ( deadline > now ) ? ( deadline - now ) / 1000 : 0;
+}
+
+
+static void
+_timerServiceInit ( void )
+{
+#if HAVE_PTHREAD_CONDATTR_SETCLOCK && defined(CLOCK_MONOTONIC)
+	pthread_condattr_t	attr;
+
+	pthread_condattr_init ( &attr );
+	pthread_condattr_setclock ( &attr, CLOCK_MONOTONIC );
+	pthread_cond_init ( &timerService.changed, &attr );
+	pthread_condattr_destroy ( &attr );
+#else
+	pthread_cond_init ( &timerService.changed, 0 );
+#endif
+
+	if ( pthread_create ( &timerService.thread, 0, _timerThread, 0 )) {
+		oaLogError ( OA_LOG_CAMERA, "%s: failed to start timer thread",
+				__func__ );
+		return;
+	}
+	pthread_detach ( timerService.thread );
+	timerService.started = 1;
+}
+
+
+static void*
+_timerThread ( void* param )
+{
+	SHARED_STATE*		cameraInfo;
+	uint64_t				now;
+
+	pthread_mutex_lock ( &timerService.mutex );
+	while ( 1 ) {
+		if ( !timerService.numTimers ) {
+			pthread_cond_wait ( &timerService.changed, &timerService.mutex );
+			continue;
+		}
+		cameraInfo = timerService.heap[0];
+		now = _oaMonotonicTime();
+		if ( cameraInfo->timerDeadline > now ) {
+			_timerWait ( cameraInfo->timerDeadline );
+			continue;
+		}
+
+		_heapRemove ( cameraInfo );
+		if ( cameraInfo->stopControllerThread ) {
+			continue;
+		}
+		timerService.running = cameraInfo;
+		pthread_mutex_unlock ( &timerService.mutex );
+
+		cameraInfo->timerCallback ( cameraInfo );
+
+		pthread_mutex_lock ( &timerService.mutex );
+		timerService.running = 0;
+		pthread_cond_broadcast ( &timerService.callbackDone );
+	}
 
-	cameraInfo->timerActive = 0;
 	return 0;
 }
 
 
-void
-oacamAbortTimer ( void* param )
+/**
+ * Wait on the "changed" condition until the given monotonic deadline.  If
+ * the condition variable can't be told to use the monotonic clock the
+ * deadline is converted to one on the realtime clock, which is good enough
+ * as the caller rechecks the monotonic time whenever this returns.
+ */
+
+static void
+_timerWait ( uint64_t deadline )
 {
-	SHARED_STATE*		cameraInfo = param;
+	struct timespec		end;
+
+#if HAVE_PTHREAD_CONDATTR_SETCLOCK && defined(CLOCK_MONOTONIC)
+	end.tv_sec = deadline / 1000000000;
+	end.tv_nsec = deadline % 1000000000;
+#else
+	uint64_t					delay = deadline - _oaMonotonicTime();
+
+	_oaDeadline ( &end, delay / 1000 + 1 );
+#endif
+	( void ) pthread_cond_timedwait ( &timerService.changed,
+			&timerService.mutex, &end );
+}
+
+
+static void
+_heapSwap ( unsigned int a, unsigned int b )
+{
+	SHARED_STATE*		t = timerService.heap[a];
+
+	timerService.heap[a] = timerService.heap[b];
+	timerService.heap[b] = t;
+	timerService.heap[a]->timerSlot = a;
+	timerService.heap[b]->timerSlot = b;
+}
+
+
+static void
+_heapUp ( unsigned int slot )
+{
+	unsigned int		parent;
 
-	pthread_cond_signal ( &( cameraInfo->timerState ));
+	while ( slot ) {
+		parent = ( slot - 1 ) / 2;
+		if ( timerService.heap[ parent ]->timerDeadline <=
+				timerService.heap[ slot ]->timerDeadline ) {
+			break;
+		}
+		_heapSwap ( slot, parent );
+		slot = parent;
+	}
+}
+
+
+static void
+_heapDown ( unsigned int slot )
+{
+	unsigned int		child, smallest;
+
+	while ( 1 ) {
+		smallest = slot;
+		child = slot * 2 + 1;
+		if ( child < timerService.numTimers &&
+				timerService.heap[ child ]->timerDeadline <
+				timerService.heap[ smallest ]->timerDeadline ) {
+			smallest = child;
+		}
+		child++;
+		if ( child < timerService.numTimers &&
+				timerService.heap[ child ]->timerDeadline <
+				timerService.heap[ smallest ]->timerDeadline ) {
+			smallest = child;
+		}
+		if ( smallest == slot ) {
+			return;
+		}
+		_heapSwap ( slot, smallest );
+		slot = smallest;
+	}
+}
+
+
+static void
+_heapRemove ( SHARED_STATE* cameraInfo )
+{
+	unsigned int		slot = cameraInfo->timerSlot;
+
+	timerService.numTimers--;
+	if ( slot != timerService.numTimers ) {
+		_heapSwap ( slot, timerService.numTimers );
+		_heapUp ( slot );
+		_heapDown ( slot );
+	}
+	cameraInfo->timerActive = 0;
 }
@@ -834,18 +834,15 @@ TT_FUNC( oa, CloseCamera )( oaCamera* camera )
     cameraInfo->stopControllerThread = 1;
     pthread_cond_broadcast ( &cameraInfo->commandQueued );
     pthread_join ( cameraInfo->controllerThread, &dummy );
+		oacamAbortTimer ( cameraInfo );
   
     cameraInfo->stopCallbackThread = 1;
     pthread_cond_broadcast ( &cameraInfo->callbackQueued );
     pthread_join ( cameraInfo->callbackThread, &dummy );
 
-		if ( cameraInfo->timerActive ) {
-			pthread_cond_signal ( &( cameraInfo->timerState ));
-			pthread_join ( cameraInfo->timerThread, &dummy );
-		}
-
     ( TT_LIB_PTR( Close )) ( cameraInfo->handle );
 
+    oacamFlushAsync ( cameraInfo );
     oaDLListDelete ( cameraInfo->commandQueue, 1 );
     oaDLListDelete ( cameraInfo->callbackQueue, 0 );
 
@@ -137,7 +137,7 @@ TT_FUNC( oacam, controller )( void* param )
       pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
     }
     do {
-      command = oaDLListRemoveFromHead ( cameraInfo->commandQueue );
+      command = oacamNextCommand ( cameraInfo );
       if ( command ) {
         switch ( command->commandType ) {
           case OA_CMD_CONTROL_SET:
@@ -170,14 +170,7 @@ TT_FUNC( oacam, controller )( void* param )
             resultCode = -OA_ERR_INVALID_CONTROL;
             break;
         }
-        if ( command->callback ) {
-        } else {
-          pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
-          command->completed = 1;
-          command->resultCode = resultCode;
-          pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
-          pthread_cond_broadcast ( &cameraInfo->commandComplete );
-        }
+        oacamCommandComplete ( cameraInfo, command, resultCode );
       }
     } while ( command );
   } while ( !exitThread );
@@ -1337,6 +1330,7 @@ _completeCallback ( TOUPTEK_STATE* cameraInfo, const void* frame,
 			cameraInfo->buffers[ nextBuffer ].start;
 	cameraInfo->frameCallbacks[ nextBuffer ].bufferLen = dataLength;
 	pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
+	OA_FRAME_STATS_QUEUED ( cameraInfo, nextBuffer );
 	oaDLListAddToTail ( cameraInfo->callbackQueue,
 			&cameraInfo->frameCallbacks[ nextBuffer ]);
 	cameraInfo->buffersFree--;
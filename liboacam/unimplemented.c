@@ -141,6 +141,9 @@ static int
 _testROISize ( oaCamera* camera, unsigned int tx, unsigned int ty,
     unsigned int* sxp, unsigned int *syp )
 {
+  if ( oaHasSoftwareROI ( camera )) {
+    return _oaSoftwareTestROISize ( camera, tx, ty, sxp, syp );
+  }
   oaLogError ( OA_LOG_CAMERA, "%s: not implemented for %s", __func__,
       camera->deviceName );
   return -OA_ERR_UNIMPLEMENTED;
@@ -205,6 +208,8 @@ _oaInitCameraFunctionPointers ( oaCamera* camera )
 
   camera->funcs.readControl = oacamReadControl;
   camera->funcs.setControl = oacamSetControl;
+  camera->funcs.setControlAsync = oacamSetControlAsync;
+  camera->funcs.setControls = oacamSetControls;
   camera->funcs.testControl = _testControl;
   camera->funcs.getControlRange = _getControlRange;
   camera->funcs.getControlDiscreteSet = _getControlDiscreteSet;
@@ -223,6 +228,7 @@ _oaInitCameraFunctionPointers ( oaCamera* camera )
 */
   camera->funcs.hasAuto = oacamHasAuto;
   camera->funcs.isAuto = _isAuto;
+  camera->funcs.setControlMaxAge = oacamSetControlMaxAge;
 /*
   camera->funcs.setControlMulti = _setControlMulti;
 */
@@ -0,0 +1,644 @@
+/*****************************************************************************
+ *
+ * usbTransfer.c -- shared asynchronous libusb transfer engine
+ *
+ * Copyright 2026 James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <oa_common.h>
+
+#include <pthread.h>
+#include <sys/time.h>
+
+#include <openastro/camera.h>
+#include <openastro/errno.h>
+#include <openastro/util.h>
+
+#include "usbTransfer.h"
+
+/*
+ * Each transfer is either "direct", in which case its buffer is a region
+ * of a frame buffer handed out by the driver's reserve callback, or
+ * "staged", in which case it has a buffer of its own and the payload
+ * callback copies the data out.  The reserve callback hands out regions
+ * in stream order on the assumption that every transfer will come back
+ * full, so a short transfer (or a payload callback that has dropped what
+ * it had) means the data from transfers already in flight will belong
+ * somewhere earlier than the place it lands.  It can always be moved
+ * there safely, because nothing still in flight is writing anywhere
+ * earlier than itself, but until every direct transfer submitted before
+ * the problem has come back the engine uses staging buffers for new
+ * submissions.  After that the driver is asked to restart its reservations
+ * from wherever it has got to, plus whatever is still in flight.
+ */
+
+typedef struct USB_EVENT_THREAD {
+	libusb_context*		context;
+	unsigned int			refs;
+	int								stop;
+	pthread_t					thread;
+	struct USB_EVENT_THREAD*	next;
+} USB_EVENT_THREAD;
+
+static USB_EVENT_THREAD*	_eventThreads = 0;
+static pthread_mutex_t		_eventThreadMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int		_submit ( USB_TRANSFER* );
+static void*	_eventHandler ( void* );
+
+static int		_libusbAlloc ( USB_TRANSFER* );
+static void		_libusbRelease ( USB_TRANSFER* );
+static int		_libusbSubmit ( USB_TRANSFER* );
+static int		_libusbCancel ( USB_TRANSFER* );
+static void LIBUSB_CALL	_libusbCallback ( struct libusb_transfer* );
+
+static int		_mockAlloc ( USB_TRANSFER* );
+static void		_mockRelease ( USB_TRANSFER* );
+static int		_mockSubmit ( USB_TRANSFER* );
+static int		_mockCancel ( USB_TRANSFER* );
+
+const USB_TRANSPORT	oaUSBLibusbTransport = {
+	_libusbAlloc, _libusbRelease, _libusbSubmit, _libusbCancel
+};
+
+const USB_TRANSPORT	oaUSBMockTransport = {
+	_mockAlloc, _mockRelease, _mockSubmit, _mockCancel
+};
+
+
+int
+_oaUSBTransferInit ( USB_TRANSFER_ENGINE* engine,
+		const USB_TRANSPORT* transport, libusb_device_handle* usbHandle,
+		unsigned char endpoint, unsigned int timeout, USB_PAYLOAD_FN payload,
+		USB_RESERVE_FN reserve, void* callbackArg )
+{
+	memset ( engine, 0, sizeof ( USB_TRANSFER_ENGINE ));
+
+	if ( !transport || !payload ) {
+		oaLogError ( OA_LOG_CAMERA, "%s: transport and payload are required",
+				__func__ );
+		return -OA_ERR_INVALID_COMMAND;
+	}
+
+	engine->transport = transport;
+	engine->usbHandle = usbHandle;
+	engine->endpoint = endpoint;
+	engine->timeout = timeout;
+	engine->payload = payload;
+	engine->reserve = reserve;
+	engine->callbackArg = callbackArg;
+	pthread_mutex_init ( &engine->mutex, 0 );
+	pthread_cond_init ( &engine->idle, 0 );
+
+	return OA_ERR_NONE;
+}
+
+
+int
+_oaUSBTransferStart ( USB_TRANSFER_ENGINE* engine, unsigned int numTransfers,
+		unsigned int transferSize )
+{
+	USB_TRANSFER*		t;
+	unsigned int		i, submitted;
+
+	if ( engine->transfers ) {
+		oaLogError ( OA_LOG_CAMERA, "%s: transfers already running", __func__ );
+		return -OA_ERR_INVALID_COMMAND;
+	}
+	if ( !transferSize ) {
+		oaLogError ( OA_LOG_CAMERA, "%s: invalid transfer size", __func__ );
+		return -OA_ERR_OUT_OF_RANGE;
+	}
+	if ( !numTransfers ) {
+		numTransfers = OA_USB_DEFAULT_TRANSFERS;
+	}
+	if ( numTransfers > OA_USB_MAX_TRANSFERS ) {
+		numTransfers = OA_USB_MAX_TRANSFERS;
+	}
+
+	if (!( engine->transfers = calloc ( numTransfers,
+			sizeof ( USB_TRANSFER )))) {
+		oaLogError ( OA_LOG_CAMERA, "%s: malloc of transfer array failed",
+				__func__ );
+		return -OA_ERR_MEM_ALLOC;
+	}
+	engine->numTransfers = numTransfers;
+	engine->transferSize = transferSize;
+
+	for ( i = 0; i < numTransfers; i++ ) {
+		t = &engine->transfers[i];
+		t->engine = engine;
+		if (!( t->staging = malloc ( transferSize )) ||
+				engine->transport->alloc ( t ) != OA_ERR_NONE ) {
+			oaLogError ( OA_LOG_CAMERA, "%s: allocation of transfer %d failed",
+					__func__, i );
+			if ( t->staging ) {
+				free (( void* ) t->staging );
+			}
+			while ( i-- > 0 ) {
+				engine->transport->release ( &engine->transfers[i] );
+				free (( void* ) engine->transfers[i].staging );
+			}
+			free (( void* ) engine->transfers );
+			engine->transfers = 0;
+			return -OA_ERR_MEM_ALLOC;
+		}
+	}
+
+	pthread_mutex_lock ( &engine->mutex );
+	engine->running = 1;
+	engine->resync = 1;
+	engine->inFlight = engine->directInFlight = 0;
+	engine->pendingBytes = 0;
+	submitted = 0;
+	for ( i = 0; i < numTransfers; i++ ) {
+		if ( _submit ( &engine->transfers[i] ) != OA_ERR_NONE ) {
+			break;
+		}
+		submitted++;
+	}
+	if ( !submitted ) {
+		engine->running = 0;
+	}
+	pthread_mutex_unlock ( &engine->mutex );
+
+	if ( !submitted ) {
+		oaLogError ( OA_LOG_CAMERA, "%s: unable to submit any transfers",
+				__func__ );
+		for ( i = 0; i < numTransfers; i++ ) {
+			engine->transport->release ( &engine->transfers[i] );
+			free (( void* ) engine->transfers[i].staging );
+		}
+		free (( void* ) engine->transfers );
+		engine->transfers = 0;
+		return -OA_ERR_SYSTEM_ERROR;
+	}
+
+	if ( submitted < numTransfers ) {
+		oaLogWarning ( OA_LOG_CAMERA, "%s: only %d of %d transfers submitted",
+				__func__, submitted, numTransfers );
+	}
+
+	return OA_ERR_NONE;
+}
+
+
+int
+_oaUSBTransferStop ( USB_TRANSFER_ENGINE* engine )
+{
+	unsigned int		i;
+	int							inFlight;
+
+	if ( !engine->transfers ) {
+		return OA_ERR_NONE;
+	}
+
+	pthread_mutex_lock ( &engine->mutex );
+	engine->running = 0;
+	pthread_mutex_unlock ( &engine->mutex );
+
+	// The cancel can't be done with the engine locked because the
+	// transport is allowed to complete the transfer before it returns
+
+	for ( i = 0; i < engine->numTransfers; i++ ) {
+		pthread_mutex_lock ( &engine->mutex );
+		inFlight = engine->transfers[i].inFlight;
+		pthread_mutex_unlock ( &engine->mutex );
+		if ( inFlight ) {
+			( void ) engine->transport->cancel ( &engine->transfers[i] );
+		}
+	}
+
+	pthread_mutex_lock ( &engine->mutex );
+	while ( engine->inFlight ) {
+		pthread_cond_wait ( &engine->idle, &engine->mutex );
+	}
+	pthread_mutex_unlock ( &engine->mutex );
+
+	for ( i = 0; i < engine->numTransfers; i++ ) {
+		engine->transport->release ( &engine->transfers[i] );
+		free (( void* ) engine->transfers[i].staging );
+	}
+	free (( void* ) engine->transfers );
+	engine->transfers = 0;
+	engine->numTransfers = 0;
+
+	return OA_ERR_NONE;
+}
+
+
+void
+_oaUSBTransferFree ( USB_TRANSFER_ENGINE* engine )
+{
+	if ( !engine->transport ) {
+		return;
+	}
+	( void ) _oaUSBTransferStop ( engine );
+	pthread_mutex_destroy ( &engine->mutex );
+	pthread_cond_destroy ( &engine->idle );
+	engine->transport = 0;
+}
+
+
+/**
+ * Called by the transport when a transfer has finished, for whatever
+ * reason.  Hands the data to the driver and resubmits the transfer if
+ * the engine is still running.
+ */
+
+void
+_oaUSBTransferDone ( USB_TRANSFER* t, int status, unsigned int actualLength )
+{
+	USB_TRANSFER_ENGINE*	engine = t->engine;
+	int										flags = 0;
+
+	pthread_mutex_lock ( &engine->mutex );
+
+	t->inFlight = 0;
+	engine->inFlight--;
+	engine->pendingBytes -= t->length;
+	if ( t->direct ) {
+		engine->directInFlight--;
+	}
+
+	switch ( status ) {
+
+		case OA_USB_XFER_COMPLETED:
+			if ( actualLength ) {
+				flags = engine->payload ( engine->callbackArg, t->data,
+						actualLength );
+				if ( t->direct ) {
+					engine->directBytes += actualLength;
+				} else {
+					engine->stagedBytes += actualLength;
+				}
+			}
+			if ( actualLength < t->length || ( flags & OA_USB_PAYLOAD_RESYNC )) {
+				engine->resync = 1;
+			}
+			break;
+
+		case OA_USB_XFER_RETRY:
+			// This transfer's place in the stream has been given up, so
+			// everything after it will come back early
+			engine->resync = 1;
+			break;
+	}
+
+	if ( engine->running && ( OA_USB_XFER_COMPLETED == status ||
+			OA_USB_XFER_RETRY == status )) {
+		if ( _submit ( t ) != OA_ERR_NONE ) {
+			oaLogError ( OA_LOG_CAMERA, "%s: resubmit of transfer %p failed",
+					__func__, t );
+		}
+	}
+
+	if ( !engine->inFlight ) {
+		pthread_cond_broadcast ( &engine->idle );
+	}
+	pthread_mutex_unlock ( &engine->mutex );
+}
+
+
+// Must be called with the engine locked
+
+static int
+_submit ( USB_TRANSFER* t )
+{
+	USB_TRANSFER_ENGINE*	engine = t->engine;
+
+	t->length = engine->transferSize;
+	t->data = 0;
+	if ( engine->reserve ) {
+		if ( engine->resync ) {
+			if ( !engine->directInFlight ) {
+				t->data = engine->reserve ( engine->callbackArg, t->length, 1,
+						engine->pendingBytes );
+				engine->resync = 0;
+			}
+		} else {
+			t->data = engine->reserve ( engine->callbackArg, t->length, 0, 0 );
+		}
+	}
+	t->direct = t->data ? 1 : 0;
+	if ( !t->data ) {
+		t->data = t->staging;
+	}
+
+	if ( engine->transport->submit ( t ) != OA_ERR_NONE ) {
+		// the driver has moved its reservations on past this one
+		engine->resync = 1;
+		return -OA_ERR_SYSTEM_ERROR;
+	}
+
+	t->inFlight = 1;
+	engine->inFlight++;
+	engine->pendingBytes += t->length;
+	if ( t->direct ) {
+		engine->directInFlight++;
+	}
+	return OA_ERR_NONE;
+}
+
+
+int
+_oaUSBEventThreadStart ( libusb_context* context )
+{
+	USB_EVENT_THREAD*		t;
+
+	pthread_mutex_lock ( &_eventThreadMutex );
+	for ( t = _eventThreads; t; t = t->next ) {
+		if ( t->context == context ) {
+			t->refs++;
+			pthread_mutex_unlock ( &_eventThreadMutex );
+			return OA_ERR_NONE;
+		}
+	}
+
+	if (!( t = calloc ( 1, sizeof ( USB_EVENT_THREAD )))) {
+		pthread_mutex_unlock ( &_eventThreadMutex );
+		oaLogError ( OA_LOG_CAMERA, "%s: malloc failed", __func__ );
+		return -OA_ERR_MEM_ALLOC;
+	}
+	t->context = context;
+	t->refs = 1;
+	if ( pthread_create ( &t->thread, 0, _eventHandler, ( void* ) t )) {
+		pthread_mutex_unlock ( &_eventThreadMutex );
+		oaLogError ( OA_LOG_CAMERA, "%s: event thread creation failed",
+				__func__ );
+		free (( void* ) t );
+		return -OA_ERR_SYSTEM_ERROR;
+	}
+	t->next = _eventThreads;
+	_eventThreads = t;
+	pthread_mutex_unlock ( &_eventThreadMutex );
+
+	return OA_ERR_NONE;
+}
+
+
+void
+_oaUSBEventThreadStop ( libusb_context* context )
+{
+	USB_EVENT_THREAD**	p;
+	USB_EVENT_THREAD*		t = 0;
+	void*								dummy;
+
+	pthread_mutex_lock ( &_eventThreadMutex );
+	for ( p = &_eventThreads; *p; p = &( *p )->next ) {
+		if (( *p )->context == context ) {
+			t = *p;
+			if ( --t->refs ) {
+				t = 0;
+			} else {
+				*p = t->next;
+			}
+			break;
+		}
+	}
+	pthread_mutex_unlock ( &_eventThreadMutex );
+
+	if ( t ) {
+		t->stop = 1;
+		pthread_join ( t->thread, &dummy );
+		free (( void* ) t );
+	}
+}
+
+
+static void*
+_eventHandler ( void* param )
+{
+	USB_EVENT_THREAD*		t = param;
+	struct timeval			tv;
+
+	do {
+		tv.tv_sec = 1;
+		tv.tv_usec = 0;
+		libusb_handle_events_timeout_completed ( t->context, &tv, &t->stop );
+	} while ( !t->stop );
+
+	return 0;
+}
+
+
+static int
+_libusbAlloc ( USB_TRANSFER* t )
+{
+	if (!( t->transportData = libusb_alloc_transfer ( 0 ))) {
+		return -OA_ERR_MEM_ALLOC;
+	}
+	return OA_ERR_NONE;
+}
+
+
+static void
+_libusbRelease ( USB_TRANSFER* t )
+{
+	if ( t->transportData ) {
+		libusb_free_transfer ( t->transportData );
+		t->transportData = 0;
+	}
+}
+
+
+static int
+_libusbSubmit ( USB_TRANSFER* t )
+{
+	USB_TRANSFER_ENGINE*		engine = t->engine;
+	struct libusb_transfer*	transfer = t->transportData;
+	int											ret;
+
+	libusb_fill_bulk_transfer ( transfer, engine->usbHandle, engine->endpoint,
+			t->data, t->length, _libusbCallback, t, engine->timeout );
+	if (( ret = libusb_submit_transfer ( transfer ))) {
+		oaLogError ( OA_LOG_CAMERA, "%s: submit failed: %s", __func__,
+				libusb_error_name ( ret ));
+		return -OA_ERR_SYSTEM_ERROR;
+	}
+	return OA_ERR_NONE;
+}
+
+
+static int
+_libusbCancel ( USB_TRANSFER* t )
+{
+	int		ret;
+
+	// NOT_FOUND just means the transfer has already completed
+	ret = libusb_cancel_transfer ( t->transportData );
+	if ( ret && ret != LIBUSB_ERROR_NOT_FOUND ) {
+		oaLogError ( OA_LOG_CAMERA, "%s: cancel failed: %s", __func__,
+				libusb_error_name ( ret ));
+		return -OA_ERR_SYSTEM_ERROR;
+	}
+	return OA_ERR_NONE;
+}
+
+
+static void LIBUSB_CALL
+_libusbCallback ( struct libusb_transfer* transfer )
+{
+	USB_TRANSFER*		t = transfer->user_data;
+	int							status = OA_USB_XFER_FAILED;
+
+	switch ( transfer->status ) {
+
+		case LIBUSB_TRANSFER_COMPLETED:
+			status = OA_USB_XFER_COMPLETED;
+			break;
+
+		case LIBUSB_TRANSFER_TIMED_OUT:
+			status = OA_USB_XFER_RETRY;
+			break;
+
+		case LIBUSB_TRANSFER_STALL:
+		case LIBUSB_TRANSFER_OVERFLOW:
+			oaLogError ( OA_LOG_CAMERA, "%s: retrying transfer, status = %d (%s)",
+					__func__, transfer->status, libusb_error_name ( transfer->status ));
+			status = OA_USB_XFER_RETRY;
+			break;
+
+		case LIBUSB_TRANSFER_CANCELLED:
+			status = OA_USB_XFER_CANCELLED;
+			break;
+
+		case LIBUSB_TRANSFER_ERROR:
+		case LIBUSB_TRANSFER_NO_DEVICE:
+			status = OA_USB_XFER_FAILED;
+			break;
+	}
+
+	_oaUSBTransferDone ( t, status, transfer->actual_length );
+}
+
+
+/*
+ * The mock transport keeps submitted transfers in a queue in submission
+ * order, as a single bulk endpoint would, and _oaUSBMockComplete() plays
+ * the part of the device by filling and completing the oldest of them.
+ */
+
+static int
+_mockAlloc ( USB_TRANSFER* t )
+{
+	USB_TRANSFER_ENGINE*	engine = t->engine;
+
+	if ( t == engine->transfers ) {
+		if (!( engine->mockQueue = calloc ( engine->numTransfers,
+				sizeof ( USB_TRANSFER* )))) {
+			return -OA_ERR_MEM_ALLOC;
+		}
+		engine->mockHead = engine->mockCount = 0;
+	}
+	return OA_ERR_NONE;
+}
+
+
+static void
+_mockRelease ( USB_TRANSFER* t )
+{
+	USB_TRANSFER_ENGINE*	engine = t->engine;
+
+	if ( t == engine->transfers && engine->mockQueue ) {
+		free (( void* ) engine->mockQueue );
+		engine->mockQueue = 0;
+	}
+}
+
+
+// Called with the engine locked
+
+static int
+_mockSubmit ( USB_TRANSFER* t )
+{
+	USB_TRANSFER_ENGINE*	engine = t->engine;
+
+	if ( engine->mockCount == engine->numTransfers ) {
+		return -OA_ERR_SYSTEM_ERROR;
+	}
+	engine->mockQueue[( engine->mockHead + engine->mockCount ) %
+			engine->numTransfers ] = t;
+	engine->mockCount++;
+	return OA_ERR_NONE;
+}
+
+
+static int
+_mockCancel ( USB_TRANSFER* t )
+{
+	USB_TRANSFER_ENGINE*	engine = t->engine;
+	unsigned int					i, j, n = engine->numTransfers;
+	int										found = 0;
+
+	pthread_mutex_lock ( &engine->mutex );
+	for ( i = 0; i < engine->mockCount; i++ ) {
+		if ( engine->mockQueue[( engine->mockHead + i ) % n ] == t ) {
+			for ( j = i + 1; j < engine->mockCount; j++ ) {
+				engine->mockQueue[( engine->mockHead + j - 1 ) % n ] =
+						engine->mockQueue[( engine->mockHead + j ) % n ];
+			}
+			engine->mockCount--;
+			found = 1;
+			break;
+		}
+	}
+	pthread_mutex_unlock ( &engine->mutex );
+
+	if ( found ) {
+		_oaUSBTransferDone ( t, OA_USB_XFER_CANCELLED, 0 );
+	}
+	return OA_ERR_NONE;
+}
+
+
+/**
+ * Complete the oldest transfer submitted to the mock transport with (at
+ * most) len bytes from data.  Returns the number of bytes delivered or
+ * an error if nothing is in flight.
+ */
+
+int
+_oaUSBMockComplete ( USB_TRANSFER_ENGINE* engine, const unsigned char* data,
+		unsigned int len, int status )
+{
+	USB_TRANSFER*		t;
+
+	pthread_mutex_lock ( &engine->mutex );
+	if ( engine->transport != &oaUSBMockTransport || !engine->mockCount ) {
+		pthread_mutex_unlock ( &engine->mutex );
+		return -OA_ERR_INVALID_COMMAND;
+	}
+	t = engine->mockQueue[ engine->mockHead ];
+	engine->mockHead = ( engine->mockHead + 1 ) % engine->numTransfers;
+	engine->mockCount--;
+	if ( len > t->length ) {
+		len = t->length;
+	}
+	if ( OA_USB_XFER_COMPLETED == status && len ) {
+		memcpy ( t->data, data, len );
+	}
+	pthread_mutex_unlock ( &engine->mutex );
+
+	_oaUSBTransferDone ( t, status, len );
+	return len;
+}
@@ -0,0 +1,132 @@
+/*****************************************************************************
+ *
+ * usbTransfer.h -- shared asynchronous libusb transfer engine
+ *
+ * Copyright 2026 James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#ifndef OA_USB_TRANSFER_H
+#define OA_USB_TRANSFER_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <libusb-1.0/libusb.h>
+
+#define	OA_USB_DEFAULT_TRANSFERS	8
+#define	OA_USB_MAX_TRANSFERS		128
+
+// Completion status as seen by the engine, whatever the transport
+
+#define	OA_USB_XFER_COMPLETED		0
+#define	OA_USB_XFER_RETRY				1	// timed out, stalled etc.
+#define	OA_USB_XFER_CANCELLED		2
+#define	OA_USB_XFER_FAILED			3	// error or device gone
+
+// Returned by a payload callback when the data it has just seen means that
+// the positions it handed out for transfers still in flight are no longer
+// where the data will belong (eg. it has just dropped a partial frame)
+
+#define	OA_USB_PAYLOAD_RESYNC		1
+
+struct USB_TRANSFER_ENGINE;
+
+typedef struct USB_TRANSFER {
+	struct USB_TRANSFER_ENGINE*	engine;
+	void*						transportData;
+	unsigned char*	staging;
+	unsigned char*	data;
+	unsigned int		length;
+	int							direct;
+	int							inFlight;
+} USB_TRANSFER;
+
+typedef struct USB_TRANSPORT {
+	int		( *alloc )( USB_TRANSFER* );
+	void	( *release )( USB_TRANSFER* );
+	int		( *submit )( USB_TRANSFER* );
+	int		( *cancel )( USB_TRANSFER* );
+} USB_TRANSPORT;
+
+// The payload callback is given each completed transfer's data in the
+// order the transfers were submitted, which for a single bulk endpoint is
+// also the order the data arrived in.  If the data is not already where
+// the caller wants it the caller must copy it (with memmove(), as the two
+// may overlap when the stream has got out of step)
+//
+// The reserve callback, if given, is asked for somewhere to put the next
+// "length" bytes of the stream each time a transfer is submitted.  It may
+// return NULL, in which case the transfer uses its own staging buffer.
+// The third argument is set on the first call after starting or after a
+// resync, when the fourth gives the number of bytes the transfers already
+// in flight will deliver ahead of this one and the driver should restart
+// its reservations from there.  Both callbacks are made with the engine
+// locked and must not call back into it.
+
+typedef int		( *USB_PAYLOAD_FN )( void*, unsigned char*, unsigned int );
+typedef unsigned char*	( *USB_RESERVE_FN )( void*, unsigned int, int,
+										uint64_t );
+
+typedef struct USB_TRANSFER_ENGINE {
+	const USB_TRANSPORT*	transport;
+	libusb_device_handle*	usbHandle;
+	unsigned char		endpoint;
+	unsigned int		timeout;
+	USB_PAYLOAD_FN	payload;
+	USB_RESERVE_FN	reserve;
+	void*						callbackArg;
+	unsigned int		numTransfers;
+	unsigned int		transferSize;
+	USB_TRANSFER*		transfers;
+	pthread_mutex_t	mutex;
+	pthread_cond_t	idle;
+	int							running;
+	int							resync;
+	unsigned int		inFlight;
+	unsigned int		directInFlight;
+	uint64_t				pendingBytes;
+	uint64_t				directBytes;
+	uint64_t				stagedBytes;
+	// used only by the mock transport
+	USB_TRANSFER**	mockQueue;
+	unsigned int		mockHead;
+	unsigned int		mockCount;
+} USB_TRANSFER_ENGINE;
+
+extern const USB_TRANSPORT	oaUSBLibusbTransport;
+extern const USB_TRANSPORT	oaUSBMockTransport;
+
+extern int		_oaUSBTransferInit ( USB_TRANSFER_ENGINE*, const USB_TRANSPORT*,
+									libusb_device_handle*, unsigned char, unsigned int,
+									USB_PAYLOAD_FN, USB_RESERVE_FN, void* );
+extern int		_oaUSBTransferStart ( USB_TRANSFER_ENGINE*, unsigned int,
+									unsigned int );
+extern int		_oaUSBTransferStop ( USB_TRANSFER_ENGINE* );
+extern void		_oaUSBTransferFree ( USB_TRANSFER_ENGINE* );
+extern void		_oaUSBTransferDone ( USB_TRANSFER*, int, unsigned int );
+
+extern int		_oaUSBMockComplete ( USB_TRANSFER_ENGINE*, const unsigned char*,
+									unsigned int, int );
+
+extern int		_oaUSBEventThreadStart ( libusb_context* );
+extern void		_oaUSBEventThreadStop ( libusb_context* );
+
+#endif	/* OA_USB_TRANSFER_H */
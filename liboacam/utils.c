@@ -93,6 +93,9 @@ _oaInitCameraStructs ( oaCamera** camera, void** state, size_t stateSize,
 	oaCamera*			p_camera;
 	SHARED_STATE*	p_state;
 	COMMON_INFO*	p_common;
+#if HAVE_PTHREAD_CONDATTR_SETCLOCK && defined(CLOCK_MONOTONIC)
+	pthread_condattr_t	attr;
+#endif
 
 	if (!( p_camera = ( oaCamera* ) malloc ( sizeof ( oaCamera )))) {
 		perror ( "malloc of oaCamera struct failed" );
@@ -128,12 +131,178 @@ _oaInitCameraStructs ( oaCamera** camera, void** state, size_t stateSize,
 
 	pthread_mutex_init ( &p_state->commandQueueMutex, 0 );
 	pthread_mutex_init ( &p_state->callbackQueueMutex, 0 );
-	pthread_mutex_init ( &p_state->timerMutex, 0 );
+	// Timed waits on these use deadlines from _oaDeadline(), so must be
+	// on the same clock
+#if HAVE_PTHREAD_CONDATTR_SETCLOCK && defined(CLOCK_MONOTONIC)
+	pthread_condattr_init ( &attr );
+	pthread_condattr_setclock ( &attr, CLOCK_MONOTONIC );
+	pthread_cond_init ( &p_state->callbackQueued, &attr );
+	pthread_cond_init ( &p_state->commandQueued, &attr );
+	pthread_cond_init ( &p_state->commandComplete, &attr );
+	pthread_condattr_destroy ( &attr );
+#else
 	pthread_cond_init ( &p_state->callbackQueued, 0 );
 	pthread_cond_init ( &p_state->commandQueued, 0 );
 	pthread_cond_init ( &p_state->commandComplete, 0 );
-	pthread_cond_init ( &p_state->timerState, 0 );
+#endif
 	p_state->timerActive = 0;
+	p_state->controllerEventFd = -1;
+	_oaControlMirrorInit ( &p_state->controlMirror );
 
 	return OA_ERR_NONE;
 }
+
+
+/**
+ * Tell the controller thread that there's work for it to do.  Controllers
+ * that sleep in poll/epoll rather than on the condition variable can set
+ * controllerEventFd to an eventfd (or any fd accepting an eight-byte write)
+ * to be woken as well.
+ */
+
+void
+oacamWakeController ( void* state )
+{
+	SHARED_STATE*		cameraInfo = state;
+	uint64_t				one = 1;
+
+	pthread_cond_broadcast ( &cameraInfo->commandQueued );
+	if ( cameraInfo->controllerEventFd >= 0 ) {
+		if ( write ( cameraInfo->controllerEventFd, &one, sizeof ( one )) !=
+				sizeof ( one )) {
+			oaLogWarning ( OA_LOG_CAMERA, "%s: controller wakeup failed, errno %d",
+					__func__, errno );
+		}
+	}
+}
+
+
+/**
+ * Take the next command off the camera's queue.  Once an asynchronous
+ * control change has been taken it can no longer have later changes to the
+ * same control merged into it, so it is dropped from the pending list
+ * here, under the same lock oacamSetControlAsync() uses to look for it.
+ */
+
+OA_COMMAND*
+oacamNextCommand ( void* state )
+{
+	SHARED_STATE*		cameraInfo = state;
+	OA_COMMAND*			command;
+	ASYNC_COMMAND**	p;
+
+	pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
+	if (( command = oaDLListRemoveFromHead ( cameraInfo->commandQueue )) &&
+			command->callback ) {
+		for ( p = &cameraInfo->asyncPending; *p; p = &( *p )->nextPending ) {
+			if ( &( *p )->command == command ) {
+				*p = ( *p )->nextPending;
+				break;
+			}
+		}
+	}
+	pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
+
+	return command;
+}
+
+
+/**
+ * Report the result of a command back to whoever queued it.  Synchronous
+ * callers are woken up.  Asynchronous commands are freed here and, when
+ * the last command of a batch is done, the batch's callback is made from
+ * the controller thread with the first error seen (if any).
+ */
+
+void
+oacamCommandComplete ( void* state, OA_COMMAND* command, int resultCode )
+{
+	SHARED_STATE*		cameraInfo = state;
+	ASYNC_BATCH*		batch;
+	int							done, i, baseVal;
+
+	// Keep the control mirror up to date before anyone can see the result.
+	// A change to a control may alter its auto and on/off settings and vice
+	// versa, so forget all of them
+
+	if ( OA_CMD_CONTROL_GET == command->commandType &&
+			OA_ERR_NONE == resultCode ) {
+		_oaControlMirrorSet ( &cameraInfo->controlMirror, command->controlId,
+				command->resultData );
+	}
+	if ( OA_CMD_CONTROL_SET == command->commandType ) {
+		baseVal = OA_CAM_CTRL_MODE_BASE( command->controlId );
+		for ( i = 0; i < OA_CAM_CTRL_MODIFIERS_LAST_P1; i++ ) {
+			_oaControlMirrorInvalidate ( &cameraInfo->controlMirror,
+					baseVal | ( i << 8 ));
+		}
+		if ( OA_CAM_CTRL_DROPPED_RESET == command->controlId ) {
+			_oaControlMirrorInvalidate ( &cameraInfo->controlMirror,
+					OA_CAM_CTRL_DROPPED );
+		}
+	}
+
+	if ( !command->callback ) {
+		pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
+		command->completed = 1;
+		command->resultCode = resultCode;
+		pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
+		pthread_cond_broadcast ( &cameraInfo->commandComplete );
+		return;
+	}
+
+	batch = command->callback;
+	pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
+	if ( resultCode != OA_ERR_NONE && ( batch->resultCode == OA_ERR_NONE ||
+			batch->resultCode == -OA_ERR_SUPERSEDED )) {
+		batch->resultCode = resultCode;
+	}
+	done = !--batch->remaining;
+	pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
+
+	free (( void* ) command );
+	if ( done ) {
+		if ( batch->callback ) {
+			batch->callback ( batch->callbackArg, batch->resultCode );
+		}
+		free (( void* ) batch );
+	}
+}
+
+
+/**
+ * Complete any asynchronous control changes still queued when a camera is
+ * closed, so their batches' callbacks are still made and the batches are
+ * freed.  Must only be called once the controller thread has stopped.
+ * Synchronous commands are left in the queue.
+ */
+
+void
+oacamFlushAsync ( void* state )
+{
+	SHARED_STATE*		cameraInfo = state;
+	OA_COMMAND*			command;
+	ASYNC_COMMAND*	async;
+	ASYNC_COMMAND*	flushed = 0;
+	int							i = 0;
+
+	pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
+	while (( command = oaDLListPeekAt ( cameraInfo->commandQueue, i ))) {
+		if ( command->callback ) {
+			( void ) oaDLListRemoveAt ( cameraInfo->commandQueue, i );
+			async = ( ASYNC_COMMAND* ) command;
+			async->nextPending = flushed;
+			flushed = async;
+		} else {
+			i++;
+		}
+	}
+	cameraInfo->asyncPending = 0;
+	pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
+
+	while (( async = flushed )) {
+		flushed = async->nextPending;
+		oacamCommandComplete ( cameraInfo, &async->command,
+				-OA_ERR_INVALID_CAMERA );
+	}
+}
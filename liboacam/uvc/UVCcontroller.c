@@ -81,7 +81,7 @@ oacamUVCcontroller ( void* param )
       pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
     }
     do {
-      command = oaDLListRemoveFromHead ( cameraInfo->commandQueue );
+      command = oacamNextCommand ( cameraInfo );
       if ( command ) {
         switch ( command->commandType ) {
           case OA_CMD_CONTROL_SET:
@@ -108,15 +108,7 @@ oacamUVCcontroller ( void* param )
             resultCode = -OA_ERR_INVALID_CONTROL;
             break;
         }
-        if ( command->callback ) {
-					oaLogWarning ( OA_LOG_CAMERA, "%s: command has callback", __func__ );
-        } else {
-          pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
-          command->completed = 1;
-          command->resultCode = resultCode;
-          pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
-          pthread_cond_broadcast ( &cameraInfo->commandComplete );
-        }
+        oacamCommandComplete ( cameraInfo, command, resultCode );
       }
     } while ( command );
   } while ( !exitThread );
@@ -154,6 +146,7 @@ _UVCFrameCallback ( uvc_frame_t *frame, void *ptr )
         cameraInfo->buffers[ nextBuffer ].start;
     cameraInfo->frameCallbacks[ nextBuffer ].bufferLen = dataLength;
     pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
+    OA_FRAME_STATS_QUEUED ( cameraInfo, nextBuffer );
     oaDLListAddToTail ( cameraInfo->callbackQueue,
         &cameraInfo->frameCallbacks[ nextBuffer ]);
     cameraInfo->buffersFree--;
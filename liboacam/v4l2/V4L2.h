@@ -31,6 +31,12 @@
 
 #define	V4L2_MAX_MENU_ITEM_LENGTH	32
 
+#if V4L2_MEMORY_RESTRICTED
+#define	V4L2_DEFAULT_BUFFERS		3
+#else
+#define	V4L2_DEFAULT_BUFFERS		OA_CAM_BUFFERS
+#endif
+
 extern int	_getExtendedControl ( int, int, oaControlValue* );
 
 #endif	/* OA_V4L2_H */
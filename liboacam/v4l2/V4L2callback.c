@@ -44,9 +44,11 @@ oacamV4L2callbackHandler ( void* param )
 {
   oaCamera*		camera = param;
   V4L2_STATE*		cameraInfo = camera->_private;
-  int			exitThread = 0, streaming;
+  int			exitThread = 0;
   CALLBACK*		callback;
   void*			(*callbackFunc)( void*, void*, int, void* );
+  void*			frame;
+  int				frameLen;
   struct v4l2_buffer*	frameData;
 
 	oaLogInfo ( OA_LOG_CAMERA, "%s: thread started", __func__ );
@@ -74,21 +76,26 @@ oacamV4L2callbackHandler ( void* param )
         case OA_CALLBACK_NEW_FRAME:
           callbackFunc = callback->callback;
           frameData = callback->buffer;
-          callbackFunc ( callback->callbackArg,
-              cameraInfo->buffers[ frameData->index ].start,
-              callback->bufferLen, 0 );
-          // We can only requeue frames if we're still streaming
-          pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
-          streaming = ( cameraInfo->runMode == CAM_RUN_MODE_STREAMING ) ? 1 : 0;
-          pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
-          if ( streaming ) {
-            if ( v4l2ioctl ( cameraInfo->fd, VIDIOC_QBUF, frameData )) {
-							oaLogError ( OA_LOG_CAMERA, "%s: VIDIOC_DQBUF failed", __func__ );
-            }
-          }
+          frame = cameraInfo->buffers[ frameData->index ].start;
+          frameLen = callback->bufferLen;
+          _oaSoftwareFrame ( camera, &frame, &frameLen, callback->metadata );
+          OA_FRAME_STATS_CB_STAMP ( cameraInfo, callback,
+              OA_FRAME_STAGE_CALLBACK );
+          callbackFunc ( callback->callbackArg, frame, frameLen,
+              callback->metadata );
+          OA_FRAME_STATS_CB_STAMP ( cameraInfo, callback,
+              OA_FRAME_STAGE_RETURNED );
+          OA_FRAME_STATS_CB_COMPLETE ( cameraInfo, callback );
+          // The controller owns the device, so the buffer goes back to it
+          // to be requeued rather than being queued from here
           pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
+          cameraInfo->requeueBuffers[ cameraInfo->requeueCount++ ] =
+              frameData->index;
           cameraInfo->buffersFree++;
           pthread_mutex_unlock ( &cameraInfo->callbackQueueMutex );
+          // for _oaWaitForBuffers() when streaming is stopping
+          pthread_cond_broadcast ( &cameraInfo->callbackQueued );
+          oacamWakeController ( cameraInfo );
           break;
         default:
 					oaLogWarning ( OA_LOG_CAMERA, "%s: unexpected callback type %d",
@@ -160,7 +160,13 @@ oaV4L2InitCamera ( oaCameraDevice* device )
     return 0;
   }
 
-  if (!( cap.device_caps & V4L2_CAP_VIDEO_CAPTURE )) {
+  // Prefer the single-planar API if the device offers both.  libv4l2 may
+  // also present multi-planar devices as single-planar.
+  if ( cap.device_caps & V4L2_CAP_VIDEO_CAPTURE ) {
+    cameraInfo->bufferType = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  } else if ( cap.device_caps & V4L2_CAP_VIDEO_CAPTURE_MPLANE ) {
+    cameraInfo->bufferType = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+  } else {
 		oaLogError ( OA_LOG_CAMERA, "%s: %s does not support video capture",
       __func__, camera->deviceName );
     v4l2_close ( cameraInfo->fd );
@@ -1407,7 +1413,7 @@ oaV4L2InitCamera ( oaCameraDevice* device )
   for ( id = 0;; id++ ) {
     OA_CLEAR ( formatDesc );
     formatDesc.index = id;
-    formatDesc.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    formatDesc.type = cameraInfo->bufferType;
     if ( -1 == v4l2ioctl ( cameraInfo->fd, VIDIOC_ENUM_FMT, &formatDesc )) {
       if ( EINVAL != errno) {
         oaLogWarning ( OA_LOG_CAMERA,
@@ -1748,15 +1754,41 @@ oaV4L2InitCamera ( oaCameraDevice* device )
 
   camera->OA_CAM_CTRL_TYPE( OA_CAM_CTRL_FRAME_FORMAT ) = OA_CTRL_TYPE_DISCRETE;
 
+  camera->OA_CAM_CTRL_TYPE( OA_CAM_CTRL_DROPPED ) = OA_CTRL_TYPE_READONLY;
+  camera->OA_CAM_CTRL_TYPE( OA_CAM_CTRL_DROPPED_RESET ) = OA_CTRL_TYPE_BUTTON;
+  commonInfo->OA_CAM_CTRL_MIN( OA_CAM_CTRL_DROPPED_RESET ) = 0;
+  commonInfo->OA_CAM_CTRL_MAX( OA_CAM_CTRL_DROPPED_RESET ) = 1;
+  commonInfo->OA_CAM_CTRL_STEP( OA_CAM_CTRL_DROPPED_RESET ) = 1;
+  commonInfo->OA_CAM_CTRL_DEF( OA_CAM_CTRL_DROPPED_RESET ) = 0;
+
+  cameraInfo->buffersRequested = V4L2_DEFAULT_BUFFERS;
+  camera->OA_CAM_CTRL_TYPE( OA_CAM_CTRL_FRAME_BUFFERS ) = OA_CTRL_TYPE_INT32;
+  commonInfo->OA_CAM_CTRL_MIN( OA_CAM_CTRL_FRAME_BUFFERS ) = 2;
+  commonInfo->OA_CAM_CTRL_MAX( OA_CAM_CTRL_FRAME_BUFFERS ) = OA_CAM_BUFFERS;
+  commonInfo->OA_CAM_CTRL_STEP( OA_CAM_CTRL_FRAME_BUFFERS ) = 1;
+  commonInfo->OA_CAM_CTRL_DEF( OA_CAM_CTRL_FRAME_BUFFERS ) =
+      V4L2_DEFAULT_BUFFERS;
+  for ( j = 0; j < OA_CAM_BUFFERS; j++ ) {
+    cameraInfo->dmabufFds[j] = -1;
+  }
+
   // Put the camera into the current video mode.  Ignore the frame size
   // for now.  That will have to be sorted later by the caller
 
   OA_CLEAR ( format );
-  format.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-  format.fmt.pix.width = 640;
-  format.fmt.pix.height = 480;
-  format.fmt.pix.pixelformat = cameraInfo->currentV4L2Format;
-  format.fmt.pix.field = V4L2_FIELD_NONE;
+  format.type = cameraInfo->bufferType;
+  if ( V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE == cameraInfo->bufferType ) {
+    format.fmt.pix_mp.width = 640;
+    format.fmt.pix_mp.height = 480;
+    format.fmt.pix_mp.pixelformat = cameraInfo->currentV4L2Format;
+    format.fmt.pix_mp.field = V4L2_FIELD_NONE;
+    format.fmt.pix_mp.num_planes = 1;
+  } else {
+    format.fmt.pix.width = 640;
+    format.fmt.pix.height = 480;
+    format.fmt.pix.pixelformat = cameraInfo->currentV4L2Format;
+    format.fmt.pix.field = V4L2_FIELD_NONE;
+  }
   if ( v4l2ioctl ( cameraInfo->fd, VIDIOC_S_FMT, &format )) {
     oaLogError ( OA_LOG_CAMERA, "%s: VIDIOC_S_FMT xioctl failed", __func__ );
     v4l2_close ( cameraInfo->fd );
@@ -1764,14 +1796,20 @@ oaV4L2InitCamera ( oaCameraDevice* device )
     return 0;
   }
 
-  if ( format.fmt.pix.pixelformat != cameraInfo->currentV4L2Format ) {
+  if ( V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE == cameraInfo->bufferType ) {
+    id = format.fmt.pix_mp.pixelformat;
+    cameraInfo->strideLength = format.fmt.pix_mp.plane_fmt[0].bytesperline;
+  } else {
+    id = format.fmt.pix.pixelformat;
+    cameraInfo->strideLength = format.fmt.pix.bytesperline;
+  }
+  if ( id != cameraInfo->currentV4L2Format ) {
     oaLogError ( OA_LOG_CAMERA, "%s: Can't set required video format",
         __func__);
     v4l2_close ( cameraInfo->fd );
     FREE_DATA_STRUCTS;
     return 0;
   }
-  cameraInfo->strideLength = format.fmt.pix.bytesperline;
   cameraInfo->expectedStride = cameraInfo->xSize *
       oaFrameFormats [ cameraInfo->currentFrameFormat ].strideFactor;
   cameraInfo->excessStride = cameraInfo->strideLength -
@@ -1861,8 +1899,18 @@ oaV4L2InitCamera ( oaCameraDevice* device )
   cameraInfo->commandQueue = oaDLListCreate();
   cameraInfo->callbackQueue = oaDLListCreate();
 
+  if ( oaV4L2InitControllerEvents ( cameraInfo )) {
+    v4l2_close ( cameraInfo->fd );
+    free (( void* ) cameraInfo->frameSizes[1].sizes );
+    oaDLListDelete ( cameraInfo->commandQueue, 0 );
+    oaDLListDelete ( cameraInfo->callbackQueue, 0 );
+    FREE_DATA_STRUCTS;
+    return 0;
+  }
+
   if ( pthread_create ( &( cameraInfo->controllerThread ), 0,
       oacamV4L2controller, ( void* ) camera )) {
+    oaV4L2FreeControllerEvents ( cameraInfo );
     v4l2_close ( cameraInfo->fd );
     free (( void* ) cameraInfo->frameSizes[1].sizes );
     oaDLListDelete ( cameraInfo->commandQueue, 0 );
@@ -1875,8 +1923,9 @@ oaV4L2InitCamera ( oaCameraDevice* device )
 
     void* dummy;
     cameraInfo->stopControllerThread = 1;
-    pthread_cond_broadcast ( &cameraInfo->commandQueued );
+    oacamWakeController ( cameraInfo );
     pthread_join ( cameraInfo->controllerThread, &dummy );
+    oaV4L2FreeControllerEvents ( cameraInfo );
     v4l2_close ( cameraInfo->fd );
     free (( void* ) cameraInfo->frameSizes[1].sizes );
     oaDLListDelete ( cameraInfo->commandQueue, 0 );
@@ -1930,13 +1979,16 @@ oaV4L2CloseCamera ( oaCamera* camera )
 
     cameraInfo = camera->_private;
 
+    pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
     cameraInfo->stopControllerThread = 1;
-    pthread_cond_broadcast ( &cameraInfo->commandQueued );
+    pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
+    oacamWakeController ( cameraInfo );
     pthread_join ( cameraInfo->controllerThread, &dummy );
 
     cameraInfo->stopCallbackThread = 1;
     pthread_cond_broadcast ( &cameraInfo->callbackQueued );
     pthread_join ( cameraInfo->callbackThread, &dummy );
+    oaV4L2FreeControllerEvents ( cameraInfo );
 
     if ( cameraInfo->fd >= 0 ) {
       v4l2_close ( cameraInfo->fd );
@@ -1945,6 +1997,7 @@ oaV4L2CloseCamera ( oaCamera* camera )
       free (( void* ) cameraInfo->frameSizes[1].sizes );
     }
 
+    oacamFlushAsync ( cameraInfo );
     oaDLListDelete ( cameraInfo->commandQueue, 1 );
     oaDLListDelete ( cameraInfo->callbackQueue, 0 );
 
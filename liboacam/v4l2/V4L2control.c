@@ -170,7 +170,7 @@ oaV4L2CameraGetMenuString ( oaCamera* camera, int control, int index )
   command.commandData = &index;
 
   oaDLListAddToTail ( cameraInfo->commandQueue, &command );
-  pthread_cond_broadcast ( &cameraInfo->commandQueued );
+  oacamWakeController ( cameraInfo );
   pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
   while ( !command.completed ) {
     pthread_cond_wait ( &cameraInfo->commandComplete,
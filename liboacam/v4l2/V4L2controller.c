@@ -35,6 +35,8 @@
 #include <fcntl.h>
 #endif
 #include <sys/mman.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <libv4l2.h>
 
 #include "oacamprivate.h"
@@ -61,6 +63,14 @@ static int	_getUserControl ( int, int );
 static int	_setExtendedControl ( int, int, oaControlValue* );
 static int	_doCameraConfig ( V4L2_STATE*, OA_COMMAND* );
 static int	_doStart ( V4L2_STATE* );
+static void	_processCommands ( oaCamera* );
+static void	_dequeueFrames ( V4L2_STATE* );
+static void	_requeueBuffers ( V4L2_STATE* );
+static int	_queueBuffer ( V4L2_STATE*, unsigned int );
+static void	_armDevice ( V4L2_STATE*, int );
+static int	_processSetFrameBuffers ( V4L2_STATE*, OA_COMMAND* );
+static int	_formatIsEmulated ( V4L2_STATE* );
+static void	_releaseBuffers ( V4L2_STATE* );
 
 
 void*
@@ -68,15 +78,10 @@ oacamV4L2controller ( void* param )
 {
   oaCamera*		camera = param;
   V4L2_STATE*		cameraInfo = camera->_private;
-  OA_COMMAND*		command;
+  struct epoll_event	events[2];
+  uint64_t		count;
   int			exitThread = 0;
-  int			resultCode, streaming, r;
-  int			frameWait, haveFrame;
-  int			nextBuffer, buffersFree;
-  struct timeval	tv;
-  fd_set		fds;
-  struct v4l2_buffer*	frame = 0;
-  int			fd;
+  int			streaming, deviceReady, numEvents, n;
 
   // V4L2 cameras are a mixed bunch in terms of how they respond to
   // controls.  Some are happy if the controls are changed at any time
@@ -93,182 +98,362 @@ oacamV4L2controller ( void* param )
   // whilst the camera is streaming wil require the camera to be stopped
   // and restarted.
 
+  // The thread sleeps in epoll_wait() until either the device has a
+  // frame ready or the eventfd is written to say that a command has been
+  // queued or the callback thread has finished with a buffer.  Only this
+  // thread queues and dequeues buffers, so the device needs no locking.
+
   do {
+    numEvents = epoll_wait ( cameraInfo->epollFd, events, 2, -1 );
+    if ( numEvents < 0 ) {
+      if ( EINTR != errno ) {
+        oaLogError ( OA_LOG_CAMERA, "%s: epoll_wait failed, errno %d",
+            __func__, errno );
+        usleep ( 1000 );
+      }
+      numEvents = 0;
+    }
+
+    deviceReady = 0;
+    for ( n = 0; n < numEvents; n++ ) {
+      if ( events[n].data.fd == cameraInfo->controllerEventFd ) {
+        ( void ) read ( cameraInfo->controllerEventFd, &count,
+            sizeof ( count ));
+      } else {
+        deviceReady = 1;
+      }
+    }
+
     pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
     exitThread = cameraInfo->stopControllerThread;
     pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
     if ( exitThread ) {
       break;
-    } else {
-      pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
-      // stop us busy-waiting
-      if ( cameraInfo->runMode == CAM_RUN_MODE_STOPPED &&
-          oaDLListIsEmpty ( cameraInfo->commandQueue )) {
-        pthread_cond_wait ( &cameraInfo->commandQueued,
-            &cameraInfo->commandQueueMutex );
+    }
+
+    _processCommands ( camera );
+
+    pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
+    streaming = ( cameraInfo->runMode == CAM_RUN_MODE_STREAMING ) ? 1 : 0;
+    pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
+    if ( streaming ) {
+      _requeueBuffers ( cameraInfo );
+      if ( deviceReady ) {
+        _dequeueFrames ( cameraInfo );
       }
-      pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
     }
+  } while ( !exitThread );
 
-    do {
-      command = oaDLListRemoveFromHead ( cameraInfo->commandQueue );
-      pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
-      streaming = ( cameraInfo->runMode == CAM_RUN_MODE_STREAMING ) ? 1 : 0;
-      pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
-      if ( command ) {
-        // This is a bit cack.  Need a neater way to handle this
-        if ( streaming || ( OA_CMD_RESOLUTION_SET == command->commandType ||
-            OA_CMD_ROI_SET == command->commandType ||
-            OA_CMD_FRAME_INTERVAL_SET == command->commandType ||
-            OA_CMD_START_STREAMING == command->commandType ||
-            OA_CMD_MENU_ITEM_GET == command->commandType )) {
-          switch ( command->commandType ) {
-            case OA_CMD_CONTROL_SET:
-              resultCode = _processSetControl ( camera, command );
-              break;
-            case OA_CMD_CONTROL_GET:
-              resultCode = _processGetControl ( camera, command );
-              break;
-            case OA_CMD_RESOLUTION_SET:
-              resultCode = _processSetResolution ( cameraInfo, command );
-              break;
-            case OA_CMD_ROI_SET:
-              resultCode = _processSetROI ( cameraInfo, command );
-              break;
-            case OA_CMD_START_STREAMING:
-              resultCode = _processStreamingStart ( cameraInfo, command );
-              break;
-            case OA_CMD_STOP_STREAMING:
-              resultCode = _processStreamingStop ( cameraInfo, command );
-              break;
-            case OA_CMD_FRAME_INTERVAL_SET:
-              resultCode = _processSetFrameInterval ( cameraInfo, command );
-              break;
-            case OA_CMD_MENU_ITEM_GET:
-              resultCode = _processGetMenuItem ( cameraInfo, command );
-              break;
-            default:
-              oaLogError ( OA_LOG_CAMERA,
-									"%s: Invalid command type %d in controller", __func__,
-                  command->commandType );
-              resultCode = -OA_ERR_INVALID_CONTROL;
-              break;
-          }
-        } else {
-          resultCode = -OA_ERR_IGNORED;
-        }
-        if ( command->callback ) {
-					oaLogWarning ( OA_LOG_CAMERA, "%s: command has callback", __func__ );
-        } else {
-          pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
-          command->completed = 1;
-          command->resultCode = resultCode;
-          pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
-          pthread_cond_broadcast ( &cameraInfo->commandComplete );
+	if ( CAM_RUN_MODE_STREAMING == cameraInfo->runMode ) {
+		( void ) _processStreamingStop ( cameraInfo, 0 );
+	}
+
+  return 0;
+}
+
+
+/**
+ * The eventfd is created before the controller thread is started so that
+ * commands can be queued as soon as the thread exists
+ */
+
+int
+oaV4L2InitControllerEvents ( void* state )
+{
+  V4L2_STATE*		cameraInfo = state;
+  struct epoll_event	event;
+
+  cameraInfo->epollFd = -1;
+  cameraInfo->deviceArmed = 0;
+  if (( cameraInfo->controllerEventFd = eventfd ( 0,
+      EFD_NONBLOCK | EFD_CLOEXEC )) < 0 ) {
+    oaLogError ( OA_LOG_CAMERA, "%s: eventfd failed, errno %d", __func__,
+        errno );
+    return -OA_ERR_SYSTEM_ERROR;
+  }
+  if (( cameraInfo->epollFd = epoll_create1 ( EPOLL_CLOEXEC )) < 0 ) {
+    oaLogError ( OA_LOG_CAMERA, "%s: epoll_create1 failed, errno %d",
+        __func__, errno );
+    oaV4L2FreeControllerEvents ( cameraInfo );
+    return -OA_ERR_SYSTEM_ERROR;
+  }
+  OA_CLEAR ( event );
+  event.events = EPOLLIN;
+  event.data.fd = cameraInfo->controllerEventFd;
+  if ( epoll_ctl ( cameraInfo->epollFd, EPOLL_CTL_ADD,
+      cameraInfo->controllerEventFd, &event )) {
+    oaLogError ( OA_LOG_CAMERA, "%s: epoll_ctl failed, errno %d",
+        __func__, errno );
+    oaV4L2FreeControllerEvents ( cameraInfo );
+    return -OA_ERR_SYSTEM_ERROR;
+  }
+  return OA_ERR_NONE;
+}
+
+
+void
+oaV4L2FreeControllerEvents ( void* state )
+{
+  V4L2_STATE*		cameraInfo = state;
+
+  if ( cameraInfo->epollFd >= 0 ) {
+    close ( cameraInfo->epollFd );
+    cameraInfo->epollFd = -1;
+  }
+  if ( cameraInfo->controllerEventFd >= 0 ) {
+    close ( cameraInfo->controllerEventFd );
+    cameraInfo->controllerEventFd = -1;
+  }
+}
+
+
+static void
+_processCommands ( oaCamera* camera )
+{
+  V4L2_STATE*		cameraInfo = camera->_private;
+  OA_COMMAND*		command;
+  int			resultCode, streaming;
+
+  do {
+    command = oacamNextCommand ( cameraInfo );
+    pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
+    streaming = ( cameraInfo->runMode == CAM_RUN_MODE_STREAMING ) ? 1 : 0;
+    pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
+    if ( command ) {
+      // This is a bit cack.  Need a neater way to handle this
+      if ( streaming || ( OA_CMD_RESOLUTION_SET == command->commandType ||
+          OA_CMD_ROI_SET == command->commandType ||
+          OA_CMD_FRAME_INTERVAL_SET == command->commandType ||
+          OA_CMD_START_STREAMING == command->commandType ||
+          OA_CMD_MENU_ITEM_GET == command->commandType ||
+          ( OA_CMD_CONTROL_SET == command->commandType &&
+          OA_CAM_CTRL_FRAME_BUFFERS == command->controlId ))) {
+        switch ( command->commandType ) {
+          case OA_CMD_CONTROL_SET:
+            resultCode = _processSetControl ( camera, command );
+            break;
+          case OA_CMD_CONTROL_GET:
+            resultCode = _processGetControl ( camera, command );
+            break;
+          case OA_CMD_RESOLUTION_SET:
+            resultCode = _processSetResolution ( cameraInfo, command );
+            break;
+          case OA_CMD_ROI_SET:
+            resultCode = _processSetROI ( cameraInfo, command );
+            break;
+          case OA_CMD_START_STREAMING:
+            resultCode = _processStreamingStart ( cameraInfo, command );
+            break;
+          case OA_CMD_STOP_STREAMING:
+            resultCode = _processStreamingStop ( cameraInfo, command );
+            break;
+          case OA_CMD_FRAME_INTERVAL_SET:
+            resultCode = _processSetFrameInterval ( cameraInfo, command );
+            break;
+          case OA_CMD_MENU_ITEM_GET:
+            resultCode = _processGetMenuItem ( cameraInfo, command );
+            break;
+          default:
+            oaLogError ( OA_LOG_CAMERA,
+								"%s: Invalid command type %d in controller", __func__,
+                command->commandType );
+            resultCode = -OA_ERR_INVALID_CONTROL;
+            break;
         }
+      } else {
+        resultCode = -OA_ERR_IGNORED;
       }
-    } while ( command );
+      oacamCommandComplete ( cameraInfo, command, resultCode );
+    }
+  } while ( command );
+}
 
-    if ( streaming ) {
 
-      if ( camera->features.flags & OA_CAM_FEATURE_FRAME_RATES ) {
-        frameWait = 1000000.0 * cameraInfo->frameRateNumerator /
-            cameraInfo->frameRateDenominator;
-      } else {
-        // FIX ME -- need to handle non-manual exposure modes here?
-        if ( camera->OA_CAM_CTRL_TYPE( OA_CAM_CTRL_EXPOSURE_ABSOLUTE )) {
-          pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
-          frameWait = cameraInfo->currentAbsoluteExposure;
-          pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
-        } else {
-          // This is pretty arbitrary, but we don't really have much to
-          // go on.  As the rates are in 100usec, we use 100usec.
-          frameWait = 100;
-        }
+/**
+ * Dequeue every frame the driver has ready and pass them to the callback
+ * thread.  The device is non-blocking, so this stops at EAGAIN.
+ */
+
+static void
+_dequeueFrames ( V4L2_STATE* cameraInfo )
+{
+  struct v4l2_buffer	buf;
+  struct v4l2_plane	plane;
+  struct v4l2_buffer*	frame;
+  FRAME_METADATA*	metadata;
+  unsigned int		index;
+
+  do {
+    OA_CLEAR ( buf );
+    buf.type = cameraInfo->bufferType;
+    buf.memory = V4L2_MEMORY_MMAP;
+    if ( V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE == cameraInfo->bufferType ) {
+      OA_CLEAR ( plane );
+      buf.m.planes = &plane;
+      buf.length = 1;
+    }
+    if ( v4l2_ioctl ( cameraInfo->fd, VIDIOC_DQBUF, &buf ) < 0 ) {
+      if ( EINTR == errno ) {
+        continue;
       }
-      // pause between tests for frame here is no more than 1ms
-      if ( frameWait > 1000 ) {
-        frameWait = 1000;
+      if ( EAGAIN != errno ) {
+        oaLogError ( OA_LOG_CAMERA, "%s: VIDIOC_DQBUF failed, errno %d",
+            __func__, errno );
+        // Something is badly wrong with the device, so stop listening to
+        // it rather than spinning on the error
+        _armDevice ( cameraInfo, 0 );
       }
+      break;
+    }
 
-      pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
-      buffersFree = cameraInfo->buffersFree;
-      pthread_mutex_unlock ( &cameraInfo->callbackQueueMutex );
-
-      if ( buffersFree ) {
-        nextBuffer = cameraInfo->nextBuffer;
-        haveFrame = 0;
-        pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
-        fd = cameraInfo->fd;
-        pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
-        FD_ZERO ( &fds );
-        FD_SET ( fd, &fds );
-        tv.tv_sec = ( int ) ( frameWait / 1000000 );
-        tv.tv_usec = ( frameWait % 1000000 );
-        r = select ( cameraInfo->fd + 1, &fds, 0, 0, &tv );
-        if ( r > 0 ) {
-          // This mutex prevents attempts to dequeue frames if streaming
-          // has stopped since we last checked
-          pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
-					streaming = ( cameraInfo->runMode == CAM_RUN_MODE_STREAMING ) ? 1 : 0;
-          if ( streaming ) {
-            OA_CLEAR( cameraInfo->currentFrame[ nextBuffer ]);
-            frame = &cameraInfo->currentFrame[ nextBuffer ];
-            frame->type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-            frame->memory = V4L2_MEMORY_MMAP;
-            frame->index = nextBuffer;
-            if ( v4l2ioctl ( cameraInfo->fd, VIDIOC_DQBUF, frame ) < 0 ) {
-              perror ( "VIDIOC_DQBUF" );
-            } else {
-              haveFrame = 1;
-            }
-          }
-          exitThread = cameraInfo->stopControllerThread;
-          pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
-        }
+    index = buf.index;
+    if ( index >= ( unsigned int ) cameraInfo->configuredBuffers ) {
+      oaLogError ( OA_LOG_CAMERA, "%s: unexpected buffer index %d", __func__,
+          index );
+      continue;
+    }
+    cameraInfo->buffersQueued--;
+    OA_FRAME_STATS_STAMP ( cameraInfo, index, OA_FRAME_STAGE_READOUT );
+
+    // Frames the driver flags as corrupt go straight back to it
+    if ( buf.flags & V4L2_BUF_FLAG_ERROR ) {
+      cameraInfo->droppedFrames++;
+      OA_CONTROL_MIRROR_READONLY ( cameraInfo, OA_CAM_CTRL_DROPPED,
+          cameraInfo->droppedFrames );
+      OA_FRAME_STATS_DROPPED ( cameraInfo );
+      ( void ) _queueBuffer ( cameraInfo, index );
+      continue;
+    }
 
-        if ( !exitThread ) {
-          if ( haveFrame ) {
-            cameraInfo->frameCallbacks[ nextBuffer ].callbackType =
-                OA_CALLBACK_NEW_FRAME;
-            cameraInfo->frameCallbacks[ nextBuffer ].callback =
-                cameraInfo->streamingCallback.callback;
-            cameraInfo->frameCallbacks[ nextBuffer ].callbackArg =
-                cameraInfo->streamingCallback.callbackArg;
-            cameraInfo->frameCallbacks[ nextBuffer ].buffer = frame;
-            cameraInfo->frameCallbacks[ nextBuffer ].bufferLen =
-                frame->bytesused;
-						if ( cameraInfo->excessStride > 0 ) {
-							uint32_t	i;
-							uint8_t*	s = cameraInfo->buffers[ frame->index ].start;
-							uint8_t*	t = cameraInfo->buffers[ frame->index ].start;
-							for ( i = 0; i < cameraInfo->ySize; i++ ) {
-								( void ) memcpy ( t, s, cameraInfo->expectedStride );
-								t += cameraInfo->expectedStride;
-								s += cameraInfo->strideLength;
-							}
-            	cameraInfo->frameCallbacks[ nextBuffer ].bufferLen =
-									t - ( uint8_t* ) cameraInfo->buffers[ frame->index ].start; 
-						}
-            pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
-            oaDLListAddToTail ( cameraInfo->callbackQueue,
-                &cameraInfo->frameCallbacks[ nextBuffer ]);
-            cameraInfo->buffersFree--;
-            cameraInfo->nextBuffer = ( nextBuffer + 1 ) %
-                cameraInfo->configuredBuffers;
-            pthread_mutex_unlock ( &cameraInfo->callbackQueueMutex );
-            pthread_cond_broadcast ( &cameraInfo->callbackQueued );
-          }
-        }
-      }
+    frame = &cameraInfo->currentFrame[ index ];
+    *frame = buf;
+    if ( V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE == cameraInfo->bufferType ) {
+      cameraInfo->currentPlanes[ index ] = plane;
+      frame->m.planes = &cameraInfo->currentPlanes[ index ];
+      frame->bytesused = plane.bytesused;
     }
-  } while ( !exitThread );
 
-	if ( CAM_RUN_MODE_STREAMING == cameraInfo->runMode ) {
-		resultCode = _processStreamingStop ( cameraInfo, 0 );
-	}
+    cameraInfo->frameCallbacks[ index ].callbackType = OA_CALLBACK_NEW_FRAME;
+    cameraInfo->frameCallbacks[ index ].callback =
+        cameraInfo->streamingCallback.callback;
+    cameraInfo->frameCallbacks[ index ].callbackArg =
+        cameraInfo->streamingCallback.callbackArg;
+    cameraInfo->frameCallbacks[ index ].buffer = frame;
+    cameraInfo->frameCallbacks[ index ].bufferLen = frame->bytesused;
+		if ( cameraInfo->excessStride > 0 ) {
+			uint32_t	i;
+			uint8_t*	s = cameraInfo->buffers[ index ].start;
+			uint8_t*	t = cameraInfo->buffers[ index ].start;
+			for ( i = 0; i < cameraInfo->ySize; i++ ) {
+				( void ) memcpy ( t, s, cameraInfo->expectedStride );
+				t += cameraInfo->expectedStride;
+				s += cameraInfo->strideLength;
+			}
+			cameraInfo->frameCallbacks[ index ].bufferLen =
+					t - ( uint8_t* ) cameraInfo->buffers[ index ].start;
+		}
+
+    metadata = &cameraInfo->metadataBuffers[ index ];
+    metadata->frameCounterValid = 1;
+    metadata->frameCounter = buf.sequence;
+    metadata->dmabufValid = ( cameraInfo->dmabufFds[ index ] >= 0 ) ? 1 : 0;
+    metadata->dmabufFd = cameraInfo->dmabufFds[ index ];
+    cameraInfo->frameCallbacks[ index ].metadata = metadata;
+
+    OA_FRAME_STATS_STAMP ( cameraInfo, index, OA_FRAME_STAGE_COPIED );
+    pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
+    OA_FRAME_STATS_QUEUED ( cameraInfo, index );
+    oaDLListAddToTail ( cameraInfo->callbackQueue,
+        &cameraInfo->frameCallbacks[ index ]);
+    cameraInfo->buffersFree--;
+    pthread_mutex_unlock ( &cameraInfo->callbackQueueMutex );
+    pthread_cond_broadcast ( &cameraInfo->callbackQueued );
+  } while ( 1 );
 
-  return 0;
+  // Some drivers report an error from poll() when they have no buffers
+  // queued, so don't listen to the device until there are some again
+  if ( !cameraInfo->buffersQueued ) {
+    _armDevice ( cameraInfo, 0 );
+  }
+}
+
+
+/**
+ * Give the driver back any buffers the callback thread has finished with
+ */
+
+static void
+_requeueBuffers ( V4L2_STATE* cameraInfo )
+{
+  unsigned int		buffers[ OA_CAM_BUFFERS ];
+  unsigned int		i, count;
+
+  pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
+  count = cameraInfo->requeueCount;
+  for ( i = 0; i < count; i++ ) {
+    buffers[i] = cameraInfo->requeueBuffers[i];
+  }
+  cameraInfo->requeueCount = 0;
+  pthread_mutex_unlock ( &cameraInfo->callbackQueueMutex );
+
+  for ( i = 0; i < count; i++ ) {
+    ( void ) _queueBuffer ( cameraInfo, buffers[i] );
+  }
+  if ( cameraInfo->buffersQueued ) {
+    _armDevice ( cameraInfo, 1 );
+  }
+}
+
+
+static int
+_queueBuffer ( V4L2_STATE* cameraInfo, unsigned int index )
+{
+  struct v4l2_buffer	buf;
+  struct v4l2_plane	plane;
+
+  OA_CLEAR ( buf );
+  buf.type = cameraInfo->bufferType;
+  buf.memory = V4L2_MEMORY_MMAP;
+  buf.index = index;
+  if ( V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE == cameraInfo->bufferType ) {
+    OA_CLEAR ( plane );
+    buf.m.planes = &plane;
+    buf.length = 1;
+  }
+  if ( v4l2ioctl ( cameraInfo->fd, VIDIOC_QBUF, &buf ) < 0 ) {
+    oaLogError ( OA_LOG_CAMERA, "%s: VIDIOC_QBUF failed for buffer %d, "
+        "errno %d", __func__, index, errno );
+    return -OA_ERR_CAMERA_IO;
+  }
+  cameraInfo->buffersQueued++;
+  return OA_ERR_NONE;
+}
+
+
+/**
+ * Start or stop listening for frames from the device.  The fd stays
+ * registered with epoll whilst streaming so this is just a change of the
+ * events we're interested in.
+ */
+
+static void
+_armDevice ( V4L2_STATE* cameraInfo, int enable )
+{
+  struct epoll_event	event;
+
+  if ( enable == cameraInfo->deviceArmed ) {
+    return;
+  }
+  OA_CLEAR ( event );
+  event.events = enable ? EPOLLIN : 0;
+  event.data.fd = cameraInfo->fd;
+  if ( epoll_ctl ( cameraInfo->epollFd, EPOLL_CTL_MOD, cameraInfo->fd,
+      &event )) {
+    oaLogError ( OA_LOG_CAMERA, "%s: epoll_ctl failed, errno %d", __func__,
+        errno );
+    return;
+  }
+  cameraInfo->deviceArmed = enable;
 }
 
 
@@ -296,6 +481,15 @@ _processSetControl ( oaCamera* camera, OA_COMMAND* command )
       return _processSetFrameFormat ( cameraInfo, val_s32, command );
       break;
 
+    case OA_CAM_CTRL_FRAME_BUFFERS:
+      return _processSetFrameBuffers ( cameraInfo, command );
+      break;
+
+    case OA_CAM_CTRL_DROPPED_RESET:
+      cameraInfo->droppedFrames = 0;
+      return OA_ERR_NONE;
+      break;
+
     case OA_CAM_CTRL_BRIGHTNESS:
       val_s32 = valp->int32;
       return _setUserControl ( cameraInfo->fd, V4L2_CID_BRIGHTNESS, val_s32 );
@@ -616,6 +810,16 @@ _processGetControl ( oaCamera* camera, OA_COMMAND* command )
 
   switch ( command->controlId ) {
 
+    case OA_CAM_CTRL_FRAME_BUFFERS:
+      valp->valueType = OA_CTRL_TYPE_INT32;
+      valp->int32 = cameraInfo->buffersRequested;
+      break;
+
+    case OA_CAM_CTRL_DROPPED:
+      valp->valueType = OA_CTRL_TYPE_READONLY;
+      valp->readonly = cameraInfo->droppedFrames;
+      break;
+
     case OA_CAM_CTRL_BRIGHTNESS:
       valp->valueType = OA_CTRL_TYPE_INT32;
       valp->int32 = _getUserControl ( cameraInfo->fd, V4L2_CID_BRIGHTNESS );
@@ -1027,6 +1231,32 @@ _processSetFrameFormat ( V4L2_STATE* cameraInfo, unsigned int format,
 }
 
 
+/**
+ * The number of buffers requested from the driver.  Fewer buffers means
+ * lower latency, more means fewer dropped frames when the consumer stalls.
+ */
+
+static int
+_processSetFrameBuffers ( V4L2_STATE* cameraInfo, OA_COMMAND* command )
+{
+  oaControlValue*	valp = command->commandData;
+  int			streaming;
+
+  if ( valp->int32 < 2 || valp->int32 > OA_CAM_BUFFERS ) {
+    return -OA_ERR_OUT_OF_RANGE;
+  }
+  cameraInfo->buffersRequested = valp->int32;
+
+  pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
+	streaming = ( cameraInfo->runMode == CAM_RUN_MODE_STREAMING ) ? 1 : 0;
+  pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
+  if ( streaming ) {
+    return _doCameraConfig ( cameraInfo, command );
+  }
+  return OA_ERR_NONE;
+}
+
+
 static int
 _processSetFrameInterval ( V4L2_STATE* cameraInfo, OA_COMMAND* command )
 {
@@ -1212,22 +1442,57 @@ _doStart ( V4L2_STATE* cameraInfo )
 {
   struct v4l2_format		fmt;
   struct v4l2_buffer		buf;
+  struct v4l2_plane		plane;
   struct v4l2_requestbuffers	req;
+  struct v4l2_exportbuffer	expbuf;
+  struct epoll_event		event;
   enum v4l2_buf_type		type;
-  unsigned int			m, n;
+  uint32_t			width, height, pixelFormat, bytesPerLine;
+  size_t			length;
+  off_t				offset;
+  unsigned int			n;
+  int				mplane, canExport;
+
+  mplane = ( V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE == cameraInfo->bufferType );
 
   OA_CLEAR ( fmt );
-  fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-  fmt.fmt.pix.width = cameraInfo->xSize;
-  fmt.fmt.pix.height = cameraInfo->ySize;
-  fmt.fmt.pix.pixelformat = cameraInfo->currentV4L2Format;
-  fmt.fmt.pix.field = V4L2_FIELD_NONE;
+  fmt.type = cameraInfo->bufferType;
+  if ( mplane ) {
+    fmt.fmt.pix_mp.width = cameraInfo->xSize;
+    fmt.fmt.pix_mp.height = cameraInfo->ySize;
+    fmt.fmt.pix_mp.pixelformat = cameraInfo->currentV4L2Format;
+    fmt.fmt.pix_mp.field = V4L2_FIELD_NONE;
+    fmt.fmt.pix_mp.num_planes = 1;
+  } else {
+    fmt.fmt.pix.width = cameraInfo->xSize;
+    fmt.fmt.pix.height = cameraInfo->ySize;
+    fmt.fmt.pix.pixelformat = cameraInfo->currentV4L2Format;
+    fmt.fmt.pix.field = V4L2_FIELD_NONE;
+  }
   if ( v4l2ioctl ( cameraInfo->fd, VIDIOC_S_FMT, &fmt )) {
     perror ( "VIDIOC_S_FMT v4l2ioctl failed" );
     return -OA_ERR_CAMERA_IO;
   }
 
-  if ( fmt.fmt.pix.pixelformat != cameraInfo->currentV4L2Format ) {
+  if ( mplane ) {
+    // Only formats that keep the whole image in one plane are handled
+    if ( fmt.fmt.pix_mp.num_planes != 1 ) {
+      oaLogError ( OA_LOG_CAMERA, "%s: %d-plane formats are not supported",
+          __func__, fmt.fmt.pix_mp.num_planes );
+      return -OA_ERR_CAMERA_IO;
+    }
+    width = fmt.fmt.pix_mp.width;
+    height = fmt.fmt.pix_mp.height;
+    pixelFormat = fmt.fmt.pix_mp.pixelformat;
+    bytesPerLine = fmt.fmt.pix_mp.plane_fmt[0].bytesperline;
+  } else {
+    width = fmt.fmt.pix.width;
+    height = fmt.fmt.pix.height;
+    pixelFormat = fmt.fmt.pix.pixelformat;
+    bytesPerLine = fmt.fmt.pix.bytesperline;
+  }
+
+  if ( pixelFormat != cameraInfo->currentV4L2Format ) {
     oaLogError ( OA_LOG_CAMERA,
 				"%s: Can't get expected video format: %c%c%c%c", __func__,
         cameraInfo->currentV4L2Format & 0xff,
@@ -1237,37 +1502,48 @@ _doStart ( V4L2_STATE* cameraInfo )
     return -OA_ERR_CAMERA_IO;
   }
 
-  if (( fmt.fmt.pix.width != cameraInfo->xSize ) || ( fmt.fmt.pix.height !=
-      cameraInfo->ySize )) {
+  if (( width != cameraInfo->xSize ) || ( height != cameraInfo->ySize )) {
     oaLogError ( OA_LOG_CAMERA,
 				"%s: Requested image size %dx%d, offered as %dx%d", __func__,
-        cameraInfo->xSize, cameraInfo->ySize, fmt.fmt.pix.width,
-        fmt.fmt.pix.height );
+        cameraInfo->xSize, cameraInfo->ySize, width, height );
     return -OA_ERR_OUT_OF_RANGE;
   }
-  cameraInfo->strideLength = fmt.fmt.pix.bytesperline;
+  cameraInfo->strideLength = bytesPerLine;
   cameraInfo->expectedStride = cameraInfo->xSize *
       oaFrameFormats [ cameraInfo->currentFrameFormat ].strideFactor;
   cameraInfo->excessStride = cameraInfo->strideLength -
 			cameraInfo->expectedStride;
 
   OA_CLEAR( req );
-#if V4L2_MEMORY_RESTRICTED
-  req.count = 3;
-#else
-  req.count = OA_CAM_BUFFERS;
-#endif
-  req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  req.count = cameraInfo->buffersRequested;
+  req.type = cameraInfo->bufferType;
   req.memory = V4L2_MEMORY_MMAP;
   if ( v4l2ioctl( cameraInfo->fd, VIDIOC_REQBUFS, &req )) {
     perror ( "VIDIOC_REQBUFS v4l2ioctl failed" );
     return -OA_ERR_SYSTEM_ERROR;
   }
+  if ( !req.count ) {
+    oaLogError ( OA_LOG_CAMERA, "%s: driver granted no buffers", __func__ );
+    return -OA_ERR_SYSTEM_ERROR;
+  }
+  // The driver may insist on more buffers than were asked for, but we can
+  // only track OA_CAM_BUFFERS of them.  Any others are never queued.
+  if ( req.count > OA_CAM_BUFFERS ) {
+    req.count = OA_CAM_BUFFERS;
+  }
   cameraInfo->buffersGranted = req.count;
 
+  // Buffers can only be exported if they hold what the callback sees,
+  // which isn't the case if libv4l2 is converting the frames
+  canExport = !_formatIsEmulated ( cameraInfo );
+
   cameraInfo->nextBuffer = 0;
   cameraInfo->configuredBuffers = 0;
   cameraInfo->buffersFree = 0;
+  cameraInfo->buffersQueued = 0;
+  pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
+  cameraInfo->requeueCount = 0;
+  pthread_mutex_unlock ( &cameraInfo->callbackQueueMutex );
   if (!( cameraInfo->buffers = calloc( req.count, sizeof ( frameBuffer )))) {
     oaLogError ( OA_LOG_CAMERA, "%s: calloc of transfer buffers failed",
 				__func__ );
@@ -1278,57 +1554,82 @@ _doStart ( V4L2_STATE* cameraInfo )
     buf.type = req.type;
     buf.memory = V4L2_MEMORY_MMAP;
     buf.index = n;
+    if ( mplane ) {
+      OA_CLEAR ( plane );
+      buf.m.planes = &plane;
+      buf.length = 1;
+    }
     if ( v4l2ioctl ( cameraInfo->fd, VIDIOC_QUERYBUF, &buf )) {
       perror ( "VIDIOC_QUERYBUF v4l2ioctl failed" );
-      free (( void* ) cameraInfo->buffers );
+      _releaseBuffers ( cameraInfo );
       return -OA_ERR_CAMERA_IO;
     }
-    cameraInfo->buffers[ n ].length = buf.length;
+    if ( mplane ) {
+      length = plane.length;
+      offset = plane.m.mem_offset;
+    } else {
+      length = buf.length;
+      offset = buf.m.offset;
+    }
+    cameraInfo->buffers[ n ].length = length;
     if ( MAP_FAILED == ( cameraInfo->buffers[ n ].start = v4l2_mmap ( 0,
-        buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, cameraInfo->fd,
-        buf.m.offset ))) {
+        length, PROT_READ | PROT_WRITE, MAP_SHARED, cameraInfo->fd,
+        offset ))) {
       perror ( "mmap" );
-      if ( n ) {
-        for ( m = 0; m < n; m++ ) {
-          v4l2_munmap ( cameraInfo->buffers[ m ].start,
-              cameraInfo->buffers[ m ].length );
-        }
-      }
-      free (( void* ) cameraInfo->buffers );
+      _releaseBuffers ( cameraInfo );
       return -OA_ERR_SYSTEM_ERROR;
     }
+    cameraInfo->dmabufFds[ n ] = -1;
     cameraInfo->configuredBuffers++;
+
+    if ( canExport ) {
+      OA_CLEAR ( expbuf );
+      expbuf.type = req.type;
+      expbuf.index = n;
+      expbuf.plane = 0;
+      expbuf.flags = O_RDONLY | O_CLOEXEC;
+      if ( v4l2ioctl ( cameraInfo->fd, VIDIOC_EXPBUF, &expbuf )) {
+        // Not an error.  Plenty of drivers don't support it.
+        oaLogInfo ( OA_LOG_CAMERA, "%s: DMABUF export not available",
+            __func__ );
+        canExport = 0;
+      } else {
+        cameraInfo->dmabufFds[ n ] = expbuf.fd;
+      }
+    }
   }
   cameraInfo->buffersFree = cameraInfo->configuredBuffers;
 
   for ( n = 0; n < req.count; n++ ) {
-    OA_CLEAR( buf );
-    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    buf.memory = V4L2_MEMORY_MMAP;
-    buf.index = n;
-    if ( v4l2ioctl ( cameraInfo->fd, VIDIOC_QBUF, &buf ) < 0 ) {
-      perror ( "init VIDIOC_QBUF" );
-      for ( m = 0; m < cameraInfo->configuredBuffers; m++ ) {
-        v4l2_munmap ( cameraInfo->buffers[ m ].start,
-            cameraInfo->buffers[ m ].length );
-      }
-      free (( void* ) cameraInfo->buffers );
+    if ( _queueBuffer ( cameraInfo, n )) {
+      _releaseBuffers ( cameraInfo );
       return -OA_ERR_SYSTEM_ERROR;
     }
   }
 
-  type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  OA_CLEAR ( event );
+  event.events = EPOLLIN;
+  event.data.fd = cameraInfo->fd;
+  if ( epoll_ctl ( cameraInfo->epollFd, EPOLL_CTL_ADD, cameraInfo->fd,
+      &event )) {
+    oaLogError ( OA_LOG_CAMERA, "%s: epoll_ctl failed, errno %d", __func__,
+        errno );
+    _releaseBuffers ( cameraInfo );
+    return -OA_ERR_SYSTEM_ERROR;
+  }
+  cameraInfo->deviceArmed = 1;
+
+  type = req.type;
   if ( v4l2ioctl ( cameraInfo->fd, VIDIOC_STREAMON, &type ) < 0 )  {
-    if ( -ENOSPC == errno ) {
+    if ( ENOSPC == errno ) {
       oaLogError ( OA_LOG_CAMERA,
 					"%s: Insufficient bandwidth for camera on the USB bus", __func__ );
     }
     perror ( "VIDIOC_STREAMON" );
-    for ( m = 0; m < cameraInfo->configuredBuffers; m++ ) {
-      v4l2_munmap ( cameraInfo->buffers[ m ].start,
-          cameraInfo->buffers[ m ].length );
-    }
-    free (( void* ) cameraInfo->buffers );
+    ( void ) epoll_ctl ( cameraInfo->epollFd, EPOLL_CTL_DEL, cameraInfo->fd,
+        0 );
+    cameraInfo->deviceArmed = 0;
+    _releaseBuffers ( cameraInfo );
     return -OA_ERR_SYSTEM_ERROR;
   }
 
@@ -1342,9 +1643,7 @@ _doStart ( V4L2_STATE* cameraInfo )
 static int
 _processStreamingStop ( V4L2_STATE* cameraInfo, OA_COMMAND* command )
 {
-  int           	queueEmpty;
-  unsigned int		n;
-  enum v4l2_buf_type	type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  enum v4l2_buf_type	type = cameraInfo->bufferType;
 
   if ( cameraInfo->runMode != CAM_RUN_MODE_STREAMING ) {
     return -OA_ERR_INVALID_COMMAND;
@@ -1354,35 +1653,87 @@ _processStreamingStop ( V4L2_STATE* cameraInfo, OA_COMMAND* command )
   cameraInfo->runMode = CAM_RUN_MODE_STOPPED;
   pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
 
+  if ( epoll_ctl ( cameraInfo->epollFd, EPOLL_CTL_DEL, cameraInfo->fd, 0 )) {
+    oaLogWarning ( OA_LOG_CAMERA, "%s: epoll_ctl failed, errno %d", __func__,
+        errno );
+  }
+  cameraInfo->deviceArmed = 0;
+
   if ( v4l2ioctl ( cameraInfo->fd, VIDIOC_STREAMOFF, &type ) < 0 ) {
     perror ( "VIDIOC_STREAMOFF" );
   }
+  cameraInfo->buffersQueued = 0;
 
   // We wait here until the callback queue has drained otherwise unmapping
   // the buffers could rip the image frame out from underneath the callback
 
-  queueEmpty = 0;
-  do {
-    pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
-    queueEmpty = ( cameraInfo->buffersGranted ==
-        cameraInfo->buffersFree ) ? 1 : 0;
-    pthread_mutex_unlock ( &cameraInfo->callbackQueueMutex );
-    if ( !queueEmpty ) {
-      usleep ( 100 );
-    }
-  } while ( !queueEmpty );
+  _oaWaitForBuffers ( cameraInfo, cameraInfo->configuredBuffers );
 
-  if ( cameraInfo->configuredBuffers ) {
-    for ( n = 0; n < cameraInfo->configuredBuffers; n++ ) {
-      v4l2_munmap ( cameraInfo->buffers[ n ].start,
-          cameraInfo->buffers[ n ].length );
-    }
+  _releaseBuffers ( cameraInfo );
+  pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
+  cameraInfo->requeueCount = 0;
+  pthread_mutex_unlock ( &cameraInfo->callbackQueueMutex );
 
+  return OA_ERR_NONE;
+}
+
+
+/**
+ * Close any exported DMABUF handles, unmap the buffers and give them back
+ * to the driver
+ */
+
+static void
+_releaseBuffers ( V4L2_STATE* cameraInfo )
+{
+  struct v4l2_requestbuffers	req;
+  int				n;
+
+  for ( n = 0; n < cameraInfo->configuredBuffers; n++ ) {
+    if ( cameraInfo->dmabufFds[ n ] >= 0 ) {
+      close ( cameraInfo->dmabufFds[ n ] );
+      cameraInfo->dmabufFds[ n ] = -1;
+    }
+    v4l2_munmap ( cameraInfo->buffers[ n ].start,
+        cameraInfo->buffers[ n ].length );
+  }
+  if ( cameraInfo->buffers ) {
     free (( void* ) cameraInfo->buffers );
+    cameraInfo->buffers = 0;
   }
   cameraInfo->configuredBuffers = cameraInfo->buffersFree = 0;
 
-  return OA_ERR_NONE;
+  OA_CLEAR ( req );
+  req.count = 0;
+  req.type = cameraInfo->bufferType;
+  req.memory = V4L2_MEMORY_MMAP;
+  ( void ) v4l2ioctl ( cameraInfo->fd, VIDIOC_REQBUFS, &req );
+}
+
+
+/**
+ * Check whether libv4l2 is converting the current format from something
+ * else the camera provides
+ */
+
+static int
+_formatIsEmulated ( V4L2_STATE* cameraInfo )
+{
+  struct v4l2_fmtdesc	formatDesc;
+  unsigned int		id;
+
+  for ( id = 0;; id++ ) {
+    OA_CLEAR ( formatDesc );
+    formatDesc.index = id;
+    formatDesc.type = cameraInfo->bufferType;
+    if ( v4l2ioctl ( cameraInfo->fd, VIDIOC_ENUM_FMT, &formatDesc )) {
+      break;
+    }
+    if ( formatDesc.pixelformat == cameraInfo->currentV4L2Format ) {
+      return ( formatDesc.flags & V4L2_FMT_FLAG_EMULATED ) ? 1 : 0;
+    }
+  }
+  return 0;
 }
 
 
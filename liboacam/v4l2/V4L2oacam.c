@@ -148,7 +148,8 @@ oaV4L2GetCameras ( CAMERA_LIST* deviceList, unsigned long featureFlags,
 			}
 			v4l2_close ( fd );
 
-			if (!( cap.device_caps & V4L2_CAP_VIDEO_CAPTURE )) {
+			if (!( cap.device_caps & ( V4L2_CAP_VIDEO_CAPTURE |
+					V4L2_CAP_VIDEO_CAPTURE_MPLANE ))) {
 				continue;
 			}
 
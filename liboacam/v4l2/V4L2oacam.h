@@ -49,6 +49,8 @@ extern int		oaV4L2CameraGetControlDiscreteSet ( oaCamera*, int,
 
 extern void*		oacamV4L2controller ( void* );
 extern void*		oacamV4L2callbackHandler ( void* );
+extern int		oaV4L2InitControllerEvents ( void* );
+extern void		oaV4L2FreeControllerEvents ( void* );
 
 extern const FRAMESIZES* oaV4L2CameraGetFrameSizes ( oaCamera* );
 extern const FRAMERATES* oaV4L2CameraGetFrameRates ( oaCamera*, int, int );
@@ -45,10 +45,26 @@ typedef struct V4L2_STATE {
   // video mode settings
   uint32_t		currentFrameFormat;
   uint32_t		currentV4L2Format;
+  // single- or multi-planar capture
+  enum v4l2_buf_type	bufferType;
   // buffering for image transfers
   frameBuffer*			buffers;
   struct v4l2_buffer	currentFrame[ OA_CAM_BUFFERS ];
+  struct v4l2_plane	currentPlanes[ OA_CAM_BUFFERS ];
+  FRAME_METADATA	metadataBuffers[ OA_CAM_BUFFERS ];
+  int			dmabufFds[ OA_CAM_BUFFERS ];
+  unsigned int		buffersRequested;
   unsigned int		buffersGranted;
+  unsigned int		buffersQueued;
+  // buffers returned by the callback thread waiting to go back to the
+  // driver
+  unsigned int		requeueBuffers[ OA_CAM_BUFFERS ];
+  unsigned int		requeueCount;
+  // frames the driver handed back flagged as corrupt
+  uint64_t		droppedFrames;
+  // event handling for the controller
+  int			epollFd;
+  int			deviceArmed;
   // camera status
   int			colourDxK;
   int			monoDMK;
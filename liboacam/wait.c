@@ -0,0 +1,139 @@
+/*****************************************************************************
+ *
+ * wait.c -- blocking waits for controller threads
+ *
+ * Copyright 2026 James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <oa_common.h>
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <openastro/util.h>
+
+#include "oacamprivate.h"
+#include "sharedState.h"
+
+
+/**
+ * Set deadline to be delayusec microseconds from now.  The deadline is in
+ * the same clock as used by pthread_cond_timedwait() on the condition
+ * variables set up by _oaInitCameraStructs(): the monotonic clock where
+ * condition variables can use it, so that setting the system time doesn't
+ * stretch or cut short a wait, and the realtime clock otherwise.
+ */
+
+void
+_oaDeadline ( struct timespec* deadline, uint64_t delayusec )
+{
+#if HAVE_PTHREAD_CONDATTR_SETCLOCK && defined(CLOCK_MONOTONIC)
+	struct timespec	now;
+	uint64_t				ns;
+
+	clock_gettime ( CLOCK_MONOTONIC, &now );
+	ns = ( uint64_t ) now.tv_nsec + ( delayusec % 1000000 ) * 1000;
+#else
+	struct timeval	now;
+	uint64_t				ns;
+
+	gettimeofday ( &now, 0 );
+	ns = ( uint64_t ) now.tv_usec * 1000 + ( delayusec % 1000000 ) * 1000;
+#endif
+	deadline->tv_sec = now.tv_sec + delayusec / 1000000 + ns / 1000000000;
+	deadline->tv_nsec = ns % 1000000000;
+}
+
+
+/**
+ * Block the controller thread until the deadline passes (or forever if
+ * there isn't one), the thread is told to stop or, if wakeOnCommand is
+ * set, a command is queued.  This relies on the controller being woken
+ * with oacamWakeController() or a broadcast on commandQueued, which the
+ * command and close functions already do.
+ */
+
+int
+_oaControllerWait ( void* state, const struct timespec* deadline,
+		int wakeOnCommand )
+{
+	SHARED_STATE*		cameraInfo = state;
+	int							ret = OA_WAIT_TIMEOUT;
+
+	pthread_mutex_lock ( &cameraInfo->commandQueueMutex );
+	while ( 1 ) {
+		if ( cameraInfo->stopControllerThread ) {
+			ret = OA_WAIT_STOP;
+			break;
+		}
+		if ( wakeOnCommand && !oaDLListIsEmpty ( cameraInfo->commandQueue )) {
+			ret = OA_WAIT_COMMAND;
+			break;
+		}
+		if ( deadline ) {
+			if ( pthread_cond_timedwait ( &cameraInfo->commandQueued,
+					&cameraInfo->commandQueueMutex, deadline ) == ETIMEDOUT ) {
+				break;
+			}
+		} else {
+			pthread_cond_wait ( &cameraInfo->commandQueued,
+					&cameraInfo->commandQueueMutex );
+		}
+	}
+	pthread_mutex_unlock ( &cameraInfo->commandQueueMutex );
+
+	return ret;
+}
+
+
+/**
+ * Wait until at least count frame buffers have been handed back by the
+ * callback thread.  The callback thread must return its buffers with
+ * _oaReturnBuffer() for this to wake up.
+ */
+
+void
+_oaWaitForBuffers ( void* state, int count )
+{
+	SHARED_STATE*		cameraInfo = state;
+
+	pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
+	while ( cameraInfo->buffersFree < count ) {
+		pthread_cond_wait ( &cameraInfo->callbackQueued,
+				&cameraInfo->callbackQueueMutex );
+	}
+	pthread_mutex_unlock ( &cameraInfo->callbackQueueMutex );
+}
+
+
+void
+_oaReturnBuffer ( void* state )
+{
+	SHARED_STATE*		cameraInfo = state;
+
+	pthread_mutex_lock ( &cameraInfo->callbackQueueMutex );
+	cameraInfo->buffersFree++;
+	pthread_mutex_unlock ( &cameraInfo->callbackQueueMutex );
+	// wakes anyone in _oaWaitForBuffers() as well as the callback thread,
+	// which doesn't mind
+	pthread_cond_broadcast ( &cameraInfo->callbackQueued );
+}
@@ -1389,6 +1389,7 @@ oaZWASI2InitCamera ( oaCameraDevice* device )
     cameraInfo->stopControllerThread = 1;
     pthread_cond_broadcast ( &cameraInfo->commandQueued );
     pthread_join ( cameraInfo->controllerThread, &dummy );
+		oacamAbortTimer ( cameraInfo );
 
     for ( i = 0; i < OA_CAM_BUFFERS; i++ ) {
       free (( void* ) cameraInfo->buffers[i].start );
@@ -1445,6 +1446,7 @@ oaZWASI2CloseCamera ( oaCamera* camera )
     cameraInfo->stopControllerThread = 1;
     pthread_cond_broadcast ( &cameraInfo->commandQueued );
     pthread_join ( cameraInfo->controllerThread, &dummy );
+		oacamAbortTimer ( cameraInfo );
 
     cameraInfo->stopCallbackThread = 1;
     pthread_cond_broadcast ( &cameraInfo->callbackQueued );
@@ -1464,6 +1466,7 @@ oaZWASI2CloseCamera ( oaCamera* camera )
         free (( void* ) cameraInfo->frameSizes[j].sizes );
     }
 
+    oacamFlushAsync ( cameraInfo );
     oaDLListDelete ( cameraInfo->commandQueue, 1 );
     oaDLListDelete ( cameraInfo->callbackQueue, 0 );
 
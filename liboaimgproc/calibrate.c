@@ -0,0 +1,398 @@
+/*****************************************************************************
+ *
+ * calibrate.c -- bias, dark and flat calibration of raw frames
+ *
+ * Copyright 2026
+ *   James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <oa_common.h>
+
+#include <openastro/imgproc.h>
+#include <openastro/errno.h>
+#include <openastro/util.h>
+#include <openastro/video/formats.h>
+
+#include "threads.h"
+
+// Flats are held as reciprocals with this many fractional bits, so the
+// largest correction is 16x.  With that limit the product of a 16-bit
+// pixel and the reciprocal always fits in 32 bits
+
+#define	FLAT_SHIFT		12
+#define	FLAT_ONE		( 1 << FLAT_SHIFT )
+#define	FLAT_MAX		0xffff
+
+typedef struct {
+  oaCalibration*	cal;
+  void*			frame;
+  unsigned int		first;
+  unsigned int		last;
+} calibrationJob;
+
+static void*	_calibratePixels ( void* );
+static void	_calibrate8 ( uint8_t*, const uint16_t*, const uint16_t*,
+		    unsigned int, unsigned int );
+static void	_calibrate16 ( uint16_t*, const uint16_t*, const uint16_t*,
+		    unsigned int, unsigned int );
+static void	_calibrate16Swapped ( uint8_t*, const uint16_t*,
+		    const uint16_t*, unsigned int, unsigned int, int );
+static void	_updateOffset ( oaCalibration*, int64_t );
+
+
+/**
+ * Set up calibration for frames of the given size and format, which must
+ * be mono or raw colour and not packed.  Master frames are always held
+ * as 16-bit values in the same range as the frame's pixels, whatever the
+ * frame's depth.  numThreads of zero uses one thread per processor.
+ */
+
+int
+oaCalibrationInit ( oaCalibration* cal, int xSize, int ySize,
+    int frameFormat, int numThreads )
+{
+  frameFormatInfo*	fmt;
+  unsigned int		one = 1;
+
+  memset ( cal, 0, sizeof ( oaCalibration ));
+  cal->xSize = xSize;
+  cal->ySize = ySize;
+  cal->frameFormat = frameFormat;
+
+  if ( frameFormat <= 0 || frameFormat >= OA_PIX_FMT_LAST_P1 ) {
+    return -OA_ERR_UNSUPPORTED_FORMAT;
+  }
+  if ( xSize < 1 || ySize < 1 ) {
+    return -OA_ERR_INVALID_SIZE;
+  }
+  fmt = &oaFrameFormats[ frameFormat ];
+  if (( !fmt->monochrome && !fmt->rawColour ) || fmt->packed ||
+      ( fmt->bytesPerPixel != 1 && fmt->bytesPerPixel != 2 )) {
+    oaLogError ( OA_LOG_IMGPROC, "%s: can't calibrate format %s", __func__,
+        fmt->name );
+    return -OA_ERR_UNSUPPORTED_FORMAT;
+  }
+
+  cal->numPixels = xSize * ySize;
+  cal->bytesPerSample = fmt->bytesPerPixel;
+  cal->maxValue = ( cal->bytesPerSample == 1 ) ? 0xff : 0xffff;
+  cal->offsetExposure = -1;
+  // Whether 16-bit frames can be treated as an array of uint16_t
+  cal->nativeOrder = ( fmt->littleEndian ? 1 : 0 ) ==
+      *(( uint8_t* ) &one );
+
+  cal->numThreads = _oaImgprocThreads ( numThreads, cal->numPixels,
+      OA_CALIBRATION_MAX_THREADS );
+
+  if (!( cal->offset = malloc ( cal->numPixels * sizeof ( uint16_t )))) {
+    return -OA_ERR_MEM_ALLOC;
+  }
+  return OA_ERR_NONE;
+}
+
+
+void
+oaCalibrationFree ( oaCalibration* cal )
+{
+  if ( cal->bias ) {
+    free ( cal->bias );
+  }
+  if ( cal->dark ) {
+    free ( cal->dark );
+  }
+  if ( cal->invFlat ) {
+    free ( cal->invFlat );
+  }
+  if ( cal->offset ) {
+    free ( cal->offset );
+  }
+  cal->bias = cal->dark = cal->invFlat = cal->offset = 0;
+}
+
+
+/**
+ * Load a master bias.  It's only needed separately from the dark if the
+ * dark is to be scaled for exposure time, or to remove the bias from the
+ * flat, in which case it must be loaded before the flat.
+ */
+
+int
+oaCalibrationSetBias ( oaCalibration* cal, const uint16_t* bias )
+{
+  if ( !cal->offset ) {
+    return -OA_ERR_INVALID_SIZE;
+  }
+  if ( !cal->bias && !( cal->bias = malloc ( cal->numPixels *
+      sizeof ( uint16_t )))) {
+    return -OA_ERR_MEM_ALLOC;
+  }
+  memcpy ( cal->bias, bias, cal->numPixels * sizeof ( uint16_t ));
+  cal->offsetExposure = -1;
+  return OA_ERR_NONE;
+}
+
+
+/**
+ * Load a master dark taken with the given exposure time.  If scaleDark
+ * is set and a bias is loaded the thermal signal, dark minus bias, is
+ * scaled by the ratio of each frame's exposure time to this one.
+ */
+
+int
+oaCalibrationSetDark ( oaCalibration* cal, const uint16_t* dark,
+    int64_t exposure, int scaleDark )
+{
+  if ( !cal->offset ) {
+    return -OA_ERR_INVALID_SIZE;
+  }
+  if ( !cal->dark && !( cal->dark = malloc ( cal->numPixels *
+      sizeof ( uint16_t )))) {
+    return -OA_ERR_MEM_ALLOC;
+  }
+  memcpy ( cal->dark, dark, cal->numPixels * sizeof ( uint16_t ));
+  cal->darkExposure = exposure;
+  cal->scaleDark = scaleDark && exposure > 0;
+  cal->offsetExposure = -1;
+  return OA_ERR_NONE;
+}
+
+
+/**
+ * Load a master flat and turn it into fixed point reciprocals normalised
+ * to the mean of the flat, so applying it is a multiply.  For raw colour
+ * each of the four photosites of the CFA cell is normalised separately
+ * so the flat doesn't change the colour balance.  Pixels that are zero
+ * in the flat get the largest possible correction.
+ */
+
+int
+oaCalibrationSetFlat ( oaCalibration* cal, const uint16_t* flat )
+{
+  frameFormatInfo*	fmt;
+  double		sum[4], mean[4];
+  unsigned int		count[4];
+  unsigned int		i, x, y, cell;
+  int			v;
+
+  if ( !cal->offset ) {
+    return -OA_ERR_INVALID_SIZE;
+  }
+  if ( !cal->invFlat && !( cal->invFlat = malloc ( cal->numPixels *
+      sizeof ( uint16_t )))) {
+    return -OA_ERR_MEM_ALLOC;
+  }
+
+  fmt = &oaFrameFormats[ cal->frameFormat ];
+  for ( i = 0; i < 4; i++ ) {
+    sum[i] = 0;
+    count[i] = 0;
+  }
+  for ( y = 0, i = 0; y < ( unsigned int ) cal->ySize; y++ ) {
+    for ( x = 0; x < ( unsigned int ) cal->xSize; x++, i++ ) {
+      cell = fmt->rawColour ? (( y & 1 ) << 1 ) | ( x & 1 ) : 0;
+      v = flat[i] - ( cal->bias ? cal->bias[i] : 0 );
+      sum[ cell ] += v > 0 ? v : 0;
+      count[ cell ]++;
+    }
+  }
+  for ( i = 0; i < 4; i++ ) {
+    mean[i] = count[i] ? sum[i] / count[i] : 0;
+  }
+
+  for ( y = 0, i = 0; y < ( unsigned int ) cal->ySize; y++ ) {
+    for ( x = 0; x < ( unsigned int ) cal->xSize; x++, i++ ) {
+      cell = fmt->rawColour ? (( y & 1 ) << 1 ) | ( x & 1 ) : 0;
+      v = flat[i] - ( cal->bias ? cal->bias[i] : 0 );
+      if ( v <= 0 || mean[ cell ] * FLAT_ONE / v > FLAT_MAX ) {
+        cal->invFlat[i] = FLAT_MAX;
+      } else {
+        cal->invFlat[i] = mean[ cell ] * FLAT_ONE / v + 0.5;
+      }
+    }
+  }
+  return OA_ERR_NONE;
+}
+
+
+/**
+ * Calibrate a frame in place.  The exposure time is only used if the
+ * dark is being scaled, and the combined bias and dark offset is only
+ * recalculated when it changes.  Everything else is one pass over the
+ * frame, split between the threads.
+ */
+
+int
+oaCalibrationApply ( oaCalibration* cal, void* frame, int64_t exposure )
+{
+  calibrationJob	jobs[ OA_CALIBRATION_MAX_THREADS ];
+  int			i;
+
+  if ( !cal->offset ) {
+    return -OA_ERR_INVALID_SIZE;
+  }
+  if ( !cal->bias && !cal->dark && !cal->invFlat ) {
+    return OA_ERR_NONE;
+  }
+
+  if ( cal->offsetExposure < 0 || ( cal->scaleDark &&
+      cal->offsetExposure != exposure )) {
+    _updateOffset ( cal, exposure );
+  }
+
+  for ( i = 0; i < cal->numThreads; i++ ) {
+    jobs[i].cal = cal;
+    jobs[i].frame = frame;
+    _oaImgprocChunk ( cal->numPixels, cal->numThreads, i, 64,
+        &jobs[i].first, &jobs[i].last );
+  }
+  _oaImgprocRun ( _calibratePixels, jobs, sizeof ( calibrationJob ),
+      cal->numThreads );
+  return OA_ERR_NONE;
+}
+
+
+/**
+ * Combine the bias and dark into the single offset that is subtracted
+ * from each frame
+ */
+
+static void
+_updateOffset ( oaCalibration* cal, int64_t exposure )
+{
+  unsigned int	i;
+  double	scale;
+  int		v;
+
+  if ( cal->dark && cal->scaleDark && cal->bias ) {
+    scale = ( double ) exposure / cal->darkExposure;
+    for ( i = 0; i < cal->numPixels; i++ ) {
+      v = cal->bias[i] + ( cal->dark[i] - cal->bias[i] ) * scale + 0.5;
+      cal->offset[i] = oaclamp ( 0, 0xffff, v );
+    }
+  } else if ( cal->dark ) {
+    memcpy ( cal->offset, cal->dark, cal->numPixels * sizeof ( uint16_t ));
+  } else if ( cal->bias ) {
+    memcpy ( cal->offset, cal->bias, cal->numPixels * sizeof ( uint16_t ));
+  } else {
+    memset ( cal->offset, 0, cal->numPixels * sizeof ( uint16_t ));
+  }
+  cal->offsetExposure = exposure;
+}
+
+
+static void*
+_calibratePixels ( void* param )
+{
+  calibrationJob*	job = param;
+  oaCalibration*	cal = job->cal;
+  const uint16_t*	offset = cal->offset + job->first;
+  const uint16_t*	inv = cal->invFlat ? cal->invFlat + job->first : 0;
+  unsigned int		n = job->last - job->first;
+
+  if ( cal->bytesPerSample == 1 ) {
+    _calibrate8 (( uint8_t* ) job->frame + job->first, offset, inv, n,
+        cal->maxValue );
+  } else if ( cal->nativeOrder ) {
+    _calibrate16 (( uint16_t* ) job->frame + job->first, offset, inv, n,
+        cal->maxValue );
+  } else {
+    _calibrate16Swapped (( uint8_t* ) job->frame + 2 * job->first, offset,
+        inv, n, cal->maxValue, oaFrameFormats[ cal->frameFormat ].
+        littleEndian );
+  }
+  return 0;
+}
+
+
+/**
+ * The kernels are simple loops over contiguous arrays with the flat test
+ * taken outside, so the compiler can vectorise them
+ */
+
+static void
+_calibrate8 ( uint8_t* restrict p, const uint16_t* restrict offset,
+    const uint16_t* restrict inv, unsigned int n, unsigned int max )
+{
+  unsigned int	i;
+  int32_t	v;
+  uint32_t	u;
+
+  if ( inv ) {
+    for ( i = 0; i < n; i++ ) {
+      v = p[i] - offset[i];
+      u = v < 0 ? 0 : v;
+      u = ( u * inv[i] + FLAT_ONE / 2 ) >> FLAT_SHIFT;
+      p[i] = u > max ? max : u;
+    }
+  } else {
+    for ( i = 0; i < n; i++ ) {
+      v = p[i] - offset[i];
+      p[i] = v < 0 ? 0 : v;
+    }
+  }
+}
+
+
+static void
+_calibrate16 ( uint16_t* restrict p, const uint16_t* restrict offset,
+    const uint16_t* restrict inv, unsigned int n, unsigned int max )
+{
+  unsigned int	i;
+  int32_t	v;
+  uint32_t	u;
+
+  if ( inv ) {
+    for ( i = 0; i < n; i++ ) {
+      v = p[i] - offset[i];
+      u = v < 0 ? 0 : v;
+      u = ( u * inv[i] + FLAT_ONE / 2 ) >> FLAT_SHIFT;
+      p[i] = u > max ? max : u;
+    }
+  } else {
+    for ( i = 0; i < n; i++ ) {
+      v = p[i] - offset[i];
+      p[i] = v < 0 ? 0 : v;
+    }
+  }
+}
+
+
+static void
+_calibrate16Swapped ( uint8_t* p, const uint16_t* offset,
+    const uint16_t* inv, unsigned int n, unsigned int max, int littleEndian )
+{
+  unsigned int	i;
+  int		hi = littleEndian ? 1 : 0, lo = 1 - hi;
+  int32_t	v;
+  uint32_t	u;
+
+  for ( i = 0; i < n; i++, p += 2 ) {
+    v = (( p[ hi ] << 8 ) | p[ lo ] ) - offset[i];
+    u = v < 0 ? 0 : v;
+    if ( inv ) {
+      u = ( u * inv[i] + FLAT_ONE / 2 ) >> FLAT_SHIFT;
+      u = u > max ? max : u;
+    }
+    p[ hi ] = u >> 8;
+    p[ lo ] = u & 0xff;
+  }
+}
@@ -2,7 +2,7 @@
  *
  * focus.c -- focus scoring algorithms
  *
- * Copyright 2015,2017,2018,2021
+ * Copyright 2015,2017,2018,2021,2026
  *   James Fidell (james@openastroproject.org)
  *
  * License:
@@ -27,204 +27,402 @@
 
 #include <oa_common.h>
 
+#include <limits.h>
+
 #include <openastro/imgproc.h>
 #include <openastro/demosaic.h>
 #include <openastro/errno.h>
 #include <openastro/util.h>
 #include <openastro/video/formats.h>
 
-#include "sobel.h"
-#include "scharr.h"
-#include "gauss.h"
+// Number of rows of workspace: three of source luminance and three of
+// blurred luminance
+
+#define	FOCUS_ROWS	6
 
+static void	_loadRow ( oaFocusContext*, uint8_t*, int, int32_t* );
+static void	_blurRow ( const int32_t*, const int32_t*, const int32_t*,
+		    int32_t*, int );
+static uint64_t	_sobelRow ( const int32_t*, const int32_t*, const int32_t*,
+		    int );
+static void	_edgeRow ( const int32_t*, const int32_t*, const int32_t*,
+		    uint8_t*, int, int );
+static void	_setBounds ( oaFocusContext* );
+
+
+/**
+ * Set up a context for scoring frames of the given size and format.  All
+ * the workspace needed is allocated here so that scoring a frame never
+ * has to allocate memory.
+ *
+ * Frames are scored on a luminance image.  Mono frames are used as they
+ * are at whatever bit depth they have, full colour frames are converted
+ * to luminance and raw colour frames use only their green pixels, summed
+ * for each 2x2 cell of the CFA, so the scored image is half the size of
+ * the frame in each direction.
+ */
 
 int
-oaFocusScore ( void* source, void* target, int xSize, int ySize,
+oaFocusInit ( oaFocusContext* context, int xSize, int ySize,
     int frameFormat )
 {
-  void*		currentSource = source;
-  void*		currentTarget = target;
-  void*		workspace1;
-  void*		workspace2;
-  int		freeSource, freeTarget;
-  int		numPixels, result, canProcess;
-  int		cfaPattern = 0, new8BitFormat = 0;
-
-  freeSource = freeTarget = canProcess = 0;
-  numPixels = xSize * ySize;
-  workspace1 = workspace2 = 0;
-
-  if ( oaFrameFormats[ frameFormat ].rawColour ) {
-    switch ( frameFormat ) {
-      case OA_PIX_FMT_RGGB8:
-      case OA_PIX_FMT_RGGB16LE:
-      case OA_PIX_FMT_RGGB16BE:
-        cfaPattern = OA_DEMOSAIC_RGGB;
-        new8BitFormat = OA_PIX_FMT_RGGB8;
-        break;
-      case OA_PIX_FMT_BGGR8:
-      case OA_PIX_FMT_BGGR16LE:
-      case OA_PIX_FMT_BGGR16BE:
-        cfaPattern = OA_DEMOSAIC_BGGR;
-        new8BitFormat = OA_PIX_FMT_BGGR8;
-        break;
-      case OA_PIX_FMT_GRBG8:
-      case OA_PIX_FMT_GRBG16LE:
-      case OA_PIX_FMT_GRBG16BE:
-        cfaPattern = OA_DEMOSAIC_GRBG;
-        new8BitFormat = OA_PIX_FMT_GRBG8;
+  frameFormatInfo*	fmt;
+  int			maxValue;
+
+  // The size and format are kept even if they can't be handled, so
+  // callers can tell whether they need to try again
+  memset ( context, 0, sizeof ( oaFocusContext ));
+  context->frameFormat = frameFormat;
+  context->xSize = xSize;
+  context->ySize = ySize;
+
+  if ( frameFormat <= 0 || frameFormat >= OA_PIX_FMT_LAST_P1 ) {
+    return -OA_ERR_UNSUPPORTED_FORMAT;
+  }
+  fmt = &oaFrameFormats[ frameFormat ];
+  if ( fmt->packed || fmt->planar || fmt->lumChrom || fmt->hasAlpha ) {
+    oaLogError ( OA_LOG_IMGPROC, "%s: can't handle format %s", __func__,
+        fmt->name );
+    return -OA_ERR_UNSUPPORTED_FORMAT;
+  }
+
+  maxValue = ( 1 << fmt->bitsPerPixel ) - 1;
+  context->workX = xSize;
+  context->workY = ySize;
+
+  if ( fmt->monochrome && ( fmt->bytesPerPixel == 1 ||
+      fmt->bytesPerPixel == 2 )) {
+    context->fullScale = maxValue;
+  } else if (( OA_PIX_FMT_RGB24 == frameFormat ||
+      OA_PIX_FMT_BGR24 == frameFormat )) {
+    // L = 5/16.R + 9/16.G + 1/8.B, without the division
+    context->fullScale = 16 * 255;
+  } else if ( fmt->rawColour && ( fmt->bytesPerPixel == 1 ||
+      fmt->bytesPerPixel == 2 )) {
+    switch ( fmt->cfaPattern ) {
+      case OA_DEMOSAIC_RGGB:
+      case OA_DEMOSAIC_BGGR:
+        context->greenOffset = 1;
         break;
-      case OA_PIX_FMT_GBRG8:
-      case OA_PIX_FMT_GBRG16LE:
-      case OA_PIX_FMT_GBRG16BE:
-        cfaPattern = OA_DEMOSAIC_GBRG;
-        new8BitFormat = OA_PIX_FMT_GBRG8;
+      case OA_DEMOSAIC_GRBG:
+      case OA_DEMOSAIC_GBRG:
+        context->greenOffset = 0;
         break;
       default:
-        oaLogError ( OA_LOG_IMGPROC, "%s: can't handle format %d", __func__,
-            frameFormat );
-        // FIX ME --return meaningful error code
-        return -1;
-        break;
+        oaLogError ( OA_LOG_IMGPROC, "%s: can't handle CFA pattern for %s",
+            __func__, fmt->name );
+        return -OA_ERR_UNSUPPORTED_FORMAT;
     }
+    context->workX = xSize / 2;
+    context->workY = ySize / 2;
+    context->fullScale = 2 * maxValue;
+  } else {
+    oaLogError ( OA_LOG_IMGPROC, "%s: can't handle format %s", __func__,
+        fmt->name );
+    return -OA_ERR_UNSUPPORTED_FORMAT;
+  }
 
-    if ( oaFrameFormats[ frameFormat ].bitsPerPixel == 16 ) {
-      int i, length = xSize * ySize;
-      uint8_t* s = currentSource;
-      uint8_t* t;
+  // The blur and the gradient each need one pixel all round, so the
+  // smallest image that can give a score is 5x5
+  if ( context->workX < 5 || context->workY < 5 ) {
+    return -OA_ERR_INVALID_SIZE;
+  }
 
-      if (!( workspace1 = malloc ( xSize * ySize ))) {
-        return -OA_ERR_MEM_ALLOC;
-      }
-      t = workspace1;
-      if ( oaFrameFormats[ frameFormat ].littleEndian ) {
-        s++;
-      }
-      for ( i = 0; i < length; i++ ) {
-        *t++ = *s++;
-        s++;
-      }
-      currentSource = workspace1;
-      frameFormat = new8BitFormat;
-    }
+  if (!( context->workspace = malloc ( FOCUS_ROWS * context->workX *
+      sizeof ( int32_t )))) {
+    return -OA_ERR_MEM_ALLOC;
+  }
 
-    if ( oaFrameFormats[ frameFormat ].bitsPerPixel == 8 ) {
-      if (!( workspace2 = malloc ( xSize * ySize * 3 ))) {
-        return -OA_ERR_MEM_ALLOC;
-      }
-      oademosaic ( currentSource, workspace2, xSize, ySize, 8,
-          cfaPattern, OA_DEMOSAIC_NEAREST_NEIGHBOUR );
-      currentSource = workspace2;
-      frameFormat = OA_PIX_FMT_RGB24;
-    }
+  _setBounds ( context );
+  return OA_ERR_NONE;
+}
+
+
+/**
+ * Restrict scoring to a rectangle of the frame, given in frame pixels.
+ * A width or height of zero scores the whole frame.
+ */
+
+int
+oaFocusSetROI ( oaFocusContext* context, int x, int y, int width,
+    int height )
+{
+  if ( x < 0 || y < 0 || width < 0 || height < 0 ||
+      x + width > context->xSize || y + height > context->ySize ) {
+    return -OA_ERR_OUT_OF_RANGE;
+  }
+  context->roiX = x;
+  context->roiY = y;
+  context->roiWidth = width;
+  context->roiHeight = height;
+  _setBounds ( context );
+  return OA_ERR_NONE;
+}
+
+
+void
+oaFocusFree ( oaFocusContext* context )
+{
+  if ( context->workspace ) {
+    free ( context->workspace );
   }
+  context->workspace = 0;
+}
 
-  if ( OA_PIX_FMT_RGB24 == frameFormat || OA_PIX_FMT_BGR24 == frameFormat ) {
-    uint8_t*	s;
-    uint8_t*	t;
-    int		n = numPixels, v;
 
-    if (!( currentTarget = malloc ( xSize * ySize ))) {
-      return -OA_ERR_MEM_ALLOC;
-    }
+/**
+ * Score a frame.  The score is the mean squared Sobel gradient of the
+ * Gaussian blurred luminance image over the ROI, scaled as though the
+ * image were 8-bit so that scores are comparable across bit depths.
+ *
+ * The blur and gradient are done together a row at a time on a
+ * three-row ring buffer, so no intermediate images are written.  If
+ * target is not NULL the gradient magnitude is also written to it as an
+ * 8-bit image the size of the scored image.
+ */
+
+int
+oaFocusScoreFrame ( oaFocusContext* context, void* frame, void* target,
+    double* score )
+{
+  int32_t*	src[3];
+  int32_t*	blur[3];
+  int32_t*	ws;
+  uint8_t*	t;
+  double	total, norm;
+  int		width, r, i, x0, y0, x1, y1;
+
+  if ( !context->workspace ) {
+    return -OA_ERR_INVALID_SIZE;
+  }
 
-    // Convert the colours to a luminance value
-    // These seem to be common formulae:
-    // L = 0.3086.R + 0.6094.G + 0.0820.B
-    // L = 0.299.R + 0.587.G + 0.114.B
-    //
-    // To make life easy and remove multiplications I'm going to use
-    // L = 5/16.R + 9/16.G + 1/8.B
-    // which works out as
-    // L = 0.3125.R + 0.5625.G + 0.125.B
-
-    t = currentTarget;
-    s = currentSource;
-    while ( n-- ) {
-      if ( OA_PIX_FMT_RGB24 == frameFormat ) {
-        v = ( *s << 2 ) + *s;
-        s++;
-        v += ( *s << 3 ) + *s;
-        s++;
-        v += *s << 1;
-        s++;
-      } else {
-        v += *s << 1;
-        s++;
-        v += ( *s << 3 ) + *s;
-        s++;
-        v = ( *s << 2 ) + *s;
-        s++;
+  x0 = context->x0;
+  y0 = context->y0;
+  x1 = context->x1;
+  y1 = context->y1;
+
+  // Source rows cover two pixels either side of the ROI and blurred rows
+  // one pixel either side
+  width = x1 - x0 + 4;
+  ws = context->workspace;
+  for ( i = 0; i < 3; i++ ) {
+    src[i] = ws + i * context->workX;
+    blur[i] = ws + ( i + 3 ) * context->workX;
+  }
+
+  if ( target ) {
+    memset ( target, 0, context->workX * context->workY );
+  }
+
+  _loadRow ( context, frame, y0 - 2, src[( y0 - 2 ) % 3 ] );
+  _loadRow ( context, frame, y0 - 1, src[( y0 - 1 ) % 3 ] );
+  total = 0;
+  for ( r = y0 - 1; r <= y1; r++ ) {
+    _loadRow ( context, frame, r + 1, src[( r + 1 ) % 3 ] );
+    _blurRow ( src[( r - 1 ) % 3 ], src[ r % 3 ], src[( r + 1 ) % 3 ],
+        blur[ r % 3 ], width - 2 );
+    if ( r > y0 ) {
+      total += _sobelRow ( blur[( r - 2 ) % 3 ], blur[( r - 1 ) % 3 ],
+          blur[ r % 3 ], x1 - x0 );
+      if ( target ) {
+        t = ( uint8_t* ) target + ( r - 1 ) * context->workX + x0;
+        _edgeRow ( blur[( r - 2 ) % 3 ], blur[( r - 1 ) % 3 ], blur[ r % 3 ],
+            t, x1 - x0, context->fullScale );
       }
-      *t++ = v >> 4;
     }
-    currentSource = currentTarget;
-    freeSource = 1;
-    canProcess = 1;
   }
 
-  if ( workspace1 ) {
-    free ( workspace1 );
-    workspace1 = 0;
+  // Remove the factor of 16 from the blur and scale to 8 bits
+  norm = 255.0 / ( 16.0 * context->fullScale );
+  *score = total * norm * norm / (( double ) ( x1 - x0 ) * ( y1 - y0 ));
+  return OA_ERR_NONE;
+}
+
+
+/**
+ * Single-shot focus score for callers that don't want to keep a context.
+ * This has to allocate and free the workspace on every call, so anything
+ * scoring a stream of frames should use oaFocusScoreFrame() instead.
+ */
+
+int
+oaFocusScore ( void* source, void* target, int xSize, int ySize,
+    int frameFormat )
+{
+  oaFocusContext	context;
+  double		score;
+  int			ret;
+
+  if (( ret = oaFocusInit ( &context, xSize, ySize, frameFormat )) !=
+      OA_ERR_NONE ) {
+    return ret;
   }
-  if ( workspace2 ) {
-    free ( workspace2 );
-    workspace1 = 0;
+  ret = oaFocusScoreFrame ( &context, source, target, &score );
+  oaFocusFree ( &context );
+  if ( ret != OA_ERR_NONE ) {
+    return ret;
   }
+  return ( score > INT_MAX ) ? INT_MAX : ( int ) score;
+}
 
-  if ( OA_PIX_FMT_GREY16BE == frameFormat ||
-      OA_PIX_FMT_GREY16LE == frameFormat ) {
-    uint8_t*	s;
-    uint8_t*	t;
-    int		n = numPixels;
 
-    if (!( currentTarget = malloc ( xSize * ySize ))) {
-      return -OA_ERR_MEM_ALLOC;
-    }
+/**
+ * Work out the rows and columns of the scored image to produce gradients
+ * for, keeping two pixels clear of the edges for the 5x5 support of the
+ * blur and gradient together
+ */
 
-    t = currentTarget;
-    s = currentSource;
-    if ( OA_PIX_FMT_GREY16LE == frameFormat ) {
-      s++;
-    }
-    while ( n-- ) {
-      *t++ = *s++;
-      s++;
-    }
-    currentSource = currentTarget;
-    freeSource = 1;
-    canProcess = 1;
+static void
+_setBounds ( oaFocusContext* context )
+{
+  int		x0, y0, x1, y1, div;
+
+  if ( context->roiWidth && context->roiHeight ) {
+    div = oaFrameFormats[ context->frameFormat ].rawColour ? 2 : 1;
+    x0 = context->roiX / div;
+    y0 = context->roiY / div;
+    x1 = ( context->roiX + context->roiWidth ) / div;
+    y1 = ( context->roiY + context->roiHeight ) / div;
+  } else {
+    x0 = y0 = 0;
+    x1 = context->workX;
+    y1 = context->workY;
   }
 
-  if ( canProcess || OA_PIX_FMT_GREY8 == frameFormat ) {
-    if (!( currentTarget = malloc ( numPixels ))) {
-      if ( freeSource ) {
-        free ( currentSource );
+  context->x0 = oaclamp ( 2, context->workX - 3, x0 );
+  context->y0 = oaclamp ( 2, context->workY - 3, y0 );
+  context->x1 = oaclamp ( context->x0 + 1, context->workX - 2, x1 );
+  context->y1 = oaclamp ( context->y0 + 1, context->workY - 2, y1 );
+}
+
+
+/**
+ * Fill a row of luminance values starting two pixels left of the ROI.
+ * Each case is a simple loop over contiguous memory that the compiler
+ * can vectorise.
+ */
+
+static void
+_loadRow ( oaFocusContext* context, uint8_t* frame, int row, int32_t* t )
+{
+  frameFormatInfo*	fmt = &oaFrameFormats[ context->frameFormat ];
+  const uint8_t*	s;
+  const uint8_t*	s1;
+  int			i, n, x, hi, lo;
+
+  x = context->x0 - 2;
+  n = context->x1 - context->x0 + 4;
+  hi = fmt->littleEndian ? 1 : 0;
+  lo = 1 - hi;
+
+  if ( fmt->rawColour ) {
+    // Both greens in each 2x2 cell.  One is at greenOffset in the even
+    // row and the other at the opposite column in the odd row
+    s = frame + ( 2 * row * context->xSize + 2 * x + context->greenOffset ) *
+        ( int ) fmt->bytesPerPixel;
+    s1 = frame + (( 2 * row + 1 ) * context->xSize + 2 * x + 1 -
+        context->greenOffset ) * ( int ) fmt->bytesPerPixel;
+    if ( fmt->bytesPerPixel == 1 ) {
+      for ( i = 0; i < n; i++ ) {
+        t[i] = s[ 2 * i ] + s1[ 2 * i ];
+      }
+    } else {
+      for ( i = 0; i < n; i++ ) {
+        t[i] = (( s[ 4 * i + hi ] << 8 ) | s[ 4 * i + lo ] ) +
+            (( s1[ 4 * i + hi ] << 8 ) | s1[ 4 * i + lo ] );
       }
-      return -OA_ERR_MEM_ALLOC;
     }
-    gauss8_3x3 ( currentSource, currentTarget, xSize, ySize );
-    currentSource = currentTarget;
-    freeSource = 1;
-    if ( target ) {
-      currentTarget = target;
+    return;
+  }
+
+  if ( fmt->monochrome ) {
+    s = frame + ( row * context->xSize + x ) * ( int ) fmt->bytesPerPixel;
+    if ( fmt->bytesPerPixel == 1 ) {
+      for ( i = 0; i < n; i++ ) {
+        t[i] = s[i];
+      }
     } else {
-      if (!( currentTarget = malloc ( numPixels ))) {
-        free ( currentSource );
-        return -OA_ERR_MEM_ALLOC;
+      for ( i = 0; i < n; i++ ) {
+        t[i] = ( s[ 2 * i + hi ] << 8 ) | s[ 2 * i + lo ];
       }
-      freeTarget = 1;
     }
-    result = sobel8 ( currentSource, currentTarget, xSize, ySize );
-    if ( freeTarget ) {
-      free ( currentTarget );
+    return;
+  }
+
+  // L = 5/16.R + 9/16.G + 1/8.B, as 5.R + 9.G + 2.B
+  s = frame + ( row * context->xSize + x ) * 3;
+  if ( OA_PIX_FMT_RGB24 == context->frameFormat ) {
+    for ( i = 0; i < n; i++ ) {
+      t[i] = 5 * s[ 3 * i ] + 9 * s[ 3 * i + 1 ] + 2 * s[ 3 * i + 2 ];
     }
-    if ( freeSource ) {
-      free ( currentSource );
+  } else {
+    for ( i = 0; i < n; i++ ) {
+      t[i] = 2 * s[ 3 * i ] + 9 * s[ 3 * i + 1 ] + 5 * s[ 3 * i + 2 ];
     }
-    return result;
   }
+}
+
+
+/**
+ * 3x3 Gaussian of three source rows, without the division by 16
+ */
+
+static void
+_blurRow ( const int32_t* restrict s0, const int32_t* restrict s1,
+    const int32_t* restrict s2, int32_t* restrict t, int n )
+{
+  int		i;
+
+  for ( i = 0; i < n; i++ ) {
+    t[i] = s0[i] + 2 * s0[ i + 1 ] + s0[ i + 2 ] +
+        2 * ( s1[i] + 2 * s1[ i + 1 ] + s1[ i + 2 ] ) +
+        s2[i] + 2 * s2[ i + 1 ] + s2[ i + 2 ];
+  }
+}
+
+
+/**
+ * Sum of gx^2 + gy^2 along a row of blurred values
+ */
+
+static uint64_t
+_sobelRow ( const int32_t* restrict b0, const int32_t* restrict b1,
+    const int32_t* restrict b2, int n )
+{
+  int64_t	gx, gy;
+  uint64_t	sum = 0;
+  int		i;
+
+  for ( i = 0; i < n; i++ ) {
+    gx = ( b0[i] + 2 * b1[i] + b2[i] ) -
+        ( b0[ i + 2 ] + 2 * b1[ i + 2 ] + b2[ i + 2 ] );
+    gy = ( b0[i] + 2 * b0[ i + 1 ] + b0[ i + 2 ] ) -
+        ( b2[i] + 2 * b2[ i + 1 ] + b2[ i + 2 ] );
+    sum += gx * gx + gy * gy;
+  }
+  return sum;
+}
+
+
+/**
+ * Gradient magnitude |gx| + |gy| scaled to 8 bits, for callers that want
+ * the edge image
+ */
 
-  // FIX ME -- return more meaningful error
-  return -1;
+static void
+_edgeRow ( const int32_t* b0, const int32_t* b1, const int32_t* b2,
+    uint8_t* t, int n, int fullScale )
+{
+  int64_t	gx, gy, v, div;
+  int		i;
+
+  div = 16 * ( int64_t ) fullScale;
+  for ( i = 0; i < n; i++ ) {
+    gx = ( b0[i] + 2 * b1[i] + b2[i] ) -
+        ( b0[ i + 2 ] + 2 * b1[ i + 2 ] + b2[ i + 2 ] );
+    gy = ( b0[i] + 2 * b0[ i + 1 ] + b0[ i + 2 ] ) -
+        ( b2[i] + 2 * b2[ i + 1 ] + b2[ i + 2 ] );
+    v = (( gx < 0 ? -gx : gx ) + ( gy < 0 ? -gy : gy )) * 255 / div;
+    t[i] = v > 255 ? 255 : v;
+  }
 }
@@ -0,0 +1,374 @@
+/*****************************************************************************
+ *
+ * grade.c -- score frames for lucky imaging selection
+ *
+ * Copyright 2026
+ *   James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <oa_common.h>
+
+#include <openastro/imgproc.h>
+#include <openastro/errno.h>
+#include <openastro/util.h>
+#include <openastro/video/formats.h>
+
+#include "sobel.h"
+
+
+static int		_toGrey8 ( void*, uint8_t*, int, int, int, int*, int* );
+static double	_laplacianVariance ( uint8_t*, int, int );
+static void		_findDisc ( uint8_t*, int, int, int*, int*, int*, int* );
+
+
+/**
+ * Score a frame for sharpness.  Higher scores are better.  The scores are
+ * only meaningful relative to other frames of the same subject scored
+ * with the same metric.
+ *
+ * Everything is done on an 8-bit greyscale copy of the frame.  Raw colour
+ * frames are binned 2x2 to avoid the Bayer pattern looking like detail.
+ * workspace must be at least xSize * ySize bytes, or NULL to have it
+ * allocated per call.
+ */
+
+int
+oaGradeFrame ( void* frame, void* workspace, int xSize, int ySize,
+		int frameFormat, int metric, double* score )
+{
+	uint8_t*	grey;
+	int				freeGrey = 0, ret;
+	int				x0, y0, x1, y1;
+
+	if ( xSize < 3 || ySize < 3 ) {
+		return -OA_ERR_INVALID_SIZE;
+	}
+
+	if ( !oaFrameFormats[ frameFormat ].rawColour &&
+			oaFrameFormats[ frameFormat ].monochrome &&
+			oaFrameFormats[ frameFormat ].bytesPerPixel == 1 ) {
+		grey = frame;
+	} else {
+		if (!( grey = workspace )) {
+			if (!( grey = malloc ( xSize * ySize ))) {
+				return -OA_ERR_MEM_ALLOC;
+			}
+			freeGrey = 1;
+		}
+		if (( ret = _toGrey8 ( frame, grey, xSize, ySize, frameFormat, &xSize,
+				&ySize )) != OA_ERR_NONE ) {
+			if ( freeGrey ) {
+				free ( grey );
+			}
+			return ret;
+		}
+	}
+
+	switch ( metric ) {
+		case OA_GRADE_SOBEL:
+			*score = sobel8Energy ( grey, xSize, ySize, 1, 1, xSize - 1,
+					ySize - 1 );
+			break;
+		case OA_GRADE_LAPLACIAN:
+			*score = _laplacianVariance ( grey, xSize, ySize );
+			break;
+		case OA_GRADE_PLANET:
+			_findDisc ( grey, xSize, ySize, &x0, &y0, &x1, &y1 );
+			*score = sobel8Energy ( grey, xSize, ySize, x0, y0, x1, y1 );
+			break;
+		default:
+			if ( freeGrey ) {
+				free ( grey );
+			}
+			return -OA_ERR_OUT_OF_RANGE;
+	}
+
+	if ( freeGrey ) {
+		free ( grey );
+	}
+	return OA_ERR_NONE;
+}
+
+
+/**
+ * Check whether oaGradeFrame() can handle frames of the given format, so
+ * callers can refuse a format once up front rather than have every frame
+ * fail to be scored.
+ */
+
+int
+oaGradeFormatSupported ( int format )
+{
+	frameFormatInfo*	fmt;
+
+	if ( format < 1 || format >= OA_PIX_FMT_LAST_P1 ) {
+		return 0;
+	}
+	fmt = &oaFrameFormats[ format ];
+	if ( fmt->packed || fmt->lumChrom || fmt->planar || fmt->hasAlpha ) {
+		return 0;
+	}
+	if ( fmt->monochrome && ( fmt->bytesPerPixel == 1 ||
+			fmt->bytesPerPixel == 2 )) {
+		return 1;
+	}
+	if ( fmt->fullColour && fmt->bytesPerPixel == 3 ) {
+		return 1;
+	}
+	if ( fmt->rawColour && ( fmt->bytesPerPixel == 1 ||
+			fmt->bytesPerPixel == 2 )) {
+		return 1;
+	}
+	return 0;
+}
+
+
+/**
+ * Produce an 8-bit greyscale image, returning its size, which will be
+ * halved in each direction for raw colour frames.  Formats rejected by
+ * oaGradeFormatSupported() just return an error here, as this is called
+ * for every frame.
+ */
+
+static int
+_toGrey8 ( void* frame, uint8_t* grey, int xSize, int ySize, int format,
+		int* greyX, int* greyY )
+{
+	frameFormatInfo*	fmt = &oaFrameFormats[ format ];
+	uint8_t*					s = frame;
+	uint8_t*					t = grey;
+	uint8_t*					r0;
+	uint8_t*					r1;
+	unsigned int			n = xSize * ySize, v, shift;
+	int								x, y, hx, hy, hi, lo, stride;
+
+	*greyX = xSize;
+	*greyY = ySize;
+
+	if ( fmt->packed || fmt->lumChrom || fmt->planar || fmt->hasAlpha ) {
+		return -OA_ERR_UNSUPPORTED_FORMAT;
+	}
+
+	// 16-bit containers may hold fewer significant bits, so shift by
+	// however many are needed to get the top eight
+	shift = ( fmt->bitsPerPixel > 8 ) ? fmt->bitsPerPixel - 8 : 0;
+	hi = fmt->littleEndian ? 1 : 0;
+	lo = 1 - hi;
+
+	if ( fmt->monochrome && fmt->bytesPerPixel == 2 ) {
+		while ( n-- ) {
+			v = ( s[ hi ] << 8 ) | s[ lo ];
+			v >>= shift;
+			*t++ = v > 255 ? 255 : v;
+			s += 2;
+		}
+		return OA_ERR_NONE;
+	}
+
+	if ( fmt->fullColour && fmt->bytesPerPixel == 3 ) {
+		// Same integer approximation to luminance as the focus score:
+		// L = 5/16.R + 9/16.G + 1/8.B, with the order of R and B not
+		// mattering enough to be worth checking for
+		while ( n-- ) {
+			v = ( s[0] << 2 ) + s[0] + ( s[1] << 3 ) + s[1] + ( s[2] << 1 );
+			*t++ = v >> 4;
+			s += 3;
+		}
+		return OA_ERR_NONE;
+	}
+
+	if ( fmt->rawColour && ( fmt->bytesPerPixel == 1 ||
+			fmt->bytesPerPixel == 2 )) {
+		// Sum each 2x2 block of the mosaic.  Whatever the pattern, that's
+		// one red, two green and one blue
+		hx = xSize / 2;
+		hy = ySize / 2;
+		stride = xSize * fmt->bytesPerPixel;
+		for ( y = 0; y < hy; y++ ) {
+			r0 = s + 2 * y * stride;
+			r1 = r0 + stride;
+			if ( fmt->bytesPerPixel == 1 ) {
+				for ( x = 0; x < hx; x++ ) {
+					*t++ = ( r0[0] + r0[1] + r1[0] + r1[1] ) >> 2;
+					r0 += 2;
+					r1 += 2;
+				}
+			} else {
+				for ( x = 0; x < hx; x++ ) {
+					v = (( r0[ hi ] << 8 ) | r0[ lo ] ) +
+							(( r0[ 2 + hi ] << 8 ) | r0[ 2 + lo ] ) +
+							(( r1[ hi ] << 8 ) | r1[ lo ] ) +
+							(( r1[ 2 + hi ] << 8 ) | r1[ 2 + lo ] );
+					v = ( v >> 2 ) >> shift;
+					*t++ = v > 255 ? 255 : v;
+					r0 += 4;
+					r1 += 4;
+				}
+			}
+		}
+		*greyX = hx;
+		*greyY = hy;
+		if ( hx < 3 || hy < 3 ) {
+			return -OA_ERR_INVALID_SIZE;
+		}
+		return OA_ERR_NONE;
+	}
+
+	return -OA_ERR_UNSUPPORTED_FORMAT;
+}
+
+
+/**
+ * Variance of the 4-neighbour Laplacian over the interior of the frame
+ */
+
+static double
+_laplacianVariance ( uint8_t* grey, int xSize, int ySize )
+{
+	uint8_t*	p;
+	int64_t		sum = 0;
+	uint64_t	sumSq = 0;
+	int				x, y, l;
+	double		n, mean;
+
+	for ( y = 1; y < ySize - 1; y++ ) {
+		p = grey + y * xSize + 1;
+		for ( x = 1; x < xSize - 1; x++, p++ ) {
+			l = ( *p << 2 ) - p[ -1 ] - p[ 1 ] - p[ -xSize ] - p[ xSize ];
+			sum += l;
+			sumSq += l * l;
+		}
+	}
+
+	n = ( double )( xSize - 2 ) * ( ySize - 2 );
+	mean = sum / n;
+	return sumSq / n - mean * mean;
+}
+
+
+/**
+ * Find the bounding box of a bright disc on a dark background so that
+ * only the planet contributes to the score and noise in the sky doesn't.
+ * Rows and columns are counted as part of the disc if enough of their
+ * pixels are more than half way from the background level to the peak,
+ * which stops isolated hot pixels or moons from stretching the box.  If
+ * nothing sensible is found the whole frame is used.
+ */
+
+static void
+_findDisc ( uint8_t* grey, int xSize, int ySize, int* x0, int* y0, int* x1,
+		int* y1 )
+{
+	unsigned int*	colCount;
+	unsigned int*	rowCount;
+	unsigned int	hist[ 256 ];
+	unsigned int	peak, background, threshold, maxCol, maxRow, total, n;
+	int						x, y, i, marginX, marginY;
+	uint8_t*			p;
+
+	*x0 = 1;
+	*y0 = 1;
+	*x1 = xSize - 1;
+	*y1 = ySize - 1;
+
+	if (!( colCount = calloc ( xSize + ySize, sizeof ( unsigned int )))) {
+		return;
+	}
+	rowCount = colCount + xSize;
+
+	// The background is taken to be the median and the peak the 99.9th
+	// percentile, both of which ignore a few hot pixels
+	memset ( hist, 0, sizeof ( hist ));
+	n = xSize * ySize;
+	p = grey;
+	for ( i = n; i > 0; i-- ) {
+		hist[ *p++ ]++;
+	}
+	background = peak = 0;
+	total = 0;
+	for ( i = 0; i < 256; i++ ) {
+		total += hist[i];
+		if ( !background && total >= n / 2 ) {
+			background = i;
+		}
+		if ( total >= n - n / 1000 ) {
+			peak = i;
+			break;
+		}
+	}
+	if ( peak <= background + 8 ) {
+		free ( colCount );
+		return;
+	}
+	threshold = background + ( peak - background ) / 2;
+
+	p = grey;
+	for ( y = 0; y < ySize; y++ ) {
+		for ( x = 0; x < xSize; x++ ) {
+			if ( *p++ > threshold ) {
+				colCount[x]++;
+				rowCount[y]++;
+			}
+		}
+	}
+
+	maxCol = maxRow = 0;
+	for ( x = 0; x < xSize; x++ ) {
+		if ( colCount[x] > maxCol ) {
+			maxCol = colCount[x];
+		}
+	}
+	for ( y = 0; y < ySize; y++ ) {
+		if ( rowCount[y] > maxRow ) {
+			maxRow = rowCount[y];
+		}
+	}
+	maxCol /= 10;
+	maxRow /= 10;
+
+	for ( x = 0; x < xSize && colCount[x] <= maxCol; x++ );
+	*x0 = x;
+	for ( x = xSize - 1; x >= 0 && colCount[x] <= maxCol; x-- );
+	*x1 = x + 1;
+	for ( y = 0; y < ySize && rowCount[y] <= maxRow; y++ );
+	*y0 = y;
+	for ( y = ySize - 1; y >= 0 && rowCount[y] <= maxRow; y-- );
+	*y1 = y + 1;
+	free ( colCount );
+
+	if ( *x1 - *x0 < 4 || *y1 - *y0 < 4 ) {
+		*x0 = 1;
+		*y0 = 1;
+		*x1 = xSize - 1;
+		*y1 = ySize - 1;
+		return;
+	}
+
+	// Allow a margin so the limb, where most of the detail is, is
+	// included in full
+	marginX = ( *x1 - *x0 ) / 10 + 2;
+	marginY = ( *y1 - *y0 ) / 10 + 2;
+	*x0 -= marginX;
+	*y0 -= marginY;
+	*x1 += marginX;
+	*y1 += marginY;
+}
@@ -0,0 +1,451 @@
+/*****************************************************************************
+ *
+ * histogram.c -- exact full-depth histograms and statistics
+ *
+ * Copyright 2026
+ *   James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <oa_common.h>
+
+#include <openastro/imgproc.h>
+#include <openastro/demosaic.h>
+#include <openastro/errno.h>
+#include <openastro/util.h>
+#include <openastro/video/formats.h>
+
+#include "threads.h"
+
+// 8-bit mono counts into several copies of the bins in turn, so that
+// runs of equal pixels don't have to wait for the previous increment of
+// the same bin to finish
+
+#define	SUB_HISTOGRAMS		4
+
+typedef struct {
+  oaHistogram*		hist;
+  const uint8_t*	frame;
+  int			firstRow;
+  int			lastRow;
+  uint32_t*		bins;
+} histogramJob;
+
+static void*	_histogramRows ( void* );
+static void	_count8 ( const uint8_t*, int, uint32_t* );
+static void	_count16 ( const uint8_t*, int, int, int, uint32_t* );
+static void	_countColour8 ( const uint8_t*, int, uint32_t*, uint32_t*,
+		    uint32_t* );
+static void	_countColour16 ( const uint8_t*, int, int, int, uint32_t*,
+		    uint32_t*, uint32_t* );
+static void	_countCFA8 ( const uint8_t*, int, uint32_t*, uint32_t* );
+static void	_countCFA16 ( const uint8_t*, int, int, uint32_t*, uint32_t* );
+static void	_calculateStats ( oaHistogram*, int );
+
+
+/**
+ * Set up for histograms of frames of the given size and format.  Mono
+ * frames have one channel, full colour and raw colour three.  For raw
+ * colour each photosite is counted in the channel for its CFA colour and
+ * both greens go in the green channel.
+ *
+ * Bins are indexed by the raw pixel value, so 16-bit frames have 65536
+ * bins whatever their significant bit depth.  numThreads of zero uses
+ * one thread per processor up to OA_HISTOGRAM_MAX_THREADS.  All the
+ * memory needed, including each thread's private bins, is allocated here.
+ */
+
+int
+oaHistogramInit ( oaHistogram* hist, int xSize, int ySize, int frameFormat,
+    int numThreads )
+{
+  frameFormatInfo*	fmt;
+  size_t		binsSize;
+  int			c;
+
+  // As for focus scoring, the size and format are kept even if they can't
+  // be handled so callers can tell whether they need to try again
+  memset ( hist, 0, sizeof ( oaHistogram ));
+  hist->xSize = xSize;
+  hist->ySize = ySize;
+  hist->frameFormat = frameFormat;
+
+  if ( frameFormat <= 0 || frameFormat >= OA_PIX_FMT_LAST_P1 ) {
+    return -OA_ERR_UNSUPPORTED_FORMAT;
+  }
+  if ( xSize < 1 || ySize < 1 ) {
+    return -OA_ERR_INVALID_SIZE;
+  }
+
+  fmt = &oaFrameFormats[ frameFormat ];
+  if ( fmt->packed || fmt->planar || fmt->lumChrom || fmt->hasAlpha ) {
+    oaLogError ( OA_LOG_IMGPROC, "%s: can't handle format %s", __func__,
+        fmt->name );
+    return -OA_ERR_UNSUPPORTED_FORMAT;
+  }
+
+  if ( fmt->monochrome ) {
+    hist->numChannels = 1;
+    hist->bytesPerSample = fmt->bytesPerPixel;
+  } else if ( fmt->fullColour && ( fmt->bytesPerPixel == 3 ||
+      fmt->bytesPerPixel == 6 )) {
+    hist->numChannels = 3;
+    hist->bytesPerSample = fmt->bytesPerPixel / 3;
+  } else if ( fmt->rawColour ) {
+    // cfa[row][column] is the channel for each photosite of a 2x2 cell
+    switch ( fmt->cfaPattern ) {
+      case OA_DEMOSAIC_RGGB:
+        hist->cfa[0][0] = OA_HISTOGRAM_RED;
+        hist->cfa[1][1] = OA_HISTOGRAM_BLUE;
+        break;
+      case OA_DEMOSAIC_BGGR:
+        hist->cfa[0][0] = OA_HISTOGRAM_BLUE;
+        hist->cfa[1][1] = OA_HISTOGRAM_RED;
+        break;
+      case OA_DEMOSAIC_GRBG:
+        hist->cfa[0][1] = OA_HISTOGRAM_RED;
+        hist->cfa[1][0] = OA_HISTOGRAM_BLUE;
+        break;
+      case OA_DEMOSAIC_GBRG:
+        hist->cfa[0][1] = OA_HISTOGRAM_BLUE;
+        hist->cfa[1][0] = OA_HISTOGRAM_RED;
+        break;
+      default:
+        oaLogError ( OA_LOG_IMGPROC, "%s: can't handle CFA pattern for %s",
+            __func__, fmt->name );
+        return -OA_ERR_UNSUPPORTED_FORMAT;
+    }
+    if ( hist->cfa[0][0] == hist->cfa[1][1] ) {
+      hist->cfa[0][0] = hist->cfa[1][1] = OA_HISTOGRAM_GREEN;
+    } else {
+      hist->cfa[0][1] = hist->cfa[1][0] = OA_HISTOGRAM_GREEN;
+    }
+    hist->numChannels = 3;
+    hist->bytesPerSample = fmt->bytesPerPixel;
+  }
+
+  if ( hist->bytesPerSample != 1 && hist->bytesPerSample != 2 ) {
+    oaLogError ( OA_LOG_IMGPROC, "%s: can't handle format %s", __func__,
+        fmt->name );
+    return -OA_ERR_UNSUPPORTED_FORMAT;
+  }
+
+  hist->numBins = ( hist->bytesPerSample == 1 ) ? 256 : 65536;
+  hist->fullScale = ( 1 << fmt->bitsPerPixel ) - 1;
+  hist->subHistograms = ( hist->numChannels == 1 &&
+      hist->bytesPerSample == 1 ) ? SUB_HISTOGRAMS : 1;
+
+  hist->numThreads = _oaImgprocThreads ( numThreads,
+      ( unsigned long ) xSize * ySize, OA_HISTOGRAM_MAX_THREADS );
+  if ( hist->numThreads > ySize / 2 ) {
+    hist->numThreads = ( ySize >= 2 ) ? ySize / 2 : 1;
+  }
+
+  // The results come first, followed by each thread's private bins
+  binsSize = ( size_t ) hist->numChannels * hist->numBins;
+  if (!( hist->workspace = malloc (( binsSize + hist->numThreads *
+      binsSize * hist->subHistograms ) * sizeof ( uint32_t )))) {
+    return -OA_ERR_MEM_ALLOC;
+  }
+  for ( c = 0; c < hist->numChannels; c++ ) {
+    hist->bins[c] = ( uint32_t* ) hist->workspace + c * hist->numBins;
+  }
+  return OA_ERR_NONE;
+}
+
+
+void
+oaHistogramFree ( oaHistogram* hist )
+{
+  if ( hist->workspace ) {
+    free ( hist->workspace );
+  }
+  hist->workspace = 0;
+}
+
+
+/**
+ * Count every pixel of a frame.  The rows are split between the threads,
+ * each counting into its own bins, and the bins are then summed.  Once
+ * that's done the statistics for each channel are worked out from the
+ * bins rather than going back to the frame.
+ */
+
+int
+oaHistogramProcess ( oaHistogram* hist, void* frame )
+{
+  histogramJob	jobs[ OA_HISTOGRAM_MAX_THREADS ];
+  uint32_t*	privateBins;
+  uint32_t*	t;
+  uint32_t*	s;
+  size_t	binsSize, threadBinsSize;
+  unsigned int	first, last;
+  int		i, j, n, c;
+
+  if ( !hist->workspace ) {
+    return -OA_ERR_INVALID_SIZE;
+  }
+
+  binsSize = ( size_t ) hist->numChannels * hist->numBins;
+  threadBinsSize = binsSize * hist->subHistograms;
+  privateBins = ( uint32_t* ) hist->workspace + binsSize;
+
+  for ( i = 0; i < hist->numThreads; i++ ) {
+    jobs[i].hist = hist;
+    jobs[i].frame = frame;
+    _oaImgprocChunk ( hist->ySize, hist->numThreads, i, 2, &first, &last );
+    jobs[i].firstRow = first;
+    jobs[i].lastRow = last;
+    jobs[i].bins = privateBins + i * threadBinsSize;
+  }
+  _oaImgprocRun ( _histogramRows, jobs, sizeof ( histogramJob ),
+      hist->numThreads );
+
+  t = hist->workspace;
+  memcpy ( t, privateBins, binsSize * sizeof ( uint32_t ));
+  n = hist->numThreads * hist->subHistograms;
+  for ( j = 1; j < n; j++ ) {
+    s = privateBins + j * binsSize;
+    for ( i = 0; i < ( int ) binsSize; i++ ) {
+      t[i] += s[i];
+    }
+  }
+
+  for ( c = 0; c < hist->numChannels; c++ ) {
+    _calculateStats ( hist, c );
+  }
+  return OA_ERR_NONE;
+}
+
+
+/**
+ * The lowest value that at least the given percentage of a channel's
+ * pixels are at or below, from the last frame processed
+ */
+
+unsigned int
+oaHistogramPercentile ( oaHistogram* hist, int channel, double percent )
+{
+  uint64_t	target, total;
+  uint32_t*	bins = hist->bins[ channel ];
+  int		i;
+
+  if ( !hist->stats[ channel ].pixels ) {
+    return 0;
+  }
+  target = percent * hist->stats[ channel ].pixels / 100.0;
+  if ( target < 1 ) {
+    target = 1;
+  }
+  total = 0;
+  for ( i = 0; i < hist->numBins; i++ ) {
+    total += bins[i];
+    if ( total >= target ) {
+      return i;
+    }
+  }
+  return hist->numBins - 1;
+}
+
+
+static void
+_calculateStats ( oaHistogram* hist, int channel )
+{
+  oaHistogramStats*	stats = &hist->stats[ channel ];
+  uint32_t*		bins = hist->bins[ channel ];
+  uint64_t		pixels = 0, sum = 0, saturated = 0;
+  int			i;
+
+  memset ( stats, 0, sizeof ( oaHistogramStats ));
+  for ( i = 0; i < hist->numBins; i++ ) {
+    if ( bins[i] ) {
+      if ( !pixels ) {
+        stats->min = i;
+      }
+      stats->max = i;
+      pixels += bins[i];
+      sum += ( uint64_t ) bins[i] * i;
+      if ( i >= ( int ) hist->fullScale ) {
+        saturated += bins[i];
+      }
+    }
+  }
+  if ( !pixels ) {
+    return;
+  }
+  stats->pixels = pixels;
+  stats->saturated = saturated;
+  stats->mean = ( double ) sum / pixels;
+  stats->low = oaHistogramPercentile ( hist, channel, 0.1 );
+  stats->median = oaHistogramPercentile ( hist, channel, 50.0 );
+  stats->high = oaHistogramPercentile ( hist, channel, 99.9 );
+}
+
+
+static void*
+_histogramRows ( void* param )
+{
+  histogramJob*		job = param;
+  oaHistogram*		hist = job->hist;
+  frameFormatInfo*	fmt = &oaFrameFormats[ hist->frameFormat ];
+  const uint8_t*	row;
+  uint32_t*		b[3];
+  uint32_t*		swap;
+  size_t		rowLength;
+  int			y, c, hi, lo;
+
+  memset ( job->bins, 0, ( size_t ) hist->numChannels * hist->numBins *
+      hist->subHistograms * sizeof ( uint32_t ));
+  for ( c = 0; c < hist->numChannels; c++ ) {
+    b[c] = job->bins + c * hist->numBins;
+  }
+  // BGR formats just count into the channels the other way round
+  if ( OA_PIX_FMT_BGR24 == hist->frameFormat ||
+      OA_PIX_FMT_BGR48BE == hist->frameFormat ||
+      OA_PIX_FMT_BGR48LE == hist->frameFormat ) {
+    swap = b[0];
+    b[0] = b[2];
+    b[2] = swap;
+  }
+  hi = fmt->littleEndian ? 1 : 0;
+  lo = 1 - hi;
+  rowLength = ( size_t ) hist->xSize * hist->numChannels *
+      hist->bytesPerSample;
+  if ( fmt->rawColour ) {
+    rowLength = ( size_t ) hist->xSize * hist->bytesPerSample;
+  }
+
+  for ( y = job->firstRow; y < job->lastRow; y++ ) {
+    row = job->frame + y * rowLength;
+    if ( fmt->rawColour ) {
+      if ( hist->bytesPerSample == 1 ) {
+        _countCFA8 ( row, hist->xSize, b[ hist->cfa[ y & 1 ][0]],
+            b[ hist->cfa[ y & 1 ][1]] );
+      } else {
+        _countCFA16 ( row, hist->xSize, hi, b[ hist->cfa[ y & 1 ][0]],
+            b[ hist->cfa[ y & 1 ][1]] );
+      }
+    } else if ( hist->numChannels == 3 ) {
+      if ( hist->bytesPerSample == 1 ) {
+        _countColour8 ( row, hist->xSize, b[0], b[1], b[2] );
+      } else {
+        _countColour16 ( row, hist->xSize, hi, lo, b[0], b[1], b[2] );
+      }
+    } else {
+      if ( hist->bytesPerSample == 1 ) {
+        _count8 ( row, hist->xSize, b[0] );
+      } else {
+        _count16 ( row, hist->xSize, hi, lo, b[0] );
+      }
+    }
+  }
+  return 0;
+}
+
+
+static void
+_count8 ( const uint8_t* s, int n, uint32_t* bins )
+{
+  uint32_t*	b1 = bins + 256;
+  uint32_t*	b2 = bins + 512;
+  uint32_t*	b3 = bins + 768;
+  int		i;
+
+  for ( i = 0; i + 3 < n; i += 4 ) {
+    bins[ s[i]]++;
+    b1[ s[ i + 1 ]]++;
+    b2[ s[ i + 2 ]]++;
+    b3[ s[ i + 3 ]]++;
+  }
+  for ( ; i < n; i++ ) {
+    bins[ s[i]]++;
+  }
+}
+
+
+static void
+_count16 ( const uint8_t* s, int n, int hi, int lo, uint32_t* bins )
+{
+  int		i;
+
+  for ( i = 0; i < n; i++, s += 2 ) {
+    bins[( s[ hi ] << 8 ) | s[ lo ]]++;
+  }
+}
+
+
+static void
+_countColour8 ( const uint8_t* s, int n, uint32_t* b0, uint32_t* b1,
+    uint32_t* b2 )
+{
+  int		i;
+
+  for ( i = 0; i < n; i++, s += 3 ) {
+    b0[ s[0]]++;
+    b1[ s[1]]++;
+    b2[ s[2]]++;
+  }
+}
+
+
+static void
+_countColour16 ( const uint8_t* s, int n, int hi, int lo, uint32_t* b0,
+    uint32_t* b1, uint32_t* b2 )
+{
+  int		i;
+
+  for ( i = 0; i < n; i++, s += 6 ) {
+    b0[( s[ hi ] << 8 ) | s[ lo ]]++;
+    b1[( s[ 2 + hi ] << 8 ) | s[ 2 + lo ]]++;
+    b2[( s[ 4 + hi ] << 8 ) | s[ 4 + lo ]]++;
+  }
+}
+
+
+static void
+_countCFA8 ( const uint8_t* s, int n, uint32_t* even, uint32_t* odd )
+{
+  int		i;
+
+  for ( i = 0; i + 1 < n; i += 2 ) {
+    even[ s[i]]++;
+    odd[ s[ i + 1 ]]++;
+  }
+  if ( i < n ) {
+    even[ s[i]]++;
+  }
+}
+
+
+static void
+_countCFA16 ( const uint8_t* s, int n, int hi, uint32_t* even,
+    uint32_t* odd )
+{
+  int		i, lo = 1 - hi;
+
+  for ( i = 0; i + 1 < n; i += 2, s += 4 ) {
+    even[( s[ hi ] << 8 ) | s[ lo ]]++;
+    odd[( s[ 2 + hi ] << 8 ) | s[ 2 + lo ]]++;
+  }
+  if ( i < n ) {
+    even[( s[ hi ] << 8 ) | s[ lo ]]++;
+  }
+}
@@ -0,0 +1,493 @@
+/*****************************************************************************
+ *
+ * hotpixel.c -- find and correct hot pixels in raw frames
+ *
+ * Copyright 2026
+ *   James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <oa_common.h>
+
+#include <openastro/imgproc.h>
+#include <openastro/errno.h>
+#include <openastro/util.h>
+#include <openastro/video/formats.h>
+
+// Scales the median absolute deviation to the standard deviation it
+// would be for Gaussian noise
+
+#define	MAD_TO_SIGMA		1.4826
+
+// Where a frame holds fewer significant bits than its container the
+// noise can look like zero, so it's never taken to be less than this
+
+#define	MIN_SIGMA_8		1.0
+#define	MIN_SIGMA_16		16.0
+
+typedef struct {
+  const uint8_t*	data;
+  int			bytesPerSample;
+  int			swap;
+} sampleSource;
+
+static inline unsigned int	_sample ( const sampleSource*, uint32_t );
+static double	_robustSigma ( oaHotPixelMap*, const sampleSource* );
+static int	_neighbours ( oaHotPixelMap*, const sampleSource*, int, int,
+		    unsigned int*, int );
+static int	_appendDefect ( oaHotPixelMap*, unsigned int*, uint32_t );
+static int	_compareOffsets ( const void*, const void* );
+
+
+/**
+ * Set up an empty hot pixel map for frames of the given size and format,
+ * which must be mono or raw colour and not packed.  For raw colour the
+ * neighbours used are two pixels away so they are the same colour.
+ */
+
+int
+oaHotPixelInit ( oaHotPixelMap* map, int xSize, int ySize, int frameFormat )
+{
+  frameFormatInfo*	fmt;
+  unsigned int		one = 1;
+
+  memset ( map, 0, sizeof ( oaHotPixelMap ));
+  map->xSize = xSize;
+  map->ySize = ySize;
+  map->frameFormat = frameFormat;
+
+  if ( frameFormat <= 0 || frameFormat >= OA_PIX_FMT_LAST_P1 ) {
+    return -OA_ERR_UNSUPPORTED_FORMAT;
+  }
+  if ( xSize < 1 || ySize < 1 ) {
+    return -OA_ERR_INVALID_SIZE;
+  }
+  fmt = &oaFrameFormats[ frameFormat ];
+  if (( !fmt->monochrome && !fmt->rawColour ) || fmt->packed ||
+      ( fmt->bytesPerPixel != 1 && fmt->bytesPerPixel != 2 )) {
+    oaLogError ( OA_LOG_IMGPROC, "%s: can't map hot pixels for format %s",
+        __func__, fmt->name );
+    return -OA_ERR_UNSUPPORTED_FORMAT;
+  }
+
+  map->bytesPerSample = fmt->bytesPerPixel;
+  map->nativeOrder = ( fmt->littleEndian ? 1 : 0 ) == *(( uint8_t* ) &one );
+  map->step = fmt->rawColour ? 2 : 1;
+  return OA_ERR_NONE;
+}
+
+
+void
+oaHotPixelFree ( oaHotPixelMap* map )
+{
+  if ( map->offsets ) {
+    free ( map->offsets );
+  }
+  if ( map->hits ) {
+    free ( map->hits );
+  }
+  map->offsets = 0;
+  map->hits = 0;
+  map->numDefects = 0;
+  map->detectFrames = 0;
+}
+
+
+/**
+ * Replace the map with the defects in a master dark, held as 16-bit
+ * values as produced by oaMasterFinish().  A pixel is hot if it exceeds
+ * the median of its same-colour neighbours by more than sigmas times the
+ * dark's noise, which is estimated from its median absolute deviation so
+ * the hot pixels themselves don't inflate it.
+ */
+
+int
+oaHotPixelFromDark ( oaHotPixelMap* map, const uint16_t* dark,
+    double sigmas )
+{
+  sampleSource	src;
+  unsigned int	n[4], allocated = 0, v, median, t;
+  double	threshold;
+  int		x, y, i, j, count;
+
+  if ( !map->bytesPerSample ) {
+    return -OA_ERR_INVALID_SIZE;
+  }
+  src.data = ( const uint8_t* ) dark;
+  src.bytesPerSample = 2;
+  src.swap = 0;
+
+  threshold = sigmas * _robustSigma ( map, &src );
+  if ( threshold < 1 ) {
+    threshold = 1;
+  }
+
+  if ( map->offsets ) {
+    free ( map->offsets );
+    map->offsets = 0;
+  }
+  map->numDefects = 0;
+
+  for ( y = 0; y < map->ySize; y++ ) {
+    for ( x = 0; x < map->xSize; x++ ) {
+      v = dark[ y * map->xSize + x ];
+      if (!( count = _neighbours ( map, &src, x, y, n, 0 ))) {
+        continue;
+      }
+      // Insertion sort the few neighbours to find their median
+      for ( i = 1; i < count; i++ ) {
+        for ( j = i; j > 0 && n[ j - 1 ] > n[j]; j-- ) {
+          t = n[j];
+          n[j] = n[ j - 1 ];
+          n[ j - 1 ] = t;
+        }
+      }
+      median = ( count & 1 ) ? n[ count / 2 ] :
+          ( n[ count / 2 - 1 ] + n[ count / 2 ] + 1 ) / 2;
+      if ( v > median + threshold ) {
+        if ( _appendDefect ( map, &allocated, y * map->xSize + x ) !=
+            OA_ERR_NONE ) {
+          return -OA_ERR_MEM_ALLOC;
+        }
+      }
+    }
+  }
+  return OA_ERR_NONE;
+}
+
+
+/**
+ * Look for hot pixels in a live frame.  Anything brighter than all of its
+ * same-colour neighbours by more than sigmas times the frame's noise is
+ * noted, and oaHotPixelDetectFinish() keeps only the pixels that did that
+ * in most frames.  Stars and planetary detail are wider than a pixel, and
+ * move, so they don't persist the way a hot pixel does.
+ */
+
+int
+oaHotPixelDetectFrame ( oaHotPixelMap* map, const void* frame,
+    double sigmas )
+{
+  sampleSource	src;
+  unsigned int	n[4], v, max;
+  double	threshold;
+  int		x, y, i, count;
+
+  if ( !map->bytesPerSample ) {
+    return -OA_ERR_INVALID_SIZE;
+  }
+  if ( map->detectFrames >= OA_HOTPIXEL_MAX_DETECT_FRAMES ) {
+    return -OA_ERR_OUT_OF_RANGE;
+  }
+  if ( !map->hits && !( map->hits = calloc ( map->xSize * map->ySize, 1 ))) {
+    return -OA_ERR_MEM_ALLOC;
+  }
+
+  src.data = frame;
+  src.bytesPerSample = map->bytesPerSample;
+  src.swap = !map->nativeOrder && map->bytesPerSample == 2;
+
+  threshold = sigmas * _robustSigma ( map, &src );
+  if ( threshold < 1 ) {
+    threshold = 1;
+  }
+
+  for ( y = 0; y < map->ySize; y++ ) {
+    for ( x = 0; x < map->xSize; x++ ) {
+      v = _sample ( &src, y * map->xSize + x );
+      count = _neighbours ( map, &src, x, y, n, 0 );
+      for ( i = 0, max = 0; i < count; i++ ) {
+        max = n[i] > max ? n[i] : max;
+      }
+      if ( count && v > max + threshold ) {
+        map->hits[ y * map->xSize + x ]++;
+      }
+    }
+  }
+  map->detectFrames++;
+  return OA_ERR_NONE;
+}
+
+
+/**
+ * Replace the map with the pixels found to be hot in at least the given
+ * fraction of the frames passed to oaHotPixelDetectFrame()
+ */
+
+int
+oaHotPixelDetectFinish ( oaHotPixelMap* map, double fraction )
+{
+  unsigned int	allocated = 0, needed, i, numPixels;
+
+  if ( !map->hits || !map->detectFrames ) {
+    return -OA_ERR_OUT_OF_RANGE;
+  }
+  needed = fraction * map->detectFrames + 0.999;
+  if ( needed < 1 ) {
+    needed = 1;
+  }
+
+  if ( map->offsets ) {
+    free ( map->offsets );
+    map->offsets = 0;
+  }
+  map->numDefects = 0;
+
+  numPixels = map->xSize * map->ySize;
+  for ( i = 0; i < numPixels; i++ ) {
+    if ( map->hits[i] >= needed && _appendDefect ( map, &allocated, i ) !=
+        OA_ERR_NONE ) {
+      return -OA_ERR_MEM_ALLOC;
+    }
+  }
+  free ( map->hits );
+  map->hits = 0;
+  map->detectFrames = 0;
+  return OA_ERR_NONE;
+}
+
+
+/**
+ * Replace the map with a list of pixel offsets, perhaps saved from an
+ * earlier session.  They needn't be sorted.
+ */
+
+int
+oaHotPixelSetList ( oaHotPixelMap* map, const uint32_t* offsets,
+    unsigned int count )
+{
+  unsigned int	i, j, numPixels = map->xSize * map->ySize;
+
+  if ( !map->bytesPerSample ) {
+    return -OA_ERR_INVALID_SIZE;
+  }
+  if ( map->offsets ) {
+    free ( map->offsets );
+    map->offsets = 0;
+  }
+  map->numDefects = 0;
+  if ( !count ) {
+    return OA_ERR_NONE;
+  }
+  if (!( map->offsets = malloc ( count * sizeof ( uint32_t )))) {
+    return -OA_ERR_MEM_ALLOC;
+  }
+  memcpy ( map->offsets, offsets, count * sizeof ( uint32_t ));
+  qsort ( map->offsets, count, sizeof ( uint32_t ), _compareOffsets );
+  for ( i = j = 0; i < count; i++ ) {
+    if ( map->offsets[i] < numPixels && ( !j ||
+        map->offsets[i] != map->offsets[ j - 1 ] )) {
+      map->offsets[ j++ ] = map->offsets[i];
+    }
+  }
+  map->numDefects = j;
+  return OA_ERR_NONE;
+}
+
+
+int
+oaHotPixelIsDefect ( oaHotPixelMap* map, uint32_t offset )
+{
+  unsigned int	lo = 0, hi = map->numDefects, mid;
+
+  while ( lo < hi ) {
+    mid = ( lo + hi ) / 2;
+    if ( map->offsets[ mid ] < offset ) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return ( lo < map->numDefects && map->offsets[ lo ] == offset );
+}
+
+
+/**
+ * Replace each hot pixel in a frame with the mean of its same-colour
+ * neighbours that aren't hot themselves, falling back to the diagonal
+ * neighbours if none of the others will do.  Only the defects are
+ * touched, so the cost depends on how many there are rather than on the
+ * size of the frame.
+ */
+
+int
+oaHotPixelCorrect ( oaHotPixelMap* map, void* frame )
+{
+  sampleSource	src;
+  unsigned int	n[4], i, sum;
+  uint32_t	offset;
+  uint16_t	v;
+  uint8_t*	p;
+  int		x, y, j, count;
+
+  if ( !map->bytesPerSample ) {
+    return -OA_ERR_INVALID_SIZE;
+  }
+  src.data = frame;
+  src.bytesPerSample = map->bytesPerSample;
+  src.swap = !map->nativeOrder && map->bytesPerSample == 2;
+
+  for ( i = 0; i < map->numDefects; i++ ) {
+    offset = map->offsets[i];
+    x = offset % map->xSize;
+    y = offset / map->xSize;
+    if (!( count = _neighbours ( map, &src, x, y, n, 1 )) &&
+        !( count = _neighbours ( map, &src, x, y, n, 2 ))) {
+      continue;
+    }
+    for ( j = 0, sum = 0; j < count; j++ ) {
+      sum += n[j];
+    }
+    v = ( sum + count / 2 ) / count;
+    if ( 1 == map->bytesPerSample ) {
+      (( uint8_t* ) frame )[ offset ] = v;
+    } else {
+      p = ( uint8_t* ) frame + 2 * offset;
+      if ( src.swap ) {
+        v = ( v >> 8 ) | ( v << 8 );
+      }
+      memcpy ( p, &v, 2 );
+    }
+  }
+  return OA_ERR_NONE;
+}
+
+
+static inline unsigned int
+_sample ( const sampleSource* src, uint32_t i )
+{
+  uint16_t	v;
+
+  if ( 1 == src->bytesPerSample ) {
+    return src->data[i];
+  }
+  memcpy ( &v, src->data + 2 * i, 2 );
+  return src->swap ? ( uint16_t )(( v >> 8 ) | ( v << 8 )) : v;
+}
+
+
+/**
+ * Fetch the same-colour neighbours of a pixel that are within the frame.
+ * mode 0 takes the four orthogonal neighbours, mode 1 the same but
+ * leaving out any that are known defects, and mode 2 the diagonal ones
+ * that aren't defects.
+ */
+
+static int
+_neighbours ( oaHotPixelMap* map, const sampleSource* src, int x, int y,
+    unsigned int* n, int mode )
+{
+  static const int	orthogonal[4][2] = {{ -1, 0 }, { 1, 0 }, { 0, -1 },
+			    { 0, 1 }};
+  static const int	diagonal[4][2] = {{ -1, -1 }, { 1, -1 }, { -1, 1 },
+			    { 1, 1 }};
+  const int		( *d )[2] = ( mode == 2 ) ? diagonal : orthogonal;
+  int			i, nx, ny, count = 0;
+  uint32_t		offset;
+
+  for ( i = 0; i < 4; i++ ) {
+    nx = x + d[i][0] * map->step;
+    ny = y + d[i][1] * map->step;
+    if ( nx < 0 || ny < 0 || nx >= map->xSize || ny >= map->ySize ) {
+      continue;
+    }
+    offset = ny * map->xSize + nx;
+    if ( mode && oaHotPixelIsDefect ( map, offset )) {
+      continue;
+    }
+    n[ count++ ] = _sample ( src, offset );
+  }
+  return count;
+}
+
+
+/**
+ * Estimate the noise in a frame from the median absolute deviation of
+ * its pixels, found with a pair of histograms so it's exact
+ */
+
+static double
+_robustSigma ( oaHotPixelMap* map, const sampleSource* src )
+{
+  uint32_t*	hist;
+  uint32_t*	dev;
+  unsigned int	numBins, numPixels, i, median, mad, total, half;
+  double	sigma, minSigma;
+
+  numBins = ( 1 == map->bytesPerSample ) ? 0x100 : 0x10000;
+  minSigma = ( 1 == map->bytesPerSample ) ? MIN_SIGMA_8 : MIN_SIGMA_16;
+  if (!( hist = calloc ( numBins * 2, sizeof ( uint32_t )))) {
+    return minSigma;
+  }
+  dev = hist + numBins;
+
+  numPixels = map->xSize * map->ySize;
+  for ( i = 0; i < numPixels; i++ ) {
+    hist[ _sample ( src, i ) & ( numBins - 1 ) ]++;
+  }
+  half = ( numPixels + 1 ) / 2;
+  for ( median = 0, total = 0; median < numBins; median++ ) {
+    if (( total += hist[ median ] ) >= half ) {
+      break;
+    }
+  }
+  for ( i = 0; i < numBins; i++ ) {
+    dev[ i > median ? i - median : median - i ] += hist[i];
+  }
+  for ( mad = 0, total = 0; mad < numBins; mad++ ) {
+    if (( total += dev[ mad ] ) >= half ) {
+      break;
+    }
+  }
+  free ( hist );
+
+  sigma = mad * MAD_TO_SIGMA;
+  return sigma < minSigma ? minSigma : sigma;
+}
+
+
+static int
+_appendDefect ( oaHotPixelMap* map, unsigned int* allocated, uint32_t offset )
+{
+  uint32_t*	p;
+  unsigned int	size;
+
+  if ( map->numDefects == *allocated ) {
+    size = *allocated ? *allocated * 2 : 256;
+    if (!( p = realloc ( map->offsets, size * sizeof ( uint32_t )))) {
+      return -OA_ERR_MEM_ALLOC;
+    }
+    map->offsets = p;
+    *allocated = size;
+  }
+  map->offsets[ map->numDefects++ ] = offset;
+  return OA_ERR_NONE;
+}
+
+
+static int
+_compareOffsets ( const void* a, const void* b )
+{
+  uint32_t	x = *( const uint32_t* ) a;
+  uint32_t	y = *( const uint32_t* ) b;
+
+  return ( x > y ) - ( x < y );
+}
@@ -0,0 +1,516 @@
+/*****************************************************************************
+ *
+ * master.c -- build master calibration frames one frame at a time
+ *
+ * Copyright 2026
+ *   James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <oa_common.h>
+
+#include <unistd.h>
+#include <limits.h>
+#include <math.h>
+
+#include <openastro/imgproc.h>
+#include <openastro/errno.h>
+#include <openastro/util.h>
+#include <openastro/video/formats.h>
+
+#include "threads.h"
+
+#if !HAVE_PREAD64
+#define pread64 pread
+#endif
+#if HAVE_MKSTEMP64
+#define mkstemp mkstemp64
+#endif
+
+// Samples are widened to 16 bits a block at a time so the accumulating
+// loops only ever see one type
+
+#define	BLOCK_SIZE		4096
+
+#define	DEFAULT_MEMORY_LIMIT	( 64 * 1024 * 1024 )
+
+typedef struct {
+  oaMasterBuilder*	master;
+  const void*		frame;
+  unsigned int		first;
+  unsigned int		last;
+} masterJob;
+
+static void*	_accumulatePixels ( void* );
+static void	_widen ( const void*, uint16_t*, unsigned int, int, int, int );
+static void	_welford ( const uint16_t*, float*, float*, unsigned int,
+		    float );
+static void	_minMax ( const uint16_t*, uint16_t*, uint16_t*, unsigned int );
+static int	_writeTile ( oaMasterBuilder*, const void* );
+static int	_finishMedian ( oaMasterBuilder*, uint16_t* );
+static uint16_t	_median ( uint16_t*, unsigned int );
+
+
+/**
+ * Set up to build a master frame of the given size and format, which must
+ * be mono or raw colour and not packed.  Only running statistics are kept
+ * in memory: a mean and variance per pixel, and the per-pixel minimum and
+ * maximum for OA_MASTER_MINMAX.  For OA_MASTER_MEDIAN the frames are also
+ * written to an unlinked temporary file in tileDir, which is read back in
+ * tiles of at most memoryLimit bytes (zero for a default) to find the
+ * median.  numThreads of zero uses one thread per processor.
+ */
+
+int
+oaMasterInit ( oaMasterBuilder* master, int xSize, int ySize,
+    int frameFormat, int method, const char* tileDir, size_t memoryLimit,
+    int numThreads )
+{
+  frameFormatInfo*	fmt;
+  char			tileName[ PATH_MAX ];
+  unsigned int		one = 1;
+
+  memset ( master, 0, sizeof ( oaMasterBuilder ));
+  master->xSize = xSize;
+  master->ySize = ySize;
+  master->frameFormat = frameFormat;
+  master->method = method;
+  master->tileFd = -1;
+
+  if ( frameFormat <= 0 || frameFormat >= OA_PIX_FMT_LAST_P1 ) {
+    return -OA_ERR_UNSUPPORTED_FORMAT;
+  }
+  if ( xSize < 1 || ySize < 1 ) {
+    return -OA_ERR_INVALID_SIZE;
+  }
+  if ( method < OA_MASTER_MEAN || method > OA_MASTER_MEDIAN ) {
+    return -OA_ERR_OUT_OF_RANGE;
+  }
+  fmt = &oaFrameFormats[ frameFormat ];
+  if (( !fmt->monochrome && !fmt->rawColour ) || fmt->packed ||
+      ( fmt->bytesPerPixel != 1 && fmt->bytesPerPixel != 2 )) {
+    oaLogError ( OA_LOG_IMGPROC, "%s: can't build a master of format %s",
+        __func__, fmt->name );
+    return -OA_ERR_UNSUPPORTED_FORMAT;
+  }
+
+  master->numPixels = xSize * ySize;
+  master->bytesPerSample = fmt->bytesPerPixel;
+  master->nativeOrder = ( fmt->littleEndian ? 1 : 0 ) ==
+      *(( uint8_t* ) &one );
+  master->memoryLimit = memoryLimit ? memoryLimit : DEFAULT_MEMORY_LIMIT;
+
+  master->numThreads = _oaImgprocThreads ( numThreads, master->numPixels,
+      OA_MASTER_MAX_THREADS );
+
+  if (!( master->mean = calloc ( master->numPixels, sizeof ( float ))) ||
+      !( master->m2 = calloc ( master->numPixels, sizeof ( float )))) {
+    oaMasterFree ( master );
+    return -OA_ERR_MEM_ALLOC;
+  }
+  if ( OA_MASTER_MINMAX == method ) {
+    if (!( master->min = malloc ( master->numPixels *
+        sizeof ( uint16_t ))) || !( master->max = malloc (
+        master->numPixels * sizeof ( uint16_t )))) {
+      oaMasterFree ( master );
+      return -OA_ERR_MEM_ALLOC;
+    }
+  }
+
+  if ( OA_MASTER_MEDIAN == method ) {
+    // Tiles are always stored in native byte order, so 16-bit frames in
+    // the other order need swapping on the way out
+    if ( master->bytesPerSample == 2 && !master->nativeOrder &&
+        !( master->tileBuffer = malloc ( master->numPixels *
+        sizeof ( uint16_t )))) {
+      oaMasterFree ( master );
+      return -OA_ERR_MEM_ALLOC;
+    }
+    ( void ) snprintf ( tileName, PATH_MAX, "%s/oamaster-XXXXXX",
+        ( tileDir && *tileDir ) ? tileDir : "/tmp" );
+    if (( master->tileFd = mkstemp ( tileName )) < 0 ) {
+      oaLogError ( OA_LOG_IMGPROC, "%s: can't create tile file in %s",
+          __func__, tileDir );
+      oaMasterFree ( master );
+      return -OA_ERR_NOT_WRITEABLE;
+    }
+    // Nothing else needs to find the file, and this way it goes away
+    // however the process ends
+    ( void ) unlink ( tileName );
+  }
+
+  return OA_ERR_NONE;
+}
+
+
+void
+oaMasterFree ( oaMasterBuilder* master )
+{
+  if ( master->mean ) {
+    free ( master->mean );
+  }
+  if ( master->m2 ) {
+    free ( master->m2 );
+  }
+  if ( master->min ) {
+    free ( master->min );
+  }
+  if ( master->max ) {
+    free ( master->max );
+  }
+  if ( master->tileBuffer ) {
+    free ( master->tileBuffer );
+  }
+  if ( master->tileFd >= 0 ) {
+    close ( master->tileFd );
+  }
+  master->mean = master->m2 = 0;
+  master->min = master->max = 0;
+  master->tileBuffer = 0;
+  master->tileFd = -1;
+}
+
+
+/**
+ * Add a frame to the running statistics.  The frame isn't referenced
+ * once this returns.
+ */
+
+int
+oaMasterAddFrame ( oaMasterBuilder* master, const void* frame )
+{
+  masterJob	jobs[ OA_MASTER_MAX_THREADS ];
+  int		i, ret;
+
+  if ( !master->mean ) {
+    return -OA_ERR_INVALID_SIZE;
+  }
+
+  if ( master->tileFd >= 0 && ( ret = _writeTile ( master, frame )) !=
+      OA_ERR_NONE ) {
+    return ret;
+  }
+
+  master->numFrames++;
+
+  for ( i = 0; i < master->numThreads; i++ ) {
+    jobs[i].master = master;
+    jobs[i].frame = frame;
+    _oaImgprocChunk ( master->numPixels, master->numThreads, i, 64,
+        &jobs[i].first, &jobs[i].last );
+  }
+  _oaImgprocRun ( _accumulatePixels, jobs, sizeof ( masterJob ),
+      master->numThreads );
+  return OA_ERR_NONE;
+}
+
+
+/**
+ * Produce the master frame as 16-bit values in the same range as the
+ * frame's pixels, which is what oaCalibrationSetBias() and friends want.
+ * If variance isn't NULL the per-pixel sample variance is returned too,
+ * which is what's needed to find noisy pixels in a dark.  More frames can
+ * be added afterwards and the master produced again.
+ */
+
+int
+oaMasterFinish ( oaMasterBuilder* master, uint16_t* result, float* variance )
+{
+  unsigned int	i, n = master->numFrames;
+  double	v;
+
+  if ( !master->mean ) {
+    return -OA_ERR_INVALID_SIZE;
+  }
+  if ( !n ) {
+    return -OA_ERR_OUT_OF_RANGE;
+  }
+
+  if ( variance ) {
+    for ( i = 0; i < master->numPixels; i++ ) {
+      variance[i] = ( n > 1 ) ? master->m2[i] / ( n - 1 ) : 0;
+    }
+  }
+
+  if ( OA_MASTER_MEDIAN == master->method ) {
+    return _finishMedian ( master, result );
+  }
+
+  // With fewer than three frames there's nothing left once the extremes
+  // are taken out, so just use the mean
+  if ( OA_MASTER_MINMAX == master->method && n > 2 ) {
+    for ( i = 0; i < master->numPixels; i++ ) {
+      v = (( double ) master->mean[i] * n - master->min[i] -
+          master->max[i] ) / ( n - 2 );
+      result[i] = v < 0 ? 0 : ( v > 0xffff ? 0xffff : v + 0.5 );
+    }
+    return OA_ERR_NONE;
+  }
+
+  for ( i = 0; i < master->numPixels; i++ ) {
+    v = master->mean[i];
+    result[i] = v < 0 ? 0 : ( v > 0xffff ? 0xffff : v + 0.5 );
+  }
+  return OA_ERR_NONE;
+}
+
+
+static void*
+_accumulatePixels ( void* param )
+{
+  masterJob*		job = param;
+  oaMasterBuilder*	master = job->master;
+  uint16_t		block[ BLOCK_SIZE ];
+  unsigned int		i, n;
+  float			inv = 1.0 / master->numFrames;
+  int			littleEndian;
+
+  littleEndian = oaFrameFormats[ master->frameFormat ].littleEndian;
+  for ( i = job->first; i < job->last; i += n ) {
+    n = job->last - i;
+    if ( n > BLOCK_SIZE ) {
+      n = BLOCK_SIZE;
+    }
+    _widen (( const uint8_t* ) job->frame + i * master->bytesPerSample,
+        block, n, master->bytesPerSample, master->nativeOrder,
+        littleEndian );
+    _welford ( block, master->mean + i, master->m2 + i, n, inv );
+    if ( master->min ) {
+      if ( 1 == master->numFrames ) {
+        memcpy ( master->min + i, block, n * sizeof ( uint16_t ));
+        memcpy ( master->max + i, block, n * sizeof ( uint16_t ));
+      } else {
+        _minMax ( block, master->min + i, master->max + i, n );
+      }
+    }
+  }
+  return 0;
+}
+
+
+static void
+_widen ( const void* source, uint16_t* restrict t, unsigned int n,
+    int bytesPerSample, int nativeOrder, int littleEndian )
+{
+  const uint8_t*	s = source;
+  unsigned int		i;
+  int			hi, lo;
+
+  if ( 1 == bytesPerSample ) {
+    for ( i = 0; i < n; i++ ) {
+      t[i] = s[i];
+    }
+  } else if ( nativeOrder ) {
+    memcpy ( t, s, n * sizeof ( uint16_t ));
+  } else {
+    hi = littleEndian ? 1 : 0;
+    lo = 1 - hi;
+    for ( i = 0; i < n; i++ ) {
+      t[i] = ( s[ 2 * i + hi ] << 8 ) | s[ 2 * i + lo ];
+    }
+  }
+}
+
+
+/**
+ * Welford's update of the running mean and sum of squared differences,
+ * which doesn't lose precision the way summing squares does.  inv is one
+ * over the number of frames including this one.  These loops are kept
+ * simple enough for the compiler to vectorise.
+ */
+
+static void
+_welford ( const uint16_t* restrict s, float* restrict mean,
+    float* restrict m2, unsigned int n, float inv )
+{
+  unsigned int	i;
+  float		x, d;
+
+  for ( i = 0; i < n; i++ ) {
+    x = s[i];
+    d = x - mean[i];
+    mean[i] += d * inv;
+    m2[i] += d * ( x - mean[i] );
+  }
+}
+
+
+static void
+_minMax ( const uint16_t* restrict s, uint16_t* restrict min,
+    uint16_t* restrict max, unsigned int n )
+{
+  unsigned int	i;
+
+  for ( i = 0; i < n; i++ ) {
+    min[i] = s[i] < min[i] ? s[i] : min[i];
+    max[i] = s[i] > max[i] ? s[i] : max[i];
+  }
+}
+
+
+static int
+_writeTile ( oaMasterBuilder* master, const void* frame )
+{
+  const uint8_t*	s = frame;
+  size_t		left = master->numPixels * master->bytesPerSample;
+  ssize_t		ret;
+
+  if ( master->tileBuffer ) {
+    _widen ( frame, master->tileBuffer, master->numPixels, 2, 0,
+        oaFrameFormats[ master->frameFormat ].littleEndian );
+    s = master->tileBuffer;
+  }
+  while ( left ) {
+    if (( ret = write ( master->tileFd, s, left )) < 0 ) {
+      if ( EINTR == errno ) {
+        continue;
+      }
+      oaLogError ( OA_LOG_IMGPROC, "%s: tile write failed: %s", __func__,
+          strerror ( errno ));
+      return -OA_ERR_NOT_WRITEABLE;
+    }
+    s += ret;
+    left -= ret;
+  }
+  return OA_ERR_NONE;
+}
+
+
+/**
+ * Read the stored frames back a tile of pixels at a time, where a tile
+ * is as many pixels as fit in the memory limit with every frame's value
+ * for them loaded, and find the median of each pixel
+ */
+
+static int
+_finishMedian ( oaMasterBuilder* master, uint16_t* result )
+{
+  uint8_t*	tile;
+  uint16_t*	column;
+  unsigned int	n = master->numFrames, bps = master->bytesPerSample;
+  unsigned int	tilePixels, first, count, f, i;
+  size_t	tileBytes, frameBytes = ( size_t ) master->numPixels * bps;
+  int64_t	offset;
+  ssize_t	ret;
+
+  tilePixels = master->memoryLimit / ( n * bps );
+  if ( tilePixels > master->numPixels ) {
+    tilePixels = master->numPixels;
+  }
+  if ( !tilePixels ) {
+    tilePixels = 1;
+  }
+  if (!( tile = malloc (( size_t ) tilePixels * n * bps ))) {
+    return -OA_ERR_MEM_ALLOC;
+  }
+  if (!( column = malloc ( n * sizeof ( uint16_t )))) {
+    free ( tile );
+    return -OA_ERR_MEM_ALLOC;
+  }
+
+  for ( first = 0; first < master->numPixels; first += count ) {
+    count = master->numPixels - first;
+    if ( count > tilePixels ) {
+      count = tilePixels;
+    }
+    tileBytes = ( size_t ) count * bps;
+    for ( f = 0; f < n; f++ ) {
+      offset = ( int64_t ) f * frameBytes + ( int64_t ) first * bps;
+      do {
+        ret = pread64 ( master->tileFd, tile + f * tileBytes, tileBytes,
+            offset );
+      } while ( ret < 0 && EINTR == errno );
+      if ( ret < 0 || ( size_t ) ret != tileBytes ) {
+        oaLogError ( OA_LOG_IMGPROC, "%s: tile read failed", __func__ );
+        free ( column );
+        free ( tile );
+        return -OA_ERR_NOT_READABLE;
+      }
+    }
+    for ( i = 0; i < count; i++ ) {
+      if ( 1 == bps ) {
+        for ( f = 0; f < n; f++ ) {
+          column[f] = tile[ f * tileBytes + i ];
+        }
+      } else {
+        for ( f = 0; f < n; f++ ) {
+          column[f] = (( uint16_t* )( tile + f * tileBytes ))[i];
+        }
+      }
+      result[ first + i ] = _median ( column, n );
+    }
+  }
+
+  free ( column );
+  free ( tile );
+  return OA_ERR_NONE;
+}
+
+
+/**
+ * Quickselect for the middle element, averaging the two middle elements
+ * when there are an even number
+ */
+
+static uint16_t
+_median ( uint16_t* v, unsigned int n )
+{
+  int		k = n / 2, left = 0, right = n - 1, i, j;
+  uint16_t	pivot, t, below;
+
+  while ( left < right ) {
+    pivot = v[ ( left + right ) / 2 ];
+    i = left;
+    j = right;
+    while ( i <= j ) {
+      while ( v[i] < pivot ) {
+        i++;
+      }
+      while ( v[j] > pivot ) {
+        j--;
+      }
+      if ( i <= j ) {
+        t = v[i];
+        v[i++] = v[j];
+        v[j--] = t;
+      }
+    }
+    if ( k <= j ) {
+      right = j;
+    } else if ( k >= i ) {
+      left = i;
+    } else {
+      break;
+    }
+  }
+
+  if ( n & 1 ) {
+    return v[k];
+  }
+  // Everything below k is now no larger than v[k]
+  below = v[0];
+  for ( i = 1; i < k; i++ ) {
+    if ( v[i] > below ) {
+      below = v[i];
+    }
+  }
+  return ( below + v[k] + 1 ) / 2;
+}
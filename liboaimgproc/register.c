@@ -0,0 +1,743 @@
+/*****************************************************************************
+ *
+ * register.c -- translation-only frame registration by phase correlation
+ *
+ * Copyright 2026
+ *   James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <oa_common.h>
+
+#include <math.h>
+
+#include <openastro/imgproc.h>
+#include <openastro/errno.h>
+#include <openastro/util.h>
+#include <openastro/video/formats.h>
+
+#include "threads.h"
+
+#define	DEFAULT_FFT_SIZE	256
+#define	MIN_FFT_SIZE		32
+
+// Shifts are applied with this many bits of sub-pixel precision
+
+#define	SHIFT_BITS		8
+#define	SHIFT_ONE		( 1 << SHIFT_BITS )
+
+// When looking for the best place for the full resolution window only
+// every SIGNAL_STEP'th pixel in each direction is looked at
+
+#define	SIGNAL_STEP		4
+
+typedef struct {
+  oaRegistration*	reg;
+  const void*		source;
+  void*			target;
+  int			first;
+  int			last;
+  int			ix;
+  int			iy;
+  unsigned int		fx;
+  unsigned int		fy;
+} shiftJob;
+
+static void	_extract ( oaRegistration*, const void*, int, int, int,
+		    float* );
+static void	_fft2d ( oaRegistration*, float*, int );
+static void	_fft ( oaRegistration*, float*, int );
+static double	_correlate ( oaRegistration*, const float*, double*,
+		    double* );
+static void*	_shiftRows ( void* );
+static double	_signal ( oaRegistration*, const void*, int, int );
+static void	_placeFineWindow ( oaRegistration*, const void* );
+
+
+/**
+ * Set up registration of frames of the given size and format, which must
+ * be mono or full colour, 8 or 16 bits per sample and not packed.  The
+ * shift is found by phase correlation of fftSize square windows, which
+ * must be a power of two (zero uses 256).  The first window covers as
+ * much of the middle of the frame as possible, binned down to fftSize,
+ * and the second refines that at full resolution wherever the reference
+ * frame has the most detail, so the work per frame is bounded whatever
+ * the frame size.  numThreads of zero uses one thread per processor when
+ * shifting frames.
+ */
+
+int
+oaRegistrationInit ( oaRegistration* reg, int xSize, int ySize,
+    int frameFormat, int fftSize, int numThreads )
+{
+  frameFormatInfo*	fmt;
+  unsigned int		one = 1;
+  int			i, j, bits, minSize;
+
+  memset ( reg, 0, sizeof ( oaRegistration ));
+  reg->xSize = xSize;
+  reg->ySize = ySize;
+  reg->frameFormat = frameFormat;
+
+  if ( frameFormat <= 0 || frameFormat >= OA_PIX_FMT_LAST_P1 ) {
+    return -OA_ERR_UNSUPPORTED_FORMAT;
+  }
+  fmt = &oaFrameFormats[ frameFormat ];
+  if (( !fmt->monochrome && !fmt->fullColour ) || fmt->packed ||
+      fmt->lumChrom || fmt->hasAlpha || fmt->planar ) {
+    oaLogError ( OA_LOG_IMGPROC, "%s: can't register format %s", __func__,
+        fmt->name );
+    return -OA_ERR_UNSUPPORTED_FORMAT;
+  }
+  reg->channels = fmt->fullColour ? 3 : 1;
+  reg->bytesPerSample = fmt->bytesPerPixel / reg->channels;
+  if ( reg->bytesPerSample != 1 && reg->bytesPerSample != 2 ) {
+    oaLogError ( OA_LOG_IMGPROC, "%s: can't register format %s", __func__,
+        fmt->name );
+    return -OA_ERR_UNSUPPORTED_FORMAT;
+  }
+  // Whether 16-bit frames can be treated as an array of uint16_t
+  reg->nativeOrder = ( fmt->littleEndian ? 1 : 0 ) ==
+      *(( uint8_t* ) &one );
+
+  if ( fftSize <= 0 ) {
+    fftSize = DEFAULT_FFT_SIZE;
+  }
+  if (( fftSize & ( fftSize - 1 )) || fftSize > OA_REGISTER_MAX_FFT_SIZE ) {
+    return -OA_ERR_OUT_OF_RANGE;
+  }
+  minSize = ( xSize < ySize ) ? xSize : ySize;
+  while ( fftSize > minSize && fftSize > MIN_FFT_SIZE ) {
+    fftSize >>= 1;
+  }
+  if ( fftSize > minSize ) {
+    return -OA_ERR_INVALID_SIZE;
+  }
+  reg->fftSize = fftSize;
+  reg->binning = minSize / fftSize;
+  reg->coarseX = ( xSize - fftSize * reg->binning ) / 2;
+  reg->coarseY = ( ySize - fftSize * reg->binning ) / 2;
+  reg->fineX = ( xSize - fftSize ) / 2;
+  reg->fineY = ( ySize - fftSize ) / 2;
+
+  reg->numThreads = _oaImgprocThreads ( numThreads,
+      ( unsigned long ) xSize * ySize, OA_REGISTER_MAX_THREADS );
+
+  if (!( reg->window = malloc ( fftSize * sizeof ( float ))) ||
+      !( reg->twiddle = malloc ( fftSize * sizeof ( float ))) ||
+      !( reg->bitReverse = malloc ( fftSize * sizeof ( unsigned int ))) ||
+      !( reg->refCoarse = malloc ( 2 * fftSize * fftSize *
+      sizeof ( float ))) || !( reg->refFine = malloc ( 2 * fftSize *
+      fftSize * sizeof ( float ))) || !( reg->work = malloc ( 2 * fftSize *
+      fftSize * sizeof ( float ))) || !( reg->column = malloc ( 2 *
+      fftSize * sizeof ( float )))) {
+    oaRegistrationFree ( reg );
+    return -OA_ERR_MEM_ALLOC;
+  }
+
+  // A Hann window stops the frame edges looking like a strong feature
+  // that doesn't move
+  for ( i = 0; i < fftSize; i++ ) {
+    reg->window[i] = 0.5 - 0.5 * cos ( 2 * M_PI * i / fftSize );
+  }
+  for ( i = 0; i < fftSize / 2; i++ ) {
+    reg->twiddle[ 2 * i ] = cos ( 2 * M_PI * i / fftSize );
+    reg->twiddle[ 2 * i + 1 ] = -sin ( 2 * M_PI * i / fftSize );
+  }
+  for ( bits = 0; ( 1 << bits ) < fftSize; bits++ );
+  for ( i = 0; i < fftSize; i++ ) {
+    reg->bitReverse[i] = 0;
+    for ( j = 0; j < bits; j++ ) {
+      if ( i & ( 1 << j )) {
+        reg->bitReverse[i] |= 1 << ( bits - 1 - j );
+      }
+    }
+  }
+  return OA_ERR_NONE;
+}
+
+
+void
+oaRegistrationFree ( oaRegistration* reg )
+{
+  if ( reg->window ) {
+    free ( reg->window );
+  }
+  if ( reg->twiddle ) {
+    free ( reg->twiddle );
+  }
+  if ( reg->bitReverse ) {
+    free ( reg->bitReverse );
+  }
+  if ( reg->refCoarse ) {
+    free ( reg->refCoarse );
+  }
+  if ( reg->refFine ) {
+    free ( reg->refFine );
+  }
+  if ( reg->work ) {
+    free ( reg->work );
+  }
+  if ( reg->column ) {
+    free ( reg->column );
+  }
+  reg->window = reg->twiddle = reg->refCoarse = reg->refFine = reg->work =
+      reg->column = 0;
+  reg->bitReverse = 0;
+  reg->haveReference = 0;
+}
+
+
+/**
+ * Make this frame the one all others are aligned to.  Only the spectra
+ * of its correlation windows are kept, not the frame itself.
+ */
+
+int
+oaRegistrationSetReference ( oaRegistration* reg, const void* frame )
+{
+  if ( !reg->work ) {
+    return -OA_ERR_INVALID_SIZE;
+  }
+  _extract ( reg, frame, reg->coarseX, reg->coarseY, reg->binning,
+      reg->refCoarse );
+  _fft2d ( reg, reg->refCoarse, 0 );
+  if ( reg->binning > 1 ) {
+    _placeFineWindow ( reg, frame );
+    _extract ( reg, frame, reg->fineX, reg->fineY, 1, reg->refFine );
+    _fft2d ( reg, reg->refFine, 0 );
+  }
+  reg->haveReference = 1;
+  reg->peak = 1.0;
+  return OA_ERR_NONE;
+}
+
+
+/**
+ * Measure the offset of a frame from the reference, such that pixel
+ * ( x, y ) of the reference is at ( x + *dx, y + *dy ) in this frame.
+ * The height of the correlation peak, between 0 and 1, is left in
+ * reg->peak as a measure of how much to trust the result.  reg->refined
+ * is cleared if the offset couldn't be refined at full resolution, in
+ * which case it is only good to about reg->binning pixels.  Returns
+ * -OA_ERR_OUT_OF_RANGE if it is below minPeak, in which case the frame
+ * probably doesn't match the reference well enough to stack.
+ */
+
+int
+oaRegistrationMeasure ( oaRegistration* reg, const void* frame,
+    double minPeak, double* dx, double* dy )
+{
+  double	cx, cy, fx, fy;
+  int		sx, sy, x0, y0;
+
+  *dx = *dy = 0;
+  reg->refined = 0;
+  if ( !reg->haveReference ) {
+    return -OA_ERR_INVALID_SIZE;
+  }
+
+  _extract ( reg, frame, reg->coarseX, reg->coarseY, reg->binning,
+      reg->work );
+  reg->peak = _correlate ( reg, reg->refCoarse, &cx, &cy );
+  if ( reg->peak < minPeak ) {
+    return -OA_ERR_OUT_OF_RANGE;
+  }
+  cx *= reg->binning;
+  cy *= reg->binning;
+  *dx = cx;
+  *dy = cy;
+  if ( reg->binning == 1 ) {
+    reg->refined = 1;
+    return OA_ERR_NONE;
+  }
+
+  // The binned estimate is only good to about one binned pixel, so
+  // correlate again at full resolution with the window moved by that
+  // much.  If that disagrees with the first estimate it has probably
+  // locked on to something fixed in the frame and is ignored.
+  sx = lrint ( cx );
+  sy = lrint ( cy );
+  x0 = reg->fineX + sx;
+  y0 = reg->fineY + sy;
+  if ( x0 >= 0 && y0 >= 0 && x0 + reg->fftSize <= reg->xSize &&
+      y0 + reg->fftSize <= reg->ySize ) {
+    _extract ( reg, frame, x0, y0, 1, reg->work );
+    if ( _correlate ( reg, reg->refFine, &fx, &fy ) >= minPeak &&
+        fabs ( fx ) <= reg->binning && fabs ( fy ) <= reg->binning ) {
+      *dx = sx + fx;
+      *dy = sy + fy;
+      reg->refined = 1;
+    }
+  }
+  return OA_ERR_NONE;
+}
+
+
+/**
+ * Copy a frame to target, moved so that it lines up with the reference
+ * given the offset found by oaRegistrationMeasure.  Source and target
+ * must not overlap.  Pixels that would come from outside the frame take
+ * the value of the nearest edge pixel.
+ */
+
+int
+oaRegistrationShift ( oaRegistration* reg, const void* source, void* target,
+    double dx, double dy )
+{
+  shiftJob	jobs[ OA_REGISTER_MAX_THREADS ];
+  double	floorX, floorY;
+  unsigned int	first, last;
+  int		i;
+
+  if ( !reg->work ) {
+    return -OA_ERR_INVALID_SIZE;
+  }
+
+  floorX = floor ( dx );
+  floorY = floor ( dy );
+  for ( i = 0; i < reg->numThreads; i++ ) {
+    jobs[i].reg = reg;
+    jobs[i].source = source;
+    jobs[i].target = target;
+    _oaImgprocChunk ( reg->ySize, reg->numThreads, i, 1, &first, &last );
+    jobs[i].first = first;
+    jobs[i].last = last;
+    jobs[i].ix = floorX;
+    jobs[i].iy = floorY;
+    jobs[i].fx = lrint (( dx - floorX ) * SHIFT_ONE );
+    jobs[i].fy = lrint (( dy - floorY ) * SHIFT_ONE );
+    // Rounding the fraction up to a whole pixel
+    if ( jobs[i].fx == SHIFT_ONE ) {
+      jobs[i].ix++;
+      jobs[i].fx = 0;
+    }
+    if ( jobs[i].fy == SHIFT_ONE ) {
+      jobs[i].iy++;
+      jobs[i].fy = 0;
+    }
+  }
+  _oaImgprocRun ( _shiftRows, jobs, sizeof ( shiftJob ), reg->numThreads );
+  return OA_ERR_NONE;
+}
+
+
+/**
+ * Move the full resolution window to wherever the reference frame has
+ * the most detail.  In a sparse star field the middle of the frame may
+ * well have nothing in it to correlate.  Only places at least a quarter
+ * of a window in from the edges are tried, so there is room for the
+ * frames to drift, and the middle is kept unless somewhere is better.
+ */
+
+static void
+_placeFineWindow ( oaRegistration* reg, const void* frame )
+{
+  double	signal, best;
+  int		margin, step, x, y;
+
+  margin = reg->fftSize / 4;
+  step = reg->fftSize / 2;
+  reg->fineX = ( reg->xSize - reg->fftSize ) / 2;
+  reg->fineY = ( reg->ySize - reg->fftSize ) / 2;
+  best = _signal ( reg, frame, reg->fineX, reg->fineY );
+  for ( y = margin; y + reg->fftSize + margin <= reg->ySize; y += step ) {
+    for ( x = margin; x + reg->fftSize + margin <= reg->xSize; x += step ) {
+      if (( signal = _signal ( reg, frame, x, y )) > best ) {
+        best = signal;
+        reg->fineX = x;
+        reg->fineY = y;
+      }
+    }
+  }
+}
+
+
+/**
+ * How much detail there is in the fftSize square starting at ( x0, y0 ),
+ * as the variance of a sample of its luminance weighted by the same
+ * window the correlation uses
+ */
+
+static double
+_signal ( oaRegistration* reg, const void* frame, int x0, int y0 )
+{
+  const uint8_t*	row8;
+  const uint16_t*	row16;
+  double		w, sum, sumSq, weights, v, mean;
+  unsigned int		s;
+  int			n, ch, rowLength, i, j, c;
+
+  n = reg->fftSize;
+  ch = reg->channels;
+  rowLength = reg->xSize * ch;
+  sum = sumSq = weights = 0;
+  for ( i = 0; i < n; i += SIGNAL_STEP ) {
+    row8 = ( const uint8_t* ) frame + ( y0 + i ) * rowLength + x0 * ch;
+    row16 = ( const uint16_t* ) frame + ( y0 + i ) * rowLength + x0 * ch;
+    for ( j = 0; j < n; j += SIGNAL_STEP ) {
+      v = 0;
+      for ( c = 0; c < ch; c++ ) {
+        if ( reg->bytesPerSample == 1 ) {
+          s = row8[ j * ch + c ];
+        } else {
+          s = row16[ j * ch + c ];
+          if ( !reg->nativeOrder ) {
+            s = (( s & 0xff ) << 8 ) | ( s >> 8 );
+          }
+        }
+        v += s;
+      }
+      w = reg->window[i] * reg->window[j];
+      sum += w * v;
+      sumSq += w * v * v;
+      weights += w;
+    }
+  }
+  if ( weights <= 0 ) {
+    return 0;
+  }
+  mean = sum / weights;
+  return sumSq / weights - mean * mean;
+}
+
+
+/**
+ * Fill a complex fftSize square with the luminance of the frame starting
+ * at ( x0, y0 ), binned by the given factor, less its mean and windowed
+ */
+
+static void
+_extract ( oaRegistration* reg, const void* frame, int x0, int y0,
+    int binning, float* out )
+{
+  const uint8_t*	row8;
+  const uint16_t*	row16;
+  float*		sums;
+  double		total;
+  float			mean, wy;
+  unsigned int		v;
+  int			n, ch, rowLength, x, y, i, j, c;
+
+  n = reg->fftSize;
+  ch = reg->channels;
+  rowLength = reg->xSize * ch;
+  for ( i = 0; i < n; i++ ) {
+    sums = out + 2 * i * n;
+    for ( j = 0; j < n; j++ ) {
+      sums[j] = 0;
+    }
+    for ( y = y0 + i * binning; y < y0 + ( i + 1 ) * binning; y++ ) {
+      if ( reg->bytesPerSample == 1 ) {
+        row8 = ( const uint8_t* ) frame + y * rowLength + x0 * ch;
+        for ( j = 0, x = 0; j < n; j++ ) {
+          for ( c = 0; c < binning * ch; c++, x++ ) {
+            sums[j] += row8[x];
+          }
+        }
+      } else {
+        row16 = ( const uint16_t* ) frame + y * rowLength + x0 * ch;
+        for ( j = 0, x = 0; j < n; j++ ) {
+          for ( c = 0; c < binning * ch; c++, x++ ) {
+            v = row16[x];
+            if ( !reg->nativeOrder ) {
+              v = (( v & 0xff ) << 8 ) | ( v >> 8 );
+            }
+            sums[j] += v;
+          }
+        }
+      }
+    }
+  }
+
+  // The rows were summed into the first half of each complex row so
+  // spread them out from the end backwards
+  total = 0;
+  for ( i = 0; i < n; i++ ) {
+    sums = out + 2 * i * n;
+    for ( j = n - 1; j >= 0; j-- ) {
+      total += sums[j];
+      sums[ 2 * j ] = sums[j];
+      sums[ 2 * j + 1 ] = 0;
+    }
+  }
+  mean = total / ( n * n );
+  for ( i = 0; i < n; i++ ) {
+    sums = out + 2 * i * n;
+    wy = reg->window[i];
+    for ( j = 0; j < n; j++ ) {
+      sums[ 2 * j ] = ( sums[ 2 * j ] - mean ) * wy * reg->window[j];
+    }
+  }
+}
+
+
+/**
+ * Phase correlate the spectrum of the reference with the window in
+ * reg->work, returning the height of the peak and its position to
+ * sub-pixel accuracy
+ */
+
+static double
+_correlate ( oaRegistration* reg, const float* ref, double* px, double* py )
+{
+  float*	w = reg->work;
+  float		re, im, mag, best;
+  double	l, r, c, d;
+  int		n, i, bx, by, xm, xp, ym, yp;
+
+  n = reg->fftSize;
+  _fft2d ( reg, w, 0 );
+  // Normalised cross power spectrum, conj ( ref ) * frame / | ... |
+  for ( i = 0; i < n * n; i++ ) {
+    re = ref[ 2 * i ] * w[ 2 * i ] + ref[ 2 * i + 1 ] * w[ 2 * i + 1 ];
+    im = ref[ 2 * i ] * w[ 2 * i + 1 ] - ref[ 2 * i + 1 ] * w[ 2 * i ];
+    mag = sqrtf ( re * re + im * im );
+    if ( mag > 1e-12 ) {
+      w[ 2 * i ] = re / mag;
+      w[ 2 * i + 1 ] = im / mag;
+    } else {
+      w[ 2 * i ] = w[ 2 * i + 1 ] = 0;
+    }
+  }
+  _fft2d ( reg, w, 1 );
+
+  best = w[0];
+  bx = by = 0;
+  for ( i = 1; i < n * n; i++ ) {
+    if ( w[ 2 * i ] > best ) {
+      best = w[ 2 * i ];
+      bx = i % n;
+      by = i / n;
+    }
+  }
+
+  // Fit a parabola through the peak and its neighbours on each axis
+  xm = ( bx + n - 1 ) % n;
+  xp = ( bx + 1 ) % n;
+  ym = ( by + n - 1 ) % n;
+  yp = ( by + 1 ) % n;
+  c = best;
+  l = w[ 2 * ( by * n + xm )];
+  r = w[ 2 * ( by * n + xp )];
+  d = l - 2 * c + r;
+  *px = ( bx > n / 2 ? bx - n : bx ) + ( d < 0 ? 0.5 * ( l - r ) / d : 0 );
+  l = w[ 2 * ( ym * n + bx )];
+  r = w[ 2 * ( yp * n + bx )];
+  d = l - 2 * c + r;
+  *py = ( by > n / 2 ? by - n : by ) + ( d < 0 ? 0.5 * ( l - r ) / d : 0 );
+
+  // The inverse transform isn't scaled, so a perfect match peaks at n^2
+  return best / ( n * n );
+}
+
+
+static void
+_fft2d ( oaRegistration* reg, float* data, int inverse )
+{
+  float*	col = reg->column;
+  int		n, i, j;
+
+  n = reg->fftSize;
+  for ( i = 0; i < n; i++ ) {
+    _fft ( reg, data + 2 * i * n, inverse );
+  }
+  for ( j = 0; j < n; j++ ) {
+    for ( i = 0; i < n; i++ ) {
+      col[ 2 * i ] = data[ 2 * ( i * n + j )];
+      col[ 2 * i + 1 ] = data[ 2 * ( i * n + j ) + 1 ];
+    }
+    _fft ( reg, col, inverse );
+    for ( i = 0; i < n; i++ ) {
+      data[ 2 * ( i * n + j )] = col[ 2 * i ];
+      data[ 2 * ( i * n + j ) + 1 ] = col[ 2 * i + 1 ];
+    }
+  }
+}
+
+
+/**
+ * In-place iterative radix-2 FFT of fftSize interleaved complex values
+ */
+
+static void
+_fft ( oaRegistration* reg, float* data, int inverse )
+{
+  float		wr, wi, tr, ti, sign;
+  int		n, len, half, step, i, j, k, a, b;
+
+  n = reg->fftSize;
+  sign = inverse ? -1 : 1;
+  for ( i = 0; i < n; i++ ) {
+    j = reg->bitReverse[i];
+    if ( j > i ) {
+      tr = data[ 2 * i ];
+      ti = data[ 2 * i + 1 ];
+      data[ 2 * i ] = data[ 2 * j ];
+      data[ 2 * i + 1 ] = data[ 2 * j + 1 ];
+      data[ 2 * j ] = tr;
+      data[ 2 * j + 1 ] = ti;
+    }
+  }
+  for ( len = 2; len <= n; len <<= 1 ) {
+    half = len / 2;
+    step = n / len;
+    for ( i = 0; i < n; i += len ) {
+      for ( k = 0; k < half; k++ ) {
+        wr = reg->twiddle[ 2 * k * step ];
+        wi = reg->twiddle[ 2 * k * step + 1 ] * sign;
+        a = i + k;
+        b = a + half;
+        tr = data[ 2 * b ] * wr - data[ 2 * b + 1 ] * wi;
+        ti = data[ 2 * b ] * wi + data[ 2 * b + 1 ] * wr;
+        data[ 2 * b ] = data[ 2 * a ] - tr;
+        data[ 2 * b + 1 ] = data[ 2 * a + 1 ] - ti;
+        data[ 2 * a ] += tr;
+        data[ 2 * a + 1 ] += ti;
+      }
+    }
+  }
+}
+
+
+/**
+ * Bilinear interpolation of a band of rows.  Each output row is made
+ * from two source rows, with the columns whose source pixels are both
+ * inside the frame done in a loop simple enough for the compiler to
+ * vectorise and the few at the edges clamped separately.
+ */
+
+#define	LERP(a,b,c,d) \
+	(((( a ) * ( SHIFT_ONE - fx ) + ( b ) * fx ) * ( SHIFT_ONE - fy ) + \
+	(( c ) * ( SHIFT_ONE - fx ) + ( d ) * fx ) * fy + \
+	( 1 << ( 2 * SHIFT_BITS - 1 ))) >> ( 2 * SHIFT_BITS ))
+
+#define	SWAP16(v)	(((( v ) & 0xff ) << 8 ) | (( v ) >> 8 ))
+
+static void*
+_shiftRows ( void* param )
+{
+  shiftJob*		job = param;
+  oaRegistration*	reg = job->reg;
+  const unsigned int	fx = job->fx, fy = job->fy;
+  const uint8_t*	r0_8;
+  const uint8_t*	r1_8;
+  uint8_t*		out8;
+  const uint16_t*	r0_16;
+  const uint16_t*	r1_16;
+  uint16_t*		out16;
+  unsigned int		a, b, c, d;
+  int			ch, rowLength, y, y0, y1, x, x0, x1, xa, xb, k;
+
+  ch = reg->channels;
+  rowLength = reg->xSize * ch;
+  // Output columns in [xa, xb) read source columns x + ix and x + ix + 1
+  // that are both inside the frame
+  xa = oaclamp ( 0, reg->xSize, -job->ix );
+  xb = oaclamp ( xa, reg->xSize, reg->xSize - 1 - job->ix );
+
+  for ( y = job->first; y < job->last; y++ ) {
+    y0 = oaclamp ( 0, reg->ySize - 1, y + job->iy );
+    y1 = oaclamp ( 0, reg->ySize - 1, y + job->iy + 1 );
+
+    if ( reg->bytesPerSample == 1 ) {
+      const uint8_t* restrict s0;
+      const uint8_t* restrict s1;
+      uint8_t* restrict o;
+
+      r0_8 = ( const uint8_t* ) job->source + y0 * rowLength;
+      r1_8 = ( const uint8_t* ) job->source + y1 * rowLength;
+      out8 = ( uint8_t* ) job->target + y * rowLength;
+      s0 = r0_8 + ( xa + job->ix ) * ch;
+      s1 = r1_8 + ( xa + job->ix ) * ch;
+      o = out8 + xa * ch;
+      for ( k = 0; k < ( xb - xa ) * ch; k++ ) {
+        o[k] = LERP ( s0[k], s0[ k + ch ], s1[k], s1[ k + ch ]);
+      }
+      for ( x = 0; x < reg->xSize; x++ ) {
+        if ( x == xa ) {
+          x = xb;
+          if ( x >= reg->xSize ) {
+            break;
+          }
+        }
+        x0 = oaclamp ( 0, reg->xSize - 1, x + job->ix ) * ch;
+        x1 = oaclamp ( 0, reg->xSize - 1, x + job->ix + 1 ) * ch;
+        for ( k = 0; k < ch; k++ ) {
+          out8[ x * ch + k ] = LERP ( r0_8[ x0 + k ], r0_8[ x1 + k ],
+              r1_8[ x0 + k ], r1_8[ x1 + k ]);
+        }
+      }
+    } else {
+      const uint16_t* restrict s0;
+      const uint16_t* restrict s1;
+      uint16_t* restrict o;
+
+      r0_16 = ( const uint16_t* ) job->source + y0 * rowLength;
+      r1_16 = ( const uint16_t* ) job->source + y1 * rowLength;
+      out16 = ( uint16_t* ) job->target + y * rowLength;
+      s0 = r0_16 + ( xa + job->ix ) * ch;
+      s1 = r1_16 + ( xa + job->ix ) * ch;
+      o = out16 + xa * ch;
+      if ( reg->nativeOrder ) {
+        for ( k = 0; k < ( xb - xa ) * ch; k++ ) {
+          o[k] = LERP ( s0[k], s0[ k + ch ], s1[k], s1[ k + ch ]);
+        }
+      } else {
+        for ( k = 0; k < ( xb - xa ) * ch; k++ ) {
+          a = SWAP16 ( s0[k] );
+          b = SWAP16 ( s0[ k + ch ] );
+          c = SWAP16 ( s1[k] );
+          d = SWAP16 ( s1[ k + ch ] );
+          a = LERP ( a, b, c, d );
+          o[k] = SWAP16 ( a );
+        }
+      }
+      for ( x = 0; x < reg->xSize; x++ ) {
+        if ( x == xa ) {
+          x = xb;
+          if ( x >= reg->xSize ) {
+            break;
+          }
+        }
+        x0 = oaclamp ( 0, reg->xSize - 1, x + job->ix ) * ch;
+        x1 = oaclamp ( 0, reg->xSize - 1, x + job->ix + 1 ) * ch;
+        for ( k = 0; k < ch; k++ ) {
+          a = r0_16[ x0 + k ];
+          b = r0_16[ x1 + k ];
+          c = r1_16[ x0 + k ];
+          d = r1_16[ x1 + k ];
+          if ( !reg->nativeOrder ) {
+            a = SWAP16 ( a );
+            b = SWAP16 ( b );
+            c = SWAP16 ( c );
+            d = SWAP16 ( d );
+            a = LERP ( a, b, c, d );
+            out16[ x * ch + k ] = SWAP16 ( a );
+          } else {
+            out16[ x * ch + k ] = LERP ( a, b, c, d );
+          }
+        }
+      }
+    }
+  }
+  return 0;
+}
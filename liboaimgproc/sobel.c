@@ -31,6 +31,8 @@
 #include <math.h>
 #endif
 
+#include <openastro/imgproc.h>
+
 #include "sobel.h"
 
 
@@ -83,3 +85,40 @@ sobel8 ( uint8_t* source, uint8_t* target, int xSize, int ySize )
 
   return score;
 }
+
+
+/**
+ * Mean Sobel gradient energy (gx^2 + gy^2) over the rectangle from
+ * (x0,y0) up to but not including (x1,y1), without writing an output
+ * image.  The rectangle is clipped to the interior of the frame.
+ */
+
+double
+sobel8Energy ( uint8_t* source, int xSize, int ySize, int x0, int y0,
+		int x1, int y1 )
+{
+	uint8_t*	p;
+	uint64_t	score = 0;
+	int				x, y, gx, gy;
+
+	x0 = oaclamp ( 1, xSize - 1, x0 );
+	y0 = oaclamp ( 1, ySize - 1, y0 );
+	x1 = oaclamp ( 1, xSize - 1, x1 );
+	y1 = oaclamp ( 1, ySize - 1, y1 );
+	if ( x1 <= x0 || y1 <= y0 ) {
+		return 0;
+	}
+
+	for ( y = y0; y < y1; y++ ) {
+		p = source + y * xSize + x0;
+		for ( x = x0; x < x1; x++, p++ ) {
+			gx = p[ -xSize - 1 ] + p[ -1 ] * 2 + p[ xSize - 1 ] -
+					p[ -xSize + 1 ] - p[ 1 ] * 2 - p[ xSize + 1 ];
+			gy = p[ -xSize - 1 ] + p[ -xSize ] * 2 + p[ -xSize + 1 ] -
+					p[ xSize - 1 ] - p[ xSize ] * 2 - p[ xSize + 1 ];
+			score += gx * gx + gy * gy;
+		}
+	}
+
+	return ( double ) score / (( double )( x1 - x0 ) * ( y1 - y0 ));
+}
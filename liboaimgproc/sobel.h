@@ -29,5 +29,6 @@
 
 extern unsigned long	sobel8 ( uint8_t*, uint8_t*, int, int );
 extern unsigned long	sobel16 ( uint16_t*, uint16_t*, int, int );
+extern double		sobel8Energy ( uint8_t*, int, int, int, int, int, int );
 
 #endif	/* OPENASTRO_IMGPROC_SOBEL_H */
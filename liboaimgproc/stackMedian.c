@@ -84,7 +84,7 @@ oaStackMedian16LE ( void** frameArray, unsigned int numFrames, void* target,
   unsigned int	i, j;
 	unsigned int	medianPos;
 
-	if (!( values = ( uint16_t* ) malloc ( numFrames ))) {
+	if (!( values = ( uint16_t* ) malloc ( numFrames * sizeof ( uint16_t )))) {
 		return -1;
 	}
 	medianPos = numFrames >> 1;
@@ -112,7 +112,7 @@ oaStackMedian16BE ( void** frameArray, unsigned int numFrames, void* target,
   unsigned int	i, j;
 	unsigned int	medianPos;
 
-	if (!( values = ( uint16_t* ) malloc ( numFrames ))) {
+	if (!( values = ( uint16_t* ) malloc ( numFrames * sizeof ( uint16_t )))) {
 		return -1;
 	}
 	medianPos = numFrames >> 1;
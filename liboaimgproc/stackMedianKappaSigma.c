@@ -113,7 +113,7 @@ oaStackMedianKappaSigma16LE ( void** frameArray, unsigned int numFrames,
 	unsigned int	finalMean, medianPos;
 	uint16_t			median;
 
-	if (!( values = ( uint16_t* ) malloc ( numFrames ))) {
+	if (!( values = ( uint16_t* ) malloc ( numFrames * sizeof ( uint16_t )))) {
 		return -1;
 	}
 	medianPos = numFrames >> 1;
@@ -168,7 +168,7 @@ oaStackMedianKappaSigma16BE ( void** frameArray, unsigned int numFrames,
 	unsigned int	finalMean, medianPos;
 	uint16_t			median;
 
-	if (!( values = ( uint16_t* ) malloc ( numFrames ))) {
+	if (!( values = ( uint16_t* ) malloc ( numFrames * sizeof ( uint16_t )))) {
 		return -1;
 	}
 	medianPos = numFrames >> 1;
@@ -0,0 +1,856 @@
+/*****************************************************************************
+ *
+ * stars.c -- find stars and measure their centroids, FWHM and HFR
+ *
+ * Copyright 2026
+ *   James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <oa_common.h>
+
+#include <math.h>
+
+#include <openastro/imgproc.h>
+#include <openastro/demosaic.h>
+#include <openastro/errno.h>
+#include <openastro/util.h>
+#include <openastro/video/formats.h>
+
+#include "threads.h"
+
+// The background and noise are measured in square cells of this many
+// detection image pixels, from every BACKGROUND_STEP'th pixel in each
+// direction
+
+#define	BACKGROUND_CELL		128
+#define	BACKGROUND_STEP		8
+#define	CELL_SAMPLES		(( BACKGROUND_CELL / BACKGROUND_STEP ) * \
+				( BACKGROUND_CELL / BACKGROUND_STEP ))
+
+#define	DEFAULT_SIGMAS		5.0
+#define	DEFAULT_MIN_AREA	3
+#define	DEFAULT_MAX_AREA	4096
+
+// One horizontal run of pixels above the detection threshold, with the
+// sums needed for the centroid of the star it is part of
+
+typedef struct {
+  int			y;
+  int			x0;
+  int			x1;		// inclusive
+  int			parent;
+  unsigned int		area;
+  int			saturated;
+  float			background;
+  float			peak;
+  double		sum;
+  double		sumX;
+  double		sumY;
+} starRun;
+
+typedef struct {
+  double		flux;
+  int			run;
+} starCandidate;
+
+typedef struct {
+  oaStarDetector*	det;
+  const uint8_t*	frame;
+  int			first;
+  int			last;
+  int32_t*		row;
+  float*		threshold;
+  float*		cells;
+  int32_t*		samples;
+  int*			counts;
+  starRun*		runs;
+  unsigned int		numRuns;
+  unsigned int		runSpace;
+  int			error;
+} starJob;
+
+static void	_runJobs ( oaStarDetector*, const void*, int,
+		    void* (*)( void* ));
+static void*	_measureBackground ( void* );
+static void*	_findRuns ( void* );
+static void	_interpolate ( const float*, int, float*, int );
+static float	_levelAt ( const float*, int, int );
+static void	_loadRow ( oaStarDetector*, const uint8_t*, int, int, int,
+		    int32_t* );
+static int32_t	_select ( int32_t*, int, int );
+static int	_findRoot ( starRun*, int );
+static int	_compareFlux ( const void*, const void* );
+static int	_compareDouble ( const void*, const void* );
+
+
+/**
+ * Set up star detection for frames of the given size and format.  Mono
+ * frames are used as they are and raw colour frames use the sum of the
+ * two green pixels of each 2x2 CFA cell, so stars are found in an image
+ * half the size of the frame in each direction.  All positions and sizes
+ * are returned in frame pixels regardless.  Up to maxStars of the
+ * brightest stars are kept.  numThreads of zero uses one thread per
+ * processor.
+ */
+
+int
+oaStarsInit ( oaStarDetector* det, int xSize, int ySize, int frameFormat,
+    unsigned int maxStars, int numThreads )
+{
+  frameFormatInfo*	fmt;
+  starJob*		jobs;
+  int			i;
+
+  memset ( det, 0, sizeof ( oaStarDetector ));
+  det->xSize = xSize;
+  det->ySize = ySize;
+  det->frameFormat = frameFormat;
+
+  if ( frameFormat <= 0 || frameFormat >= OA_PIX_FMT_LAST_P1 ) {
+    return -OA_ERR_UNSUPPORTED_FORMAT;
+  }
+  fmt = &oaFrameFormats[ frameFormat ];
+  if (( !fmt->monochrome && !fmt->rawColour ) || fmt->packed ||
+      ( fmt->bytesPerPixel != 1 && fmt->bytesPerPixel != 2 )) {
+    oaLogError ( OA_LOG_IMGPROC, "%s: can't find stars in format %s",
+        __func__, fmt->name );
+    return -OA_ERR_UNSUPPORTED_FORMAT;
+  }
+
+  det->scale = 1;
+  det->saturation = ( 1 << fmt->bitsPerPixel ) - 1;
+  if ( fmt->rawColour ) {
+    switch ( fmt->cfaPattern ) {
+      case OA_DEMOSAIC_RGGB:
+      case OA_DEMOSAIC_BGGR:
+        det->greenOffset = 1;
+        break;
+      case OA_DEMOSAIC_GRBG:
+      case OA_DEMOSAIC_GBRG:
+        det->greenOffset = 0;
+        break;
+      default:
+        oaLogError ( OA_LOG_IMGPROC, "%s: can't handle CFA pattern for %s",
+            __func__, fmt->name );
+        return -OA_ERR_UNSUPPORTED_FORMAT;
+    }
+    det->scale = 2;
+    det->saturation *= 2;
+  }
+  det->workX = xSize / det->scale;
+  det->workY = ySize / det->scale;
+  if ( det->workX < 3 || det->workY < 3 || maxStars < 1 ) {
+    return -OA_ERR_INVALID_SIZE;
+  }
+
+  det->sigmas = DEFAULT_SIGMAS;
+  det->minArea = DEFAULT_MIN_AREA;
+  det->maxArea = DEFAULT_MAX_AREA;
+  det->maxStars = maxStars;
+  det->gridX = ( det->workX + BACKGROUND_CELL - 1 ) / BACKGROUND_CELL;
+  det->gridY = ( det->workY + BACKGROUND_CELL - 1 ) / BACKGROUND_CELL;
+
+  det->numThreads = _oaImgprocThreads ( numThreads,
+      ( unsigned long ) det->workX * det->workY, OA_STARS_MAX_THREADS );
+
+  if (!( det->background = malloc ( det->gridX * det->gridY *
+      sizeof ( float ))) || !( det->noise = malloc ( det->gridX * det->gridY *
+      sizeof ( float ))) || !( det->stars = malloc ( maxStars *
+      sizeof ( oaStar ))) || !( det->scratch = malloc ( maxStars *
+      sizeof ( double ))) || !( det->jobs = calloc ( det->numThreads,
+      sizeof ( starJob )))) {
+    oaStarsFree ( det );
+    return -OA_ERR_MEM_ALLOC;
+  }
+  jobs = det->jobs;
+  for ( i = 0; i < det->numThreads; i++ ) {
+    if (!( jobs[i].row = malloc ( det->workX * sizeof ( int32_t ))) ||
+        !( jobs[i].threshold = malloc ( det->workX * sizeof ( float ))) ||
+        !( jobs[i].cells = malloc ( 2 * det->gridX * sizeof ( float ))) ||
+        !( jobs[i].samples = malloc ( det->gridX * CELL_SAMPLES *
+        sizeof ( int32_t ))) || !( jobs[i].counts = malloc ( det->gridX *
+        sizeof ( int )))) {
+      oaStarsFree ( det );
+      return -OA_ERR_MEM_ALLOC;
+    }
+  }
+
+  return OA_ERR_NONE;
+}
+
+
+void
+oaStarsFree ( oaStarDetector* det )
+{
+  starJob*	jobs = det->jobs;
+  int		i;
+
+  if ( jobs ) {
+    for ( i = 0; i < det->numThreads; i++ ) {
+      if ( jobs[i].row ) {
+        free ( jobs[i].row );
+      }
+      if ( jobs[i].threshold ) {
+        free ( jobs[i].threshold );
+      }
+      if ( jobs[i].cells ) {
+        free ( jobs[i].cells );
+      }
+      if ( jobs[i].samples ) {
+        free ( jobs[i].samples );
+      }
+      if ( jobs[i].counts ) {
+        free ( jobs[i].counts );
+      }
+      if ( jobs[i].runs ) {
+        free ( jobs[i].runs );
+      }
+    }
+    free ( jobs );
+  }
+  if ( det->background ) {
+    free ( det->background );
+  }
+  if ( det->noise ) {
+    free ( det->noise );
+  }
+  if ( det->stars ) {
+    free ( det->stars );
+  }
+  if ( det->scratch ) {
+    free ( det->scratch );
+  }
+  if ( det->runs ) {
+    free ( det->runs );
+  }
+  if ( det->candidates ) {
+    free ( det->candidates );
+  }
+  det->jobs = det->runs = det->candidates = 0;
+  det->background = det->noise = 0;
+  det->stars = 0;
+  det->scratch = 0;
+  det->runSpace = det->numStars = 0;
+}
+
+
+/**
+ * Change how far above the noise a pixel has to be to be part of a star,
+ * and the smallest and largest number of connected pixels, in the
+ * detection image, that are accepted as a star
+ */
+
+int
+oaStarsSetLimits ( oaStarDetector* det, double sigmas, unsigned int minArea,
+    unsigned int maxArea )
+{
+  if ( sigmas <= 0 || minArea < 1 || maxArea < minArea ) {
+    return -OA_ERR_OUT_OF_RANGE;
+  }
+  det->sigmas = sigmas;
+  det->minArea = minArea;
+  det->maxArea = maxArea;
+  return OA_ERR_NONE;
+}
+
+
+/**
+ * Find the stars in a frame.  The background and its noise are measured
+ * on a coarse grid, then each row is thresholded into runs of bright
+ * pixels, with the sums for their centroids collected as they are found.
+ * Both of those are split between the threads.  Runs are joined into
+ * stars by union-find, and the brightest stars get a second look at
+ * their pixels to measure the HFR.  Returns the number of stars found,
+ * which are sorted brightest first in det->stars, or a negative error.
+ */
+
+int
+oaStarsDetect ( oaStarDetector* det, const void* frame )
+{
+  starJob*	jobs = det->jobs;
+  starRun*	runs;
+  starRun*	r;
+  starCandidate* candidates;
+  oaStar*	star;
+  int32_t*	pixels;
+  void*		p;
+  unsigned int	total, space, numCandidates, i, j, k;
+  int		prevStart, prevEnd, rowStart, root, a, b, x;
+  double	w, dx, dy, sumR;
+
+  det->numStars = 0;
+  det->medianFWHM = det->medianHFR = 0;
+  if ( !jobs ) {
+    return -OA_ERR_INVALID_SIZE;
+  }
+
+  _runJobs ( det, frame, det->gridY, _measureBackground );
+  _runJobs ( det, frame, det->workY, _findRuns );
+
+  total = 0;
+  for ( i = 0; i < ( unsigned int ) det->numThreads; i++ ) {
+    if ( jobs[i].error ) {
+      return jobs[i].error;
+    }
+    total += jobs[i].numRuns;
+  }
+  if ( !total ) {
+    return 0;
+  }
+  if ( total > det->runSpace ) {
+    space = total + total / 4;
+    if (!( p = realloc ( det->runs, space * sizeof ( starRun )))) {
+      return -OA_ERR_MEM_ALLOC;
+    }
+    det->runs = p;
+    if (!( p = realloc ( det->candidates, space *
+        sizeof ( starCandidate )))) {
+      return -OA_ERR_MEM_ALLOC;
+    }
+    det->candidates = p;
+    det->runSpace = space;
+  }
+
+  // The jobs worked on consecutive bands of rows, so putting their runs
+  // end to end keeps them in row order
+  runs = det->runs;
+  candidates = det->candidates;
+  total = 0;
+  for ( i = 0; i < ( unsigned int ) det->numThreads; i++ ) {
+    memcpy ( runs + total, jobs[i].runs, jobs[i].numRuns *
+        sizeof ( starRun ));
+    total += jobs[i].numRuns;
+  }
+
+  // Join each run to any in the row above that touch it, including
+  // diagonally
+  prevStart = prevEnd = 0;
+  rowStart = 0;
+  for ( i = 0; i < total; i++ ) {
+    runs[i].parent = i;
+    if ( i && runs[i].y != runs[ i - 1 ].y ) {
+      if ( runs[i].y == runs[ i - 1 ].y + 1 ) {
+        prevStart = rowStart;
+        prevEnd = i;
+      } else {
+        prevStart = prevEnd = i;
+      }
+      rowStart = i;
+    }
+    while ( prevStart < prevEnd && runs[ prevStart ].x1 + 1 < runs[i].x0 ) {
+      prevStart++;
+    }
+    for ( j = prevStart; j < ( unsigned int ) prevEnd &&
+        runs[j].x0 <= runs[i].x1 + 1; j++ ) {
+      a = _findRoot ( runs, i );
+      b = _findRoot ( runs, j );
+      if ( a != b ) {
+        if ( a < b ) {
+          runs[b].parent = a;
+        } else {
+          runs[a].parent = b;
+        }
+      }
+    }
+  }
+
+  // Roots always have the lowest index of their star, so a single pass
+  // forwards can add every run into its root
+  numCandidates = 0;
+  for ( i = 0; i < total; i++ ) {
+    root = _findRoot ( runs, i );
+    runs[i].parent = root;
+    if ( root != ( int ) i ) {
+      r = &runs[ root ];
+      r->area += runs[i].area;
+      r->saturated |= runs[i].saturated;
+      r->sum += runs[i].sum;
+      r->sumX += runs[i].sumX;
+      r->sumY += runs[i].sumY;
+      if ( runs[i].peak > r->peak ) {
+        r->peak = runs[i].peak;
+      }
+    }
+  }
+  for ( i = 0; i < total; i++ ) {
+    if ( runs[i].parent == ( int ) i && runs[i].sum > 0 &&
+        runs[i].area >= det->minArea && runs[i].area <= det->maxArea ) {
+      candidates[ numCandidates ].flux = runs[i].sum;
+      candidates[ numCandidates++ ].run = i;
+    }
+  }
+  if ( !numCandidates ) {
+    return 0;
+  }
+  qsort ( candidates, numCandidates, sizeof ( starCandidate ),
+      _compareFlux );
+  if ( numCandidates > det->maxStars ) {
+    numCandidates = det->maxStars;
+  }
+
+  // Roots that are kept remember which star they became in their parent
+  // field, which no longer matters for a root.  Everything else is
+  // marked with -1.
+  for ( i = 0; i < total; i++ ) {
+    if ( runs[i].parent == ( int ) i ) {
+      runs[i].parent = -1;
+    }
+  }
+  for ( k = 0; k < numCandidates; k++ ) {
+    r = &runs[ candidates[k].run ];
+    star = &det->stars[k];
+    star->x = r->sumX / r->sum;
+    star->y = r->sumY / r->sum;
+    star->flux = r->sum;
+    star->peak = r->peak;
+    star->area = r->area;
+    star->saturated = r->saturated;
+    star->hfr = 0;
+    r->parent = -2 - k;
+  }
+
+  // The HFR is the flux weighted mean distance from the centroid, which
+  // needs the centroid first, so the pixels of the kept stars are read
+  // again
+  pixels = jobs[0].row;
+  for ( i = 0; i < total; i++ ) {
+    root = ( runs[i].parent <= -2 ) ? ( int ) i : runs[i].parent;
+    if ( root < 0 || runs[ root ].parent > -2 ) {
+      continue;
+    }
+    star = &det->stars[ -2 - runs[ root ].parent ];
+    _loadRow ( det, frame, runs[i].y, runs[i].x0, runs[i].x1 -
+        runs[i].x0 + 1, pixels );
+    dy = runs[i].y - star->y;
+    sumR = 0;
+    for ( x = runs[i].x0; x <= runs[i].x1; x++ ) {
+      w = pixels[ x - runs[i].x0 ] - runs[i].background;
+      if ( w > 0 ) {
+        dx = x - star->x;
+        sumR += w * sqrt ( dx * dx + dy * dy );
+      }
+    }
+    star->hfr += sumR;
+  }
+
+  // Convert to frame pixels.  The FWHM is that of a gaussian with the
+  // same flux and peak, which doesn't suffer from only the top of the
+  // star being above the threshold as much as a second moment would.
+  for ( k = 0; k < numCandidates; k++ ) {
+    star = &det->stars[k];
+    star->hfr = star->hfr / star->flux * det->scale;
+    star->fwhm = 2.35482 * sqrt ( star->flux / ( 2 * M_PI * star->peak )) *
+        det->scale;
+    star->x = star->x * det->scale + ( det->scale - 1 ) / 2.0;
+    star->y = star->y * det->scale + ( det->scale - 1 ) / 2.0;
+  }
+  det->numStars = numCandidates;
+
+  // Saturated stars would make the medians look better than they are
+  for ( k = 0, j = 0; k < numCandidates; k++ ) {
+    if ( !det->stars[k].saturated ) {
+      det->scratch[ j++ ] = det->stars[k].fwhm;
+    }
+  }
+  if ( j ) {
+    qsort ( det->scratch, j, sizeof ( double ), _compareDouble );
+    det->medianFWHM = det->scratch[ j / 2 ];
+    for ( k = 0, j = 0; k < numCandidates; k++ ) {
+      if ( !det->stars[k].saturated ) {
+        det->scratch[ j++ ] = det->stars[k].hfr;
+      }
+    }
+    qsort ( det->scratch, j, sizeof ( double ), _compareDouble );
+    det->medianHFR = det->scratch[ j / 2 ];
+  }
+  return numCandidates;
+}
+
+
+/**
+ * Split n rows (or rows of cells) between the threads and run func on
+ * each share.
+ */
+
+static void
+_runJobs ( oaStarDetector* det, const void* frame, int n,
+    void* ( *func )( void* ))
+{
+  starJob*	jobs = det->jobs;
+  unsigned int	first, last;
+  int		i;
+
+  for ( i = 0; i < det->numThreads; i++ ) {
+    jobs[i].det = det;
+    jobs[i].frame = frame;
+    _oaImgprocChunk ( n, det->numThreads, i, 1, &first, &last );
+    jobs[i].first = first;
+    jobs[i].last = last;
+    jobs[i].error = 0;
+  }
+  _oaImgprocRun ( func, jobs, sizeof ( starJob ), det->numThreads );
+}
+
+
+/**
+ * Median and noise of each background cell in a band of cell rows.  The
+ * noise is from the median absolute deviation, so stars in the cell
+ * don't affect it much.
+ */
+
+static void*
+_measureBackground ( void* param )
+{
+  starJob*		job = param;
+  oaStarDetector*	det = job->det;
+  int32_t*		s;
+  int			cy, cx, y, x, yEnd, xEnd, n, i;
+  int32_t		median;
+  float			noise;
+
+  for ( cy = job->first; cy < job->last; cy++ ) {
+    for ( cx = 0; cx < det->gridX; cx++ ) {
+      job->counts[ cx ] = 0;
+    }
+    yEnd = ( cy + 1 ) * BACKGROUND_CELL;
+    if ( yEnd > det->workY ) {
+      yEnd = det->workY;
+    }
+    // Gather the samples for the whole row of cells one image row at a
+    // time
+    for ( y = cy * BACKGROUND_CELL + BACKGROUND_STEP / 2; y < yEnd;
+        y += BACKGROUND_STEP ) {
+      _loadRow ( det, job->frame, y, 0, det->workX, job->row );
+      for ( cx = 0; cx < det->gridX; cx++ ) {
+        s = job->samples + cx * CELL_SAMPLES;
+        n = job->counts[ cx ];
+        xEnd = ( cx + 1 ) * BACKGROUND_CELL;
+        if ( xEnd > det->workX ) {
+          xEnd = det->workX;
+        }
+        for ( x = cx * BACKGROUND_CELL + BACKGROUND_STEP / 2; x < xEnd;
+            x += BACKGROUND_STEP ) {
+          s[ n++ ] = job->row[x];
+        }
+        job->counts[ cx ] = n;
+      }
+    }
+    for ( cx = 0; cx < det->gridX; cx++ ) {
+      s = job->samples + cx * CELL_SAMPLES;
+      n = job->counts[ cx ];
+      if ( !n ) {
+        // A sliver of a cell at the edge too thin to sample
+        s[ n++ ] = 0;
+      }
+      median = _select ( s, n, n / 2 );
+      for ( i = 0; i < n; i++ ) {
+        s[i] = abs ( s[i] - median );
+      }
+      noise = 1.4826 * _select ( s, n, n / 2 );
+      det->background[ cy * det->gridX + cx ] = median;
+      det->noise[ cy * det->gridX + cx ] = noise < 1 ? 1 : noise;
+    }
+  }
+  return 0;
+}
+
+
+/**
+ * Threshold a band of rows into runs of pixels above the background,
+ * collecting the sums for the centroids as they go
+ */
+
+static void*
+_findRuns ( void* param )
+{
+  starJob*		job = param;
+  oaStarDetector*	det = job->det;
+  const float*		bg0;
+  const float*		bg1;
+  const float*		n0;
+  const float*		n1;
+  float*		levels;
+  float*		thresholds;
+  starRun*		r;
+  float			cy, wy, v;
+  int			y, x, c, c0;
+  void*			p;
+
+  job->numRuns = 0;
+  for ( y = job->first; y < job->last; y++ ) {
+    cy = ( y + 0.5 ) / BACKGROUND_CELL - 0.5;
+    c0 = floorf ( cy );
+    if ( c0 < 0 ) {
+      c0 = 0;
+      wy = 0;
+    } else if ( c0 >= det->gridY - 1 ) {
+      c0 = det->gridY > 1 ? det->gridY - 2 : 0;
+      wy = det->gridY > 1 ? 1 : 0;
+    } else {
+      wy = cy - c0;
+    }
+    bg0 = det->background + c0 * det->gridX;
+    n0 = det->noise + c0 * det->gridX;
+    bg1 = det->gridY > 1 ? bg0 + det->gridX : bg0;
+    n1 = det->gridY > 1 ? n0 + det->gridX : n0;
+
+    // Background level and threshold for each cell in this row.  The
+    // threshold is needed for every pixel so is interpolated across the
+    // whole row, but the level only for the few pixels above it.
+    levels = job->cells;
+    thresholds = job->cells + det->gridX;
+    for ( c = 0; c < det->gridX; c++ ) {
+      levels[c] = bg0[c] + ( bg1[c] - bg0[c] ) * wy;
+      thresholds[c] = levels[c] + det->sigmas * ( n0[c] + ( n1[c] - n0[c] ) *
+          wy );
+    }
+    _interpolate ( thresholds, det->gridX, job->threshold, det->workX );
+
+    _loadRow ( det, job->frame, y, 0, det->workX, job->row );
+    r = 0;
+    for ( x = 0; x < det->workX; x++ ) {
+      if ( job->row[x] <= job->threshold[x] ) {
+        r = 0;
+        continue;
+      }
+      if ( !r ) {
+        if ( job->numRuns == job->runSpace ) {
+          if (!( p = realloc ( job->runs, ( job->runSpace + 1024 ) *
+              sizeof ( starRun )))) {
+            job->error = -OA_ERR_MEM_ALLOC;
+            return 0;
+          }
+          job->runs = p;
+          job->runSpace += 1024;
+        }
+        r = &job->runs[ job->numRuns++ ];
+        r->y = y;
+        r->x0 = x;
+        r->area = 0;
+        r->saturated = 0;
+        r->background = _levelAt ( levels, det->gridX, x );
+        r->peak = 0;
+        r->sum = r->sumX = r->sumY = 0;
+      }
+      v = job->row[x] - _levelAt ( levels, det->gridX, x );
+      r->x1 = x;
+      r->area++;
+      r->sum += v;
+      r->sumX += ( double ) v * x;
+      r->sumY += ( double ) v * y;
+      if ( v > r->peak ) {
+        r->peak = v;
+      }
+      if ( job->row[x] >= det->saturation ) {
+        r->saturated = 1;
+      }
+    }
+  }
+  return 0;
+}
+
+
+/**
+ * Spread values for each cell across a row, linearly between the cell
+ * centres and flat beyond the outermost ones
+ */
+
+static void
+_interpolate ( const float* cells, int numCells, float* restrict row, int n )
+{
+  float		v, slope;
+  int		c, x, end;
+
+  x = 0;
+  for ( c = -1; c < numCells; c++ ) {
+    // Up to and including the centre of the next cell
+    end = ( c + 1 < numCells ) ? ( c + 1 ) * BACKGROUND_CELL +
+        BACKGROUND_CELL / 2 : n;
+    if ( end > n ) {
+      end = n;
+    }
+    if ( c < 0 || c + 1 >= numCells ) {
+      v = cells[ c < 0 ? 0 : numCells - 1 ];
+      for ( ; x < end; x++ ) {
+        row[x] = v;
+      }
+    } else {
+      slope = ( cells[ c + 1 ] - cells[c] ) / BACKGROUND_CELL;
+      v = cells[c] - slope * ( c * BACKGROUND_CELL + BACKGROUND_CELL / 2 -
+          0.5 );
+      for ( ; x < end; x++ ) {
+        row[x] = v + slope * x;
+      }
+    }
+  }
+}
+
+
+/**
+ * One value from a row of cells, interpolated in the same way
+ */
+
+static float
+_levelAt ( const float* cells, int numCells, int x )
+{
+  float		c = ( x + 0.5 ) / BACKGROUND_CELL - 0.5;
+  int		c0 = floorf ( c );
+
+  if ( c0 < 0 ) {
+    return cells[0];
+  }
+  if ( c0 >= numCells - 1 ) {
+    return cells[ numCells - 1 ];
+  }
+  return cells[ c0 ] + ( cells[ c0 + 1 ] - cells[ c0 ] ) * ( c - c0 );
+}
+
+
+/**
+ * Load n pixels of a row of the detection image starting at x0
+ */
+
+static void
+_loadRow ( oaStarDetector* det, const uint8_t* frame, int row, int x0,
+    int n, int32_t* t )
+{
+  frameFormatInfo*	fmt = &oaFrameFormats[ det->frameFormat ];
+  const uint8_t*	s;
+  const uint8_t*	s1;
+  int			i, hi, lo;
+
+  hi = fmt->littleEndian ? 1 : 0;
+  lo = 1 - hi;
+
+  if ( fmt->rawColour ) {
+    // Both greens in each 2x2 cell.  One is at greenOffset in the even
+    // row and the other at the opposite column in the odd row
+    s = frame + ( 2 * row * det->xSize + 2 * x0 + det->greenOffset ) *
+        ( int ) fmt->bytesPerPixel;
+    s1 = frame + (( 2 * row + 1 ) * det->xSize + 2 * x0 + 1 -
+        det->greenOffset ) * ( int ) fmt->bytesPerPixel;
+    if ( fmt->bytesPerPixel == 1 ) {
+      for ( i = 0; i < n; i++ ) {
+        t[i] = s[ 2 * i ] + s1[ 2 * i ];
+      }
+    } else {
+      for ( i = 0; i < n; i++ ) {
+        t[i] = (( s[ 4 * i + hi ] << 8 ) | s[ 4 * i + lo ] ) +
+            (( s1[ 4 * i + hi ] << 8 ) | s1[ 4 * i + lo ] );
+      }
+    }
+    return;
+  }
+
+  s = frame + ( row * det->xSize + x0 ) * ( int ) fmt->bytesPerPixel;
+  if ( fmt->bytesPerPixel == 1 ) {
+    for ( i = 0; i < n; i++ ) {
+      t[i] = s[i];
+    }
+  } else {
+    for ( i = 0; i < n; i++ ) {
+      t[i] = ( s[ 2 * i + hi ] << 8 ) | s[ 2 * i + lo ];
+    }
+  }
+}
+
+
+/**
+ * Quickselect the k'th smallest of n values, reordering them
+ */
+
+static int32_t
+_select ( int32_t* v, int n, int k )
+{
+  int		lo = 0, hi = n - 1, i, j;
+  int32_t	pivot, t;
+
+  while ( lo < hi ) {
+    pivot = v[( lo + hi ) / 2 ];
+    i = lo;
+    j = hi;
+    while ( i <= j ) {
+      while ( v[i] < pivot ) {
+        i++;
+      }
+      while ( v[j] > pivot ) {
+        j--;
+      }
+      if ( i <= j ) {
+        t = v[i];
+        v[i] = v[j];
+        v[j] = t;
+        i++;
+        j--;
+      }
+    }
+    if ( k <= j ) {
+      hi = j;
+    } else if ( k >= i ) {
+      lo = i;
+    } else {
+      break;
+    }
+  }
+  return v[k];
+}
+
+
+static int
+_findRoot ( starRun* runs, int i )
+{
+  int		root = i, next;
+
+  while ( runs[ root ].parent != root ) {
+    root = runs[ root ].parent;
+  }
+  while ( runs[i].parent != root ) {
+    next = runs[i].parent;
+    runs[i].parent = root;
+    i = next;
+  }
+  return root;
+}
+
+
+/**
+ * Brightest first
+ */
+
+static int
+_compareFlux ( const void* a, const void* b )
+{
+  double	fa = (( const starCandidate* ) a )->flux;
+  double	fb = (( const starCandidate* ) b )->flux;
+
+  return ( fa < fb ) - ( fa > fb );
+}
+
+
+static int
+_compareDouble ( const void* a, const void* b )
+{
+  double	da = *(( const double* ) a );
+  double	db = *(( const double* ) b );
+
+  return ( da > db ) - ( da < db );
+}
@@ -0,0 +1,240 @@
+/*****************************************************************************
+ *
+ * threads.c -- thread sharing for the image processing engines
+ *
+ * Copyright 2026 James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <oa_common.h>
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include <openastro/imgproc.h>
+#include <openastro/util.h>
+
+#include "threads.h"
+
+/*
+ * All the engines share one pool of worker threads, started the first
+ * time there is work for more than one thread and left running until the
+ * process exits, so nothing is created or joined per frame.  Jobs are
+ * handed over in a fixed size queue.  The caller of _oaImgprocRun() does
+ * the first job itself, then helps with whatever is left in the queue
+ * before waiting for the workers to finish the rest, so jobs are never
+ * stuck behind a busy pool.  Any that don't fit in the queue (or if no
+ * worker could be started) are just done by the caller.
+ */
+
+#define	QUEUE_SIZE		( 4 * IMGPROC_MAX_THREADS )
+
+typedef struct {
+  unsigned int		remaining;
+} imgprocRun;
+
+typedef struct {
+  void*			( *func )( void* );
+  void*			job;
+  imgprocRun*		run;
+} imgprocTask;
+
+typedef struct {
+  pthread_mutex_t	mutex;
+  pthread_cond_t	work;
+  pthread_cond_t	done;
+  int			numWorkers;
+  imgprocTask		queue[ QUEUE_SIZE ];
+  unsigned int		head;
+  unsigned int		count;
+} imgprocPool;
+
+static imgprocPool	pool = {
+  .mutex = PTHREAD_MUTEX_INITIALIZER,
+  .work = PTHREAD_COND_INITIALIZER,
+  .done = PTHREAD_COND_INITIALIZER
+};
+static pthread_once_t	poolInitOnce = PTHREAD_ONCE_INIT;
+
+static void		_poolInit ( void );
+static void*		_worker ( void* );
+static void		_runTask ( imgprocTask* );
+
+
+/**
+ * The number of threads to use for a frame of the given number of
+ * pixels.  A requested count of zero or less means one per processor.
+ * The result is never more than max and never less than one.
+ */
+
+int
+_oaImgprocThreads ( int requested, unsigned long pixels, int max )
+{
+  long		cpus;
+
+  if ( requested <= 0 ) {
+    cpus = sysconf ( _SC_NPROCESSORS_ONLN );
+    requested = ( cpus > 0 ) ? cpus : 1;
+  }
+  if (( unsigned long ) requested * IMGPROC_MIN_PIXELS_PER_THREAD > pixels ) {
+    requested = pixels / IMGPROC_MIN_PIXELS_PER_THREAD;
+  }
+  if ( max > IMGPROC_MAX_THREADS ) {
+    max = IMGPROC_MAX_THREADS;
+  }
+  return oaclamp ( 1, max, requested );
+}
+
+
+/**
+ * The range [ *first, *last ) of n items that job i of numThreads
+ * should do.  Each range starts on a multiple of align, which must be
+ * a power of two.  Using 64 for pixels means no two threads ever write
+ * to the same cache line, and 2 for rows keeps every range starting at
+ * the top of a CFA cell.  The last job takes whatever is left over.
+ */
+
+void
+_oaImgprocChunk ( unsigned int n, int numThreads, int i, unsigned int align,
+    unsigned int* first, unsigned int* last )
+{
+  unsigned int	chunk;
+
+  chunk = (( n + numThreads - 1 ) / numThreads + align - 1 ) & ~( align - 1 );
+  *first = i * chunk;
+  *last = ( i + 1 ) * chunk;
+  if ( *first > n ) {
+    *first = n;
+  }
+  if ( *last > n || i == numThreads - 1 ) {
+    *last = n;
+  }
+}
+
+
+/**
+ * Run func on each of numThreads jobs of jobSize bytes, all in parallel.
+ * Every job has been done when this returns.
+ */
+
+void
+_oaImgprocRun ( void* ( *func )( void* ), void* jobs, size_t jobSize,
+    int numThreads )
+{
+  imgprocRun	run;
+  imgprocTask*	t;
+  imgprocTask	task;
+  int		i, queued;
+
+  if ( numThreads <= 1 ) {
+    ( void ) func ( jobs );
+    return;
+  }
+  pthread_once ( &poolInitOnce, _poolInit );
+
+  run.remaining = 0;
+  queued = 1;
+  pthread_mutex_lock ( &pool.mutex );
+  if ( pool.numWorkers ) {
+    for ( ; queued < numThreads && pool.count < QUEUE_SIZE; queued++ ) {
+      t = &pool.queue[( pool.head + pool.count++ ) % QUEUE_SIZE ];
+      t->func = func;
+      t->job = ( char* ) jobs + queued * jobSize;
+      t->run = &run;
+      run.remaining++;
+    }
+    if ( run.remaining ) {
+      pthread_cond_broadcast ( &pool.work );
+    }
+  }
+  pthread_mutex_unlock ( &pool.mutex );
+
+  ( void ) func ( jobs );
+  for ( i = queued; i < numThreads; i++ ) {
+    ( void ) func (( char* ) jobs + i * jobSize );
+  }
+
+  pthread_mutex_lock ( &pool.mutex );
+  while ( run.remaining ) {
+    if ( pool.count ) {
+      task = pool.queue[ pool.head ];
+      pool.head = ( pool.head + 1 ) % QUEUE_SIZE;
+      pool.count--;
+      _runTask ( &task );
+    } else {
+      pthread_cond_wait ( &pool.done, &pool.mutex );
+    }
+  }
+  pthread_mutex_unlock ( &pool.mutex );
+}
+
+
+static void
+_poolInit ( void )
+{
+  pthread_t	thread;
+  int		i;
+
+  for ( i = 1; i < IMGPROC_MAX_THREADS; i++ ) {
+    if ( pthread_create ( &thread, 0, _worker, 0 )) {
+      oaLogError ( OA_LOG_IMGPROC, "%s: only %d worker threads started",
+          __func__, pool.numWorkers );
+      break;
+    }
+    pthread_detach ( thread );
+    pthread_mutex_lock ( &pool.mutex );
+    pool.numWorkers++;
+    pthread_mutex_unlock ( &pool.mutex );
+  }
+}
+
+
+static void*
+_worker ( void* param )
+{
+  imgprocTask	task;
+
+  pthread_mutex_lock ( &pool.mutex );
+  for (;;) {
+    while ( !pool.count ) {
+      pthread_cond_wait ( &pool.work, &pool.mutex );
+    }
+    task = pool.queue[ pool.head ];
+    pool.head = ( pool.head + 1 ) % QUEUE_SIZE;
+    pool.count--;
+    _runTask ( &task );
+  }
+  return 0;
+}
+
+
+// Called with the pool locked, and returns with it locked again
+
+static void
+_runTask ( imgprocTask* task )
+{
+  pthread_mutex_unlock ( &pool.mutex );
+  ( void ) task->func ( task->job );
+  pthread_mutex_lock ( &pool.mutex );
+  if ( !--task->run->remaining ) {
+    pthread_cond_broadcast ( &pool.done );
+  }
+}
@@ -0,0 +1,49 @@
+/*****************************************************************************
+ *
+ * threads.h -- thread sharing for the image processing engines
+ *
+ * Copyright 2026 James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#ifndef OPENASTRO_IMGPROC_THREADS_H
+#define OPENASTRO_IMGPROC_THREADS_H
+
+/**
+ * Frames with fewer pixels than this per thread aren't worth starting
+ * threads for, so small frames are done by the calling thread alone.
+ */
+
+#define	IMGPROC_MIN_PIXELS_PER_THREAD	( 256 * 1024 )
+
+/**
+ * The most threads any of the engines will use.  Each engine's own
+ * OA_*_MAX_THREADS must not be more than this.
+ */
+
+#define	IMGPROC_MAX_THREADS		8
+
+extern int	_oaImgprocThreads ( int, unsigned long, int );
+extern void	_oaImgprocChunk ( unsigned int, int, int, unsigned int,
+			unsigned int*, unsigned int* );
+extern void	_oaImgprocRun ( void* ( * )( void* ), void*, size_t, int );
+
+#endif	/* OPENASTRO_IMGPROC_THREADS_H */
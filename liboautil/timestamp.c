@@ -0,0 +1,158 @@
+/*****************************************************************************
+ *
+ * timestamp.c -- binary frame timestamps
+ *
+ * Copyright 2026 James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <oa_common.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#if HAVE_TIME_H
+#include <time.h>
+#endif
+
+#include <openastro/errno.h>
+#include <openastro/timestamp.h>
+
+
+/**
+ * Take the monotonic and UTC times as close together as possible.  The
+ * monotonic clock here must match the one used for the frame statistics
+ * in liboacam, as the two are used to convert between each other.
+ */
+
+void
+oaTimestampNow ( oaTimestamp* stamp )
+{
+#if HAVE_CLOCK_GETTIME && defined(CLOCK_MONOTONIC)
+	struct timespec		mono, real;
+
+	clock_gettime ( CLOCK_MONOTONIC, &mono );
+	clock_gettime ( CLOCK_REALTIME, &real );
+	stamp->monotonic = ( uint64_t ) mono.tv_sec * 1000000000 + mono.tv_nsec;
+	stamp->utc = ( int64_t ) real.tv_sec * 1000000000 + real.tv_nsec;
+#else
+	struct timeval		t;
+
+	gettimeofday ( &t, 0 );
+	stamp->monotonic = ( uint64_t ) t.tv_sec * 1000000000 + t.tv_usec * 1000;
+	stamp->utc = ( int64_t ) stamp->monotonic;
+#endif
+}
+
+
+/**
+ * Write the UTC time as CCYY-MM-DDThh:mm:ss with the requested number of
+ * decimal places (0, OA_TIMESTAMP_MSEC or OA_TIMESTAMP_USEC).  This
+ * doesn't depend on the locale or allocate any memory, so is safe to use
+ * per-frame.
+ */
+
+int
+oaTimestampFormat ( const oaTimestamp* stamp, char* buffer, int length,
+		int places )
+{
+	struct tm		tm;
+	time_t			secs;
+	int64_t			nsecs;
+	int					used;
+
+	secs = stamp->utc / 1000000000;
+	nsecs = stamp->utc % 1000000000;
+	if ( nsecs < 0 ) {
+		secs--;
+		nsecs += 1000000000;
+	}
+	if ( !gmtime_r ( &secs, &tm )) {
+		return -OA_ERR_OUT_OF_RANGE;
+	}
+
+	switch ( places ) {
+		case 0:
+			used = snprintf ( buffer, length, "%04d-%02d-%02dT%02d:%02d:%02d",
+					tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour,
+					tm.tm_min, tm.tm_sec );
+			break;
+		case OA_TIMESTAMP_MSEC:
+			used = snprintf ( buffer, length,
+					"%04d-%02d-%02dT%02d:%02d:%02d.%03d", tm.tm_year + 1900,
+					tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec,
+					( int )( nsecs / 1000000 ));
+			break;
+		case OA_TIMESTAMP_USEC:
+			used = snprintf ( buffer, length,
+					"%04d-%02d-%02dT%02d:%02d:%02d.%06d", tm.tm_year + 1900,
+					tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec,
+					( int )( nsecs / 1000 ));
+			break;
+		default:
+			return -OA_ERR_INVALID_COMMAND;
+	}
+
+	if ( used < 0 || used >= length ) {
+		return -OA_ERR_OUT_OF_RANGE;
+	}
+	return OA_ERR_NONE;
+}
+
+
+/**
+ * Convert a UTC string of the form CCYY-MM-DDThh:mm:ss[.fff...], such as
+ * that returned by the timer, into the UTC part of a timestamp.  The
+ * monotonic time is left alone as there's no way to know it.
+ */
+
+int
+oaTimestampParse ( const char* str, oaTimestamp* stamp )
+{
+	struct tm		tm;
+	time_t			secs;
+	int64_t			nsecs = 0, scale = 100000000;
+	int					consumed = 0;
+
+	memset ( &tm, 0, sizeof ( tm ));
+	if ( sscanf ( str, "%d-%d-%dT%d:%d:%d%n", &tm.tm_year, &tm.tm_mon,
+			&tm.tm_mday, &tm.tm_hour, &tm.tm_min, &tm.tm_sec, &consumed ) != 6 ||
+			!consumed ) {
+		return -OA_ERR_INVALID_COMMAND;
+	}
+	str += consumed;
+	if ( *str == '.' ) {
+		str++;
+		while ( *str >= '0' && *str <= '9' ) {
+			nsecs += ( *str++ - '0' ) * scale;
+			scale /= 10;
+		}
+	}
+
+	tm.tm_mon--;
+	tm.tm_year -= 1900;
+	tm.tm_isdst = 0;
+	if (( secs = timegm ( &tm )) == ( time_t ) -1 ) {
+		return -OA_ERR_OUT_OF_RANGE;
+	}
+	stamp->utc = ( int64_t ) secs * 1000000000 + nsecs;
+	return OA_ERR_NONE;
+}
@@ -426,7 +426,8 @@ oaYUV411toRGB888 ( void* source, void* target, unsigned int xSize,
   uint8_t r8, g8, b8, y1, y2, y3, y4, u, v;
   float o;
 
-  while ( len > 0 ) {
+  // six bytes of source give four pixels
+  while ( len >= 4 ) {
     u = *s++;
     y1 = *s++;
     y2 = *s++;
@@ -484,6 +485,6 @@ oaYUV411toRGB888 ( void* source, void* target, unsigned int xSize,
     *t++ = g8;
     *t++ = b8;
 
-    len -= 6;
+    len -= 4;
   }
 }
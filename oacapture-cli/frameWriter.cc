@@ -0,0 +1,300 @@
+/*****************************************************************************
+ *
+ * frameWriter.cc -- queue frames from the camera to an output handler
+ *
+ * Copyright 2026
+ *   James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <oa_common.h>
+
+#include <cstdlib>
+#include <cstring>
+
+extern "C" {
+#include <openastro/camera.h>
+#include <openastro/timestamp.h>
+#include <openastro/util.h>
+}
+
+#include "outputHandler.h"
+#include "frameWriter.h"
+
+#define	SLOT_FREE			0
+#define	SLOT_FILLING	1
+#define	SLOT_QUEUED		2
+#define	SLOT_WRITING	3
+
+
+FrameWriter::FrameWriter ( OutputHandler* out, unsigned int n,
+		unsigned int frameSize, int64_t expTime ) :
+		output ( out ), exposure ( expTime ), numSlots ( n )
+{
+  nextIn = nextOut = 0;
+  queued = written = dropped = bytes = 0;
+  writeFailed = stopThread = threadRunning = 0;
+  pthread_mutex_init ( &slotMutex, 0 );
+  pthread_cond_init ( &slotQueued, 0 );
+
+  // The buffers are all allocated now rather than when frames start
+  // arriving.  They only get reallocated if a frame turns up bigger than
+  // expected.
+
+  slots = ( writerSlot* ) calloc ( numSlots, sizeof ( writerSlot ));
+  for ( unsigned int i = 0; slots && i < numSlots; i++ ) {
+    if (( slots[i].frame = malloc ( frameSize ))) {
+      slots[i].size = frameSize;
+    }
+  }
+}
+
+
+FrameWriter::~FrameWriter()
+{
+  stop();
+  if ( slots ) {
+    for ( unsigned int i = 0; i < numSlots; i++ ) {
+      free ( slots[i].frame );
+    }
+    free ( slots );
+  }
+  pthread_cond_destroy ( &slotQueued );
+  pthread_mutex_destroy ( &slotMutex );
+}
+
+
+int
+FrameWriter::start ( void )
+{
+  if ( !slots ) {
+    oaLogError ( OA_LOG_APP, "%s: no memory for frame buffers", __func__ );
+    return -1;
+  }
+  for ( unsigned int i = 0; i < numSlots; i++ ) {
+    if ( !slots[i].frame ) {
+      oaLogError ( OA_LOG_APP, "%s: no memory for frame buffers", __func__ );
+      return -1;
+    }
+  }
+  if ( pthread_create ( &writer, 0, writerThread, ( void* ) this )) {
+    oaLogError ( OA_LOG_APP, "%s: can't create writer thread", __func__ );
+    return -1;
+  }
+  threadRunning = 1;
+  return 0;
+}
+
+
+// Called from the camera's callback thread.  The only work done here is
+// the copy, so the camera gets its buffer back as quickly as possible.
+// Returns 1 if the frame was queued, 0 if it had to be dropped and -1 once
+// writing has failed so the caller can give up.
+
+int
+FrameWriter::queueFrame ( void* frame, int length, FRAME_METADATA* metadata )
+{
+  writerSlot*	slot;
+  void*		newFrame;
+
+  pthread_mutex_lock ( &slotMutex );
+  if ( writeFailed ) {
+    pthread_mutex_unlock ( &slotMutex );
+    return -1;
+  }
+  slot = &slots[ nextIn % numSlots ];
+  if ( slot->state != SLOT_FREE ) {
+    dropped++;
+    pthread_mutex_unlock ( &slotMutex );
+    return 0;
+  }
+  slot->state = SLOT_FILLING;
+  nextIn++;
+  pthread_mutex_unlock ( &slotMutex );
+
+  if (( unsigned int ) length > slot->size ) {
+    if (!( newFrame = realloc ( slot->frame, length ))) {
+      pthread_mutex_lock ( &slotMutex );
+      // the slot has already been claimed, so pass it on empty
+      slot->length = 0;
+      slot->state = SLOT_QUEUED;
+      dropped++;
+      pthread_mutex_unlock ( &slotMutex );
+      pthread_cond_signal ( &slotQueued );
+      return 0;
+    }
+    slot->frame = newFrame;
+    slot->size = length;
+  }
+
+  ( void ) memcpy ( slot->frame, frame, length );
+  slot->length = length;
+  if ( metadata ) {
+    slot->metadata = *metadata;
+    // the buffer behind this will be gone by the time it's written
+    slot->metadata.dmabufValid = 0;
+  } else {
+    memset ( &slot->metadata, 0, sizeof ( FRAME_METADATA ));
+  }
+  if ( !slot->metadata.timestampValid ) {
+    oaTimestampNow ( &slot->metadata.timestamp );
+    slot->metadata.timestampValid = 1;
+  }
+
+  pthread_mutex_lock ( &slotMutex );
+  slot->state = SLOT_QUEUED;
+  queued++;
+  pthread_mutex_unlock ( &slotMutex );
+  pthread_cond_signal ( &slotQueued );
+  return 1;
+}
+
+
+// Writes everything already queued before stopping.  The camera should
+// already have been stopped.
+
+void
+FrameWriter::stop ( void )
+{
+  if ( !threadRunning ) {
+    return;
+  }
+  pthread_mutex_lock ( &slotMutex );
+  stopThread = 1;
+  pthread_mutex_unlock ( &slotMutex );
+  pthread_cond_broadcast ( &slotQueued );
+  pthread_join ( writer, 0 );
+  threadRunning = 0;
+}
+
+
+void*
+FrameWriter::writerThread ( void* param )
+{
+  FrameWriter*	self = ( FrameWriter* ) param;
+  writerSlot*	slot;
+  int		ret, failed;
+
+  pthread_mutex_lock ( &self->slotMutex );
+  while ( 1 ) {
+    slot = &self->slots[ self->nextOut % self->numSlots ];
+    if ( slot->state != SLOT_QUEUED ) {
+      if ( self->stopThread && slot->state == SLOT_FREE ) {
+        break;
+      }
+      pthread_cond_wait ( &self->slotQueued, &self->slotMutex );
+      continue;
+    }
+    slot->state = SLOT_WRITING;
+    failed = self->writeFailed;
+    pthread_mutex_unlock ( &self->slotMutex );
+
+    ret = 0;
+    if ( slot->length && !failed ) {
+      ret = self->output->addFrame ( slot->frame, self->exposure, nullptr,
+          &slot->metadata, nullptr );
+    }
+
+    pthread_mutex_lock ( &self->slotMutex );
+    if ( ret < 0 ) {
+      self->writeFailed = 1;
+    } else if ( slot->length ) {
+      self->written++;
+      self->bytes += slot->length;
+    }
+    slot->state = SLOT_FREE;
+    self->nextOut++;
+  }
+  pthread_mutex_unlock ( &self->slotMutex );
+  return 0;
+}
+
+
+int
+FrameWriter::failed ( void )
+{
+  int		ret;
+
+  pthread_mutex_lock ( &slotMutex );
+  ret = writeFailed;
+  pthread_mutex_unlock ( &slotMutex );
+  return ret;
+}
+
+
+uint64_t
+FrameWriter::framesQueued ( void )
+{
+  uint64_t	ret;
+
+  pthread_mutex_lock ( &slotMutex );
+  ret = queued;
+  pthread_mutex_unlock ( &slotMutex );
+  return ret;
+}
+
+
+uint64_t
+FrameWriter::framesWritten ( void )
+{
+  uint64_t	ret;
+
+  pthread_mutex_lock ( &slotMutex );
+  ret = written;
+  pthread_mutex_unlock ( &slotMutex );
+  return ret;
+}
+
+
+uint64_t
+FrameWriter::framesDropped ( void )
+{
+  uint64_t	ret;
+
+  pthread_mutex_lock ( &slotMutex );
+  ret = dropped;
+  pthread_mutex_unlock ( &slotMutex );
+  return ret;
+}
+
+
+uint64_t
+FrameWriter::bytesWritten ( void )
+{
+  uint64_t	ret;
+
+  pthread_mutex_lock ( &slotMutex );
+  ret = bytes;
+  pthread_mutex_unlock ( &slotMutex );
+  return ret;
+}
+
+
+unsigned int
+FrameWriter::queueDepth ( void )
+{
+  unsigned int	ret;
+
+  pthread_mutex_lock ( &slotMutex );
+  ret = nextIn - nextOut;
+  pthread_mutex_unlock ( &slotMutex );
+  return ret;
+}
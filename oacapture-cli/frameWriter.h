@@ -0,0 +1,88 @@
+/*****************************************************************************
+ *
+ * frameWriter.h -- class declaration
+ *
+ * Copyright 2026
+ *   James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#pragma once
+
+#include <pthread.h>
+
+extern "C" {
+#include <openastro/camera.h>
+}
+
+#include "outputHandler.h"
+
+// A frame copied out of the camera's buffer, waiting to be written
+
+typedef struct {
+  int			state;
+  void*			frame;
+  unsigned int		length;
+  unsigned int		size;
+  FRAME_METADATA	metadata;
+} writerSlot;
+
+// Copies frames out of the camera callback into a ring of buffers and
+// writes them on a thread of its own, so the camera callback never waits
+// on the disk.  If the ring is full the frame is dropped and counted
+// rather than holding up the camera.
+
+class FrameWriter
+{
+  public:
+    			FrameWriter ( OutputHandler*, unsigned int,
+					unsigned int, int64_t );
+    			~FrameWriter();
+    int			start ( void );
+    int			queueFrame ( void*, int, FRAME_METADATA* );
+    void		stop ( void );
+    int			failed ( void );
+    uint64_t		framesQueued ( void );
+    uint64_t		framesWritten ( void );
+    uint64_t		framesDropped ( void );
+    uint64_t		bytesWritten ( void );
+    unsigned int	queueDepth ( void );
+
+  private:
+    OutputHandler*	output;
+    int64_t		exposure;
+    unsigned int	numSlots;
+    writerSlot*		slots;
+    uint64_t		nextIn;
+    uint64_t		nextOut;
+    uint64_t		queued;
+    uint64_t		written;
+    uint64_t		dropped;
+    uint64_t		bytes;
+    int			writeFailed;
+    int			stopThread;
+    int			threadRunning;
+    pthread_t		writer;
+    pthread_mutex_t	slotMutex;
+    pthread_cond_t	slotQueued;
+
+    static void*	writerThread ( void* );
+};
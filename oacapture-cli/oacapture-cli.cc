@@ -0,0 +1,924 @@
+/*****************************************************************************
+ *
+ * oacapture-cli.cc -- headless capture from the command line
+ *
+ * Copyright 2026
+ *   James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <oa_common.h>
+
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <pthread.h>
+#include <sys/time.h>
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QSettings>
+
+extern "C" {
+#include <openastro/camera.h>
+#include <openastro/util.h>
+#include <openastro/video/formats.h>
+}
+
+#include "version.h"
+#include "state.h"
+
+#include "camera.h"
+#include "commonState.h"
+#include "commonConfig.h"
+#include "captureSettings.h"
+#include "fitsSettings.h"
+#include "trampoline.h"
+#include "outputHandler.h"
+#include "outputFFMPEG.h"
+#include "outputAVI.h"
+#include "outputMOV.h"
+#include "outputSER.h"
+#ifdef HAVE_LIBCFITSIO
+#include "outputFITS.h"
+#endif
+#include "outputTIFF.h"
+#include "outputPNG.h"
+#include "frameWriter.h"
+
+// Output types, numbered as for fileTypeOption in oacapture's profiles
+
+#define	CAPTURE_AVI		1
+#define	CAPTURE_SER		2
+#define	CAPTURE_TIFF	3
+#define	CAPTURE_PNG		4
+#define	CAPTURE_FITS	5
+#define	CAPTURE_MOV		6
+
+static const char*	outputNames[] = {
+  "", "avi", "ser", "tiff", "png", "fits", "mov"
+};
+#define	NUM_OUTPUT_TYPES	7
+
+// Frame size, rate, output and limits from a saved oacapture profile and
+// the control values for its currently selected filter
+
+typedef struct {
+  int			useROI;
+  unsigned int		imageSizeX;
+  unsigned int		imageSizeY;
+  int			frameRateNumerator;
+  int			frameRateDenominator;
+  int			fileTypeOption;
+  QString		fileNameTemplate;
+  int			limitEnabled;
+  int			limitType;
+  int			secondsLimitValue;
+  int			framesLimitValue;
+  int			haveControls;
+  int64_t		controls[ OA_CAM_CTRL_MODIFIERS_LAST_P1 ][ OA_CAM_CTRL_LAST_P1 ];
+  uint8_t		controlSet[ OA_CAM_CTRL_MODIFIERS_LAST_P1 ][ OA_CAM_CTRL_LAST_P1 ];
+} CLI_PROFILE;
+
+STATE				state;
+
+static FrameWriter*		writer = nullptr;
+static uint64_t			frameLimit = 0;
+static std::atomic<uint64_t>	framesQueued ( 0 );
+static std::atomic<int>		captureDone ( 0 );
+static volatile sig_atomic_t	interrupted = 0;
+static pthread_mutex_t		doneMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t		doneCond = PTHREAD_COND_INITIALIZER;
+
+static int		readSettings ( QString, QString, CLI_PROFILE* );
+static int		findControl ( QString );
+static int		applyControl ( int, int64_t, int );
+static int		setFrameSize ( unsigned int, unsigned int );
+static void*		frameCallback ( void*, void*, int, void* );
+static void		finishCapture ( void );
+static void		printStats ( double, double, uint64_t*, int );
+static void		signalHandler ( int );
+static double		secondsSince ( struct timeval* );
+
+
+int
+main ( int argc, char* argv[] )
+{
+  QCoreApplication	app ( argc, argv );
+  QString		configFile, profileName, debugLog;
+  CLI_PROFILE		profile;
+  oaCameraDevice**	devs;
+  oaCameraDevice*	device;
+  OutputHandler*	out;
+  unsigned int		logLevel = OA_LOG_ERROR;
+  unsigned int		logType = OA_LOG_TYPE_ALL;
+  unsigned int		imageSizeX, imageSizeY, frameSize, numBuffers;
+  int			numCameras, i, ret, fileType, format;
+  int			intervalNumerator, intervalDenominator;
+  double		secondsLimit, statsInterval, elapsed, lastStats;
+  uint64_t		lastWritten;
+  struct timeval	startTime, now;
+  struct timespec	deadline;
+  uint64_t		waitUntil;
+
+  app.setOrganizationName ( ORGANISATION_NAME );
+  app.setApplicationName ( APPLICATION_NAME );
+  app.setApplicationVersion ( VERSION_STR );
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription ( "Capture from a camera without a "
+      "display" );
+  parser.addHelpOption();
+  parser.addVersionOption();
+
+  QCommandLineOption configFileOption ( "c", "name of config file to use",
+      "filename", "" );
+  QCommandLineOption listOption ( "list", "list connected cameras and exit" );
+  QCommandLineOption cameraOption ( "camera",
+      "camera to use, by number from --list or part of its name",
+      "camera", "0" );
+  QCommandLineOption profileOption ( "profile",
+      "oacapture profile to take settings from", "name", "" );
+  QCommandLineOption controlOption ( "control",
+      "set a control, eg. \"gain=200\" or \"auto exposure=0\"",
+      "name=value" );
+  QCommandLineOption sizeOption ( "size", "frame size", "WxH", "" );
+  QCommandLineOption intervalOption ( "interval",
+      "frame interval in seconds as a fraction, eg. 1/30", "n/d", "" );
+  QCommandLineOption outputTypeOption ( "output-type",
+      "ser, fits, avi, mov, tiff or png", "type", "" );
+  QCommandLineOption templateOption ( "output",
+      "output filename template", "template", "" );
+  QCommandLineOption framesOption ( "frames", "stop after this many frames",
+      "count", "0" );
+  QCommandLineOption secondsOption ( "seconds",
+      "stop after this many seconds", "seconds", "0" );
+  QCommandLineOption statsOption ( "stats",
+      "seconds between statistics reports, 0 for none", "seconds", "5" );
+  QCommandLineOption buffersOption ( "buffers",
+      "frames that can be queued for writing", "count", "16" );
+  QCommandLineOption overwriteOption ( "overwrite",
+      "overwrite an existing output file" );
+  QCommandLineOption debugLevelOption ( "debug-level",
+      "Debug level (error|warning|info|debug)", "level", "" );
+  QCommandLineOption debugLogOption ( "debug-log",
+      "Debug log filename ( use '-' for stderr )", "filename", "-" );
+
+  parser.addOption ( configFileOption );
+  parser.addOption ( listOption );
+  parser.addOption ( cameraOption );
+  parser.addOption ( profileOption );
+  parser.addOption ( controlOption );
+  parser.addOption ( sizeOption );
+  parser.addOption ( intervalOption );
+  parser.addOption ( outputTypeOption );
+  parser.addOption ( templateOption );
+  parser.addOption ( framesOption );
+  parser.addOption ( secondsOption );
+  parser.addOption ( statsOption );
+  parser.addOption ( buffersOption );
+  parser.addOption ( overwriteOption );
+  parser.addOption ( debugLevelOption );
+  parser.addOption ( debugLogOption );
+  parser.process ( app );
+
+  QStringList debugLevelValues = { "none", "error", "warning", "info",
+      "debug" };
+  QString debugLevel = parser.value ( debugLevelOption );
+  if ( debugLevel != "" ) {
+    if (( i = debugLevelValues.indexOf ( debugLevel )) < 0 ) {
+      fprintf ( stderr, "Unknown debug level: %s\n",
+          debugLevel.toStdString().c_str());
+      return 1;
+    }
+    logLevel = i;
+  }
+  debugLog = parser.value ( debugLogOption );
+  oaSetLogLevel ( logLevel );
+  oaSetLogType ( logType );
+  if ( oaSetLogFile ( debugLog.toStdString().c_str()) != OA_ERR_NONE ) {
+    fprintf ( stderr, "Error opening debug log file\n" );
+    return 1;
+  }
+
+  configFile = parser.value ( configFileOption );
+  profileName = parser.value ( profileOption );
+  if ( readSettings ( configFile, profileName, &profile ) < 0 ) {
+    return 1;
+  }
+
+  commonState.camera = new Camera;
+  commonState.currentDirectory = QDir::currentPath();
+  if (( numCameras = commonState.camera->listConnected ( &devs, 0 )) < 0 ) {
+    fprintf ( stderr, "Unable to list cameras, error %d\n", numCameras );
+    return 1;
+  }
+
+  if ( parser.isSet ( listOption )) {
+    for ( i = 0; i < numCameras; i++ ) {
+      printf ( "%d: %s (%s)\n", i, devs[i]->deviceName,
+          oaCameraInterfaces[ devs[i]->interface ].name );
+    }
+    commonState.camera->releaseInfo ( devs );
+    return 0;
+  }
+
+  device = nullptr;
+  QString cameraName = parser.value ( cameraOption );
+  bool isNumber;
+  int cameraNum = cameraName.toInt ( &isNumber );
+  if ( isNumber ) {
+    if ( cameraNum >= 0 && cameraNum < numCameras ) {
+      device = devs[ cameraNum ];
+    }
+  } else {
+    for ( i = 0; !device && i < numCameras; i++ ) {
+      if ( QString ( devs[i]->deviceName ).contains ( cameraName,
+          Qt::CaseInsensitive )) {
+        device = devs[i];
+      }
+    }
+  }
+  if ( !device ) {
+    fprintf ( stderr, "Camera \"%s\" not found\n",
+        cameraName.toStdString().c_str());
+    commonState.camera->releaseInfo ( devs );
+    return 1;
+  }
+
+  // Firmware is loaded here rather than by Camera::initialise() as that
+  // wants to tell the user about it with a dialog
+
+  if ( device->hasLoadableFirmware && !device->firmwareLoaded ) {
+    ret = device->loadFirmware ( device );
+    fprintf ( stderr, ret == OA_ERR_NONE || ret == -OA_ERR_RESCAN_BUS ?
+        "Firmware loaded, please run again\n" :
+        "The camera firmware could not be loaded\n" );
+    commonState.camera->releaseInfo ( devs );
+    return 1;
+  }
+
+  ret = commonState.camera->initialise ( device, APPLICATION_NAME, nullptr );
+  commonState.camera->releaseInfo ( devs );
+  if ( ret ) {
+    fprintf ( stderr, "Unable to connect to camera, error %d\n", ret );
+    return 1;
+  }
+
+  // Frame size: command line, then profile, then the biggest available
+
+  imageSizeX = imageSizeY = 0;
+  QString sizeStr = parser.value ( sizeOption );
+  if ( sizeStr != "" ) {
+    QStringList dims = sizeStr.split ( "x" );
+    if ( dims.size() == 2 ) {
+      imageSizeX = dims[0].toUInt();
+      imageSizeY = dims[1].toUInt();
+    }
+    if ( !imageSizeX || !imageSizeY ) {
+      fprintf ( stderr, "Invalid frame size \"%s\"\n",
+          sizeStr.toStdString().c_str());
+      return 1;
+    }
+  } else if ( profileName != "" && profile.imageSizeX && profile.imageSizeY ) {
+    imageSizeX = profile.imageSizeX;
+    imageSizeY = profile.imageSizeY;
+  }
+  if ( setFrameSize ( imageSizeX, imageSizeY ) < 0 ) {
+    return 1;
+  }
+
+  intervalNumerator = profile.frameRateNumerator;
+  intervalDenominator = profile.frameRateDenominator;
+  QString intervalStr = parser.value ( intervalOption );
+  if ( intervalStr != "" ) {
+    QStringList parts = intervalStr.split ( "/" );
+    intervalNumerator = parts[0].toInt();
+    intervalDenominator = parts.size() > 1 ? parts[1].toInt() : 1;
+    if ( intervalNumerator <= 0 || intervalDenominator <= 0 ) {
+      fprintf ( stderr, "Invalid frame interval \"%s\"\n",
+          intervalStr.toStdString().c_str());
+      return 1;
+    }
+  }
+  if ( intervalNumerator > 0 && intervalDenominator > 0 &&
+      commonState.camera->hasFrameRateSupport()) {
+    if ( commonState.camera->setFrameInterval ( intervalNumerator,
+        intervalDenominator ) != OA_ERR_NONE ) {
+      fprintf ( stderr, "Warning: frame interval %d/%d not set\n",
+          intervalNumerator, intervalDenominator );
+    }
+  }
+
+  // Profile controls first so the command line can override them
+
+  if ( profile.haveControls ) {
+    for ( int j = 1; j < OA_CAM_CTRL_LAST_P1; j++ ) {
+      for ( int m = 0; m < OA_CAM_CTRL_MODIFIERS_LAST_P1; m++ ) {
+        if ( profile.controlSet[m][j] ) {
+          ( void ) applyControl ( j | ( m << 8 ), profile.controls[m][j], 0 );
+        }
+      }
+    }
+  }
+  QStringList controls = parser.values ( controlOption );
+  for ( i = 0; i < controls.size(); i++ ) {
+    int control = -1;
+    int64_t value = 0;
+    int sep = controls[i].indexOf ( '=' );
+    QString valueStr = controls[i].mid ( sep + 1 ).trimmed().toLower();
+    bool ok = sep > 0;
+    if ( ok && ( control = findControl ( controls[i].left ( sep ))) < 0 ) {
+      ok = false;
+    }
+    if ( ok ) {
+      if ( valueStr == "on" || valueStr == "true" ) {
+        value = 1;
+      } else if ( valueStr == "off" || valueStr == "false" ) {
+        value = 0;
+      } else {
+        value = valueStr.toLongLong ( &ok );
+      }
+    }
+    if ( !ok || applyControl ( control, value, 1 ) < 0 ) {
+      fprintf ( stderr, "Can't set control \"%s\"\n",
+          controls[i].toStdString().c_str());
+      return 1;
+    }
+  }
+
+  if ( commonState.camera->hasControl ( OA_CAM_CTRL_GAIN )) {
+    state.gain = commonState.camera->readControl ( OA_CAM_CTRL_GAIN );
+  }
+  if ( commonState.camera->hasControl ( OA_CAM_CTRL_EXPOSURE_ABSOLUTE )) {
+    state.exposure = commonState.camera->readControl (
+        OA_CAM_CTRL_EXPOSURE_ABSOLUTE );
+  } else if ( commonState.camera->hasControl (
+      OA_CAM_CTRL_EXPOSURE_UNSCALED )) {
+    state.exposure = commonState.camera->readControl (
+        OA_CAM_CTRL_EXPOSURE_UNSCALED );
+  }
+
+  // The writers only use the interval for the container's timebase, so as
+  // for oacapture the exposure time stands in if the camera has no rate
+
+  if ( !commonState.camera->hasFrameRateSupport() ||
+      intervalNumerator <= 0 || intervalDenominator <= 0 ) {
+    if ( state.exposure > 0 && commonState.camera->hasControl (
+        OA_CAM_CTRL_EXPOSURE_ABSOLUTE )) {
+      intervalNumerator = state.exposure;
+      intervalDenominator = 1000000;
+      while ( intervalNumerator % 10 == 0 && intervalDenominator % 10 == 0 ) {
+        intervalNumerator /= 10;
+        intervalDenominator /= 10;
+      }
+    } else {
+      intervalNumerator = intervalDenominator = 1;
+    }
+  }
+
+  // Output type and filename
+
+  fileType = profile.fileTypeOption;
+  QString outputType = parser.value ( outputTypeOption ).toLower();
+  if ( outputType != "" ) {
+    fileType = 0;
+    for ( i = 1; i < NUM_OUTPUT_TYPES; i++ ) {
+      if ( outputType == outputNames[i] ) {
+        fileType = i;
+      }
+    }
+  }
+#ifndef HAVE_LIBCFITSIO
+  if ( fileType == CAPTURE_FITS ) {
+    fileType = 0;
+  }
+#endif
+  if ( fileType <= 0 || fileType >= NUM_OUTPUT_TYPES ) {
+    fprintf ( stderr, "Unknown or unsupported output type\n" );
+    return 1;
+  }
+  if ( parser.value ( templateOption ) != "" ) {
+    commonConfig.fileNameTemplate = parser.value ( templateOption );
+  } else if ( profileName != "" ) {
+    commonConfig.fileNameTemplate = profile.fileNameTemplate;
+  }
+  commonConfig.fileTypeOption = fileType;
+
+  format = commonState.camera->videoFramePixelFormat();
+  QString emptyStr = "";
+  out = nullptr;
+  switch ( fileType ) {
+    case CAPTURE_AVI:
+      out = new OutputAVI ( imageSizeX, imageSizeY, intervalNumerator,
+          intervalDenominator, format, emptyStr, &trampolines );
+      break;
+    case CAPTURE_MOV:
+      out = new OutputMOV ( imageSizeX, imageSizeY, intervalNumerator,
+          intervalDenominator, format, emptyStr, &trampolines );
+      break;
+    case CAPTURE_SER:
+      out = new OutputSER ( imageSizeX, imageSizeY, intervalNumerator,
+          intervalDenominator, format, emptyStr, &trampolines );
+      break;
+    case CAPTURE_TIFF:
+      out = new OutputTIFF ( imageSizeX, imageSizeY, intervalNumerator,
+          intervalDenominator, format, APPLICATION_NAME, VERSION_STR,
+          emptyStr, &trampolines );
+      break;
+    case CAPTURE_PNG:
+      out = new OutputPNG ( imageSizeX, imageSizeY, intervalNumerator,
+          intervalDenominator, format, APPLICATION_NAME, VERSION_STR,
+          emptyStr, &trampolines );
+      break;
+#ifdef HAVE_LIBCFITSIO
+    case CAPTURE_FITS:
+      out = new OutputFITS ( imageSizeX, imageSizeY, intervalNumerator,
+          intervalDenominator, format, APPLICATION_NAME, VERSION_STR,
+          emptyStr, &trampolines );
+      break;
+#endif
+  }
+
+  if ( !out->writesDiscreteFiles && out->outputExists() &&
+      !parser.isSet ( overwriteOption )) {
+    fprintf ( stderr, "%s exists, use --overwrite to replace it\n",
+        out->getFilename().toStdString().c_str());
+    return 1;
+  }
+  if (( out->writesDiscreteFiles || out->outputExists()) &&
+      !out->outputWritable()) {
+    fprintf ( stderr, "%s is not writable\n",
+        out->getFilename().toStdString().c_str());
+    return 1;
+  }
+  if ( out->openOutput()) {
+    fprintf ( stderr, "Unable to create %s\n",
+        out->getFilename().toStdString().c_str());
+    return 1;
+  }
+
+  // Limits: command line, then profile
+
+  frameLimit = parser.value ( framesOption ).toULongLong();
+  secondsLimit = parser.value ( secondsOption ).toDouble();
+  if ( !frameLimit && secondsLimit <= 0 && profile.limitEnabled ) {
+    if ( profile.limitType ) {
+      frameLimit = profile.framesLimitValue;
+    } else {
+      secondsLimit = profile.secondsLimitValue;
+    }
+  }
+  statsInterval = parser.value ( statsOption ).toDouble();
+  if (( numBuffers = parser.value ( buffersOption ).toUInt()) < 2 ) {
+    numBuffers = 2;
+  }
+
+  frameSize = imageSizeX * imageSizeY *
+      oaFrameFormats[ format ].bytesPerPixel;
+  writer = new FrameWriter ( out, numBuffers, frameSize, state.exposure );
+  if ( writer->start() < 0 ) {
+    out->closeOutput();
+    return 1;
+  }
+
+  signal ( SIGINT, signalHandler );
+  signal ( SIGTERM, signalHandler );
+
+  printf ( "Writing %ux%u %s to %s\n", imageSizeX, imageSizeY,
+      oaFrameFormats[ format ].name,
+      out->getRecordingFilename().toStdString().c_str());
+  fflush ( stdout );
+
+  commonState.camera->resetFrameStats();
+  gettimeofday ( &startTime, 0 );
+  if (( ret = commonState.camera->startStreaming ( frameCallback,
+      nullptr )) != OA_ERR_NONE ) {
+    fprintf ( stderr, "Unable to start streaming, error %d\n", ret );
+    writer->stop();
+    out->closeOutput();
+    return 1;
+  }
+
+  // Nothing to do here but wait.  The wait is cut into short slices only
+  // so that an interrupt is noticed promptly.
+
+  lastStats = 0;
+  lastWritten = 0;
+  pthread_mutex_lock ( &doneMutex );
+  while ( !captureDone && !interrupted ) {
+    elapsed = secondsSince ( &startTime );
+    if ( secondsLimit > 0 && elapsed >= secondsLimit ) {
+      break;
+    }
+    if ( statsInterval > 0 && elapsed - lastStats >= statsInterval ) {
+      pthread_mutex_unlock ( &doneMutex );
+      printStats ( elapsed, elapsed - lastStats, &lastWritten, 0 );
+      pthread_mutex_lock ( &doneMutex );
+      lastStats = elapsed;
+    }
+    gettimeofday ( &now, 0 );
+    waitUntil = ( uint64_t ) now.tv_sec * 1000000 + now.tv_usec + 250000;
+    deadline.tv_sec = waitUntil / 1000000;
+    deadline.tv_nsec = ( waitUntil % 1000000 ) * 1000;
+    ( void ) pthread_cond_timedwait ( &doneCond, &doneMutex, &deadline );
+  }
+  pthread_mutex_unlock ( &doneMutex );
+
+  finishCapture();
+  commonState.camera->stop();
+  writer->stop();
+  out->closeOutput();
+  elapsed = secondsSince ( &startTime );
+  printStats ( elapsed, elapsed - lastStats, &lastWritten, 1 );
+
+  ret = writer->failed() ? 1 : 0;
+  if ( ret ) {
+    fprintf ( stderr, "Writing to %s failed\n",
+        out->getRecordingFilename().toStdString().c_str());
+  }
+  delete writer;
+  delete out;
+  commonState.camera->disconnect();
+  delete commonState.camera;
+  return ret;
+}
+
+
+// Reads the parts of oacapture's configuration that affect what gets
+// written, and the named profile if there is one
+
+static int
+readSettings ( QString configFile, QString profileName, CLI_PROFILE* p )
+{
+  QSettings*	settings;
+  int		version, numProfiles, numFilters, filterOption, found;
+
+  memset ( p->controls, 0, sizeof ( p->controls ));
+  memset ( p->controlSet, 0, sizeof ( p->controlSet ));
+  p->useROI = p->haveControls = 0;
+  p->imageSizeX = p->imageSizeY = 0;
+  p->frameRateNumerator = 0;
+  p->frameRateDenominator = 1;
+  p->fileTypeOption = CAPTURE_SER;
+  p->fileNameTemplate = "oaCapture-%DATE-%TIME";
+  p->limitEnabled = p->secondsLimitValue = p->framesLimitValue = 0;
+  p->limitType = 0;
+
+  if ( configFile != "" ) {
+    settings = new QSettings ( configFile, QSettings::IniFormat );
+  } else {
+    settings = new QSettings ( ORGANISATION_NAME_SETTINGS,
+        SETTINGS_APPLICATION_NAME );
+  }
+
+  version = settings->value ( "configVersion", 0 ).toInt();
+  commonConfig.captureDirectory = settings->value (
+      "control/captureDirectory", "" ).toString();
+  commonConfig.dirProfile = settings->value ( "control/dirProfile",
+      0 ).toInt();
+  commonConfig.dirDate = settings->value ( "control/dirDate", 0 ).toInt();
+  commonConfig.fileNameTemplate = p->fileNameTemplate;
+  captureConf.indexDigits = settings->value ( "indexDigits", 6 ).toInt();
+
+  fitsConf.observer = settings->value ( "fits/observer", "" ).toString();
+  fitsConf.instrument = settings->value ( "fits/instrument", "" ).toString();
+  fitsConf.object = settings->value ( "fits/object", "" ).toString();
+  fitsConf.comment = settings->value ( "fits/comment", "" ).toString();
+  fitsConf.telescope = settings->value ( "fits/telescope", "" ).toString();
+  fitsConf.focalLength = settings->value ( "fits/focalLength", "" ).toString();
+  fitsConf.apertureDia = settings->value ( "fits/apertureDia", "" ).toString();
+  fitsConf.apertureArea = settings->value (
+      "fits/apertureArea", "" ).toString();
+  fitsConf.pixelSizeX = settings->value ( "fits/pixelSizeX", "" ).toString();
+  fitsConf.pixelSizeY = settings->value ( "fits/pixelSizeY", "" ).toString();
+  fitsConf.subframeOriginX = settings->value (
+      "fits/subframeOriginX", "" ).toString();
+  fitsConf.subframeOriginY = settings->value (
+      "fits/subframeOriginY", "" ).toString();
+  fitsConf.siteLatitude = settings->value (
+      "fits/siteLatitude", "" ).toString();
+  fitsConf.siteLongitude = settings->value (
+      "fits/siteLongitude", "" ).toString();
+  fitsConf.filter = settings->value ( "fits/filter", "" ).toString();
+
+  if ( profileName == "" ) {
+    delete settings;
+    return 0;
+  }
+
+  // Profiles from before version 7 of the config don't have usable control
+  // values, as for oacapture
+
+  found = 0;
+  filterOption = 0;
+  numProfiles = settings->beginReadArray ( "profiles" );
+  for ( int i = 0; !found && i < numProfiles; i++ ) {
+    settings->setArrayIndex ( i );
+    if ( settings->value ( "name", "" ).toString() != profileName ) {
+      continue;
+    }
+    found = 1;
+    p->useROI = settings->value ( "useROI", 0 ).toInt();
+    p->imageSizeX = settings->value ( "imageSizeX", 0 ).toInt();
+    p->imageSizeY = settings->value ( "imageSizeY", 0 ).toInt();
+    p->frameRateNumerator = settings->value ( "frameRateNumerator",
+        0 ).toInt();
+    p->frameRateDenominator = settings->value ( "frameRateDenominator",
+        1 ).toInt();
+    p->fileTypeOption = settings->value ( "fileTypeOption", 1 ).toInt();
+    p->fileNameTemplate = settings->value ( "fileNameTemplate",
+        "oaCapture-%DATE-%TIME" ).toString();
+    p->limitEnabled = settings->value ( "limitEnabled", 0 ).toInt();
+    p->framesLimitValue = settings->value ( "framesLimitValue", 0 ).toInt();
+    p->secondsLimitValue = settings->value ( "secondsLimitValue",
+        0 ).toInt();
+    p->limitType = settings->value ( "limitType", 0 ).toInt();
+    state.targetId = settings->value ( "target", 0 ).toInt();
+    filterOption = settings->value ( "filterOption", 0 ).toInt();
+
+    numFilters = settings->beginReadArray ( "filters" );
+    if ( version >= 7 && filterOption >= 0 && filterOption < numFilters ) {
+      settings->setArrayIndex ( filterOption );
+      int numControls = settings->beginReadArray ( "controls" );
+      for ( int j = 1; j <= numControls && j < OA_CAM_CTRL_LAST_P1; j++ ) {
+        settings->setArrayIndex ( j - 1 );
+        int numModifiers = settings->beginReadArray ( "modifiers" );
+        for ( int m = 0; m < numModifiers &&
+            m < OA_CAM_CTRL_MODIFIERS_LAST_P1; m++ ) {
+          settings->setArrayIndex ( m );
+          // Leave alone any control the profile has no value for rather
+          // than setting it to zero
+          if ( settings->contains ( "controlValue" )) {
+            p->controls[m][j] = settings->value ( "controlValue", 0 ).toInt();
+            p->controlSet[m][j] = 1;
+            p->haveControls = 1;
+          }
+        }
+        settings->endArray();
+      }
+      settings->endArray();
+    }
+    settings->endArray();
+  }
+  settings->endArray();
+
+  if ( !found ) {
+    fprintf ( stderr, "Profile \"%s\" not found\n",
+        profileName.toStdString().c_str());
+    delete settings;
+    return -1;
+  }
+  state.profileName = profileName;
+
+  numFilters = settings->beginReadArray ( "filters" );
+  if ( filterOption >= 0 && filterOption < numFilters ) {
+    settings->setArrayIndex ( filterOption );
+    state.filterName = settings->value ( "name", "" ).toString();
+  }
+  settings->endArray();
+
+  delete settings;
+  return 0;
+}
+
+
+// Controls are named as in oacapture, with any "Auto " or "Enable "
+// prefix, but matched ignoring case, spaces and punctuation so that
+// "gain", "Gain" and "auto-exposure" all work.  A number is taken as
+// a control id.
+
+static QString
+normaliseName ( QString name )
+{
+  QString	ret;
+
+  for ( int i = 0; i < name.size(); i++ ) {
+    if ( name[i].isLetterOrNumber()) {
+      ret += name[i].toLower();
+    }
+  }
+  return ret;
+}
+
+
+static int
+findControl ( QString name )
+{
+  QString	wanted = normaliseName ( name );
+  bool		isNumber;
+  int		id;
+
+  id = name.toInt ( &isNumber );
+  if ( isNumber ) {
+    return id;
+  }
+  for ( int j = 1; j < OA_CAM_CTRL_LAST_P1; j++ ) {
+    for ( int m = 0; m < OA_CAM_CTRL_MODIFIERS_LAST_P1; m++ ) {
+      if ( normaliseName ( QString ( oaCameraControlModifierPrefix[m] ) +
+          oaCameraControlLabel[j] ) == wanted ) {
+        return j | ( m << 8 );
+      }
+    }
+  }
+  return -1;
+}
+
+
+// Values outside the camera's range are clamped rather than rejected, as
+// a profile saved for one camera may well be used with another.  Controls
+// the camera doesn't have are ignored unless explicitly asked for.
+
+static int
+applyControl ( int control, int64_t value, int explicitlySet )
+{
+  int64_t	min, max, step, def;
+  int		type;
+
+  type = commonState.camera->hasControl ( control );
+  switch ( type ) {
+    case OA_CTRL_TYPE_INT32:
+    case OA_CTRL_TYPE_INT64:
+    case OA_CTRL_TYPE_MENU:
+    case OA_CTRL_TYPE_DISC_MENU:
+      commonState.camera->controlRange ( control, &min, &max, &step, &def );
+      if ( value < min ) {
+        value = min;
+      }
+      if ( value > max ) {
+        value = max;
+      }
+      break;
+    case OA_CTRL_TYPE_BOOLEAN:
+      value = value ? 1 : 0;
+      break;
+    case OA_CTRL_TYPE_DISCRETE:
+      break;
+    default:
+      return explicitlySet ? -1 : 0;
+  }
+
+  if ( commonState.camera->setControl ( control, value ) != OA_ERR_NONE ) {
+    if ( explicitlySet ) {
+      return -1;
+    }
+    oaLogWarning ( OA_LOG_APP, "%s: setting %s%s to %lld failed", __func__,
+        oaCameraControlModifierPrefix[ OA_CAM_CTRL_MODIFIER( control )],
+        oaCameraControlLabel[ OA_CAM_CTRL_MODE_BASE( control )],
+        ( long long ) value );
+  }
+  return 0;
+}
+
+
+// Set the requested frame size, or the largest the camera has if none
+// is given.  Sizes the camera doesn't list are set as a region of
+// interest if it can do that.
+
+static int
+setFrameSize ( unsigned int x, unsigned int y )
+{
+  const FRAMESIZES*	sizes;
+  unsigned int		i, bestX, bestY, exact;
+
+  if ( !( sizes = commonState.camera->frameSizes()) || !sizes->numSizes ) {
+    fprintf ( stderr, "The camera reports no frame sizes\n" );
+    return -1;
+  }
+
+  bestX = bestY = exact = 0;
+  for ( i = 0; i < sizes->numSizes; i++ ) {
+    if ( sizes->sizes[i].x == x && sizes->sizes[i].y == y ) {
+      exact = 1;
+    }
+    if ( sizes->sizes[i].x * sizes->sizes[i].y > bestX * bestY ) {
+      bestX = sizes->sizes[i].x;
+      bestY = sizes->sizes[i].y;
+    }
+  }
+
+  if ( !x || !y || exact ) {
+    if ( !x || !y ) {
+      x = bestX;
+      y = bestY;
+    }
+    if ( commonState.camera->setResolution ( x, y ) != OA_ERR_NONE ) {
+      fprintf ( stderr, "Unable to set frame size %ux%u\n", x, y );
+      return -1;
+    }
+  } else {
+    if ( !commonState.camera->hasROI() || x > bestX || y > bestY ||
+        commonState.camera->setResolution ( bestX, bestY ) != OA_ERR_NONE ||
+        commonState.camera->setROI ( x, y ) != OA_ERR_NONE ) {
+      fprintf ( stderr, "Frame size %ux%u is not available\n", x, y );
+      return -1;
+    }
+    commonState.cropMode = 1;
+    commonState.cropSizeX = x;
+    commonState.cropSizeY = y;
+  }
+
+  commonState.sensorSizeX = bestX;
+  commonState.sensorSizeY = bestY;
+  commonConfig.imageSizeX = x;
+  commonConfig.imageSizeY = y;
+  return 0;
+}
+
+
+// Runs on the camera's callback thread.  The frame is just copied to the
+// writer's queue, so nothing here costs more than the copy.
+
+static void*
+frameCallback ( void* args, void* buffer, int length, void* metadata )
+{
+  int		ret;
+
+  Q_UNUSED( args );
+
+  if ( captureDone ) {
+    return buffer;
+  }
+  ret = writer->queueFrame ( buffer, length,
+      static_cast<FRAME_METADATA*>( metadata ));
+  if ( ret < 0 || ( ret > 0 && ++framesQueued == frameLimit )) {
+    finishCapture();
+  }
+  return buffer;
+}
+
+
+static void
+finishCapture ( void )
+{
+  pthread_mutex_lock ( &doneMutex );
+  captureDone = 1;
+  pthread_mutex_unlock ( &doneMutex );
+  pthread_cond_signal ( &doneCond );
+}
+
+
+static void
+printStats ( double elapsed, double period, uint64_t* lastWritten,
+    int final )
+{
+  oaFrameStats	stats;
+  uint64_t	written, cameraDropped = 0;
+  double	fps, mbps;
+
+  written = writer->framesWritten();
+  if ( commonState.camera->frameStats ( &stats ) == OA_ERR_NONE ) {
+    cameraDropped = stats.droppedFrames;
+  }
+  if ( final ) {
+    period = elapsed;
+    *lastWritten = 0;
+  }
+  fps = period > 0 ? ( written - *lastWritten ) / period : 0;
+  mbps = elapsed > 0 ? writer->bytesWritten() / elapsed / 1048576.0 : 0;
+  printf ( "%s%8.1fs  written %llu  %.1f fps  %.1f MB/s  dropped camera %llu "
+      "writer %llu  queued %u\n", final ? "total " : "", elapsed,
+      ( unsigned long long ) written, fps, mbps,
+      ( unsigned long long ) cameraDropped,
+      ( unsigned long long ) writer->framesDropped(), writer->queueDepth());
+  fflush ( stdout );
+  *lastWritten = written;
+}
+
+
+static void
+signalHandler ( int sig )
+{
+  Q_UNUSED( sig );
+  interrupted = 1;
+}
+
+
+static double
+secondsSince ( struct timeval* start )
+{
+  struct timeval	now;
+
+  gettimeofday ( &now, 0 );
+  return ( now.tv_sec - start->tv_sec ) +
+      ( now.tv_usec - start->tv_usec ) / 1000000.0;
+}
@@ -0,0 +1,77 @@
+/*****************************************************************************
+ *
+ * trampoline.cc -- functions the common code needs from the application
+ *
+ * Copyright 2026
+ *   James Fidell (james@openastroproject.org)
+ *
+ * License:
+ *
+ * This file is part of the Open Astro Project.
+ *
+ * The Open Astro Project is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The Open Astro Project is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Open Astro Project.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <oa_common.h>
+
+#include "trampoline.h"
+#include "state.h"
+
+// There's no user interface here, so only the functions the output
+// handlers use for filenames and headers are needed
+
+int
+t_getCurrentGain ( void )
+{
+  return state.gain;
+}
+
+
+int
+t_getCurrentExposure ( void )
+{
+  return state.exposure;
+}
+
+
+int
+t_getCurrentTargetId ( void )
+{
+  return state.targetId;
+}
+
+
+QString
+t_getCurrentFilterName ( void )
+{
+  return state.filterName;
+}
+
+
+QString
+t_getCurrentProfileName ( void )
+{
+  return state.profileName;
+}
+
+
+trampolineFuncs trampolines = {
+  t_getCurrentGain,
+  t_getCurrentExposure,
+  t_getCurrentTargetId,
+  t_getCurrentFilterName,
+  t_getCurrentProfileName
+};
@@ -52,6 +52,9 @@
 #include "outputTIFF.h"
 #include "outputPNG.h"
 #include "outputNamedPipe.h"
+#include "outputGrader.h"
+#include "outputMaster.h"
+#include "calibrationSettings.h"
 #include "targets.h"
 
 #ifdef HAVE_LIBCFITSIO
@@ -642,6 +645,17 @@ CaptureWidget::doStartRecording ( int autorunFlag )
 
   }
 
+  // Frame grading sits between the preview and the real output, passing
+  // on only the frames good enough to keep
+  if ( out && captureConf.gradeFrames ) {
+    out = new OutputGrader ( out, actualX, actualY, format, &trampolines );
+  }
+
+  // Building a master frame sees every frame, graded or not
+  if ( out && calibrationConf.buildMaster ) {
+    out = new OutputMaster ( out, actualX, actualY, format, &trampolines );
+  }
+
   if ( out && ( CAPTURE_TIFF == commonConfig.fileTypeOption ||
       CAPTURE_PNG == commonConfig.fileTypeOption ||
       CAPTURE_FITS == commonConfig.fileTypeOption )) {
@@ -265,8 +265,10 @@ ImageWidget::configure ( void )
   }
 
   // If the camera has fixed frame sizes the we want to display the crop
-  // label for the frame size selector.  Otherwise it's the User ROI label
-  if ( commonState.camera->hasFixedFrameSizes()) {
+  // label for the frame size selector.  Otherwise it's the User ROI label.
+  // Fixed size cameras may still get an ROI cropped in software by liboacam
+  if ( commonState.camera->hasFixedFrameSizes() &&
+      !commonState.camera->hasROI()) {
     userROI->setEnabled(0);
     roiXSize->setEnabled(0);
     roiYSize->setEnabled(0);
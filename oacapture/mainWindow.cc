@@ -35,12 +35,14 @@ extern "C" {
 
 #include <openastro/filterwheel.h>
 #include <openastro/demosaic.h>
+#include <openastro/imgproc.h>
 }
 
 #include "focusOverlay.h"
 #include "commonState.h"
 #include "commonConfig.h"
 #include "targets.h"
+#include "outputGrader.h"
 
 #include "mainWindow.h"
 #include "version.h"
@@ -408,6 +410,13 @@ MainWindow::readConfig ( QString configFile )
 #endif
     captureConf.useUtVideo = 0;
     captureConf.indexDigits = 6;
+    captureConf.gradeFrames = 0;
+    captureConf.gradeMetric = OA_GRADE_PLANET;
+    captureConf.gradeMode = GRADE_MODE_BEST_PERCENT;
+    captureConf.gradeKeepPercent = 10;
+    captureConf.gradeWindow = 500;
+    captureConf.gradeThreshold = 0;
+    captureConf.gradeThreads = 0;
 
     config.preview = 1;
     config.nightMode = 0;
@@ -448,6 +457,15 @@ MainWindow::readConfig ( QString configFile )
     fitsConf.siteLongitude = "";
     fitsConf.filter = "";
 
+    calibrationConf.enabled = 0;
+    calibrationConf.scaleDark = 0;
+    calibrationConf.fixHotPixels = 0;
+    calibrationConf.biasFile = "";
+    calibrationConf.darkFile = "";
+    calibrationConf.flatFile = "";
+    calibrationConf.masterMethod = OA_MASTER_MEAN;
+    calibrationConf.buildMaster = 0;
+
     timerConf.timerMode = OA_TIMER_MODE_UNSET;
     timerConf.timerEnabled = 0;
   } else {
@@ -474,6 +492,20 @@ MainWindow::readConfig ( QString configFile )
 				"windowsCompatibleAVI", 0 ).toInt();
     captureConf.useUtVideo = settings->value ( "useUtVideo", 0 ).toInt();
     captureConf.indexDigits = settings->value ( "indexDigits", 6 ).toInt();
+    captureConf.gradeFrames = settings->value ( "grading/enabled",
+        0 ).toInt();
+    captureConf.gradeMetric = settings->value ( "grading/metric",
+        OA_GRADE_PLANET ).toInt();
+    captureConf.gradeMode = settings->value ( "grading/mode",
+        GRADE_MODE_BEST_PERCENT ).toInt();
+    captureConf.gradeKeepPercent = settings->value ( "grading/keepPercent",
+        10 ).toInt();
+    captureConf.gradeWindow = settings->value ( "grading/window",
+        500 ).toInt();
+    captureConf.gradeThreshold = settings->value ( "grading/threshold",
+        0.0 ).toDouble();
+    captureConf.gradeThreads = settings->value ( "grading/threads",
+        0 ).toInt();
 
     config.showHistogram = settings->value ( "options/showHistogram",
         0 ).toInt();
@@ -994,6 +1026,26 @@ MainWindow::readConfig ( QString configFile )
       "fits/siteLongitude", "" ).toString();
   fitsConf.filter = settings->value ( "fits/filter", "" ).toString();
 
+  pthread_mutex_lock ( &calibrationConfMutex );
+  calibrationConf.enabled = settings->value ( "calibration/enabled",
+      0 ).toInt();
+  calibrationConf.scaleDark = settings->value ( "calibration/scaleDark",
+      0 ).toInt();
+  calibrationConf.fixHotPixels = settings->value (
+      "calibration/fixHotPixels", 0 ).toInt();
+  calibrationConf.biasFile = settings->value ( "calibration/biasFile",
+      "" ).toString();
+  calibrationConf.darkFile = settings->value ( "calibration/darkFile",
+      "" ).toString();
+  calibrationConf.flatFile = settings->value ( "calibration/flatFile",
+      "" ).toString();
+  calibrationConf.masterMethod = settings->value (
+      "calibration/masterMethod", OA_MASTER_MEAN ).toInt();
+  calibrationConf.buildMaster = settings->value ( "calibration/buildMaster",
+      0 ).toInt();
+  calibrationConf.generation++;
+  pthread_mutex_unlock ( &calibrationConfMutex );
+
   timerConf.timerMode = settings->value ( "timer/mode",
       OA_TIMER_MODE_UNSET ).toInt();
   timerConf.timerEnabled = settings->value ( "timer/enabled", 0 ).toInt();
@@ -1052,6 +1104,13 @@ MainWindow::writeConfig ( QString configFile )
 			captureConf.windowsCompatibleAVI );
   settings->setValue ( "useUtVideo", captureConf.useUtVideo );
   settings->setValue ( "indexDigits", captureConf.indexDigits );
+  settings->setValue ( "grading/enabled", captureConf.gradeFrames );
+  settings->setValue ( "grading/metric", captureConf.gradeMetric );
+  settings->setValue ( "grading/mode", captureConf.gradeMode );
+  settings->setValue ( "grading/keepPercent", captureConf.gradeKeepPercent );
+  settings->setValue ( "grading/window", captureConf.gradeWindow );
+  settings->setValue ( "grading/threshold", captureConf.gradeThreshold );
+  settings->setValue ( "grading/threads", captureConf.gradeThreads );
 
   // FIX ME -- how to handle this?
   // settings->setValue ( "device/camera", -1 ).toInt();
@@ -1299,6 +1358,17 @@ MainWindow::writeConfig ( QString configFile )
   settings->setValue ( "fits/siteLongitude", fitsConf.siteLongitude );
   settings->setValue ( "fits/filter", fitsConf.filter );
 
+  settings->setValue ( "calibration/enabled", calibrationConf.enabled );
+  settings->setValue ( "calibration/scaleDark", calibrationConf.scaleDark );
+  settings->setValue ( "calibration/fixHotPixels",
+      calibrationConf.fixHotPixels );
+  settings->setValue ( "calibration/biasFile", calibrationConf.biasFile );
+  settings->setValue ( "calibration/darkFile", calibrationConf.darkFile );
+  settings->setValue ( "calibration/flatFile", calibrationConf.flatFile );
+  settings->setValue ( "calibration/masterMethod",
+      calibrationConf.masterMethod );
+  settings->setValue ( "calibration/buildMaster", calibrationConf.buildMaster );
+
   settings->setValue ( "timer/mode", timerConf.timerMode );
   settings->setValue ( "timer/enabled", timerConf.timerEnabled );
   settings->setValue ( "timer/triggerInterval", timerConf.triggerInterval );
@@ -1326,6 +1396,8 @@ MainWindow::createStatusBar ( void )
   capturedLabel->setFixedWidth ( 65 );
   droppedLabel = new QLabel ( tr ( "Dropped" ));
   droppedLabel->setFixedWidth ( 60 );
+  latencyLabel = new QLabel ( tr ( "Latency" ));
+  latencyLabel->setFixedWidth ( 55 );
   progressBar = new QProgressBar;
   progressBar->setFixedWidth ( 140 );
   progressBar->setRange ( 0, 100 );
@@ -1337,6 +1409,8 @@ MainWindow::createStatusBar ( void )
   capturedValue->setFixedWidth ( 40 );
   droppedValue = new QLabel ( "0" );
   droppedValue->setFixedWidth ( 40 );
+  latencyValue = new QLabel ( "" );
+  latencyValue->setFixedWidth ( 110 );
 
   statusLine->addPermanentWidget ( elapsedLabel );
   statusLine->addPermanentWidget ( elapsedValue );
@@ -1344,6 +1418,8 @@ MainWindow::createStatusBar ( void )
   statusLine->addPermanentWidget ( capturedValue );
   statusLine->addPermanentWidget ( droppedLabel );
   statusLine->addPermanentWidget ( droppedValue );
+  statusLine->addPermanentWidget ( latencyLabel );
+  statusLine->addPermanentWidget ( latencyValue );
   statusLine->addPermanentWidget ( progressBar );
 }
 
@@ -1369,6 +1445,12 @@ MainWindow::createMenus ( void )
   saveConfigAs->setStatusTip ( tr ( "Save configuration in a new file" ));
   connect ( saveConfigAs, SIGNAL( triggered()), this, SLOT(saveas()));
 
+  saveFrameTimings = new QAction ( tr ( "Save Frame &Timings" ), this );
+  saveFrameTimings->setStatusTip (
+      tr ( "Save per-frame latency measurements as CSV" ));
+  connect ( saveFrameTimings, SIGNAL( triggered()), this,
+      SLOT( saveFrameStats()));
+
   exit = new QAction ( tr ( "&Quit" ), this );
   exit->setShortcut ( QKeySequence::Quit );
   connect ( exit, SIGNAL( triggered()), this, SLOT( quit()));
@@ -1377,6 +1459,7 @@ MainWindow::createMenus ( void )
   fileMenu->addAction ( loadConfig );
   fileMenu->addAction ( saveConfig );
   fileMenu->addAction ( saveConfigAs );
+  fileMenu->addAction ( saveFrameTimings );
   fileMenu->addSeparator();
   fileMenu->addAction ( exit );
 
@@ -1980,12 +2063,36 @@ MainWindow::setDroppedFrames()
 {
   uint64_t dropped;
   QString stringVal;
+  oaFrameStats stats;
 
-	if ( !commonState.camera->isInitialised() ||
-			!commonState.camera->hasControl ( OA_CAM_CTRL_DROPPED )) {
+	if ( !commonState.camera->isInitialised()) {
 		return;
 	}
-  dropped = commonState.camera->readControl ( OA_CAM_CTRL_DROPPED );
+
+  if ( commonState.camera->frameStats ( &stats ) != OA_ERR_NONE ) {
+    stats.frames = 0;
+  }
+  if ( stats.frames ) {
+    // Show median and 99th percentile time from the camera delivering a
+    // frame to the buffer being available again
+    latencyValue->setText ( QString ( "%1/%2ms" ).arg (
+        stats.p50[ OA_FRAME_INTERVAL_TOTAL ] / 1000000.0, 0, 'f', 1 ).arg (
+        stats.p99[ OA_FRAME_INTERVAL_TOTAL ] / 1000000.0, 0, 'f', 1 ));
+    latencyValue->setToolTip ( tr ( "%1 fps, queue depth %2 (max %3), "
+        "%4 callback overruns, callback p99 %5ms, preview %6 frames shown, "
+        "%7 skipped" ).arg ( stats.fps, 0, 'f', 1 ).arg (
+        stats.queueDepth ).arg ( stats.maxQueueDepth ).arg (
+        stats.callbackOverruns ).arg (
+        stats.p99[ OA_FRAME_INTERVAL_CALLBACK ] / 1000000.0, 0, 'f', 2 ).arg (
+        state.previewWidget->getDisplayedFrameCount()).arg (
+        state.previewWidget->getSkippedFrameCount()));
+  }
+
+	if ( commonState.camera->hasControl ( OA_CAM_CTRL_DROPPED )) {
+    dropped = commonState.camera->readControl ( OA_CAM_CTRL_DROPPED );
+  } else {
+    dropped = stats.frames ? stats.droppedFrames : 0;
+  }
   stringVal.setNum ( dropped );
   droppedValue->setText ( stringVal );
 }
@@ -1995,6 +2102,38 @@ void
 MainWindow::clearDroppedFrames ( void )
 {
   droppedValue->setText ( "" );
+  latencyValue->setText ( "" );
+  latencyValue->setToolTip ( "" );
+  if ( commonState.camera->isInitialised()) {
+    commonState.camera->resetFrameStats();
+  }
+  if ( state.previewWidget ) {
+    state.previewWidget->resetDisplayCounts();
+  }
+}
+
+
+void
+MainWindow::saveFrameStats ( void )
+{
+  QString filename;
+
+  if ( !commonState.camera->isInitialised()) {
+    QMessageBox::warning ( TOP_WIDGET, APPLICATION_NAME,
+        tr ( "No camera is connected" ));
+    return;
+  }
+
+  filename = QFileDialog::getSaveFileName ( this, tr ( "Save Frame Timings" ),
+      state.currentDirectory, tr ( "CSV files (*.csv)" ));
+  if ( filename.isEmpty()) {
+    return;
+  }
+  if ( commonState.camera->writeFrameStats (
+      filename.toStdString().c_str()) != OA_ERR_NONE ) {
+    QMessageBox::warning ( TOP_WIDGET, APPLICATION_NAME,
+        tr ( "Unable to write frame timings to " ) + filename );
+  }
 }
 
 void
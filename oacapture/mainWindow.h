@@ -106,6 +106,7 @@ class MainWindow : public QMainWindow
     QLabel*		elapsedValue;
     QLabel*		capturedValue;
     QLabel*		droppedValue;
+    QLabel*		latencyValue;
     QStatusBar*		statusLine;
     QLabel*             timerStatus;
     QLabel*             wheelStatus;
@@ -142,10 +143,12 @@ class MainWindow : public QMainWindow
     QLabel*		elapsedLabel;
     QLabel*		capturedLabel;
     QLabel*		droppedLabel;
+    QLabel*		latencyLabel;
 
     QAction*		loadConfig;
     QAction*		saveConfig;
     QAction*		saveConfigAs;
+    QAction*		saveFrameTimings;
     QAction*		exit;
     QSignalMapper*	cameraSignalMapper;
     QSignalMapper*	filterWheelSignalMapper;
@@ -269,6 +272,7 @@ class MainWindow : public QMainWindow
     void		setCapturedFrames ( unsigned int );
     void    setElapsedTime ( unsigned int );
     void		setDroppedFrames ( void );
+    void		saveFrameStats ( void );
     void		setProgress ( unsigned int );
     void		reveal ( void );
     void		showStatusMessage ( QString );
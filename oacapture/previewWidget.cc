@@ -31,6 +31,7 @@
 #if HAVE_CSTDLIB
 #include <cstdlib>
 #endif
+#include <climits>
 #if HAVE_CMATH
 #include <cmath>
 #endif
@@ -68,6 +69,7 @@ PreviewWidget::PreviewWidget ( QWidget* parent ) : QFrame ( parent )
   lastCapturedFramesUpdateTime = 0;
   capturedFramesDisplayInterval = 200;
   lastDisplayUpdateTime = 0;
+  previewFramesDisplayed = previewFramesSkipped = 0;
   frameDisplayInterval = 1000/15; // display frames per second
   previewEnabled = 1;
   videoFramePixelFormat = config.inputFrameFormat;
@@ -80,6 +82,7 @@ PreviewWidget::PreviewWidget ( QWidget* parent ) : QFrame ( parent )
   previewBufferLength = 0;
   previewImageBuffer[0] = writeImageBuffer[0] = nullptr;
   previewImageBuffer[1] = writeImageBuffer[1] = nullptr;
+  memset ( &focusContext, 0, sizeof ( focusContext ));
   expectedSize = commonConfig.imageSizeX * commonConfig.imageSizeY *
       oaFrameFormats[ videoFramePixelFormat ].bytesPerPixel;
   demosaic = commonConfig.demosaic;
@@ -118,6 +121,7 @@ PreviewWidget::~PreviewWidget()
     free ( writeImageBuffer[0] );
     free ( writeImageBuffer[1] );
   }
+  oaFocusFree ( &focusContext );
 }
 
 
@@ -451,8 +455,8 @@ PreviewWidget::updatePreview ( void* args, void* imageData, int length, void* me
   int			currentWriteBuffer = -1;
   int			writeDemosaicPreviewBuffer = 0;
   int			maxLength;
-	char		timestampStr[64];
-  const char*		timestamp;
+  FRAME_METADATA*	frameMetadata = static_cast<FRAME_METADATA*>( metadata );
+  FRAME_METADATA	localMetadata;
   char			commentStr[64];
   char*			comment;
 
@@ -504,45 +508,41 @@ PreviewWidget::updatePreview ( void* args, void* imageData, int length, void* me
 
   previewPixelFormat = writePixelFormat = self->videoFramePixelFormat;
 
-  // if we have a luminance/chrominance or packed mono/raw colour frame
-  // format then we need to unpack that first
-
-  if ( oaFrameFormats[ self->videoFramePixelFormat ].lumChrom ||
-      oaFrameFormats[ self->videoFramePixelFormat ].packed ) {
-    // this is going to make the flip quite ugly and means we need to
-    // start using currentPreviewBuffer too
-    currentPreviewBuffer = NEXT_FREE_BUFFER ( currentPreviewBuffer );
-    // Convert luminance/chrominance and packed raw colour to RGB.
-    // Packed mono should become GREY8.  We're only converting for
-    // preview here, so nothing needs to be more than 8 bits wide
-    if ( oaFrameFormats[ self->videoFramePixelFormat ].lumChrom ||
-        oaFrameFormats[ self->videoFramePixelFormat ].rawColour ) {
-      previewPixelFormat = OA_PIX_FMT_RGB24;
-    } else {
-      if ( oaFrameFormats[ self->videoFramePixelFormat ].monochrome ) {
-        previewPixelFormat = OA_PIX_FMT_GREY8;
-      } else {
-        qWarning() << "Don't know how to unpack frame format" <<
-            self->videoFramePixelFormat;
-      }
-    }
-    ( void ) oaconvert ( previewBuffer,
-        self->previewImageBuffer[ currentPreviewBuffer ],
-				commonConfig.imageSizeX, commonConfig.imageSizeY,
-				self->videoFramePixelFormat, previewPixelFormat );
-    previewBuffer = self->previewImageBuffer [ currentPreviewBuffer ];
+  ( void ) gettimeofday ( &t, 0 );
+  unsigned long now = static_cast<unsigned long>( t.tv_sec ) * 1000 +
+      static_cast<unsigned long>( t.tv_usec ) / 1000;
 
-    // we can flip the preview image here if required, but not the
-    // image that is going to be written out.
-    // FIX ME -- work this out some time
+  // Decide now whether this frame is going to be displayed, so none of
+  // the preview-only conversions are done for frames that won't be
 
-    if ( self->flipX || self->flipY ) {
-			int axis = ( self->flipX ? OA_FLIP_X : 0 ) | ( self->flipY ?
-					OA_FLIP_Y : 0 );
-      oaFlipImage ( previewBuffer, commonConfig.imageSizeX,
-					commonConfig.imageSizeY, previewPixelFormat, axis );
-    }
+  if ( self->previewEnabled &&
+      ( self->lastDisplayUpdateTime + self->frameDisplayInterval ) < now ) {
+    self->lastDisplayUpdateTime = now;
+    doDisplay = 1;
+    self->previewFramesDisplayed++;
   } else {
+    self->previewFramesSkipped++;
+  }
+
+  // Packed and luminance/chrominance frames are written as they arrive,
+  // so they only need unpacking for the preview.  Anything else may need
+  // transforming before it is written.
+
+  if ( !oaFrameFormats[ self->videoFramePixelFormat ].lumChrom &&
+      !oaFrameFormats[ self->videoFramePixelFormat ].packed ) {
+
+		// Calibrate raw frames before anything else touches them.  This
+		// only does anything for unpacked mono and raw colour formats
+
+		if ( self->calibration.apply ( writeBuffer,
+				self->writeImageBuffer[ NEXT_FREE_BUFFER ( currentWriteBuffer ) ],
+				length, commonConfig.imageSizeX, commonConfig.imageSizeY,
+				self->videoFramePixelFormat,
+				state->controlWidget->getCurrentExposure())) {
+			currentWriteBuffer = NEXT_FREE_BUFFER ( currentWriteBuffer );
+			previewBuffer = writeBuffer =
+					self->writeImageBuffer[ currentWriteBuffer ];
+		}
 
 		// Remove any alpha channel.  This affects both the preview and
 		// the written images, so they can be left pointing to the same thing
@@ -568,11 +568,11 @@ PreviewWidget::updatePreview ( void* args, void* imageData, int length, void* me
       // the user will have to deal with that
 			int axis = ( self->flipX ? OA_FLIP_X : 0 ) | ( self->flipY ?
 					OA_FLIP_Y : 0 );
+			// If the frame is already in one of our buffers it can be
+			// flipped where it is
 			if ( -1 == currentWriteBuffer ) {
 				( void ) memcpy ( self->writeImageBuffer[0], writeBuffer, length );
 				currentWriteBuffer = 0;
-			} else {
-				currentWriteBuffer = !currentWriteBuffer;
 			}
 			// this is an in-place flip
       oaFlipImage ( self->writeImageBuffer[ currentWriteBuffer ],
@@ -585,128 +585,173 @@ PreviewWidget::updatePreview ( void* args, void* imageData, int length, void* me
     }
   }
 
-  if (( !oaFrameFormats[ previewPixelFormat ].fullColour &&
-      oaFrameFormats[ previewPixelFormat ].bytesPerPixel > 1 ) ||
-      ( oaFrameFormats[ previewPixelFormat ].fullColour &&
-      oaFrameFormats[ previewPixelFormat ].bytesPerPixel > 3 )) {
-    currentPreviewBuffer = NEXT_FREE_BUFFER (  currentPreviewBuffer );
-		// FIX ME -- this would surely be more efficient if it weren't done
-		// in place and the reduction used to effect the memcpy?
-    ( void ) memcpy ( self->previewImageBuffer[ currentPreviewBuffer ],
-        previewBuffer, length );
-    // Do this reduction "in place"
-    previewPixelFormat = self->reduceTo8Bit (
-        self->previewImageBuffer[ currentPreviewBuffer ],
-        self->previewImageBuffer[ currentPreviewBuffer ],
-        commonConfig.imageSizeX, commonConfig.imageSizeY, previewPixelFormat );
-    previewBuffer = self->previewImageBuffer [ currentPreviewBuffer ];
-  }
-
-  ( void ) gettimeofday ( &t, 0 );
-  unsigned long now = static_cast<unsigned long>( t.tv_sec ) * 1000 +
-      static_cast<unsigned long>( t.tv_usec ) / 1000;
-
   int cfaPattern = demosaicConf.cfaPattern;
   if ( OA_DEMOSAIC_AUTO == cfaPattern &&
-      oaFrameFormats[ previewPixelFormat ].rawColour ) {
-    cfaPattern = oaFrameFormats[ previewPixelFormat ].cfaPattern;
+      oaFrameFormats[ writePixelFormat ].rawColour ) {
+    cfaPattern = oaFrameFormats[ writePixelFormat ].cfaPattern;
   }
 
-  if ( self->previewEnabled ) {
-    if (( self->lastDisplayUpdateTime + self->frameDisplayInterval ) < now ) {
-      self->lastDisplayUpdateTime = now;
-      doDisplay = 1;
+  if ( doDisplay ) {
+
+    // if we have a luminance/chrominance or packed mono/raw colour frame
+    // format then we need to unpack that first
 
-      if ( self->demosaic && demosaicConf.demosaicPreview ) {
-        if ( oaFrameFormats[ previewPixelFormat ].rawColour ) {
+    if ( oaFrameFormats[ self->videoFramePixelFormat ].lumChrom ||
+        oaFrameFormats[ self->videoFramePixelFormat ].packed ) {
+      // this is going to make the flip quite ugly and means we need to
+      // start using currentPreviewBuffer too
+      currentPreviewBuffer = NEXT_FREE_BUFFER ( currentPreviewBuffer );
+      // Convert luminance/chrominance and packed raw colour to RGB.
+      // Packed mono should become GREY8.  We're only converting for
+      // preview here, so nothing needs to be more than 8 bits wide
+      if ( oaFrameFormats[ self->videoFramePixelFormat ].lumChrom ||
+          oaFrameFormats[ self->videoFramePixelFormat ].rawColour ) {
+        previewPixelFormat = OA_PIX_FMT_RGB24;
+      } else {
+        if ( oaFrameFormats[ self->videoFramePixelFormat ].monochrome ) {
+          previewPixelFormat = OA_PIX_FMT_GREY8;
+        } else {
+          qWarning() << "Don't know how to unpack frame format" <<
+              self->videoFramePixelFormat;
+        }
+      }
+      ( void ) oaconvert ( previewBuffer,
+          self->previewImageBuffer[ currentPreviewBuffer ],
+						commonConfig.imageSizeX, commonConfig.imageSizeY,
+						self->videoFramePixelFormat, previewPixelFormat );
+      previewBuffer = self->previewImageBuffer [ currentPreviewBuffer ];
+
+      // we can flip the preview image here if required, but not the
+      // image that is going to be written out.
+      // FIX ME -- work this out some time
+
+      if ( self->flipX || self->flipY ) {
+					int axis = ( self->flipX ? OA_FLIP_X : 0 ) | ( self->flipY ?
+							OA_FLIP_Y : 0 );
+        oaFlipImage ( previewBuffer, commonConfig.imageSizeX,
+							commonConfig.imageSizeY, previewPixelFormat, axis );
+      }
+    }
+
+    if (( !oaFrameFormats[ previewPixelFormat ].fullColour &&
+        oaFrameFormats[ previewPixelFormat ].bytesPerPixel > 1 ) ||
+        ( oaFrameFormats[ previewPixelFormat ].fullColour &&
+        oaFrameFormats[ previewPixelFormat ].bytesPerPixel > 3 )) {
+      currentPreviewBuffer = NEXT_FREE_BUFFER (  currentPreviewBuffer );
+				// FIX ME -- this would surely be more efficient if it weren't done
+				// in place and the reduction used to effect the memcpy?
+      ( void ) memcpy ( self->previewImageBuffer[ currentPreviewBuffer ],
+          previewBuffer, length );
+      // Do this reduction "in place"
+      previewPixelFormat = self->reduceTo8Bit (
+          self->previewImageBuffer[ currentPreviewBuffer ],
+          self->previewImageBuffer[ currentPreviewBuffer ],
+          commonConfig.imageSizeX, commonConfig.imageSizeY,
+						previewPixelFormat );
+      previewBuffer = self->previewImageBuffer [ currentPreviewBuffer ];
+    }
+
+    if ( self->demosaic && demosaicConf.demosaicPreview ) {
+      if ( oaFrameFormats[ previewPixelFormat ].rawColour ) {
 					currentPreviewBuffer = NEXT_FREE_BUFFER (  currentPreviewBuffer );
-          // Use the demosaicking to copy the data to the previewImageBuffer
-          ( void ) oademosaic ( previewBuffer,
-              self->previewImageBuffer[ currentPreviewBuffer ],
-              commonConfig.imageSizeX, commonConfig.imageSizeY, 8, cfaPattern,
-              demosaicConf.demosaicMethod );
-          if ( demosaicConf.demosaicOutput && previewBuffer == writeBuffer
+        // Use the demosaicking to copy the data to the previewImageBuffer
+        ( void ) oademosaic ( previewBuffer,
+            self->previewImageBuffer[ currentPreviewBuffer ],
+            commonConfig.imageSizeX, commonConfig.imageSizeY, 8, cfaPattern,
+            demosaicConf.demosaicMethod );
+        if ( demosaicConf.demosaicOutput && previewBuffer == writeBuffer
 							&& oaFrameFormats[ self->videoFramePixelFormat ].bytesPerPixel
 							== 1 ) {
-            writeDemosaicPreviewBuffer = 1;
-          }
-          previewPixelFormat = OA_DEMOSAIC_FMT ( previewPixelFormat );
-          previewBuffer = self->previewImageBuffer [ currentPreviewBuffer ];
+          writeDemosaicPreviewBuffer = 1;
         }
+        previewPixelFormat = OA_DEMOSAIC_FMT ( previewPixelFormat );
+        previewBuffer = self->previewImageBuffer [ currentPreviewBuffer ];
       }
+    }
 
-      if ( config.showFocusAid ) {
+    if ( config.showFocusAid ) {
+      double		focusValue;
+
+      // The workspace only needs setting up again when the frame changes
+      if ( self->focusContext.xSize != commonConfig.imageSizeX ||
+          self->focusContext.ySize != commonConfig.imageSizeY ||
+          self->focusContext.frameFormat != previewPixelFormat ) {
+        oaFocusFree ( &self->focusContext );
+        ( void ) oaFocusInit ( &self->focusContext, commonConfig.imageSizeX,
+            commonConfig.imageSizeY, previewPixelFormat );
+      }
+      if ( oaFocusScoreFrame ( &self->focusContext, previewBuffer, 0,
+          &focusValue ) == OA_ERR_NONE ) {
         // This call should be thread-safe
-        state->focusOverlay->addScore ( oaFocusScore ( previewBuffer,
-            0, commonConfig.imageSizeX, commonConfig.imageSizeY,
-						previewPixelFormat ));
+        state->focusOverlay->addScore ( focusValue > INT_MAX ? INT_MAX :
+            ( int ) focusValue );
       }
+    }
 
-      QImage* newImage;
-      QImage* swappedImage = nullptr;
+    QImage* newImage;
+    QImage* swappedImage = nullptr;
 
-      // At this point, one way or another we should have an 8-bit image
-      // for the preview
+    // At this point, one way or another we should have an 8-bit image
+    // for the preview
 
-      // First deal with anything that's mono, including untouched raw
-      // colour
+    // First deal with anything that's mono, including untouched raw
+    // colour
 
-      if ( OA_PIX_FMT_GREY8 == previewPixelFormat ||
-           ( oaFrameFormats[ previewPixelFormat ].rawColour &&
-           ( !self->demosaic || !demosaicConf.demosaicPreview ))) {
-        newImage = new QImage ( static_cast<const uint8_t*>( previewBuffer ),
-            commonConfig.imageSizeX, commonConfig.imageSizeY,
+    if ( OA_PIX_FMT_GREY8 == previewPixelFormat ||
+         ( oaFrameFormats[ previewPixelFormat ].rawColour &&
+         ( !self->demosaic || !demosaicConf.demosaicPreview ))) {
+      newImage = new QImage ( static_cast<const uint8_t*>( previewBuffer ),
+          commonConfig.imageSizeX, commonConfig.imageSizeY,
 						commonConfig.imageSizeX, QImage::Format_Indexed8 );
-        if ( OA_PIX_FMT_GREY8 == previewPixelFormat &&
+      if ( OA_PIX_FMT_GREY8 == previewPixelFormat &&
 						commonConfig.colourise ) {
-          newImage->setColorTable ( self->falseColourTable );
-        } else {
-          newImage->setColorTable ( self->greyscaleColourTable );
-        }
-        swappedImage = newImage;
+        newImage->setColorTable ( self->falseColourTable );
       } else {
-        // and full colour (should just be RGB24 or BGR24 at this point?)
-        // here
-        // Need the stride size here or QImage appears to "tear" the
-        // right hand edge of the image when the X dimension is an odd
-        // number of pixels
-        newImage = new QImage ( static_cast<const uint8_t*>( previewBuffer ),
-            commonConfig.imageSizeX, commonConfig.imageSizeY,
-						commonConfig.imageSizeX * 3, QImage::Format_RGB888 );
-        if ( OA_PIX_FMT_BGR24 == previewPixelFormat ) {
-          swappedImage = new QImage ( newImage->rgbSwapped());
-        } else {
-          swappedImage = newImage;
-        }
+        newImage->setColorTable ( self->greyscaleColourTable );
       }
-
-      // This call should be thread-safe
-      int zoomFactor = state->zoomWidget->getZoomFactor();
-      if ( zoomFactor && zoomFactor != self->currentZoom ) {
-        self->recalculateDimensions ( zoomFactor );
+      swappedImage = newImage;
+    } else {
+      // and full colour (should just be RGB24 or BGR24 at this point?)
+      // here
+      // Need the stride size here or QImage appears to "tear" the
+      // right hand edge of the image when the X dimension is an odd
+      // number of pixels
+      newImage = new QImage ( static_cast<const uint8_t*>( previewBuffer ),
+          commonConfig.imageSizeX, commonConfig.imageSizeY,
+						commonConfig.imageSizeX * 3, QImage::Format_RGB888 );
+      if ( OA_PIX_FMT_BGR24 == previewPixelFormat ) {
+        swappedImage = new QImage ( newImage->rgbSwapped());
+      } else {
+        swappedImage = newImage;
       }
+    }
 
-      if ( self->currentZoom != 100 ) {
-        QImage scaledImage = swappedImage->scaled ( self->currentZoomX,
-          self->currentZoomY );
+    // This call should be thread-safe
+    int zoomFactor = state->zoomWidget->getZoomFactor();
+    if ( zoomFactor && zoomFactor != self->currentZoom ) {
+      self->recalculateDimensions ( zoomFactor );
+    }
 
-        if ( config.showFocusAid ) {
-          // FIX ME -- eh?
-        }
+    if ( self->currentZoom != 100 ) {
+      QImage scaledImage = swappedImage->scaled ( self->currentZoomX,
+        self->currentZoomY );
 
-        pthread_mutex_lock ( &self->imageMutex );
-        self->image = scaledImage.copy();
-        pthread_mutex_unlock ( &self->imageMutex );
-      } else {
-        pthread_mutex_lock ( &self->imageMutex );
-        self->image = swappedImage->copy();
-        pthread_mutex_unlock ( &self->imageMutex );
-      }
-      if ( swappedImage != newImage ) {
-        delete swappedImage;
+      if ( config.showFocusAid ) {
+        // FIX ME -- eh?
       }
-      delete newImage;
+
+      pthread_mutex_lock ( &self->imageMutex );
+      self->image = scaledImage.copy();
+      pthread_mutex_unlock ( &self->imageMutex );
+    } else {
+      pthread_mutex_lock ( &self->imageMutex );
+      self->image = swappedImage->copy();
+      pthread_mutex_unlock ( &self->imageMutex );
+    }
+    if ( swappedImage != newImage ) {
+      delete swappedImage;
     }
+    delete newImage;
   }
 
   OutputHandler* output = nullptr;
@@ -774,8 +819,28 @@ PreviewWidget::updatePreview ( void* args, void* imageData, int length, void* me
 					haveTimestamp = 1;
 				}
 			}
+			// The camera library normally supplies a binary timestamp taken
+			// when the frame arrived, so a local copy of the metadata is only
+			// needed if it didn't or if the timer has a better idea
+			if ( haveTimestamp || !frameMetadata ||
+					!frameMetadata->timestampValid ) {
+				if ( frameMetadata ) {
+					localMetadata = *frameMetadata;
+				} else {
+					memset ( &localMetadata, 0, sizeof ( localMetadata ));
+				}
+				frameMetadata = &localMetadata;
+				if ( !frameMetadata->timestampValid ) {
+					oaTimestampNow ( &frameMetadata->timestamp );
+					frameMetadata->timestampValid = 1;
+				}
+			}
 			if ( haveTimestamp ) {
-        timestamp = ts->timestamp;
+				( void ) snprintf ( frameMetadata->gpsTime,
+						sizeof ( frameMetadata->gpsTime ), "%s", ts->timestamp );
+				frameMetadata->gpsTimeValid = 1;
+				( void ) oaTimestampParse ( ts->timestamp,
+						&frameMetadata->timestamp );
 				timerData.statusValid = timerData.sequenceNoValid = 1;
 				( void ) strcpy ( timerData.status, ts->status );
 				timerData.sequenceNo = ts->index;
@@ -783,18 +848,12 @@ PreviewWidget::updatePreview ( void* args, void* imageData, int length, void* me
         comment = commentStr;
         ( void ) snprintf ( comment, 64, "Timer frame index: %d\n", ts->index );
       } else {
-				QDateTime now = QDateTime::currentDateTimeUtc();
-				// QString dateStr = now.toString ( Qt::ISODate );
-				QString dateStr = now.toString ( "yyyy-MM-ddThh:mm:ss.zzz" );
-				( void ) strncpy ( timestampStr,
-						dateStr.toStdString().c_str(), sizeof ( timestampStr ) - 1);
-        timestamp = timestampStr;
         comment = nullptr;
       }
-      if ( output->addFrame ( writeBuffer, timestamp,
+      if ( output->addFrame ( writeBuffer,
           // This call should be thread-safe
           state->controlWidget->getCurrentExposure(), comment,
-					static_cast<FRAME_METADATA*>( metadata ), &timerData ) < 0 ) {
+					frameMetadata, &timerData ) < 0 ) {
         self->recordingInProgress = 0;
         self->manualStop = 0;
         state->autorunEnabled = 0;
@@ -986,3 +1045,27 @@ PreviewWidget::getTimerResultCode ( void )
 {
 	return lastTimerResultCode;
 }
+
+
+// Counts of frames that were converted for display and those that were
+// only written (or dropped) because the preview wasn't due an update
+
+unsigned long
+PreviewWidget::getDisplayedFrameCount ( void )
+{
+  return previewFramesDisplayed;
+}
+
+
+unsigned long
+PreviewWidget::getSkippedFrameCount ( void )
+{
+  return previewFramesSkipped;
+}
+
+
+void
+PreviewWidget::resetDisplayCounts ( void )
+{
+  previewFramesDisplayed = previewFramesSkipped = 0;
+}
@@ -39,9 +39,11 @@ extern "C" {
 #include <pthread.h>
 
 #include <openastro/camera.h>
+#include <openastro/imgproc.h>
 }
 
 #include "configuration.h"
+#include "calibration.h"
 
 
 class PreviewWidget : public QFrame
@@ -67,6 +69,9 @@ class PreviewWidget : public QFrame
     void		beginRecording ( void );
     void		forceRecordingStop ( void );
 		const char*	getTimerResultCode ( void );
+    unsigned long	getDisplayedFrameCount ( void );
+    unsigned long	getSkippedFrameCount ( void );
+    void		resetDisplayCounts ( void );
 
   public slots:
     void		recentreReticle ( void );
@@ -95,6 +100,8 @@ class PreviewWidget : public QFrame
     unsigned long	lastCapturedFramesUpdateTime;
     int			frameDisplayInterval;
     unsigned long	lastDisplayUpdateTime;
+    unsigned long	previewFramesDisplayed;
+    unsigned long	previewFramesSkipped;
     int			previewEnabled;
     int			videoFramePixelFormat;
     int			framesInFpsCalcPeriod;
@@ -123,7 +130,8 @@ class PreviewWidget : public QFrame
     pthread_mutex_t	imageMutex;
     int			recordingInProgress;
     int			manualStop;
-    int			focusScore;
+    oaFocusContext	focusContext;
+    Calibration		calibration;
 		char		lastTimerResultCode[64];
 
     unsigned int	reduceTo8Bit ( void*, void*, int, int, int );
@@ -907,7 +907,7 @@ CameraControls::updateSliderControl ( int control )
 	}
   cameraConf.CONTROL_VALUE( control ) = value;
   SET_PROFILE_CONTROL( control, value );
-  commonState.camera->setControl ( control, value );
+  commonState.camera->setControlAsync ( control, value );
 }
 
 
@@ -89,6 +89,7 @@ typedef struct
 	// processing config
 	double		stackKappa;
 	unsigned int	maxFramesToStack;
+	int		alignFrames;
 
 } CONFIG;
 
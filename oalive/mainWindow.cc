@@ -35,6 +35,7 @@ extern "C" {
 
 #include <openastro/filterwheel.h>
 #include <openastro/demosaic.h>
+#include <openastro/imgproc.h>
 }
 
 #include "commonState.h"
@@ -187,6 +188,8 @@ MainWindow::MainWindow ( QString configFile )
 #else
   connect ( state.viewWidget, SIGNAL( updateStackedFrameCount ( void )),
       this, SLOT ( setStackedFrames ( void )));
+  connect ( state.viewWidget, SIGNAL( writeStatusMessage ( QString )),
+      this, SLOT ( showStatusMessage ( QString )));
   connect ( state.processingControls, SIGNAL( redrawImage ( void )),
 			state.viewWidget, SLOT ( redrawImage ( void )));
 
@@ -444,6 +447,7 @@ MainWindow::readConfig ( QString configFile )
     config.saveProcessedImage = 0;
 		config.stackKappa = 2.0;
 		config.maxFramesToStack = 20;
+		config.alignFrames = 0;
 #endif
     config.captureDirectory = QString ( defaultDir );
 
@@ -501,6 +505,15 @@ MainWindow::readConfig ( QString configFile )
     fitsConf.siteLongitude = "";
     fitsConf.filter = "";
 
+    calibrationConf.enabled = 0;
+    calibrationConf.scaleDark = 0;
+    calibrationConf.fixHotPixels = 0;
+    calibrationConf.biasFile = "";
+    calibrationConf.darkFile = "";
+    calibrationConf.flatFile = "";
+    calibrationConf.masterMethod = OA_MASTER_MEAN;
+    calibrationConf.buildMaster = 0;
+
 #ifdef OACAPTURE
     config.timerMode = OA_TIMER_MODE_UNSET;
     config.timerEnabled = 0;
@@ -635,6 +648,8 @@ MainWindow::readConfig ( QString configFile )
     config.stackKappa = settings->value ( "stacking/kappa", 2.0 ).toDouble();
     config.maxFramesToStack = settings->value ( "stacking/maxFramesToStack",
 				20 ).toInt();
+    config.alignFrames = settings->value ( "stacking/alignFrames",
+				0 ).toInt();
 #endif
 
 #ifdef OACAPTURE
@@ -1045,6 +1060,26 @@ MainWindow::readConfig ( QString configFile )
       "fits/siteLongitude", "" ).toString();
   fitsConf.filter = settings->value ( "fits/filter", "" ).toString();
 
+  pthread_mutex_lock ( &calibrationConfMutex );
+  calibrationConf.enabled = settings->value ( "calibration/enabled",
+      0 ).toInt();
+  calibrationConf.scaleDark = settings->value ( "calibration/scaleDark",
+      0 ).toInt();
+  calibrationConf.fixHotPixels = settings->value (
+      "calibration/fixHotPixels", 0 ).toInt();
+  calibrationConf.biasFile = settings->value ( "calibration/biasFile",
+      "" ).toString();
+  calibrationConf.darkFile = settings->value ( "calibration/darkFile",
+      "" ).toString();
+  calibrationConf.flatFile = settings->value ( "calibration/flatFile",
+      "" ).toString();
+  calibrationConf.masterMethod = settings->value (
+      "calibration/masterMethod", OA_MASTER_MEAN ).toInt();
+  calibrationConf.buildMaster = settings->value ( "calibration/buildMaster",
+      0 ).toInt();
+  calibrationConf.generation++;
+  pthread_mutex_unlock ( &calibrationConfMutex );
+
 #ifdef OACAPTURE
   config.timerMode = settings->value ( "timer/mode",
       OA_TIMER_MODE_UNSET ).toInt();
@@ -1187,6 +1222,7 @@ MainWindow::writeConfig ( QString configFile )
 
   settings->setValue ( "stacking/kappa", config.stackKappa );
   settings->setValue ( "stacking/maxFramesToStack", config.maxFramesToStack );
+  settings->setValue ( "stacking/alignFrames", config.alignFrames );
 #endif
 
 #ifdef OACAPTURE
@@ -1377,6 +1413,17 @@ MainWindow::writeConfig ( QString configFile )
   settings->setValue ( "fits/siteLongitude", fitsConf.siteLongitude );
   settings->setValue ( "fits/filter", fitsConf.filter );
 
+  settings->setValue ( "calibration/enabled", calibrationConf.enabled );
+  settings->setValue ( "calibration/scaleDark", calibrationConf.scaleDark );
+  settings->setValue ( "calibration/fixHotPixels",
+      calibrationConf.fixHotPixels );
+  settings->setValue ( "calibration/biasFile", calibrationConf.biasFile );
+  settings->setValue ( "calibration/darkFile", calibrationConf.darkFile );
+  settings->setValue ( "calibration/flatFile", calibrationConf.flatFile );
+  settings->setValue ( "calibration/masterMethod",
+      calibrationConf.masterMethod );
+  settings->setValue ( "calibration/buildMaster", calibrationConf.buildMaster );
+
 #ifdef OACAPTURE
   settings->setValue ( "timer/mode", config.timerMode );
   settings->setValue ( "timer/enabled", config.timerEnabled );
@@ -62,7 +62,6 @@ class MainWindow : public QMainWindow
 			~MainWindow();
     void		clearTemperature ( void );
     void		resetTemperatureLabel ( void );
-    void		showStatusMessage ( QString );
     void		destroyLayout ( QLayout* );
     void		setFlipX ( int );
     void		setFlipY ( int );
@@ -180,6 +179,7 @@ class MainWindow : public QMainWindow
 		WaitingSpinnerWidget*	waitSpinner;
 
   public slots:
+    void		showStatusMessage ( QString );
     void		connectCamera( int );
     void		disconnectCamera ( void );
     void		rescanCameras ( void );
@@ -64,12 +64,17 @@ StackingControls::StackingControls ( QWidget* parent ) : QWidget ( parent )
 	stackMaxInput->setFixedWidth ( 100 );
 	stackMaxInput->setText ( QString::number ( config.maxFramesToStack ));
 
+	alignBox = new QCheckBox ( tr ( "Align frames before stacking" ), this );
+	alignBox->setChecked ( config.alignFrames );
+
   connect ( stackingMethodMenu, SIGNAL( currentIndexChanged ( int )), this,
       SLOT( stackingMethodChanged ( int )));
   connect ( kappaInput, SIGNAL( editingFinished()), this,
       SLOT( updateKappaValue()));
   connect ( stackMaxInput, SIGNAL( editingFinished()), this,
       SLOT( updateStackMaxValue()));
+  connect ( alignBox, SIGNAL( stateChanged ( int )), this,
+      SLOT( alignFramesChanged ( int )));
 
   grid = new QGridLayout;
 	grid->addWidget ( methodLabel, 0, 0 );
@@ -78,8 +83,9 @@ StackingControls::StackingControls ( QWidget* parent ) : QWidget ( parent )
 	grid->addWidget ( kappaInput, 1, 1 );
 	grid->addWidget ( stackMaxLabel, 2, 0 );
 	grid->addWidget ( stackMaxInput, 2, 1 );
+	grid->addWidget ( alignBox, 3, 0, 1, 2 );
 
-  grid->setRowStretch ( 3, 1 );
+  grid->setRowStretch ( 4, 1 );
 
   setLayout ( grid );
 }
@@ -115,3 +121,10 @@ StackingControls::updateStackMaxValue ( void )
 	QString m = stackMaxInput->text();
 	config.maxFramesToStack = m.toInt();
 }
+
+
+void
+StackingControls::alignFramesChanged ( int checked )
+{
+	config.alignFrames = ( checked == Qt::Unchecked ) ? 0 : 1;
+}
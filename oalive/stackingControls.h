@@ -65,9 +65,11 @@ class StackingControls : public QWidget
 		QLabel*							stackMaxLabel;
 		QLineEdit*					stackMaxInput;
 		QIntValidator*			stackMaxValidator;
+		QCheckBox*					alignBox;
 
   public slots:
     void		stackingMethodChanged ( int );
     void		updateKappaValue ( void );
     void		updateStackMaxValue ( void );
+    void		alignFramesChanged ( int );
 };
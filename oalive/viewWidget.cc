@@ -31,6 +31,7 @@
 #if HAVE_CSTDLIB
 #include <cstdlib>
 #endif
+#include <climits>
 #if HAVE_CMATH
 #include <cmath>
 #endif
@@ -58,6 +59,11 @@ extern "C" {
 #include "histogramWidget.h"
 #include "state.h"
 
+// Correlation peaks lower than this mean a frame can't be aligned with
+// any confidence
+
+#define	MIN_ALIGNMENT_PEAK	0.05
+
 
 // FIX ME -- Lots of this stuff needs refactoring or placing elsewhere
 // as it's really not anything to do with the actual preview window
@@ -80,6 +86,8 @@ ViewWidget::ViewWidget ( QWidget* parent ) : QFrame ( parent )
   viewBufferLength = 0;
   viewImageBuffer[0] = writeImageBuffer[0] = 0;
   viewImageBuffer[1] = writeImageBuffer[1] = 0;
+  memset ( &focusContext, 0, sizeof ( focusContext ));
+  memset ( &registration, 0, sizeof ( registration ));
 	originalBuffer = 0;
 	previousFrames = 0;
 	maxFrames = nextFrame = previousFrameArraySize = 0;
@@ -155,6 +163,8 @@ ViewWidget::~ViewWidget()
     free ( writeImageBuffer[0] );
     free ( writeImageBuffer[1] );
   }
+  oaFocusFree ( &focusContext );
+  oaRegistrationFree ( &registration );
 
 	if ( previousFrames ) {
 		unsigned int i;
@@ -209,6 +219,7 @@ ViewWidget::updateFrameSize ( void )
 			previousFrames[i] = 0;
 		}
 	}
+	registration.haveReference = 0;
 }
 
 
@@ -468,7 +479,6 @@ ViewWidget::addImage ( void* args, void* imageData, int length, void* metadata )
   OutputHandler*	outputFrame;
   OutputHandler*	outputProcessed;
   void*			writeBuffer = imageData;
-  char		timestamp[64];
   char*			comment;
 	unsigned int	width, height;
 
@@ -558,6 +568,19 @@ ViewWidget::addImage ( void* args, void* imageData, int length, void* metadata )
     }
   } else {
 
+		// Calibrate raw frames before anything else touches them.  This
+		// only does anything for unpacked mono and raw colour formats
+
+		if ( self->calibration.apply ( self->viewBuffer,
+				self->writeImageBuffer[ NEXT_FREE_BUFFER (
+				self->currentWriteBuffer ) ], length, commonConfig.imageSizeX,
+				commonConfig.imageSizeY, self->viewPixelFormat,
+				state->cameraControls->getCurrentExposure())) {
+			self->currentWriteBuffer = NEXT_FREE_BUFFER ( self->currentWriteBuffer );
+			self->viewBuffer = writeBuffer =
+					self->writeImageBuffer[ self->currentWriteBuffer ];
+		}
+
 		// Remove any alpha channel.  This affects both the preview and
 		// the written images, so they can be left pointing to the same thing
 		// at this point
@@ -582,11 +605,11 @@ ViewWidget::addImage ( void* args, void* imageData, int length, void* metadata )
       // the user will have to deal with that
 			int axis = ( self->flipX ? OA_FLIP_X : 0 ) | ( self->flipY ?
 					OA_FLIP_Y : 0 );
+			// If the frame is already in one of our buffers it can be
+			// flipped where it is
 			if ( -1 == self->currentWriteBuffer ) {
 				( void ) memcpy ( self->writeImageBuffer[0], writeBuffer, length );
 				self->currentWriteBuffer = 0;
-			} else {
-				self->currentWriteBuffer = !self->currentWriteBuffer;
 			}
 			// this is an in-place flip
       oaFlipImage ( self->writeImageBuffer[ self->currentWriteBuffer ],
@@ -617,7 +640,41 @@ ViewWidget::addImage ( void* args, void* imageData, int length, void* metadata )
     self->viewBuffer = self->viewImageBuffer [ self->currentViewBuffer ];
   }
 
-	if ( self->maxFrames < config.maxFramesToStack &&
+	// Work out how far this frame has drifted from the first one of the
+	// stack so it can be moved back into line as it is added.  Frames that
+	// don't look enough like the first to be sure are left out of the
+	// stack altogether
+
+	int stackFrame = 1, alignFrame = 0;
+	double alignX = 0, alignY = 0;
+	if ( config.alignFrames && state->stackingMethod != OA_STACK_NONE ) {
+		if ( self->registration.xSize != commonConfig.imageSizeX ||
+				self->registration.ySize != commonConfig.imageSizeY ||
+				self->registration.frameFormat != self->viewPixelFormat ) {
+			oaRegistrationFree ( &self->registration );
+			if ( oaRegistrationInit ( &self->registration,
+					commonConfig.imageSizeX, commonConfig.imageSizeY,
+					self->viewPixelFormat, 0, 0 ) != OA_ERR_NONE ) {
+				// This only happens once for each frame size and format, as
+				// the failed init still records them
+				emit self->writeStatusMessage ( tr ( "Can't align frames of "
+						"format %1, stacking them unaligned" ).arg (
+						oaFrameFormats[ self->viewPixelFormat ].name ));
+			}
+		}
+		if ( !self->registration.haveReference ) {
+			( void ) oaRegistrationSetReference ( &self->registration,
+					self->viewBuffer );
+		} else if ( oaRegistrationMeasure ( &self->registration,
+				self->viewBuffer, MIN_ALIGNMENT_PEAK, &alignX, &alignY ) ==
+				OA_ERR_NONE ) {
+			alignFrame = 1;
+		} else {
+			stackFrame = 0;
+		}
+	}
+
+	if ( stackFrame && self->maxFrames < config.maxFramesToStack &&
 			self->maxFrames == self->nextFrame ) {
 		self->maxFrames++;
 
@@ -644,7 +701,7 @@ ViewWidget::addImage ( void* args, void* imageData, int length, void* metadata )
 			commonConfig.imageSizeY *
 			oaFrameFormats[ self->viewPixelFormat ].bytesPerPixel;
 	
-	if ( !self->previousFrames[ self->nextFrame ]) {
+	if ( stackFrame && !self->previousFrames[ self->nextFrame ]) {
 		if (!( self->previousFrames[ self->nextFrame ] =
 				malloc ( viewFrameLength ))) {
 			qDebug() << "malloc of frame history buffer failed!";
@@ -655,23 +712,26 @@ ViewWidget::addImage ( void* args, void* imageData, int length, void* metadata )
 
   outputFrame = state->controlsWidget->getFrameOutputHandler();
   if ( outputFrame ) {
-		QDateTime now = QDateTime::currentDateTimeUtc();
-		// QString dateStr = now.toString ( Qt::ISODate );
-		QString dateStr = now.toString ( "yyyy-MM-ddThh:mm:ss.zzz" );
-		( void ) strncpy ( timestamp,
-				dateStr.toStdString().c_str(), sizeof ( timestamp ) - 1);
     comment = 0;
-    outputFrame->addFrame ( self->viewBuffer, timestamp,
+    outputFrame->addFrame ( self->viewBuffer,
         state->cameraControls->getCurrentExposure(), comment,
 				static_cast<FRAME_METADATA*>( metadata ), nullptr );
   }
 
-	// copy the view buffer to the frame history
-	memcpy ( self->previousFrames[ self->nextFrame ], self->viewBuffer,
-			viewFrameLength );
+	// copy the view buffer to the frame history, lined up with the rest
+	// of the stack if it is being aligned
+	if ( stackFrame ) {
+		if ( alignFrame ) {
+			( void ) oaRegistrationShift ( &self->registration, self->viewBuffer,
+					self->previousFrames[ self->nextFrame ], alignX, alignY );
+		} else {
+			memcpy ( self->previousFrames[ self->nextFrame ], self->viewBuffer,
+					viewFrameLength );
+		}
 
-	self->nextFrame++;
-	self->nextFrame %= config.maxFramesToStack;
+		self->nextFrame++;
+		self->nextFrame %= config.maxFramesToStack;
+	}
 
 	switch ( state->stackingMethod ) {
 		case OA_STACK_NONE:
@@ -723,13 +783,8 @@ ViewWidget::addImage ( void* args, void* imageData, int length, void* metadata )
 
   outputProcessed = state->controlsWidget->getProcessedOutputHandler();
   if ( outputProcessed ) {
-		QDateTime now = QDateTime::currentDateTimeUtc();
-		// QString dateStr = now.toString ( Qt::ISODate );
-		QString dateStr = now.toString ( "yyyy-MM-ddThh:mm:ss.zzz" );
-		( void ) strncpy ( timestamp,
-				dateStr.toStdString().c_str(), sizeof ( timestamp ) - 1);
     comment = 0;
-    outputProcessed->addFrame ( self->viewBuffer, timestamp,
+    outputProcessed->addFrame ( self->viewBuffer,
         state->cameraControls->getCurrentExposure(), comment,
 				static_cast<FRAME_METADATA*>( metadata ), nullptr );
   }
@@ -848,6 +903,7 @@ ViewWidget::restart()
 		}
 	}
   maxFrames = nextFrame = 0;
+	registration.haveReference = 0;
 }
 
 
@@ -1349,9 +1405,21 @@ ViewWidget::_processAndDisplay ( void* tmpState, ViewWidget* self,
     doDisplay = 1;
 
     if ( config.showFocusAid ) {
-      state->focusOverlay->addScore ( oaFocusScore ( self->viewBuffer,
-          0, commonConfig.imageSizeX, commonConfig.imageSizeY,
-					self->viewPixelFormat ));
+      double		focusValue;
+
+      // The workspace only needs setting up again when the frame changes
+      if ( self->focusContext.xSize != commonConfig.imageSizeX ||
+          self->focusContext.ySize != commonConfig.imageSizeY ||
+          self->focusContext.frameFormat != self->viewPixelFormat ) {
+        oaFocusFree ( &self->focusContext );
+        ( void ) oaFocusInit ( &self->focusContext, commonConfig.imageSizeX,
+            commonConfig.imageSizeY, self->viewPixelFormat );
+      }
+      if ( oaFocusScoreFrame ( &self->focusContext, self->viewBuffer, 0,
+          &focusValue ) == OA_ERR_NONE ) {
+        state->focusOverlay->addScore ( focusValue > INT_MAX ? INT_MAX :
+            ( int ) focusValue );
+      }
     }
 
     QImage* newImage;
@@ -37,9 +37,11 @@
 
 extern "C" {
 #include <openastro/camera.h>
+#include <openastro/imgproc.h>
 }
 
 #include "configuration.h"
+#include "calibration.h"
 
 
 class ViewWidget : public QFrame
@@ -96,6 +98,7 @@ class ViewWidget : public QFrame
     void		startNextExposure ( void );
 		void		updateStackedFrameCount ( void );
 		void		enableSpinner ( int );
+		void		writeStatusMessage ( QString );
 
   private:
 		void			_recalcCoeffs ( void );
@@ -127,6 +130,9 @@ class ViewWidget : public QFrame
 		void*		rgbBuffer;
 		int			rgbBufferSize;
     void*		viewImageBuffer[2];
+    oaFocusContext	focusContext;
+    oaRegistration	registration;
+    Calibration		calibration;
     int			viewBufferLength;
     void*		writeImageBuffer[2];
     int			writeBufferLength;